@@ -0,0 +1,12 @@
+#pragma once
+// ba-bench 的子命令入口，argv 不含程序名与子命令名。
+
+namespace BA::bench {
+
+// PermissionCache 读吞吐：单锁与分片模式在不同线程数下的对比
+int runCacheBench(int argc, char** argv);
+
+// PermissionManager 端到端：在内存 SQLite 上载入合成数据集后测量检查、重建、失效扇出与预热
+int runManagerBench(int argc, char** argv);
+
+} // namespace BA::bench
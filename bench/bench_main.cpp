@@ -0,0 +1,20 @@
+// 用法:
+//   ba-bench [manager] [组数=200] [继承层数=4] [玩家数=10000] [每组规则数=20]
+//   ba-bench cache [分片数=16] [每轮毫秒=500] [玩家数=10000]
+
+#include "bench.h"
+#include <cstdio>
+#include <cstring>
+
+int main(int argc, char** argv) {
+    if (argc > 1 && std::strcmp(argv[1], "cache") == 0) return BA::bench::runCacheBench(argc - 2, argv + 2);
+    if (argc > 1 && std::strcmp(argv[1], "manager") == 0) return BA::bench::runManagerBench(argc - 2, argv + 2);
+    if (argc > 1 && (std::strcmp(argv[1], "-h") == 0 || std::strcmp(argv[1], "--help") == 0)) {
+        std::printf(
+            "ba-bench [manager] [groups=200] [depth=4] [players=10000] [rules=20]\n"
+            "ba-bench cache [shards=16] [round-ms=500] [players=10000]\n"
+        );
+        return 0;
+    }
+    return BA::bench::runManagerBench(argc - 1, argv + 1);
+}
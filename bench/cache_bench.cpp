@@ -0,0 +1,125 @@
+// PermissionCache 读吞吐基准：比较单锁模式与分片模式在不同线程数下的表现。
+// 用法: ba-bench cache [分片数=16] [每轮毫秒=500] [玩家数=10000]
+// 每轮启动 N 个读线程模拟 hasPermission 的缓存命中路径（快照 + 默认权限层 + 决策缓存），
+// 同时由 1 个写线程持续替换随机玩家的快照，模拟管理员编辑时失效线程的写入。
+
+#include "bench.h"
+#include "permission/PermissionCache.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <algorithm>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace BA::permission;
+using namespace BA::permission::internal;
+
+namespace BA::bench {
+
+namespace {
+
+std::shared_ptr<const PlayerPermissionSnapshot> makeSnapshot(size_t seed) {
+    std::vector<CompiledPermissionRule> rules;
+    for (size_t i = 0; i < 16; ++i) {
+        rules.emplace_back("plugin" + std::to_string((seed + i) % 32) + ".*", i % 3 != 0);
+    }
+    rules.emplace_back("essentials.home", true);
+    return std::make_shared<const PlayerPermissionSnapshot>(std::move(rules));
+}
+
+// 运行一轮，返回每秒读操作数
+double runRound(size_t shardCount, unsigned readers, std::chrono::milliseconds duration, size_t playerCount) {
+    PermissionCache cache(shardCount);
+    cache.setPlayerCacheMaxBytes(0); // 基准只关注锁竞争，不触发淘汰
+
+    std::vector<PlayerKey> players;
+    players.reserve(playerCount);
+    for (size_t i = 0; i < playerCount; ++i) {
+        players.push_back(PlayerKey::fromString("00000000-0000-0000-0000-" + std::to_string(100000000000ull + i)));
+        cache.storePlayerPermissions(players.back(), makeSnapshot(i));
+    }
+    cache.populateAllPermissionDefaults({
+        {"essentials.spawn", true},
+        {"essentials.home",  true},
+        {"essentials.fly",   false}
+    });
+
+    const std::string nodes[] = {"essentials.home", "plugin3.use", "essentials.spawn", "plugin17.admin"};
+
+    std::atomic<bool>     start{false};
+    std::atomic<bool>     stop{false};
+    std::atomic<uint64_t> totalOps{0};
+    std::atomic<bool>     sink{false}; // 防止编译器优化掉读取结果
+
+    std::vector<std::thread> threads;
+    for (unsigned t = 0; t < readers; ++t) {
+        threads.emplace_back([&, t] {
+            std::mt19937_64 rng(t + 1);
+            uint64_t        ops    = 0;
+            bool            result = false;
+            while (!start.load(std::memory_order_acquire)) std::this_thread::yield();
+            while (!stop.load(std::memory_order_relaxed)) {
+                const auto& uuid     = players[rng() % players.size()];
+                const auto& node     = nodes[ops % 4];
+                auto        snapshot = cache.findPlayerPermissions(uuid);
+                auto        layer    = cache.getDefaultLayer();
+                if (!snapshot) continue;
+                if (auto memo = cache.findDecision(uuid, snapshot.get(), layer->version, node)) {
+                    result ^= *memo;
+                } else {
+                    bool value = snapshot->evaluate(node).value_or(layer->rules.evaluate(node).value_or(false));
+                    cache.storeDecision(uuid, snapshot, layer->version, node, value);
+                    result ^= value;
+                }
+                ++ops;
+            }
+            totalOps.fetch_add(ops, std::memory_order_relaxed);
+            if (result) sink.store(true, std::memory_order_relaxed);
+        });
+    }
+    threads.emplace_back([&] {
+        std::mt19937_64 rng(12345);
+        while (!start.load(std::memory_order_acquire)) std::this_thread::yield();
+        while (!stop.load(std::memory_order_relaxed)) {
+            size_t i = rng() % players.size();
+            cache.storePlayerPermissions(players[i], makeSnapshot(i + 1));
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+        }
+    });
+
+    auto begin = std::chrono::steady_clock::now();
+    start.store(true, std::memory_order_release);
+    std::this_thread::sleep_for(duration);
+    stop.store(true);
+    for (auto& thread : threads) thread.join();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    return static_cast<double>(totalOps.load()) / seconds;
+}
+
+} // namespace
+
+int runCacheBench(int argc, char** argv) {
+    size_t   shards     = argc > 0 ? std::strtoul(argv[0], nullptr, 10) : 16;
+    auto     duration   = std::chrono::milliseconds(argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 500);
+    size_t   players    = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 10000;
+    unsigned maxThreads = std::max(1u, std::thread::hardware_concurrency());
+
+    // 线程数按 1, 2, 4, ... 递增，最后一轮使用全部核心
+    std::vector<unsigned> threadCounts;
+    for (unsigned n = 1; n < maxThreads; n *= 2) threadCounts.push_back(n);
+    threadCounts.push_back(maxThreads);
+
+    std::printf("%-8s %16s %16s %8s\n", "threads", "1 shard (ops/s)", "sharded (ops/s)", "ratio");
+    for (unsigned readers : threadCounts) {
+        double single  = runRound(1, readers, duration, players);
+        double sharded = runRound(shards, readers, duration, players);
+        std::printf("%-8u %16.0f %16.0f %8.2f\n", readers, single, sharded, sharded / single);
+    }
+    return 0;
+}
+
+} // namespace BA::bench
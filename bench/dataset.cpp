@@ -0,0 +1,117 @@
+#include "dataset.h"
+#include "permission/PermissionManager.h"
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <set>
+
+namespace BA::bench {
+
+namespace {
+
+std::string makeUuid(std::mt19937_64& rng) {
+    uint64_t high = rng(), low = rng();
+    char     buffer[37];
+    std::snprintf(
+        buffer,
+        sizeof(buffer),
+        "%08x-%04x-4%03x-%04x-%012llx",
+        static_cast<unsigned>(high >> 32),
+        static_cast<unsigned>((high >> 16) & 0xFFFF),
+        static_cast<unsigned>(high & 0xFFF),
+        static_cast<unsigned>(0x8000 | ((low >> 48) & 0x3FFF)),
+        static_cast<unsigned long long>(low & 0xFFFFFFFFFFFFull)
+    );
+    return buffer;
+}
+
+} // namespace
+
+Dataset generateDataset(const DatasetSpec& spec) {
+    Dataset         dataset;
+    std::mt19937_64 rng(spec.seed);
+
+    for (size_t p = 0; p < spec.plugins; ++p) {
+        for (size_t n = 0; n < spec.nodesPerPlugin; ++n) {
+            dataset.nodes.push_back("plugin" + std::to_string(p) + ".node" + std::to_string(n));
+            if (n % 8 == 0) dataset.defaultNodes.push_back(dataset.nodes.back());
+        }
+    }
+
+    // 组按层排列：第 L 层的组以第 L-1 层同一列的组为父组，偶尔再多继承一个上一层的组
+    size_t depth          = std::max<size_t>(spec.depth, 1);
+    size_t groupsPerLevel = std::max<size_t>((spec.groups + depth - 1) / depth, 1);
+    dataset.groups.resize(spec.groups);
+    for (size_t i = 0; i < spec.groups; ++i) {
+        auto&  group   = dataset.groups[i];
+        size_t level   = i / groupsPerLevel;
+        group.name     = "group" + std::to_string(i);
+        group.priority = static_cast<int>(level * 10 + i % 10);
+        if (level > 0) {
+            group.parents.push_back(i - groupsPerLevel);
+            if (rng() % 4 == 0) {
+                size_t extra = (level - 1) * groupsPerLevel + rng() % groupsPerLevel;
+                if (extra != group.parents.front()) group.parents.push_back(extra);
+            }
+        }
+
+        std::set<std::string> rules;
+        while (rules.size() < std::min(spec.rulesPerGroup, dataset.nodes.size())) {
+            size_t      kind = rng() % 20;
+            const auto& node = dataset.nodes[rng() % dataset.nodes.size()];
+            if (kind < 3) {
+                rules.insert(node.substr(0, node.find('.')) + ".*");
+            } else if (kind < 6) {
+                rules.insert("-" + node);
+            } else {
+                rules.insert(node);
+            }
+        }
+        group.rules.assign(rules.begin(), rules.end());
+    }
+
+    // 玩家一半的组取自最深一层，以覆盖完整的继承链
+    size_t lastLevelStart = spec.groups > groupsPerLevel ? (spec.groups - 1) / groupsPerLevel * groupsPerLevel : 0;
+    dataset.players.reserve(spec.players);
+    dataset.memberships.reserve(spec.players);
+    for (size_t i = 0; i < spec.players; ++i) {
+        dataset.players.push_back(makeUuid(rng));
+        std::set<size_t> groups;
+        while (spec.groups > 0 && groups.size() < std::min(spec.groupsPerPlayer, spec.groups)) {
+            if (rng() % 2 == 0) {
+                groups.insert(lastLevelStart + rng() % (spec.groups - lastLevelStart));
+            } else {
+                groups.insert(rng() % spec.groups);
+            }
+        }
+        dataset.memberships.emplace_back(groups.begin(), groups.end());
+    }
+    return dataset;
+}
+
+size_t loadDataset(permission::PermissionManager& manager, const Dataset& dataset) {
+    size_t failures = 0;
+    for (const auto& node : dataset.nodes) {
+        bool isDefault = std::find(dataset.defaultNodes.begin(), dataset.defaultNodes.end(), node)
+                      != dataset.defaultNodes.end();
+        if (!manager.registerPermission(node, "", isDefault)) ++failures;
+    }
+    for (const auto& group : dataset.groups) {
+        if (!manager.createGroup(group.name)) ++failures;
+        if (!manager.setGroupPriority(group.name, group.priority)) ++failures;
+    }
+    for (const auto& group : dataset.groups) {
+        for (size_t parent : group.parents) {
+            if (!manager.addGroupInheritance(group.name, dataset.groups[parent].name)) ++failures;
+        }
+        failures += group.rules.size() - manager.addPermissionsToGroup(group.name, group.rules);
+    }
+    for (size_t i = 0; i < dataset.players.size(); ++i) {
+        std::vector<std::string> names;
+        for (size_t group : dataset.memberships[i]) names.push_back(dataset.groups[group].name);
+        failures += names.size() - manager.addPlayerToGroups(dataset.players[i], names);
+    }
+    return failures;
+}
+
+} // namespace BA::bench
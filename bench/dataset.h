@@ -0,0 +1,48 @@
+#pragma once
+// 合成数据集：N 个组、D 层继承、P 个玩家、每组 R 条规则。
+// 同一组参数和种子总是生成相同的数据，便于在修改前后对比结果。
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace BA::permission {
+class PermissionManager;
+}
+
+namespace BA::bench {
+
+struct DatasetSpec {
+    size_t   groups          = 200;   // 组数 N
+    size_t   depth           = 4;     // 继承层数 D，第 0 层没有父组
+    size_t   players         = 10000; // 玩家数 P
+    size_t   rulesPerGroup   = 20;    // 每个组的规则数 R
+    size_t   groupsPerPlayer = 2;     // 每个玩家直接所属的组数
+    size_t   plugins         = 32;    // 权限节点按 "pluginK.nodeM" 命名
+    size_t   nodesPerPlugin  = 16;
+    uint64_t seed            = 42;
+};
+
+struct DatasetGroup {
+    std::string              name;
+    int                      priority = 0;
+    std::vector<size_t>      parents; // 父组在 Dataset::groups 中的下标
+    std::vector<std::string> rules;   // 可带 "-" 前缀表示否定，可含通配符
+};
+
+struct Dataset {
+    std::vector<DatasetGroup>        groups;
+    std::vector<std::string>         players;       // 标准格式的 UUID
+    std::vector<std::vector<size_t>> memberships;   // 与 players 对应，直接所属组的下标
+    std::vector<std::string>         nodes;         // 所有 "pluginK.nodeM" 节点，用作检查目标
+    std::vector<std::string>         defaultNodes;  // 注册时默认值为 true 的节点
+};
+
+// 按参数生成数据集（只在内存中）
+Dataset generateDataset(const DatasetSpec& spec);
+
+// 通过 PermissionManager 的公开接口写入数据集，返回写入失败的操作数
+size_t loadDataset(permission::PermissionManager& manager, const Dataset& dataset);
+
+} // namespace BA::bench
@@ -0,0 +1,305 @@
+// PermissionManager 端到端基准：在内存 SQLite 上载入合成数据集，依次测量
+//   1. hasPermission 冷启动（玩家快照未缓存，需要查询数据库并构建）
+//   2. hasPermission 决策未命中（快照已缓存，首次检查某个节点）
+//   3. hasPermission 命中（决策缓存命中）与按 PermissionId 检查
+//   4. getAllPermissionsForPlayer 首次构建与缓存命中
+//   5. 在线玩家反向查询：filterPlayersWithPermission 逐个过滤与 getOnlinePlayersWithPermission 索引
+//   6. GROUP_MODIFIED 扇出（直接驱动 PermissionCache 与 AsyncCacheInvalidator）
+//   7. 带玩家预热的 init
+//   8. NDJSON 导出与导入到一个空的数据库
+// 用法: ba-bench manager [组数=200] [继承层数=4] [玩家数=10000] [每组规则数=20]
+
+#include "bench.h"
+#include "dataset.h"
+#include "db/DatabaseFactory.h"
+#include "permission/AsyncCacheInvalidator.h"
+#include "permission/DataTransfer.h"
+#include "permission/PermissionCache.h"
+#include "permission/PermissionManager.h"
+#include "permission/PermissionStorage.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using namespace BA::permission;
+using namespace BA::permission::internal;
+
+namespace BA::bench {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double secondsSince(Clock::time_point since) { return std::chrono::duration<double>(Clock::now() - since).count(); }
+
+void report(const char* name, size_t ops, double seconds) {
+    double perOp = ops > 0 ? seconds * 1e9 / static_cast<double>(ops) : 0;
+    if (perOp >= 1e8) {
+        std::printf("%-44s %10zu %12.1f ms/op\n", name, ops, perOp / 1e6);
+    } else if (perOp >= 1e5) {
+        std::printf("%-44s %10zu %12.1f us/op\n", name, ops, perOp / 1e3);
+    } else {
+        std::printf("%-44s %10zu %12.0f ns/op\n", name, ops, perOp);
+    }
+}
+
+// 在不经过 PermissionManager 的情况下，把数据集的组关系与玩家快照直接放进缓存
+void populateCache(PermissionCache& cache, const Dataset& dataset, const std::vector<size_t>& players) {
+    uint64_t epoch = cache.getGroupEpoch();
+    for (size_t i : players) {
+        std::vector<GroupDetails> details;
+        std::set<std::string>     direct;
+        std::set<std::string>     relevant;
+        for (size_t group : dataset.memberships[i]) {
+            const auto& name = dataset.groups[group].name;
+            details.emplace_back("id-" + name, name, "", dataset.groups[group].priority);
+            direct.insert(name);
+            auto ancestors = cache.getAllAncestorGroups(name);
+            relevant.insert(ancestors.begin(), ancestors.end());
+        }
+        auto key = PlayerKey::fromString(dataset.players[i]);
+        cache.storePlayerGroups(
+            key,
+            std::make_shared<const PlayerGroupsSnapshot>(std::move(details), epoch, cache.captureGroupGenerations(direct))
+        );
+        cache.storePlayerPermissions(
+            key,
+            std::make_shared<const PlayerPermissionSnapshot>(
+                std::vector<CompiledPermissionRule>{},
+                epoch,
+                cache.captureGroupGenerations(relevant)
+            )
+        );
+    }
+}
+
+// GROUP_MODIFIED 扇出：修改第 0 层的组，失效其所有后代组并释放受影响的离线玩家
+void benchGroupModifiedFanOut(db::IDatabase& db, const Dataset& dataset) {
+    PermissionStorage     storage(&db);
+    PermissionCache       cache(16);
+    AsyncCacheInvalidator invalidator(cache, storage);
+    cache.setPlayerCacheMaxBytes(0);
+
+    std::unordered_map<std::string, std::set<std::string>> parentToChildren, childToParents;
+    for (const auto& group : dataset.groups) {
+        for (size_t parent : group.parents) {
+            parentToChildren[dataset.groups[parent].name].insert(group.name);
+            childToParents[group.name].insert(dataset.groups[parent].name);
+        }
+    }
+    cache.populateInheritance(std::move(parentToChildren), std::move(childToParents));
+
+    std::vector<size_t> all(dataset.players.size());
+    for (size_t i = 0; i < all.size(); ++i) all[i] = i;
+    populateCache(cache, dataset, all);
+    // 十分之一的玩家在线，它们的缓存不会被释放
+    for (size_t i = 0; i < dataset.players.size(); i += 10) cache.pinPlayer(PlayerKey::fromString(dataset.players[i]));
+
+    std::vector<std::string> roots;
+    for (const auto& group : dataset.groups) {
+        if (group.parents.empty() && roots.size() < 10) roots.push_back(group.name);
+    }
+
+    // 单个工作线程按先进先出处理，stop() 返回时 GROUP_MODIFIED 一定已处理完
+    double seconds  = 0;
+    size_t released = 0;
+    for (const auto& root : roots) {
+        size_t before = cache.getStats().playerPermissionEntries;
+        invalidator.start(1);
+        auto start = Clock::now();
+        invalidator.enqueueTask({CacheInvalidationTaskType::GROUP_MODIFIED, root});
+        invalidator.stop();
+        seconds  += secondsSince(start);
+        released += before - cache.getStats().playerPermissionEntries;
+        populateCache(cache, dataset, all); // 恢复被释放的玩家，不计入耗时
+    }
+    report("GROUP_MODIFIED fan-out (per task)", roots.size(), seconds);
+    std::printf("    players released per task: %zu\n", roots.empty() ? 0 : released / roots.size());
+}
+
+// 导出整个数据集到内存，再导入一个新的内存数据库，最后从新库导出比较大小
+bool benchTransfer(db::IDatabase& db) {
+    PermissionStorage source(&db);
+    std::string       exported;
+    auto              start = Clock::now();
+    auto exportStats = exportDataset(source, [&exported](std::string_view chunk) {
+        exported.append(chunk);
+        return true;
+    });
+    double exportSeconds = secondsSince(start);
+    size_t records = exportStats.permissions + exportStats.groups + exportStats.inheritance + exportStats.rules
+                   + exportStats.memberships;
+    report("export (per record)", records, exportSeconds);
+
+    db::SQLiteOptions sqliteOptions;
+    sqliteOptions.journalMode = "memory";
+    auto              target  = db::DatabaseFactory::createPooledSQLite(":memory:", 0, sqliteOptions);
+    PermissionStorage storage(target.get());
+    if (!storage.ensureTables()) return false;
+
+    start = Clock::now();
+    DatasetImporter importer(storage);
+    for (size_t pos = 0; pos < exported.size(); pos += 64 * 1024) {
+        importer.feed(std::string_view(exported).substr(pos, 64 * 1024));
+    }
+    auto   importStats   = importer.finish();
+    double importSeconds = secondsSince(start);
+    report("import (per record)", records, importSeconds);
+
+    std::string roundTrip;
+    exportDataset(storage, [&roundTrip](std::string_view chunk) {
+        roundTrip.append(chunk);
+        return true;
+    });
+    std::printf(
+        "    %.1f MB, %zu records, %zu skipped, round trip %s\n",
+        static_cast<double>(exported.size()) / (1024 * 1024),
+        records,
+        importStats.skipped,
+        roundTrip.size() == exported.size() ? "same size" : "DIFFERENT SIZE"
+    );
+    return exportStats.success && importStats.success && importStats.skipped == 0;
+}
+
+} // namespace
+
+int runManagerBench(int argc, char** argv) {
+    DatasetSpec spec;
+    if (argc > 0) spec.groups = std::strtoul(argv[0], nullptr, 10);
+    if (argc > 1) spec.depth = std::strtoul(argv[1], nullptr, 10);
+    if (argc > 2) spec.players = std::strtoul(argv[2], nullptr, 10);
+    if (argc > 3) spec.rulesPerGroup = std::strtoul(argv[3], nullptr, 10);
+    std::printf(
+        "dataset: %zu groups, depth %zu, %zu players, %zu rules/group\n",
+        spec.groups,
+        spec.depth,
+        spec.players,
+        spec.rulesPerGroup
+    );
+
+    Dataset           dataset = generateDataset(spec);
+    db::SQLiteOptions sqliteOptions;
+    sqliteOptions.journalMode = "memory"; // 内存数据库不支持 WAL
+    auto db                   = db::DatabaseFactory::createPooledSQLite(":memory:", 0, sqliteOptions);
+
+    PermissionOptions options;
+    options.enableWarmup        = false;
+    options.playerCacheMaxBytes = 0; // 基准不触发淘汰
+    options.threadPoolSize      = 2;
+    options.ioThreadPoolSize    = 1;
+
+    auto& manager = PermissionManager::getInstance();
+    if (!manager.init(db.get(), options)) {
+        std::fprintf(stderr, "PermissionManager 初始化失败\n");
+        return 1;
+    }
+
+    auto   loadStart = Clock::now();
+    size_t failures  = loadDataset(manager, dataset);
+    std::printf("load dataset: %.2f s, %zu failed operations\n\n", secondsSince(loadStart), failures);
+    std::printf("%-44s %10s %15s\n", "scenario", "ops", "time");
+
+    const size_t half  = dataset.players.size() / 2;
+    const auto&  nodes = dataset.nodes;
+    bool         sink  = false; // 防止编译器优化掉检查结果
+
+    // 1. 前一半玩家的首次检查：快照未缓存
+    auto start = Clock::now();
+    for (size_t i = 0; i < half; ++i) sink ^= manager.hasPermission(dataset.players[i], nodes[i % nodes.size()]);
+    report("hasPermission cold (snapshot miss)", half, secondsSince(start));
+
+    // 2. 同一批玩家检查从未检查过的节点：快照命中，决策未命中
+    constexpr size_t EVAL_ROUNDS = 4;
+    start                        = Clock::now();
+    for (size_t round = 1; round <= EVAL_ROUNDS; ++round) {
+        for (size_t i = 0; i < half; ++i) {
+            sink ^= manager.hasPermission(dataset.players[i], nodes[(i + round * 7) % nodes.size()]);
+        }
+    }
+    report("hasPermission eval (decision miss)", half * EVAL_ROUNDS, secondsSince(start));
+
+    // 3. 随机重复上面检查过的组合：决策命中
+    constexpr size_t HIT_OPS = 1000000;
+    std::mt19937_64  rng(7);
+    start = Clock::now();
+    for (size_t op = 0; op < HIT_OPS && half > 0; ++op) {
+        size_t i     = rng() % half;
+        size_t round = rng() % (EVAL_ROUNDS + 1);
+        sink ^= manager.hasPermission(dataset.players[i], nodes[(i + round * 7) % nodes.size()]);
+    }
+    report("hasPermission hit", half > 0 ? HIT_OPS : 0, secondsSince(start));
+
+    std::vector<PermissionId> ids;
+    for (const auto& node : nodes) ids.push_back(manager.resolvePermission(node));
+    // 每个玩家第一次按ID检查时计算全部位，与之后的命中分开计时
+    start = Clock::now();
+    for (size_t i = 0; i < half; ++i) sink ^= manager.hasPermission(dataset.players[i], ids[i % ids.size()]);
+    report("hasPermission(PermissionId) first (bits)", half, secondsSince(start));
+    start = Clock::now();
+    for (size_t op = 0; op < HIT_OPS && half > 0; ++op) {
+        sink ^= manager.hasPermission(dataset.players[rng() % half], ids[rng() % ids.size()]);
+    }
+    report("hasPermission(PermissionId) hit", half > 0 ? HIT_OPS : 0, secondsSince(start));
+
+    // 4. 后一半玩家尚未缓存，getAllPermissionsForPlayer 需要完整构建快照
+    size_t rules = 0;
+    start        = Clock::now();
+    for (size_t i = half; i < dataset.players.size(); ++i) {
+        rules += manager.getAllPermissionsForPlayer(dataset.players[i]).size();
+    }
+    report("getAllPermissionsForPlayer rebuild", dataset.players.size() - half, secondsSince(start));
+    start = Clock::now();
+    for (size_t i = half; i < dataset.players.size(); ++i) {
+        rules += manager.getAllPermissionsForPlayer(dataset.players[i]).size();
+    }
+    report("getAllPermissionsForPlayer cached", dataset.players.size() - half, secondsSince(start));
+
+    // 5. 前 1000 个玩家上线后，反复查询拥有各节点的在线玩家；两种方式的结果数应一致
+    const size_t             online = std::min<size_t>(dataset.players.size(), 1000);
+    std::vector<std::string> onlinePlayers(dataset.players.begin(), dataset.players.begin() + online);
+    for (const auto& uuid : onlinePlayers) manager.pinPlayer(uuid);
+    constexpr size_t QUERY_OPS = 2000;
+    long long        mismatch  = 0;
+    start                      = Clock::now();
+    for (size_t op = 0; op < QUERY_OPS; ++op) {
+        mismatch += manager.filterPlayersWithPermission(onlinePlayers, nodes[op % nodes.size()]).size();
+    }
+    report("filterPlayersWithPermission (online)", QUERY_OPS, secondsSince(start));
+    start = Clock::now();
+    for (size_t op = 0; op < QUERY_OPS; ++op) {
+        mismatch -= manager.getOnlinePlayersWithPermission(nodes[op % nodes.size()]).size();
+    }
+    report("getOnlinePlayersWithPermission", QUERY_OPS, secondsSince(start));
+    if (mismatch != 0) std::fprintf(stderr, "在线玩家反向查询与逐个过滤的结果不一致\n");
+
+    // 6. GROUP_MODIFIED 扇出
+    benchGroupModifiedFanOut(*db, dataset);
+
+    // 7. 记录最近上线的玩家后重新 init，测量带玩家预热的启动
+    const size_t recent = std::min<size_t>(dataset.players.size(), 1000);
+    for (size_t i = 0; i < recent; ++i) manager.pinPlayer(dataset.players[i]);
+    manager.shutdown(); // 等待 I/O 线程写完上线时间
+    options.enableWarmup        = true;
+    options.warmupRecentPlayers = recent;
+    start                       = Clock::now();
+    bool warmed                 = manager.init(db.get(), options);
+    report("init with warmup (groups + recent players)", warmed ? 1 : 0, secondsSince(start));
+
+    // 8. 导出与导入
+    bool transferred = benchTransfer(*db);
+
+    std::printf("\nmetrics:\n");
+    for (const auto& line : manager.getStatsSummary()) std::printf("    %s\n", line.c_str());
+    manager.shutdown();
+
+    std::printf("\n(checksum %d, %zu rules)\n", sink ? 1 : 0, rules);
+    return failures == 0 && mismatch == 0 && warmed && transferred ? 0 : 1;
+}
+
+} // namespace BA::bench
@@ -0,0 +1,396 @@
+// ba-replay：把 PermissionManager::startCallRecording（/ba record start）录制的调用重新驱动到一个新的 PermissionManager 上，
+// 在 SQLite 上测量吞吐、各类调用的尾延迟与缓存命中率，用于部署前验证参数调优与后端修改。
+// 用法:
+//   ba-replay <录制文件> [--speed N] [--threads N] [--data 导出文件] [--db SQLite文件]
+//             [--shards N] [--decision-cache N] [--cache-mb N] [--refresh-ahead] [--write-behind]
+//   --speed    按录制时间间隔的 N 倍速回放，0 表示不等待、尽可能快（默认 1）
+//   --threads  回放线程数（默认 4）。同一玩家（或同一组、节点）的调用总是由同一个线程按录制顺序执行，
+//              不同线程之间只按时间戳对齐，加速或不限速时可能交错
+//   --data     回放前导入 /ba export 导出的 NDJSON，使组与规则与录制开始时一致
+//   --db       使用 SQLite 文件而不是内存数据库（回放中的修改会写入该文件，请使用副本）
+//   其余选项对应 PermissionOptions 中的同名参数
+
+#include "db/DatabaseFactory.h"
+#include "permission/CallRecorder.h"
+#include "permission/Metrics.h"
+#include "permission/PermissionManager.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <latch>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+using namespace BA;
+using namespace BA::permission;
+using namespace BA::permission::internal;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct ReplayOptions {
+    std::string       logPath;
+    std::string       dataPath;
+    std::string       dbPath;
+    double            speed   = 1;
+    unsigned          threads = 4;
+    PermissionOptions manager;
+};
+
+void printUsage() {
+    std::printf(
+        "ba-replay <recording> [--speed N] [--threads N] [--data export.ndjson] [--db file.db]\n"
+        "          [--shards N] [--decision-cache N] [--cache-mb N] [--refresh-ahead] [--write-behind]\n"
+    );
+}
+
+bool parseArgs(int argc, char** argv, ReplayOptions& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg   = argv[i];
+        auto        value = [&]() -> const char* { return i + 1 < argc ? argv[++i] : nullptr; };
+        if (arg == "--refresh-ahead") {
+            options.manager.refreshAhead = true;
+        } else if (arg == "--write-behind") {
+            options.manager.writeBehind = true;
+        } else if (arg.rfind("--", 0) == 0) {
+            const char* text = value();
+            if (!text) return false;
+            if (arg == "--speed") options.speed = std::strtod(text, nullptr);
+            else if (arg == "--threads") options.threads = std::max(1u, static_cast<unsigned>(std::strtoul(text, nullptr, 10)));
+            else if (arg == "--data") options.dataPath = text;
+            else if (arg == "--db") options.dbPath = text;
+            else if (arg == "--shards") options.manager.cacheShardCount = std::strtoul(text, nullptr, 10);
+            else if (arg == "--decision-cache") options.manager.decisionCacheMaxEntriesPerPlayer = std::strtoul(text, nullptr, 10);
+            else if (arg == "--cache-mb") options.manager.playerCacheMaxBytes = std::strtoull(text, nullptr, 10) * 1024 * 1024;
+            else return false;
+        } else if (options.logPath.empty()) {
+            options.logPath = arg;
+        } else {
+            return false;
+        }
+    }
+    return !options.logPath.empty() && options.speed >= 0;
+}
+
+enum Category { CHECK, QUERY, MUTATION, CATEGORY_COUNT };
+const char* const CATEGORY_NAMES[] = {"check", "query", "mutation"};
+
+Category categoryOf(RecordedOp op) {
+    if (isRecordedMutation(op)) return MUTATION;
+    if (op <= RecordedOp::HAS_PERMISSIONS) return CHECK;
+    return QUERY;
+}
+
+// 回放时的缓存计数，开始与结束时各取一次求差
+struct CacheCounters {
+    uint64_t decisionHits, decisionMisses, snapshotHits, snapshotMisses, groupHits, groupMisses;
+
+    static CacheCounters capture() {
+        auto& metrics = Metrics::getInstance();
+        return {
+            metrics.decisionHits.value(),
+            metrics.decisionMisses.value(),
+            metrics.permissionSnapshotHits.value(),
+            metrics.permissionSnapshotMisses.value(),
+            metrics.groupSnapshotHits.value(),
+            metrics.groupSnapshotMisses.value()
+        };
+    }
+};
+
+void printHitRate(const char* name, uint64_t hits, uint64_t misses) {
+    uint64_t total = hits + misses;
+    std::printf(
+        "    %-28s %6.2f%%  (%llu / %llu)\n",
+        name,
+        total > 0 ? 100.0 * static_cast<double>(hits) / static_cast<double>(total) : 0.0,
+        static_cast<unsigned long long>(hits),
+        static_cast<unsigned long long>(total)
+    );
+}
+
+std::string formatNs(uint64_t ns) {
+    char buffer[32];
+    if (ns >= 1000000) std::snprintf(buffer, sizeof(buffer), "%.1f ms", static_cast<double>(ns) / 1e6);
+    else if (ns >= 1000) std::snprintf(buffer, sizeof(buffer), "%.1f us", static_cast<double>(ns) / 1e3);
+    else std::snprintf(buffer, sizeof(buffer), "%llu ns", static_cast<unsigned long long>(ns));
+    return buffer;
+}
+
+class Replayer {
+public:
+    Replayer(PermissionManager& manager, const RecordedLog& log, unsigned threads)
+    : m_manager(manager),
+      m_log(log),
+      m_threads(threads),
+      m_latency{LatencyHistogram(threads), LatencyHistogram(threads), LatencyHistogram(threads)},
+      m_lag(threads) {
+        // 按第一个参数分配线程，同一玩家的调用保持录制顺序
+        m_assigned.resize(threads);
+        std::hash<std::string> hash;
+        for (size_t i = 0; i < log.calls.size(); ++i) {
+            const auto& call   = log.calls[i];
+            size_t      thread = call.args.empty() ? 0 : hash(log.strings[call.args[0]]) % threads;
+            m_assigned[thread].push_back(i);
+            if (call.op == RecordedOp::HAS_PERMISSION_ID && call.args.size() >= 2 && !m_ids.contains(call.args[1])) {
+                m_ids.emplace(call.args[1], manager.resolvePermission(log.strings[call.args[1]]));
+            }
+        }
+    }
+
+    // 回放全部调用，返回墙钟时间（秒）
+    double run(double speed) {
+        std::latch               ready(m_threads + 1);
+        Clock::time_point        start;
+        std::vector<std::thread> workers;
+        for (unsigned t = 0; t < m_threads; ++t) {
+            workers.emplace_back([this, t, speed, &ready, &start] {
+                ready.arrive_and_wait();
+                replayThread(m_assigned[t], start, speed);
+            });
+        }
+        start = Clock::now() + std::chrono::milliseconds(10); // 所有线程就绪后同时开始
+        ready.arrive_and_wait();
+        for (auto& worker : workers) worker.join();
+        return std::chrono::duration<double>(Clock::now() - start).count();
+    }
+
+    const LatencyHistogram& latency(Category category) const { return m_latency[category]; }
+    const LatencyHistogram& lag() const { return m_lag; }
+    uint64_t                count(Category category) const { return m_counts[category].value(); }
+    uint64_t                checksCompared() const { return m_compared.value(); }
+    uint64_t                mismatches() const { return m_mismatches.value(); }
+
+private:
+    void replayThread(const std::vector<size_t>& calls, Clock::time_point start, double speed) {
+        std::this_thread::sleep_until(start);
+        std::vector<std::string> nodes;
+        for (size_t index : calls) {
+            const auto& call = m_log.calls[index];
+            if (speed > 0) {
+                auto target = start
+                            + std::chrono::duration_cast<Clock::duration>(
+                                  std::chrono::duration<double, std::micro>(static_cast<double>(call.offsetMicros) / speed)
+                            );
+                auto now = Clock::now();
+                if (now < target) {
+                    std::this_thread::sleep_until(target);
+                } else {
+                    m_lag.record(now - target); // 落后于录制节奏的时间，持续增长说明跟不上
+                }
+            }
+            if (call.op == RecordedOp::HAS_PERMISSIONS) {
+                nodes.clear();
+                for (size_t i = 1; i < call.args.size(); ++i) nodes.push_back(m_log.strings[call.args[i]]);
+            }
+            auto category = categoryOf(call.op);
+            auto begin    = Clock::now();
+            execute(call, nodes);
+            m_latency[category].record(Clock::now() - begin);
+            m_counts[category].add();
+        }
+    }
+
+    void execute(const RecordedCall& call, const std::vector<std::string>& nodes) {
+        static const std::string empty;
+        auto arg = [&](size_t i) -> const std::string& { return i < call.args.size() ? m_log.strings[call.args[i]] : empty; };
+        auto compare = [&](bool result) {
+            m_compared.add();
+            if (result != (call.value != 0)) m_mismatches.add();
+        };
+        switch (call.op) {
+        case RecordedOp::HAS_PERMISSION:
+            compare(m_manager.hasPermission(arg(0), arg(1)));
+            break;
+        case RecordedOp::HAS_PERMISSION_ID:
+            if (call.args.size() >= 2) compare(m_manager.hasPermission(arg(0), m_ids.at(call.args[1])));
+            break;
+        case RecordedOp::HAS_PERMISSIONS:
+            m_manager.hasPermissions(arg(0), nodes);
+            break;
+        case RecordedOp::ONLINE_PLAYERS_WITH_PERMISSION:
+            m_manager.getOnlinePlayersWithPermission(arg(0));
+            break;
+        case RecordedOp::GET_ALL_PERMISSIONS:
+            m_manager.getAllPermissionsForPlayer(arg(0));
+            break;
+        case RecordedOp::GET_PLAYER_GROUPS:
+            m_manager.getPlayerGroups(arg(0));
+            break;
+        case RecordedOp::GET_PLAYERS_IN_GROUP:
+            m_manager.getPlayersInGroup(arg(0));
+            break;
+        case RecordedOp::ADD_PLAYER_TO_GROUP:
+            m_manager.addPlayerToGroup(arg(0), arg(1), call.value);
+            break;
+        case RecordedOp::REMOVE_PLAYER_FROM_GROUP:
+            m_manager.removePlayerFromGroup(arg(0), arg(1));
+            break;
+        case RecordedOp::ADD_PERMISSION_TO_GROUP:
+            m_manager.addPermissionToGroup(arg(0), arg(1));
+            break;
+        case RecordedOp::REMOVE_PERMISSION_FROM_GROUP:
+            m_manager.removePermissionFromGroup(arg(0), arg(1));
+            break;
+        case RecordedOp::ADD_GROUP_INHERITANCE:
+            m_manager.addGroupInheritance(arg(0), arg(1));
+            break;
+        case RecordedOp::REMOVE_GROUP_INHERITANCE:
+            m_manager.removeGroupInheritance(arg(0), arg(1));
+            break;
+        case RecordedOp::SET_GROUP_PRIORITY:
+            m_manager.setGroupPriority(arg(0), static_cast<int>(call.value));
+            break;
+        case RecordedOp::CREATE_GROUP:
+            m_manager.createGroup(arg(0));
+            break;
+        case RecordedOp::DELETE_GROUP:
+            m_manager.deleteGroup(arg(0));
+            break;
+        case RecordedOp::PLAYER_ONLINE:
+            if (call.value != 0) m_manager.prefetchPlayer(arg(0));
+            else m_manager.pinPlayer(arg(0));
+            break;
+        case RecordedOp::PLAYER_OFFLINE:
+            m_manager.unpinPlayer(arg(0));
+            break;
+        default:
+            break;
+        }
+    }
+
+    PermissionManager&                                  m_manager;
+    const RecordedLog&                                  m_log;
+    unsigned                                            m_threads;
+    std::vector<std::vector<size_t>>                    m_assigned; // 每个线程回放的调用下标
+    std::unordered_map<uint32_t, PermissionId>          m_ids;      // HAS_PERMISSION_ID 的节点在本进程中的ID
+    LatencyHistogram                                    m_latency[CATEGORY_COUNT];
+    LatencyHistogram                                    m_lag;
+    Counter                                             m_counts[CATEGORY_COUNT];
+    Counter                                             m_compared;
+    Counter                                             m_mismatches;
+};
+
+} // namespace
+
+int main(int argc, char** argv) {
+    ReplayOptions options;
+    if (!parseArgs(argc, argv, options)) {
+        printUsage();
+        return 1;
+    }
+
+    std::string error;
+    auto        log = CallRecorder::read(options.logPath, error);
+    if (!log) {
+        std::fprintf(stderr, "无法读取录制文件 %s: %s\n", options.logPath.c_str(), error.c_str());
+        return 1;
+    }
+    uint64_t span = log->calls.empty() ? 0 : log->calls.back().offsetMicros;
+    std::printf(
+        "recording: %zu calls over %.1f s, %zu distinct strings, sample rate %.4g%s\n",
+        log->calls.size(),
+        static_cast<double>(span) / 1e6,
+        log->strings.size(),
+        log->sampleRate,
+        log->truncated ? " (truncated tail ignored)" : ""
+    );
+
+    std::unique_ptr<db::IDatabase> db;
+    if (options.dbPath.empty()) {
+        db::SQLiteOptions sqliteOptions;
+        sqliteOptions.journalMode = "memory"; // 内存数据库不支持 WAL
+        db                        = db::DatabaseFactory::createPooledSQLite(":memory:", 0, sqliteOptions);
+    } else {
+        db = db::DatabaseFactory::createPooledSQLite(options.dbPath, 2);
+    }
+    auto& manager = PermissionManager::getInstance();
+    if (!db || !manager.init(db.get(), options.manager)) {
+        std::fprintf(stderr, "PermissionManager 初始化失败\n");
+        return 1;
+    }
+    if (!options.dataPath.empty()) {
+        std::ifstream file(options.dataPath, std::ios::binary);
+        auto          stats = manager.importData([&file](char* buffer, size_t size) -> size_t {
+            file.read(buffer, static_cast<std::streamsize>(size));
+            return static_cast<size_t>(file.gcount());
+        });
+        if (!file.eof() || !stats.success) {
+            std::fprintf(stderr, "导入 %s 失败: %s\n", options.dataPath.c_str(), stats.error.c_str());
+            manager.shutdown();
+            return 1;
+        }
+        std::printf(
+            "imported: %zu permissions, %zu groups, %zu rules, %zu memberships\n",
+            stats.permissions,
+            stats.groups,
+            stats.rules,
+            stats.memberships
+        );
+    }
+
+    Replayer replayer(manager, *log, options.threads);
+    auto     before  = CacheCounters::capture();
+    double   seconds = replayer.run(options.speed);
+    manager.flush(); // 写回队列中剩余的修改计入回放
+    auto after = CacheCounters::capture();
+
+    char speed[32] = "unthrottled";
+    if (options.speed > 0) std::snprintf(speed, sizeof(speed), "%gx", options.speed);
+    std::printf(
+        "\nreplayed %zu calls in %.2f s (speed %s, %u threads): %.0f calls/s\n\n",
+        log->calls.size(),
+        seconds,
+        speed,
+        options.threads,
+        seconds > 0 ? static_cast<double>(log->calls.size()) / seconds : 0.0
+    );
+    std::printf("%-10s %10s %10s %10s %10s %10s %10s\n", "category", "calls", "mean", "p50", "p99", "p99.9", "max");
+    for (int category = 0; category < CATEGORY_COUNT; ++category) {
+        auto snapshot = replayer.latency(static_cast<Category>(category)).snapshot();
+        std::printf(
+            "%-10s %10llu %10s %10s %10s %10s %10s\n",
+            CATEGORY_NAMES[category],
+            static_cast<unsigned long long>(snapshot.count),
+            formatNs(static_cast<uint64_t>(snapshot.meanNs())).c_str(),
+            formatNs(snapshot.percentileNs(0.5)).c_str(),
+            formatNs(snapshot.percentileNs(0.99)).c_str(),
+            formatNs(snapshot.percentileNs(0.999)).c_str(),
+            formatNs(snapshot.percentileNs(1.0)).c_str()
+        );
+    }
+    if (options.speed > 0) {
+        auto lag = replayer.lag().snapshot();
+        std::printf(
+            "\nbehind schedule: %llu calls, p99 %s, max %s\n",
+            static_cast<unsigned long long>(lag.count),
+            formatNs(lag.percentileNs(0.99)).c_str(),
+            formatNs(lag.percentileNs(1.0)).c_str()
+        );
+    }
+
+    std::printf("\ncache hit rates during replay:\n");
+    printHitRate("decision cache", after.decisionHits - before.decisionHits, after.decisionMisses - before.decisionMisses);
+    printHitRate("permission snapshots", after.snapshotHits - before.snapshotHits, after.snapshotMisses - before.snapshotMisses);
+    printHitRate("group snapshots", after.groupHits - before.groupHits, after.groupMisses - before.groupMisses);
+    if (replayer.checksCompared() > 0) {
+        // 回放前的数据与录制开始时不同（例如未指定 --data）时，检查结果自然会不同
+        std::printf(
+            "\ncheck results differing from the recording: %llu of %llu\n",
+            static_cast<unsigned long long>(replayer.mismatches()),
+            static_cast<unsigned long long>(replayer.checksCompared())
+        );
+    }
+
+    std::printf("\nmetrics:\n");
+    for (const auto& line : manager.getStatsSummary()) std::printf("    %s\n", line.c_str());
+    manager.shutdown();
+    return 0;
+}
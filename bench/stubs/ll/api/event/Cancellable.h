@@ -0,0 +1,16 @@
+#pragma once
+
+namespace ll::event {
+
+template <class T>
+class Cancellable : public T {
+public:
+    bool isCancelled() const { return m_cancelled; }
+    void setCancelled(bool cancelled = true) { m_cancelled = cancelled; }
+    void cancel() { setCancelled(true); }
+
+private:
+    bool m_cancelled = false;
+};
+
+} // namespace ll::event
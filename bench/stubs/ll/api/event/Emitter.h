@@ -0,0 +1,8 @@
+#pragma once
+
+namespace ll::event {
+
+template <auto EmitterFactory, class EventType>
+class Emitter {};
+
+} // namespace ll::event
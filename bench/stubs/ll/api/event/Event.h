@@ -0,0 +1,11 @@
+#pragma once
+// 基准程序使用的事件替身：事件照常构造和发布，但没有监听器。
+
+namespace ll::event {
+
+class Event {
+public:
+    virtual ~Event() = default;
+};
+
+} // namespace ll::event
@@ -0,0 +1,23 @@
+#pragma once
+
+#include "ll/api/event/Event.h"
+#include <cstddef>
+
+namespace ll::event {
+
+class EventBus {
+public:
+    static EventBus& getInstance() {
+        static EventBus bus;
+        return bus;
+    }
+    void publish(Event&) {}
+    void publish(Event&&) {}
+    // 基准中没有监听器，修改接口不会构造事件
+    template <typename T>
+    size_t getListenerCount() {
+        return 0;
+    }
+};
+
+} // namespace ll::event
@@ -0,0 +1,28 @@
+#pragma once
+// 基准程序使用的 LeviLamina 日志替身：debug/info 直接丢弃，warn/error 只输出格式串到 stderr，
+// 不做格式化，避免日志开销混入测量结果。
+
+#include <cstdio>
+#include <string_view>
+
+namespace ll::io {
+
+class Logger {
+public:
+    template <class... Args>
+    void trace(std::string_view, Args&&...) {}
+    template <class... Args>
+    void debug(std::string_view, Args&&...) {}
+    template <class... Args>
+    void info(std::string_view, Args&&...) {}
+    template <class... Args>
+    void warn(std::string_view fmt, Args&&...) {
+        std::fprintf(stderr, "[warn] %.*s\n", static_cast<int>(fmt.size()), fmt.data());
+    }
+    template <class... Args>
+    void error(std::string_view fmt, Args&&...) {
+        std::fprintf(stderr, "[error] %.*s\n", static_cast<int>(fmt.size()), fmt.data());
+    }
+};
+
+} // namespace ll::io
@@ -0,0 +1,20 @@
+#pragma once
+// 基准程序使用的 NativeMod 替身，只提供 current()->getLogger()。
+
+#include "ll/api/io/Logger.h"
+
+namespace ll::mod {
+
+class NativeMod {
+public:
+    static NativeMod* current() {
+        static NativeMod mod;
+        return &mod;
+    }
+    io::Logger& getLogger() { return m_logger; }
+
+private:
+    io::Logger m_logger;
+};
+
+} // namespace ll::mod
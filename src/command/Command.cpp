@@ -10,13 +10,103 @@
 #include "mc/world/actor/player/Player.h"
 #include "mc/platform/UUID.h"
 #include "mc/server/commands/CommandFlag.h"
+#include "ll/api/service/Bedrock.h"
 #include "ll/api/service/PlayerInfo.h"
+#include "ll/api/thread/ServerThreadExecutor.h"
+#include "mc/world/level/Level.h"
 #include "permission/PermissionManager.h"
 #include "command/Command.h"
+#include "mod/MyMod.h"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <optional>
 #include <string>
 #include <vector> 
 namespace BA::Command {
     using ll::service::PlayerInfo;
+
+    namespace {
+        // 导入导出的文件路径：相对路径落在插件数据目录下
+        std::filesystem::path resolveDataFile(const std::string& file) {
+            std::filesystem::path path = std::filesystem::u8path(file);
+            if (path.is_relative()) path = BA::MyMod::getInstance().getSelf().getDataDir() / path;
+            return path;
+        }
+
+        std::string describeTransfer(const BA::permission::TransferStats& stats) {
+            return std::to_string(stats.permissions) + " 个权限, " + std::to_string(stats.groups) + " 个组, "
+                 + std::to_string(stats.inheritance) + " 条继承, " + std::to_string(stats.rules) + " 条规则, "
+                 + std::to_string(stats.memberships) + " 条玩家组关系";
+        }
+
+        constexpr size_t LIST_PAGE_SIZE = 50; // 列表命令每页显示的条目数
+
+        // 把非空列表的第 page 页（从 1 开始）格式化为一行，页码超出范围时显示最后一页
+        std::string formatPage(const std::string& title, const std::vector<std::string>& items, int page) {
+            size_t pages = (items.size() + LIST_PAGE_SIZE - 1) / LIST_PAGE_SIZE;
+            size_t index = std::clamp<size_t>(page < 1 ? 1 : static_cast<size_t>(page), 1, pages);
+            size_t begin = (index - 1) * LIST_PAGE_SIZE;
+            size_t end   = std::min(begin + LIST_PAGE_SIZE, items.size());
+
+            std::string line = title;
+            if (pages > 1) line += fmt::format("（第 {}/{} 页，共 {} 个）", index, pages, items.size());
+            line += ": ";
+            for (size_t i = begin; i < end; ++i) {
+                line += items[i];
+                if (i + 1 < end) line += ", ";
+            }
+            if (index < pages) line += fmt::format("。在命令末尾加上页码 {} 查看下一页", index + 1);
+            return line;
+        }
+
+        // 在后台执行的命令的结果
+        struct CommandReply {
+            bool                     success = true;
+            std::vector<std::string> messages;
+        };
+
+        /**
+         * @brief 在 I/O 线程中执行 task，完成后回到游戏线程把结果发给执行命令的玩家；
+         *        控制台等其他来源的结果写入日志。离线玩家的数据不在缓存中，查询与修改都要访问数据库，
+         *        放在命令回调中执行会在数据库繁忙时卡住游戏线程。
+         * @param origin 命令来源，只在调用时读取。
+         * @param output 命令输出，立即写入一条“正在处理”的提示。
+         * @param task 在 I/O 线程中执行，只能捕获值，不能引用命令参数。
+         */
+        void replyAsync(CommandOrigin const& origin, CommandOutput& output, std::function<CommandReply()> task) {
+            std::optional<mce::UUID> playerUuid;
+            if (auto* entity = origin.getEntity(); entity && entity->isPlayer()) {
+                playerUuid = static_cast<Player*>(entity)->getUuid();
+            }
+            output.success("正在后台处理，完成后发送结果。");
+            BA::permission::PermissionManager::getInstance().runAsync([playerUuid, task = std::move(task)]() {
+                auto reply = std::make_shared<CommandReply>(task());
+                ll::thread::ServerThreadExecutor::getDefault().execute([playerUuid, reply]() {
+                    if (playerUuid) {
+                        auto    level  = ll::service::getLevel();
+                        Player* player = level ? level->getPlayer(*playerUuid) : nullptr;
+                        if (!player) return; // 执行命令的玩家已下线
+                        for (const auto& message : reply->messages) {
+                            player->sendMessage(reply->success ? message : "§c" + message);
+                        }
+                        return;
+                    }
+                    auto& logger = BA::MyMod::getInstance().getSelf().getLogger();
+                    for (const auto& message : reply->messages) {
+                        if (reply->success) {
+                            logger.info("{}", message);
+                        } else {
+                            logger.error("{}", message);
+                        }
+                    }
+                });
+            });
+        }
+    }
+
     void RegisterCommands() {
         using namespace ll::command;
         auto& Registrar = CommandRegistrar::getInstance(false);
@@ -66,6 +156,7 @@ namespace BA::Command {
         cmd.overload<列出权限组节点>()
         .text("列出权限组节点")
         .required("权限组id")
+        .optional("页码")
         .execute([&](CommandOrigin const& origin, CommandOutput& output, 列出权限组节点 const& param, ::Command const&) {
             if (!pm.groupExists(param.权限组id)) { 
                 output.error("权限组 '" + param.权限组id + "' 不存在。");
@@ -79,14 +170,7 @@ namespace BA::Command {
             if (permissions.empty()) {
                 output.success("权限组 '" + param.权限组id + "' 没有直接或间接的权限节点。");
             } else {
-                std::string permStr = "权限组 '" + param.权限组id + "' 的权限节点: ";
-                for (size_t i = 0; i < permissions.size(); ++i) {
-                    permStr += permissions[i];
-                    if (i < permissions.size() - 1) {
-                        permStr += ", ";
-                    }
-                }
-                output.success(permStr);
+                output.success(formatPage("权限组 '" + param.权限组id + "' 的权限节点", permissions, param.页码));
             }
         });
 
@@ -144,7 +228,7 @@ namespace BA::Command {
         .required("权限组id")
         .optional("可选过期时间") // 新增可选参数
         .execute([&](CommandOrigin const& origin, CommandOutput& output, 离线添加玩家权限组 const& param, ::Command const&) {
-                // 使用 PlayerInfo 获取玩家信息
+                // 使用 PlayerInfo 获取玩家信息（内存中的名称表，不访问数据库）
                 auto offlinePlayerInfoOpt = PlayerInfo::getInstance().fromName(param.playerName);
                 if (!offlinePlayerInfoOpt.has_value()) {
                     output.error(fmt::format("Player '{}' not found.", param.playerName));
@@ -153,34 +237,26 @@ namespace BA::Command {
                 const auto& offlinePlayerInfo = offlinePlayerInfoOpt.value();
                 std::string offlineUuidStr = offlinePlayerInfo.uuid.asString(); // 获取 UUID
 
-                bool offlineOk;
-                std::string offlineMessage;
-                long long offlineDurationSeconds = 0;
-                bool offlineHasDuration = false;
-
-                if (param.可选过期时间 > 0.0f) { // 检查 float 值是否大于 0
-                    float hours = param.可选过期时间; // 直接使用 float 类型的值
-                    if (hours < 0) { // 再次检查，虽然理论上不会发生
-                        output.error("过期时间不能为负数。");
-                        return;
-                    }
-                    offlineDurationSeconds = static_cast<long long>(hours * 3600); // 小时转秒
-                    offlineHasDuration = true;
-                }
-
-                if (offlineHasDuration) {
-                    offlineOk = pm.addPlayerToGroup(offlineUuidStr, param.权限组id, offlineDurationSeconds);
-                    offlineMessage = fmt::format("已将离线玩家 {} 加入权限组 {}，过期时间为 {} 小时。", offlinePlayerInfo.name, param.权限组id, param.可选过期时间);
-                } else {
-                    offlineOk = pm.addPlayerToGroup(offlineUuidStr, param.权限组id);
-                    offlineMessage = fmt::format("已将离线玩家 {} 加入权限组 {}。", offlinePlayerInfo.name, param.权限组id);
-                }
-
-                if (offlineOk) {
-                    output.success(offlineMessage);
-                } else {
-                    output.error("添加失败，权限组可能不存在或玩家已在组内");
+                if (param.可选过期时间 < 0.0f) {
+                    output.error("过期时间不能为负数。");
+                    return;
                 }
+                float     hours           = param.可选过期时间;
+                long long durationSeconds = static_cast<long long>(hours * 3600); // 小时转秒
+
+                replyAsync(
+                    origin,
+                    output,
+                    [&pm, uuid = offlineUuidStr, name = offlinePlayerInfo.name, group = std::string(param.权限组id), hours, durationSeconds]() -> CommandReply {
+                        bool ok = durationSeconds > 0 ? pm.addPlayerToGroup(uuid, group, durationSeconds)
+                                                      : pm.addPlayerToGroup(uuid, group);
+                        if (!ok) return {false, {"添加失败，权限组可能不存在或玩家已在组内"}};
+                        if (durationSeconds > 0) {
+                            return {true, {fmt::format("已将离线玩家 {} 加入权限组 {}，过期时间为 {} 小时。", name, group, hours)}};
+                        }
+                        return {true, {fmt::format("已将离线玩家 {} 加入权限组 {}。", name, group)}};
+                    }
+                );
             }
         );
 
@@ -226,20 +302,18 @@ namespace BA::Command {
                 }
                 const auto& playerInfo = playerInfoOpt.value();
                 std::string uuidStr = playerInfo.uuid.asString(); // 获取 UUID
-                std::vector<std::string> groups = pm.getPlayerGroups(uuidStr);
-                if (groups.empty()) {
-                    output.success(playerInfo.name + " 不属于任何权限组。");
-                } else {
-                    std::string groupsStr = "玩家 " + playerInfo.name + " 所属权限组: ";
+                replyAsync(origin, output, [&pm, uuid = uuidStr, name = playerInfo.name]() -> CommandReply {
+                    std::vector<std::string> groups = pm.getPlayerGroups(uuid);
+                    if (groups.empty()) return {true, {name + " 不属于任何权限组。"}};
+                    std::string groupsStr = "玩家 " + name + " 所属权限组: ";
                     for (size_t i = 0; i < groups.size(); ++i) {
                         groupsStr += groups[i];
                         if (i < groups.size() - 1) {
                             groupsStr += ", ";
-                        
+                        }
                     }
-                    output.success(groupsStr);
-                }
-            }
+                    return {true, {groupsStr}};
+                });
         });
 
         // 添加权限组节点命令
@@ -285,6 +359,7 @@ namespace BA::Command {
         cmd.overload<列出玩家权限节点>()
         .text("列出玩家权限节点")
         .required("playerName")
+        .optional("页码")
         .execute([&](CommandOrigin const& origin, CommandOutput& output, 列出玩家权限节点 const& param, ::Command const&) {
             auto results = param.playerName.results(origin); // 解析目标选择器
 
@@ -306,20 +381,14 @@ namespace BA::Command {
                 if (permissions.empty()) {
                     output.success("玩家 " + player->getRealName() + " 没有生效的权限节点。");
                 } else {
-                    std::string permStr = "玩家 " + player->getRealName() + " 生效的权限节点: ";
-                    for (size_t i = 0; i < permissions.size(); ++i) {
-                        permStr += permissions[i];
-                        if (i < permissions.size() - 1) {
-                            permStr += ", ";
-                        }
-                    }
-                    output.success(permStr);
+                    output.success(formatPage("玩家 " + player->getRealName() + " 生效的权限节点", permissions, param.页码));
                 }
             }
         });
         cmd.overload<离线列出玩家权限组节点>()
         .text("列出玩家权限节点")
         .required("playerName")
+        .optional("页码")
         .execute(
             [](CommandOrigin const& origin, CommandOutput& output, 离线列出玩家权限组节点 const& args, ::Command const&) {
 
@@ -332,25 +401,18 @@ namespace BA::Command {
                 const auto& playerInfo = playerInfoOpt.value();
                 std::string uuidStr = playerInfo.uuid.asString(); // 获取 UUID
 
-                std::vector<BA::permission::CompiledPermissionRule> playerCompiledPermissions = BA::permission::PermissionManager::getInstance().getAllPermissionsForPlayer(uuidStr);
-                std::vector<std::string> permissions;
-                for (const auto& rule : playerCompiledPermissions) {
-                    if (rule.state) { // 只添加值为 true 的权限
-                        permissions.push_back(rule.pattern);
-                    }
-                }
-                if (permissions.empty()) {
-                    output.success("玩家 " + playerInfo.name + " 没有生效的权限节点。");
-                } else {
-                    std::string permStr = "玩家 " + playerInfo.name + " 生效的权限节点: ";
-                    for (size_t i = 0; i < permissions.size(); ++i) {
-                        permStr += permissions[i];
-                        if (i < permissions.size() - 1) {
-                            permStr += ", ";
+                // 离线玩家没有权限快照，解析需要读取数据库
+                replyAsync(origin, output, [uuid = uuidStr, name = playerInfo.name, page = args.页码]() -> CommandReply {
+                    std::vector<BA::permission::CompiledPermissionRule> playerCompiledPermissions = BA::permission::PermissionManager::getInstance().getAllPermissionsForPlayer(uuid);
+                    std::vector<std::string> permissions;
+                    for (const auto& rule : playerCompiledPermissions) {
+                        if (rule.state) { // 只添加值为 true 的权限
+                            permissions.push_back(rule.pattern);
                         }
                     }
-                    output.success(permStr);
-                }
+                    if (permissions.empty()) return {true, {"玩家 " + name + " 没有生效的权限节点。"}};
+                    return {true, {formatPage("玩家 " + name + " 生效的权限节点", permissions, page)}};
+                });
             }
         );
 
@@ -443,34 +505,22 @@ namespace BA::Command {
             const auto& playerInfo = playerInfoOpt.value();
             std::string uuidStr = playerInfo.uuid.asString(); // 获取 UUID
 
-            // 检查权限组是否存在
-            if (!pm.groupExists(param.权限组id)) {
-                 output.error("权限组 '" + param.权限组id + "' 不存在。");
-                 return;
-            }
+            replyAsync(origin, output, [&pm, uuid = uuidStr, name = playerInfo.name, group = std::string(param.权限组id)]() -> CommandReply {
+                // 检查权限组是否存在
+                if (!pm.groupExists(group)) return {false, {"权限组 '" + group + "' 不存在。"}};
 
-                bool ok = pm.removePlayerFromGroup(uuidStr, param.权限组id);
-                if (ok) {
-                    output.success("已将玩家 " + playerInfo.name + " 从权限组 '" + param.权限组id + "' 移除。");
-                } else {
-                    // 提供更详细的错误信息
-                    std::vector<std::string> groups = pm.getPlayerGroups(uuidStr);
-                    bool isInGroup = false;
-                    for(const auto& group : groups) {
-                        if (group == param.权限组id) {
-                            isInGroup = true;
-                            break;
-                        
-                    }
-                    if (!isInGroup) {
-                         // 如果玩家本来就不在组里
-                         output.error("移除失败，玩家 " + playerInfo.name + " 不在权限组 '" + param.权限组id + "' 中。");
-                    } else {
-                         // 其他未知错误
-                         output.error("从权限组移除玩家 " + playerInfo.name + " 时发生未知错误。");
-                    }
+                if (pm.removePlayerFromGroup(uuid, group)) {
+                    return {true, {"已将玩家 " + name + " 从权限组 '" + group + "' 移除。"}};
                 }
-            }
+                // 提供更详细的错误信息
+                std::vector<std::string> groups = pm.getPlayerGroups(uuid);
+                if (std::find(groups.begin(), groups.end(), group) == groups.end()) {
+                    // 如果玩家本来就不在组里
+                    return {false, {"移除失败，玩家 " + name + " 不在权限组 '" + group + "' 中。"}};
+                }
+                // 其他未知错误
+                return {false, {"从权限组移除玩家 " + name + " 时发生未知错误。"}};
+            });
         });
 
         // 设置权限组继承命令
@@ -524,6 +574,148 @@ namespace BA::Command {
                  output.error("移除继承失败。可能原因：该继承关系不存在。");
             }
         });
+
+        // 导出/导入整个数据集：只允许在控制台执行，在 I/O 线程中读写文件，结果写入日志
+        cmd.overload<导出数据>()
+        .text("export")
+        .required("文件")
+        .execute([&](CommandOrigin const& origin, CommandOutput& output, 导出数据 const& param, ::Command const&) {
+            if (origin.getOriginType() != CommandOriginType::DedicatedServer) {
+                output.error("该命令只能在控制台执行。");
+                return;
+            }
+            auto path = resolveDataFile(param.文件);
+            output.success("正在后台导出到 " + path.string() + "，完成后结果会写入日志。");
+            pm.runAsync([&pm, path]() {
+                auto&         logger = BA::MyMod::getInstance().getSelf().getLogger();
+                std::ofstream file(path, std::ios::binary | std::ios::trunc);
+                if (!file) {
+                    logger.error("无法写入导出文件 {}", path.string());
+                    return;
+                }
+                auto stats = pm.exportData([&file](std::string_view chunk) {
+                    file.write(chunk.data(), static_cast<std::streamsize>(chunk.size()));
+                    return static_cast<bool>(file);
+                });
+                file.close();
+                if (stats.success && file) {
+                    logger.info("已导出到 {}: {}", path.string(), describeTransfer(stats));
+                } else {
+                    logger.error("导出到 {} 失败: {}", path.string(), stats.error.empty() ? "写入文件失败" : stats.error);
+                }
+            });
+        });
+
+        cmd.overload<导入数据>()
+        .text("import")
+        .required("文件")
+        .execute([&](CommandOrigin const& origin, CommandOutput& output, 导入数据 const& param, ::Command const&) {
+            if (origin.getOriginType() != CommandOriginType::DedicatedServer) {
+                output.error("该命令只能在控制台执行。");
+                return;
+            }
+            auto path = resolveDataFile(param.文件);
+            if (!std::filesystem::is_regular_file(path)) {
+                output.error("文件 " + path.string() + " 不存在。");
+                return;
+            }
+            output.success("正在后台从 " + path.string() + " 导入，完成后结果会写入日志。");
+            pm.runAsync([&pm, path]() {
+                auto&         logger = BA::MyMod::getInstance().getSelf().getLogger();
+                std::ifstream file(path, std::ios::binary);
+                auto stats = pm.importData([&file](char* buffer, size_t size) {
+                    file.read(buffer, static_cast<std::streamsize>(size));
+                    return static_cast<size_t>(file.gcount());
+                });
+                if (stats.success) {
+                    logger.info(
+                        "已从 {} 导入: {}，跳过 {} 条记录",
+                        path.string(),
+                        describeTransfer(stats),
+                        stats.skipped
+                    );
+                } else {
+                    logger.error("从 {} 导入失败: {}。已提交: {}", path.string(), stats.error, describeTransfer(stats));
+                }
+            });
+        });
+
+        // 导出追踪缓冲区中最近的记录，用于排查失效任务与数据库语句的耗时
+        cmd.overload<导出追踪>()
+        .text("trace")
+        .optional("文件")
+        .execute([&](CommandOrigin const& origin, CommandOutput& output, 导出追踪 const& param, ::Command const&) {
+            // 文件路径可以是任意位置，与导入导出一样只允许控制台写入
+            if (origin.getOriginType() != CommandOriginType::DedicatedServer) {
+                output.error("该命令只能在控制台执行。");
+                return;
+            }
+            replyAsync(origin, output, [&pm, path = resolveDataFile(param.文件)]() -> CommandReply {
+                auto          lines = pm.dumpTrace();
+                std::ofstream file(path, std::ios::binary | std::ios::trunc);
+                for (const auto& line : lines) file << line << '\n';
+                file.close();
+                if (!file) return {false, {"无法写入追踪文件 " + path.string()}};
+                return {true, {fmt::format("已导出 {} 条追踪记录到 {}", lines.size(), path.string())}};
+            });
+        });
+
+        // 运行时指标摘要：缓存命中率、耗时分位数与失效队列深度
+        cmd.overload()
+        .text("stats")
+        .execute([&](CommandOrigin const& origin, CommandOutput& output) {
+            for (const auto& line : pm.getStatsSummary()) {
+                output.success(line);
+            }
+        });
+
+        // 录制 API 调用，用于在测试环境中以真实的访问模式回放（ba-replay）
+        cmd.overload<开始录制>()
+        .text("record")
+        .text("start")
+        .optional("文件")
+        .optional("采样率")
+        .execute([&](CommandOrigin const& origin, CommandOutput& output, 开始录制 const& param, ::Command const&) {
+            if (origin.getOriginType() != CommandOriginType::DedicatedServer) {
+                output.error("该命令只能在控制台执行。");
+                return;
+            }
+            if (param.采样率 <= 0.0f || param.采样率 > 1.0f) {
+                output.error("采样率必须在 (0, 1] 之间。");
+                return;
+            }
+            auto path = resolveDataFile(param.文件);
+            auto utf8 = path.u8string(); // startCallRecording 按 UTF-8 解析路径
+            if (!pm.startCallRecording(std::string(utf8.begin(), utf8.end()), param.采样率)) {
+                output.error("无法创建录制文件 " + path.string());
+                return;
+            }
+            output.success(fmt::format("开始录制 API 调用到 {}，检查与查询的采样率为 {}。", path.string(), param.采样率));
+        });
+        cmd.overload()
+        .text("record")
+        .text("stop")
+        .execute([&](CommandOrigin const&, CommandOutput& output) {
+            if (!pm.getCallRecordingStats().active) {
+                output.error("当前没有在录制。");
+                return;
+            }
+            auto stats = pm.stopCallRecording();
+            output.success(fmt::format(
+                "录制结束：{} 次调用（{} 次检查与查询未被抽中），{} 字节，已写入 {}。",
+                stats.calls,
+                stats.skipped,
+                stats.bytes,
+                stats.path
+            ));
+        });
+
+        // 热点存储语句的查询计划，用于确认它们使用覆盖索引
+        cmd.overload()
+        .text("explain")
+        .execute([&](CommandOrigin const& origin, CommandOutput& output) {
+            replyAsync(origin, output, [&pm]() -> CommandReply { return {true, pm.explainHotQueries()}; });
+        });
     }
 
 }
@@ -32,6 +32,7 @@ namespace BA::Command {
 
     struct 离线列出玩家权限组节点 {
         std::string             playerName;     // 玩家名称
+        int                     页码 = 1;       // 可选参数，列表较长时分页显示
     };
     struct 离线移除玩家权限组 {
         std::string             playerName;     // 玩家名称
@@ -41,12 +42,14 @@ namespace BA::Command {
     // 新增：列出玩家权限节点的结构体
     struct 列出玩家权限节点 {
         CommandSelector<Player> playerName;         // 目标玩家选择器
+        int 页码 = 1; // 可选参数，列表较长时分页显示
     };
     struct 创建权限组 {      // 目标玩家选择器
         std::string 权限组id;  
     };
     struct 列出权限组节点 {      // 目标玩家选择器
         ll::command::SoftEnum<PermissionGroupEnum> 权限组id;
+        int 页码 = 1; // 可选参数，列表较长时分页显示
     };
     // 新增：添加权限组节点的结构体
     struct 添加权限组节点 {
@@ -86,4 +89,21 @@ namespace BA::Command {
         ll::command::SoftEnum<PermissionGroupEnum> 子权限组id;
         ll::command::SoftEnum<PermissionGroupEnum> 父权限组id;
     };
+
+    // 导出/导入数据集，文件路径相对于插件数据目录
+    struct 导出数据 {
+        std::string 文件;
+    };
+    struct 导入数据 {
+        std::string 文件;
+    };
+    // 导出追踪缓冲区，文件路径相对于插件数据目录
+    struct 导出追踪 {
+        std::string 文件 = "trace.txt";
+    };
+    // 录制 API 调用供 ba-replay 回放，文件路径相对于插件数据目录
+    struct 开始录制 {
+        std::string 文件   = "calls.bin";
+        float       采样率 = 1.0f;
+    };
 }
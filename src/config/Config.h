@@ -9,6 +9,11 @@ struct Config {
     int version = 2;
     std::string db_type = "sqlite";       // "sqlite" or "mysql"
     std::string sqlite_path = "ba.db";
+    std::string sqlite_journal_mode = "wal"; // SQLite journal_mode，wal 模式下读写互不阻塞
+    std::string sqlite_synchronous = "normal"; // SQLite synchronous，wal 下 normal 只在检查点时同步到磁盘
+    unsigned int sqlite_mmap_size_mb = 256; // SQLite 内存映射大小（MB），0 表示不使用
+    unsigned int sqlite_cache_size_kb = 8192; // 每个 SQLite 连接的页缓存大小（KB）
+    unsigned int sqlite_busy_timeout_ms = 5000; // SQLite 遇到锁时的最长等待时间（毫秒）
     std::string mysql_host = "127.0.0.1";
     std::string mysql_user = "root";
     std::string mysql_password;
@@ -19,19 +24,42 @@ struct Config {
     std::string postgresql_password;
     std::string postgresql_db = "ba";
     unsigned int postgresql_port = 5432;
+    unsigned int db_statement_cache_size = 64; // 每个数据库连接缓存的预处理语句数量，0 表示不缓存
+    unsigned int db_pool_min_connections = 1; // MySQL/PostgreSQL 连接池启动时建立的连接数
+    unsigned int db_pool_max_connections = 4; // MySQL/PostgreSQL 连接池的连接数上限
+    unsigned int db_pool_health_check_seconds = 30; // 连接空闲超过该秒数后，使用前先检查是否存活（断开则重连），0 表示不检查
+    unsigned int sqlite_reader_connections = 2; // SQLite 只读连接数，事务之外的查询走只读连接，0 表示读写共用一个连接
 
     // HTTP Server Config
-    bool http_server_enabled = true;
-    std::string http_server_host = "0.0.0.0";
+    bool http_server_enabled = false; // 配置 http_server_token 后再启用
+    std::string http_server_host = "127.0.0.1";
+    std::string http_server_token; // API 请求须携带 Authorization: Bearer <令牌>，为空时拒绝所有 API 请求
     unsigned int http_server_port = 8080;
-    std::string http_server_static_path = "http_static";
+    std::string http_server_static_path = "http_static"; // 网页文件目录，相对路径基于模组目录
+    unsigned int http_server_threads = 2; // HTTP 事件循环线程数，数据库操作在 I/O 线程上执行
 
     // Cache Warmup Config
     bool enable_cache_warmup = true; // 是否在启动时预热缓存
+    unsigned int cache_warmup_recent_players = 0; // 预热时额外构建最近上线的多少名玩家的缓存，0 表示不预热玩家
+    bool cache_snapshot_enabled = false; // 关闭时把编译后的组缓存写入数据目录下的快照文件，下次启动时若数据库未变则直接载入
     unsigned int cache_worker_threads = 4; // 缓存失效工作线程池大小
+    unsigned int decision_cache_max_entries = 256; // 每个玩家缓存的权限判定结果数量上限，0 表示禁用
+    unsigned int cache_shards = 16; // 玩家缓存按 UUID 哈希分片的数量，每片一把读写锁，1 表示单锁模式
+    bool cache_refresh_ahead = false; // 在线玩家缓存失效时由后台线程重建并替换，重建完成前继续使用旧快照
+    bool write_behind_enabled = false; // 启用玩家组关系写回队列，批量接口的修改合并后在一个事务中提交
+    unsigned int write_behind_interval_ms = 50; // 写回队列两次提交之间的最长间隔（毫秒）
+    unsigned int write_behind_max_batch = 1000; // 写回队列积累到该条数时立即提交
+    unsigned int io_worker_threads = 2; // 执行异步接口（*Async）的 I/O 线程数
+    bool cluster_invalidation_enabled = false; // 多台服务器共用 MySQL/PostgreSQL 数据库时，通过数据库互相同步缓存失效
+    unsigned int cluster_poll_interval_ms = 500; // 读取其他服务器失效记录的间隔（毫秒），PostgreSQL 上收到通知时会立即读取
+    unsigned int player_cache_max_mb = 64; // 玩家权限快照与玩家组缓存各自的内存上限（MB），超出后淘汰最久未访问的离线玩家，0 表示不限制
 
     // Cleanup Scheduler Config
-    long long cleanup_interval_seconds = 60; // 定期清理任务的执行间隔（秒），默认为 1 分钟
+    long long cleanup_interval_seconds = 600; // 兜底全表清理的执行间隔（秒），到期的临时组由到期队列按时删除
+
+    // Debug Config
+    bool trace_enabled = true; // 把失效任务、快照构建与数据库语句记录到内存中的追踪缓冲区，供 /ba trace 导出
+    bool debug_event_listeners = false; // 注册把所有权限事件写入调试日志的监听器；事件只在有监听器时构造，平时应关闭
 };
 
 } // namespace config
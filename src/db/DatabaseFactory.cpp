@@ -51,5 +51,74 @@ std::unique_ptr<IDatabase> DatabaseFactory::createPostgreSQL(const std::string&
 #endif
 }
 
+std::unique_ptr<IDatabase>
+DatabaseFactory::createPooledSQLite(const std::string& dbPath, size_t readerConnections, SQLiteOptions options) {
+    options.noMutex = true; // 池中的每个连接同一时刻只被一个线程使用
+
+    // SQLite 同一时刻只允许一个写入者，主池固定一个连接；本地文件不需要存活检查
+    PoolOptions writerOptions;
+    writerOptions.minConnections      = 1;
+    writerOptions.maxConnections      = 1;
+    writerOptions.healthCheckInterval = std::chrono::seconds(0);
+
+    PooledDatabase::ConnectionFactory connectReader;
+    PoolOptions                       readerOptions = writerOptions;
+    readerOptions.maxConnections                    = readerConnections;
+    // 内存数据库的每个连接都是独立的库，只读连接看不到写入
+    if (readerConnections > 0 && dbPath != ":memory:" && !dbPath.empty()) {
+        connectReader = [dbPath, options] { return std::make_unique<SQLiteDatabase>(dbPath, true, options); };
+    }
+    return std::make_unique<PooledDatabase>(
+        [dbPath, options] { return std::make_unique<SQLiteDatabase>(dbPath, false, options); },
+        writerOptions,
+        std::move(connectReader),
+        readerOptions
+    );
+}
+
+std::unique_ptr<IDatabase> DatabaseFactory::createPooledMySQL(const std::string& host,
+                                                               const std::string& user,
+                                                               const std::string& password,
+                                                               const std::string& database,
+                                                               unsigned int port,
+                                                               const PoolOptions& options) {
+#if BA_ENABLE_MYSQL
+    return std::make_unique<PooledDatabase>(
+        [=] { return std::make_unique<MySQLDatabase>(host, user, password, database, port); },
+        options
+    );
+#else
+    (void)host;
+    (void)user;
+    (void)password;
+    (void)database;
+    (void)port;
+    (void)options;
+    throw std::runtime_error("MySQL support is disabled in this build");
+#endif
+}
+
+std::unique_ptr<IDatabase> DatabaseFactory::createPooledPostgreSQL(const std::string& host,
+                                                                    const std::string& user,
+                                                                    const std::string& password,
+                                                                    const std::string& database,
+                                                                    unsigned int port,
+                                                                    const PoolOptions& options) {
+#if BA_ENABLE_POSTGRESQL
+    return std::make_unique<PooledDatabase>(
+        [=] { return std::make_unique<PostgreSQLDatabase>(host, user, password, database, port); },
+        options
+    );
+#else
+    (void)host;
+    (void)user;
+    (void)password;
+    (void)database;
+    (void)port;
+    (void)options;
+    throw std::runtime_error("PostgreSQL support is disabled in this build");
+#endif
+}
+
 } // namespace db
 } // namespace BA
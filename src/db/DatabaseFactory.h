@@ -3,6 +3,8 @@
 #include <memory>
 #include <string>
 #include "db/IDatabase.h"
+#include "db/PooledDatabase.h"
+#include "db/SQLiteDatabase.h"
 
 namespace BA {
 namespace db {
@@ -25,6 +27,26 @@ public:
                                                     const std::string& database,
                                                     unsigned int port = 5432);
 
+    /// Create a pooled SQLite database: one read-write connection plus readerConnections read-only connections
+    static std::unique_ptr<IDatabase>
+    createPooledSQLite(const std::string& dbPath, size_t readerConnections, SQLiteOptions options = {});
+
+    /// Create a pooled MySQL database, connections are opened lazily up to options.maxConnections
+    static std::unique_ptr<IDatabase> createPooledMySQL(const std::string& host,
+                                                        const std::string& user,
+                                                        const std::string& password,
+                                                        const std::string& database,
+                                                        unsigned int port,
+                                                        const PoolOptions& options);
+
+    /// Create a pooled PostgreSQL database, connections are opened lazily up to options.maxConnections
+    static std::unique_ptr<IDatabase> createPooledPostgreSQL(const std::string& host,
+                                                             const std::string& user,
+                                                             const std::string& password,
+                                                             const std::string& database,
+                                                             unsigned int port,
+                                                             const PoolOptions& options);
+
 
 
 };
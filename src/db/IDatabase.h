@@ -1,6 +1,12 @@
 #pragma once
 
+#include <charconv>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <optional>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <unordered_map>
 
@@ -14,6 +20,58 @@ enum class DatabaseType {
     PostgreSQL
 };
 
+/// @brief Read-only view of the current row, valid only for the duration of the visitor call
+class RowView {
+public:
+    virtual ~RowView() = default;
+    virtual size_t columnCount() const = 0;
+    virtual bool isNull(size_t column) const = 0;
+    /// @brief Column text without copying; empty for NULL. Points into driver buffers, do not keep it
+    virtual std::string_view getText(size_t column) const = 0;
+    /// @brief Column as a 64-bit integer; 0 for NULL or text that is not an integer
+    virtual long long getInt64(size_t column) const {
+        std::string_view text  = getText(column);
+        long long        value = 0;
+        std::from_chars(text.data(), text.data() + text.size(), value);
+        return value;
+    }
+
+    std::string              getString(size_t column) const { return std::string(getText(column)); }
+    std::optional<long long> getOptionalInt64(size_t column) const {
+        if (isNull(column)) return std::nullopt;
+        return getInt64(column);
+    }
+};
+
+/// @brief Called once per row; return false to stop reading the remaining rows.
+///        Must not run other statements on the same database: MySQL/PostgreSQL stream rows over the connection.
+using RowVisitor = std::function<bool(const RowView&)>;
+
+/// @brief Kind of statement run by IDatabase::executeBatch
+enum class BatchKind {
+    InsertOrIgnore, // Insert each row, skipping rows that conflict with an existing one
+    Delete          // Delete the rows whose columns equal each row's values
+};
+
+/// @brief Rows written to one table by IDatabase::executeBatch; every row holds one value per column
+struct BatchStatement {
+    BatchKind                             kind = BatchKind::InsertOrIgnore;
+    std::string                           table;
+    std::vector<std::string>              columns;         // Inserted columns, or the columns a delete matches on
+    std::string                           conflictColumns; // InsertOrIgnore only, as in getInsertOrIgnoreSql
+    std::vector<std::vector<std::string>> rows;
+};
+
+/// @brief Listens on a notification channel (PostgreSQL LISTEN) over its own dedicated connection
+class INotificationListener {
+public:
+    virtual ~INotificationListener() = default;
+    /// @brief Wait until at least one notification arrives on the channel
+    /// @param timeout Maximum time to wait
+    /// @return True if notifications arrived; false on timeout or connection error (the next call reconnects)
+    virtual bool waitForNotification(std::chrono::milliseconds timeout) = 0;
+};
+
 class IDatabase {
 public:
     virtual ~IDatabase() = default;
@@ -22,6 +80,9 @@ public:
     virtual bool execute(const std::string& sql) = 0;
     /// @brief Execute a SQL query and return rows of columns (Use queryPrepared for security)
     virtual std::vector<std::vector<std::string>> query(const std::string& sql) = 0;
+    /// @brief Same as query, reporting failure through ok so that an empty result from a failed
+    ///        query (e.g. a dropped connection) is not mistaken for a query that matched no rows
+    virtual std::vector<std::vector<std::string>> query(const std::string& sql, bool& ok) = 0;
 
     /// @brief Execute a prepared SQL statement without expecting a result set
     /// @param sql The SQL statement with placeholders (e.g., ?)
@@ -35,9 +96,55 @@ public:
     /// @return A vector of rows, where each row is a vector of column strings
     virtual std::vector<std::vector<std::string>> queryPrepared(const std::string& sql, const std::vector<std::string>& params) = 0;
 
+    /// @brief Execute a prepared SQL query and stream its rows to a visitor without buffering the result set
+    /// @param sql The SQL query with placeholders (e.g., ?)
+    /// @param params The parameters to bind to the placeholders
+    /// @param visitor Called for each row with typed accessors
+    /// @return True if the query ran to completion (or the visitor stopped it), false on error
+    virtual bool queryPrepared(const std::string& sql, const std::vector<std::string>& params, const RowVisitor& visitor) = 0;
+
+    /// @brief Same as the buffered queryPrepared, reporting failure through ok so that an empty result
+    ///        from a failed query is not mistaken for a query that matched no rows
+    std::vector<std::vector<std::string>>
+    queryPrepared(const std::string& sql, const std::vector<std::string>& params, bool& ok) {
+        std::vector<std::vector<std::string>> result;
+        ok = queryPrepared(sql, params, [&result](const RowView& row) {
+            std::vector<std::string> values;
+            values.reserve(row.columnCount());
+            for (size_t i = 0; i < row.columnCount(); ++i) values.emplace_back(row.getText(i));
+            result.push_back(std::move(values));
+            return true;
+        });
+        return result;
+    }
+
+    /// @brief Run the same prepared statement once per parameter set, sending them together where the backend allows
+    /// @param sql The SQL statement with placeholders (e.g., ?)
+    /// @param paramSets One parameter list per execution
+    /// @return Number of parameter sets that executed successfully
+    virtual size_t executePreparedBatch(const std::string& sql, const std::vector<std::vector<std::string>>& paramSets) {
+        size_t succeeded = 0;
+        for (const auto& params : paramSets) {
+            if (executePrepared(sql, params)) ++succeeded;
+        }
+        return succeeded;
+    }
+
+    /// @brief Insert or delete many rows of one table in as few round trips as the backend allows.
+    ///        Call inside a transaction: a failed row does not undo the rows before it
+    /// @return Number of rows whose statement succeeded (rows skipped as duplicates count as succeeded)
+    virtual size_t executeBatch(const BatchStatement& batch) {
+        if (batch.columns.empty() || batch.rows.empty()) return 0;
+        return executePreparedBatch(getBatchRowSql(batch), batch.rows);
+    }
+
     /// @brief Close the database connection
     virtual void close() = 0;
 
+    /// @brief Set how many prepared statements are kept per connection (LRU, keyed by SQL text)
+    /// @param capacity Maximum number of cached statements, 0 disables caching
+    virtual void setStatementCacheCapacity(size_t capacity) = 0;
+
     /// @brief Begin a database transaction
     virtual bool beginTransaction() = 0;
     /// @brief Commit the current database transaction
@@ -51,6 +158,23 @@ public:
     virtual std::string getAddColumnSql(const std::string& tableName, const std::string& columnName, const std::string& columnDefinition) const = 0;
     // 新增：获取创建索引的 SQL 语句
     virtual std::string getCreateIndexSql(const std::string& indexName, const std::string& tableName, const std::string& columnName) const = 0;
+    // 获取只为满足 whereClause 的行创建索引（部分索引）的 SQL 语句；不支持部分索引的数据库为所有行创建索引
+    virtual std::string getCreatePartialIndexSql(
+        const std::string& indexName,
+        const std::string& tableName,
+        const std::string& columnName,
+        const std::string& whereClause
+    ) const {
+        (void)whereClause;
+        return getCreateIndexSql(indexName, tableName, columnName);
+    }
+    // 获取删除索引的 SQL 语句，索引不存在时不视为错误
+    virtual std::string getDropIndexSql(const std::string& indexName, const std::string& tableName) const {
+        (void)tableName;
+        return "DROP INDEX IF EXISTS " + indexName + ";";
+    }
+    // 获取显示查询计划的 SQL 语句
+    virtual std::string getExplainSql(const std::string& sql) const { return "EXPLAIN " + sql; }
     // 新增：获取插入或忽略冲突的 SQL 语句 (用于 ON CONFLICT / INSERT IGNORE)
     virtual std::string getInsertOrIgnoreSql(const std::string& tableName, const std::string& columns, const std::string& values, const std::string& conflictColumns) const = 0;
     // 新增：获取自增主键的数据库方言定义
@@ -62,6 +186,43 @@ public:
     // 批量接口
     virtual std::unordered_map<std::string, std::vector<std::string>>
     fetchDirectPermissionsOfGroups(const std::vector<std::string>& groupIds) = 0;
+
+    /// @brief Send a notification on a channel (PostgreSQL NOTIFY); delivered when the current transaction commits
+    /// @return False if the backend has no notification support or sending failed
+    virtual bool notify(const std::string& channel) {
+        (void)channel;
+        return false;
+    }
+    /// @brief Create a listener for a channel on a new dedicated connection
+    /// @return Null if the backend has no notification support or the connection failed
+    virtual std::unique_ptr<INotificationListener> createNotificationListener(const std::string& channel) {
+        (void)channel;
+        return nullptr;
+    }
+
+protected:
+    /// @brief Single-row statement for a batch, with one placeholder per column
+    std::string getBatchRowSql(const BatchStatement& batch) const {
+        std::string columns;
+        for (const auto& column : batch.columns) {
+            if (!columns.empty()) columns += ", ";
+            columns += column;
+        }
+        if (batch.kind == BatchKind::InsertOrIgnore) {
+            return getInsertOrIgnoreSql(
+                batch.table,
+                columns,
+                getInClausePlaceholders(batch.columns.size()),
+                batch.conflictColumns
+            );
+        }
+        std::string sql = "DELETE FROM " + batch.table + " WHERE ";
+        for (size_t i = 0; i < batch.columns.size(); ++i) {
+            if (i > 0) sql += " AND ";
+            sql += batch.columns[i] + " = ?";
+        }
+        return sql + ";";
+    }
 };
 
 } // namespace db
@@ -3,6 +3,7 @@
 #include <string>
 #include <algorithm> // for std::search
 #include <cctype>    // for std::tolower
+#include <map>
 #include <memory>    // for std::unique_ptr
 #include "ll/api/mod/NativeMod.h"
 #include "ll/api/io/Logger.h"
@@ -25,7 +26,8 @@ MySQLDatabase::MySQLDatabase(const std::string& host,
                              const std::string& password,
                              const std::string& database,
                               unsigned int port)
-    : conn_(mysql_init(nullptr)) {
+    : conn_(mysql_init(nullptr)),
+      stmtCache_(DEFAULT_STATEMENT_CACHE_CAPACITY, [](MYSQL_STMT*& stmt) { mysql_stmt_close(stmt); }) {
     auto& logger = ll::mod::NativeMod::current()->getLogger();
     logger.info("正在初始化 MySQL 连接到 {}:{} 数据库={} 用户={}", host, port, database, user);
     if (conn_ == nullptr) {
@@ -77,9 +79,15 @@ bool MySQLDatabase::execute(const std::string& sql) {
 }
 
 std::vector<std::vector<std::string>> MySQLDatabase::query(const std::string& sql) {
+    bool ok;
+    return query(sql, ok);
+}
+
+std::vector<std::vector<std::string>> MySQLDatabase::query(const std::string& sql, bool& ok) {
     auto& logger = ll::mod::NativeMod::current()->getLogger();
     logger.debug("MySQL 查询: {}", sql); // 对 std::string 使用 {}
     std::vector<std::vector<std::string>> result;
+    ok = false;
     if (mysql_query(conn_, sql.c_str()) != 0) {
         std::string error_msg = mysql_error(conn_); // 先获取错误消息
         logger.error("MySQL 查询错误: {}", error_msg); // 使用 {} 占位符记录 std::string
@@ -87,9 +95,13 @@ std::vector<std::vector<std::string>> MySQLDatabase::query(const std::string& sq
     }
     MYSQL_RES* res = mysql_store_result(conn_);
     if (res == nullptr) {
-        logger.warn("MySQL 查询未返回结果集");
+        // 语句本身不产生结果集时不算错误，否则是读取结果时出错（例如连接断开）
+        ok = mysql_field_count(conn_) == 0;
+        if (ok) logger.warn("MySQL 查询未返回结果集");
+        else logger.error("MySQL 读取结果集错误: {}", mysql_error(conn_));
         return result;
     }
+    ok = true;
     int num_fields = mysql_num_fields(res);
     MYSQL_ROW row;
     while ((row = mysql_fetch_row(res))) {
@@ -108,6 +120,11 @@ void MySQLDatabase::close() {
     auto& logger = ll::mod::NativeMod::current()->getLogger();
     if (conn_) {
         logger.info("正在关闭 MySQL 连接");
+        {
+            // 语句句柄依附于连接，必须先于连接关闭
+            std::lock_guard<std::mutex> lock(stmtCacheMutex_);
+            stmtCache_.clear();
+        }
         mysql_close(conn_);
         conn_ = nullptr;
         logger.info("MySQL 连接已关闭");
@@ -119,21 +136,57 @@ DatabaseType MySQLDatabase::getType() const {
 }
 
 
-bool MySQLDatabase::executePrepared(const std::string& sql, const std::vector<std::string>& params) {
+void MySQLDatabase::setStatementCacheCapacity(size_t capacity) {
+    std::lock_guard<std::mutex> lock(stmtCacheMutex_);
+    stmtCache_.setCapacity(capacity);
+}
+
+MYSQL_STMT* MySQLDatabase::acquireStatement(const std::string& sql) {
     auto& logger = ll::mod::NativeMod::current()->getLogger();
-    logger.debug("MySQL 执行预处理语句: {}", sql);
+    MYSQL_STMT* stmt = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(stmtCacheMutex_);
+        if (stmtCache_.take(sql, stmt)) {
+            return stmt;
+        }
+    }
 
-    MYSQL_STMT* stmt = mysql_stmt_init(conn_);
+    stmt = mysql_stmt_init(conn_);
     if (!stmt) {
         logger.error("MySQL mysql_stmt_init 失败");
-        return false;
+        return nullptr;
     }
-
     // 显式转换 sql.length() 为 unsigned long
     if (mysql_stmt_prepare(stmt, sql.c_str(), static_cast<unsigned long>(sql.length())) != 0) {
         std::string error_msg = mysql_stmt_error(stmt); // 先获取错误消息
-        logger.error("MySQL mysql_stmt_prepare 失败: {}", error_msg); // 使用 {} 占位符记录 std::string
+        logger.error("MySQL mysql_stmt_prepare 失败: {}", error_msg);
         mysql_stmt_close(stmt);
+        return nullptr;
+    }
+    return stmt;
+}
+
+void MySQLDatabase::releaseStatement(const std::string& sql, MYSQL_STMT* stmt, bool reusable) {
+    // 释放结果集并重置语句状态；重置失败（例如连接已断开）的句柄不再复用
+    if (reusable) {
+        mysql_stmt_free_result(stmt);
+        reusable = mysql_stmt_reset(stmt) == 0;
+    }
+    if (!reusable) {
+        mysql_stmt_close(stmt);
+        return;
+    }
+    std::lock_guard<std::mutex> lock(stmtCacheMutex_);
+    stmtCache_.put(sql, stmt);
+}
+
+bool MySQLDatabase::executePrepared(const std::string& sql, const std::vector<std::string>& params) {
+    auto& logger = ll::mod::NativeMod::current()->getLogger();
+    logger.debug("MySQL 执行预处理语句: {}", sql);
+
+    // 准备语句（命中缓存时省去一次到服务器的往返）
+    MYSQL_STMT* stmt = acquireStatement(sql);
+    if (!stmt) {
         return false;
     }
 
@@ -152,7 +205,7 @@ bool MySQLDatabase::executePrepared(const std::string& sql, const std::vector<st
 
     if (mysql_stmt_bind_param(stmt, bind.data()) != 0) {
         logger.error("MySQL mysql_stmt_bind_param 失败: {}", mysql_stmt_error(stmt));
-        mysql_stmt_close(stmt);
+        releaseStatement(sql, stmt, false);
         return false;
     }
 
@@ -163,37 +216,125 @@ bool MySQLDatabase::executePrepared(const std::string& sql, const std::vector<st
         if (error_code == 1062) { // ER_DUP_ENTRY 表示重复键
             logger.warn("MySQL executePrepared 重复条目已忽略: {}", error_msg);
             // 将重复键错误视为 INSERT IGNORE 语义的成功
-            mysql_stmt_close(stmt);
+            releaseStatement(sql, stmt, true);
             return true; // 即使执行因重复而失败，也返回 true
         } else {
             logger.error("MySQL mysql_stmt_execute 失败 (代码 {}): {}", error_code, error_msg);
-            mysql_stmt_close(stmt);
+            releaseStatement(sql, stmt, false);
             return false; // 对其他错误返回 false
         }
     }
 
-    mysql_stmt_close(stmt);
+    releaseStatement(sql, stmt, true);
     logger.debug("MySQL executePrepared 成功");
     return true;
 }
 
+size_t MySQLDatabase::executeBatch(const BatchStatement& batch) {
+    if (batch.columns.empty() || batch.rows.empty()) return 0;
+    const size_t columnCount = batch.columns.size();
+    size_t       succeeded   = 0;
+
+    if (batch.kind == BatchKind::InsertOrIgnore) {
+        std::string columns;
+        for (const auto& column : batch.columns) {
+            if (!columns.empty()) columns += ", ";
+            columns += column;
+        }
+        const std::string row = "(" + getInClausePlaceholders(columnCount) + ")";
+        for (size_t begin = 0; begin < batch.rows.size(); begin += BATCH_ROWS_PER_STATEMENT) {
+            size_t                   end = std::min(begin + BATCH_ROWS_PER_STATEMENT, batch.rows.size());
+            std::string              sql = "INSERT IGNORE INTO " + batch.table + " (" + columns + ") VALUES ";
+            std::vector<std::string> params;
+            params.reserve((end - begin) * columnCount);
+            for (size_t i = begin; i < end; ++i) {
+                if (i != begin) sql += ", ";
+                sql += row;
+                params.insert(params.end(), batch.rows[i].begin(), batch.rows[i].end());
+            }
+            sql += ";";
+            if (executePrepared(sql, params)) succeeded += end - begin;
+        }
+        return succeeded;
+    }
+
+    // 按除最后一列以外的取值分组，每组一条 WHERE a = ? AND ... AND last IN (?, ?, ...)
+    std::map<std::vector<std::string>, std::vector<const std::string*>> groups;
+    for (const auto& row : batch.rows) {
+        groups[std::vector<std::string>(row.begin(), row.end() - 1)].push_back(&row.back());
+    }
+    std::string prefix = "DELETE FROM " + batch.table + " WHERE ";
+    for (size_t i = 0; i + 1 < columnCount; ++i) prefix += batch.columns[i] + " = ? AND ";
+    prefix += batch.columns.back() + " IN (";
+    for (const auto& [key, values] : groups) {
+        for (size_t begin = 0; begin < values.size(); begin += BATCH_ROWS_PER_STATEMENT) {
+            size_t                   end    = std::min(begin + BATCH_ROWS_PER_STATEMENT, values.size());
+            std::vector<std::string> params = key;
+            params.reserve(key.size() + end - begin);
+            for (size_t i = begin; i < end; ++i) params.push_back(*values[i]);
+            if (executePrepared(prefix + getInClausePlaceholders(end - begin) + ");", params)) {
+                succeeded += end - begin;
+            }
+        }
+    }
+    return succeeded;
+}
 
 std::vector<std::vector<std::string>> MySQLDatabase::queryPrepared(const std::string& sql, const std::vector<std::string>& params) {
-    auto& logger = ll::mod::NativeMod::current()->getLogger();
-    logger.debug("MySQL 查询预处理语句: {}", sql);
     std::vector<std::vector<std::string>> result;
+    queryPrepared(sql, params, [&result](const RowView& row) {
+        std::vector<std::string> values;
+        values.reserve(row.columnCount());
+        for (size_t i = 0; i < row.columnCount(); ++i) {
+            values.emplace_back(row.getText(i));
+        }
+        result.push_back(std::move(values));
+        return true;
+    });
+    return result;
+}
 
-    MYSQL_STMT* stmt = mysql_stmt_init(conn_);
-    if (!stmt) {
-        logger.error("MySQL mysql_stmt_init 失败");
-        return result;
+namespace {
+
+// 读取绑定到结果缓冲区的当前行，所有列都以字符串形式获取
+class MySQLRowView : public RowView {
+public:
+    MySQLRowView(
+        const std::vector<std::vector<char>>& buffers,
+        const std::vector<unsigned long>&     lengths,
+        const bool*                           isNull
+    )
+    : buffers_(buffers),
+      lengths_(lengths),
+      isNull_(isNull) {}
+
+    size_t           columnCount() const override { return buffers_.size(); }
+    bool             isNull(size_t column) const override { return isNull_[column]; }
+    std::string_view getText(size_t column) const override {
+        if (isNull_[column]) return {};
+        return {buffers_[column].data(), lengths_[column]};
     }
 
-    // 显式转换 sql.length() 为 unsigned long
-    if (mysql_stmt_prepare(stmt, sql.c_str(), static_cast<unsigned long>(sql.length())) != 0) {
-        logger.error("MySQL mysql_stmt_prepare 失败: {}", mysql_stmt_error(stmt));
-        mysql_stmt_close(stmt);
-        return result;
+private:
+    const std::vector<std::vector<char>>& buffers_;
+    const std::vector<unsigned long>&     lengths_;
+    const bool*                           isNull_;
+};
+
+} // namespace
+
+bool MySQLDatabase::queryPrepared(
+    const std::string&              sql,
+    const std::vector<std::string>& params,
+    const RowVisitor&               visitor
+) {
+    auto& logger = ll::mod::NativeMod::current()->getLogger();
+    logger.debug("MySQL 查询预处理语句: {}", sql);
+
+    // 准备语句（命中缓存时省去一次到服务器的往返）
+    MYSQL_STMT* stmt = acquireStatement(sql);
+    if (!stmt) {
+        return false;
     }
 
     // 绑定参数
@@ -211,15 +352,15 @@ std::vector<std::vector<std::string>> MySQLDatabase::queryPrepared(const std::st
 
     if (mysql_stmt_bind_param(stmt, param_bind.data()) != 0) {
         logger.error("MySQL mysql_stmt_bind_param 失败: {}", mysql_stmt_error(stmt));
-        mysql_stmt_close(stmt);
-        return result;
+        releaseStatement(sql, stmt, false);
+        return false;
     }
 
     // 执行
     if (mysql_stmt_execute(stmt) != 0) {
         logger.error("MySQL mysql_stmt_execute 失败: {}", mysql_stmt_error(stmt));
-        mysql_stmt_close(stmt);
-        return result;
+        releaseStatement(sql, stmt, false);
+        return false;
     }
 
     // 获取结果元数据
@@ -227,13 +368,14 @@ std::vector<std::vector<std::string>> MySQLDatabase::queryPrepared(const std::st
     if (!meta_result) {
         // 对于 INSERT/UPDATE/DELETE 等语句可能会发生这种情况
         // 检查是否有错误或只是没有结果集
-        if (mysql_stmt_errno(stmt) != 0) {
-         logger.error("MySQL mysql_stmt_result_metadata 失败: {}", mysql_stmt_error(stmt));
+        bool ok = mysql_stmt_errno(stmt) == 0;
+        if (!ok) {
+            logger.error("MySQL mysql_stmt_result_metadata 失败: {}", mysql_stmt_error(stmt));
         } else {
-             logger.debug("MySQL queryPrepared 未返回结果集 (例如 INSERT/UPDATE)。");
+            logger.debug("MySQL queryPrepared 未返回结果集 (例如 INSERT/UPDATE)。");
         }
-        mysql_stmt_close(stmt);
-        return result; // 返回空结果
+        releaseStatement(sql, stmt, ok);
+        return ok;
     }
 
     int num_fields = mysql_num_fields(meta_result);
@@ -247,8 +389,7 @@ std::vector<std::vector<std::string>> MySQLDatabase::queryPrepared(const std::st
     std::unique_ptr<bool[]> error_arr(new bool[num_fields]);
 
     for (int i = 0; i < num_fields; ++i) {
-        // 分配一个合理的缓冲区大小，例如 1024 字节。
-        // 对于生产环境，可能需要动态调整大小或检查字段元数据的 max_length。
+        // 初始缓冲区 1024 字节，遇到更长的值时按实际长度扩大并重新获取该列
         result_buffers[i].resize(1024);
         result_bind[i] = {};
         result_bind[i].buffer_type = MYSQL_TYPE_STRING; // 将所有内容作为字符串获取
@@ -264,60 +405,46 @@ std::vector<std::vector<std::string>> MySQLDatabase::queryPrepared(const std::st
     if (mysql_stmt_bind_result(stmt, result_bind.data()) != 0) {
         logger.error("MySQL mysql_stmt_bind_result 失败: {}", mysql_stmt_error(stmt));
         mysql_free_result(meta_result);
-        mysql_stmt_close(stmt);
-        return result;
-    }
-
-    // 存储结果以允许获取
-    if (mysql_stmt_store_result(stmt) != 0) {
-         logger.error("MySQL mysql_stmt_store_result 失败: {}", mysql_stmt_error(stmt));
-         mysql_free_result(meta_result);
-         mysql_stmt_close(stmt);
-         return result;
+        releaseStatement(sql, stmt, false);
+        return false;
     }
 
-
-    // 获取行
-    while (mysql_stmt_fetch(stmt) == 0) { // 0 表示成功
-        std::vector<std::string> rowVec;
-        rowVec.reserve(num_fields);
-        for (int i = 0; i < num_fields; ++i) {
-            // 从 bool C 数组读取
-            if (is_null_arr[i]) { // 直接检查 bool 值
-                rowVec.emplace_back(""); // 处理 NULL 值
-            } else {
-                // 检查是否发生截断
-                if (error_arr[i]) { // 直接检查 bool 值
-                    logger.warn("MySQL 获取第 {} 列时发生截断。实际长度: {}", i, result_lengths[i]);
-                    // 重新分配缓冲区并重新获取该列
-                    result_buffers[i].resize(result_lengths[i] + 1); // +1 for null terminator
-                    result_bind[i].buffer = result_buffers[i].data();
-                    result_bind[i].buffer_length = static_cast<unsigned long>(result_buffers[i].size());
-
-                    if (mysql_stmt_fetch_column(stmt, &result_bind[i], i, 0) != 0) {
-                        logger.error("MySQL mysql_stmt_fetch_column 失败: {}", mysql_stmt_error(stmt));
-                        rowVec.emplace_back(""); // 发生错误时使用空字符串
-                    } else {
-                        rowVec.emplace_back(result_buffers[i].data(), result_lengths[i]);
-                    }
-                } else {
-                    rowVec.emplace_back(result_buffers[i].data(), result_lengths[i]);
+    // 不调用 mysql_stmt_store_result：行在 fetch 时才从服务器读取，客户端不缓存整个结果集。
+    // 连接在本次调用期间被独占，未读完的行由 releaseStatement 中的 free_result/reset 丢弃。
+    MySQLRowView row(result_buffers, result_lengths, is_null_arr.get());
+    size_t       rows = 0;
+    bool         ok   = true;
+    int          rc;
+    while ((rc = mysql_stmt_fetch(stmt)) == 0 || rc == MYSQL_DATA_TRUNCATED) {
+        if (rc == MYSQL_DATA_TRUNCATED) {
+            for (int i = 0; i < num_fields; ++i) {
+                if (is_null_arr[i] || !error_arr[i]) continue;
+                // 重新分配缓冲区并重新获取该列
+                result_buffers[i].resize(result_lengths[i] + 1); // +1 for null terminator
+                result_bind[i].buffer = result_buffers[i].data();
+                result_bind[i].buffer_length = static_cast<unsigned long>(result_buffers[i].size());
+                if (mysql_stmt_fetch_column(stmt, &result_bind[i], i, 0) != 0) {
+                    logger.error("MySQL mysql_stmt_fetch_column 失败: {}", mysql_stmt_error(stmt));
+                    result_lengths[i] = 0; // 发生错误时使用空字符串
                 }
             }
+            // 扩大后的缓冲区用于后续的行
+            mysql_stmt_bind_result(stmt, result_bind.data());
         }
-        result.push_back(std::move(rowVec));
+        ++rows;
+        if (!visitor(row)) break;
     }
 
     // 循环后检查获取错误
-    if (mysql_stmt_errno(stmt) != 0 && mysql_stmt_errno(stmt) != MYSQL_NO_DATA) {
+    if (rc != 0 && rc != MYSQL_DATA_TRUNCATED && rc != MYSQL_NO_DATA) {
         logger.error("MySQL mysql_stmt_fetch 失败: {}", mysql_stmt_error(stmt));
-        // 结果可能部分填充
+        ok = false;
     }
 
     mysql_free_result(meta_result);
-    mysql_stmt_close(stmt);
-    logger.debug("MySQL queryPrepared 返回 {} 行", result.size());
-    return result;
+    releaseStatement(sql, stmt, ok);
+    logger.debug("MySQL queryPrepared 读取了 {} 行", rows);
+    return ok;
 }
 
 
@@ -338,6 +465,10 @@ std::string MySQLDatabase::getCreateIndexSql(const std::string& indexName, const
     return "CREATE INDEX " + indexName + " ON " + tableName + " (" + columnName + ");";
 }
 
+std::string MySQLDatabase::getDropIndexSql(const std::string& indexName, const std::string& tableName) const {
+    return "DROP INDEX " + indexName + " ON " + tableName + ";";
+}
+
 // 新增：获取插入或忽略冲突的 SQL 语句 (用于 INSERT IGNORE)
 std::string MySQLDatabase::getInsertOrIgnoreSql(const std::string& tableName, const std::string& columns, const std::string& values, const std::string& conflictColumns) const {
     // MySQL uses INSERT IGNORE
@@ -386,12 +517,12 @@ MySQLDatabase::fetchDirectPermissionsOfGroups(const std::vector<std::string>& gr
     std::string sql = "SELECT group_id, permission_rule FROM group_permissions WHERE group_id IN ("
                     + getInClausePlaceholders(groupIds.size()) + ");";
 
-    auto rows = queryPrepared(sql, groupIds);
-    for (const auto& row : rows) {
-        if (row.size() == 2) {
-            result[row[0]].push_back(row[1]);
+    queryPrepared(sql, groupIds, [&result](const RowView& row) {
+        if (row.columnCount() == 2) {
+            result[row.getString(0)].push_back(row.getString(1));
         }
-    }
+        return true;
+    });
     return result;
 }
 
@@ -1,8 +1,10 @@
 #pragma once
 
 #include "db/IDatabase.h"
+#include "db/StatementCache.h"
 #include <mysql.h>
 #include <string>
+#include <mutex>
 #include <vector>
 #include <unordered_map>
 
@@ -20,9 +22,14 @@ public:
 
     bool execute(const std::string& sql) override;
     std::vector<std::vector<std::string>> query(const std::string& sql) override;
+    std::vector<std::vector<std::string>> query(const std::string& sql, bool& ok) override;
     bool executePrepared(const std::string& sql, const std::vector<std::string>& params) override;
     std::vector<std::vector<std::string>> queryPrepared(const std::string& sql, const std::vector<std::string>& params) override;
+    bool queryPrepared(const std::string& sql, const std::vector<std::string>& params, const RowVisitor& visitor) override;
+    // 合并为多行 INSERT IGNORE ... VALUES (...), (...) 与 DELETE ... IN (...)，每条语句最多 BATCH_ROWS_PER_STATEMENT 行
+    size_t executeBatch(const BatchStatement& batch) override;
     void close() override;
+    void setStatementCacheCapacity(size_t capacity) override;
 
     virtual DatabaseType getType() const override;
 
@@ -32,6 +39,8 @@ public:
     std::string getAddColumnSql(const std::string& tableName, const std::string& columnName, const std::string& columnDefinition) const override;
     // 新增：获取创建索引的 SQL 语句
     std::string getCreateIndexSql(const std::string& indexName, const std::string& tableName, const std::string& columnName) const override;
+    // MySQL 不支持 DROP INDEX IF EXISTS，索引不存在的错误 (1091) 由 execute 忽略
+    std::string getDropIndexSql(const std::string& indexName, const std::string& tableName) const override;
     // 新增：获取插入或忽略冲突的 SQL 语句 (用于 ON CONFLICT / INSERT IGNORE)
     std::string getInsertOrIgnoreSql(const std::string& tableName, const std::string& columns, const std::string& values, const std::string& conflictColumns) const override;
     // 新增：获取自增主键的数据库方言定义
@@ -50,7 +59,16 @@ public:
     fetchDirectPermissionsOfGroups(const std::vector<std::string>& groupIds) override;
 
 private:
-    MYSQL* conn_;
+    static constexpr size_t BATCH_ROWS_PER_STATEMENT = 250; // 远低于 65535 个占位符的上限
+
+    // 从语句缓存取出或新建预处理语句，失败时返回 nullptr
+    MYSQL_STMT* acquireStatement(const std::string& sql);
+    // 重置语句并放回缓存；reusable 为 false 时直接关闭
+    void        releaseStatement(const std::string& sql, MYSQL_STMT* stmt, bool reusable);
+
+    MYSQL*                      conn_;
+    std::mutex                  stmtCacheMutex_; // 保护 stmtCache_
+    StatementCache<MYSQL_STMT*> stmtCache_;
 };
 
 } // namespace db
@@ -0,0 +1,447 @@
+#include "db/PooledDatabase.h"
+#include "ll/api/io/Logger.h"
+#include "ll/api/mod/NativeMod.h"
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <stdexcept>
+
+using namespace std;
+using namespace ll::mod;
+
+namespace BA {
+namespace db {
+
+namespace {
+constexpr size_t UNSET_CAPACITY = SIZE_MAX;
+
+struct Connection {
+    shared_ptr<IDatabase>            db;
+    chrono::steady_clock::time_point lastUsed = chrono::steady_clock::now();
+    bool                             suspect  = false; // 上次调用失败，取出前需要先检查连接
+    size_t                           statementCacheCapacity = UNSET_CAPACITY;
+};
+} // namespace
+
+/**
+ * @brief 一组同类连接。空闲连接按后进先出取用，让常用的连接保持活跃、少用的连接自然空闲。
+ */
+class PooledDatabase::Pool {
+public:
+    Pool(string name, ConnectionFactory connect, PoolOptions options)
+    : m_name(std::move(name)),
+      m_connect(std::move(connect)),
+      m_options(options) {
+        if (m_options.maxConnections == 0) m_options.maxConnections = 1;
+        m_options.minConnections = min(m_options.minConnections, m_options.maxConnections);
+        // 初始连接失败直接抛出，由调用方决定是否继续启动
+        for (size_t i = 0; i < m_options.minConnections; ++i) {
+            auto conn = make_unique<Connection>();
+            conn->db  = shared_ptr<IDatabase>(m_connect());
+            m_idle.push_back(std::move(conn));
+            ++m_total;
+        }
+    }
+
+    // 取出一个连接，池已关闭、连接失败或等待超时时返回空
+    unique_ptr<Connection> take() {
+        auto&                  logger = NativeMod::current()->getLogger();
+        unique_ptr<Connection> conn;
+        {
+            unique_lock<mutex> lock(m_mutex);
+            bool available = m_cv.wait_for(lock, m_options.acquireTimeout, [this] {
+                return m_closed || !m_idle.empty() || m_total < m_options.maxConnections;
+            });
+            if (m_closed) return nullptr;
+            if (!available) {
+                logger.error("{} 连接池等待空闲连接超时（上限 {}）", m_name, m_options.maxConnections);
+                return nullptr;
+            }
+            if (!m_idle.empty()) {
+                conn = std::move(m_idle.back());
+                m_idle.pop_back();
+            } else {
+                ++m_total; // 先占位，连接在锁外建立
+            }
+        }
+
+        if (conn && needsCheck(*conn)) {
+            if (isAlive(*conn)) {
+                conn->suspect = false;
+            } else {
+                logger.warn("{} 连接已失效，正在重新连接", m_name);
+                conn->db->close();
+                conn.reset();
+            }
+        }
+        if (!conn) {
+            conn = open();
+            if (!conn) {
+                lock_guard<mutex> lock(m_mutex);
+                --m_total;
+                m_cv.notify_one();
+                return nullptr;
+            }
+        }
+
+        size_t capacity = m_statementCacheCapacity.load(memory_order_relaxed);
+        if (capacity != UNSET_CAPACITY && conn->statementCacheCapacity != capacity) {
+            conn->db->setStatementCacheCapacity(capacity);
+            conn->statementCacheCapacity = capacity;
+        }
+        return conn;
+    }
+
+    // 归还连接；池已关闭时直接关闭连接
+    void release(unique_ptr<Connection> conn) {
+        conn->lastUsed = chrono::steady_clock::now();
+        {
+            lock_guard<mutex> lock(m_mutex);
+            if (!m_closed) {
+                m_idle.push_back(std::move(conn));
+                m_cv.notify_one();
+                return;
+            }
+            --m_total;
+        }
+        conn->db->close();
+    }
+
+    // 新的容量在连接下次被取出时生效
+    void setStatementCacheCapacity(size_t capacity) { m_statementCacheCapacity.store(capacity, memory_order_relaxed); }
+
+    void close() {
+        deque<unique_ptr<Connection>> idle;
+        {
+            lock_guard<mutex> lock(m_mutex);
+            m_closed = true;
+            idle.swap(m_idle);
+            m_total -= idle.size();
+            m_cv.notify_all();
+        }
+        for (auto& conn : idle) conn->db->close();
+    }
+
+    // 任意一个已建立的连接，用于生成方言 SQL
+    shared_ptr<IDatabase> any() {
+        lock_guard<mutex> lock(m_mutex);
+        return m_idle.empty() ? nullptr : m_idle.front()->db;
+    }
+
+private:
+    bool needsCheck(const Connection& conn) const {
+        if (conn.suspect) return true;
+        auto interval = m_options.healthCheckInterval;
+        return interval.count() > 0 && chrono::steady_clock::now() - conn.lastUsed >= interval;
+    }
+
+    static bool isAlive(Connection& conn) { return !conn.db->query("SELECT 1;").empty(); }
+
+    unique_ptr<Connection> open() {
+        try {
+            auto conn = make_unique<Connection>();
+            conn->db  = shared_ptr<IDatabase>(m_connect());
+            return conn;
+        } catch (const exception& e) {
+            NativeMod::current()->getLogger().error("{} 建立连接失败: {}", m_name, e.what());
+            return nullptr;
+        }
+    }
+
+    string            m_name;
+    ConnectionFactory m_connect;
+    PoolOptions       m_options;
+
+    mutex                         m_mutex;
+    condition_variable            m_cv;
+    deque<unique_ptr<Connection>> m_idle;
+    size_t                        m_total  = 0; // 已建立（含正在建立）的连接数
+    bool                          m_closed = false;
+    atomic<size_t>                m_statementCacheCapacity{UNSET_CAPACITY};
+};
+
+/**
+ * @brief 一次调用期间对连接的独占使用权，析构时归还连接。
+ *        事务中的线程拿到的是借用的绑定连接，析构时不归还。
+ */
+class PooledDatabase::Lease {
+public:
+    Lease() = default;
+    Lease(Pool* pool, unique_ptr<Connection> conn) : m_pool(pool), m_conn(std::move(conn)), m_db(m_conn ? m_conn->db.get() : nullptr) {}
+    explicit Lease(IDatabase* borrowed) : m_db(borrowed) {}
+    Lease(Lease&&)            = default;
+    Lease& operator=(Lease&&) = delete;
+    ~Lease() {
+        if (m_pool && m_conn) m_pool->release(std::move(m_conn));
+    }
+
+    explicit   operator bool() const { return m_db != nullptr; }
+    IDatabase* operator->() const { return m_db; }
+    IDatabase* get() const { return m_db; }
+
+    // 调用失败时标记连接，下次取出前先检查是否存活
+    void markSuspect() {
+        if (m_conn) m_conn->suspect = true;
+    }
+
+private:
+    Pool*                  m_pool = nullptr;
+    unique_ptr<Connection> m_conn;
+    IDatabase*             m_db = nullptr;
+};
+
+PooledDatabase::PooledDatabase(
+    ConnectionFactory connect,
+    PoolOptions       options,
+    ConnectionFactory connectReader,
+    PoolOptions       readerOptions
+) {
+    auto& logger = NativeMod::current()->getLogger();
+    options.minConnections = max<size_t>(options.minConnections, 1); // 至少保留一个连接用于生成方言 SQL
+    m_writers              = make_unique<Pool>("数据库", std::move(connect), options);
+    m_dialect              = m_writers->any();
+    if (connectReader && readerOptions.maxConnections > 0) {
+        m_readers = make_unique<Pool>("只读数据库", std::move(connectReader), readerOptions);
+    }
+    logger.info(
+        "数据库连接池已创建: 连接 {}-{} 个, 只读连接 {} 个",
+        options.minConnections,
+        options.maxConnections,
+        m_readers ? readerOptions.maxConnections : 0
+    );
+}
+
+PooledDatabase::~PooledDatabase() { close(); }
+
+PooledDatabase::Lease PooledDatabase::acquire(bool readOnly) {
+    {
+        lock_guard<mutex> lock(m_transactionMutex);
+        auto              it = m_transactions.find(this_thread::get_id());
+        if (it != m_transactions.end()) {
+            return Lease(it->second->get()); // 事务内的读写都必须落在同一个连接上
+        }
+    }
+    Pool* pool = (readOnly && m_readers) ? m_readers.get() : m_writers.get();
+    return Lease(pool, pool->take());
+}
+
+DatabaseType PooledDatabase::getType() const { return m_dialect->getType(); }
+
+bool PooledDatabase::execute(const std::string& sql) {
+    auto lease = acquire(false);
+    if (!lease) return false;
+    bool ok = lease->execute(sql);
+    if (!ok) lease.markSuspect();
+    return ok;
+}
+
+std::vector<std::vector<std::string>> PooledDatabase::query(const std::string& sql) {
+    bool ok;
+    return query(sql, ok);
+}
+
+std::vector<std::vector<std::string>> PooledDatabase::query(const std::string& sql, bool& ok) {
+    auto lease = acquire(true);
+    if (!lease) {
+        ok = false;
+        return {};
+    }
+    auto rows = lease->query(sql, ok);
+    if (!ok) lease.markSuspect(); // 读取失败同样可能是连接断开，不等空闲检查
+    return rows;
+}
+
+bool PooledDatabase::executePrepared(const std::string& sql, const std::vector<std::string>& params) {
+    auto lease = acquire(false);
+    if (!lease) return false;
+    bool ok = lease->executePrepared(sql, params);
+    if (!ok) lease.markSuspect();
+    return ok;
+}
+
+size_t PooledDatabase::executePreparedBatch(
+    const std::string&                           sql,
+    const std::vector<std::vector<std::string>>& paramSets
+) {
+    auto lease = acquire(false);
+    if (!lease) return 0;
+    size_t succeeded = lease->executePreparedBatch(sql, paramSets);
+    if (succeeded < paramSets.size()) lease.markSuspect();
+    return succeeded;
+}
+
+size_t PooledDatabase::executeBatch(const BatchStatement& batch) {
+    auto lease = acquire(false);
+    if (!lease) return 0;
+    size_t succeeded = lease->executeBatch(batch);
+    if (succeeded < batch.rows.size()) lease.markSuspect();
+    return succeeded;
+}
+
+std::vector<std::vector<std::string>>
+PooledDatabase::queryPrepared(const std::string& sql, const std::vector<std::string>& params) {
+    bool ok;
+    return IDatabase::queryPrepared(sql, params, ok); // 经由下面的逐行接口，失败时同样标记连接
+}
+
+bool PooledDatabase::queryPrepared(
+    const std::string&              sql,
+    const std::vector<std::string>& params,
+    const RowVisitor&               visitor
+) {
+    auto lease = acquire(true);
+    if (!lease) return false;
+    bool ok = lease->queryPrepared(sql, params, visitor); // 访问期间连接一直被占用
+    if (!ok) lease.markSuspect();
+    return ok;
+}
+
+void PooledDatabase::close() {
+    if (m_closed.exchange(true)) return;
+    auto& logger = NativeMod::current()->getLogger();
+    {
+        lock_guard<mutex> lock(m_transactionMutex);
+        if (!m_transactions.empty()) {
+            logger.warn("关闭连接池时仍有 {} 个未结束的事务，将被回滚", m_transactions.size());
+            for (auto& [thread, lease] : m_transactions) (*lease)->rollback();
+        }
+        m_transactions.clear();
+    }
+    if (m_readers) m_readers->close();
+    m_writers->close();
+    logger.info("数据库连接池已关闭");
+}
+
+void PooledDatabase::setStatementCacheCapacity(size_t capacity) {
+    m_writers->setStatementCacheCapacity(capacity);
+    if (m_readers) m_readers->setStatementCacheCapacity(capacity);
+}
+
+bool PooledDatabase::beginTransaction() {
+    auto& logger = NativeMod::current()->getLogger();
+    auto  thread = this_thread::get_id();
+    {
+        lock_guard<mutex> lock(m_transactionMutex);
+        if (m_transactions.count(thread)) {
+            logger.error("当前线程已有未结束的事务，不支持嵌套事务");
+            return false;
+        }
+    }
+    Lease lease(m_writers.get(), m_writers->take());
+    if (!lease) return false;
+    if (!lease->beginTransaction()) {
+        lease.markSuspect();
+        return false;
+    }
+    lock_guard<mutex> lock(m_transactionMutex);
+    m_transactions.emplace(thread, make_shared<Lease>(std::move(lease)));
+    return true;
+}
+
+bool PooledDatabase::commit() {
+    shared_ptr<Lease> lease;
+    {
+        lock_guard<mutex> lock(m_transactionMutex);
+        auto              it = m_transactions.find(this_thread::get_id());
+        if (it == m_transactions.end()) {
+            NativeMod::current()->getLogger().error("commit 失败: 当前线程没有进行中的事务");
+            return false;
+        }
+        lease = it->second;
+    }
+    if (!(*lease)->commit()) {
+        return false; // 保持绑定，调用方随后会 rollback
+    }
+    lock_guard<mutex> lock(m_transactionMutex);
+    m_transactions.erase(this_thread::get_id());
+    return true;
+}
+
+bool PooledDatabase::rollback() {
+    shared_ptr<Lease> lease;
+    {
+        lock_guard<mutex> lock(m_transactionMutex);
+        auto              it = m_transactions.find(this_thread::get_id());
+        if (it == m_transactions.end()) {
+            NativeMod::current()->getLogger().error("rollback 失败: 当前线程没有进行中的事务");
+            return false;
+        }
+        lease = std::move(it->second);
+        m_transactions.erase(it);
+    }
+    bool ok = (*lease)->rollback();
+    if (!ok) lease->markSuspect();
+    return ok; // lease 析构时归还连接
+}
+
+std::string PooledDatabase::getCreateTableSql(const std::string& tableName, const std::string& columns) const {
+    return m_dialect->getCreateTableSql(tableName, columns);
+}
+
+std::string PooledDatabase::getAddColumnSql(
+    const std::string& tableName,
+    const std::string& columnName,
+    const std::string& columnDefinition
+) const {
+    return m_dialect->getAddColumnSql(tableName, columnName, columnDefinition);
+}
+
+std::string PooledDatabase::getCreateIndexSql(
+    const std::string& indexName,
+    const std::string& tableName,
+    const std::string& columnName
+) const {
+    return m_dialect->getCreateIndexSql(indexName, tableName, columnName);
+}
+
+std::string PooledDatabase::getCreatePartialIndexSql(
+    const std::string& indexName,
+    const std::string& tableName,
+    const std::string& columnName,
+    const std::string& whereClause
+) const {
+    return m_dialect->getCreatePartialIndexSql(indexName, tableName, columnName, whereClause);
+}
+
+std::string PooledDatabase::getDropIndexSql(const std::string& indexName, const std::string& tableName) const {
+    return m_dialect->getDropIndexSql(indexName, tableName);
+}
+
+std::string PooledDatabase::getExplainSql(const std::string& sql) const { return m_dialect->getExplainSql(sql); }
+
+std::string PooledDatabase::getInsertOrIgnoreSql(
+    const std::string& tableName,
+    const std::string& columns,
+    const std::string& values,
+    const std::string& conflictColumns
+) const {
+    return m_dialect->getInsertOrIgnoreSql(tableName, columns, values, conflictColumns);
+}
+
+std::string PooledDatabase::getAutoIncrementPrimaryKeyDefinition() const {
+    return m_dialect->getAutoIncrementPrimaryKeyDefinition();
+}
+
+std::string PooledDatabase::getInClausePlaceholders(size_t count) const {
+    return m_dialect->getInClausePlaceholders(count);
+}
+
+std::unordered_map<std::string, std::vector<std::string>>
+PooledDatabase::fetchDirectPermissionsOfGroups(const std::vector<std::string>& groupIds) {
+    auto lease = acquire(true);
+    if (!lease) return {};
+    return lease->fetchDirectPermissionsOfGroups(groupIds);
+}
+
+bool PooledDatabase::notify(const std::string& channel) {
+    auto lease = acquire(false);
+    if (!lease) return false;
+    return lease->notify(channel);
+}
+
+std::unique_ptr<INotificationListener> PooledDatabase::createNotificationListener(const std::string& channel) {
+    return m_dialect->createNotificationListener(channel);
+}
+
+} // namespace db
+} // namespace BA
@@ -0,0 +1,105 @@
+#pragma once
+
+#include "db/IDatabase.h"
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace BA {
+namespace db {
+
+/// @brief 连接池参数
+struct PoolOptions {
+    size_t                    minConnections = 1;  // 启动时建立的连接数
+    size_t                    maxConnections = 4;  // 连接数上限，用尽时调用方等待
+    std::chrono::seconds      healthCheckInterval{30}; // 连接空闲超过该时长后，取出前先检查是否存活；0 表示不检查
+    std::chrono::milliseconds acquireTimeout{10000};   // 等待空闲连接的最长时间，超时视为执行失败
+};
+
+/**
+ * @brief 线程安全的连接池，对外仍是一个 IDatabase。
+ *        每次调用从池中独占取出一个连接，调用结束后归还；同一时刻不同线程使用不同的连接，互不干扰。
+ *        beginTransaction 会把取出的连接绑定到调用线程，直到 commit 成功或 rollback，
+ *        期间该线程的所有调用都落在这条连接上。
+ *        可选的只读池（SQLite 的只读连接）承接事务之外的 query/queryPrepared，写入始终走主池。
+ *        MySQL/PostgreSQL 连接断开后在下次取出时重新连接。
+ */
+class PooledDatabase : public IDatabase {
+public:
+    using ConnectionFactory = std::function<std::unique_ptr<IDatabase>()>;
+
+    /**
+     * @param connect 创建主池连接的函数，失败时抛出 std::runtime_error。
+     * @param options 主池参数。
+     * @param connectReader 创建只读连接的函数，为空时读取也走主池。
+     * @param readerOptions 只读池参数。
+     * @throws std::runtime_error 无法建立主池的初始连接时抛出。
+     */
+    PooledDatabase(
+        ConnectionFactory connect,
+        PoolOptions       options,
+        ConnectionFactory connectReader = {},
+        PoolOptions       readerOptions = {}
+    );
+    ~PooledDatabase() override;
+
+    DatabaseType getType() const override;
+
+    bool execute(const std::string& sql) override;
+    std::vector<std::vector<std::string>> query(const std::string& sql) override;
+    std::vector<std::vector<std::string>> query(const std::string& sql, bool& ok) override;
+    bool executePrepared(const std::string& sql, const std::vector<std::string>& params) override;
+    std::vector<std::vector<std::string>> queryPrepared(const std::string& sql, const std::vector<std::string>& params) override;
+    bool queryPrepared(const std::string& sql, const std::vector<std::string>& params, const RowVisitor& visitor) override;
+    // 整批在同一条连接上执行，后端才能把它们合并为一次往返
+    size_t executePreparedBatch(const std::string& sql, const std::vector<std::vector<std::string>>& paramSets) override;
+    size_t executeBatch(const BatchStatement& batch) override;
+    void close() override;
+    void setStatementCacheCapacity(size_t capacity) override;
+
+    bool beginTransaction() override;
+    bool commit() override;
+    bool rollback() override;
+
+    // 方言相关的 SQL 生成不访问连接，直接交给第一个连接
+    std::string getCreateTableSql(const std::string& tableName, const std::string& columns) const override;
+    std::string getAddColumnSql(const std::string& tableName, const std::string& columnName, const std::string& columnDefinition) const override;
+    std::string getCreateIndexSql(const std::string& indexName, const std::string& tableName, const std::string& columnName) const override;
+    std::string getCreatePartialIndexSql(const std::string& indexName, const std::string& tableName, const std::string& columnName, const std::string& whereClause) const override;
+    std::string getDropIndexSql(const std::string& indexName, const std::string& tableName) const override;
+    std::string getExplainSql(const std::string& sql) const override;
+    std::string getInsertOrIgnoreSql(const std::string& tableName, const std::string& columns, const std::string& values, const std::string& conflictColumns) const override;
+    std::string getAutoIncrementPrimaryKeyDefinition() const override;
+    std::string getInClausePlaceholders(size_t count) const override;
+
+    std::unordered_map<std::string, std::vector<std::string>>
+    fetchDirectPermissionsOfGroups(const std::vector<std::string>& groupIds) override;
+
+    bool                                   notify(const std::string& channel) override;
+    // 监听器使用独立的连接，不占用池中的连接
+    std::unique_ptr<INotificationListener> createNotificationListener(const std::string& channel) override;
+
+private:
+    class Pool;
+    class Lease;
+
+    // 取得本次调用使用的连接：事务中的线程使用绑定的连接，否则从对应的池中取出
+    Lease acquire(bool readOnly);
+
+    std::shared_ptr<IDatabase> m_dialect; // 用于生成方言 SQL 的连接（主池的第一个连接）
+    std::unique_ptr<Pool>      m_writers;
+    std::unique_ptr<Pool>      m_readers; // 可为空
+
+    std::mutex                                        m_transactionMutex; // 保护 m_transactions
+    std::unordered_map<std::thread::id, std::shared_ptr<Lease>> m_transactions; // 处于事务中的线程及其连接
+    std::atomic<bool>                                 m_closed{false};
+};
+
+} // namespace db
+} // namespace BA
@@ -8,6 +8,12 @@
 #include <algorithm> // 确保包含 algorithm 头文件
 #include <functional> // 确保包含 functional 头文件
 
+#ifdef _WIN32
+#include <winsock2.h>
+#else
+#include <sys/select.h>
+#endif
+
 using namespace std; // 引入 std 命名空间
 using namespace ll::mod; // 引入 ll::mod 命名空间
 
@@ -29,17 +35,95 @@ static string replacePlaceholders(const string& sql) {
 namespace BA {
 namespace db {
 
+namespace {
+
+// 把频道名转义为标识符；失败时返回空字符串
+string quoteChannel(PGconn* conn, const string& channel) {
+    char* escaped = PQescapeIdentifier(conn, channel.c_str(), channel.size());
+    if (!escaped) return {};
+    string result = escaped;
+    PQfreemem(escaped);
+    return result;
+}
+
+/**
+ * @brief 基于独立连接的 LISTEN 监听器。
+ *        池中的连接会被不同线程轮换使用，不适合长期持有 LISTEN，因此监听器自己建立一条连接。
+ */
+class PostgreSQLNotificationListener : public INotificationListener {
+public:
+    PostgreSQLNotificationListener(PGconn* conn, string channel) : conn_(conn), channel_(std::move(channel)) {}
+    ~PostgreSQLNotificationListener() override { PQfinish(conn_); }
+
+    bool listen() {
+        string quoted = quoteChannel(conn_, channel_);
+        if (quoted.empty()) return false;
+        PGresult* res = PQexec(conn_, ("LISTEN " + quoted).c_str());
+        bool      ok  = PQresultStatus(res) == PGRES_COMMAND_OK;
+        if (!ok) {
+            NativeMod::current()->getLogger().error("PostgreSQL LISTEN {} 失败: {}", channel_, PQerrorMessage(conn_));
+        }
+        PQclear(res);
+        return ok;
+    }
+
+    bool waitForNotification(std::chrono::milliseconds timeout) override {
+        if (PQstatus(conn_) != CONNECTION_OK) {
+            // 连接断开后重连并重新 LISTEN，断线期间的通知会丢失，由调用方的轮询兜底
+            PQreset(conn_);
+            if (PQstatus(conn_) != CONNECTION_OK || !listen()) return false;
+        }
+        if (drainNotifications()) return true;
+
+        int socket = PQsocket(conn_);
+        if (socket < 0) return false;
+        fd_set readSet;
+        FD_ZERO(&readSet);
+        FD_SET(socket, &readSet);
+        timeval tv{};
+        tv.tv_sec  = static_cast<long>(timeout.count() / 1000);
+        tv.tv_usec = static_cast<long>((timeout.count() % 1000) * 1000);
+        if (select(socket + 1, &readSet, nullptr, nullptr, &tv) <= 0) return false;
+
+        if (!PQconsumeInput(conn_)) return false;
+        return drainNotifications();
+    }
+
+private:
+    // 取出已到达的所有通知，返回是否有通知
+    bool drainNotifications() {
+        bool      received = false;
+        PGnotify* notification;
+        while ((notification = PQnotifies(conn_)) != nullptr) {
+            received = true;
+            PQfreemem(notification);
+        }
+        return received;
+    }
+
+    PGconn* conn_;
+    string  channel_;
+};
+
+} // namespace
+
 PostgreSQLDatabase::PostgreSQLDatabase(const string& host,
                                        const string& user,
                                        const string& password,
                                        const string& database,
                                        unsigned int port)
-    : conn_(nullptr) {
+    : conn_(nullptr),
+      stmtCache_(DEFAULT_STATEMENT_CACHE_CAPACITY, [this](std::string& name) {
+          // 服务器端的预处理语句随连接存在，淘汰时显式释放
+          if (conn_) {
+              PQclear(PQexec(conn_, ("DEALLOCATE " + name).c_str()));
+          }
+      }) {
     auto& logger = NativeMod::current()->getLogger();
     logger.info("正在初始化 PostgreSQL 连接到 {}:{} 数据库={} 用户={}", host, port, database, user);
 
-    string conninfo = "host=" + host + " port=" + to_string(port) + " dbname=" + database + " user=" + user + " password=" + password;
-    conn_ = PQconnectdb(conninfo.c_str());
+    conninfo_ = "host=" + host + " port=" + to_string(port) + " dbname=" + database + " user=" + user + " password=" + password;
+    conn_     = PQconnectdb(conninfo_.c_str());
 
     if (PQstatus(conn_) != CONNECTION_OK) {
         string err = PQerrorMessage(conn_);
@@ -83,13 +167,19 @@ bool PostgreSQLDatabase::execute(const string& sql) {
 }
 
 vector<vector<string>> PostgreSQLDatabase::query(const string& sql) {
+    bool ok;
+    return query(sql, ok);
+}
+
+vector<vector<string>> PostgreSQLDatabase::query(const string& sql, bool& ok) {
     auto& logger = NativeMod::current()->getLogger();
     logger.debug("PostgreSQL 查询: {}", sql);
 
     vector<vector<string>> result;
     PGresult* res = PQexec(conn_, sql.c_str());
 
-    if (PQresultStatus(res) != PGRES_TUPLES_OK) {
+    ok = PQresultStatus(res) == PGRES_TUPLES_OK;
+    if (!ok) {
         string error_msg = PQerrorMessage(conn_);
         logger.error("PostgreSQL 查询错误: {}", error_msg);
         PQclear(res);
@@ -115,6 +205,10 @@ void PostgreSQLDatabase::close() {
     auto& logger = NativeMod::current()->getLogger();
     if (conn_) {
         logger.info("正在关闭 PostgreSQL 连接");
+        {
+            std::lock_guard<std::mutex> lock(stmtCacheMutex_);
+            stmtCache_.clear();
+        }
         PQfinish(conn_);
         conn_ = nullptr;
         logger.info("PostgreSQL 连接已关闭");
@@ -125,11 +219,40 @@ DatabaseType PostgreSQLDatabase::getType() const {
     return DatabaseType::PostgreSQL;
 }
 
-bool PostgreSQLDatabase::executePrepared(const string& sql, const vector<string>& params) {
-    auto& logger = NativeMod::current()->getLogger();
-string processedSql = replacePlaceholders(sql);
-logger.debug("PostgreSQL 执行预处理语句: {}", processedSql);
+void PostgreSQLDatabase::setStatementCacheCapacity(size_t capacity) {
+    std::lock_guard<std::mutex> lock(stmtCacheMutex_);
+    stmtCache_.setCapacity(capacity);
+}
+
+string PostgreSQLDatabase::acquireStatement(const string& processedSql) {
+    string name;
+    {
+        std::lock_guard<std::mutex> lock(stmtCacheMutex_);
+        if (stmtCache_.take(processedSql, name)) {
+            return name;
+        }
+        name = "ba_stmt_" + to_string(++nextStatementId_);
+    }
+    // 参数类型交给服务器根据用法推断，与 PQexecParams 的行为一致
+    PGresult* res = PQprepare(conn_, name.c_str(), processedSql.c_str(), 0, nullptr);
+    bool      ok  = PQresultStatus(res) == PGRES_COMMAND_OK;
+    if (!ok) {
+        NativeMod::current()->getLogger().debug("PostgreSQL 准备语句失败，回退到 PQexecParams: {}", PQerrorMessage(conn_));
+    }
+    PQclear(res);
+    return ok ? name : string();
+}
+
+void PostgreSQLDatabase::releaseStatement(const string& processedSql, string name, bool reusable) {
+    std::lock_guard<std::mutex> lock(stmtCacheMutex_);
+    if (reusable) {
+        stmtCache_.put(processedSql, std::move(name));
+    } else if (conn_) {
+        PQclear(PQexec(conn_, ("DEALLOCATE " + name).c_str()));
+    }
+}
 
+PGresult* PostgreSQLDatabase::execWithParams(const string& processedSql, const vector<string>& params) {
     vector<const char*> paramValues;
     vector<int> paramLengths;
     vector<int> paramFormats;
@@ -140,16 +263,43 @@ logger.debug("PostgreSQL 执行预处理语句: {}", processedSql);
         paramFormats.push_back(0); // 0 for text format
     }
 
-PGresult* res = PQexecParams(
+    string name = acquireStatement(processedSql);
+    if (name.empty()) {
+        // 准备失败（例如处于已中止的事务中），直接执行以便调用方拿到真实的错误结果
+        return PQexecParams(
+            conn_,
+            processedSql.c_str(),
+            static_cast<int>(params.size()),
+            nullptr, // paramTypes[] - infer from usage
+            paramValues.data(),
+            paramLengths.data(),
+            paramFormats.data(),
+            0        // resultFormat - 0 for text
+        );
+    }
+
+    PGresult* res = PQexecPrepared(
         conn_,
-        processedSql.c_str(),
+        name.c_str(),
         static_cast<int>(params.size()),
-        nullptr, // paramTypes[] - infer from usage
         paramValues.data(),
         paramLengths.data(),
         paramFormats.data(),
         0        // resultFormat - 0 for text
     );
+    // 26000 (invalid_sql_statement_name) 表示服务器端已没有该语句，其余错误不影响语句本身
+    const char* sqlstate = PQresultErrorField(res, PG_DIAG_SQLSTATE);
+    bool reusable = PQstatus(conn_) == CONNECTION_OK && !(sqlstate && string(sqlstate) == "26000");
+    releaseStatement(processedSql, std::move(name), reusable);
+    return res;
+}
+
+bool PostgreSQLDatabase::executePrepared(const string& sql, const vector<string>& params) {
+    auto& logger = NativeMod::current()->getLogger();
+string processedSql = replacePlaceholders(sql);
+logger.debug("PostgreSQL 执行预处理语句: {}", processedSql);
+
+    PGresult* res = execWithParams(processedSql, params);
 
     if (PQresultStatus(res) != PGRES_COMMAND_OK && PQresultStatus(res) != PGRES_TUPLES_OK) {
         string error_msg = PQerrorMessage(conn_);
@@ -163,12 +313,152 @@ PGresult* res = PQexecParams(
     return true;
 }
 
-vector<vector<string>> PostgreSQLDatabase::queryPrepared(const string& sql, const vector<string>& params) {
-    auto& logger = NativeMod::current()->getLogger();
-string processedSql = replacePlaceholders(sql);
-logger.debug("PostgreSQL 查询预处理语句: {}", processedSql);
+size_t PostgreSQLDatabase::executePreparedBatch(const string& sql, const vector<vector<string>>& paramSets) {
+#ifdef LIBPQ_HAS_PIPELINING
+    if (paramSets.size() < 2) return IDatabase::executePreparedBatch(sql, paramSets);
+    auto&  logger       = NativeMod::current()->getLogger();
+    string processedSql = replacePlaceholders(sql);
+    logger.debug("PostgreSQL 管道执行预处理语句 {} 次: {}", paramSets.size(), processedSql);
+
+    // 语句在进入管道前准备好，管道中只发送执行请求
+    string name = acquireStatement(processedSql);
+    if (name.empty()) return IDatabase::executePreparedBatch(sql, paramSets);
+    if (!PQenterPipelineMode(conn_)) {
+        logger.debug("PostgreSQL 无法进入管道模式，逐条执行: {}", PQerrorMessage(conn_));
+        releaseStatement(processedSql, std::move(name), true);
+        return IDatabase::executePreparedBatch(sql, paramSets);
+    }
+
+    size_t succeeded = 0;
+    bool   reusable  = true;
+    for (size_t begin = 0; begin < paramSets.size(); begin += PIPELINE_CHUNK) {
+        size_t end = std::min(begin + PIPELINE_CHUNK, paramSets.size());
+        succeeded += pipelineBatch(name, paramSets, begin, end, reusable);
+    }
+    if (!PQexitPipelineMode(conn_)) {
+        logger.error("PostgreSQL 退出管道模式失败: {}", PQerrorMessage(conn_));
+    }
+    releaseStatement(processedSql, std::move(name), reusable && PQstatus(conn_) == CONNECTION_OK);
+    if (succeeded < paramSets.size()) {
+        logger.error("PostgreSQL 管道执行 {} 次中有 {} 次失败. 语句: {}", paramSets.size(), paramSets.size() - succeeded, sql);
+    }
+    return succeeded;
+#else
+    return IDatabase::executePreparedBatch(sql, paramSets);
+#endif
+}
+
+size_t PostgreSQLDatabase::pipelineBatch(
+    const string&                 statementName,
+    const vector<vector<string>>& paramSets,
+    size_t                        begin,
+    size_t                        end,
+    bool&                         reusable
+) {
+#ifdef LIBPQ_HAS_PIPELINING
+    auto&               logger = NativeMod::current()->getLogger();
+    vector<const char*> paramValues;
+    vector<int>         paramLengths;
+    size_t              sent = 0;
+    for (size_t i = begin; i < end; ++i) {
+        paramValues.clear();
+        paramLengths.clear();
+        for (const auto& param : paramSets[i]) {
+            paramValues.push_back(param.c_str());
+            paramLengths.push_back(static_cast<int>(param.length()));
+        }
+        if (!PQsendQueryPrepared(
+                conn_,
+                statementName.c_str(),
+                static_cast<int>(paramValues.size()),
+                paramValues.data(),
+                paramLengths.data(),
+                nullptr, // 全部为文本格式
+                0
+            )) {
+            logger.error("PostgreSQL 管道发送失败: {}", PQerrorMessage(conn_));
+            break;
+        }
+        ++sent;
+    }
+    if (!PQpipelineSync(conn_)) {
+        // 同步点没有发出时读不到任何结果，连接只能等下次取出时重新建立
+        logger.error("PostgreSQL 管道同步失败: {}", PQerrorMessage(conn_));
+        reusable = false;
+        return 0;
+    }
+
+    // 每条语句的结果之后跟一个 nullptr；出错后同一同步点之前的语句都返回 PGRES_PIPELINE_ABORTED
+    size_t succeeded = 0;
+    for (size_t i = 0; i < sent; ++i) {
+        while (PGresult* res = PQgetResult(conn_)) {
+            ExecStatusType status = PQresultStatus(res);
+            if (status == PGRES_COMMAND_OK || status == PGRES_TUPLES_OK) {
+                ++succeeded;
+            } else if (status == PGRES_FATAL_ERROR) {
+                logger.error("PostgreSQL 管道中的语句失败: {}", PQresultErrorMessage(res));
+                const char* sqlstate = PQresultErrorField(res, PG_DIAG_SQLSTATE);
+                if (sqlstate && string(sqlstate) == "26000") reusable = false;
+            }
+            PQclear(res);
+        }
+    }
+    // 同步点本身产生一个 PGRES_PIPELINE_SYNC 结果
+    PQclear(PQgetResult(conn_));
+    return succeeded;
+#else
+    (void)statementName, (void)paramSets, (void)begin, (void)end, (void)reusable;
+    return 0;
+#endif
+}
 
+vector<vector<string>> PostgreSQLDatabase::queryPrepared(const string& sql, const vector<string>& params) {
     vector<vector<string>> result;
+    queryPrepared(sql, params, [&result](const RowView& row) {
+        vector<string> values;
+        values.reserve(row.columnCount());
+        for (size_t i = 0; i < row.columnCount(); ++i) {
+            values.emplace_back(row.getText(i));
+        }
+        result.push_back(std::move(values));
+        return true;
+    });
+    return result;
+}
+
+bool PostgreSQLDatabase::queryPrepared(const string& sql, const vector<string>& params, const RowVisitor& visitor) {
+    string processedSql = replacePlaceholders(sql);
+    NativeMod::current()->getLogger().debug("PostgreSQL 查询预处理语句: {}", processedSql);
+    return streamWithParams(processedSql, params, visitor);
+}
+
+namespace {
+
+// 读取 PGresult 中的一行；单行模式下每个结果只有一行
+class PostgreSQLRowView : public RowView {
+public:
+    PostgreSQLRowView(const PGresult* res, int row) : res_(res), row_(row) {}
+
+    size_t columnCount() const override { return static_cast<size_t>(PQnfields(res_)); }
+    bool   isNull(size_t column) const override { return PQgetisnull(res_, row_, static_cast<int>(column)) != 0; }
+    std::string_view getText(size_t column) const override {
+        int c = static_cast<int>(column);
+        return {PQgetvalue(res_, row_, c), static_cast<size_t>(PQgetlength(res_, row_, c))};
+    }
+
+private:
+    const PGresult* res_;
+    int             row_;
+};
+
+} // namespace
+
+bool PostgreSQLDatabase::streamWithParams(
+    const string&         processedSql,
+    const vector<string>& params,
+    const RowVisitor&     visitor
+) {
+    auto& logger = NativeMod::current()->getLogger();
     vector<const char*> paramValues;
     vector<int> paramLengths;
     vector<int> paramFormats;
@@ -179,43 +469,70 @@ logger.debug("PostgreSQL 查询预处理语句: {}", processedSql);
         paramFormats.push_back(0); // 0 for text format
     }
 
-PGresult* res = PQexecParams(
-        conn_,
-        processedSql.c_str(),
-        static_cast<int>(params.size()),
-        nullptr, // paramTypes[] - infer from usage
-        paramValues.data(),
-        paramLengths.data(),
-        paramFormats.data(),
-        0        // resultFormat - 0 for text
-    );
-
-    if (PQresultStatus(res) != PGRES_TUPLES_OK) {
-        string error_msg = PQerrorMessage(conn_);
-        logger.error("PostgreSQL 查询预处理语句失败: {}. 语句: {}", error_msg, sql);
-        PQclear(res);
-        return result;
+    string name = acquireStatement(processedSql);
+    int    sent = 0;
+    if (name.empty()) {
+        // 准备失败时直接发送，以便拿到真实的错误结果
+        sent = PQsendQueryParams(
+            conn_,
+            processedSql.c_str(),
+            static_cast<int>(params.size()),
+            nullptr, // paramTypes[] - infer from usage
+            paramValues.data(),
+            paramLengths.data(),
+            paramFormats.data(),
+            0        // resultFormat - 0 for text
+        );
+    } else {
+        sent = PQsendQueryPrepared(
+            conn_,
+            name.c_str(),
+            static_cast<int>(params.size()),
+            paramValues.data(),
+            paramLengths.data(),
+            paramFormats.data(),
+            0        // resultFormat - 0 for text
+        );
+    }
+    if (!sent) {
+        logger.error("PostgreSQL 发送查询失败: {}. 语句: {}", PQerrorMessage(conn_), processedSql);
+        if (!name.empty()) releaseStatement(processedSql, std::move(name), PQstatus(conn_) == CONNECTION_OK);
+        return false;
+    }
+    // 单行模式：服务器返回的每一行都作为单独的结果交付，客户端不缓存整个结果集。
+    // 设置失败时退回普通模式，结果仍能逐行访问，只是会一次性接收。
+    if (!PQsetSingleRowMode(conn_)) {
+        logger.debug("PostgreSQL 无法进入单行模式，按普通模式接收结果。");
     }
 
-    int nFields = PQnfields(res);
-    int nRows = PQntuples(res);
-    for (int i = 0; i < nRows; i++) {
-        vector<string> row;
-        row.reserve(nFields);
-        for (int j = 0; j < nFields; j++) {
-            char* val = PQgetvalue(res, i, j);
-            if (val) {
-                row.push_back(val);
-            } else {
-                row.push_back(""); // Handle NULL values
+    bool   ok       = true;
+    bool   stopped  = false;
+    size_t rows     = 0;
+    string sqlstate;
+    // 必须读到 nullptr 为止，连接才能执行下一条命令；调用方提前结束时剩余的行直接丢弃
+    while (PGresult* res = PQgetResult(conn_)) {
+        ExecStatusType status = PQresultStatus(res);
+        if (status == PGRES_SINGLE_TUPLE || status == PGRES_TUPLES_OK) {
+            int nRows = PQntuples(res);
+            for (int i = 0; i < nRows && !stopped; ++i) {
+                ++rows;
+                if (!visitor(PostgreSQLRowView(res, i))) stopped = true;
             }
+        } else if (status != PGRES_COMMAND_OK) {
+            ok = false;
+            logger.error("PostgreSQL 查询预处理语句失败: {}. 语句: {}", PQresultErrorMessage(res), processedSql);
+            if (const char* state = PQresultErrorField(res, PG_DIAG_SQLSTATE)) sqlstate = state;
         }
-        result.push_back(std::move(row));
+        PQclear(res);
     }
 
-    PQclear(res);
-    logger.debug("PostgreSQL 查询预处理语句返回 {} 行", result.size());
-    return result;
+    if (!name.empty()) {
+        // 26000 (invalid_sql_statement_name) 表示服务器端已没有该语句，其余错误不影响语句本身
+        bool reusable = PQstatus(conn_) == CONNECTION_OK && sqlstate != "26000";
+        releaseStatement(processedSql, std::move(name), reusable);
+    }
+    logger.debug("PostgreSQL 查询预处理语句读取了 {} 行", rows);
+    return ok;
 }
 
 // 新增：获取创建表的 SQL 语句
@@ -233,6 +550,15 @@ string PostgreSQLDatabase::getCreateIndexSql(const string& indexName, const stri
     return "CREATE INDEX IF NOT EXISTS " + indexName + " ON " + tableName + " (" + columnName + ");";
 }
 
+string PostgreSQLDatabase::getCreatePartialIndexSql(
+    const string& indexName,
+    const string& tableName,
+    const string& columnName,
+    const string& whereClause
+) const {
+    return "CREATE INDEX IF NOT EXISTS " + indexName + " ON " + tableName + " (" + columnName + ") WHERE " + whereClause + ";";
+}
+
 // 新增：获取插入或忽略冲突的 SQL 语句 (用于 ON CONFLICT)
 string PostgreSQLDatabase::getInsertOrIgnoreSql(const string& tableName, const string& columns, const string& values, const string& conflictColumns) const {
     // PostgreSQL uses ON CONFLICT (column) DO NOTHING
@@ -282,39 +608,29 @@ PostgreSQLDatabase::fetchDirectPermissionsOfGroups(const std::vector<std::string
     std::string sql = "SELECT group_id, permission_rule FROM group_permissions WHERE group_id IN ("
                     + getInClausePlaceholders(groupIds.size()) + ");";
 
-    // PQexecParams 需要 const char* 数组作为参数值
-    std::vector<const char*> paramValues;
-    paramValues.reserve(groupIds.size());
-    for (const auto& id : groupIds) {
-        paramValues.push_back(id.c_str());
-    }
-
-    PGresult* res = PQexecParams(
-        conn_,
-        sql.c_str(),
-        static_cast<int>(paramValues.size()),
-        nullptr, // paramTypes[] - infer from usage
-        paramValues.data(),
-        nullptr, // paramLengths[] - null for text format
-        nullptr, // paramFormats[] - null for text format
-        0        // resultFormat - 0 for text
-    );
+    streamWithParams(sql, groupIds, [&result](const RowView& row) {
+        result[row.getString(0)].push_back(row.getString(1));
+        return true;
+    });
+    return result;
+}
 
-    if (PQresultStatus(res) != PGRES_TUPLES_OK) {
-        ll::mod::NativeMod::current()->getLogger().error("PostgreSQL 批量查询组权限失败: {}. 语句: {}", PQerrorMessage(conn_), sql);
-        PQclear(res);
-        return result;
-    }
+bool PostgreSQLDatabase::notify(const std::string& channel) {
+    string quoted = quoteChannel(conn_, channel);
+    if (quoted.empty()) return false;
+    return execute("NOTIFY " + quoted + ";");
+}
 
-    int nRows = PQntuples(res);
-    for (int i = 0; i < nRows; ++i) {
-        std::string groupId    = PQgetvalue(res, i, 0);
-        std::string permission = PQgetvalue(res, i, 1);
-        result[groupId].push_back(permission);
+std::unique_ptr<INotificationListener> PostgreSQLDatabase::createNotificationListener(const std::string& channel) {
+    PGconn* conn = PQconnectdb(conninfo_.c_str());
+    if (PQstatus(conn) != CONNECTION_OK) {
+        NativeMod::current()->getLogger().error("为 LISTEN 建立 PostgreSQL 连接失败: {}", PQerrorMessage(conn));
+        PQfinish(conn);
+        return nullptr;
     }
-
-    PQclear(res);
-    return result;
+    auto listener = std::make_unique<PostgreSQLNotificationListener>(conn, channel);
+    if (!listener->listen()) return nullptr;
+    return listener;
 }
 
 } // namespace db
@@ -2,8 +2,10 @@
 #pragma once
 
 #include "db/IDatabase.h"
+#include "db/StatementCache.h"
 #include <libpq-fe.h>  // Include PostgreSQL C API
 #include <string>
+#include <mutex>
 #include <vector>
 #include <unordered_map>
 
@@ -21,9 +23,14 @@ public:
 
     bool execute(const std::string& sql) override;
     std::vector<std::vector<std::string>> query(const std::string& sql) override;
+    std::vector<std::vector<std::string>> query(const std::string& sql, bool& ok) override;
     bool executePrepared(const std::string& sql, const std::vector<std::string>& params) override;
     std::vector<std::vector<std::string>> queryPrepared(const std::string& sql, const std::vector<std::string>& params) override;
+    bool queryPrepared(const std::string& sql, const std::vector<std::string>& params, const RowVisitor& visitor) override;
+    // libpq 14 起使用管道模式：整批语句连续发送，一次同步后统一读取结果
+    size_t executePreparedBatch(const std::string& sql, const std::vector<std::vector<std::string>>& paramSets) override;
     void close() override;
+    void setStatementCacheCapacity(size_t capacity) override;
 
     virtual DatabaseType getType() const override;
 
@@ -33,6 +40,7 @@ public:
     std::string getAddColumnSql(const std::string& tableName, const std::string& columnName, const std::string& columnDefinition) const override;
     // 新增：获取创建索引的 SQL 语句
     std::string getCreateIndexSql(const std::string& indexName, const std::string& tableName, const std::string& columnName) const override;
+    std::string getCreatePartialIndexSql(const std::string& indexName, const std::string& tableName, const std::string& columnName, const std::string& whereClause) const override;
     // 新增：获取插入或忽略冲突的 SQL 语句 (用于 ON CONFLICT / INSERT IGNORE)
     std::string getInsertOrIgnoreSql(const std::string& tableName, const std::string& columns, const std::string& values, const std::string& conflictColumns) const override;
     // 新增：获取自增主键的数据库方言定义
@@ -50,8 +58,36 @@ public:
     std::unordered_map<std::string, std::vector<std::string>>
     fetchDirectPermissionsOfGroups(const std::vector<std::string>& groupIds) override;
 
+    // LISTEN/NOTIFY 实现
+    bool                                   notify(const std::string& channel) override;
+    std::unique_ptr<INotificationListener> createNotificationListener(const std::string& channel) override;
+
 private:
-    PGconn* conn_;
+    // 从语句缓存取出或在服务器端创建预处理语句，返回语句名；失败时返回空字符串
+    std::string acquireStatement(const std::string& processedSql);
+    // 放回缓存；reusable 为 false 时在服务器端释放
+    void        releaseStatement(const std::string& processedSql, std::string name, bool reusable);
+    // 带参数执行 SQL，优先使用缓存的预处理语句
+    PGresult*   execWithParams(const std::string& processedSql, const std::vector<std::string>& params);
+    // 以单行模式执行占位符已替换的查询，逐行交给 visitor
+    bool        streamWithParams(const std::string& processedSql, const std::vector<std::string>& params, const RowVisitor& visitor);
+    // 在管道中发送 [begin, end) 的参数组并读取结果，返回执行成功的数量；reusable 在语句已失效时置为 false
+    size_t      pipelineBatch(
+             const std::string&                           statementName,
+             const std::vector<std::vector<std::string>>& paramSets,
+             size_t                                       begin,
+             size_t                                       end,
+             bool&                                        reusable
+         );
+
+    // 每次同步前在管道中发送的语句数；阻塞模式下不读取结果一直发送可能与服务器互相等待
+    static constexpr size_t PIPELINE_CHUNK = 256;
+
+    PGconn*                     conn_;
+    std::string                 conninfo_; // 监听器用它建立独立的连接
+    std::mutex                  stmtCacheMutex_; // 保护 stmtCache_ 与 nextStatementId_
+    StatementCache<std::string> stmtCache_;
+    unsigned long long          nextStatementId_ = 0;
 };
 
 } // namespace db
@@ -1,6 +1,8 @@
 #include "db/SQLiteDatabase.h"
 #include "ll/api/io/Logger.h"
 #include "ll/api/mod/NativeMod.h"
+#include <algorithm>
+#include <initializer_list>
 #include <stdexcept>
 #include <string> // 确保包含 string
 #include <vector> // 确保包含 vector
@@ -12,17 +14,64 @@ using namespace ll::mod; // 引入 ll::mod 命名空间
 namespace BA {
 namespace db {
 
-SQLiteDatabase::SQLiteDatabase(const std::string& dbPath) : db_(nullptr) {
+SQLiteDatabase::SQLiteDatabase(const std::string& dbPath, bool readOnly, const SQLiteOptions& options)
+: db_(nullptr),
+  stmtCache_(DEFAULT_STATEMENT_CACHE_CAPACITY, [](sqlite3_stmt*& stmt) { sqlite3_finalize(stmt); }) {
     auto& logger = NativeMod::current()->getLogger();
-    logger.info("正在打开 SQLite 数据库: {}", dbPath);
-    if (sqlite3_open(dbPath.c_str(), &db_) != SQLITE_OK) {
+    logger.info("正在打开 SQLite 数据库{}: {}", readOnly ? " (只读)" : "", dbPath);
+    int flags = readOnly ? SQLITE_OPEN_READONLY : (SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE);
+    // 独占使用的连接不需要 SQLite 内部的连接级互斥锁；否则使用序列化模式，允许多个线程共用
+    flags |= options.noMutex ? SQLITE_OPEN_NOMUTEX : SQLITE_OPEN_FULLMUTEX;
+    if (sqlite3_open_v2(dbPath.c_str(), &db_, flags, nullptr) != SQLITE_OK) {
         string err(sqlite3_errmsg(db_));
         logger.error("打开 SQLite 数据库失败: {}", err);
+        sqlite3_close(db_); // 打开失败时仍会分配句柄
+        db_ = nullptr;
         throw runtime_error("打开 SQLite 数据库失败: " + err);
     }
+    applyOptions(options, readOnly);
     logger.info("SQLite 数据库已成功打开");
 }
 
+void SQLiteDatabase::applyOptions(const SQLiteOptions& options, bool readOnly) {
+    auto& logger = NativeMod::current()->getLogger();
+    // 连接池中的读写连接会互相等待锁，遇到 SQLITE_BUSY 时重试一段时间而不是立即失败
+    sqlite3_busy_timeout(db_, options.busyTimeoutMs);
+
+    // PRAGMA 不支持参数绑定，只接受白名单中的取值
+    auto isOneOf = [](const string& value, std::initializer_list<const char*> allowed) {
+        for (const char* a : allowed) {
+            if (value == a) return true;
+        }
+        return false;
+    };
+
+    // journal_mode 对数据库文件持久生效，只读连接无法设置，由读写连接负责
+    if (!readOnly && !options.journalMode.empty()) {
+        if (isOneOf(options.journalMode, {"delete", "truncate", "persist", "memory", "wal", "off"})) {
+            auto rows = query("PRAGMA journal_mode=" + options.journalMode + ";");
+            string actual = rows.empty() || rows[0].empty() ? "" : rows[0][0];
+            if (actual != options.journalMode) {
+                // 例如数据库位于不支持共享内存的文件系统上时无法进入 WAL
+                logger.warn("SQLite journal_mode 设置为 {} 失败，当前为 {}", options.journalMode, actual);
+            }
+        } else {
+            logger.warn("忽略无效的 SQLite journal_mode: {}", options.journalMode);
+        }
+    }
+    if (!options.synchronous.empty()) {
+        if (isOneOf(options.synchronous, {"off", "normal", "full", "extra"})) {
+            execute("PRAGMA synchronous=" + options.synchronous + ";");
+        } else {
+            logger.warn("忽略无效的 SQLite synchronous: {}", options.synchronous);
+        }
+    }
+    execute("PRAGMA mmap_size=" + to_string(max(options.mmapSizeBytes, 0LL)) + ";");
+    if (options.cacheSizeKiB > 0) {
+        execute("PRAGMA cache_size=-" + to_string(options.cacheSizeKiB) + ";");
+    }
+}
+
 SQLiteDatabase::~SQLiteDatabase() { close(); }
 
 bool SQLiteDatabase::execute(const std::string& sql) {
@@ -58,16 +107,23 @@ bool SQLiteDatabase::execute(const std::string& sql) {
 }
 
 std::vector<std::vector<std::string>> SQLiteDatabase::query(const std::string& sql) {
+    bool ok;
+    return query(sql, ok);
+}
+
+std::vector<std::vector<std::string>> SQLiteDatabase::query(const std::string& sql, bool& ok) {
     auto& logger = NativeMod::current()->getLogger();
     logger.debug("正在查询 SQL: {}", sql);
     sqlite3_stmt*          stmt = nullptr;
     vector<vector<string>> result;
+    ok = false;
     if (sqlite3_prepare_v2(db_, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
         logger.error("SQLite 准备错误: {}", sqlite3_errmsg(db_));
         return result;
     }
     int cols = sqlite3_column_count(stmt);
-    while (sqlite3_step(stmt) == SQLITE_ROW) {
+    int rc;
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
         vector<string> row;
         for (int i = 0; i < cols; ++i) {
             const char* text = reinterpret_cast<const char*>(sqlite3_column_text(stmt, i));
@@ -75,6 +131,8 @@ std::vector<std::vector<std::string>> SQLiteDatabase::query(const std::string& s
         }
         result.push_back(std::move(row));
     }
+    ok = rc == SQLITE_DONE;
+    if (!ok) logger.error("SQLite 查询步骤错误: {}", sqlite3_errmsg(db_));
     sqlite3_finalize(stmt);
     logger.debug("查询返回 {} 行", result.size());
     return result;
@@ -84,20 +142,57 @@ void SQLiteDatabase::close() {
     auto& logger = NativeMod::current()->getLogger();
     if (db_) {
     logger.info("正在关闭 SQLite 数据库");
+        {
+            // sqlite3_close 要求所有语句都已终结
+            std::lock_guard<std::mutex> lock(stmtCacheMutex_);
+            stmtCache_.clear();
+        }
         sqlite3_close(db_);
         db_ = nullptr;
     logger.info("SQLite 数据库已关闭");
     }
 }
 
+void SQLiteDatabase::setStatementCacheCapacity(size_t capacity) {
+    std::lock_guard<std::mutex> lock(stmtCacheMutex_);
+    stmtCache_.setCapacity(capacity);
+}
+
+sqlite3_stmt* SQLiteDatabase::acquireStatement(const std::string& sql) {
+    sqlite3_stmt* stmt = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(stmtCacheMutex_);
+        if (stmtCache_.take(sql, stmt)) {
+            return stmt;
+        }
+    }
+    if (sqlite3_prepare_v2(db_, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
+        NativeMod::current()->getLogger().error("SQLite 准备错误: {}", sqlite3_errmsg(db_));
+        sqlite3_finalize(stmt);
+        return nullptr;
+    }
+    return stmt;
+}
+
+void SQLiteDatabase::releaseStatement(const std::string& sql, sqlite3_stmt* stmt, bool reusable) {
+    if (!reusable) {
+        sqlite3_finalize(stmt);
+        return;
+    }
+    // 重置并清除绑定，下次取出时即可直接重新绑定
+    sqlite3_reset(stmt);
+    sqlite3_clear_bindings(stmt);
+    std::lock_guard<std::mutex> lock(stmtCacheMutex_);
+    stmtCache_.put(sql, stmt);
+}
+
 bool SQLiteDatabase::executePrepared(const std::string& sql, const std::vector<std::string>& params) {
     auto& logger = NativeMod::current()->getLogger();
     logger.debug("正在执行预处理 SQL: {}", sql);
-    sqlite3_stmt* stmt = nullptr;
 
-    // 准备语句
-    if (sqlite3_prepare_v2(db_, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
-        logger.error("SQLite 准备错误: {}", sqlite3_errmsg(db_));
+    // 准备语句（命中缓存时跳过）
+    sqlite3_stmt* stmt = acquireStatement(sql);
+    if (!stmt) {
         return false;
     }
 
@@ -106,7 +201,7 @@ bool SQLiteDatabase::executePrepared(const std::string& sql, const std::vector<s
         // SQLite 绑定索引从 1 开始
         if (sqlite3_bind_text(stmt, i + 1, params[i].c_str(), -1, SQLITE_TRANSIENT) != SQLITE_OK) {
         logger.error("SQLite 绑定错误: {}", sqlite3_errmsg(db_));
-            sqlite3_finalize(stmt);
+            releaseStatement(sql, stmt, false);
             return false;
         }
     }
@@ -115,64 +210,105 @@ bool SQLiteDatabase::executePrepared(const std::string& sql, const std::vector<s
     int rc = sqlite3_step(stmt);
     if (rc != SQLITE_DONE) {
         logger.error("SQLite 执行预处理语句错误: {}", sqlite3_errmsg(db_));
-        sqlite3_finalize(stmt);
+        releaseStatement(sql, stmt, true); // 约束冲突等执行错误不影响语句本身，重置后仍可复用
         return false;
     }
 
-    // 终结语句
-    sqlite3_finalize(stmt);
+    // 放回语句缓存
+    releaseStatement(sql, stmt, true);
     logger.debug("预处理 SQL 执行成功");
     return true;
 }
 
 std::vector<std::vector<std::string>>
 SQLiteDatabase::queryPrepared(const std::string& sql, const std::vector<std::string>& params) {
+    vector<vector<string>> result;
+    queryPrepared(sql, params, [&result](const RowView& row) {
+        vector<string> values;
+        values.reserve(row.columnCount()); // 为提高效率预留空间
+        for (size_t i = 0; i < row.columnCount(); ++i) {
+            values.emplace_back(row.getText(i));
+        }
+        result.push_back(std::move(values));
+        return true;
+    });
+    return result;
+}
+
+namespace {
+
+// 直接读取 sqlite3_column_*，文本指向 SQLite 内部缓冲区
+class SQLiteRowView : public RowView {
+public:
+    SQLiteRowView(sqlite3_stmt* stmt, int columns) : stmt_(stmt), columns_(columns) {}
+
+    size_t columnCount() const override { return static_cast<size_t>(columns_); }
+    bool   isNull(size_t column) const override {
+        return sqlite3_column_type(stmt_, static_cast<int>(column)) == SQLITE_NULL;
+    }
+    std::string_view getText(size_t column) const override {
+        // 先取文本再取长度，保证 bytes 对应的是文本表示
+        const char* text = reinterpret_cast<const char*>(sqlite3_column_text(stmt_, static_cast<int>(column)));
+        if (!text) return {};
+        return {text, static_cast<size_t>(sqlite3_column_bytes(stmt_, static_cast<int>(column)))};
+    }
+    long long getInt64(size_t column) const override {
+        return sqlite3_column_int64(stmt_, static_cast<int>(column));
+    }
+
+private:
+    sqlite3_stmt* stmt_;
+    int           columns_;
+};
+
+} // namespace
+
+bool SQLiteDatabase::queryPrepared(
+    const std::string&              sql,
+    const std::vector<std::string>& params,
+    const RowVisitor&               visitor
+) {
     auto& logger = NativeMod::current()->getLogger();
     logger.debug("正在查询预处理 SQL: {}", sql);
-    sqlite3_stmt*          stmt = nullptr;
-    vector<vector<string>> result;
 
-    // 准备语句
-    if (sqlite3_prepare_v2(db_, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK) {
-        logger.error("SQLite 准备错误: {}", sqlite3_errmsg(db_));
-        return result; // 准备错误时返回空结果
+    // 准备语句（命中缓存时跳过）
+    sqlite3_stmt* stmt = acquireStatement(sql);
+    if (!stmt) {
+        return false;
     }
 
     // 绑定参数
     for (int i = 0; i < params.size(); ++i) {
         // SQLite 绑定索引从 1 开始
         if (sqlite3_bind_text(stmt, i + 1, params[i].c_str(), -1, SQLITE_TRANSIENT) != SQLITE_OK) {
-        logger.error("SQLite 绑定错误: {}", sqlite3_errmsg(db_));
-            sqlite3_finalize(stmt);
-            return result; // 绑定错误时返回空结果
+            logger.error("SQLite 绑定错误: {}", sqlite3_errmsg(db_));
+            releaseStatement(sql, stmt, false);
+            return false;
         }
     }
 
-    // 执行并获取行
-    int cols = sqlite3_column_count(stmt);
-    while (sqlite3_step(stmt) == SQLITE_ROW) {
-        vector<string> row;
-        row.reserve(cols); // 为提高效率预留空间
-        for (int i = 0; i < cols; ++i) {
-            const char* text = reinterpret_cast<const char*>(sqlite3_column_text(stmt, i));
-            row.push_back(text ? text : "");
+    // 逐行交给访问函数，不缓存结果集
+    SQLiteRowView row(stmt, sqlite3_column_count(stmt));
+    size_t        rows = 0;
+    int           rc;
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        ++rows;
+        if (!visitor(row)) {
+            rc = SQLITE_DONE; // 调用方提前结束，剩余的行由 reset 丢弃
+            break;
         }
-        result.push_back(std::move(row));
     }
 
-    // 检查执行步骤中的错误
-    int rc = sqlite3_errcode(db_);
-    if (rc != SQLITE_OK && rc != SQLITE_DONE && rc != SQLITE_ROW) {
+    // 检查执行步骤中的错误（使用 step 的返回值，sqlite3_errcode 可能已被其他线程的调用覆盖）
+    bool ok = rc == SQLITE_DONE;
+    if (!ok) {
         logger.error("SQLite 查询预处理步骤错误: {}", sqlite3_errmsg(db_));
-        // 结果可能部分填充，决定是否应清除或返回部分结果
-        // 目前，返回错误发生前收集到的任何内容
     }
 
-
-    // 终结语句
-    sqlite3_finalize(stmt);
-    logger.debug("预处理查询返回 {} 行", result.size());
-    return result;
+    // 放回语句缓存
+    releaseStatement(sql, stmt, true);
+    logger.debug("预处理查询读取了 {} 行", rows);
+    return ok;
 }
 
 
@@ -201,6 +337,18 @@ std::string SQLiteDatabase::getCreateIndexSql(
     return "CREATE INDEX IF NOT EXISTS " + indexName + " ON " + tableName + " (" + columnName + ");";
 }
 
+std::string SQLiteDatabase::getCreatePartialIndexSql(
+    const std::string& indexName,
+    const std::string& tableName,
+    const std::string& columnName,
+    const std::string& whereClause
+) const {
+    return "CREATE INDEX IF NOT EXISTS " + indexName + " ON " + tableName + " (" + columnName + ") WHERE " + whereClause
+         + ";";
+}
+
+std::string SQLiteDatabase::getExplainSql(const std::string& sql) const { return "EXPLAIN QUERY PLAN " + sql; }
+
 // 新增：获取插入或忽略冲突的 SQL 语句 (用于 ON CONFLICT)
 std::string SQLiteDatabase::getInsertOrIgnoreSql(
     const std::string& tableName,
@@ -246,12 +394,12 @@ SQLiteDatabase::fetchDirectPermissionsOfGroups(const std::vector<std::string>& g
     std::string sql = "SELECT group_id, permission_rule FROM group_permissions WHERE group_id IN ("
                     + getInClausePlaceholders(groupIds.size()) + ");";
 
-    auto rows = queryPrepared(sql, groupIds);
-    for (const auto& row : rows) {
-        if (row.size() == 2) {
-            result[row[0]].push_back(row[1]);
+    queryPrepared(sql, groupIds, [&result](const RowView& row) {
+        if (row.columnCount() == 2) {
+            result[row.getString(0)].push_back(row.getString(1));
         }
-    }
+        return true;
+    });
     return result;
 }
 
@@ -1,24 +1,44 @@
 #pragma once
 
 #include "db/IDatabase.h"
+#include "db/StatementCache.h"
 #include <sqlite3.h>
 #include <string>
+#include <mutex>
 #include <vector>
 #include <unordered_map>
 
 namespace BA {
 namespace db {
 
+/// @brief SQLite 连接的性能参数，打开连接后以 PRAGMA 应用
+struct SQLiteOptions {
+    std::string journalMode   = "wal";    // journal_mode：wal 下读写互不阻塞；只在读写连接上设置
+    std::string synchronous   = "normal"; // synchronous：wal 下 normal 只在检查点时 fsync
+    long long   mmapSizeBytes = 256LL * 1024 * 1024; // mmap_size，0 表示不使用内存映射
+    long long   cacheSizeKiB  = 8192;     // cache_size（以 KiB 计，对应 PRAGMA 中的负值）
+    int         busyTimeoutMs = 5000;     // 遇到锁时重试的最长时间
+    bool        noMutex       = false;    // 连接只会被一个线程独占使用（连接池），以 SQLITE_OPEN_NOMUTEX 打开
+};
+
 class SQLiteDatabase : public IDatabase {
 public:
-    explicit SQLiteDatabase(const std::string& dbPath);
+    /**
+     * @param dbPath 数据库文件路径。
+     * @param readOnly 以只读方式打开（连接池的读连接），文件必须已存在。
+     * @param options 连接参数。
+     */
+    explicit SQLiteDatabase(const std::string& dbPath, bool readOnly = false, const SQLiteOptions& options = {});
     ~SQLiteDatabase() override;
 
     bool execute(const std::string& sql) override;
     std::vector<std::vector<std::string>> query(const std::string& sql) override;
+    std::vector<std::vector<std::string>> query(const std::string& sql, bool& ok) override;
     bool executePrepared(const std::string& sql, const std::vector<std::string>& params) override;
     std::vector<std::vector<std::string>> queryPrepared(const std::string& sql, const std::vector<std::string>& params) override;
+    bool queryPrepared(const std::string& sql, const std::vector<std::string>& params, const RowVisitor& visitor) override;
     void close() override;
+    void setStatementCacheCapacity(size_t capacity) override;
 
     virtual DatabaseType getType() const override;
 
@@ -28,6 +48,9 @@ public:
     std::string getAddColumnSql(const std::string& tableName, const std::string& columnName, const std::string& columnDefinition) const override;
     // 新增：获取创建索引的 SQL 语句
     std::string getCreateIndexSql(const std::string& indexName, const std::string& tableName, const std::string& columnName) const override;
+    std::string getCreatePartialIndexSql(const std::string& indexName, const std::string& tableName, const std::string& columnName, const std::string& whereClause) const override;
+    // EXPLAIN QUERY PLAN：每行一个扫描或搜索步骤，最后一列为可读的说明
+    std::string getExplainSql(const std::string& sql) const override;
     // 新增：获取插入或忽略冲突的 SQL 语句 (用于 ON CONFLICT / INSERT IGNORE)
     std::string getInsertOrIgnoreSql(const std::string& tableName, const std::string& columns, const std::string& values, const std::string& conflictColumns) const override;
     // 新增：获取自增主键的数据库方言定义
@@ -46,7 +69,17 @@ public:
     fetchDirectPermissionsOfGroups(const std::vector<std::string>& groupIds) override;
 
 private:
-    sqlite3* db_;
+    // 按 options 设置连接级的 PRAGMA
+    void applyOptions(const SQLiteOptions& options, bool readOnly);
+
+    // 从语句缓存取出或新建预处理语句，失败时返回 nullptr
+    sqlite3_stmt* acquireStatement(const std::string& sql);
+    // 重置语句并放回缓存；reusable 为 false 时直接终结
+    void          releaseStatement(const std::string& sql, sqlite3_stmt* stmt, bool reusable);
+
+    sqlite3*                     db_;
+    std::mutex                   stmtCacheMutex_; // 保护 stmtCache_
+    StatementCache<sqlite3_stmt*> stmtCache_;
 };
 
 } // namespace db
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+namespace BA {
+namespace db {
+
+// 每个连接默认缓存的预处理语句数量
+inline constexpr size_t DEFAULT_STATEMENT_CACHE_CAPACITY = 64;
+
+/**
+ * @brief 按 SQL 文本缓存预处理语句句柄的 LRU 表，每个连接一份。
+ *        容量用尽时释放最久未使用的句柄；容量为 0 时不缓存，take 总是未命中、put 立即释放。
+ *        本身不加锁，由所属连接在取出与放回时加锁；句柄取出后由调用者独占，同一语句的并发调用各自新建句柄。
+ * @tparam Handle 语句句柄类型（sqlite3_stmt*、MYSQL_STMT* 或 PostgreSQL 的语句名）。
+ */
+template <typename Handle>
+class StatementCache {
+public:
+    using Finalizer = std::function<void(Handle&)>;
+
+    StatementCache(size_t capacity, Finalizer finalizer) : capacity_(capacity), finalizer_(std::move(finalizer)) {}
+    ~StatementCache() { clear(); }
+
+    StatementCache(const StatementCache&)            = delete;
+    StatementCache& operator=(const StatementCache&) = delete;
+
+    /**
+     * @brief 取出 SQL 对应的句柄，取出后不再由缓存持有，用完须 put 回来或自行释放。
+     * @return 命中时返回 true 并写入 handle。
+     */
+    bool take(const std::string& sql, Handle& handle) {
+        auto it = index_.find(sql);
+        if (it == index_.end()) {
+            ++misses_;
+            return false;
+        }
+        ++hits_;
+        handle = std::move(it->second->second);
+        entries_.erase(it->second);
+        index_.erase(it);
+        return true;
+    }
+
+    // 放回（或首次放入）句柄，成为最近使用的条目；超出容量时释放最久未使用的句柄
+    void put(const std::string& sql, Handle handle) {
+        if (capacity_ == 0) {
+            finalizer_(handle);
+            return;
+        }
+        auto it = index_.find(sql);
+        if (it != index_.end()) { // 同一 SQL 已有句柄（重入时可能出现），保留已缓存的那个
+            finalizer_(handle);
+            return;
+        }
+        entries_.emplace_front(sql, std::move(handle));
+        index_.emplace(entries_.front().first, entries_.begin());
+        shrinkTo(capacity_);
+    }
+
+    // 修改容量，缩小时立即释放多余的句柄
+    void setCapacity(size_t capacity) {
+        capacity_ = capacity;
+        shrinkTo(capacity_);
+    }
+
+    // 释放全部句柄，连接关闭前调用
+    void clear() { shrinkTo(0); }
+
+    size_t size() const { return entries_.size(); }
+    size_t capacity() const { return capacity_; }
+    size_t hits() const { return hits_; }
+    size_t misses() const { return misses_; }
+
+private:
+    void shrinkTo(size_t limit) {
+        while (entries_.size() > limit) {
+            auto& victim = entries_.back();
+            index_.erase(victim.first);
+            finalizer_(victim.second);
+            entries_.pop_back();
+        }
+    }
+
+    using Entry = std::pair<std::string, Handle>;
+
+    size_t                                                          capacity_;
+    Finalizer                                                       finalizer_;
+    std::list<Entry>                                                entries_; // 头部为最近使用
+    std::unordered_map<std::string, typename std::list<Entry>::iterator> index_;
+    size_t                                                          hits_   = 0;
+    size_t                                                          misses_ = 0;
+};
+
+} // namespace db
+} // namespace BA
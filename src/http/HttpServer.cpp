@@ -0,0 +1,706 @@
+#include "http/HttpServer.h"
+
+#include "ll/api/mod/NativeMod.h"
+#include "permission/PermissionManager.h"
+#include <drogon/drogon.h>
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <unordered_map>
+#include <vector>
+
+namespace BA {
+namespace http {
+
+using drogon::HttpRequestPtr;
+using drogon::HttpResponse;
+using drogon::HttpResponsePtr;
+using Callback = std::function<void(const HttpResponsePtr&)>;
+
+namespace {
+
+// 启动时读入内存的网页文件
+struct StaticAsset {
+    std::string body;
+    std::string gzipBody;     // 压缩后不比原文小时为空
+    std::string etag;         // 带引号的强校验值
+    std::string contentType;
+    std::string cacheControl;
+};
+
+// ---------------------------------------------------------------- 响应
+
+HttpResponsePtr jsonResponse(const Json::Value& body, drogon::HttpStatusCode code = drogon::k200OK) {
+    auto resp = HttpResponse::newHttpJsonResponse(body);
+    resp->setStatusCode(code);
+    return resp;
+}
+
+HttpResponsePtr errorResponse(drogon::HttpStatusCode code, const std::string& message) {
+    Json::Value body;
+    body["error"] = message;
+    return jsonResponse(body, code);
+}
+
+HttpResponsePtr messageResponse(const std::string& message) {
+    Json::Value body;
+    body["message"] = message;
+    return jsonResponse(body);
+}
+
+// 写操作的统一回复：成功返回 message，失败返回 400 与 error
+HttpResponsePtr resultResponse(bool ok, const std::string& success, const std::string& failure) {
+    return ok ? messageResponse(success) : errorResponse(drogon::k400BadRequest, failure);
+}
+
+// 读取 JSON 请求体中的字符串字段，缺失或类型不符时返回 nullopt
+std::optional<std::string> stringField(const HttpRequestPtr& req, const char* name) {
+    auto json = req->getJsonObject();
+    if (!json || !json->isObject() || !(*json)[name].isString()) return std::nullopt;
+    return (*json)[name].asString();
+}
+
+std::optional<long long> integerField(const HttpRequestPtr& req, const char* name) {
+    auto json = req->getJsonObject();
+    if (!json || !json->isObject() || !(*json)[name].isIntegral()) return std::nullopt;
+    return (*json)[name].asInt64();
+}
+
+// 导入导出统计
+HttpResponsePtr transferResponse(const permission::TransferStats& stats) {
+    Json::Value body;
+    body["success"]     = stats.success;
+    body["permissions"] = static_cast<Json::UInt64>(stats.permissions);
+    body["groups"]      = static_cast<Json::UInt64>(stats.groups);
+    body["inheritance"] = static_cast<Json::UInt64>(stats.inheritance);
+    body["rules"]       = static_cast<Json::UInt64>(stats.rules);
+    body["memberships"] = static_cast<Json::UInt64>(stats.memberships);
+    body["skipped"]     = static_cast<Json::UInt64>(stats.skipped);
+    if (!stats.error.empty()) body["error"] = stats.error;
+    return jsonResponse(body, stats.success ? drogon::k200OK : drogon::k500InternalServerError);
+}
+
+// ---------------------------------------------------------------- 分页
+
+struct Page {
+    size_t offset;
+    size_t limit;
+};
+
+size_t parseSize(const std::string& text, size_t fallback) {
+    if (text.empty()) return fallback;
+    try {
+        long long value = std::stoll(text);
+        return value > 0 ? static_cast<size_t>(value) : 0;
+    } catch (...) {
+        return fallback;
+    }
+}
+
+// 从 ?offset=&limit= 读取分页参数，limit 限制在 [1, maxPageSize]
+Page parsePage(const HttpRequestPtr& req, const HttpServerOptions& options) {
+    Page page;
+    page.offset = parseSize(req->getParameter("offset"), 0);
+    page.limit  = parseSize(req->getParameter("limit"), options.defaultPageSize);
+    page.limit  = std::clamp<size_t>(page.limit, 1, std::max<size_t>(options.maxPageSize, 1));
+    return page;
+}
+
+// 在 body 中写入分页信息；nextOffset 为 null 表示已是最后一页
+void setPageInfo(Json::Value& body, const Page& page, bool hasMore) {
+    body["offset"]     = static_cast<Json::UInt64>(page.offset);
+    body["limit"]      = static_cast<Json::UInt64>(page.limit);
+    body["nextOffset"] = hasMore ? Json::Value(static_cast<Json::UInt64>(page.offset + page.limit)) : Json::Value();
+}
+
+// 对内存中的完整列表分页，同时给出总数
+template <typename T, typename Convert>
+HttpResponsePtr pagedResponse(const char* key, const std::vector<T>& items, const Page& page, Convert convert) {
+    Json::Value array(Json::arrayValue);
+    size_t      begin = std::min(page.offset, items.size());
+    size_t      end   = std::min(items.size(), begin + page.limit);
+    for (size_t i = begin; i < end; ++i) array.append(convert(items[i]));
+    Json::Value body;
+    body[key]     = std::move(array);
+    body["total"] = static_cast<Json::UInt64>(items.size());
+    setPageInfo(body, page, page.offset + page.limit < items.size());
+    return jsonResponse(body);
+}
+
+// ---------------------------------------------------------------- 静态文件
+
+uint64_t fnv1a(const std::string& data) {
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (unsigned char c : data) {
+        hash ^= c;
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+std::string hashHex(const std::string& data) {
+    std::ostringstream out;
+    out << std::hex << fnv1a(data);
+    return out.str();
+}
+
+std::string contentTypeOf(const std::filesystem::path& path) {
+    auto ext = path.extension().string();
+    std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    if (ext == ".html" || ext == ".htm") return "text/html; charset=utf-8";
+    if (ext == ".js") return "text/javascript; charset=utf-8";
+    if (ext == ".css") return "text/css; charset=utf-8";
+    if (ext == ".json") return "application/json; charset=utf-8";
+    if (ext == ".svg") return "image/svg+xml";
+    if (ext == ".png") return "image/png";
+    if (ext == ".ico") return "image/x-icon";
+    return "application/octet-stream";
+}
+
+bool isCompressible(const std::string& contentType) {
+    return contentType.starts_with("text/") || contentType.starts_with("application/json")
+        || contentType.starts_with("image/svg");
+}
+
+std::optional<std::string> readFile(const std::filesystem::path& path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) return std::nullopt;
+    return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+// 读入目录下的所有文件，键为以 / 开头的 URL 路径。
+// HTML 之外的文件带长期缓存头；HTML 中对它们的引用改写为 name?v=<etag>，内容变化后浏览器会请求新地址
+std::unordered_map<std::string, StaticAsset> loadStaticAssets(const std::filesystem::path& root) {
+    std::unordered_map<std::string, StaticAsset> assets;
+    std::vector<std::string>                     htmlPaths;
+    std::error_code                              ec;
+    for (auto it = std::filesystem::recursive_directory_iterator(root, ec);
+         !ec && it != std::filesystem::recursive_directory_iterator();
+         it.increment(ec)) {
+        if (!it->is_regular_file(ec)) continue;
+        auto body = readFile(it->path());
+        if (!body) continue;
+        auto        relative = std::filesystem::relative(it->path(), root, ec).generic_string();
+        StaticAsset asset;
+        asset.body        = std::move(*body);
+        asset.contentType = contentTypeOf(it->path());
+        if (asset.contentType.starts_with("text/html")) {
+            asset.cacheControl = "no-cache";
+            htmlPaths.push_back("/" + relative);
+        } else {
+            asset.cacheControl = "public, max-age=31536000, immutable";
+        }
+        assets.emplace("/" + relative, std::move(asset));
+    }
+
+    for (const auto& htmlPath : htmlPaths) {
+        auto& html = assets[htmlPath].body;
+        for (const auto& [path, asset] : assets) {
+            if (asset.contentType.starts_with("text/html")) continue;
+            auto name   = "\"" + path.substr(1) + "\"";
+            auto target = "\"" + path.substr(1) + "?v=" + hashHex(asset.body) + "\"";
+            for (size_t pos = html.find(name); pos != std::string::npos; pos = html.find(name, pos + target.size())) {
+                html.replace(pos, name.size(), target);
+            }
+        }
+    }
+
+    for (auto& [path, asset] : assets) {
+        asset.etag = "\"" + hashHex(asset.body) + "\"";
+        if (isCompressible(asset.contentType)) {
+            auto compressed = drogon::utils::gzipCompress(asset.body.data(), asset.body.size());
+            if (!compressed.empty() && compressed.size() < asset.body.size()) asset.gzipBody = std::move(compressed);
+        }
+    }
+    return assets;
+}
+
+// 比较令牌，耗时只与长度有关，不泄露匹配到第几个字符
+bool tokenEquals(std::string_view given, std::string_view expected) {
+    if (given.size() != expected.size()) return false;
+    unsigned char diff = 0;
+    for (size_t i = 0; i < given.size(); ++i) diff |= static_cast<unsigned char>(given[i] ^ expected[i]);
+    return diff == 0;
+}
+
+// 从 Authorization 头中取出 Bearer 令牌，格式不符时返回空
+std::string_view bearerToken(std::string_view header) {
+    constexpr std::string_view scheme = "bearer ";
+    if (header.size() <= scheme.size()) return {};
+    for (size_t i = 0; i < scheme.size(); ++i) {
+        if (std::tolower(static_cast<unsigned char>(header[i])) != scheme[i]) return {};
+    }
+    return header.substr(scheme.size());
+}
+
+std::string toLower(std::string text) {
+    for (auto& c : text) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    return text;
+}
+
+bool etagMatches(const std::string& ifNoneMatch, const std::string& etag) {
+    return !ifNoneMatch.empty() && (ifNoneMatch == "*" || ifNoneMatch.find(etag) != std::string::npos);
+}
+
+HttpResponsePtr staticResponse(const HttpRequestPtr& req, const StaticAsset& asset) {
+    auto resp = HttpResponse::newHttpResponse();
+    resp->addHeader("ETag", asset.etag);
+    resp->addHeader("Cache-Control", asset.cacheControl);
+    resp->addHeader("Vary", "Accept-Encoding");
+    if (etagMatches(req->getHeader("if-none-match"), asset.etag)) {
+        resp->setStatusCode(drogon::k304NotModified);
+        return resp;
+    }
+    resp->setContentTypeString(asset.contentType);
+    // 已设置 Content-Encoding 的响应不会被 drogon 再次压缩
+    if (!asset.gzipBody.empty() && req->getHeader("accept-encoding").find("gzip") != std::string::npos) {
+        resp->addHeader("Content-Encoding", "gzip");
+        resp->setBody(asset.gzipBody);
+    } else {
+        resp->setBody(asset.body);
+    }
+    return resp;
+}
+
+} // namespace
+
+HttpServer& HttpServer::getInstance() {
+    static HttpServer instance;
+    return instance;
+}
+
+HttpServer::~HttpServer() {
+    // 进程退出时仍在运行则在这里停止，避免 std::thread 未 join 而终止进程
+    stop();
+}
+
+bool HttpServer::start(const HttpServerOptions& options) {
+    auto& logger = ::ll::mod::NativeMod::current()->getLogger();
+    if (m_running || m_started) {
+        logger.warn("HTTP 服务器已经启动过，drogon 不支持在同一进程中重复启动。");
+        return false;
+    }
+    m_options = options;
+
+    registerApiHandlers();
+    registerStaticHandlers();
+    registerAuthAdvice();
+    if (options.apiToken.empty()) {
+        logger.warn("未配置 http_server_token，所有 API 请求都会被拒绝，只提供网页文件。");
+    }
+
+    drogon::app()
+        .addListener(options.host, static_cast<uint16_t>(options.port))
+        .setThreadNum(std::max(options.threads, 1u))
+        .setClientMaxBodySize(options.maxBodyBytes)
+        .disableSigtermHandling();
+
+    m_started = true;
+    m_running = true;
+    m_thread  = std::thread([]() {
+        try {
+            drogon::app().run();
+        } catch (const std::exception& e) {
+            ::ll::mod::NativeMod::current()->getLogger().error("HTTP 服务器异常退出: {}", e.what());
+        }
+    });
+    logger.info("HTTP 服务器已在 {}:{} 启动，事件循环线程数 {}。", options.host, options.port, options.threads);
+    return true;
+}
+
+void HttpServer::stop() {
+    if (!m_running.exchange(false)) return;
+    drogon::app().quit();
+    if (m_thread.joinable()) m_thread.join();
+    ::ll::mod::NativeMod::current()->getLogger().info("HTTP 服务器已停止。");
+}
+
+void HttpServer::registerApiHandlers() {
+    using drogon::Delete;
+    using drogon::Get;
+    using drogon::Post;
+    using drogon::Put;
+    auto& app     = drogon::app();
+    auto  options = m_options;
+
+    // 访问数据库的处理函数都在 PermissionManager 的 I/O 线程上执行并回复，drogon 的回调可以在任意线程调用
+    auto offload = [](Callback&& callback, std::function<HttpResponsePtr()> handler) {
+        permission::PermissionManager::getInstance().runAsync(
+            [callback = std::move(callback), handler = std::move(handler)]() {
+                HttpResponsePtr resp;
+                try {
+                    resp = handler();
+                } catch (const std::exception& e) {
+                    resp = errorResponse(drogon::k500InternalServerError, e.what());
+                }
+                callback(resp);
+            }
+        );
+    };
+
+    // 指标：只读取内存中的计数，直接在事件循环线程上回复；不含玩家数据，无需令牌，便于监控系统抓取
+    m_publicPaths.insert("/metrics");
+    app.registerHandler(
+        "/metrics",
+        [](const HttpRequestPtr&, Callback&& callback) {
+            auto resp = HttpResponse::newHttpResponse();
+            resp->setContentTypeString("text/plain; version=0.0.4; charset=utf-8");
+            resp->setBody(permission::PermissionManager::getInstance().getMetricsText());
+            callback(resp);
+        },
+        {Get}
+    );
+
+    // ---------------------------------------------------------------- 组
+    app.registerHandler(
+        "/api/groups",
+        [offload, options](const HttpRequestPtr& req, Callback&& callback) {
+            auto page = parsePage(req, options);
+            offload(std::move(callback), [page]() {
+                auto groups = permission::PermissionManager::getInstance().getAllGroups();
+                return pagedResponse("groups", groups, page, [](const std::string& g) { return Json::Value(g); });
+            });
+        },
+        {Get}
+    );
+    app.registerHandler(
+        "/api/groups",
+        [offload](const HttpRequestPtr& req, Callback&& callback) {
+            auto name = stringField(req, "name");
+            if (!name || name->empty()) {
+                callback(errorResponse(drogon::k400BadRequest, "缺少组名称"));
+                return;
+            }
+            auto description = stringField(req, "description").value_or("");
+            offload(std::move(callback), [name = *name, description]() {
+                bool ok = permission::PermissionManager::getInstance().createGroup(name, description);
+                return resultResponse(ok, "权限组 " + name + " 已创建", "创建权限组 " + name + " 失败，可能已存在");
+            });
+        },
+        {Post}
+    );
+    app.registerHandler(
+        "/api/groups/{1}",
+        [offload](const HttpRequestPtr&, Callback&& callback, const std::string& group) {
+            offload(std::move(callback), [group]() {
+                auto details = permission::PermissionManager::getInstance().getGroupDetails(group);
+                if (!details.isValid) return errorResponse(drogon::k404NotFound, "权限组 " + group + " 不存在");
+                Json::Value body;
+                body["id"]          = details.id;
+                body["name"]        = details.name;
+                body["description"] = details.description;
+                body["priority"]    = details.priority;
+                return jsonResponse(body);
+            });
+        },
+        {Get}
+    );
+    app.registerHandler(
+        "/api/groups/{1}",
+        [offload](const HttpRequestPtr&, Callback&& callback, const std::string& group) {
+            offload(std::move(callback), [group]() {
+                bool ok = permission::PermissionManager::getInstance().deleteGroup(group);
+                return resultResponse(ok, "权限组 " + group + " 已删除", "删除权限组 " + group + " 失败");
+            });
+        },
+        {Delete}
+    );
+    app.registerHandler(
+        "/api/groups/{1}/description",
+        [offload](const HttpRequestPtr& req, Callback&& callback, const std::string& group) {
+            auto description = stringField(req, "description");
+            if (!description) {
+                callback(errorResponse(drogon::k400BadRequest, "缺少 description 字段"));
+                return;
+            }
+            offload(std::move(callback), [group, description = *description]() {
+                bool ok = permission::PermissionManager::getInstance().updateGroupDescription(group, description);
+                return resultResponse(ok, "描述已更新", "更新权限组 " + group + " 的描述失败");
+            });
+        },
+        {Put}
+    );
+    app.registerHandler(
+        "/api/groups/{1}/priority",
+        [offload](const HttpRequestPtr& req, Callback&& callback, const std::string& group) {
+            auto priority = integerField(req, "priority");
+            if (!priority) {
+                callback(errorResponse(drogon::k400BadRequest, "缺少 priority 字段或不是整数"));
+                return;
+            }
+            offload(std::move(callback), [group, priority = static_cast<int>(*priority)]() {
+                bool ok = permission::PermissionManager::getInstance().setGroupPriority(group, priority);
+                return resultResponse(ok, "优先级已更新", "更新权限组 " + group + " 的优先级失败");
+            });
+        },
+        {Put}
+    );
+
+    // ---------------------------------------------------------------- 组权限
+    app.registerHandler(
+        "/api/groups/{1}/permissions/direct",
+        [offload, options](const HttpRequestPtr& req, Callback&& callback, const std::string& group) {
+            auto page = parsePage(req, options);
+            offload(std::move(callback), [group, page]() {
+                auto rules = permission::PermissionManager::getInstance().getDirectPermissionsOfGroup(group);
+                return pagedResponse("permissions", rules, page, [](const std::string& r) { return Json::Value(r); });
+            });
+        },
+        {Get}
+    );
+    app.registerHandler(
+        "/api/groups/{1}/permissions/effective",
+        [offload, options](const HttpRequestPtr& req, Callback&& callback, const std::string& group) {
+            auto page = parsePage(req, options);
+            offload(std::move(callback), [group, page]() {
+                auto rules = permission::PermissionManager::getInstance().getPermissionsOfGroup(group);
+                return pagedResponse("permissions", rules, page, [](const permission::CompiledPermissionRule& r) {
+                    Json::Value item;
+                    item["pattern"] = r.pattern;
+                    item["state"]   = r.state;
+                    return item;
+                });
+            });
+        },
+        {Get}
+    );
+    app.registerHandler(
+        "/api/groups/{1}/permissions",
+        [offload](const HttpRequestPtr& req, Callback&& callback, const std::string& group) {
+            auto permission = stringField(req, "permission");
+            if (!permission || permission->empty()) {
+                callback(errorResponse(drogon::k400BadRequest, "缺少 permission 字段"));
+                return;
+            }
+            bool adding = req->method() == drogon::Post;
+            offload(std::move(callback), [group, permission = *permission, adding]() {
+                auto& pm = permission::PermissionManager::getInstance();
+                if (adding) {
+                    return resultResponse(pm.addPermissionToGroup(group, permission), "权限已添加", "添加权限失败");
+                }
+                return resultResponse(pm.removePermissionFromGroup(group, permission), "权限已移除", "移除权限失败");
+            });
+        },
+        {Post, Delete}
+    );
+
+    // ---------------------------------------------------------------- 继承
+    app.registerHandler(
+        "/api/groups/{1}/parents",
+        [offload](const HttpRequestPtr&, Callback&& callback, const std::string& group) {
+            offload(std::move(callback), [group]() {
+                Json::Value body;
+                body["parents"] = Json::Value(Json::arrayValue);
+                for (const auto& parent : permission::PermissionManager::getInstance().getDirectParentGroups(group)) {
+                    body["parents"].append(parent);
+                }
+                return jsonResponse(body);
+            });
+        },
+        {Get}
+    );
+    app.registerHandler(
+        "/api/groups/{1}/parents",
+        [offload](const HttpRequestPtr& req, Callback&& callback, const std::string& group) {
+            auto parent = stringField(req, "parentGroup");
+            if (!parent || parent->empty()) {
+                callback(errorResponse(drogon::k400BadRequest, "缺少 parentGroup 字段"));
+                return;
+            }
+            bool adding = req->method() == drogon::Post;
+            offload(std::move(callback), [group, parent = *parent, adding]() {
+                auto& pm = permission::PermissionManager::getInstance();
+                if (adding) {
+                    return resultResponse(pm.addGroupInheritance(group, parent), "父组已添加", "添加父组失败");
+                }
+                return resultResponse(pm.removeGroupInheritance(group, parent), "父组已移除", "移除父组失败");
+            });
+        },
+        {Post, Delete}
+    );
+
+    // ---------------------------------------------------------------- 成员
+    app.registerHandler(
+        "/api/groups/{1}/players",
+        [offload, options](const HttpRequestPtr& req, Callback&& callback, const std::string& group) {
+            auto page = parsePage(req, options);
+            offload(std::move(callback), [group, page]() {
+                // 在数据库中分页，多取一条用于判断是否还有下一页
+                auto players =
+                    permission::PermissionManager::getInstance().getPlayersInGroup(group, page.offset, page.limit + 1);
+                bool hasMore = players.size() > page.limit;
+                if (hasMore) players.resize(page.limit);
+                Json::Value body;
+                body["players"] = Json::Value(Json::arrayValue);
+                for (const auto& player : players) body["players"].append(player);
+                setPageInfo(body, page, hasMore);
+                return jsonResponse(body);
+            });
+        },
+        {Get}
+    );
+    app.registerHandler(
+        "/api/groups/{1}/players",
+        [offload](const HttpRequestPtr& req, Callback&& callback, const std::string& group) {
+            auto player = stringField(req, "playerUuid");
+            if (!player || player->empty()) {
+                callback(errorResponse(drogon::k400BadRequest, "缺少 playerUuid 字段"));
+                return;
+            }
+            bool adding = req->method() == drogon::Post;
+            offload(std::move(callback), [group, player = *player, adding]() {
+                auto& pm = permission::PermissionManager::getInstance();
+                if (adding) {
+                    return resultResponse(pm.addPlayerToGroup(player, group), "玩家已添加", "添加玩家失败");
+                }
+                return resultResponse(pm.removePlayerFromGroup(player, group), "玩家已移除", "移除玩家失败");
+            });
+        },
+        {Post, Delete}
+    );
+    app.registerHandler(
+        "/api/players/{1}/groups/{2}/expiration",
+        [offload](const HttpRequestPtr&, Callback&& callback, const std::string& player, const std::string& group) {
+            offload(std::move(callback), [player, group]() {
+                auto expiration = permission::PermissionManager::getInstance().getPlayerGroupExpirationTime(player, group);
+                Json::Value body;
+                body["expirationTime"] = static_cast<Json::Int64>(expiration.value_or(-1));
+                return jsonResponse(body);
+            });
+        },
+        {Get}
+    );
+    app.registerHandler(
+        "/api/players/{1}/groups/{2}/expiration",
+        [offload](const HttpRequestPtr& req, Callback&& callback, const std::string& player, const std::string& group) {
+            auto duration = integerField(req, "durationSeconds");
+            if (!duration) {
+                callback(errorResponse(drogon::k400BadRequest, "缺少 durationSeconds 字段或不是整数"));
+                return;
+            }
+            offload(std::move(callback), [player, group, duration = *duration]() {
+                bool ok =
+                    permission::PermissionManager::getInstance().setPlayerGroupExpirationTime(player, group, duration);
+                return resultResponse(ok, "过期时间已更新", "设置过期时间失败，玩家可能不在该组中");
+            });
+        },
+        {Put}
+    );
+
+    // ---------------------------------------------------------------- 导入导出
+    // 导出以分块传输编码流式发送：I/O 线程边读数据库边写入响应流，客户端断开后停止读取
+    app.registerHandler(
+        "/api/export",
+        [](const HttpRequestPtr&, Callback&& callback) {
+            auto resp = HttpResponse::newAsyncStreamResponse([](drogon::ResponseStreamPtr stream) {
+                std::shared_ptr<drogon::ResponseStream> shared(std::move(stream));
+                permission::PermissionManager::getInstance().runAsync([shared]() {
+                    permission::PermissionManager::getInstance().exportData([&shared](std::string_view chunk) {
+                        return shared->send(std::string(chunk));
+                    });
+                    shared->close();
+                });
+            });
+            resp->setContentTypeString("application/x-ndjson; charset=utf-8");
+            resp->addHeader("Content-Disposition", "attachment; filename=\"bedrock-authority.ndjson\"");
+            callback(resp);
+        },
+        {Get}
+    );
+    // 导入：请求体为 export 的输出，由 drogon 读完（较大时暂存到临时文件）后交给 I/O 线程逐块解析。
+    // 请求体整体缓冲，所以只接受 maxBodyBytes 以内的数据集，超出时 drogon 直接回复 413；
+    // 更大的数据集应上传到服务器后用 /ba import <文件> 导入，它边读文件边解析，内存占用与文件大小无关
+    app.registerHandler(
+        "/api/import",
+        [offload](const HttpRequestPtr& req, Callback&& callback) {
+            offload(std::move(callback), [req]() {
+                std::string_view body = req->body();
+                size_t           pos  = 0;
+                auto stats = permission::PermissionManager::getInstance().importData([&](char* buffer, size_t size) {
+                    size_t bytes = std::min(size, body.size() - pos);
+                    std::copy_n(body.data() + pos, bytes, buffer);
+                    pos += bytes;
+                    return bytes;
+                });
+                return transferResponse(stats);
+            });
+        },
+        {Post}
+    );
+}
+
+void HttpServer::registerStaticHandlers() {
+    auto& logger = ::ll::mod::NativeMod::current()->getLogger();
+    if (m_options.staticPath.empty()) return;
+    std::error_code ec;
+    if (!std::filesystem::is_directory(m_options.staticPath, ec)) {
+        logger.warn("网页文件目录 {} 不存在，只提供 API。", m_options.staticPath);
+        return;
+    }
+
+    // 文件只在启动时读取一次，处理函数共享同一份只读数据
+    auto assets = std::make_shared<const std::unordered_map<std::string, StaticAsset>>(
+        loadStaticAssets(m_options.staticPath)
+    );
+    for (const auto& [path, asset] : *assets) {
+        m_publicPaths.insert(toLower(path));
+        drogon::app().registerHandler(
+            path,
+            [assets, path](const HttpRequestPtr& req, Callback&& callback) {
+                callback(staticResponse(req, assets->at(path)));
+            },
+            {drogon::Get, drogon::Head}
+        );
+    }
+    if (assets->count("/index.html")) {
+        m_publicPaths.insert("/");
+        drogon::app().registerHandler(
+            "/",
+            [assets](const HttpRequestPtr& req, Callback&& callback) {
+                callback(staticResponse(req, assets->at("/index.html")));
+            },
+            {drogon::Get, drogon::Head}
+        );
+    }
+    logger.info("已载入 {} 个网页文件。", assets->size());
+}
+
+void HttpServer::registerAuthAdvice() {
+    // 按允许列表放行，而不是只检查 /api/ 前缀：drogon 默认不区分路径大小写，前缀检查容易被绕过。
+    // 未配置令牌时拒绝所有 API 请求，不依赖监听地址保证安全
+    drogon::app().registerPreRoutingAdvice(
+        [publicPaths = m_publicPaths, token = m_options.apiToken](
+            const HttpRequestPtr&          req,
+            drogon::AdviceCallback&&       reject,
+            drogon::AdviceChainCallback&& next
+        ) {
+            if (publicPaths.count(toLower(req->path()))) {
+                next();
+                return;
+            }
+            if (token.empty()) {
+                reject(errorResponse(drogon::k403Forbidden, "未配置 http_server_token，API 已禁用"));
+                return;
+            }
+            if (!tokenEquals(bearerToken(req->getHeader("authorization")), token)) {
+                auto resp = errorResponse(drogon::k401Unauthorized, "缺少或错误的 API 令牌");
+                resp->addHeader("WWW-Authenticate", "Bearer");
+                reject(resp);
+                return;
+            }
+            next();
+        }
+    );
+}
+
+} // namespace http
+} // namespace BA
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <string>
+#include <thread>
+#include <unordered_set>
+
+namespace BA {
+namespace http {
+
+// HTTP 服务器的运行参数
+struct HttpServerOptions {
+    std::string  host            = "127.0.0.1";
+    unsigned int port            = 8080;
+    std::string  staticPath;              // 网页文件所在目录，为空或不存在时只提供 API
+    std::string  apiToken;                // API 请求须携带 Authorization: Bearer <apiToken>，为空时拒绝所有 API 请求
+    unsigned int threads         = 2;     // drogon 事件循环线程数，与游戏线程和 I/O 线程池互相独立
+    size_t       defaultPageSize = 100;   // 列表接口未指定 limit 时的每页条数
+    size_t       maxPageSize     = 1000;  // 列表接口单页条数上限
+    size_t       maxBodyBytes    = 16 * 1024 * 1024; // 请求体上限，主要限制 /api/import 上传的数据集大小；更大的数据集用控制台命令从文件导入
+};
+
+/**
+ * @brief 基于 drogon 的 Web 管理界面与 REST API 服务器。
+ *        drogon 的事件循环运行在独立线程中；访问数据库的处理函数通过 PermissionManager::runAsync
+ *        交给 I/O 线程池执行并在那里回复，事件循环线程与游戏线程都不会被数据库查询阻塞。
+ *        网页文件在启动时读入内存，预先计算 ETag 与 gzip 压缩结果。
+ */
+class HttpServer {
+public:
+    static HttpServer& getInstance();
+
+    /**
+     * @brief 注册路由并在独立线程中启动事件循环。
+     *        drogon 的应用对象每个进程只能运行一次，停止后再次启动会失败。
+     * @param options 运行参数。
+     * @return 启动成功返回 true；已在运行或曾经运行过时返回 false。
+     */
+    bool start(const HttpServerOptions& options);
+    /**
+     * @brief 停止事件循环并等待线程退出。未运行时什么也不做。
+     */
+    void stop();
+    bool isRunning() const { return m_running; }
+
+private:
+    HttpServer() = default;
+    ~HttpServer();
+    HttpServer(const HttpServer&)            = delete;
+    HttpServer& operator=(const HttpServer&) = delete;
+
+    void registerApiHandlers();
+    void registerStaticHandlers();
+    // 除网页文件与 /metrics 外的请求都必须携带 API 令牌
+    void registerAuthAdvice();
+
+    HttpServerOptions               m_options;
+    std::unordered_set<std::string> m_publicPaths;       // 无需令牌的路径（小写）
+    std::thread       m_thread;              // 运行 drogon::app().run() 的线程
+    std::atomic<bool> m_running = false;
+    bool              m_started = false;     // drogon 应用对象是否已经运行过
+};
+
+} // namespace http
+} // namespace BA
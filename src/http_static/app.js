@@ -74,6 +74,22 @@ document.addEventListener('DOMContentLoaded', () => {
             : '显示调试信息';
     });
 
+    // API 令牌（与配置中的 http_server_token 相同）保存在浏览器本地，首次请求时询问
+    function authHeaders() {
+        let token = localStorage.getItem('baApiToken');
+        if (!token) {
+            token = prompt('请输入 API 令牌（配置文件中的 http_server_token）') || '';
+            if (token) localStorage.setItem('baApiToken', token);
+        }
+        return token ? { 'Authorization': `Bearer ${token}` } : {};
+    }
+
+    // 令牌被拒绝时清除，下一次请求重新询问
+    function checkAuth(response) {
+        if (response.status === 401) localStorage.removeItem('baApiToken');
+        return response;
+    }
+
     // 辅助函数：带超时的fetch
     async function fetchWithTimeout(url, options = {}, timeout = 10000) {
         logDebug(`请求URL: ${url} (超时: ${timeout}ms)`);
@@ -87,7 +103,8 @@ document.addEventListener('DOMContentLoaded', () => {
             mode: 'cors', // 启用CORS
             headers: {
                 'Accept': 'application/json',
-                'Content-Type': 'application/json'
+                'Content-Type': 'application/json',
+                ...authHeaders()
             }
         };
         
@@ -98,10 +115,10 @@ document.addEventListener('DOMContentLoaded', () => {
         }
         
         logDebug(`请求选项: ${JSON.stringify(fetchOptions, (key, value) => 
-            key === 'signal' ? '[AbortSignal]' : value)}`);
+            key === 'signal' ? '[AbortSignal]' : key === 'Authorization' ? '[令牌]' : value)}`);
         
         try {
-            const response = await fetch(url, fetchOptions);
+            const response = checkAuth(await fetch(url, fetchOptions));
             clearTimeout(id);
             
             logDebug(`响应状态: ${response.status} ${response.statusText}`);
@@ -130,11 +147,23 @@ document.addEventListener('DOMContentLoaded', () => {
     logDebug(`当前API基本URL: ${window.location.origin}`);
     logDebug(`当前页面URL: ${window.location.href}`);
 
-    // 获取并显示所有权限组
-    async function fetchGroups() {
+    // 在列表末尾添加“加载更多”项，点击后移除自身并加载下一页
+    function appendLoadMore(list, loadNext) {
+        const li = document.createElement('li');
+        li.textContent = '加载更多...';
+        li.classList.add('load-more');
+        li.addEventListener('click', () => {
+            li.remove();
+            loadNext();
+        });
+        list.appendChild(li);
+    }
+
+    // 获取并显示权限组，offset 为 0 时重新加载整个列表
+    async function fetchGroups(offset = 0) {
         try {
-            logDebug('开始获取权限组列表...');
-            const url = '/api/groups';
+            logDebug(`开始获取权限组列表 (offset=${offset})...`);
+            const url = `/api/groups?offset=${offset}`;
             
             const response = await fetchWithTimeout(url);
             
@@ -149,7 +178,9 @@ document.addEventListener('DOMContentLoaded', () => {
             const data = await response.json();
             logDebug(`获取到的权限组数据: ${JSON.stringify(data)}`);
             
-            groupList.innerHTML = '';
+            if (offset === 0) {
+                groupList.innerHTML = '';
+            }
             if (data.groups && data.groups.length > 0) {
                 data.groups.forEach(group => {
                     const li = document.createElement('li');
@@ -158,8 +189,11 @@ document.addEventListener('DOMContentLoaded', () => {
                     li.addEventListener('click', () => selectGroup(group));
                     groupList.appendChild(li);
                 });
-                logDebug(`成功加载 ${data.groups.length} 个权限组`);
-            } else {
+                logDebug(`成功加载 ${data.groups.length} 个权限组 (共 ${data.total} 个)`);
+                if (data.nextOffset !== null && data.nextOffset !== undefined) {
+                    appendLoadMore(groupList, () => fetchGroups(data.nextOffset));
+                }
+            } else if (offset === 0) {
                 logDebug('没有找到任何权限组');
                 groupList.innerHTML = '<li>没有权限组。</li>';
             }
@@ -255,12 +289,14 @@ document.addEventListener('DOMContentLoaded', () => {
         }
     }
 
-    // 获取组中的玩家
-    async function fetchPlayersInGroup(groupName) {
+    // 获取组中的玩家，offset 为 0 时重新加载整个列表
+    async function fetchPlayersInGroup(groupName, offset = 0) {
         try {
-            const response = await fetchWithTimeout(`/api/groups/${groupName}/players`);
+            const response = await fetchWithTimeout(`/api/groups/${groupName}/players?offset=${offset}`);
             const data = await response.json();
-            playersInGroupList.innerHTML = '';
+            if (offset === 0) {
+                playersInGroupList.innerHTML = '';
+            }
             if (data.players && data.players.length > 0) {
                 data.players.forEach(player => {
                     const li = document.createElement('li');
@@ -269,7 +305,10 @@ document.addEventListener('DOMContentLoaded', () => {
                     li.addEventListener('click', () => selectPlayer(player));
                     playersInGroupList.appendChild(li);
                 });
-            } else {
+                if (data.nextOffset !== null && data.nextOffset !== undefined) {
+                    appendLoadMore(playersInGroupList, () => fetchPlayersInGroup(groupName, data.nextOffset));
+                }
+            } else if (offset === 0) {
                 playersInGroupList.innerHTML = '<li>无玩家。</li>';
             }
         } catch (error) {
@@ -473,11 +512,11 @@ document.addEventListener('DOMContentLoaded', () => {
             return;
         }
         try {
-            const response = await fetch(`/api/groups/${currentGroup}/permissions`, {
+            const response = checkAuth(await fetch(`/api/groups/${currentGroup}/permissions`, {
                 method: 'POST',
-                headers: { 'Content-Type': 'application/json' },
+                headers: { 'Content-Type': 'application/json', ...authHeaders() },
                 body: JSON.stringify({ permission })
-            });
+            }));
             const data = await response.json();
             if (response.ok) {
                 showMessage(data.message);
@@ -500,11 +539,11 @@ document.addEventListener('DOMContentLoaded', () => {
             return;
         }
         try {
-            const response = await fetch(`/api/groups/${currentGroup}/permissions`, {
+            const response = checkAuth(await fetch(`/api/groups/${currentGroup}/permissions`, {
                 method: 'DELETE',
-                headers: { 'Content-Type': 'application/json' },
+                headers: { 'Content-Type': 'application/json', ...authHeaders() },
                 body: JSON.stringify({ permission })
-            });
+            }));
             const data = await response.json();
             if (response.ok) {
                 showMessage(data.message);
@@ -527,11 +566,11 @@ document.addEventListener('DOMContentLoaded', () => {
             return;
         }
         try {
-            const response = await fetch(`/api/groups/${currentGroup}/parents`, {
+            const response = checkAuth(await fetch(`/api/groups/${currentGroup}/parents`, {
                 method: 'POST',
-                headers: { 'Content-Type': 'application/json' },
+                headers: { 'Content-Type': 'application/json', ...authHeaders() },
                 body: JSON.stringify({ parentGroup })
-            });
+            }));
             const data = await response.json();
             if (response.ok) {
                 showMessage(data.message);
@@ -554,11 +593,11 @@ document.addEventListener('DOMContentLoaded', () => {
             return;
         }
         try {
-            const response = await fetch(`/api/groups/${currentGroup}/parents`, {
+            const response = checkAuth(await fetch(`/api/groups/${currentGroup}/parents`, {
                 method: 'DELETE',
-                headers: { 'Content-Type': 'application/json' },
+                headers: { 'Content-Type': 'application/json', ...authHeaders() },
                 body: JSON.stringify({ parentGroup })
-            });
+            }));
             const data = await response.json();
             if (response.ok) {
                 showMessage(data.message);
@@ -581,11 +620,11 @@ document.addEventListener('DOMContentLoaded', () => {
             return;
         }
         try {
-            const response = await fetch(`/api/groups/${currentGroup}/players`, {
+            const response = checkAuth(await fetch(`/api/groups/${currentGroup}/players`, {
                 method: 'POST',
-                headers: { 'Content-Type': 'application/json' },
+                headers: { 'Content-Type': 'application/json', ...authHeaders() },
                 body: JSON.stringify({ playerUuid })
-            });
+            }));
             const data = await response.json();
             if (response.ok) {
                 showMessage(data.message);
@@ -608,11 +647,11 @@ document.addEventListener('DOMContentLoaded', () => {
             return;
         }
         try {
-            const response = await fetch(`/api/groups/${currentGroup}/players`, {
+            const response = checkAuth(await fetch(`/api/groups/${currentGroup}/players`, {
                 method: 'DELETE',
-                headers: { 'Content-Type': 'application/json' },
+                headers: { 'Content-Type': 'application/json', ...authHeaders() },
                 body: JSON.stringify({ playerUuid })
-            });
+            }));
             const data = await response.json();
             if (response.ok) {
                 showMessage(data.message);
@@ -633,9 +672,10 @@ document.addEventListener('DOMContentLoaded', () => {
             return;
         }
         try {
-            const response = await fetch(`/api/groups/${currentGroup}`, {
-                method: 'DELETE'
-            });
+            const response = checkAuth(await fetch(`/api/groups/${currentGroup}`, {
+                method: 'DELETE',
+                headers: authHeaders()
+            }));
             const data = await response.json();
             if (response.ok) {
                 showMessage(data.message);
@@ -2,10 +2,15 @@
 
 #include "command/Command.h"
 #include "db/DatabaseFactory.h"
+#include "http/HttpServer.h"
 #include "ll/api/Config.h"
 #include "ll/api/mod/RegisterHelper.h"
+#include "ll/api/thread/ServerThreadExecutor.h"
+#include "mod/PlayerListeners.h"
+#include "mod/ScriptExports.h"
 #include "permission/PermissionManager.h" // 添加 PermissionManager 头文件
 #include <exception>
+#include <filesystem>
 #include "permission/events/EventTest.h" // Include EventTest.h
 namespace BA {
 
@@ -31,34 +36,69 @@ bool MyMod::load() {
     // create database
     try {
         if (config_.db_type == "sqlite") {
-            db_ = db::DatabaseFactory::createSQLite(config_.sqlite_path);
-        } else if (config_.db_type == "mysql") {
-            db_ = db::DatabaseFactory::createMySQL(
-                config_.mysql_host,
-                config_.mysql_user,
-                config_.mysql_password,
-                config_.mysql_db,
-                config_.mysql_port
-            );
-        } else if (config_.db_type == "postgresql") {
-            db_ = db::DatabaseFactory::createPostgreSQL(
-                config_.postgresql_host,
-                config_.postgresql_user,
-                config_.postgresql_password,
-                config_.postgresql_db,
-                config_.postgresql_port
+            db::SQLiteOptions sqliteOptions;
+            sqliteOptions.journalMode   = config_.sqlite_journal_mode;
+            sqliteOptions.synchronous   = config_.sqlite_synchronous;
+            sqliteOptions.mmapSizeBytes = static_cast<long long>(config_.sqlite_mmap_size_mb) * 1024 * 1024;
+            sqliteOptions.cacheSizeKiB  = config_.sqlite_cache_size_kb;
+            sqliteOptions.busyTimeoutMs = static_cast<int>(config_.sqlite_busy_timeout_ms);
+            db_ = db::DatabaseFactory::createPooledSQLite(
+                config_.sqlite_path,
+                config_.sqlite_reader_connections,
+                sqliteOptions
             );
+        } else if (config_.db_type == "mysql" || config_.db_type == "postgresql") {
+            db::PoolOptions poolOptions;
+            poolOptions.minConnections      = config_.db_pool_min_connections;
+            poolOptions.maxConnections      = config_.db_pool_max_connections;
+            poolOptions.healthCheckInterval = std::chrono::seconds(config_.db_pool_health_check_seconds);
+            if (config_.db_type == "mysql") {
+                db_ = db::DatabaseFactory::createPooledMySQL(
+                    config_.mysql_host,
+                    config_.mysql_user,
+                    config_.mysql_password,
+                    config_.mysql_db,
+                    config_.mysql_port,
+                    poolOptions
+                );
+            } else {
+                db_ = db::DatabaseFactory::createPooledPostgreSQL(
+                    config_.postgresql_host,
+                    config_.postgresql_user,
+                    config_.postgresql_password,
+                    config_.postgresql_db,
+                    config_.postgresql_port,
+                    poolOptions
+                );
+            }
         }
 
+        if (db_) {
+            db_->setStatementCacheCapacity(config_.db_statement_cache_size);
+        }
         getSelf().getLogger().info("Database '{}' initialized", config_.db_type);
 
         // 初始化 PermissionManager
         if (db_) {
-            if (!permission::PermissionManager::getInstance().init(
-                    db_.get(),
-                    config_.enable_cache_warmup,
-                    config_.cache_worker_threads
-                )) { // 使用 get() 获取原始指针并传递预热配置和线程池大小
+            permission::PermissionOptions options;
+            options.enableWarmup                     = config_.enable_cache_warmup;
+            options.warmupRecentPlayers              = config_.cache_warmup_recent_players;
+            if (config_.cache_snapshot_enabled) {
+                options.cacheSnapshotPath = (getSelf().getDataDir() / "cache_snapshot.bin").string();
+            }
+            options.threadPoolSize                   = config_.cache_worker_threads;
+            options.decisionCacheMaxEntriesPerPlayer = config_.decision_cache_max_entries;
+            options.playerCacheMaxBytes              = size_t(config_.player_cache_max_mb) * 1024 * 1024;
+            options.cacheShardCount                  = config_.cache_shards;
+            options.refreshAhead                     = config_.cache_refresh_ahead;
+            options.writeBehind                      = config_.write_behind_enabled;
+            options.writeBehindIntervalMs            = config_.write_behind_interval_ms;
+            options.writeBehindMaxBatch              = config_.write_behind_max_batch;
+            options.ioThreadPoolSize                 = config_.io_worker_threads;
+            options.clusterInvalidation              = config_.cluster_invalidation_enabled;
+            options.clusterPollIntervalMs            = config_.cluster_poll_interval_ms;
+            options.tracing                          = config_.trace_enabled;
+            if (!permission::PermissionManager::getInstance().init(db_.get(), options)) { // 使用 get() 获取原始指针
                 getSelf().getLogger().error("PermissionManager 初始化失败，无法继续加载。");
                 return false; // 阻止加载
             }
@@ -92,12 +132,34 @@ bool MyMod::enable() {
     if (m_cleanupScheduler) {
         m_cleanupScheduler->start();
     }
+    // 异步接口的回调投递到游戏线程执行
+    permission::PermissionManager::getInstance().setCompletionExecutor([](std::function<void()> completion) {
+        ll::thread::ServerThreadExecutor::getDefault().execute(std::move(completion));
+    });
+    script::registerAsyncExports();
+    script::registerBulkExports();
+    // 玩家上线时预取权限，下线时取消固定
+    listener::registerPlayerListeners();
     getSelf().getLogger().info("Mod enabled");
     BA::Command::RegisterCommands();
 
-    // Register and trigger test events
-    BA::permission::event::registerTestListeners();
-    BA::permission::event::triggerTestEvents();
+    if (config_.http_server_enabled) {
+        http::HttpServerOptions httpOptions;
+        httpOptions.host     = config_.http_server_host;
+        httpOptions.port     = config_.http_server_port;
+        httpOptions.threads  = config_.http_server_threads;
+        httpOptions.apiToken = config_.http_server_token;
+        std::filesystem::path staticPath(config_.http_server_static_path);
+        if (!staticPath.empty() && staticPath.is_relative()) staticPath = getSelf().getModDir() / staticPath;
+        httpOptions.staticPath = staticPath.string();
+        http::HttpServer::getInstance().start(httpOptions);
+    }
+
+    // 调试用的事件监听器会让每次修改都构造并分发事件，只在配置开启时注册
+    if (config_.debug_event_listeners) {
+        BA::permission::event::registerTestListeners();
+        BA::permission::event::triggerTestEvents();
+    }
 
 
     return true;
@@ -110,8 +172,14 @@ bool MyMod::disable() {
     if (m_cleanupScheduler) {
         m_cleanupScheduler->stop();
     }
+    script::removeAsyncExports();
+    script::removeBulkExports();
+    listener::removePlayerListeners();
+    // 先停止 HTTP 服务器，确保关闭 PermissionManager 时不再有新的请求进入
+    http::HttpServer::getInstance().stop();
     // 关闭 PermissionManager，停止其异步工作线程
     permission::PermissionManager::getInstance().shutdown();
+    permission::PermissionManager::getInstance().setCompletionExecutor({});
     getSelf().getLogger().info("Mod disabled");
     return true;
 }
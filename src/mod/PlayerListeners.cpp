@@ -0,0 +1,61 @@
+#include "mod/PlayerListeners.h"
+
+#include "ll/api/event/EventBus.h"
+#include "ll/api/event/Listener.h"
+#include "ll/api/event/player/PlayerDisconnectEvent.h"
+#include "ll/api/event/player/PlayerJoinEvent.h"
+#include "ll/api/mod/NativeMod.h"
+#include "ll/api/service/Bedrock.h"
+#include "mc/world/actor/player/Player.h"
+#include "mc/world/level/Level.h"
+#include "permission/PermissionManager.h"
+#include <string>
+
+namespace BA {
+namespace listener {
+
+namespace {
+
+ll::event::ListenerPtr joinListener;
+ll::event::ListenerPtr leaveListener;
+
+} // namespace
+
+void registerPlayerListeners() {
+    auto& bus = ll::event::EventBus::getInstance();
+    auto& pm  = permission::PermissionManager::getInstance();
+
+    joinListener = bus.emplaceListener<ll::event::player::PlayerJoinEvent>(
+        [&pm](ll::event::player::PlayerJoinEvent& event) { pm.prefetchPlayer(event.self().getUuid().asString()); },
+        ll::event::EventPriority::Normal,
+        ll::mod::NativeMod::current()
+    );
+    leaveListener = bus.emplaceListener<ll::event::player::PlayerDisconnectEvent>(
+        [&pm](ll::event::player::PlayerDisconnectEvent& event) { pm.unpinPlayer(event.self().getUuid().asString()); },
+        ll::event::EventPriority::Normal,
+        ll::mod::NativeMod::current()
+    );
+
+    // 插件在服务器运行中启用时，已在线的玩家不会再触发上线事件
+    if (auto level = ll::service::getLevel()) {
+        level->forEachPlayer([&pm](Player& player) {
+            pm.prefetchPlayer(player.getUuid().asString());
+            return true;
+        });
+    }
+}
+
+void removePlayerListeners() {
+    auto& bus = ll::event::EventBus::getInstance();
+    if (joinListener) {
+        bus.removeListener(joinListener);
+        joinListener.reset();
+    }
+    if (leaveListener) {
+        bus.removeListener(leaveListener);
+        leaveListener.reset();
+    }
+}
+
+} // namespace listener
+} // namespace BA
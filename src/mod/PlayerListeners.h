@@ -0,0 +1,19 @@
+#pragma once
+
+namespace BA {
+namespace listener {
+
+/**
+ * @brief 订阅玩家上线与下线事件：上线时固定玩家缓存并在 I/O 线程中预先载入其权限，
+ *        下线时取消固定，之后按访问时间正常参与淘汰。
+ *        注册时已在线的玩家（例如重载插件后）会立即预取。
+ */
+void registerPlayerListeners();
+
+/**
+ * @brief 取消 registerPlayerListeners 注册的监听器。
+ */
+void removePlayerListeners();
+
+} // namespace listener
+} // namespace BA
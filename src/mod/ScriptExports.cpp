@@ -0,0 +1,241 @@
+#include "mod/ScriptExports.h"
+
+#include "RemoteCallAPI.h"
+#include "ll/api/io/Logger.h"
+#include "ll/api/mod/NativeMod.h"
+#include "permission/PermissionManager.h"
+#include <exception>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace BA {
+namespace script {
+
+namespace {
+
+constexpr const char* EXPORT_NAMESPACE = "BA";
+
+const char* const ASYNC_EXPORTS[] = {
+    "hasPermissionAsync",
+    "getPlayerGroupsAsync",
+    "getPlayersInGroupAsync",
+    "addPlayerToGroupAsync",
+    "removePlayerFromGroupAsync",
+    "addPermissionToGroupAsync",
+    "removePermissionFromGroupAsync",
+};
+
+const char* const BULK_EXPORTS[] = {
+    "hasPermissions",
+    "filterPlayersWithPermission",
+    "getOnlinePlayersWithPermission",
+};
+
+/**
+ * @brief 构造调用脚本回调的函数，在游戏线程中执行。
+ *        回调在调用时才解析，脚本可以在请求完成前重新导出或撤销它。
+ */
+template <typename Result>
+std::function<void(Result)> scriptCallback(std::string callbackNamespace, std::string callbackName, int requestId) {
+    return [callbackNamespace = std::move(callbackNamespace),
+            callbackName      = std::move(callbackName),
+            requestId](Result result) {
+        auto& logger = ::ll::mod::NativeMod::current()->getLogger();
+        if (!RemoteCall::hasFunc(callbackNamespace, callbackName)) {
+            logger.warn("脚本回调 {}::{} 不存在，请求 {} 的结果被丢弃。", callbackNamespace, callbackName, requestId);
+            return;
+        }
+        try {
+            auto callback = RemoteCall::importAs<void(int, Result)>(callbackNamespace, callbackName);
+            callback(requestId, std::move(result));
+        } catch (const std::exception& e) {
+            logger.error("调用脚本回调 {}::{} 失败: {}", callbackNamespace, callbackName, e.what());
+        }
+    };
+}
+
+// 导出函数的签名：业务参数之后依次是回调命名空间、回调函数名和请求 ID，返回是否已提交
+using OneArgExport   = std::function<bool(std::string, std::string, std::string, int)>;
+using TwoArgExport   = std::function<bool(std::string, std::string, std::string, std::string, int)>;
+using ThreeArgExport = std::function<bool(std::string, std::string, int, std::string, std::string, int)>;
+
+} // namespace
+
+void registerAsyncExports() {
+    auto& pm = permission::PermissionManager::getInstance();
+
+    RemoteCall::exportAs(
+        EXPORT_NAMESPACE,
+        "hasPermissionAsync",
+        TwoArgExport([&pm](
+            std::string playerUuid,
+            std::string permissionNode,
+            std::string ns,
+            std::string fn,
+            int requestId
+        ) {
+            pm.hasPermissionAsync(
+                playerUuid,
+                permissionNode,
+                scriptCallback<bool>(std::move(ns), std::move(fn), requestId)
+            );
+            return true;
+        })
+    );
+    RemoteCall::exportAs(
+        EXPORT_NAMESPACE,
+        "getPlayerGroupsAsync",
+        OneArgExport([&pm](
+            std::string playerUuid,
+            std::string ns,
+            std::string fn,
+            int requestId
+        ) {
+            pm.getPlayerGroupsAsync(
+                playerUuid,
+                scriptCallback<std::vector<std::string>>(std::move(ns), std::move(fn), requestId)
+            );
+            return true;
+        })
+    );
+    RemoteCall::exportAs(
+        EXPORT_NAMESPACE,
+        "getPlayersInGroupAsync",
+        OneArgExport([&pm](
+            std::string groupName,
+            std::string ns,
+            std::string fn,
+            int requestId
+        ) {
+            pm.getPlayersInGroupAsync(
+                groupName,
+                scriptCallback<std::vector<std::string>>(std::move(ns), std::move(fn), requestId)
+            );
+            return true;
+        })
+    );
+    RemoteCall::exportAs(
+        EXPORT_NAMESPACE,
+        "addPlayerToGroupAsync",
+        ThreeArgExport([&pm](
+            std::string playerUuid,
+            std::string groupName,
+            int durationSeconds,
+            std::string ns,
+            std::string fn,
+            int requestId
+        ) {
+            pm.addPlayerToGroupAsync(
+                playerUuid,
+                groupName,
+                durationSeconds,
+                scriptCallback<bool>(std::move(ns), std::move(fn), requestId)
+            );
+            return true;
+        })
+    );
+    RemoteCall::exportAs(
+        EXPORT_NAMESPACE,
+        "removePlayerFromGroupAsync",
+        TwoArgExport([&pm](
+            std::string playerUuid,
+            std::string groupName,
+            std::string ns,
+            std::string fn,
+            int requestId
+        ) {
+            pm.removePlayerFromGroupAsync(
+                playerUuid,
+                groupName,
+                scriptCallback<bool>(std::move(ns), std::move(fn), requestId)
+            );
+            return true;
+        })
+    );
+    RemoteCall::exportAs(
+        EXPORT_NAMESPACE,
+        "addPermissionToGroupAsync",
+        TwoArgExport([&pm](
+            std::string groupName,
+            std::string permissionName,
+            std::string ns,
+            std::string fn,
+            int requestId
+        ) {
+            pm.addPermissionToGroupAsync(
+                groupName,
+                permissionName,
+                scriptCallback<bool>(std::move(ns), std::move(fn), requestId)
+            );
+            return true;
+        })
+    );
+    RemoteCall::exportAs(
+        EXPORT_NAMESPACE,
+        "removePermissionFromGroupAsync",
+        TwoArgExport([&pm](
+            std::string groupName,
+            std::string permissionName,
+            std::string ns,
+            std::string fn,
+            int requestId
+        ) {
+            pm.removePermissionFromGroupAsync(
+                groupName,
+                permissionName,
+                scriptCallback<bool>(std::move(ns), std::move(fn), requestId)
+            );
+            return true;
+        })
+    );
+}
+
+void removeAsyncExports() {
+    for (const char* name : ASYNC_EXPORTS) {
+        RemoteCall::removeFunc(EXPORT_NAMESPACE, name);
+    }
+}
+
+void registerBulkExports() {
+    auto& pm = permission::PermissionManager::getInstance();
+
+    // RemoteCall 无法打包 std::vector<bool>，结果以 1/0 返回
+    RemoteCall::exportAs(
+        EXPORT_NAMESPACE,
+        "hasPermissions",
+        std::function<std::vector<int>(std::string, std::vector<std::string>)>(
+            [&pm](std::string playerUuid, std::vector<std::string> permissionNodes) {
+                auto             results = pm.hasPermissions(playerUuid, permissionNodes);
+                std::vector<int> flags(results.begin(), results.end());
+                return flags;
+            }
+        )
+    );
+    RemoteCall::exportAs(
+        EXPORT_NAMESPACE,
+        "filterPlayersWithPermission",
+        std::function<std::vector<std::string>(std::vector<std::string>, std::string)>(
+            [&pm](std::vector<std::string> playerUuids, std::string permissionNode) {
+                return pm.filterPlayersWithPermission(playerUuids, permissionNode);
+            }
+        )
+    );
+    RemoteCall::exportAs(
+        EXPORT_NAMESPACE,
+        "getOnlinePlayersWithPermission",
+        std::function<std::vector<std::string>(std::string)>([&pm](std::string permissionNode) {
+            return pm.getOnlinePlayersWithPermission(permissionNode);
+        })
+    );
+}
+
+void removeBulkExports() {
+    for (const char* name : BULK_EXPORTS) {
+        RemoteCall::removeFunc(EXPORT_NAMESPACE, name);
+    }
+}
+
+} // namespace script
+} // namespace BA
@@ -0,0 +1,30 @@
+#pragma once
+
+namespace BA {
+namespace script {
+
+/**
+ * @brief 通过 RemoteCall 在 BA 命名空间下导出异步脚本 API（*Async 函数）。
+ *        脚本传入自己用 ll.exports 导出的回调所在的命名空间和函数名，以及一个请求 ID；
+ *        调用完成后在游戏线程中以 (请求 ID, 结果) 调用该回调。
+ */
+void registerAsyncExports();
+
+/**
+ * @brief 移除 registerAsyncExports 导出的函数。
+ */
+void removeAsyncExports();
+
+/**
+ * @brief 在 BA 命名空间下导出批量权限检查函数（hasPermissions、filterPlayersWithPermission、
+ *        getOnlinePlayersWithPermission），一次调用检查多个节点或多个玩家，减少脚本与插件之间的往返。
+ */
+void registerBulkExports();
+
+/**
+ * @brief 移除 registerBulkExports 导出的函数。
+ */
+void removeBulkExports();
+
+} // namespace script
+} // namespace BA
@@ -1,8 +1,12 @@
 #include "permission/AsyncCacheInvalidator.h"
 #include "ll/api/io/Logger.h"
 #include "ll/api/mod/NativeMod.h"
+#include "permission/Metrics.h"
 #include "permission/PermissionCache.h"
 #include "permission/PermissionStorage.h"
+#include "permission/Trace.h"
+#include <chrono>
+#include <functional>
 #include <set>          
 #include <string>     
 #include <unordered_map>
@@ -16,6 +20,46 @@ namespace internal {
 
 // 移除了 'using namespace std;' 以显式限定标准库类型。
 
+static_assert(AsyncCacheInvalidator::LANE_COUNT == INVALIDATOR_LANES, "Metrics 中的分道数与失效器不一致");
+
+namespace {
+
+// data 为单个玩家 UUID 的任务
+bool isSinglePlayerTask(CacheInvalidationTaskType type) {
+    return type == CacheInvalidationTaskType::PLAYER_GROUP_CHANGED || type == CacheInvalidationTaskType::PLAYER_REFRESH;
+}
+
+// 按任务类型选择追踪记录的键：组名、权限名或玩家；批量任务记录玩家数
+void traceTask(
+    TraceEvent                   event,
+    const CacheInvalidationTask& task,
+    const PlayerKey&             player,
+    uint64_t                     durationNs = 0,
+    uint32_t                     value      = 0
+) {
+    auto& tracer = Tracer::getInstance();
+    if (!tracer.enabled()) return;
+    auto type = static_cast<uint8_t>(task.type);
+    switch (task.type) {
+    case CacheInvalidationTaskType::GROUP_MODIFIED:
+    case CacheInvalidationTaskType::PERMISSION_DEFAULT_CHANGED:
+        tracer.recordName(event, type, task.data, durationNs, value);
+        break;
+    case CacheInvalidationTaskType::PLAYER_GROUP_CHANGED:
+    case CacheInvalidationTaskType::PLAYER_REFRESH:
+        tracer.recordPlayer(event, type, player, durationNs, value);
+        break;
+    case CacheInvalidationTaskType::PLAYER_BATCH_GROUP_CHANGED:
+        tracer.record(event, type, durationNs, value > 0 ? value : static_cast<uint32_t>(task.players.size()));
+        break;
+    default:
+        tracer.record(event, type, durationNs, value);
+        break;
+    }
+}
+
+} // namespace
+
 /**
  * @brief 异步缓存失效器的构造函数。
  * @param cache 权限缓存的引用。
@@ -47,9 +91,15 @@ void AsyncCacheInvalidator::start(unsigned int threadPoolSize) {
         ::ll::mod::NativeMod::current()->getLogger().warn("AsyncCacheInvalidator: 已经运行，无需再次启动。");
         return; // 已经运行
     }
+    if (threadPoolSize == 0) threadPoolSize = 1;
+    m_stopping = false;
+    m_queued   = 0;
+    for (auto& depth : m_laneDepth) depth = 0;
+    m_workers.clear();
+    for (unsigned int i = 0; i < threadPoolSize; ++i) m_workers.push_back(std::make_unique<Worker>());
     m_running = true;
     for (unsigned int i = 0; i < threadPoolSize; ++i) {
-        m_workerThreads.emplace_back(&AsyncCacheInvalidator::processTasks, this);
+        m_workerThreads.emplace_back(&AsyncCacheInvalidator::processTasks, this, static_cast<size_t>(i));
         ::ll::mod::NativeMod::current()->getLogger().debug("AsyncCacheInvalidator: 启动工作线程 #{}。", i + 1);
     }
     ::ll::mod::NativeMod::current()->getLogger().info(
@@ -60,6 +110,7 @@ void AsyncCacheInvalidator::start(unsigned int threadPoolSize) {
 
 /**
  * @brief 停止异步缓存失效器，并等待所有工作线程完成。
+ *        已入队的任务仍会被处理，之后入队的任务被丢弃。
  */
 void AsyncCacheInvalidator::stop() {
     if (!m_running) {
@@ -67,20 +118,16 @@ void AsyncCacheInvalidator::stop() {
         return; // 已经停止
     }
 
-    // 为每个工作线程入队一个关闭任务
-    if (!m_workerThreads.empty()) {
+    m_running  = false; // 发出信号，不再接受新的任务
+    m_stopping = true;  // 工作线程处理完剩余任务后退出
+    for (auto& worker : m_workers) {
         {
-            std::unique_lock<std::mutex> lock(m_queueMutex);
-            for (size_t i = 0; i < m_workerThreads.size(); ++i) {
-                m_taskQueue.push({CacheInvalidationTaskType::SHUTDOWN, ""});
-            }
-            ::ll::mod::NativeMod::current()->getLogger().debug("AsyncCacheInvalidator: 已为所有工作线程入队关闭任务。");
+            std::lock_guard<std::mutex> lock(worker->mutex);
+            worker->notified = true;
         }
-        m_condition.notify_all(); // 唤醒所有线程以处理关闭任务
+        worker->wake.notify_one();
     }
 
-    m_running = false; // 发出信号，不再处理新的任务
-
     // 等待所有线程完成
     for (std::thread& worker : m_workerThreads) {
         if (worker.joinable()) {
@@ -92,11 +139,57 @@ void AsyncCacheInvalidator::stop() {
     ::ll::mod::NativeMod::current()->getLogger().info("AsyncCacheInvalidator: 已停止。");
 }
 
+
 /**
  * @brief 将一个缓存失效任务加入队列。
  * @param task 要加入队列的任务。
  */
 void AsyncCacheInvalidator::enqueueTask(CacheInvalidationTask task) {
+    if (m_running) publish(task);
+    enqueueLocal(std::move(task));
+}
+
+/**
+ * @brief 将其他服务器产生的缓存失效任务加入队列，不再发布。
+ * @param task 要加入队列的任务。
+ */
+void AsyncCacheInvalidator::enqueueRemoteTask(CacheInvalidationTask task) { enqueueLocal(std::move(task)); }
+
+/**
+ * @brief 发布任务，不在本机处理。
+ * @param task 要发布的任务。
+ */
+void AsyncCacheInvalidator::publish(const CacheInvalidationTask& task) {
+    if (!m_publisher || task.type == CacheInvalidationTaskType::PLAYER_REFRESH
+        || task.type == CacheInvalidationTaskType::SHUTDOWN) {
+        return;
+    }
+    m_publisher(task);
+}
+
+/**
+ * @brief 选择任务的分道：组与全局变化最先，其次是在线玩家，离线玩家最后。
+ * @param task 任务。
+ * @param player 单个玩家任务的玩家键。
+ */
+AsyncCacheInvalidator::Lane
+AsyncCacheInvalidator::laneOf(const CacheInvalidationTask& task, const PlayerKey& player) const {
+    switch (task.type) {
+    case CacheInvalidationTaskType::PLAYER_GROUP_CHANGED:
+    case CacheInvalidationTaskType::PLAYER_REFRESH:
+        return m_cache.isPinned(player) ? Lane::ONLINE : Lane::OFFLINE;
+    case CacheInvalidationTaskType::PLAYER_BATCH_GROUP_CHANGED:
+        return Lane::OFFLINE; // 其中的在线玩家在入队时已被拆出
+    default:
+        return Lane::GLOBAL;
+    }
+}
+
+/**
+ * @brief 合并并入队任务。
+ * @param task 要加入队列的任务。
+ */
+void AsyncCacheInvalidator::enqueueLocal(CacheInvalidationTask task) {
     if (!m_running) {
         ::ll::mod::NativeMod::current()->getLogger().warn(
             "AsyncCacheInvalidator: 未运行，任务被丢弃。任务类型: {}, 数据: {}",
@@ -106,229 +199,303 @@ void AsyncCacheInvalidator::enqueueTask(CacheInvalidationTask task) {
         return;
     }
 
-    bool task_merged = false;
-    {
-        std::unique_lock<std::mutex> pendingLock(m_pendingTasksMutex); // 锁定 m_pendingTasksMutex
-        // 任务合并逻辑
-        if (task.type == CacheInvalidationTaskType::GROUP_MODIFIED) {
-            if (m_allGroupsModifiedPending || m_pendingGroupModifiedTasks.count(task.data)) {
-                ::ll::mod::NativeMod::current()->getLogger().debug(
-                    "AsyncCacheInvalidator: 合并 GROUP_MODIFIED 任务，组: '{}'。",
-                    task.data
-                );
-                task_merged = true;
-            } else {
-                m_pendingGroupModifiedTasks.insert(task.data);
-                ::ll::mod::NativeMod::current()->getLogger().debug(
-                    "AsyncCacheInvalidator: 入队 GROUP_MODIFIED 任务，组: \'{}\'.",
-                    task.data
-                );
-            }
-        } else if (task.type == CacheInvalidationTaskType::PLAYER_GROUP_CHANGED) {
-            if (m_pendingPlayerGroupChangedTasks.count(task.data)) {
-                ::ll::mod::NativeMod::current()->getLogger().debug(
-                    "AsyncCacheInvalidator: 合并 PLAYER_GROUP_CHANGED 任务，玩家: \'{}\'.",
-                    task.data
-                );
-                task_merged = true;
-            } else {
-                m_pendingPlayerGroupChangedTasks.insert(task.data);
-                ::ll::mod::NativeMod::current()->getLogger().debug(
-                    "AsyncCacheInvalidator: 入队 PLAYER_GROUP_CHANGED 任务，玩家: \'{}\'.",
-                    task.data
-                );
-            }
-        } else if (task.type == CacheInvalidationTaskType::ALL_GROUPS_MODIFIED) {
-            if (m_allGroupsModifiedPending) {
-                ::ll::mod::NativeMod::current()->getLogger().debug(
-                    "AsyncCacheInvalidator: 合并 ALL_GROUPS_MODIFIED 任务。"
-                );
-                task_merged = true;
+    // 批量任务中的在线玩家拆成单独的任务进入在线分道，不必排在离线玩家之后
+    if (task.type == CacheInvalidationTaskType::PLAYER_BATCH_GROUP_CHANGED) {
+        std::vector<std::string> offline;
+        offline.reserve(task.players.size());
+        for (auto& playerUuid : task.players) {
+            if (m_cache.isPinned(PlayerKey::fromString(playerUuid))) {
+                enqueueLocal({CacheInvalidationTaskType::PLAYER_GROUP_CHANGED, std::move(playerUuid)});
             } else {
-                m_pendingGroupModifiedTasks.clear(); // ALL 任务包含所有特定组修改
-                m_allGroupsModifiedPending = true;
-                ::ll::mod::NativeMod::current()->getLogger().debug(
-                    "AsyncCacheInvalidator: 入队 ALL_GROUPS_MODIFIED 任务。"
-                );
+                offline.push_back(std::move(playerUuid));
             }
+        }
+        if (offline.empty()) return;
+        task.players = std::move(offline);
+    }
+
+    // 玩家任务的 UUID 只解析一次，合并、分道与处理都使用解析出的键
+    PlayerKey player;
+    if (isSinglePlayerTask(task.type)) player = PlayerKey::fromString(task.data);
+
+    bool task_merged = false;
+    if (task.type != CacheInvalidationTaskType::PLAYER_BATCH_GROUP_CHANGED) {
+        std::unique_lock<std::mutex> pendingLock(m_pendingTasksMutex); // 锁定 m_pendingTasksMutex
+        // 任务合并逻辑：同一 (类型, 键) 的任务尚未开始处理时，新的任务被它覆盖
+        PendingKey key{task.type, player, isSinglePlayerTask(task.type) ? std::string() : task.data};
+        if (task.type == CacheInvalidationTaskType::GROUP_MODIFIED
+            && m_pendingTasks.count({CacheInvalidationTaskType::ALL_GROUPS_MODIFIED, {}, {}})) {
+            task_merged = true; // ALL 任务包含所有特定组修改：它会递增所有组的代数并释放玩家组快照
+        } else if (task.type == CacheInvalidationTaskType::PLAYER_REFRESH
+                   && m_pendingTasks.count({CacheInvalidationTaskType::PLAYER_GROUP_CHANGED, player, {}})) {
+            task_merged = true; // 已有同一玩家的失效任务在排队
         } else {
-            ::ll::mod::NativeMod::current()->getLogger().debug(
-                "AsyncCacheInvalidator: 入队任务，类型: {}, 数据: \'{}\'.",
-                static_cast<int>(task.type),
-                task.data
-            );
+            task_merged = !m_pendingTasks.insert(std::move(key)).second;
         }
     } // pendingLock 在这里释放
 
+    traceTask(task_merged ? TraceEvent::INVALIDATOR_MERGE : TraceEvent::INVALIDATOR_ENQUEUE, task, player);
+    auto& metrics = Metrics::getInstance();
     if (task_merged) {
+        metrics.invalidatorTasksMerged.add();
         return; // 任务已合并，无需入队
     }
 
-    // 在 m_pendingTasksMutex 释放后，再锁定 m_queueMutex 将任务推入队列
+    metrics.invalidatorTasksEnqueued.add();
+    Lane lane = laneOf(task, player);
+    push({std::move(task), player, lane, std::chrono::steady_clock::now()});
+}
+
+namespace {
+// 当前线程是哪个失效器的第几个工作线程，工作线程产生的任务放入自己的队列
+thread_local const AsyncCacheInvalidator* currentInvalidator = nullptr;
+thread_local size_t                       currentWorker      = 0;
+} // namespace
+
+/**
+ * @brief 放入一个工作线程的队列：工作线程放入自己的队列，其他线程轮流选择。
+ * @param task 要放入的任务。
+ */
+void AsyncCacheInvalidator::push(QueuedTask task) {
+    size_t index = currentInvalidator == this ? currentWorker
+                                              : m_nextWorker.fetch_add(1, std::memory_order_relaxed) % m_workers.size();
+    auto   lane  = static_cast<size_t>(task.lane);
+    // 先计数再放入：休眠前看到计数为 0 的线程一定会被下面的唤醒找到
+    size_t queued = m_queued.fetch_add(1) + 1;
+    size_t depth  = m_laneDepth[lane].fetch_add(1, std::memory_order_relaxed) + 1;
     {
-        std::unique_lock<std::mutex> queueLock(m_queueMutex); // 锁定 m_queueMutex
-        m_taskQueue.push(std::move(task));
-    } // queueLock 在这里释放
-    m_condition.notify_one();
+        std::lock_guard<std::mutex> lock(m_workers[index]->mutex);
+        m_workers[index]->lanes[lane].push_back(std::move(task));
+    }
+    auto& metrics = Metrics::getInstance();
+    metrics.invalidatorQueueDepth.set(queued);
+    metrics.invalidatorLaneDepth[lane].set(depth);
+    wakeWorker(index);
 }
 
 /**
- * @brief 工作线程函数，负责从任务队列中取出并处理任务。
+ * @brief 唤醒指定的工作线程；它没有休眠时唤醒任意一个休眠的线程，由它来窃取任务。
+ * @param preferred 任务所在队列的工作线程。
  */
-void AsyncCacheInvalidator::processTasks() {
-    auto& logger = ::ll::mod::NativeMod::current()->getLogger();
-    logger.debug("AsyncCacheInvalidator: 工作线程开始处理任务。");
-    while (true) {
-        CacheInvalidationTask task;
+void AsyncCacheInvalidator::wakeWorker(size_t preferred) {
+    size_t count = m_workers.size();
+    for (size_t i = 0; i < count; ++i) {
+        auto& worker = *m_workers[(preferred + i) % count];
+        if (!worker.sleeping.exchange(false)) continue; // 没有休眠，或已被其他入队线程唤醒
         {
-            std::unique_lock<std::mutex> queueLock(m_queueMutex); // 只锁定 m_queueMutex
-            m_condition.wait(queueLock, [this] { return !m_taskQueue.empty(); });
+            std::lock_guard<std::mutex> lock(worker.mutex);
+            worker.notified = true;
+        }
+        worker.wake.notify_one();
+        return;
+    }
+}
+
+/**
+ * @brief 按分道优先级取出一个任务。每个分道先看自己的队列，再从其他线程的队列窃取最早入队的任务，
+ *        都为空时才看下一个分道。
+ * @param index 工作线程的编号。
+ * @return 取出的任务；所有队列都为空时返回 std::nullopt。
+ */
+std::optional<AsyncCacheInvalidator::QueuedTask> AsyncCacheInvalidator::pop(size_t index) {
+    size_t count = m_workers.size();
+    for (size_t lane = 0; lane < LANE_COUNT; ++lane) {
+        if (m_laneDepth[lane].load(std::memory_order_relaxed) == 0) continue;
+        for (size_t i = 0; i < count; ++i) {
+            auto&                      worker = *m_workers[(index + i) % count];
+            std::optional<QueuedTask> task;
+            {
+                std::lock_guard<std::mutex> lock(worker.mutex);
+                auto&                       queue = worker.lanes[lane];
+                if (queue.empty()) continue;
+                task.emplace(std::move(queue.front()));
+                queue.pop_front();
+            }
+            auto& metrics = Metrics::getInstance();
+            if (i > 0) metrics.invalidatorTasksStolen.add();
+            metrics.invalidatorQueueDepth.set(m_queued.fetch_sub(1) - 1);
+            metrics.invalidatorLaneDepth[lane].set(m_laneDepth[lane].fetch_sub(1, std::memory_order_relaxed) - 1);
+            metrics.invalidatorLaneWait[lane].record(std::chrono::steady_clock::now() - task->enqueuedAt);
+            return task;
+        }
+    }
+    return std::nullopt;
+}
+
 
-            task = std::move(m_taskQueue.front());
-            m_taskQueue.pop();
-        } // queueLock 在这里释放
+/**
+ * @brief 设置玩家快照的重建函数，启用 refresh-ahead。
+ * @param refresher 以玩家键调用的重建函数。
+ */
+void AsyncCacheInvalidator::setRefreshHandler(std::function<void(const PlayerKey&)> refresher) {
+    m_refresher = std::move(refresher);
+}
 
-        // 优先处理 SHUTDOWN 任务
-        if (task.type == CacheInvalidationTaskType::SHUTDOWN) {
-            logger.debug("AsyncCacheInvalidator: 工作线程收到 SHUTDOWN 任务并正在退出。");
-            break; // 退出循环并终止线程
+/**
+ * @brief 设置任务发布函数。
+ * @param publisher 以任务调用的发布函数。
+ */
+void AsyncCacheInvalidator::setPublishHandler(std::function<void(const CacheInvalidationTask&)> publisher) {
+    m_publisher = std::move(publisher);
+}
+
+/**
+ * @brief 工作线程函数，负责从分道队列中取出并处理任务。
+ * @param index 工作线程的编号。
+ */
+void AsyncCacheInvalidator::processTasks(size_t index) {
+    auto& logger = ::ll::mod::NativeMod::current()->getLogger();
+    logger.debug("AsyncCacheInvalidator: 工作线程开始处理任务。");
+    currentInvalidator = this;
+    currentWorker      = index;
+    auto& self         = *m_workers[index];
+    auto& tracer       = Tracer::getInstance();
+    while (true) {
+        std::optional<QueuedTask> queued = pop(index);
+        if (!queued) {
+            if (m_stopping && m_queued.load() == 0) break; // 剩余任务已处理完
+            std::unique_lock<std::mutex> lock(self.mutex);
+            self.sleeping.store(true);
+            // 置位之后再检查计数，与 push 中先计数后唤醒配合，不会错过新任务
+            if (m_queued.load() > 0 || m_stopping) {
+                self.sleeping.store(false);
+                continue;
+            }
+            self.wake.wait(lock, [&self] { return self.notified; });
+            self.notified = false;
+            self.sleeping.store(false);
+            continue;
         }
 
-        // 在处理任务之前，更新待处理任务状态，这部分需要 m_pendingTasksMutex
-        {
+        // 在处理任务之前移除合并键，之后入队的同类任务不再被合并
+        if (queued->task.type != CacheInvalidationTaskType::PLAYER_BATCH_GROUP_CHANGED) {
             std::unique_lock<std::mutex> pendingLock(m_pendingTasksMutex); // 锁定 m_pendingTasksMutex
-            if (task.type == CacheInvalidationTaskType::GROUP_MODIFIED) {
-                m_pendingGroupModifiedTasks.erase(task.data);
-                logger.debug("AsyncCacheInvalidator: 从待处理集合中移除 GROUP_MODIFIED 任务，组: \'{}\'.", task.data);
-            } else if (task.type == CacheInvalidationTaskType::PLAYER_GROUP_CHANGED) {
-                m_pendingPlayerGroupChangedTasks.erase(task.data);
-                logger.debug("AsyncCacheInvalidator: 从待处理集合中移除 PLAYER_GROUP_CHANGED 任务，玩家: \'{}\'.", task.data);
-            } else if (task.type == CacheInvalidationTaskType::ALL_GROUPS_MODIFIED) {
-                m_allGroupsModifiedPending = false;
-                logger.debug("AsyncCacheInvalidator: 从待处理集合中移除 ALL_GROUPS_MODIFIED 任务。");
-            }
+            m_pendingTasks.erase(
+                {queued->task.type,
+                 queued->player,
+                 isSinglePlayerTask(queued->task.type) ? std::string() : queued->task.data}
+            );
         } // pendingLock 在这里释放
 
+        // 逐任务的记录写入追踪缓冲区而不是调试日志，组内玩家很多时也不会产生大量格式化与日志调用
+        uint64_t      start = tracer.enabled() ? Tracer::now() : 0;
+        ScopedLatency timer(Metrics::getInstance().invalidatorTaskLatency);
         try {
-            switch (task.type) {
-            case CacheInvalidationTaskType::GROUP_MODIFIED: {
-                logger.debug("AsyncCacheInvalidator: 正在处理 GROUP_MODIFIED 任务，组: \'{}\'.", task.data);
-                // 组的权限或继承关系发生变化。
-                // 这会影响组本身、其所有子组以及这些组中的所有玩家。
-                std::set<std::string> affectedGroups = m_cache.getChildGroupsRecursive(task.data);
-                logger
-                    .debug("AsyncCacheInvalidator: 组 \'{}\' 及其子组共 {} 个受影响。", task.data, affectedGroups.size());
-                for (const auto& groupName : affectedGroups) {
-                    m_cache.invalidateGroupPermissions(groupName);
-                    logger.debug("AsyncCacheInvalidator: 使组 \'{}\' 的权限缓存失效。", groupName);
-
-                    std::vector<std::string> affectedPlayers = getAffectedPlayersByGroup(groupName);
-                    logger.debug(
-                        "AsyncCacheInvalidator: 组 \'{}\' 中有 {} 个受影响的玩家。",
-                        groupName,
-                        affectedPlayers.size()
-                    );
-                    for (const auto& playerUuid : affectedPlayers) {
-                        logger.debug(
-                            "AsyncCacheInvalidator: 正在为玩家 \'{}\' 使缓存失效，因为其所在的组 \'{}\' 已被修改。",
-                            playerUuid,
-                            groupName
-                        );
-                        m_cache.invalidatePlayerPermissions(playerUuid);
-                        m_cache.invalidatePlayerGroups(playerUuid);
-                        logger.debug("AsyncCacheInvalidator: 已成功使玩家 \'{}\' 的权限和组缓存失效。", playerUuid);
-                    }
-                }
-                break;
-            }
-            case CacheInvalidationTaskType::PLAYER_GROUP_CHANGED: {
-                logger.debug("AsyncCacheInvalidator: 正在处理 PLAYER_GROUP_CHANGED 任务，玩家: \'{}\'.", task.data);
-                // 玩家被添加/从组中移除。
-                m_cache.invalidatePlayerPermissions(task.data);
-                m_cache.invalidatePlayerGroups(task.data);
-                logger.debug("AsyncCacheInvalidator: 使玩家 \'{}\' 的权限和组缓存失效。", task.data);
-                break;
-            }
-            case CacheInvalidationTaskType::ALL_GROUPS_MODIFIED: {
-                logger.debug("AsyncCacheInvalidator: 正在处理 ALL_GROUPS_MODIFIED 任务。");
-                // 全局性变化，例如新的权限注册。
-                m_cache.invalidateAllGroupPermissions();
-                m_cache.invalidateAllPlayerPermissions();
-                logger.debug("AsyncCacheInvalidator: 使所有组权限和所有玩家权限缓存失效。");
-                break;
-            }
-            case CacheInvalidationTaskType::ALL_PLAYERS_MODIFIED: {
-                logger.debug("AsyncCacheInvalidator: 正在处理 ALL_PLAYERS_MODIFIED 任务。");
-                // 影响所有玩家的变化，例如默认权限值改变。
-                m_cache.invalidateAllPlayerPermissions();
-                logger.debug("AsyncCacheInvalidator: 使所有玩家权限缓存失效。");
-                break;
-            }
-            case CacheInvalidationTaskType::SHUTDOWN:
-                // 此情况已在循环开始时处理
-                break;
+            uint32_t affected = execute(*queued);
+            Metrics::getInstance().invalidatorTasksProcessed.add();
+            if (start) {
+                traceTask(TraceEvent::INVALIDATOR_TASK, queued->task, queued->player, Tracer::now() - start, affected);
             }
         } catch (const std::exception& e) {
+            Metrics::getInstance().invalidatorTasksFailed.add();
+            if (start) traceTask(TraceEvent::INVALIDATOR_FAILED, queued->task, queued->player, Tracer::now() - start);
             logger.error("AsyncCacheInvalidator: 异步任务处理失败，异常: {}", e.what());
         } catch (...) {
+            Metrics::getInstance().invalidatorTasksFailed.add();
+            if (start) traceTask(TraceEvent::INVALIDATOR_FAILED, queued->task, queued->player, Tracer::now() - start);
             logger.error("AsyncCacheInvalidator: 异步任务处理失败，发生未知异常。");
         }
     }
+    currentInvalidator = nullptr;
     logger.debug("AsyncCacheInvalidator: 工作线程退出。");
 }
 
 /**
- * @brief 辅助函数，用于查找受组更改影响的所有玩家。
- *        它查询存储层，因为缓存可能不包含所有玩家数据。
- * @param groupName 组名称。
- * @return 受影响玩家的UUID列表。
+ * @brief 执行一个任务。
+ * @param queued 任务。
+ * @return 受影响的组数或玩家数，用于追踪记录。
  */
-std::vector<std::string> AsyncCacheInvalidator::getAffectedPlayersByGroup(const std::string& groupName) {
-    auto&                 logger = ::ll::mod::NativeMod::current()->getLogger();
-    std::set<std::string> affectedPlayerUuids;
-
-    // 从缓存中获取所有后代组（包括组本身）。
-    std::set<std::string> allRelatedGroups = m_cache.getChildGroupsRecursive(groupName);
-
-    logger.debug(
-        "AsyncCacheInvalidator: 正在查找组 \'{}\' 的受影响玩家。相关组数量: {}",
-        groupName,
-        allRelatedGroups.size()
-    );
-
-    // 对于每个相关组，从存储层获取其成员。
-    // 首先，收集所有组名以批量查询其ID。
-    std::set<std::string> groupNamesToFetchIds;
-    for (const auto& gName : allRelatedGroups) {
-        groupNamesToFetchIds.insert(gName);
+uint32_t AsyncCacheInvalidator::execute(const QueuedTask& queued) {
+    const auto& task   = queued.task;
+    const auto& player = queued.player;
+    switch (task.type) {
+    case CacheInvalidationTaskType::GROUP_MODIFIED: {
+        // 组的权限或继承关系发生变化。
+        // 这会影响组本身、其所有子组以及这些组中的所有玩家。
+        // 直接使用图中预先计算的后代闭包，不复制组名
+        GroupClosure affectedGroups = m_cache.getDescendantClosure(task.data);
+        m_cache.invalidateGroupPermissions(affectedGroups);
+        // 不再逐个查找并失效组内玩家：递增这些组的代数后，
+        // 依赖它们的玩家快照会在下次查找时被识别为过期并重建，耗时只与受影响的组数有关
+        m_cache.bumpGroupGenerations(affectedGroups);
+        // 已缓存的离线玩家的旧快照不会再被使用，借助反向索引直接在内存中释放，不查询数据库
+        m_cache.releasePlayersInGroups(affectedGroups);
+        if (m_refresher) {
+            // 剩下的都是在线玩家，分发为重建任务，由各工作线程窃取并行完成
+            for (const auto& cachedPlayer : m_cache.getCachedPlayersInGroups(affectedGroups)) {
+                enqueueTask({CacheInvalidationTaskType::PLAYER_REFRESH, cachedPlayer.toString()});
+            }
+        }
+        return static_cast<uint32_t>(affectedGroups.size());
     }
-
-    // 批量获取组ID
-    std::unordered_map<std::string, std::string> groupNameToIdMap =
-        m_storage.fetchGroupIdsByNames(groupNamesToFetchIds);
-
-    std::vector<std::string> groupIdsToFetchPlayers;
-    for (const auto& gName : allRelatedGroups) {
-        auto it = groupNameToIdMap.find(gName);
-        if (it != groupNameToIdMap.end()) {
-            groupIdsToFetchPlayers.push_back(it->second);
+    case CacheInvalidationTaskType::PLAYER_GROUP_CHANGED: {
+        // 玩家被添加/从组中移除。
+        if (m_refresher && m_cache.isPinned(player)) {
+            // 在线玩家：直接重建并替换，重建完成前旧快照继续生效
+            m_refresher(player);
+            return 1;
         }
+        m_cache.invalidatePlayerPermissions(player);
+        m_cache.invalidatePlayerGroups(player);
+        return 1;
     }
-
-    // 批量获取这些组中的玩家
-    if (!groupIdsToFetchPlayers.empty()) {
-        std::vector<std::string> playersInGroups = m_storage.fetchPlayersInGroups(groupIdsToFetchPlayers);
-        affectedPlayerUuids.insert(playersInGroups.begin(), playersInGroups.end());
-        logger.debug(
-            "AsyncCacheInvalidator: 从 {} 个组中获取到 {} 个玩家。",
-            groupIdsToFetchPlayers.size(),
-            playersInGroups.size()
-        );
-    } else {
-        logger.debug("AsyncCacheInvalidator: 没有需要获取玩家的组ID。");
+    case CacheInvalidationTaskType::PLAYER_BATCH_GROUP_CHANGED: {
+        // 入队时已拆出在线玩家，这里只剩离线玩家；处理期间上线的玩家仍按在线玩家重建
+        for (const auto& playerUuid : task.players) {
+            PlayerKey batchPlayer = PlayerKey::fromString(playerUuid);
+            if (m_refresher && m_cache.isPinned(batchPlayer)) {
+                enqueueTask({CacheInvalidationTaskType::PLAYER_REFRESH, playerUuid});
+            } else {
+                m_cache.invalidatePlayerPermissions(batchPlayer);
+                m_cache.invalidatePlayerGroups(batchPlayer);
+            }
+        }
+        return static_cast<uint32_t>(task.players.size());
     }
+    case CacheInvalidationTaskType::PLAYER_REFRESH: {
+        if (m_refresher) {
+            m_refresher(player);
+        } else {
+            m_cache.invalidatePlayerPermissions(player);
+            m_cache.invalidatePlayerGroups(player);
+        }
+        return 1;
+    }
+    case CacheInvalidationTaskType::ALL_GROUPS_MODIFIED: {
+        // 全局性变化，例如新的权限注册或导入数据。
+        // 它可能合并了若干 GROUP_MODIFIED，所以同样要递增代数，否则依赖旧组数据的玩家组快照会继续生效
+        m_cache.invalidateAllGroupPermissions();
+        m_cache.bumpAllGroupGenerations();
+        m_cache.invalidateAllPlayerPermissions();
+        size_t released = m_cache.releaseAllPlayers();
+        if (m_refresher) {
+            // 剩下的是在线玩家，分发为重建任务
+            for (const auto& cachedPlayer : m_cache.getCachedPlayers()) {
+                enqueueTask({CacheInvalidationTaskType::PLAYER_REFRESH, cachedPlayer.toString()});
+            }
+        }
+        return static_cast<uint32_t>(released);
+    }
+    case CacheInvalidationTaskType::ALL_PLAYERS_MODIFIED: {
+        // 影响所有玩家的变化，例如默认权限值改变。
+        m_cache.invalidateAllPlayerPermissions();
+        return 0;
+    }
+    case CacheInvalidationTaskType::PERMISSION_DEFAULT_CHANGED: {
+        // 玩家快照不包含默认权限，重新载入默认权限层即可
+        m_cache.populateAllPermissionDefaults(m_storage.fetchAllPermissionDefaults());
+        return 0;
+    }
+    case CacheInvalidationTaskType::SHUTDOWN:
+        // 工作线程不再通过任务退出，保留该类型只为兼容
+        return 0;
+    }
+    return 0;
+}
 
-    return std::vector<std::string>(affectedPlayerUuids.begin(), affectedPlayerUuids.end());
+size_t AsyncCacheInvalidator::PendingKeyHash::operator()(const PendingKey& key) const noexcept {
+    size_t hash = key.name.empty() ? PlayerKeyHash{}(key.player) : std::hash<std::string>{}(key.name);
+    return hash ^ (static_cast<size_t>(key.type) * 0x9e3779b97f4a7c15ull);
 }
 
 
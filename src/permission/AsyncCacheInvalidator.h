@@ -1,12 +1,20 @@
 #pragma once
 
 #include "permission/PermissionData.h"
+#include "permission/PlayerKey.h"
+#include <array>
 #include <atomic>
+#include <chrono>
 #include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
 #include <mutex>
-#include <queue>
-#include <set>
+#include <optional>
+#include <string>
 #include <thread>
+#include <unordered_set>
 #include <vector>
 
 
@@ -20,9 +28,22 @@ class PermissionStorage;
 /**
  * @brief 异步缓存失效器，负责在后台线程中处理缓存失效任务。
  *        它通过任务队列和线程池机制，异步地更新权限缓存，以避免阻塞主线程。
+ *
+ *        每个工作线程有自己的一组分道队列，外部线程入队时轮流分配，工作线程产生的任务进入自己的队列；
+ *        工作线程按分道优先级取任务，自己的某一分道为空时先从其他线程的同一分道窃取，再看下一分道。
+ *        因此批量导入产生的大量离线玩家任务不会推迟组修改或在线玩家的任务。
+ *        尚未开始处理的任务按 (类型, 组名或玩家) 合并。
  */
 class AsyncCacheInvalidator {
 public:
+    // 任务的优先级分道，越靠前越先处理
+    enum class Lane : uint8_t {
+        GLOBAL,  // 组修改与全局变化，影响所有持有相关组的玩家
+        ONLINE,  // 在线（被固定）玩家的任务
+        OFFLINE, // 离线玩家的任务与批量任务
+    };
+    static constexpr size_t LANE_COUNT = 3;
+
     /**
      * @brief 构造函数。
      * @param cache 权限缓存的引用。
@@ -48,34 +69,93 @@ public:
      * @param task 要加入队列的任务。
      */
     void enqueueTask(CacheInvalidationTask task);
-
-private:
     /**
-     * @brief 工作线程函数，负责从任务队列中取出并处理任务。
+     * @brief 设置玩家快照的重建函数，设置后启用 refresh-ahead：
+     *        被固定玩家的缓存不再被删除，而是在工作线程中重建后替换。只应在 start 之前调用。
+     * @param refresher 以玩家键调用的重建函数。
+     */
+    void setRefreshHandler(std::function<void(const PlayerKey&)> refresher);
+    /**
+     * @brief 设置任务发布函数，设置后经 enqueueTask 加入的任务（包括被合并的）都会同时交给它，
+     *        用于把本机产生的失效任务同步给共用数据库的其他服务器。PLAYER_REFRESH 只在本机有意义，不会发布。
+     *        只应在 start 之前调用。
+     * @param publisher 以任务调用的发布函数。
+     */
+    void setPublishHandler(std::function<void(const CacheInvalidationTask&)> publisher);
+    /**
+     * @brief 将其他服务器产生的缓存失效任务加入队列，不再发布。
+     * @param task 要加入队列的任务。
+     */
+    void enqueueRemoteTask(CacheInvalidationTask task);
+    /**
+     * @brief 只发布任务而不在本机处理，用于本机缓存已同步更新、只需通知其他服务器的修改。
+     * @param task 要发布的任务。
      */
-    void                     processTasks();
+    void publish(const CacheInvalidationTask& task);
+
+private:
+    // 合并键：任务类型加组名/权限名或玩家键，批量任务不合并
+    struct PendingKey {
+        CacheInvalidationTaskType type;
+        PlayerKey                 player;
+        std::string               name;
+
+        bool operator==(const PendingKey&) const = default;
+    };
+    struct PendingKeyHash {
+        size_t operator()(const PendingKey& key) const noexcept;
+    };
+
+    // 排队中的任务
+    struct QueuedTask {
+        CacheInvalidationTask                 task;
+        PlayerKey                             player; // 单个玩家任务的玩家键
+        Lane                                  lane = Lane::GLOBAL;
+        std::chrono::steady_clock::time_point enqueuedAt;
+    };
+
+    // 一个工作线程的分道队列与休眠状态
+    struct Worker {
+        std::mutex                                     mutex; // 保护 lanes 与 notified
+        std::array<std::deque<QueuedTask>, LANE_COUNT> lanes;
+        std::condition_variable                        wake;
+        std::atomic<bool>                              sleeping = false;
+        bool                                           notified = false; // 休眠期间被唤醒
+    };
+
     /**
-     * @brief 根据组名获取受影响的玩家UUID列表。
-     *        此函数会查询存储层以获取玩家数据。
-     * @param groupName 组名称。
-     * @return 受影响玩家的UUID列表。
+     * @brief 工作线程函数，负责从分道队列中取出并处理任务。
+     * @param index 工作线程的编号。
      */
-    std::vector<std::string> getAffectedPlayersByGroup(const std::string& groupName);
+    void processTasks(size_t index);
+    // 合并并入队任务，不发布
+    void enqueueLocal(CacheInvalidationTask task);
+    // 放入一个工作线程的队列并在需要时唤醒一个休眠的线程
+    void push(QueuedTask task);
+    // 按分道优先级取出一个任务：先取自己的，再从其他线程窃取
+    std::optional<QueuedTask> pop(size_t index);
+    // 唤醒指定的工作线程；它没有休眠时唤醒任意一个休眠的线程来窃取
+    void wakeWorker(size_t preferred);
+    // 执行任务，返回受影响的组数或玩家数
+    uint32_t execute(const QueuedTask& queued);
+    Lane     laneOf(const CacheInvalidationTask& task, const PlayerKey& player) const;
 
     PermissionCache&   m_cache;         
     PermissionStorage& m_storage;      
+    std::function<void(const PlayerKey&)> m_refresher; /**< 玩家快照重建函数，为空时不启用 refresh-ahead */
+    std::function<void(const CacheInvalidationTask&)> m_publisher; /**< 任务发布函数，为空时不发布 */
 
-    std::queue<CacheInvalidationTask> m_taskQueue;     /**< 待处理任务队列 */
-    std::mutex                        m_queueMutex;    /**< 保护任务队列的互斥锁 */
-    std::condition_variable           m_condition;     /**< 用于通知工作线程有新任务的条件变量 */
-    std::vector<std::thread>          m_workerThreads; /**< 工作线程池 */
-    std::atomic<bool>                 m_running = false; /**< 指示失效器是否正在运行的原子标志 */
+    std::vector<std::unique_ptr<Worker>> m_workers;       /**< 每个工作线程的队列 */
+    std::vector<std::thread>             m_workerThreads; /**< 工作线程池 */
+    std::atomic<size_t>                  m_queued     = 0; /**< 所有队列中的任务数，在放入队列之前递增 */
+    std::atomic<size_t>                  m_nextWorker = 0; /**< 外部线程入队时轮流选择的工作线程 */
+    std::array<std::atomic<size_t>, LANE_COUNT> m_laneDepth{}; /**< 各分道的任务数 */
+    std::atomic<bool>                    m_running  = false; /**< 指示失效器是否接受新任务的原子标志 */
+    std::atomic<bool>                    m_stopping = false; /**< 工作线程处理完剩余任务后退出 */
 
     // 任务合并成员
-    std::mutex            m_pendingTasksMutex;      /**< 保护待处理任务集合的互斥锁 */
-    std::set<std::string> m_pendingGroupModifiedTasks; /**< 待处理的组修改任务集合，用于合并 */
-    std::set<std::string> m_pendingPlayerGroupChangedTasks; /**< 待处理的玩家组改变任务集合，用于合并 */
-    bool                  m_allGroupsModifiedPending = false; /**< 标记是否有 ALL_GROUPS_MODIFIED 任务待处理 */
+    std::mutex                                     m_pendingTasksMutex; /**< 保护待处理任务集合的互斥锁 */
+    std::unordered_set<PendingKey, PendingKeyHash> m_pendingTasks;      /**< 已入队、尚未开始处理的任务，用于合并 */
 };
 
 } // namespace internal
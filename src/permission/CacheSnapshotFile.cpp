@@ -0,0 +1,270 @@
+#include "permission/CacheSnapshotFile.h"
+#include "ll/api/io/Logger.h"
+#include "ll/api/mod/NativeMod.h"
+#include <cstring>
+#include <fstream>
+#include <system_error>
+
+namespace BA {
+namespace permission {
+namespace internal {
+
+namespace {
+
+constexpr char     SNAPSHOT_MAGIC[8]      = {'B', 'A', 'C', 'A', 'C', 'H', 'E', '\0'};
+constexpr uint32_t SNAPSHOT_FORMAT_VERSION = 2; // 布局变化时递增，旧文件会被当作无效快照
+// 头部：魔数、格式版本、保留字段、水位、载荷长度、载荷校验和
+constexpr size_t   SNAPSHOT_HEADER_SIZE    = sizeof(SNAPSHOT_MAGIC) + 4 + 4 + 8 + 8 + 8;
+
+// FNV-1a 64 位校验和，用于发现截断或损坏的文件
+uint64_t checksum(std::string_view bytes) {
+    uint64_t hash = 14695981039346656037ull;
+    for (unsigned char c : bytes) {
+        hash ^= c;
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+// 按小端序追加定长整数
+template <typename T>
+void appendInt(std::string& out, T value) {
+    for (size_t i = 0; i < sizeof(T); ++i) {
+        out.push_back(static_cast<char>((static_cast<uint64_t>(value) >> (8 * i)) & 0xFF));
+    }
+}
+
+void appendString(std::string& out, std::string_view value) {
+    appendInt<uint32_t>(out, static_cast<uint32_t>(value.size()));
+    out.append(value);
+}
+
+template <typename T>
+bool readInt(std::string_view& in, T& value) {
+    if (in.size() < sizeof(T)) return false;
+    uint64_t result = 0;
+    for (size_t i = 0; i < sizeof(T); ++i) {
+        result |= static_cast<uint64_t>(static_cast<unsigned char>(in[i])) << (8 * i);
+    }
+    value = static_cast<T>(result);
+    in.remove_prefix(sizeof(T));
+    return true;
+}
+
+bool readString(std::string_view& in, std::string& value) {
+    uint32_t size = 0;
+    if (!readInt(in, size) || in.size() < size) return false;
+    value.assign(in.data(), size);
+    in.remove_prefix(size);
+    return true;
+}
+
+// 读取元素数量，并粗略检查剩余字节是否足够，防止损坏的长度导致巨量分配
+bool readCount(std::string_view& in, uint32_t& count, size_t minBytesPerItem) {
+    if (!readInt(in, count)) return false;
+    return static_cast<uint64_t>(count) * minBytesPerItem <= in.size();
+}
+
+void appendIds(std::string& out, const std::vector<GroupId>& ids) {
+    appendInt<uint32_t>(out, static_cast<uint32_t>(ids.size()));
+    for (GroupId id : ids) appendInt<uint32_t>(out, id);
+}
+
+bool readIds(std::string_view& in, std::vector<GroupId>& ids, size_t nodeCount) {
+    uint32_t count = 0;
+    if (!readCount(in, count, sizeof(uint32_t))) return false;
+    ids.resize(count);
+    for (auto& id : ids) {
+        if (!readInt(in, id) || id >= nodeCount) return false;
+    }
+    return true;
+}
+
+} // namespace
+
+void CacheSnapshotFile::appendGraph(std::string& out, const GroupGraph& graph) {
+    appendInt<uint32_t>(out, static_cast<uint32_t>(graph.m_names.size()));
+    for (const auto& name : graph.m_names) appendString(out, name);
+    for (const auto& node : graph.m_nodes) {
+        appendIds(out, node->parents);
+        appendIds(out, node->children);
+        appendIds(out, node->ancestors);
+        appendIds(out, node->descendants);
+    }
+}
+
+bool CacheSnapshotFile::parseGraph(std::string_view& in, GroupGraph& graph) {
+    uint32_t count = 0;
+    if (!readCount(in, count, sizeof(uint32_t))) return false;
+    graph.m_names.resize(count);
+    graph.m_nodes.clear();
+    graph.m_nodes.reserve(count);
+    graph.m_ids.clear();
+    graph.m_ids.reserve(count);
+    for (GroupId id = 0; id < count; ++id) {
+        if (!readString(in, graph.m_names[id])) return false;
+        if (!graph.m_ids.emplace(graph.m_names[id], id).second) return false; // 组名重复
+    }
+    for (GroupId id = 0; id < count; ++id) {
+        auto& node = *graph.m_nodes.emplace_back(std::make_shared<GroupGraph::Node>());
+        if (!readIds(in, node.parents, count) || !readIds(in, node.children, count)
+            || !readIds(in, node.ancestors, count) || !readIds(in, node.descendants, count)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool CacheSnapshotFile::write(const std::filesystem::path& path, const CacheSnapshotData& data) {
+    auto& logger = ::ll::mod::NativeMod::current()->getLogger();
+
+    std::string payload;
+    appendInt<uint32_t>(payload, static_cast<uint32_t>(data.groupIds.size()));
+    for (const auto& [name, id] : data.groupIds) {
+        appendString(payload, name);
+        appendString(payload, id);
+    }
+    appendGraph(payload, data.graph);
+    appendInt<uint32_t>(payload, static_cast<uint32_t>(data.groupLayers.size()));
+    for (const auto& [groupName, rules] : data.groupLayers) {
+        appendString(payload, groupName);
+        appendInt<uint32_t>(payload, static_cast<uint32_t>(rules.size()));
+        for (const auto& rule : rules) {
+            appendString(payload, rule.pattern);
+            appendInt<uint8_t>(payload, rule.state ? 1 : 0);
+            appendInt<int32_t>(payload, rule.priority);
+        }
+    }
+    appendInt<uint32_t>(payload, static_cast<uint32_t>(data.permissionDefaults.size()));
+    for (const auto& [name, value] : data.permissionDefaults) {
+        appendString(payload, name);
+        appendInt<uint8_t>(payload, value ? 1 : 0);
+    }
+
+    std::string header(SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+    appendInt<uint32_t>(header, SNAPSHOT_FORMAT_VERSION);
+    appendInt<uint32_t>(header, 0); // 保留
+    appendInt<uint64_t>(header, data.watermark);
+    appendInt<uint64_t>(header, payload.size());
+    appendInt<uint64_t>(header, checksum(payload));
+
+    std::error_code ec;
+    if (path.has_parent_path()) std::filesystem::create_directories(path.parent_path(), ec);
+    // 先写临时文件再替换，进程中途退出时不会留下半个快照
+    auto tempPath = path;
+    tempPath += ".tmp";
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        if (!file) {
+            logger.error("CacheSnapshotFile: 无法创建快照文件 '{}'。", tempPath.string());
+            return false;
+        }
+        file.write(header.data(), static_cast<std::streamsize>(header.size()));
+        file.write(payload.data(), static_cast<std::streamsize>(payload.size()));
+        if (!file.flush()) {
+            logger.error("CacheSnapshotFile: 写入快照文件 '{}' 失败。", tempPath.string());
+            return false;
+        }
+    }
+    std::filesystem::rename(tempPath, path, ec);
+    if (ec) {
+        logger.error("CacheSnapshotFile: 替换快照文件 '{}' 失败: {}", path.string(), ec.message());
+        std::filesystem::remove(tempPath, ec);
+        return false;
+    }
+    return true;
+}
+
+std::optional<CacheSnapshotData> CacheSnapshotFile::read(const std::filesystem::path& path) {
+    auto& logger = ::ll::mod::NativeMod::current()->getLogger();
+
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file) return std::nullopt;
+    auto size = static_cast<size_t>(file.tellg());
+    if (size < SNAPSHOT_HEADER_SIZE) {
+        logger.warn("CacheSnapshotFile: 快照文件 '{}' 不完整。", path.string());
+        return std::nullopt;
+    }
+    // 一次性读入整个文件，之后的解析只在内存中进行
+    std::string bytes(size, '\0');
+    file.seekg(0);
+    if (!file.read(bytes.data(), static_cast<std::streamsize>(size))) {
+        logger.warn("CacheSnapshotFile: 读取快照文件 '{}' 失败。", path.string());
+        return std::nullopt;
+    }
+
+    std::string_view in(bytes);
+    if (std::memcmp(in.data(), SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0) {
+        logger.warn("CacheSnapshotFile: '{}' 不是快照文件。", path.string());
+        return std::nullopt;
+    }
+    in.remove_prefix(sizeof(SNAPSHOT_MAGIC));
+
+    CacheSnapshotData data;
+    uint32_t          version = 0, reserved = 0;
+    uint64_t          payloadSize = 0, payloadChecksum = 0;
+    readInt(in, version);
+    readInt(in, reserved);
+    readInt(in, data.watermark);
+    readInt(in, payloadSize);
+    readInt(in, payloadChecksum);
+    if (version != SNAPSHOT_FORMAT_VERSION) {
+        logger.info("CacheSnapshotFile: 快照文件格式版本 {} 与当前版本 {} 不符，忽略。", version, SNAPSHOT_FORMAT_VERSION);
+        return std::nullopt;
+    }
+    if (payloadSize != in.size() || checksum(in) != payloadChecksum) {
+        logger.warn("CacheSnapshotFile: 快照文件 '{}' 校验失败，忽略。", path.string());
+        return std::nullopt;
+    }
+
+    auto corrupted = [&]() -> std::optional<CacheSnapshotData> {
+        logger.warn("CacheSnapshotFile: 快照文件 '{}' 内容损坏，忽略。", path.string());
+        return std::nullopt;
+    };
+
+    uint32_t count = 0;
+    if (!readCount(in, count, 2 * sizeof(uint32_t))) return corrupted();
+    data.groupIds.reserve(count);
+    for (uint32_t i = 0; i < count; ++i) {
+        std::string name, id;
+        if (!readString(in, name) || !readString(in, id)) return corrupted();
+        data.groupIds.emplace(std::move(name), std::move(id));
+    }
+
+    if (!parseGraph(in, data.graph)) return corrupted();
+
+    if (!readCount(in, count, 2 * sizeof(uint32_t))) return corrupted();
+    data.groupLayers.reserve(count);
+    for (uint32_t i = 0; i < count; ++i) {
+        std::string groupName;
+        uint32_t    ruleCount = 0;
+        if (!readString(in, groupName) || !readCount(in, ruleCount, 2 * sizeof(uint32_t) + 1)) return corrupted();
+        std::vector<RankedPermissionRule> rules;
+        rules.reserve(ruleCount);
+        for (uint32_t j = 0; j < ruleCount; ++j) {
+            std::string pattern;
+            uint8_t     state    = 0;
+            int32_t     priority = 0;
+            if (!readString(in, pattern) || !readInt(in, state) || !readInt(in, priority)) return corrupted();
+            // 组权限层要求模式按字典序排列且互不相同
+            if (!rules.empty() && !(rules.back().pattern < pattern)) return corrupted();
+            rules.push_back({std::move(pattern), state != 0, priority});
+        }
+        data.groupLayers.emplace_back(std::move(groupName), std::move(rules));
+    }
+
+    if (!readCount(in, count, sizeof(uint32_t) + 1)) return corrupted();
+    data.permissionDefaults.reserve(count);
+    for (uint32_t i = 0; i < count; ++i) {
+        std::string name;
+        uint8_t     value = 0;
+        if (!readString(in, name) || !readInt(in, value)) return corrupted();
+        data.permissionDefaults.emplace(std::move(name), value != 0);
+    }
+    if (!in.empty()) return corrupted();
+    return data;
+}
+
+} // namespace internal
+} // namespace permission
+} // namespace BA
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "permission/GroupGraph.h"
+#include "permission/PermissionData.h"
+#include "permission/PermissionSnapshot.h"
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace BA {
+namespace permission {
+namespace internal {
+
+/**
+ * @brief 快照文件中保存的编译缓存。
+ *        只包含与玩家无关、可由数据库完全重建的部分：组名表、继承关系图（含闭包）、
+ *        各组编译后的权限层与权限默认值。
+ */
+struct CacheSnapshotData {
+    uint64_t                                     watermark = 0; // 写入时数据库的变更水位
+    std::unordered_map<std::string, std::string> groupIds;      // 组名到组ID的映射
+    GroupGraph                                   graph;         // 继承关系图
+    // 组名及其按模式字典序排列、带来源优先级的生效规则
+    std::vector<std::pair<std::string, std::vector<RankedPermissionRule>>> groupLayers;
+    std::unordered_map<std::string, bool>                                    permissionDefaults; // 权限名到默认值的映射
+};
+
+/**
+ * @brief 编译缓存快照文件的读写。
+ *        文件为紧凑的二进制格式：固定头部（魔数、格式版本、水位、长度与校验和）之后是各段数据。
+ *        写入先写临时文件再重命名，读取时一次性读入整个文件并校验，任何不一致都视为无效快照。
+ */
+class CacheSnapshotFile {
+public:
+    /**
+     * @brief 写入快照文件。
+     * @param path 文件路径，所在目录不存在时自动创建。
+     * @param data 要写入的缓存。
+     * @return 写入成功返回 true。
+     */
+    static bool write(const std::filesystem::path& path, const CacheSnapshotData& data);
+
+    /**
+     * @brief 读取快照文件。
+     * @param path 文件路径。
+     * @return 解析出的缓存；文件不存在、格式版本不符或内容损坏时返回 std::nullopt。
+     */
+    static std::optional<CacheSnapshotData> read(const std::filesystem::path& path);
+
+private:
+    // 继承关系图的编码需要访问 GroupGraph 的内部节点，因此作为友元成员实现
+    static void appendGraph(std::string& out, const GroupGraph& graph);
+    static bool parseGraph(std::string_view& in, GroupGraph& graph);
+};
+
+} // namespace internal
+} // namespace permission
+} // namespace BA
@@ -0,0 +1,409 @@
+#include "permission/CallRecorder.h"
+#include "ll/api/io/Logger.h"
+#include "ll/api/mod/NativeMod.h"
+#include "permission/Metrics.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <limits>
+#include <system_error>
+#include <thread>
+#include <unordered_map>
+
+namespace BA {
+namespace permission {
+namespace internal {
+
+namespace {
+
+constexpr char     RECORDING_MAGIC[8]       = {'B', 'A', 'C', 'A', 'L', 'L', 'S', '\0'};
+constexpr uint32_t RECORDING_FORMAT_VERSION = 1; // 布局变化时递增，ba-replay 拒绝读取其他版本
+// 头部：魔数、格式版本、抽样率（百万分之一）、开始时间（Unix 毫秒）
+constexpr size_t   RECORDING_HEADER_SIZE    = sizeof(RECORDING_MAGIC) + 4 + 4 + 8;
+constexpr size_t   FLUSH_THRESHOLD          = 64 * 1024; // 缓冲区达到该大小时唤醒写入线程
+// 字符串表超过该数量时写入 RESET 并清空，限制长时间录制时录制端的内存
+constexpr size_t   MAX_INTERNED_STRINGS     = size_t{1} << 20;
+
+const char* const OP_NAMES[] = {
+    "reset",
+    "hasPermission",
+    "hasPermission(id)",
+    "hasPermissions",
+    "getOnlinePlayersWithPermission",
+    "getAllPermissionsForPlayer",
+    "getPlayerGroups",
+    "getPlayersInGroup",
+    "addPlayerToGroup",
+    "removePlayerFromGroup",
+    "addPermissionToGroup",
+    "removePermissionFromGroup",
+    "addGroupInheritance",
+    "removeGroupInheritance",
+    "setGroupPriority",
+    "createGroup",
+    "deleteGroup",
+    "playerOnline",
+    "playerOffline",
+};
+static_assert(std::size(OP_NAMES) == static_cast<size_t>(RecordedOp::OP_COUNT));
+
+template <typename T>
+void appendInt(std::string& out, T value) {
+    for (size_t i = 0; i < sizeof(T); ++i) {
+        out.push_back(static_cast<char>((static_cast<uint64_t>(value) >> (8 * i)) & 0xFF));
+    }
+}
+
+template <typename T>
+bool readInt(std::string_view& in, T& value) {
+    if (in.size() < sizeof(T)) return false;
+    uint64_t result = 0;
+    for (size_t i = 0; i < sizeof(T); ++i) {
+        result |= static_cast<uint64_t>(static_cast<unsigned char>(in[i])) << (8 * i);
+    }
+    value = static_cast<T>(result);
+    in.remove_prefix(sizeof(T));
+    return true;
+}
+
+// 每字节 7 位、低位在前的变长整数，小于 128 的值只占一个字节
+void appendVarint(std::string& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<char>((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+bool readVarint(std::string_view& in, uint64_t& value) {
+    value = 0;
+    for (unsigned shift = 0; shift < 64 && !in.empty(); shift += 7) {
+        auto byte = static_cast<unsigned char>(in.front());
+        in.remove_prefix(1);
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) return true;
+    }
+    return false;
+}
+
+uint64_t zigzag(int64_t value) { return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63); }
+int64_t  unzigzag(uint64_t value) { return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1); }
+
+uint64_t mix64(uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xBF58476D1CE4E5B9ull;
+    x ^= x >> 27;
+    x *= 0x94D049BB133111EBull;
+    return x ^ (x >> 31);
+}
+
+struct TransparentStringHash {
+    using is_transparent = void;
+    size_t operator()(std::string_view value) const { return std::hash<std::string_view>{}(value); }
+};
+
+} // namespace
+
+const char* recordedOpName(RecordedOp op) {
+    auto index = static_cast<size_t>(op);
+    return index < std::size(OP_NAMES) ? OP_NAMES[index] : "unknown";
+}
+
+struct CallRecorder::Session {
+    using StringTable = std::unordered_map<std::string, uint32_t, TransparentStringHash, std::equal_to<>>;
+
+    std::filesystem::path                 path;
+    std::ofstream                         file;
+    double                                sampleRate   = 1;
+    uint64_t                              maxBytes     = 0;
+    std::chrono::steady_clock::time_point started;
+    uint64_t                              lastMicros   = 0; // 上一条记录的时间，记录中只保存差值
+    std::string                           buffer;           // 等待写入文件的记录
+    StringTable                           strings;          // 已写出的字符串及其编号
+    uint64_t                              calls        = 0;
+    uint64_t                              bytes        = 0; // 已写入文件的字节数
+    uint64_t                              skippedStart = 0; // 开始录制时 m_skipped 的值
+    bool                                  stopping     = false;
+    std::condition_variable               wake;
+    std::thread                           writer;
+};
+
+CallRecorder::CallRecorder() = default;
+
+CallRecorder::~CallRecorder() { stop(); }
+
+bool CallRecorder::start(const std::filesystem::path& path, double sampleRate, uint64_t maxBytes) {
+    stop();
+    auto& logger = ::ll::mod::NativeMod::current()->getLogger();
+
+    auto session        = std::make_unique<Session>();
+    session->path       = path;
+    session->sampleRate = sampleRate > 0 && sampleRate < 1 ? sampleRate : 1;
+    session->maxBytes   = maxBytes;
+    std::error_code ec;
+    if (path.has_parent_path()) std::filesystem::create_directories(path.parent_path(), ec);
+    session->file.open(path, std::ios::binary | std::ios::trunc);
+    if (!session->file) {
+        logger.error("CallRecorder: 无法创建录制文件 '{}'。", path.string());
+        return false;
+    }
+
+    std::string header(RECORDING_MAGIC, sizeof(RECORDING_MAGIC));
+    appendInt<uint32_t>(header, RECORDING_FORMAT_VERSION);
+    appendInt<uint32_t>(header, static_cast<uint32_t>(session->sampleRate * 1e6));
+    appendInt<uint64_t>(
+        header,
+        static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch())
+                .count()
+        )
+    );
+    session->file.write(header.data(), static_cast<std::streamsize>(header.size()));
+    session->bytes        = header.size();
+    session->started      = std::chrono::steady_clock::now();
+    session->skippedStart = m_skipped.value();
+
+    m_sampleThreshold.store(
+        session->sampleRate >= 1 ? std::numeric_limits<uint64_t>::max()
+                                 : static_cast<uint64_t>(session->sampleRate * 18446744073709551616.0),
+        std::memory_order_relaxed
+    );
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_session         = std::move(session);
+    m_session->writer = std::thread([this, raw = m_session.get()] { writerLoop(*raw); });
+    m_active.store(true, std::memory_order_relaxed);
+    logger.info("CallRecorder: 开始录制到 '{}'，检查与查询的抽样率为 {}。", path.string(), m_session->sampleRate);
+    return true;
+}
+
+CallRecordingStats CallRecorder::stop() {
+    std::unique_ptr<Session> session;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_session) return m_lastStats;
+        m_active.store(false, std::memory_order_relaxed);
+        session           = std::move(m_session);
+        session->stopping = true;
+    }
+    session->wake.notify_one();
+    if (session->writer.joinable()) session->writer.join(); // 写入线程退出前写完缓冲区
+    session->file.close();
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_lastStats = {
+        false,
+        session->path.string(),
+        session->sampleRate,
+        session->calls,
+        m_skipped.value() - session->skippedStart,
+        session->bytes
+    };
+    ::ll::mod::NativeMod::current()->getLogger().info(
+        "CallRecorder: 录制结束，共 {} 次调用、{} 字节，写入 '{}'。",
+        m_lastStats.calls,
+        m_lastStats.bytes,
+        m_lastStats.path
+    );
+    return m_lastStats;
+}
+
+CallRecordingStats CallRecorder::stats() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_session) return m_lastStats;
+    return {
+        m_active.load(std::memory_order_relaxed),
+        m_session->path.string(),
+        m_session->sampleRate,
+        m_session->calls,
+        m_skipped.value() - m_session->skippedStart,
+        m_session->bytes
+    };
+}
+
+bool CallRecorder::sampled(RecordedOp op, std::string_view first) const {
+    if (isRecordedMutation(op)) return true;
+    uint64_t threshold = m_sampleThreshold.load(std::memory_order_relaxed);
+    if (threshold == std::numeric_limits<uint64_t>::max()) return true;
+    uint64_t hash;
+    if (op == RecordedOp::ONLINE_PLAYERS_WITH_PERMISSION || op == RecordedOp::GET_PLAYERS_IN_GROUP) {
+        // 没有玩家参数，按调用随机抽样
+        thread_local uint64_t state = mix64(std::hash<std::thread::id>{}(std::this_thread::get_id()));
+        hash                        = mix64(state += 0x9E3779B97F4A7C15ull);
+    } else {
+        hash = mix64(std::hash<std::string_view>{}(first));
+    }
+    if (hash < threshold) return true;
+    m_skipped.add();
+    return false;
+}
+
+void CallRecorder::record(RecordedOp op, std::initializer_list<std::string_view> args, int64_t value) {
+    if (!active() || !sampled(op, args.size() > 0 ? *args.begin() : std::string_view{})) return;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_session || !active()) return;
+    appendLocked(op, args.begin(), args.size(), value);
+}
+
+void CallRecorder::record(RecordedOp op, std::string_view first, const std::vector<std::string_view>& rest) {
+    if (!active() || !sampled(op, first)) return;
+    std::vector<std::string_view> args;
+    args.reserve(rest.size() + 1);
+    args.push_back(first);
+    args.insert(args.end(), rest.begin(), rest.end());
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_session || !active()) return;
+    appendLocked(op, args.data(), args.size(), 0);
+}
+
+void CallRecorder::appendLocked(RecordedOp op, const std::string_view* args, size_t count, int64_t value) {
+    auto& session = *m_session;
+    if (session.strings.size() + count > MAX_INTERNED_STRINGS) {
+        session.buffer.push_back(static_cast<char>(RecordedOp::RESET));
+        session.strings.clear();
+    }
+    // 在锁内取时间，保证记录按时间排序、差值非负
+    auto micros = static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - session.started)
+            .count()
+    );
+    session.buffer.push_back(static_cast<char>(op));
+    appendVarint(session.buffer, micros - session.lastMicros);
+    appendVarint(session.buffer, zigzag(value));
+    appendVarint(session.buffer, count);
+    for (size_t i = 0; i < count; ++i) appendStringLocked(args[i]);
+    session.lastMicros = micros;
+    ++session.calls;
+    if (session.buffer.size() >= FLUSH_THRESHOLD) session.wake.notify_one();
+}
+
+void CallRecorder::appendStringLocked(std::string_view value) {
+    auto& session = *m_session;
+    if (auto it = session.strings.find(value); it != session.strings.end()) {
+        appendVarint(session.buffer, it->second);
+        return;
+    }
+    auto id = static_cast<uint32_t>(session.strings.size());
+    session.strings.emplace(std::string(value), id);
+    appendVarint(session.buffer, id); // 编号等于已有字符串数，表示其后紧跟内容
+    appendVarint(session.buffer, value.size());
+    session.buffer.append(value);
+}
+
+void CallRecorder::writerLoop(Session& session) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true) {
+        session.wake.wait_for(lock, std::chrono::seconds(1), [&session] {
+            return session.stopping || session.buffer.size() >= FLUSH_THRESHOLD;
+        });
+        bool        stopping = session.stopping;
+        std::string chunk;
+        chunk.swap(session.buffer);
+        lock.unlock();
+
+        bool failed = false;
+        if (!chunk.empty()) {
+            session.file.write(chunk.data(), static_cast<std::streamsize>(chunk.size()));
+            failed = !session.file.flush();
+        }
+
+        lock.lock();
+        session.bytes += chunk.size();
+        if (!stopping && active() && (failed || (session.maxBytes > 0 && session.bytes >= session.maxBytes))) {
+            m_active.store(false, std::memory_order_relaxed); // 之后的调用不再录制，文件保留到 stop
+            auto& logger = ::ll::mod::NativeMod::current()->getLogger();
+            if (failed) {
+                logger.error("CallRecorder: 写入录制文件 '{}' 失败，已停止录制。", session.path.string());
+            } else {
+                logger.warn("CallRecorder: 录制文件达到 {} 字节上限，已停止录制。", session.maxBytes);
+            }
+        }
+        if (stopping) return;
+    }
+}
+
+std::optional<RecordedLog> CallRecorder::read(const std::filesystem::path& path, std::string& error) {
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file) {
+        error = "无法打开文件";
+        return std::nullopt;
+    }
+    auto        size = static_cast<size_t>(file.tellg());
+    std::string bytes(size, '\0');
+    file.seekg(0);
+    if (!file.read(bytes.data(), static_cast<std::streamsize>(size))) {
+        error = "读取文件失败";
+        return std::nullopt;
+    }
+
+    std::string_view in(bytes);
+    if (in.size() < RECORDING_HEADER_SIZE || std::memcmp(in.data(), RECORDING_MAGIC, sizeof(RECORDING_MAGIC)) != 0) {
+        error = "不是录制文件";
+        return std::nullopt;
+    }
+    in.remove_prefix(sizeof(RECORDING_MAGIC));
+    RecordedLog log;
+    uint32_t    version = 0, ratePpm = 0;
+    readInt(in, version);
+    readInt(in, ratePpm);
+    readInt(in, log.startedAtMillis);
+    if (version != RECORDING_FORMAT_VERSION) {
+        error = "录制文件格式版本 " + std::to_string(version) + " 与当前版本 "
+              + std::to_string(RECORDING_FORMAT_VERSION) + " 不符";
+        return std::nullopt;
+    }
+    log.sampleRate = ratePpm / 1e6;
+
+    std::vector<uint32_t> local; // 文件内的字符串编号 -> log.strings 的下标，RESET 时清空
+    uint64_t              clock = 0;
+    while (!in.empty()) {
+        auto op = static_cast<RecordedOp>(static_cast<unsigned char>(in.front()));
+        in.remove_prefix(1);
+        if (op == RecordedOp::RESET) {
+            local.clear();
+            continue;
+        }
+        if (op >= RecordedOp::OP_COUNT) {
+            error = "未知的调用类型 " + std::to_string(static_cast<unsigned>(op));
+            return std::nullopt;
+        }
+        // 录制中途进程退出时最后一条记录可能不完整，读到无法解析处为止
+        RecordedCall call;
+        uint64_t     delta = 0, value = 0, count = 0;
+        if (!readVarint(in, delta) || !readVarint(in, value) || !readVarint(in, count) || count > in.size()) {
+            log.truncated = true;
+            break;
+        }
+        call.args.reserve(count);
+        for (uint64_t i = 0; i < count && !log.truncated; ++i) {
+            uint64_t id = 0;
+            if (!readVarint(in, id) || id > local.size()) {
+                log.truncated = true;
+            } else if (id < local.size()) {
+                call.args.push_back(local[id]);
+            } else {
+                uint64_t length = 0;
+                if (!readVarint(in, length) || length > in.size()) {
+                    log.truncated = true;
+                    break;
+                }
+                local.push_back(static_cast<uint32_t>(log.strings.size()));
+                log.strings.emplace_back(in.substr(0, length));
+                in.remove_prefix(length);
+                call.args.push_back(local.back());
+            }
+        }
+        if (log.truncated) break;
+        clock             += delta;
+        call.offsetMicros  = clock;
+        call.op            = op;
+        call.value         = unzigzag(value);
+        log.calls.push_back(std::move(call));
+    }
+    return log;
+}
+
+} // namespace internal
+} // namespace permission
+} // namespace BA
@@ -0,0 +1,150 @@
+#pragma once
+
+#include "permission/Metrics.h"
+#include "permission/PermissionData.h"
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <initializer_list>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace BA {
+namespace permission {
+namespace internal {
+
+/**
+ * @brief 录制的 API 调用类型。编号写入录制文件，只能追加不能修改。
+ *        参数按注释中的顺序保存在 RecordedCall::args 中。
+ */
+enum class RecordedOp : uint8_t {
+    RESET = 0, // 录制端清空了字符串表，之后的字符串编号重新从 0 开始（仅文件内部使用）
+
+    // 检查与查询：按抽样率录制
+    HAS_PERMISSION = 1,             // 玩家, 节点；value 为结果
+    HAS_PERMISSION_ID,              // 玩家, 节点（按 PermissionId 检查，记录的是节点名）；value 为结果
+    HAS_PERMISSIONS,                // 玩家, 节点...
+    ONLINE_PLAYERS_WITH_PERMISSION, // 节点
+    GET_ALL_PERMISSIONS,            // 玩家
+    GET_PLAYER_GROUPS,              // 玩家
+    GET_PLAYERS_IN_GROUP,           // 组
+
+    // 修改与上下线：总是录制，回放时数据才能保持一致
+    ADD_PLAYER_TO_GROUP,          // 玩家, 组；value 为有效时长（秒），0 表示永久
+    REMOVE_PLAYER_FROM_GROUP,     // 玩家, 组
+    ADD_PERMISSION_TO_GROUP,      // 组, 规则
+    REMOVE_PERMISSION_FROM_GROUP, // 组, 规则
+    ADD_GROUP_INHERITANCE,        // 组, 父组
+    REMOVE_GROUP_INHERITANCE,     // 组, 父组
+    SET_GROUP_PRIORITY,           // 组；value 为优先级
+    CREATE_GROUP,                 // 组
+    DELETE_GROUP,                 // 组
+    PLAYER_ONLINE,                // 玩家；value 为 1 表示 prefetchPlayer，0 表示 pinPlayer
+    PLAYER_OFFLINE,               // 玩家
+
+    OP_COUNT
+};
+
+// 调用类型的名称，用于回放报告
+const char* recordedOpName(RecordedOp op);
+// 是否为修改或上下线（总是录制）
+inline bool isRecordedMutation(RecordedOp op) { return op >= RecordedOp::ADD_PLAYER_TO_GROUP; }
+
+// 读回的一次调用，字符串参数是 RecordedLog::strings 中的下标
+struct RecordedCall {
+    uint64_t              offsetMicros = 0; // 相对录制开始的时间（微秒）
+    RecordedOp            op           = RecordedOp::RESET;
+    int64_t               value        = 0;
+    std::vector<uint32_t> args;
+};
+
+// 读回的整个录制文件
+struct RecordedLog {
+    uint64_t                  startedAtMillis = 0; // 录制开始时的 Unix 时间（毫秒）
+    double                    sampleRate      = 1; // 检查与查询的抽样率
+    std::vector<std::string>  strings;             // 去重后的字符串参数
+    std::vector<RecordedCall> calls;               // 按时间排序
+    bool                      truncated = false;   // 文件末尾有不完整的记录（录制中途进程退出），已忽略
+};
+
+/**
+ * @brief API 调用录制器：把检查、查询与修改调用连同时间戳写入紧凑的二进制文件，供 ba-replay 回放。
+ *        文件为固定头部（魔数、格式版本、开始时间、抽样率）之后的变长记录：
+ *        调用类型、与上一条的时间差（微秒，varint）、整数参数（zigzag varint）与字符串参数；
+ *        字符串参数在第一次出现时写出内容，之后只写编号，玩家 UUID 与节点名各只保存一次。
+ *        记录先追加到内存缓冲区，由后台线程每秒或积累 64KB 时写入文件，调用线程不做文件 I/O。
+ *        检查与查询按第一个参数（玩家 UUID）的哈希抽样，同一玩家的调用要么全部录制要么全部跳过，
+ *        保留每个玩家的访问顺序；没有玩家参数的查询按调用随机抽样。
+ */
+class CallRecorder {
+public:
+    CallRecorder();
+    ~CallRecorder();
+
+    CallRecorder(const CallRecorder&)            = delete;
+    CallRecorder& operator=(const CallRecorder&) = delete;
+
+    /**
+     * @brief 开始录制，已在录制时先停止之前的录制。
+     * @param path 录制文件路径，已存在时覆盖。
+     * @param sampleRate 检查与查询的抽样率（0~1]；修改与上下线总是录制。
+     * @param maxBytes 文件大小上限，达到后自动停止录制；0 表示不限制。
+     * @return 无法创建文件时返回 false。
+     */
+    bool start(const std::filesystem::path& path, double sampleRate, uint64_t maxBytes);
+    /**
+     * @brief 停止录制，把缓冲区中剩余的记录写入文件后返回。
+     * @return 本次录制的统计；未在录制时返回上一次录制的统计。
+     */
+    CallRecordingStats stop();
+    // 当前或上一次录制的统计
+    CallRecordingStats stats() const;
+
+    // 是否正在录制；调用方据此跳过参数准备，未录制时开销只有一次 relaxed 读取
+    bool active() const { return m_active.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief 录制一次调用，未被抽中或未在录制时什么也不做。
+     * @param op 调用类型。
+     * @param args 字符串参数，含义见 RecordedOp。
+     * @param value 整数参数，含义见 RecordedOp。
+     */
+    void record(RecordedOp op, std::initializer_list<std::string_view> args, int64_t value = 0);
+    // 与上面相同，额外追加一组字符串参数（HAS_PERMISSIONS 的节点列表）
+    void record(RecordedOp op, std::string_view first, const std::vector<std::string_view>& rest);
+
+    /**
+     * @brief 读取录制文件。
+     * @param path 文件路径。
+     * @param error 失败时写入原因。
+     * @return 读回的调用；文件不存在、不是录制文件或格式版本不符时返回 std::nullopt。
+     */
+    static std::optional<RecordedLog> read(const std::filesystem::path& path, std::string& error);
+
+private:
+    struct Session; // 一次录制的文件、缓冲区、字符串表与写入线程
+
+    bool sampled(RecordedOp op, std::string_view first) const;
+    // 追加一条记录，调用方需持有 m_mutex 且 m_session 非空
+    void appendLocked(RecordedOp op, const std::string_view* args, size_t count, int64_t value);
+    void appendStringLocked(std::string_view value);
+    void writerLoop(Session& session);
+
+    std::atomic<bool>     m_active{false};
+    // 检查与查询的抽样阈值：哈希值小于阈值时录制，最大值表示全部录制
+    std::atomic<uint64_t> m_sampleThreshold{std::numeric_limits<uint64_t>::max()};
+    mutable Counter       m_skipped; // 未被抽中的调用数，分条带计数，避免各线程争用同一缓存行
+
+    mutable std::mutex       m_mutex;
+    std::unique_ptr<Session> m_session;
+    CallRecordingStats       m_lastStats; // 上一次录制结束时的统计
+};
+
+} // namespace internal
+} // namespace permission
+} // namespace BA
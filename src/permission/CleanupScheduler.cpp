@@ -2,6 +2,7 @@
 #include "ll/api/io/Logger.h"
 #include "ll/api/mod/NativeMod.h"
 #include "permission/PermissionManager.h" 
+#include <algorithm>
 
 namespace BA {
 namespace permission {
@@ -35,8 +36,9 @@ void CleanupScheduler::start() {
         return;
     }
     m_running = true;
+    PermissionManager::getInstance().setExpirationWakeHandler([this] { wake(); });
     m_workerThread = std::thread(&CleanupScheduler::run, this);
-    ::ll::mod::NativeMod::current()->getLogger().info("CleanupScheduler: 已启动，清理间隔为 {} 秒。", m_intervalSeconds);
+    ::ll::mod::NativeMod::current()->getLogger().info("CleanupScheduler: 已启动，兜底清理间隔为 {} 秒。", m_intervalSeconds);
 }
 
 /**
@@ -48,7 +50,11 @@ void CleanupScheduler::stop() {
         return;
     }
 
-    m_running = false; // 设置停止标志
+    PermissionManager::getInstance().setExpirationWakeHandler({});
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_running = false; // 设置停止标志
+    }
     m_condition.notify_one(); // 唤醒等待中的线程
 
     if (m_workerThread.joinable()) {
@@ -59,26 +65,48 @@ void CleanupScheduler::stop() {
 }
 
 /**
- * @brief 工作线程函数，负责周期性地调用清理任务。
+ * @brief 唤醒工作线程重新计算下一次醒来的时间。
+ */
+void CleanupScheduler::wake() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_wakeRequested = true;
+    }
+    m_condition.notify_one();
+}
+
+/**
+ * @brief 工作线程函数，在最早的过期时间或兜底清理时间到达时调用清理任务。
  */
 void CleanupScheduler::run() {
     auto& logger = ::ll::mod::NativeMod::current()->getLogger();
     logger.debug("CleanupScheduler: 工作线程开始运行。");
 
+    using Clock      = std::chrono::system_clock;
+    auto& manager    = PermissionManager::getInstance();
+    auto  nextSweep  = Clock::now(); // 启动时先执行一次兜底清理
     while (m_running) {
         try {
-            // 执行清理任务
-            PermissionManager::getInstance().runPeriodicCleanup();
-            logger.debug("CleanupScheduler: 已执行一次定期清理任务。");
+            if (Clock::now() >= nextSweep) {
+                manager.runPeriodicCleanup();
+                nextSweep = Clock::now() + std::chrono::seconds(m_intervalSeconds);
+                logger.debug("CleanupScheduler: 已执行一次兜底清理任务。");
+            }
+            manager.processDueExpirations();
         } catch (const std::exception& e) {
             logger.error("CleanupScheduler: 执行清理任务失败，异常: {}", e.what());
         } catch (...) {
             logger.error("CleanupScheduler: 执行清理任务失败，发生未知异常。");
         }
 
-        // 等待下一个周期，或者被停止信号唤醒
+        // 睡眠到最早的过期时间或下一次兜底清理，期间可被停止信号或更早的过期时间唤醒
+        auto wakeAt = nextSweep;
+        if (auto deadline = manager.getNextExpiration()) {
+            wakeAt = std::min(wakeAt, Clock::time_point(std::chrono::seconds(*deadline)));
+        }
         std::unique_lock<std::mutex> lock(m_mutex);
-        m_condition.wait_for(lock, std::chrono::seconds(m_intervalSeconds), [this] { return !m_running; });
+        m_condition.wait_until(lock, wakeAt, [this] { return !m_running || m_wakeRequested; });
+        m_wakeRequested = false;
     }
     logger.debug("CleanupScheduler: 工作线程退出。");
 }
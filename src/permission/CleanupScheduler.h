@@ -13,14 +13,15 @@ namespace permission {
 class PermissionManager; 
 
 /**
- * @brief CleanupScheduler 类负责定期触发权限管理器的清理任务。
- *        它使用一个独立的线程来执行周期性操作，避免阻塞主线程。
+ * @brief CleanupScheduler 类负责触发权限管理器的清理任务。
+ *        它使用一个独立的线程，睡眠到到期队列中最早的过期时间后按键删除到期的玩家组关系；
+ *        全表扫描的定期清理只作为兜底，按较长的间隔执行。
  */
 class CleanupScheduler {
 public:
     /**
      * @brief 构造函数。
-     * @param intervalSeconds 清理任务的执行间隔（秒）。
+     * @param intervalSeconds 兜底全表清理的执行间隔（秒）。
      */
     explicit CleanupScheduler(long long intervalSeconds);
 
@@ -41,15 +42,20 @@ public:
 
 private:
     /**
-     * @brief 工作线程函数，负责周期性地调用清理任务。
+     * @brief 工作线程函数，在最早的过期时间或兜底清理时间到达时调用清理任务。
      */
     void run();
+    /**
+     * @brief 唤醒工作线程重新计算下一次醒来的时间。
+     */
+    void wake();
 
     std::atomic<bool> m_running;           /**< 指示调度器是否正在运行的原子标志 */
     std::thread       m_workerThread;      /**< 执行清理任务的工作线程 */
     std::mutex        m_mutex;             /**< 保护条件变量的互斥锁 */
-    std::condition_variable m_condition;   /**< 用于通知工作线程停止的条件变量 */
-    long long         m_intervalSeconds;   /**< 清理任务的执行间隔（秒） */
+    std::condition_variable m_condition;   /**< 用于通知工作线程停止或提前醒来的条件变量 */
+    bool              m_wakeRequested = false; /**< 最早的过期时间已提前，受 m_mutex 保护 */
+    long long         m_intervalSeconds;   /**< 兜底全表清理的执行间隔（秒） */
 };
 
 } // namespace permission
@@ -0,0 +1,219 @@
+#include "permission/ClusterInvalidator.h"
+#include "db/IDatabase.h"
+#include "ll/api/io/Logger.h"
+#include "ll/api/mod/NativeMod.h"
+#include "permission/PermissionStorage.h"
+#include "permission/Trace.h"
+#include <algorithm>
+#include <cstdio>
+#include <random>
+
+namespace BA {
+namespace permission {
+namespace internal {
+
+namespace {
+
+constexpr const char* NOTIFY_CHANNEL        = "ba_cache_invalidation";
+constexpr size_t      POLL_BATCH_SIZE       = 1000;  // 每次最多读取的日志记录数
+constexpr long long   GRACE_SECONDS         = 5;     // 读取位置不越过最近这么多秒内的记录
+constexpr long long   LOG_RETENTION_SECONDS = 3600;  // 日志保留时间
+constexpr size_t      MAX_OUTBOUND          = 10000; // 数据库不可用时最多积压的待发布任务数
+constexpr auto        PRUNE_INTERVAL        = std::chrono::seconds(60);
+constexpr auto        LISTEN_SLICE          = std::chrono::milliseconds(100); // 监听模式下写出待发布任务的最长延迟
+
+std::string generateNodeId() {
+    std::random_device rd;
+    std::mt19937_64    rng((static_cast<uint64_t>(rd()) << 32) ^ rd());
+    char               buffer[17];
+    std::snprintf(buffer, sizeof(buffer), "%016llx", static_cast<unsigned long long>(rng()));
+    return buffer;
+}
+
+long long unixNow() {
+    return std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch())
+        .count();
+}
+
+// 只接受可以跨服务器传递的任务类型，其他版本写入的未知类型直接忽略
+bool isTransportable(CacheInvalidationTaskType type) {
+    switch (type) {
+    case CacheInvalidationTaskType::GROUP_MODIFIED:
+    case CacheInvalidationTaskType::PLAYER_GROUP_CHANGED:
+    case CacheInvalidationTaskType::ALL_GROUPS_MODIFIED:
+    case CacheInvalidationTaskType::ALL_PLAYERS_MODIFIED:
+    case CacheInvalidationTaskType::PLAYER_BATCH_GROUP_CHANGED:
+    case CacheInvalidationTaskType::PERMISSION_DEFAULT_CHANGED:
+        return true;
+    default:
+        return false;
+    }
+}
+
+} // namespace
+
+ClusterInvalidator::ClusterInvalidator(
+    PermissionStorage&        storage,
+    std::chrono::milliseconds pollInterval,
+    RemoteTaskHandler         onRemoteTasks
+)
+: m_storage(storage),
+  m_pollInterval(std::max(pollInterval, std::chrono::milliseconds(10))),
+  m_onRemoteTasks(std::move(onRemoteTasks)),
+  m_nodeId(generateNodeId()) {}
+
+ClusterInvalidator::~ClusterInvalidator() { stop(); }
+
+void ClusterInvalidator::start(long long afterId) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_running) return;
+    m_scanFrom = afterId;
+    m_seenIds.clear();
+    m_running = true;
+    m_thread  = std::thread(&ClusterInvalidator::run, this);
+    ::ll::mod::NativeMod::current()->getLogger().info("ClusterInvalidator: 已启动，节点ID {}。", m_nodeId);
+}
+
+void ClusterInvalidator::stop() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_running) return;
+        m_running = false;
+    }
+    m_wakeup.notify_all();
+    if (m_thread.joinable()) m_thread.join(); // 后台线程退出前会写出剩余的任务
+}
+
+void ClusterInvalidator::publish(const CacheInvalidationTask& task) {
+    if (!isTransportable(task.type)) return;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_running) return;
+        if (task.type != CacheInvalidationTaskType::PLAYER_BATCH_GROUP_CHANGED
+            && !m_outboundKeys.emplace(task.type, task.data).second) {
+            return; // 相同的任务还未写出
+        }
+        if (m_outbound.size() >= MAX_OUTBOUND) {
+            ::ll::mod::NativeMod::current()->getLogger().warn(
+                "ClusterInvalidator: 待发布任务过多，丢弃任务（类型: {}, 数据: '{}'）。",
+                static_cast<int>(task.type),
+                task.data
+            );
+            return;
+        }
+        m_outbound.push_back(task);
+    }
+    m_wakeup.notify_one();
+}
+
+void ClusterInvalidator::run() {
+    auto& logger   = ::ll::mod::NativeMod::current()->getLogger();
+    auto  listener = m_storage.createNotificationListener(NOTIFY_CHANNEL);
+    if (listener) {
+        logger.info("ClusterInvalidator: 正在监听频道 {}，并每 {} 毫秒轮询一次。", NOTIFY_CHANNEL, m_pollInterval.count());
+    } else {
+        logger.info("ClusterInvalidator: 数据库不支持通知，每 {} 毫秒轮询一次。", m_pollInterval.count());
+    }
+
+    using Clock    = std::chrono::steady_clock;
+    auto lastPoll  = Clock::now();
+    auto lastPrune = Clock::now();
+    while (true) {
+        bool running;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            running = m_running;
+        }
+        flushOutbound();
+        if (!running) break;
+
+        bool notified = false;
+        if (listener) {
+            // 监听期间不会被 publish 唤醒，按较短的时间片等待以便及时写出
+            notified = listener->waitForNotification(std::min<std::chrono::milliseconds>(m_pollInterval, LISTEN_SLICE));
+        } else {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wakeup.wait_until(lock, lastPoll + m_pollInterval, [this] { return !m_running || !m_outbound.empty(); });
+        }
+
+        auto now = Clock::now();
+        if (notified || now - lastPoll >= m_pollInterval) {
+            pollRemote();
+            lastPoll = now;
+        }
+        if (now - lastPrune >= PRUNE_INTERVAL) {
+            m_storage.pruneInvalidationLog(unixNow() - LOG_RETENTION_SECONDS);
+            lastPrune = now;
+        }
+    }
+    logger.debug("ClusterInvalidator: 后台线程退出。");
+}
+
+void ClusterInvalidator::flushOutbound() {
+    std::vector<CacheInvalidationTask> batch;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_outbound.empty()) return;
+        batch.swap(m_outbound);
+        m_outboundKeys.clear();
+    }
+    if (m_storage.appendInvalidationLog(m_nodeId, batch)) {
+        m_storage.notifyChannel(NOTIFY_CHANNEL);
+        return;
+    }
+
+    ::ll::mod::NativeMod::current()->getLogger().warn(
+        "ClusterInvalidator: 写入缓存失效日志失败，{} 个任务将在稍后重试。",
+        batch.size()
+    );
+    // 放回队列头部，期间新发布的相同任务与之合并
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::vector<CacheInvalidationTask> merged;
+    merged.reserve(batch.size() + m_outbound.size());
+    m_outboundKeys.clear();
+    for (auto* source : {&batch, &m_outbound}) {
+        for (auto& task : *source) {
+            if (task.type != CacheInvalidationTaskType::PLAYER_BATCH_GROUP_CHANGED
+                && !m_outboundKeys.emplace(task.type, task.data).second) {
+                continue;
+            }
+            merged.push_back(std::move(task));
+        }
+    }
+    if (merged.size() > MAX_OUTBOUND) merged.resize(MAX_OUTBOUND);
+    m_outbound.swap(merged);
+}
+
+void ClusterInvalidator::pollRemote() {
+    auto entries = m_storage.fetchInvalidationLogAfter(m_scanFrom, POLL_BATCH_SIZE);
+    if (entries.empty()) return;
+
+    std::vector<CacheInvalidationTask> remote;
+    long long                          settledBefore = unixNow() - GRACE_SECONDS;
+    long long                          newScanFrom   = m_scanFrom;
+    bool                               pastRecent    = false;
+    for (auto& entry : entries) {
+        // 宽限期之前的记录已不会再有更小的ID提交，读取位置可以越过它们
+        if (!pastRecent && entry.createdAt < settledBefore) {
+            newScanFrom = entry.id;
+        } else {
+            pastRecent = true;
+        }
+        if (!m_seenIds.insert(entry.id).second) continue;
+        if (entry.origin == m_nodeId || !isTransportable(entry.task.type)) continue;
+        remote.push_back(std::move(entry.task));
+    }
+    // 一整批都在宽限期内时也必须前进，否则会一直读到同一批记录
+    if (entries.size() >= POLL_BATCH_SIZE) newScanFrom = std::max(newScanFrom, entries.back().id);
+    m_scanFrom = newScanFrom;
+    m_seenIds.erase(m_seenIds.begin(), m_seenIds.upper_bound(m_scanFrom));
+
+    if (!remote.empty()) {
+        Tracer::getInstance().record(TraceEvent::CLUSTER_RECEIVE, 0, 0, static_cast<uint32_t>(remote.size()));
+        m_onRemoteTasks(std::move(remote));
+    }
+}
+
+} // namespace internal
+} // namespace permission
+} // namespace BA
@@ -0,0 +1,84 @@
+#pragma once
+
+#include "permission/PermissionData.h"
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace BA {
+namespace permission {
+namespace internal {
+
+class PermissionStorage;
+
+/**
+ * @brief 跨服务器缓存失效。
+ *        多台服务器共用一个 MySQL/PostgreSQL 数据库时，每台服务器把本机产生的失效任务批量追加到
+ *        cache_invalidation_log，并轮询其他服务器写入的记录交给本机的失效器处理。
+ *        PostgreSQL 上写入后还会发送 NOTIFY，监听线程收到后立即读取，不必等到下一次轮询。
+ *
+ *        自增ID在并发事务中可能乱序提交，因此读取位置会停在最近 GRACE 秒内的记录之前，
+ *        这段时间内的记录靠已处理ID集合去重。
+ */
+class ClusterInvalidator {
+public:
+    using RemoteTaskHandler = std::function<void(std::vector<CacheInvalidationTask>)>;
+
+    /**
+     * @param storage 权限存储。
+     * @param pollInterval 两次轮询之间的最长间隔。
+     * @param onRemoteTasks 读到其他服务器的任务后在后台线程中调用。
+     */
+    ClusterInvalidator(PermissionStorage& storage, std::chrono::milliseconds pollInterval, RemoteTaskHandler onRemoteTasks);
+    ~ClusterInvalidator();
+
+    /**
+     * @brief 启动后台线程。
+     * @param afterId 只处理ID大于它的日志记录，应在预热读取数据之前获取。
+     */
+    void start(long long afterId);
+    // 写出剩余的任务并停止后台线程
+    void stop();
+
+    /**
+     * @brief 发布一个本机产生的失效任务，由后台线程批量写入日志。
+     *        尚未写出的相同任务（玩家批量任务除外）只保留一份。
+     */
+    void publish(const CacheInvalidationTask& task);
+
+    // 本服务器的节点ID，每次启动随机生成
+    const std::string& nodeId() const { return m_nodeId; }
+
+private:
+    void run();
+    // 把待发布的任务写入日志，失败时放回队列等待下次重试
+    void flushOutbound();
+    // 读取其他服务器写入的新记录
+    void pollRemote();
+
+    PermissionStorage&        m_storage;
+    std::chrono::milliseconds m_pollInterval;
+    RemoteTaskHandler         m_onRemoteTasks;
+    std::string               m_nodeId;
+
+    std::mutex                                                  m_mutex;
+    std::condition_variable                                     m_wakeup;
+    std::vector<CacheInvalidationTask>                          m_outbound;     // 待写入日志的任务
+    std::set<std::pair<CacheInvalidationTaskType, std::string>> m_outboundKeys; // 用于合并待写入的相同任务
+    bool                                                        m_running = false;
+    std::thread                                                 m_thread;
+
+    // 以下只由后台线程访问
+    long long           m_scanFrom = 0; // 下次从这个ID之后开始读取
+    std::set<long long> m_seenIds;      // 已处理但仍在宽限期内的记录ID
+};
+
+} // namespace internal
+} // namespace permission
+} // namespace BA
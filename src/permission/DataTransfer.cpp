@@ -0,0 +1,596 @@
+#include "permission/DataTransfer.h"
+#include "ll/api/io/Logger.h"
+#include "ll/api/mod/NativeMod.h"
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <utility>
+
+namespace BA {
+namespace permission {
+namespace internal {
+
+namespace {
+
+long long nowSeconds() {
+    return std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch())
+        .count();
+}
+
+void appendUtf8(std::string& out, uint32_t cp) {
+    if (cp < 0x80) {
+        out += static_cast<char>(cp);
+    } else if (cp < 0x800) {
+        out += static_cast<char>(0xC0 | (cp >> 6));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    } else if (cp < 0x10000) {
+        out += static_cast<char>(0xE0 | (cp >> 12));
+        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    } else {
+        out += static_cast<char>(0xF0 | (cp >> 18));
+        out += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    }
+}
+
+// 一行之内的递归下降解析器，位置越界或遇到意外字符时返回 false
+class LineParser {
+public:
+    explicit LineParser(std::string_view text) : m_text(text) {}
+
+    bool parseObject(NdjsonRecord& record) {
+        skipSpace();
+        if (!consume('{')) return false;
+        skipSpace();
+        if (consume('}')) return atEnd();
+        while (true) {
+            std::string key;
+            skipSpace();
+            if (!parseString(key)) return false;
+            skipSpace();
+            if (!consume(':')) return false;
+            skipSpace();
+            NdjsonValue value;
+            if (!parseValue(value)) return false;
+            record[std::move(key)] = std::move(value);
+            skipSpace();
+            if (consume(',')) continue;
+            if (consume('}')) return atEnd();
+            return false;
+        }
+    }
+
+private:
+    bool atEnd() {
+        skipSpace();
+        return m_pos == m_text.size();
+    }
+    void skipSpace() {
+        while (m_pos < m_text.size()
+               && (m_text[m_pos] == ' ' || m_text[m_pos] == '\t' || m_text[m_pos] == '\r' || m_text[m_pos] == '\n')) {
+            ++m_pos;
+        }
+    }
+    bool consume(char c) {
+        if (m_pos < m_text.size() && m_text[m_pos] == c) {
+            ++m_pos;
+            return true;
+        }
+        return false;
+    }
+    bool consumeWord(std::string_view word) {
+        if (m_text.substr(m_pos, word.size()) != word) return false;
+        m_pos += word.size();
+        return true;
+    }
+
+    bool parseValue(NdjsonValue& value) {
+        if (m_pos >= m_text.size()) return false;
+        char c = m_text[m_pos];
+        if (c == '"') {
+            std::string text;
+            if (!parseString(text)) return false;
+            value = std::move(text);
+            return true;
+        }
+        if (c == 't') return consumeWord("true") && (value = true, true);
+        if (c == 'f') return consumeWord("false") && (value = false, true);
+        if (c == 'n') return consumeWord("null") && (value = std::monostate{}, true);
+        if (c == '-' || (c >= '0' && c <= '9')) {
+            long long number = 0;
+            if (!parseInteger(number)) return false;
+            value = number;
+            return true;
+        }
+        return false; // 数组、嵌套对象与小数都不会出现在导出文件中
+    }
+
+    bool parseInteger(long long& number) {
+        bool negative = consume('-');
+        if (m_pos >= m_text.size() || m_text[m_pos] < '0' || m_text[m_pos] > '9') return false;
+        unsigned long long magnitude = 0;
+        while (m_pos < m_text.size() && m_text[m_pos] >= '0' && m_text[m_pos] <= '9') {
+            unsigned digit = static_cast<unsigned>(m_text[m_pos] - '0');
+            if (magnitude > (static_cast<unsigned long long>(INT64_MAX) + 1 - digit) / 10) return false;
+            magnitude = magnitude * 10 + digit;
+            ++m_pos;
+        }
+        if (!negative && magnitude > static_cast<unsigned long long>(INT64_MAX)) return false;
+        number = negative ? static_cast<long long>(0 - magnitude) : static_cast<long long>(magnitude);
+        return true;
+    }
+
+    bool parseHex4(uint32_t& cp) {
+        if (m_pos + 4 > m_text.size()) return false;
+        cp = 0;
+        for (int i = 0; i < 4; ++i) {
+            char c = m_text[m_pos++];
+            cp <<= 4;
+            if (c >= '0' && c <= '9') cp |= static_cast<uint32_t>(c - '0');
+            else if (c >= 'a' && c <= 'f') cp |= static_cast<uint32_t>(c - 'a' + 10);
+            else if (c >= 'A' && c <= 'F') cp |= static_cast<uint32_t>(c - 'A' + 10);
+            else return false;
+        }
+        return true;
+    }
+
+    bool parseString(std::string& out) {
+        if (!consume('"')) return false;
+        while (m_pos < m_text.size()) {
+            char c = m_text[m_pos++];
+            if (c == '"') return true;
+            if (static_cast<unsigned char>(c) < 0x20) return false;
+            if (c != '\\') {
+                out += c;
+                continue;
+            }
+            if (m_pos >= m_text.size()) return false;
+            switch (m_text[m_pos++]) {
+            case '"': out += '"'; break;
+            case '\\': out += '\\'; break;
+            case '/': out += '/'; break;
+            case 'b': out += '\b'; break;
+            case 'f': out += '\f'; break;
+            case 'n': out += '\n'; break;
+            case 'r': out += '\r'; break;
+            case 't': out += '\t'; break;
+            case 'u': {
+                uint32_t cp = 0;
+                if (!parseHex4(cp)) return false;
+                if (cp >= 0xD800 && cp <= 0xDBFF) { // 高代理项必须紧跟低代理项
+                    uint32_t low = 0;
+                    if (!consumeWord("\\u") || !parseHex4(low) || low < 0xDC00 || low > 0xDFFF) return false;
+                    cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                } else if (cp >= 0xDC00 && cp <= 0xDFFF) {
+                    return false;
+                }
+                appendUtf8(out, cp);
+                break;
+            }
+            default: return false;
+            }
+        }
+        return false;
+    }
+
+    std::string_view m_text;
+    size_t           m_pos = 0;
+};
+
+const std::string* stringOf(const NdjsonRecord& record, const char* key) {
+    auto it = record.find(key);
+    return it == record.end() ? nullptr : std::get_if<std::string>(&it->second);
+}
+
+const long long* integerOf(const NdjsonRecord& record, const char* key) {
+    auto it = record.find(key);
+    return it == record.end() ? nullptr : std::get_if<long long>(&it->second);
+}
+
+// 非空的字符串字段，缺失或为空时返回 nullptr
+const std::string* nameOf(const NdjsonRecord& record, const char* key) {
+    const auto* value = stringOf(record, key);
+    return value && !value->empty() ? value : nullptr;
+}
+
+} // namespace
+
+bool parseNdjsonRecord(std::string_view line, NdjsonRecord& record) {
+    record.clear();
+    return LineParser(line).parseObject(record);
+}
+
+// --- NdjsonWriter ---
+
+NdjsonWriter::NdjsonWriter(std::function<bool(std::string_view)> sink, size_t chunkBytes)
+: m_sink(std::move(sink)),
+  m_chunkBytes(chunkBytes) {
+    m_buffer.reserve(chunkBytes + 1024);
+}
+
+NdjsonWriter& NdjsonWriter::begin(std::string_view type) {
+    m_buffer += "{\"type\":";
+    quoted(type);
+    return *this;
+}
+
+NdjsonWriter& NdjsonWriter::string(std::string_view key, std::string_view value) {
+    this->key(key);
+    quoted(value);
+    return *this;
+}
+
+NdjsonWriter& NdjsonWriter::integer(std::string_view key, long long value) {
+    this->key(key);
+    m_buffer += std::to_string(value);
+    return *this;
+}
+
+NdjsonWriter& NdjsonWriter::boolean(std::string_view key, bool value) {
+    this->key(key);
+    m_buffer += value ? "true" : "false";
+    return *this;
+}
+
+NdjsonWriter& NdjsonWriter::optionalInteger(std::string_view key, std::optional<long long> value) {
+    if (value) return integer(key, *value);
+    this->key(key);
+    m_buffer += "null";
+    return *this;
+}
+
+bool NdjsonWriter::end() {
+    m_buffer += "}\n";
+    if (m_buffer.size() >= m_chunkBytes) return flush();
+    return !m_failed;
+}
+
+bool NdjsonWriter::flush() {
+    if (!m_failed && !m_buffer.empty() && !m_sink(m_buffer)) m_failed = true;
+    m_buffer.clear();
+    return !m_failed;
+}
+
+void NdjsonWriter::key(std::string_view key) {
+    m_buffer += ',';
+    quoted(key);
+    m_buffer += ':';
+}
+
+void NdjsonWriter::quoted(std::string_view text) {
+    m_buffer += '"';
+    for (char c : text) {
+        switch (c) {
+        case '"': m_buffer += "\\\""; break;
+        case '\\': m_buffer += "\\\\"; break;
+        case '\n': m_buffer += "\\n"; break;
+        case '\r': m_buffer += "\\r"; break;
+        case '\t': m_buffer += "\\t"; break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20) {
+                char escaped[8];
+                std::snprintf(escaped, sizeof(escaped), "\\u%04x", static_cast<unsigned>(c));
+                m_buffer += escaped;
+            } else {
+                m_buffer += c; // UTF-8 多字节序列原样写出
+            }
+        }
+    }
+    m_buffer += '"';
+}
+
+// --- 导出 ---
+
+TransferStats exportDataset(PermissionStorage& storage, const std::function<bool(std::string_view)>& sink) {
+    auto&         logger = ::ll::mod::NativeMod::current()->getLogger();
+    TransferStats stats;
+    NdjsonWriter  writer(sink);
+
+    writer.begin("header")
+        .string("format", NDJSON_FORMAT)
+        .integer("version", NDJSON_VERSION)
+        .integer("exportedAt", nowSeconds())
+        .end();
+
+    bool ok = storage.forEachPermission([&](const PermissionDefinition& definition) {
+        writer.begin("permission")
+            .string("name", definition.name)
+            .string("description", definition.description)
+            .boolean("default", definition.defaultValue);
+        ++stats.permissions;
+        return writer.end();
+    });
+    if (!ok || writer.failed()) {
+        stats.error = writer.failed() ? "输出已关闭" : "读取权限定义失败";
+        return stats;
+    }
+
+    // 组、继承与规则按组名输出，导入时不依赖原数据库的组ID
+    auto                                         groups = storage.fetchAllGroupDetails();
+    std::unordered_map<std::string, std::string> idToName;
+    for (const auto& [name, details] : groups) {
+        idToName.emplace(details.id, name);
+        writer.begin("group")
+            .string("name", name)
+            .string("description", details.description)
+            .integer("priority", details.priority);
+        ++stats.groups;
+        if (!writer.end()) break;
+    }
+    for (const auto& [parent, children] : storage.fetchAllInheritance()) {
+        for (const auto& child : children) {
+            writer.begin("parent").string("group", child).string("parent", parent);
+            ++stats.inheritance;
+            if (!writer.end()) break;
+        }
+    }
+    for (const auto& [groupId, rules] : storage.fetchAllGroupPermissions()) {
+        auto name = idToName.find(groupId);
+        if (name == idToName.end()) continue;
+        for (const auto& rule : rules) {
+            writer.begin("rule").string("group", name->second).string("rule", rule);
+            ++stats.rules;
+            if (!writer.end()) break;
+        }
+    }
+    if (writer.failed()) {
+        stats.error = "输出已关闭";
+        return stats;
+    }
+
+    ok = storage.forEachPlayerGroup(
+        nowSeconds(),
+        [&](const std::string& playerUuid, const std::string& groupId, std::optional<long long> expiry) {
+            auto name = idToName.find(groupId);
+            if (name == idToName.end()) return true; // 导出期间新建的组
+            writer.begin("member")
+                .string("player", playerUuid)
+                .string("group", name->second)
+                .optionalInteger("expiry", expiry);
+            ++stats.memberships;
+            return writer.end();
+        }
+    );
+    if (!ok || !writer.flush()) {
+        stats.error = writer.failed() ? "输出已关闭" : "读取玩家组关系失败";
+        return stats;
+    }
+
+    stats.success = true;
+    logger.info(
+        "导出完成: {} 个权限, {} 个组, {} 条继承, {} 条规则, {} 条玩家组关系。",
+        stats.permissions,
+        stats.groups,
+        stats.inheritance,
+        stats.rules,
+        stats.memberships
+    );
+    return stats;
+}
+
+// --- 导入 ---
+
+DatasetImporter::DatasetImporter(PermissionStorage& storage, size_t batchRecords)
+: m_storage(storage),
+  m_batchRecords(batchRecords > 0 ? batchRecords : 1),
+  m_now(nowSeconds()) {
+    for (const auto& [name, details] : m_storage.fetchAllGroupDetails()) {
+        m_groupIds.emplace(name, details.id);
+        m_knownGroups.insert(name);
+    }
+    for (const auto& [parent, children] : m_storage.fetchAllInheritance()) {
+        for (const auto& child : children) m_childToParents[child].insert(parent);
+    }
+}
+
+bool DatasetImporter::feed(std::string_view chunk) {
+    if (m_failed) return false;
+    // 先处理与上一块末尾拼接成的行，之后直接在本块内切分，避免复制整块
+    size_t start = 0;
+    if (!m_pending.empty()) {
+        size_t newline = chunk.find('\n');
+        if (newline == std::string_view::npos) {
+            m_pending.append(chunk);
+            return true;
+        }
+        m_pending.append(chunk.substr(0, newline));
+        handleLine(m_pending);
+        m_pending.clear();
+        start = newline + 1;
+    }
+    while (!m_failed) {
+        size_t newline = chunk.find('\n', start);
+        if (newline == std::string_view::npos) {
+            m_pending.assign(chunk.substr(start));
+            break;
+        }
+        handleLine(chunk.substr(start, newline - start));
+        start = newline + 1;
+    }
+    return !m_failed;
+}
+
+TransferStats DatasetImporter::finish() {
+    if (!m_failed && !m_pending.empty()) {
+        std::string last = std::move(m_pending);
+        m_pending.clear();
+        handleLine(last);
+    }
+    if (!m_failed) flushBatch();
+    m_stats.success = !m_failed;
+
+    auto& logger = ::ll::mod::NativeMod::current()->getLogger();
+    if (m_stats.success) {
+        logger.info(
+            "导入完成: {} 个权限, {} 个组, {} 条继承, {} 条规则, {} 条玩家组关系，跳过 {} 条记录。",
+            m_stats.permissions,
+            m_stats.groups,
+            m_stats.inheritance,
+            m_stats.rules,
+            m_stats.memberships,
+            m_stats.skipped
+        );
+    } else {
+        logger.error("导入在第 {} 行中止: {}", m_lineNumber, m_stats.error);
+    }
+    return m_stats;
+}
+
+void DatasetImporter::handleLine(std::string_view line) {
+    ++m_lineNumber;
+    if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+    if (line.find_first_not_of(" \t") == std::string_view::npos) return;
+
+    NdjsonRecord record;
+    if (!parseNdjsonRecord(line, record)) {
+        ++m_stats.skipped;
+        ::ll::mod::NativeMod::current()->getLogger().warn("导入: 第 {} 行不是有效的记录，已跳过。", m_lineNumber);
+        return;
+    }
+    handleRecord(record);
+    if (!m_failed && m_batch.size() >= m_batchRecords) flushBatch();
+}
+
+void DatasetImporter::handleRecord(const NdjsonRecord& record) {
+    const auto* type = stringOf(record, "type");
+    if (!type) {
+        ++m_stats.skipped;
+        return;
+    }
+    bool first  = !m_sawRecord;
+    m_sawRecord = true;
+
+    if (*type == "header") {
+        const auto* format  = stringOf(record, "format");
+        const auto* version = integerOf(record, "version");
+        if (!first || !format || *format != NDJSON_FORMAT) {
+            fail("文件头无效");
+        } else if (!version || *version > NDJSON_VERSION) {
+            fail("不支持的导出格式版本");
+        }
+        return;
+    }
+
+    if (*type == "permission") {
+        const auto* name = nameOf(record, "name");
+        if (!name) {
+            ++m_stats.skipped;
+            return;
+        }
+        const auto* description  = stringOf(record, "description");
+        auto        defaultValue = record.find("default");
+        const bool* flag = defaultValue == record.end() ? nullptr : std::get_if<bool>(&defaultValue->second);
+        m_batch.permissions.push_back({*name, description ? *description : "", flag && *flag});
+        return;
+    }
+
+    if (*type == "group") {
+        const auto* name = nameOf(record, "name");
+        if (!name) {
+            ++m_stats.skipped;
+            return;
+        }
+        const auto* description = stringOf(record, "description");
+        const auto* priority    = integerOf(record, "priority");
+        m_batch.groups.emplace_back(
+            "",
+            *name,
+            description ? *description : "",
+            priority ? static_cast<int>(*priority) : 0
+        );
+        m_knownGroups.insert(*name); // 组ID在写入后才知道
+        return;
+    }
+
+    if (*type == "parent") {
+        const auto* child  = nameOf(record, "group");
+        const auto* parent = nameOf(record, "parent");
+        if (!child || !parent || !m_knownGroups.count(*child) || !m_knownGroups.count(*parent)
+            || createsCycle(*child, *parent)) {
+            ++m_stats.skipped;
+            return;
+        }
+        if (!m_childToParents[*child].insert(*parent).second) return; // 已存在的继承
+        m_batch.inheritance.emplace_back(*child, *parent);
+        return;
+    }
+
+    if (*type == "rule") {
+        const auto* group = nameOf(record, "group");
+        const auto* rule  = nameOf(record, "rule");
+        if (!group || !rule || !m_knownGroups.count(*group)) {
+            ++m_stats.skipped;
+            return;
+        }
+        m_batch.rules.emplace_back(*group, *rule);
+        return;
+    }
+
+    if (*type == "member") {
+        const auto* player = nameOf(record, "player");
+        const auto* group  = nameOf(record, "group");
+        if (!player || !group || !m_knownGroups.count(*group)) {
+            ++m_stats.skipped;
+            return;
+        }
+        std::optional<long long> expiry;
+        if (const auto* value = integerOf(record, "expiry")) {
+            if (*value <= m_now) {
+                ++m_stats.skipped; // 导出后已经到期
+                return;
+            }
+            expiry = *value;
+        }
+        m_batch.memberships.push_back({*player, *group, expiry});
+        return;
+    }
+
+    ++m_stats.skipped; // 更高版本可能增加的记录类型
+}
+
+bool DatasetImporter::createsCycle(const std::string& child, const std::string& parent) const {
+    if (child == parent) return true;
+    // 从 parent 向上遍历，若能到达 child，则 child 已是 parent 的祖先
+    std::vector<const std::string*>  stack{&parent};
+    std::set<std::string_view>       visited{parent};
+    while (!stack.empty()) {
+        const std::string* current = stack.back();
+        stack.pop_back();
+        auto it = m_childToParents.find(*current);
+        if (it == m_childToParents.end()) continue;
+        for (const auto& ancestor : it->second) {
+            if (ancestor == child) return true;
+            if (visited.insert(ancestor).second) stack.push_back(&ancestor);
+        }
+    }
+    return false;
+}
+
+bool DatasetImporter::flushBatch() {
+    if (m_batch.empty()) return true;
+    if (!m_storage.applyImportBatch(m_batch, m_groupIds, m_stats)) {
+        fail("写入数据库失败");
+        return false;
+    }
+    for (const auto& membership : m_batch.memberships) {
+        m_players.insert(membership.playerUuid);
+        if (!membership.expiryTimestamp) continue;
+        auto id = m_groupIds.find(membership.groupName);
+        if (id != m_groupIds.end()) {
+            m_expirations.push_back({membership.playerUuid, id->second, *membership.expiryTimestamp});
+        }
+    }
+    m_batch = ImportBatch{};
+    return true;
+}
+
+void DatasetImporter::fail(std::string error) {
+    m_failed      = true;
+    m_stats.error = std::move(error);
+}
+
+} // namespace internal
+} // namespace permission
+} // namespace BA
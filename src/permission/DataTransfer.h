@@ -0,0 +1,135 @@
+#pragma once
+
+#include "permission/PermissionData.h"
+#include "permission/PermissionStorage.h"
+#include <cstddef>
+#include <functional>
+#include <optional>
+#include <set>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <variant>
+#include <vector>
+
+namespace BA {
+namespace permission {
+namespace internal {
+
+// 导出文件的格式标识与版本，导入时拒绝更高的版本
+inline constexpr std::string_view NDJSON_FORMAT  = "bedrock-authority";
+inline constexpr long long        NDJSON_VERSION = 1;
+
+// NDJSON 记录中的值：null、布尔、整数或字符串。记录都是不嵌套的扁平对象
+using NdjsonValue  = std::variant<std::monostate, bool, long long, std::string>;
+using NdjsonRecord = std::unordered_map<std::string, NdjsonValue>;
+
+/**
+ * @brief 解析一行 NDJSON。只支持值为标量的扁平对象，足以表示导出文件中的所有记录。
+ * @param line 一行文本，不含换行符。
+ * @param record 输出的字段，解析前清空。
+ * @return 语法正确返回 true。
+ */
+bool parseNdjsonRecord(std::string_view line, NdjsonRecord& record);
+
+/**
+ * @brief 逐条写出 NDJSON 记录。记录先写入缓冲区，积累到一定大小后整块交给 sink，
+ *        因此调用方可以把每块直接作为 HTTP 分块响应或文件写入发出，无需把整个导出放进内存。
+ */
+class NdjsonWriter {
+public:
+    /**
+     * @param sink 接收一块完整的行，返回 false 表示对端已关闭，之后的写入都会被丢弃。
+     * @param chunkBytes 缓冲区达到该大小时交给 sink。
+     */
+    explicit NdjsonWriter(std::function<bool(std::string_view)> sink, size_t chunkBytes = 64 * 1024);
+
+    // 开始一条记录，写入 "type" 字段
+    NdjsonWriter& begin(std::string_view type);
+    NdjsonWriter& string(std::string_view key, std::string_view value);
+    NdjsonWriter& integer(std::string_view key, long long value);
+    NdjsonWriter& boolean(std::string_view key, bool value);
+    // 值为空时写入 null
+    NdjsonWriter& optionalInteger(std::string_view key, std::optional<long long> value);
+    // 结束当前记录，缓冲区已满时交给 sink；sink 失败后返回 false
+    bool          end();
+    // 把缓冲区中剩余的内容交给 sink
+    bool          flush();
+    bool          failed() const { return m_failed; }
+
+private:
+    void key(std::string_view key);
+    void quoted(std::string_view text);
+
+    std::function<bool(std::string_view)> m_sink;
+    size_t                                m_chunkBytes;
+    std::string                           m_buffer;
+    bool                                  m_failed = false;
+};
+
+/**
+ * @brief 把整个权限数据集（权限定义、组、继承、组规则与未过期的玩家组关系）流式导出为 NDJSON。
+ *        组相关的表先整体读出（通常不大），玩家组关系逐行读取并写出。导出不在同一个事务中读取，
+ *        导出期间发生的修改可能只有一部分出现在结果中。
+ * @param storage 存储层。
+ * @param sink 接收输出块，返回 false 时停止导出。
+ * @return 各类记录的数量；sink 中途失败或读取出错时 success 为 false。
+ */
+TransferStats exportDataset(PermissionStorage& storage, const std::function<bool(std::string_view)>& sink);
+
+/**
+ * @brief 增量解析 NDJSON 并分批写入数据库。
+ *        输入可以按任意边界切块；记录积累到一批后通过 PermissionStorage::applyImportBatch 在一个事务中写入。
+ *        不触发任何事件，也不修改缓存，调用方在 finish 之后根据 players()/expirations() 统一刷新。
+ */
+class DatasetImporter {
+public:
+    /**
+     * @param storage 存储层。
+     * @param batchRecords 每个事务写入的记录数。
+     */
+    explicit DatasetImporter(PermissionStorage& storage, size_t batchRecords = 5000);
+
+    /**
+     * @brief 输入一块数据。
+     * @return 之前的批次都已成功写入返回 true；某一批写入失败后返回 false，之后的输入被忽略。
+     */
+    bool          feed(std::string_view chunk);
+    /**
+     * @brief 处理最后一行（可以没有换行符）并写入剩余的记录。
+     * @return 导入统计。
+     */
+    TransferStats finish();
+
+    // 导入了玩家组关系的玩家
+    const std::set<std::string>&          players() const { return m_players; }
+    // 导入的带过期时间的玩家组关系（组ID形式），用于更新到期队列
+    const std::vector<PlayerGroupExpiry>& expirations() const { return m_expirations; }
+
+private:
+    void handleLine(std::string_view line);
+    void handleRecord(const NdjsonRecord& record);
+    // 添加 child -> parent 是否会形成循环（包括自己继承自己）
+    bool createsCycle(const std::string& child, const std::string& parent) const;
+    bool flushBatch();
+    void fail(std::string error);
+
+    PermissionStorage&                                     m_storage;
+    size_t                                                 m_batchRecords;
+    long long                                              m_now;            // 开始导入的时间
+    std::string                                            m_pending;        // 尚未凑成完整一行的输入
+    size_t                                                 m_lineNumber = 0;
+    bool                                                   m_sawRecord  = false;
+    ImportBatch                                            m_batch;
+    std::unordered_map<std::string, std::string>           m_groupIds;       // 组名 -> 组ID（已写入数据库的组）
+    std::set<std::string>                                  m_knownGroups;    // 已存在或本次导入中出现过的组名
+    std::unordered_map<std::string, std::set<std::string>> m_childToParents; // 含已接受的导入记录
+    std::set<std::string>                                  m_players;
+    std::vector<PlayerGroupExpiry>                         m_expirations;
+    TransferStats                                          m_stats;
+    bool                                                   m_failed = false;
+};
+
+} // namespace internal
+} // namespace permission
+} // namespace BA
@@ -0,0 +1,103 @@
+#include "permission/ExpiryQueue.h"
+
+namespace BA {
+namespace permission {
+namespace internal {
+
+void ExpiryQueue::merge(std::vector<PlayerGroupExpiry> entries) {
+    std::function<void()> wake;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        dropStaleTop();
+        std::optional<long long> previous;
+        if (!m_heap.empty()) previous = m_heap.top().expiryTimestamp;
+        for (auto& entry : entries) {
+            Key key{std::move(entry.playerUuid), std::move(entry.groupId)};
+            if (!m_current.emplace(key, entry.expiryTimestamp).second) continue;
+            m_heap.push({entry.expiryTimestamp, std::move(key)});
+        }
+        if (!m_heap.empty() && (!previous || m_heap.top().expiryTimestamp < *previous)) wake = m_onWake;
+    }
+    if (wake) wake();
+}
+
+void ExpiryQueue::schedule(
+    const std::string&       playerUuid,
+    const std::string&       groupId,
+    std::optional<long long> expiryTimestamp
+) {
+    if (!expiryTimestamp) {
+        cancel(playerUuid, groupId);
+        return;
+    }
+    std::function<void()> wake;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        dropStaleTop();
+        bool earlier = m_heap.empty() || *expiryTimestamp < m_heap.top().expiryTimestamp;
+        Key  key{playerUuid, groupId};
+        m_current[key] = *expiryTimestamp;
+        m_heap.push({*expiryTimestamp, std::move(key)});
+        compactIfNeeded();
+        if (earlier) wake = m_onWake;
+    }
+    if (wake) wake();
+}
+
+void ExpiryQueue::cancel(const std::string& playerUuid, const std::string& groupId) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    // 堆中的条目留到弹出时再丢弃
+    if (m_current.erase({playerUuid, groupId}) > 0) compactIfNeeded();
+}
+
+std::optional<long long> ExpiryQueue::nextDeadline() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    dropStaleTop();
+    if (m_heap.empty()) return std::nullopt;
+    return m_heap.top().expiryTimestamp;
+}
+
+std::vector<ExpiryQueue::Key> ExpiryQueue::popDue(long long now) {
+    std::vector<Key>            due;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    while (!m_heap.empty() && m_heap.top().expiryTimestamp <= now) {
+        HeapEntry top = m_heap.top();
+        m_heap.pop();
+        auto it = m_current.find(top.key);
+        if (it == m_current.end() || it->second != top.expiryTimestamp) continue; // 已改期或已取消
+        m_current.erase(it);
+        due.push_back(std::move(top.key));
+    }
+    return due;
+}
+
+size_t ExpiryQueue::size() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_current.size();
+}
+
+void ExpiryQueue::setWakeHandler(std::function<void()> handler) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_onWake = std::move(handler);
+}
+
+void ExpiryQueue::dropStaleTop() {
+    while (!m_heap.empty()) {
+        const HeapEntry& top = m_heap.top();
+        auto             it  = m_current.find(top.key);
+        if (it != m_current.end() && it->second == top.expiryTimestamp) return;
+        m_heap.pop();
+    }
+}
+
+void ExpiryQueue::compactIfNeeded() {
+    if (m_heap.size() <= 2 * m_current.size() + 64) return;
+    std::vector<HeapEntry> heap;
+    heap.reserve(m_current.size());
+    for (const auto& [key, expiry] : m_current) heap.push_back({expiry, key});
+    m_heap = decltype(m_heap)(std::greater<HeapEntry>(), std::move(heap));
+}
+
+} // namespace internal
+} // namespace permission
+} // namespace BA
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "permission/PermissionStorage.h"
+#include <functional>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <queue>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace BA {
+namespace permission {
+namespace internal {
+
+/**
+ * @brief 即将到期的玩家组关系（最小堆）。
+ *        启动时从数据库载入所有带过期时间的 (玩家, 组)，之后由加入组、设置过期时间与移出组同步更新。
+ *        重新设置过期时间时不在堆中查找旧条目，而是记录每个键当前的过期时间，弹出时丢弃不一致的旧条目。
+ */
+class ExpiryQueue {
+public:
+    using Key = std::pair<std::string, std::string>; // (玩家UUID, 组ID)
+
+    /**
+     * @brief 合并数据库中的记录：只加入队列中还没有的 (玩家, 组)，已有的以本地记录为准。
+     *        启动时用它载入全部记录，兜底清理时用它补上其他实例添加的记录。
+     * @param entries 带过期时间的玩家组关系。
+     */
+    void merge(std::vector<PlayerGroupExpiry> entries);
+
+    /**
+     * @brief 设置 (玩家, 组) 的过期时间。
+     * @param expiryTimestamp 过期时间戳（秒），std::nullopt 表示永久，等同于 cancel。
+     */
+    void schedule(const std::string& playerUuid, const std::string& groupId, std::optional<long long> expiryTimestamp);
+    /**
+     * @brief 取消 (玩家, 组) 的过期时间（例如玩家已被移出该组）。
+     */
+    void cancel(const std::string& playerUuid, const std::string& groupId);
+
+    /**
+     * @brief 获取最早的过期时间。
+     * @return 最早的过期时间戳（秒）；队列为空时返回 std::nullopt。
+     */
+    std::optional<long long> nextDeadline();
+    /**
+     * @brief 取出所有在 now 或之前到期的 (玩家, 组)。
+     * @param now 当前 Unix 时间戳（秒）。
+     */
+    std::vector<Key> popDue(long long now);
+
+    // 队列中的 (玩家, 组) 数量
+    size_t size() const;
+
+    /**
+     * @brief 设置最早的过期时间提前时调用的回调（例如唤醒等待中的清理线程），在锁外调用。
+     */
+    void setWakeHandler(std::function<void()> handler);
+
+private:
+    struct HeapEntry {
+        long long expiryTimestamp;
+        Key       key;
+
+        bool operator>(const HeapEntry& other) const { return expiryTimestamp > other.expiryTimestamp; }
+    };
+
+    // 丢弃堆顶已被改期或取消的旧条目，调用方需持有 m_mutex
+    void dropStaleTop();
+    // 旧条目过多时从 m_current 重建堆，调用方需持有 m_mutex
+    void compactIfNeeded();
+
+    mutable std::mutex                                                              m_mutex;
+    std::priority_queue<HeapEntry, std::vector<HeapEntry>, std::greater<HeapEntry>> m_heap;
+    std::map<Key, long long>                                                        m_current; // 每个键当前的过期时间
+    std::function<void()>                                                           m_onWake;
+};
+
+} // namespace internal
+} // namespace permission
+} // namespace BA
@@ -0,0 +1,177 @@
+#include "permission/GroupGraph.h"
+#include <algorithm>
+
+namespace BA {
+namespace permission {
+namespace internal {
+
+using namespace std;
+
+namespace {
+// 将 ID 插入升序数组，已存在时返回 false
+bool insertSorted(vector<GroupId>& ids, GroupId id) {
+    auto it = lower_bound(ids.begin(), ids.end(), id);
+    if (it != ids.end() && *it == id) return false;
+    ids.insert(it, id);
+    return true;
+}
+
+bool eraseSorted(vector<GroupId>& ids, GroupId id) {
+    auto it = lower_bound(ids.begin(), ids.end(), id);
+    if (it == ids.end() || *it != id) return false;
+    ids.erase(it);
+    return true;
+}
+
+// 合并两个升序数组
+void mergeSorted(vector<GroupId>& into, const vector<GroupId>& from) {
+    vector<GroupId> merged;
+    merged.reserve(into.size() + from.size());
+    set_union(into.begin(), into.end(), from.begin(), from.end(), back_inserter(merged));
+    into.swap(merged);
+}
+} // namespace
+
+GroupGraph GroupGraph::build(const unordered_map<string, set<string>>& childToParents) {
+    GroupGraph graph;
+    for (const auto& [child, parents] : childToParents) {
+        GroupId childId = graph.intern(child);
+        for (const auto& parent : parents) {
+            GroupId parentId = graph.intern(parent);
+            insertSorted(graph.m_nodes[childId]->parents, parentId);
+            insertSorted(graph.m_nodes[parentId]->children, childId);
+        }
+    }
+    // 一次性计算全部闭包
+    for (GroupId id = 0; id < graph.m_nodes.size(); ++id) {
+        graph.m_nodes[id]->ancestors   = graph.collect(id, true);
+        graph.m_nodes[id]->descendants = graph.collect(id, false);
+    }
+    return graph;
+}
+
+GroupGraph::Node& GroupGraph::edit(GroupId id) {
+    auto& node = m_nodes[id];
+    // 只被本图持有的节点一定属于尚未发布的副本，可以直接修改
+    if (node.use_count() > 1) node = make_shared<Node>(*node);
+    return *node;
+}
+
+GroupId GroupGraph::find(const string& name) const {
+    auto it = m_ids.find(name);
+    return it == m_ids.end() ? INVALID_GROUP : it->second;
+}
+
+bool GroupGraph::hasPath(GroupId from, GroupId to) const {
+    const auto& descendants = m_nodes[from]->descendants;
+    return binary_search(descendants.begin(), descendants.end(), to);
+}
+
+GroupId GroupGraph::intern(const string& name) {
+    auto [it, inserted] = m_ids.try_emplace(name, static_cast<GroupId>(m_names.size()));
+    if (inserted) {
+        m_names.push_back(name);
+        auto node         = make_shared<Node>();
+        node->ancestors   = {it->second};
+        node->descendants = {it->second};
+        m_nodes.push_back(std::move(node));
+    }
+    return it->second;
+}
+
+// 新边 child -> parent：child 的每个后代获得 parent 的全部祖先，parent 的每个祖先获得 child 的全部后代
+bool GroupGraph::addEdge(GroupId child, GroupId parent) {
+    const auto& parents = m_nodes[child]->parents;
+    if (binary_search(parents.begin(), parents.end(), parent)) return false;
+    insertSorted(edit(child).parents, parent);
+    insertSorted(edit(parent).children, child);
+
+    vector<GroupId> newAncestors   = m_nodes[parent]->ancestors;
+    vector<GroupId> newDescendants = m_nodes[child]->descendants;
+    for (GroupId d : newDescendants) {
+        const auto& ancestors = m_nodes[d]->ancestors;
+        // 已经是祖先的不再复制节点
+        if (!includes(ancestors.begin(), ancestors.end(), newAncestors.begin(), newAncestors.end())) {
+            mergeSorted(edit(d).ancestors, newAncestors);
+        }
+    }
+    for (GroupId a : newAncestors) {
+        const auto& descendants = m_nodes[a]->descendants;
+        if (!includes(descendants.begin(), descendants.end(), newDescendants.begin(), newDescendants.end())) {
+            mergeSorted(edit(a).descendants, newDescendants);
+        }
+    }
+    return true;
+}
+
+// 删除边后闭包无法简单相减（可能还有其他路径），只对受影响的组重新遍历
+bool GroupGraph::removeEdge(GroupId child, GroupId parent) {
+    const auto& parents = m_nodes[child]->parents;
+    if (!binary_search(parents.begin(), parents.end(), parent)) return false;
+    eraseSorted(edit(child).parents, parent);
+    eraseSorted(edit(parent).children, child);
+
+    vector<GroupId> affectedDescendants = m_nodes[child]->descendants;
+    vector<GroupId> affectedAncestors   = m_nodes[parent]->ancestors;
+    for (GroupId d : affectedDescendants) {
+        auto ancestors = collect(d, true);
+        if (ancestors != m_nodes[d]->ancestors) edit(d).ancestors = std::move(ancestors);
+    }
+    for (GroupId a : affectedAncestors) {
+        auto descendants = collect(a, false);
+        if (descendants != m_nodes[a]->descendants) edit(a).descendants = std::move(descendants);
+    }
+    return true;
+}
+
+bool GroupGraph::detach(GroupId id) {
+    vector<GroupId> parents  = m_nodes[id]->parents;
+    vector<GroupId> children = m_nodes[id]->children;
+    for (GroupId parent : parents) removeEdge(id, parent);
+    for (GroupId child : children) removeEdge(child, id);
+    return !parents.empty() || !children.empty();
+}
+
+// 沿父（upward）或子方向遍历，返回包含起点的升序 ID 数组
+vector<GroupId> GroupGraph::collect(GroupId start, bool upward) const {
+    vector<bool>    visited(m_nodes.size(), false);
+    vector<GroupId> result{start};
+    visited[start] = true;
+    for (size_t i = 0; i < result.size(); ++i) {
+        const auto& next = upward ? m_nodes[result[i]]->parents : m_nodes[result[i]]->children;
+        for (GroupId n : next) {
+            if (!visited[n]) {
+                visited[n] = true;
+                result.push_back(n);
+            }
+        }
+    }
+    sort(result.begin(), result.end());
+    return result;
+}
+
+size_t GroupGraph::memoryUsage() const {
+    size_t bytes = sizeof(*this) + m_names.capacity() * sizeof(string) + m_nodes.capacity() * sizeof(shared_ptr<Node>);
+    for (const auto& name : m_names) bytes += name.capacity() * 2; // m_names 与 m_ids 各一份
+    for (const auto& node : m_nodes) {
+        bytes += sizeof(Node)
+               + (node->parents.capacity() + node->children.capacity() + node->ancestors.capacity()
+                  + node->descendants.capacity())
+                     * sizeof(GroupId);
+    }
+    return bytes;
+}
+
+GroupClosure::GroupClosure(shared_ptr<const GroupGraph> graph, const string& group, bool ancestors)
+: m_graph(std::move(graph)) {
+    GroupId id = m_graph->find(group);
+    if (id == GroupGraph::INVALID_GROUP) {
+        m_lone = group;
+    } else {
+        m_ids = ancestors ? &m_graph->ancestorsOf(id) : &m_graph->descendantsOf(id);
+    }
+}
+
+} // namespace internal
+} // namespace permission
+} // namespace BA
@@ -0,0 +1,142 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <set>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace BA {
+namespace permission {
+namespace internal {
+
+using GroupId = uint32_t; // 组名驻留后的稠密整数 ID
+
+/**
+ * @brief 组继承关系图。
+ *        组名被驻留为稠密整数 ID，每个组预先计算好祖先闭包与后代闭包（均为包含自身的升序 ID 数组），
+ *        祖先查询直接返回数组引用，hasPath 只需一次二分查找，均不分配内存。
+ *        缓存以 std::shared_ptr<const GroupGraph> 持有：修改时复制一份、在副本上增量更新闭包后整体替换，
+ *        读者拿到指针后无需加锁。各组的节点按引用共享，复制图只复制节点指针与组名，
+ *        修改时只有闭包真正变化的节点会被复制一份。
+ */
+class GroupGraph {
+public:
+    static constexpr GroupId INVALID_GROUP = UINT32_MAX;
+
+    GroupGraph() = default;
+
+    /**
+     * @brief 从子组到父组的映射构建完整的图。
+     * @param childToParents 子组名到其直接父组名集合的映射。
+     */
+    static GroupGraph build(const std::unordered_map<std::string, std::set<std::string>>& childToParents);
+
+    // 查找组名对应的 ID，不存在时返回 INVALID_GROUP
+    GroupId            find(const std::string& name) const;
+    // 获取 ID 对应的组名
+    const std::string& nameOf(GroupId id) const { return m_names[id]; }
+    // 已驻留的组数量
+    size_t             size() const { return m_names.size(); }
+
+    // 所有祖先组（包括自身），按 ID 升序
+    const std::vector<GroupId>& ancestorsOf(GroupId id) const { return m_nodes[id]->ancestors; }
+    // 所有后代组（包括自身），按 ID 升序
+    const std::vector<GroupId>& descendantsOf(GroupId id) const { return m_nodes[id]->descendants; }
+    // 是否存在从 from 沿父到子方向到达 to 的路径（from == to 时为 true）
+    bool                        hasPath(GroupId from, GroupId to) const;
+
+    // --- 修改操作，只应在尚未发布的副本上调用 ---
+    // 驻留组名，已存在时返回原 ID
+    GroupId intern(const std::string& name);
+    // 添加继承边并增量更新闭包，边已存在时返回 false
+    bool    addEdge(GroupId child, GroupId parent);
+    // 移除继承边并重新计算受影响组的闭包，边不存在时返回 false
+    bool    removeEdge(GroupId child, GroupId parent);
+    // 移除组的全部继承边（组被删除时），组名保持驻留，重建同名组时沿用原 ID；没有任何边时返回 false
+    bool    detach(GroupId id);
+
+    // 估算占用的内存字节数
+    size_t memoryUsage() const;
+
+private:
+    friend class CacheSnapshotFile; // 快照文件直接读写节点与闭包
+
+    struct Node {
+        std::vector<GroupId> parents;     // 直接父组，升序
+        std::vector<GroupId> children;    // 直接子组，升序
+        std::vector<GroupId> ancestors;   // 祖先闭包（含自身），升序
+        std::vector<GroupId> descendants; // 后代闭包（含自身），升序
+    };
+
+    std::vector<GroupId> collect(GroupId start, bool upward) const;
+    // 获取可修改的节点，节点仍与其他图共享时先复制一份
+    Node&                edit(GroupId id);
+
+    std::vector<std::string>                 m_names;
+    std::unordered_map<std::string, GroupId> m_ids;
+    std::vector<std::shared_ptr<Node>>       m_nodes; // 可能与之前的图共享，共享的节点不可修改
+};
+
+/**
+ * @brief 某个组的祖先或后代闭包（含自身）的只读视图，按 ID 升序遍历组名。
+ *        持有图的引用，闭包数组与组名在视图存活期间保持有效，构造与遍历都不分配内存；
+ *        组不在图中（没有任何继承关系）时只包含该组自身。
+ */
+class GroupClosure {
+public:
+    class Iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type        = std::string_view;
+        using difference_type   = std::ptrdiff_t;
+        using pointer           = void;
+        using reference         = std::string_view;
+
+        Iterator() = default;
+        Iterator(const GroupClosure* closure, size_t index) : m_closure(closure), m_index(index) {}
+
+        std::string_view operator*() const { return (*m_closure)[m_index]; }
+        Iterator&        operator++() {
+            ++m_index;
+            return *this;
+        }
+        Iterator operator++(int) {
+            Iterator previous = *this;
+            ++m_index;
+            return previous;
+        }
+        bool operator==(const Iterator& other) const { return m_index == other.m_index; }
+
+    private:
+        const GroupClosure* m_closure = nullptr;
+        size_t              m_index   = 0;
+    };
+
+    /**
+     * @param graph 继承关系图，视图存活期间保持引用。
+     * @param group 组名。
+     * @param ancestors true 为祖先闭包，false 为后代闭包。
+     */
+    GroupClosure(std::shared_ptr<const GroupGraph> graph, const std::string& group, bool ancestors);
+
+    size_t           size() const { return m_ids ? m_ids->size() : 1; }
+    std::string_view operator[](size_t index) const {
+        return m_ids ? std::string_view(m_graph->nameOf((*m_ids)[index])) : std::string_view(m_lone);
+    }
+    Iterator begin() const { return Iterator(this, 0); }
+    Iterator end() const { return Iterator(this, size()); }
+
+private:
+    std::shared_ptr<const GroupGraph> m_graph;
+    const std::vector<GroupId>*       m_ids = nullptr; // 指向图中的闭包，组不在图中时为空
+    std::string                       m_lone;          // 不在图中的组
+};
+
+} // namespace internal
+} // namespace permission
+} // namespace BA
@@ -0,0 +1,76 @@
+#include "permission/IoExecutor.h"
+#include "ll/api/io/Logger.h"
+#include "ll/api/mod/NativeMod.h"
+#include <algorithm>
+#include <exception>
+#include <utility>
+
+namespace BA {
+namespace permission {
+namespace internal {
+
+IoExecutor::~IoExecutor() { stop(); }
+
+void IoExecutor::start(unsigned int threadCount) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_running) return;
+    m_running = true;
+    threadCount = std::max(threadCount, 1u);
+    for (unsigned int i = 0; i < threadCount; ++i) {
+        m_threads.emplace_back(&IoExecutor::run, this);
+    }
+    ::ll::mod::NativeMod::current()->getLogger().info("IoExecutor: 已启动，线程数为 {}。", threadCount);
+}
+
+void IoExecutor::stop() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_running) return;
+        m_running = false;
+    }
+    m_condition.notify_all();
+    for (auto& thread : m_threads) {
+        if (thread.joinable()) thread.join(); // 工作线程退出前会执行完剩余的任务
+    }
+    m_threads.clear();
+    ::ll::mod::NativeMod::current()->getLogger().info("IoExecutor: 已停止。");
+}
+
+bool IoExecutor::post(std::function<void()> task) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_running) return false;
+        m_tasks.push_back(std::move(task));
+    }
+    m_condition.notify_one();
+    return true;
+}
+
+size_t IoExecutor::pendingCount() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_tasks.size();
+}
+
+void IoExecutor::run() {
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_condition.wait(lock, [this] { return !m_running || !m_tasks.empty(); });
+            if (m_tasks.empty()) break; // 已停止且没有剩余任务
+            task = std::move(m_tasks.front());
+            m_tasks.pop_front();
+        }
+        try {
+            task();
+        } catch (const std::exception& e) {
+            ::ll::mod::NativeMod::current()->getLogger().error("IoExecutor: 任务执行失败: {}", e.what());
+        } catch (...) {
+            ::ll::mod::NativeMod::current()->getLogger().error("IoExecutor: 任务执行失败：未知异常。");
+        }
+    }
+}
+
+} // namespace internal
+} // namespace permission
+} // namespace BA
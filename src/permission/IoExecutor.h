@@ -0,0 +1,61 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace BA {
+namespace permission {
+namespace internal {
+
+/**
+ * @brief 执行可能访问数据库的异步 API 调用的线程池，与缓存失效器的线程池相互独立，
+ *        避免慢查询拖慢缓存失效，也避免游戏线程等待数据库。任务按提交顺序取出，线程数为 1 时严格串行。
+ */
+class IoExecutor {
+public:
+    IoExecutor() = default;
+    /**
+     * @brief 析构函数。确保在对象销毁时停止所有工作线程。
+     */
+    ~IoExecutor();
+
+    IoExecutor(const IoExecutor&)            = delete;
+    IoExecutor& operator=(const IoExecutor&) = delete;
+
+    /**
+     * @brief 启动工作线程。
+     * @param threadCount 工作线程数量，0 按 1 处理。
+     */
+    void start(unsigned int threadCount);
+    /**
+     * @brief 执行完队列中剩余的任务后停止工作线程。
+     */
+    void stop();
+
+    /**
+     * @brief 提交一个任务。
+     * @param task 在工作线程中执行的任务。
+     * @return 未运行（尚未启动或已停止）时返回 false，任务不会被执行。
+     */
+    bool post(std::function<void()> task);
+
+    // 队列中尚未开始执行的任务数量
+    size_t pendingCount() const;
+
+private:
+    void run();
+
+    mutable std::mutex                 m_mutex;
+    std::condition_variable            m_condition;
+    std::deque<std::function<void()>>  m_tasks;
+    std::vector<std::thread>           m_threads;
+    bool                               m_running = false;
+};
+
+} // namespace internal
+} // namespace permission
+} // namespace BA
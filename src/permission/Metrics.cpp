@@ -0,0 +1,320 @@
+#include "permission/Metrics.h"
+#include <algorithm>
+#include <bit>
+#include <cstdio>
+#include <mutex>
+#include <utility>
+
+namespace BA {
+namespace permission {
+namespace internal {
+
+namespace {
+
+// Prometheus 直方图使用的固定上界（秒）；HDR 桶按上界不超过它的部分累计，最多多算进下一档
+constexpr double PROMETHEUS_BOUNDS[] =
+    {1e-6, 2.5e-6, 5e-6, 1e-5, 2.5e-5, 5e-5, 1e-4, 2.5e-4, 5e-4, 1e-3, 2.5e-3, 5e-3, 1e-2, 2.5e-2, 5e-2, 0.1, 0.25, 0.5, 1, 2.5, 5, 10};
+
+std::string formatDouble(double value) {
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "%.9g", value);
+    return buffer;
+}
+
+// 纳秒转换为便于阅读的时长
+std::string formatDuration(uint64_t nanoseconds) {
+    char buffer[32];
+    if (nanoseconds < 1000) {
+        std::snprintf(buffer, sizeof(buffer), "%lluns", static_cast<unsigned long long>(nanoseconds));
+    } else if (nanoseconds < 1000000) {
+        std::snprintf(buffer, sizeof(buffer), "%.1fus", static_cast<double>(nanoseconds) / 1e3);
+    } else if (nanoseconds < 1000000000) {
+        std::snprintf(buffer, sizeof(buffer), "%.2fms", static_cast<double>(nanoseconds) / 1e6);
+    } else {
+        std::snprintf(buffer, sizeof(buffer), "%.2fs", static_cast<double>(nanoseconds) / 1e9);
+    }
+    return buffer;
+}
+
+std::string formatRatio(uint64_t hits, uint64_t misses) {
+    if (hits + misses == 0) return "-";
+    char buffer[16];
+    std::snprintf(buffer, sizeof(buffer), "%.1f%%", 100.0 * static_cast<double>(hits) / static_cast<double>(hits + misses));
+    return buffer;
+}
+
+// 失效器分道的名称，与 AsyncCacheInvalidator::Lane 的顺序一致
+constexpr const char* LANE_NAMES[INVALIDATOR_LANES] = {"global", "online", "offline"};
+constexpr const char* LANE_LABELS[INVALIDATOR_LANES] = {"全局", "在线", "离线"};
+
+std::string describeLatency(const HistogramSnapshot& snapshot) {
+    if (snapshot.count == 0) return "无样本";
+    return std::to_string(snapshot.count) + " 次, 平均 " + formatDuration(static_cast<uint64_t>(snapshot.meanNs()))
+         + ", p50 " + formatDuration(snapshot.percentileNs(0.5)) + ", p99 " + formatDuration(snapshot.percentileNs(0.99))
+         + ", max " + formatDuration(snapshot.percentileNs(1.0));
+}
+
+void writeHeader(std::string& out, const char* name, const char* type, const char* help) {
+    out += "# HELP ";
+    out += name;
+    out += ' ';
+    out += help;
+    out += "\n# TYPE ";
+    out += name;
+    out += ' ';
+    out += type;
+    out += '\n';
+}
+
+void writeSample(std::string& out, const char* name, uint64_t value) {
+    out += name;
+    out += ' ';
+    out += std::to_string(value);
+    out += '\n';
+}
+
+void writeMetric(std::string& out, const char* name, const char* type, const char* help, uint64_t value) {
+    writeHeader(out, name, type, help);
+    writeSample(out, name, value);
+}
+
+// labels 为空或形如 statement="x",
+void writeHistogramSamples(std::string& out, const std::string& name, const std::string& labels, const HistogramSnapshot& snapshot) {
+    size_t   bucket     = 0;
+    uint64_t cumulative = 0;
+    for (double bound : PROMETHEUS_BOUNDS) {
+        auto boundNs = static_cast<uint64_t>(bound * 1e9);
+        while (bucket < snapshot.buckets.size() && LatencyHistogram::bucketUpperBound(bucket) <= boundNs) {
+            cumulative += snapshot.buckets[bucket++];
+        }
+        out += name + "_bucket{" + labels + "le=\"" + formatDouble(bound) + "\"} " + std::to_string(cumulative) + "\n";
+    }
+    out += name + "_bucket{" + labels + "le=\"+Inf\"} " + std::to_string(snapshot.count) + "\n";
+    std::string plainLabels = labels.empty() ? "" : "{" + labels.substr(0, labels.size() - 1) + "}";
+    out += name + "_sum" + plainLabels + " " + formatDouble(static_cast<double>(snapshot.sumNs) / 1e9) + "\n";
+    out += name + "_count" + plainLabels + " " + std::to_string(snapshot.count) + "\n";
+}
+
+void writeHistogram(std::string& out, const char* name, const char* help, const LatencyHistogram& histogram) {
+    writeHeader(out, name, "histogram", help);
+    writeHistogramSamples(out, name, "", histogram.snapshot());
+}
+
+} // namespace
+
+size_t currentMetricStripe() {
+    static std::atomic<size_t> nextStripe{0};
+    thread_local size_t        stripe = nextStripe.fetch_add(1, std::memory_order_relaxed) % METRIC_STRIPES;
+    return stripe;
+}
+
+uint64_t Counter::value() const {
+    uint64_t total = 0;
+    for (const auto& stripe : m_stripes) total += stripe.value.load(std::memory_order_relaxed);
+    return total;
+}
+
+uint64_t HistogramSnapshot::percentileNs(double q) const {
+    if (count == 0) return 0;
+    auto     target = static_cast<uint64_t>(q * static_cast<double>(count) + 0.5);
+    uint64_t seen   = 0;
+    target          = std::clamp<uint64_t>(target, 1, count);
+    for (size_t i = 0; i < buckets.size(); ++i) {
+        seen += buckets[i];
+        if (seen >= target) return LatencyHistogram::bucketUpperBound(i);
+    }
+    return LatencyHistogram::bucketUpperBound(buckets.size() - 1);
+}
+
+LatencyHistogram::LatencyHistogram(size_t stripes) {
+    m_stripes.reserve(std::max<size_t>(stripes, 1));
+    for (size_t i = 0; i < std::max<size_t>(stripes, 1); ++i) m_stripes.push_back(std::make_unique<Stripe>());
+}
+
+// 小于 8 的值各占一个桶；其余值按最高位所在的指数分组，组内用紧随其后的 3 位作为子桶
+size_t LatencyHistogram::bucketOf(uint64_t nanoseconds) {
+    if (nanoseconds < SUB_BUCKETS) return static_cast<size_t>(nanoseconds);
+    auto exponent = static_cast<unsigned>(std::bit_width(nanoseconds)) - 1;
+    if (exponent >= MAX_EXPONENT) return BUCKET_COUNT - 1;
+    size_t sub = static_cast<size_t>(nanoseconds >> (exponent - SUB_BUCKET_BITS)) & (SUB_BUCKETS - 1);
+    return (exponent - SUB_BUCKET_BITS + 1) * SUB_BUCKETS + sub;
+}
+
+uint64_t LatencyHistogram::bucketUpperBound(size_t bucket) {
+    if (bucket < SUB_BUCKETS) return bucket;
+    unsigned exponent = static_cast<unsigned>(bucket / SUB_BUCKETS) + SUB_BUCKET_BITS - 1;
+    uint64_t width    = uint64_t{1} << (exponent - SUB_BUCKET_BITS);
+    uint64_t lower    = (SUB_BUCKETS + bucket % SUB_BUCKETS) * width;
+    return lower + width - 1;
+}
+
+void LatencyHistogram::record(uint64_t nanoseconds) {
+    auto& stripe = *m_stripes[m_stripes.size() == 1 ? 0 : currentMetricStripe() % m_stripes.size()];
+    stripe.buckets[bucketOf(nanoseconds)].fetch_add(1, std::memory_order_relaxed);
+    stripe.sumNs.fetch_add(nanoseconds, std::memory_order_relaxed);
+}
+
+HistogramSnapshot LatencyHistogram::snapshot() const {
+    HistogramSnapshot result;
+    result.buckets.assign(BUCKET_COUNT, 0);
+    for (const auto& stripe : m_stripes) {
+        for (size_t i = 0; i < BUCKET_COUNT; ++i) result.buckets[i] += stripe->buckets[i].load(std::memory_order_relaxed);
+        result.sumNs += stripe->sumNs.load(std::memory_order_relaxed);
+    }
+    // 总数由桶汇总得出，与各桶保持一致
+    for (uint64_t n : result.buckets) result.count += n;
+    return result;
+}
+
+Metrics& Metrics::getInstance() {
+    static Metrics instance;
+    return instance;
+}
+
+LatencyHistogram& Metrics::statementLatency(std::string_view statement) {
+    {
+        std::shared_lock<std::shared_mutex> lock(m_statementMutex);
+        auto                                it = m_statementLatency.find(statement);
+        if (it != m_statementLatency.end()) return *it->second;
+    }
+    std::unique_lock<std::shared_mutex> lock(m_statementMutex);
+    auto& histogram = m_statementLatency[std::string(statement)];
+    if (!histogram) histogram = std::make_unique<LatencyHistogram>();
+    return *histogram;
+}
+
+LatencyHistogram* Metrics::sampleCheck() {
+    thread_local uint32_t tick = 0;
+    return ++tick % CHECK_SAMPLE_INTERVAL == 0 ? &checkLatency : nullptr;
+}
+
+std::string Metrics::renderPrometheus(const CacheStats& cache) const {
+    std::string out;
+    writeMetric(out, "ba_permission_checks_total", "counter", "Permission nodes checked.", checks.value());
+    writeHeader(out, "ba_permission_decision_cache_total", "counter", "Decision cache lookups by result.");
+    out += "ba_permission_decision_cache_total{result=\"hit\"} " + std::to_string(decisionHits.value()) + "\n";
+    out += "ba_permission_decision_cache_total{result=\"miss\"} " + std::to_string(decisionMisses.value()) + "\n";
+    writeHeader(out, "ba_player_snapshot_cache_total", "counter", "Player snapshot cache lookups by kind and result.");
+    out += "ba_player_snapshot_cache_total{kind=\"permissions\",result=\"hit\"} "
+         + std::to_string(permissionSnapshotHits.value()) + "\n";
+    out += "ba_player_snapshot_cache_total{kind=\"permissions\",result=\"miss\"} "
+         + std::to_string(permissionSnapshotMisses.value()) + "\n";
+    out += "ba_player_snapshot_cache_total{kind=\"groups\",result=\"hit\"} " + std::to_string(groupSnapshotHits.value())
+         + "\n";
+    out += "ba_player_snapshot_cache_total{kind=\"groups\",result=\"miss\"} "
+         + std::to_string(groupSnapshotMisses.value()) + "\n";
+
+    writeMetric(out, "ba_player_cache_entries", "gauge", "Cached player permission snapshots.", cache.playerPermissionEntries);
+    writeMetric(out, "ba_player_cache_bytes", "gauge", "Estimated bytes held by player permission snapshots.", cache.playerPermissionBytes);
+    writeMetric(out, "ba_player_group_cache_entries", "gauge", "Cached player group snapshots.", cache.playerGroupEntries);
+    writeMetric(out, "ba_player_group_cache_bytes", "gauge", "Estimated bytes held by player group snapshots.", cache.playerGroupBytes);
+    writeMetric(out, "ba_player_cache_pinned", "gauge", "Pinned (online) players.", cache.pinnedPlayers);
+    writeMetric(out, "ba_player_cache_evictions_total", "counter", "Player cache entries evicted.", cache.evictions);
+    writeMetric(out, "ba_rule_sets_interned", "gauge", "Distinct compiled rule sets shared by all snapshots.", cache.internedRuleSets);
+    writeMetric(out, "ba_rule_sets_interned_bytes", "gauge", "Estimated bytes held by interned rule sets.", cache.internedRuleSetBytes);
+    writeHeader(out, "ba_rule_set_intern_total", "counter", "Snapshot builds that reused (hit) or compiled (miss) a rule set.");
+    out += "ba_rule_set_intern_total{result=\"hit\"} " + std::to_string(ruleSetInternHits.value()) + "\n";
+    out += "ba_rule_set_intern_total{result=\"miss\"} " + std::to_string(ruleSetInternMisses.value()) + "\n";
+
+    writeMetric(out, "ba_invalidator_tasks_enqueued_total", "counter", "Invalidation tasks queued.", invalidatorTasksEnqueued.value());
+    writeMetric(out, "ba_invalidator_tasks_merged_total", "counter", "Invalidation tasks merged into a pending task.", invalidatorTasksMerged.value());
+    writeMetric(out, "ba_invalidator_tasks_processed_total", "counter", "Invalidation tasks processed.", invalidatorTasksProcessed.value());
+    writeMetric(out, "ba_invalidator_tasks_failed_total", "counter", "Invalidation tasks that threw.", invalidatorTasksFailed.value());
+    writeMetric(out, "ba_invalidator_queue_depth", "gauge", "Invalidation tasks waiting in the queue.", invalidatorQueueDepth.value());
+    writeMetric(out, "ba_invalidator_queue_depth_peak", "gauge", "Highest invalidation queue depth seen.", invalidatorQueueDepth.peak());
+    writeMetric(out, "ba_invalidator_tasks_stolen_total", "counter", "Invalidation tasks taken from another worker's queue.", invalidatorTasksStolen.value());
+    writeHeader(out, "ba_invalidator_lane_depth", "gauge", "Invalidation tasks waiting per priority lane.");
+    for (size_t lane = 0; lane < INVALIDATOR_LANES; ++lane) {
+        out += "ba_invalidator_lane_depth{lane=\"" + std::string(LANE_NAMES[lane]) + "\"} "
+             + std::to_string(invalidatorLaneDepth[lane].value()) + "\n";
+    }
+
+    writeMetric(out, "ba_cleanup_runs_total", "counter", "Cleanup and expiry runs.", cleanupRuns.value());
+    writeMetric(out, "ba_expired_memberships_total", "counter", "Player group memberships removed on expiry.", expiredMemberships.value());
+
+    writeHistogram(out, "ba_permission_check_sampled_duration_seconds", "Single permission check latency, 1 in 16 checks per thread.", checkLatency);
+    writeHistogram(out, "ba_player_permission_rebuild_duration_seconds", "Player permission snapshot build latency.", permissionRebuildLatency);
+    writeHistogram(out, "ba_player_group_rebuild_duration_seconds", "Player group snapshot build latency, including the query.", groupRebuildLatency);
+    writeHistogram(out, "ba_invalidator_task_duration_seconds", "Invalidation task processing latency.", invalidatorTaskLatency);
+    writeHeader(out, "ba_invalidator_lane_wait_seconds", "histogram", "Time from enqueue to processing per priority lane.");
+    for (size_t lane = 0; lane < INVALIDATOR_LANES; ++lane) {
+        writeHistogramSamples(
+            out,
+            "ba_invalidator_lane_wait_seconds",
+            "lane=\"" + std::string(LANE_NAMES[lane]) + "\",",
+            invalidatorLaneWait[lane].snapshot()
+        );
+    }
+    writeHistogram(out, "ba_cleanup_duration_seconds", "Cleanup and expiry run latency.", cleanupLatency);
+
+    writeHeader(out, "ba_db_statement_duration_seconds", "histogram", "Storage statement latency.");
+    std::shared_lock<std::shared_mutex> lock(m_statementMutex);
+    for (const auto& [statement, histogram] : m_statementLatency) {
+        writeHistogramSamples(out, "ba_db_statement_duration_seconds", "statement=\"" + statement + "\",", histogram->snapshot());
+    }
+    return out;
+}
+
+std::vector<std::string> Metrics::renderSummary(const CacheStats& cache) const {
+    std::vector<std::string> lines;
+    lines.push_back(
+        "权限检查: " + std::to_string(checks.value()) + " 个节点, 决策缓存命中率 "
+        + formatRatio(decisionHits.value(), decisionMisses.value())
+    );
+    lines.push_back("检查耗时(采样): " + describeLatency(checkLatency.snapshot()));
+    lines.push_back(
+        "玩家快照命中率: 权限 " + formatRatio(permissionSnapshotHits.value(), permissionSnapshotMisses.value()) + ", 组 "
+        + formatRatio(groupSnapshotHits.value(), groupSnapshotMisses.value())
+    );
+    lines.push_back("权限快照构建: " + describeLatency(permissionRebuildLatency.snapshot()));
+    lines.push_back("组快照构建: " + describeLatency(groupRebuildLatency.snapshot()));
+    lines.push_back(
+        "玩家缓存: 权限快照 " + std::to_string(cache.playerPermissionEntries) + " 条 ("
+        + std::to_string(cache.playerPermissionBytes / 1024) + " KiB), 组 " + std::to_string(cache.playerGroupEntries)
+        + " 条 (" + std::to_string(cache.playerGroupBytes / 1024) + " KiB), 固定 " + std::to_string(cache.pinnedPlayers)
+        + ", 淘汰 " + std::to_string(cache.evictions)
+    );
+    lines.push_back(
+        "共享规则集: " + std::to_string(cache.internedRuleSets) + " 份 (" + std::to_string(cache.internedRuleSetBytes / 1024)
+        + " KiB), 构建复用率 " + formatRatio(ruleSetInternHits.value(), ruleSetInternMisses.value())
+    );
+    lines.push_back(
+        "失效队列: 当前 " + std::to_string(invalidatorQueueDepth.value()) + ", 峰值 "
+        + std::to_string(invalidatorQueueDepth.peak()) + "; 入队 " + std::to_string(invalidatorTasksEnqueued.value())
+        + ", 合并 " + std::to_string(invalidatorTasksMerged.value()) + ", 处理 "
+        + std::to_string(invalidatorTasksProcessed.value()) + ", 失败 " + std::to_string(invalidatorTasksFailed.value())
+        + ", 窃取 " + std::to_string(invalidatorTasksStolen.value())
+    );
+    lines.push_back("失效任务耗时: " + describeLatency(invalidatorTaskLatency.snapshot()));
+    for (size_t lane = 0; lane < INVALIDATOR_LANES; ++lane) {
+        lines.push_back(
+            std::string("失效分道 ") + LANE_LABELS[lane] + ": 当前 " + std::to_string(invalidatorLaneDepth[lane].value())
+            + ", 峰值 " + std::to_string(invalidatorLaneDepth[lane].peak()) + "; 等待 "
+            + describeLatency(invalidatorLaneWait[lane].snapshot())
+        );
+    }
+    lines.push_back(
+        "清理: " + std::to_string(cleanupRuns.value()) + " 次, 删除到期关系 " + std::to_string(expiredMemberships.value())
+        + " 条; " + describeLatency(cleanupLatency.snapshot())
+    );
+
+    // 数据库语句只列出总耗时最多的几条
+    std::vector<std::pair<std::string, HistogramSnapshot>> statements;
+    {
+        std::shared_lock<std::shared_mutex> lock(m_statementMutex);
+        for (const auto& [statement, histogram] : m_statementLatency) statements.emplace_back(statement, histogram->snapshot());
+    }
+    std::sort(statements.begin(), statements.end(), [](const auto& a, const auto& b) {
+        return a.second.sumNs > b.second.sumNs;
+    });
+    constexpr size_t TOP_STATEMENTS = 5;
+    for (size_t i = 0; i < statements.size() && i < TOP_STATEMENTS; ++i) {
+        if (statements[i].second.count == 0) break;
+        lines.push_back("数据库 " + statements[i].first + ": " + describeLatency(statements[i].second));
+    }
+    return lines;
+}
+
+} // namespace internal
+} // namespace permission
+} // namespace BA
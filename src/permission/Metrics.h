@@ -0,0 +1,192 @@
+#pragma once
+
+#include "permission/PermissionData.h"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace BA {
+namespace permission {
+namespace internal {
+
+// 条带数：每个线程固定写入其中一条，多线程计数时不会争用同一缓存行
+inline constexpr size_t METRIC_STRIPES = 16;
+
+// 失效器的优先级分道数（全局、在线玩家、离线玩家），与 AsyncCacheInvalidator::Lane 一致
+inline constexpr size_t INVALIDATOR_LANES = 3;
+
+// 当前线程使用的条带下标，线程首次调用时轮流分配
+size_t currentMetricStripe();
+
+/**
+ * @brief 按线程分条带的单调计数器，写入只有一次 relaxed 原子加，读取时汇总所有条带。
+ */
+class Counter {
+public:
+    void add(uint64_t n = 1) { m_stripes[currentMetricStripe()].value.fetch_add(n, std::memory_order_relaxed); }
+    uint64_t value() const;
+
+private:
+    struct alignas(64) Stripe {
+        std::atomic<uint64_t> value{0};
+    };
+    std::array<Stripe, METRIC_STRIPES> m_stripes;
+};
+
+/**
+ * @brief 记录当前值与历史峰值的瞬时量（例如队列长度）。
+ */
+class Gauge {
+public:
+    void set(uint64_t value) {
+        m_value.store(value, std::memory_order_relaxed);
+        uint64_t peak = m_peak.load(std::memory_order_relaxed);
+        while (value > peak && !m_peak.compare_exchange_weak(peak, value, std::memory_order_relaxed)) {}
+    }
+    uint64_t value() const { return m_value.load(std::memory_order_relaxed); }
+    uint64_t peak() const { return m_peak.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<uint64_t> m_value{0};
+    std::atomic<uint64_t> m_peak{0};
+};
+
+// 直方图的只读副本
+struct HistogramSnapshot {
+    std::vector<uint64_t> buckets; // 与 LatencyHistogram 的桶一一对应
+    uint64_t              count = 0;
+    uint64_t              sumNs = 0;
+
+    // 第 q 分位（0~1）所在桶的上界（纳秒），没有样本时为 0
+    uint64_t percentileNs(double q) const;
+    double   meanNs() const { return count > 0 ? static_cast<double>(sumNs) / static_cast<double>(count) : 0; }
+};
+
+/**
+ * @brief HDR 风格的纳秒延迟直方图：每个 2 的幂区间再等分为 8 个子桶，
+ *        任意值的相对误差不超过 12.5%，覆盖 0 到约 18 分钟（2^40 ns），更大的值计入最后一个桶。
+ *        记录只做两次 relaxed 原子加（桶与总和）；热点路径上的直方图可以分条带，避免多线程争用。
+ */
+class LatencyHistogram {
+public:
+    static constexpr unsigned SUB_BUCKET_BITS = 3;
+    static constexpr size_t   SUB_BUCKETS     = size_t{1} << SUB_BUCKET_BITS;
+    static constexpr unsigned MAX_EXPONENT    = 40;
+    static constexpr size_t   BUCKET_COUNT    = (MAX_EXPONENT - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+    /**
+     * @param stripes 条带数，只在多线程高频记录的直方图上大于 1。
+     */
+    explicit LatencyHistogram(size_t stripes = 1);
+
+    void record(uint64_t nanoseconds);
+    void record(std::chrono::nanoseconds duration) {
+        record(static_cast<uint64_t>(duration.count() > 0 ? duration.count() : 0));
+    }
+    HistogramSnapshot snapshot() const;
+
+    // 值所在桶的下标
+    static size_t   bucketOf(uint64_t nanoseconds);
+    // 桶能容纳的最大值（纳秒）
+    static uint64_t bucketUpperBound(size_t bucket);
+
+private:
+    struct alignas(64) Stripe {
+        std::array<std::atomic<uint64_t>, BUCKET_COUNT> buckets{};
+        std::atomic<uint64_t>                           sumNs{0};
+    };
+    std::vector<std::unique_ptr<Stripe>> m_stripes;
+};
+
+/**
+ * @brief 作用域计时器，析构时把经过的时间记入直方图；直方图为空指针时什么也不做（用于采样）。
+ */
+class ScopedLatency {
+public:
+    explicit ScopedLatency(LatencyHistogram* histogram)
+    : m_histogram(histogram),
+      m_start(histogram ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point{}) {}
+    explicit ScopedLatency(LatencyHistogram& histogram) : ScopedLatency(&histogram) {}
+    ~ScopedLatency() {
+        if (m_histogram) m_histogram->record(std::chrono::steady_clock::now() - m_start);
+    }
+    ScopedLatency(const ScopedLatency&)            = delete;
+    ScopedLatency& operator=(const ScopedLatency&) = delete;
+
+private:
+    LatencyHistogram*                     m_histogram;
+    std::chrono::steady_clock::time_point m_start;
+};
+
+/**
+ * @brief 进程内的运行时指标：缓存命中率、重建与数据库语句耗时、失效队列深度等。
+ *        所有记录都是无锁的，可以一直开启；通过 /ba stats 命令和 HTTP 服务器的 Prometheus 端点查看。
+ */
+class Metrics {
+public:
+    // 每个线程每隔多少次权限检查记录一次检查耗时，计时本身的开销与一次命中检查相当
+    static constexpr uint32_t CHECK_SAMPLE_INTERVAL = 16;
+
+    static Metrics& getInstance();
+
+    // 权限检查
+    Counter checks;                   // 检查的节点数（包括批量检查中的每个节点）
+    Counter decisionHits;             // 决策缓存命中
+    Counter decisionMisses;           // 决策缓存未命中，需要匹配规则
+    Counter permissionSnapshotHits;   // 玩家权限快照命中
+    Counter permissionSnapshotMisses; // 玩家权限快照未命中或已过期
+    Counter groupSnapshotHits;        // 玩家组快照命中
+    Counter groupSnapshotMisses;      // 玩家组快照未命中或已过期
+
+    // 失效器
+    Counter invalidatorTasksEnqueued;  // 入队的任务数
+    Counter invalidatorTasksMerged;    // 因已有相同任务排队而被合并的任务数
+    Counter invalidatorTasksProcessed; // 工作线程处理完的任务数
+    Counter invalidatorTasksFailed;    // 处理时抛出异常的任务数
+    Counter invalidatorTasksStolen;    // 工作线程从其他线程的队列中取走的任务数
+    Gauge   invalidatorQueueDepth;     // 所有队列中的任务数
+    std::array<Gauge, INVALIDATOR_LANES> invalidatorLaneDepth; // 各分道的任务数
+
+    // 规则集驻留
+    Counter ruleSetInternHits;   // 快照构建时复用了已编译的规则集
+    Counter ruleSetInternMisses; // 快照构建时编译了新的规则集
+
+    // 清理
+    Counter cleanupRuns;        // 定期清理与到期处理的执行次数
+    Counter expiredMemberships; // 到期删除的玩家组关系数（定期清理只能按受影响的玩家计）
+
+    LatencyHistogram checkLatency{METRIC_STRIPES}; // 单个权限检查（采样）
+    LatencyHistogram permissionRebuildLatency;     // 玩家权限快照构建
+    LatencyHistogram groupRebuildLatency;          // 玩家组快照构建（包括数据库查询）
+    LatencyHistogram invalidatorTaskLatency;       // 单个失效任务的处理
+    std::array<LatencyHistogram, INVALIDATOR_LANES> invalidatorLaneWait; // 各分道从入队到开始处理的等待时间
+    LatencyHistogram cleanupLatency;               // 单次清理或到期处理
+
+    // 按存储层语句名取直方图，首次使用时创建
+    LatencyHistogram& statementLatency(std::string_view statement);
+    // 按采样间隔返回检查耗时直方图，本次不采样时返回空指针
+    LatencyHistogram* sampleCheck();
+
+    // 以 Prometheus 文本格式（0.0.4）输出所有指标
+    std::string              renderPrometheus(const CacheStats& cache) const;
+    // 供 /ba stats 显示的摘要，每行一项
+    std::vector<std::string> renderSummary(const CacheStats& cache) const;
+
+private:
+    Metrics() = default;
+
+    mutable std::shared_mutex                                              m_statementMutex;
+    std::map<std::string, std::unique_ptr<LatencyHistogram>, std::less<>> m_statementLatency; // 语句名 -> 耗时
+};
+
+} // namespace internal
+} // namespace permission
+} // namespace BA
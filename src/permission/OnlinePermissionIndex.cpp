@@ -0,0 +1,145 @@
+#include "permission/OnlinePermissionIndex.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace BA {
+namespace permission {
+namespace internal {
+
+OnlinePermissionIndex::OnlinePermissionIndex(
+    PermissionCache& cache,
+    SnapshotResolver resolve,
+    LayerProvider    layer,
+    Evaluator        evaluate,
+    size_t           maxNodes
+)
+: m_cache(cache),
+  m_resolve(std::move(resolve)),
+  m_layerProvider(std::move(layer)),
+  m_evaluate(std::move(evaluate)),
+  m_maxNodes(std::max<size_t>(maxNodes, 1)) {
+    m_cache.setPlayerSnapshotListener(
+        [this](const PlayerKey* player, const std::shared_ptr<const PlayerPermissionSnapshot>& snapshot) {
+            onSnapshotChanged(player, snapshot);
+        }
+    );
+}
+
+void OnlinePermissionIndex::addPlayer(const PlayerKey& player) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_players.try_emplace(player); // 快照为空，下一次查询时计算
+}
+
+void OnlinePermissionIndex::removePlayer(const PlayerKey& player) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_players.erase(player) == 0) return;
+    for (auto& [node, entry] : m_nodes) entry.holders.erase(player);
+}
+
+std::vector<PlayerKey> OnlinePermissionIndex::query(const std::string& node) {
+    // 默认权限层可能需要从存储层加载，在锁外获取
+    auto layer = m_layerProvider();
+
+    std::vector<std::pair<PlayerKey, uint64_t>> pending; // 待更新的玩家及其版本
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_layer != layer) {
+            // 默认权限层被替换（版本变化），所有节点的结果都可能改变
+            m_layer = std::move(layer);
+            m_nodes.clear();
+        }
+        // 组被修改后，依赖它的快照不会被替换而是在查找时才被识别为过期；纪元不变时无需逐个检查
+        uint64_t epoch = m_cache.getGroupEpoch();
+        if (epoch != m_checkedEpoch) {
+            m_checkedEpoch = epoch;
+            for (auto& [player, entry] : m_players) {
+                if (entry.snapshot && !m_cache.isStampCurrent(*entry.snapshot)) markStaleLocked(player, entry);
+            }
+        }
+        for (const auto& [player, entry] : m_players) {
+            if (!entry.snapshot) pending.emplace_back(player, entry.version);
+        }
+    }
+
+    // 重建快照可能访问存储层，在锁外进行；重建存入缓存时监听器会先一步更新索引
+    std::vector<std::shared_ptr<const PlayerPermissionSnapshot>> snapshots;
+    snapshots.reserve(pending.size());
+    for (const auto& [player, version] : pending) snapshots.push_back(m_resolve(player));
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (size_t i = 0; i < pending.size(); ++i) {
+        auto it = m_players.find(pending[i].first);
+        // 玩家已下线，或期间快照已被监听器更新
+        if (it == m_players.end() || it->second.version != pending[i].second) continue;
+        it->second.snapshot = std::move(snapshots[i]);
+        reindexPlayerLocked(it->first, it->second);
+    }
+    auto       it    = m_nodes.find(node);
+    NodeEntry& entry = it != m_nodes.end() ? it->second : indexNodeLocked(node);
+    entry.lastQueried = ++m_clock;
+    return {entry.holders.begin(), entry.holders.end()};
+}
+
+size_t OnlinePermissionIndex::nodeCount() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_nodes.size();
+}
+
+void OnlinePermissionIndex::onSnapshotChanged(
+    const PlayerKey*                                       player,
+    const std::shared_ptr<const PlayerPermissionSnapshot>& snapshot
+) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!player) {
+        for (auto& [key, entry] : m_players) markStaleLocked(key, entry);
+        return;
+    }
+    auto it = m_players.find(*player);
+    if (it == m_players.end()) return; // 离线玩家不在索引中
+    if (!snapshot) {
+        markStaleLocked(it->first, it->second);
+        return;
+    }
+    // 通知在缓存修改之后发出，同一玩家的并发存储可能乱序到达；只采用缓存当前持有的快照，
+    // 较旧的快照被忽略，较新的存储或失效随后会再次通知
+    if (!m_cache.holdsPlayerPermissions(*player, snapshot.get())) return;
+    it->second.snapshot = snapshot;
+    ++it->second.version;
+    reindexPlayerLocked(it->first, it->second);
+}
+
+void OnlinePermissionIndex::markStaleLocked(const PlayerKey& player, PlayerEntry& entry) {
+    entry.snapshot.reset();
+    ++entry.version;
+    for (auto& [node, nodeEntry] : m_nodes) nodeEntry.holders.erase(player);
+}
+
+void OnlinePermissionIndex::reindexPlayerLocked(const PlayerKey& player, PlayerEntry& entry) {
+    for (auto& [node, nodeEntry] : m_nodes) {
+        // 节点只在查询时加入，此时默认权限层一定已经获取
+        if (m_evaluate(*entry.snapshot, *m_layer, node)) {
+            nodeEntry.holders.insert(player);
+        } else {
+            nodeEntry.holders.erase(player);
+        }
+    }
+}
+
+OnlinePermissionIndex::NodeEntry& OnlinePermissionIndex::indexNodeLocked(const std::string& node) {
+    if (m_nodes.size() >= m_maxNodes) {
+        auto oldest = std::min_element(m_nodes.begin(), m_nodes.end(), [](const auto& a, const auto& b) {
+            return a.second.lastQueried < b.second.lastQueried;
+        });
+        m_nodes.erase(oldest);
+    }
+    NodeEntry& entry = m_nodes[node];
+    for (const auto& [player, playerEntry] : m_players) {
+        if (playerEntry.snapshot && m_evaluate(*playerEntry.snapshot, *m_layer, node)) entry.holders.insert(player);
+    }
+    return entry;
+}
+
+} // namespace internal
+} // namespace permission
+} // namespace BA
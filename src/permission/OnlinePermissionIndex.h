@@ -0,0 +1,107 @@
+#pragma once
+
+#include "permission/PermissionCache.h"
+#include "permission/PermissionSnapshot.h"
+#include "permission/PlayerKey.h"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace BA {
+namespace permission {
+namespace internal {
+
+/**
+ * @brief 在线玩家的权限反向索引：权限节点 -> 拥有该权限的在线玩家。
+ *        节点在第一次被查询时加入索引，之后的查询直接返回索引中的玩家集合，不再逐个玩家匹配。
+ *        索引基于缓存中的玩家快照和共享的默认权限层，由缓存的玩家快照监听器维护：
+ *        快照被替换时（失效器重建、refresh-ahead）立即对已索引的节点重新计算该玩家；
+ *        快照失效时（淘汰、全局失效）以及组代数变化使快照过期时，该玩家被标记为待更新，
+ *        在下一次查询时重新获取快照。默认权限层变化时整个索引在下一次查询时重建。
+ */
+class OnlinePermissionIndex {
+public:
+    // 获取玩家当前的权限快照，未缓存时构建（可能访问存储层），永不返回空指针
+    using SnapshotResolver = std::function<std::shared_ptr<const PlayerPermissionSnapshot>(const PlayerKey&)>;
+    // 获取当前的默认权限层，永不返回空指针
+    using LayerProvider    = std::function<std::shared_ptr<const DefaultPermissionLayer>()>;
+    // 在快照与默认权限层上计算节点的最终结果，不得访问存储层（在索引的锁内调用）
+    using Evaluator =
+        std::function<bool(const PlayerPermissionSnapshot&, const DefaultPermissionLayer&, const std::string&)>;
+
+    /**
+     * @brief 构造索引，并把自己注册为 cache 的玩家快照监听器。
+     * @param cache 权限缓存；监听器不会被撤销，缓存不得在索引销毁后继续使用（两者应一同替换）。
+     * @param maxNodes 最多索引的节点数，超出时移除最久未查询的节点。
+     */
+    OnlinePermissionIndex(
+        PermissionCache& cache,
+        SnapshotResolver resolve,
+        LayerProvider    layer,
+        Evaluator        evaluate,
+        size_t           maxNodes = DEFAULT_MAX_NODES
+    );
+
+    OnlinePermissionIndex(const OnlinePermissionIndex&)            = delete;
+    OnlinePermissionIndex& operator=(const OnlinePermissionIndex&) = delete;
+
+    // 玩家上线，在下一次查询时计算其权限
+    void addPlayer(const PlayerKey& player);
+    // 玩家下线，从所有节点中移除
+    void removePlayer(const PlayerKey& player);
+
+    /**
+     * @brief 获取拥有某个权限节点的在线玩家。
+     * @param node 权限节点。
+     * @return 拥有该权限的在线玩家，顺序不固定。
+     */
+    std::vector<PlayerKey> query(const std::string& node);
+
+    // 已索引的节点数
+    size_t nodeCount() const;
+
+    static constexpr size_t DEFAULT_MAX_NODES = 1024;
+
+private:
+    struct PlayerEntry {
+        std::shared_ptr<const PlayerPermissionSnapshot> snapshot; // 计算索引时使用的快照，为空表示待更新
+        uint64_t                                        version = 0; // 每次快照变化时递增，丢弃锁外获取的旧快照
+    };
+
+    struct NodeEntry {
+        std::unordered_set<PlayerKey, PlayerKeyHash> holders;        // 拥有该权限的在线玩家
+        uint64_t                                     lastQueried = 0; // 最近一次查询时的逻辑时钟
+    };
+
+    // 缓存中的玩家快照被替换（snapshot 非空）或失效（snapshot 为空）；player 为空指针表示所有玩家
+    void onSnapshotChanged(const PlayerKey* player, const std::shared_ptr<const PlayerPermissionSnapshot>& snapshot);
+    // 把玩家标记为待更新并从所有节点中移除，调用方需持有 m_mutex
+    void markStaleLocked(const PlayerKey& player, PlayerEntry& entry);
+    // 用玩家的新快照重新计算所有已索引节点，调用方需持有 m_mutex
+    void reindexPlayerLocked(const PlayerKey& player, PlayerEntry& entry);
+    // 为新节点计算所有在线玩家，超出上限时先移除最久未查询的节点，调用方需持有 m_mutex
+    NodeEntry& indexNodeLocked(const std::string& node);
+
+    PermissionCache& m_cache;
+    SnapshotResolver m_resolve;
+    LayerProvider    m_layerProvider;
+    Evaluator        m_evaluate;
+    size_t           m_maxNodes;
+
+    mutable std::mutex                                           m_mutex;
+    std::unordered_map<PlayerKey, PlayerEntry, PlayerKeyHash>    m_players; // 在线玩家
+    std::unordered_map<std::string, NodeEntry, StringKeyHash, std::equal_to<>> m_nodes; // 已索引的节点
+    std::shared_ptr<const DefaultPermissionLayer>                m_layer;        // 计算索引时使用的默认权限层
+    uint64_t                                                     m_checkedEpoch = 0; // 最近一次检查快照是否过期时的全局组纪元
+    uint64_t                                                     m_clock        = 0; // 查询的逻辑时钟
+};
+
+} // namespace internal
+} // namespace permission
+} // namespace BA
@@ -1,7 +1,14 @@
 
 #include "permission/PermissionCache.h"
+#include "permission/PermissionOptions.h"
+#include "permission/RuleSetInterner.h"
+#include <algorithm>
+#include <array>
 #include <chrono>
-#include <queue>
+#include <cstddef>
+#include <functional>
+#include <memory_resource>
+#include <mutex>
 
 namespace BA {
 namespace permission {
@@ -9,6 +16,29 @@ namespace internal {
 
 using namespace std; // 使用标准命名空间
 
+namespace {
+// 玩家组快照的估算字节数
+size_t playerGroupsBytes(const PlayerGroupsSnapshot& groups) {
+    size_t bytes = sizeof(groups) + groups.capacity() * sizeof(GroupDetails) + groups.GroupGenerationStamp::memoryUsage();
+    for (const auto& group : groups) {
+        bytes += group.id.capacity() + group.name.capacity() + group.description.capacity();
+    }
+    return bytes;
+}
+
+size_t playerPermissionsBytes(const PlayerPermissionSnapshot& snapshot) {
+    return snapshot.PermissionRuleSnapshot::memoryUsage() + snapshot.GroupGenerationStamp::memoryUsage();
+}
+} // namespace
+
+PermissionCache::PermissionCache(size_t shardCount)
+: m_playerPermissionsCache(&playerPermissionsBytes, &m_pinnedPlayers, shardCount),
+  m_playerGroupsCache(&playerGroupsBytes, &m_pinnedPlayers, shardCount),
+  m_groupGraph(make_shared<const GroupGraph>()) {
+    m_decisionShards.resize(m_playerPermissionsCache.shardCount());
+    for (auto& shard : m_decisionShards) shard = make_unique<DecisionShard>();
+    setPlayerCacheMaxBytes(PermissionOptions{}.playerCacheMaxBytes);
+}
 
 // 查找组ID
 // 参数: groupName - 组名
@@ -88,104 +118,547 @@ const std::unordered_map<std::string, std::string>& PermissionCache::getAllGroup
 // --- 玩家权限缓存 ---
 
 // 查找玩家权限
-// 参数: playerUuid - 玩家UUID
-// 返回: 编译后的权限规则列表 (如果找到)
-optional<vector<CompiledPermissionRule>> PermissionCache::findPlayerPermissions(const string& playerUuid) {
-    shared_lock<shared_mutex> lock(m_playerPermissionsMutex);                 // 获取读锁
-    auto                      it = m_playerPermissionsCache.find(playerUuid); // 在玩家权限缓存中查找
-    if (it != m_playerPermissionsCache.end()) {
-        return it->second; // 返回找到的权限规则
+// 参数: player - 玩家
+// 返回: 权限快照 (未找到则为空指针)
+shared_ptr<const PlayerPermissionSnapshot> PermissionCache::findPlayerPermissions(const PlayerKey& player) const {
+    auto snapshot = m_playerPermissionsCache.find(player); // 只复制指针并刷新访问时间
+    if (snapshot && !isStampCurrent(*snapshot)) {
+        if (m_onStaleSnapshot && m_pinnedPlayers.contains(player)) {
+            m_onStaleSnapshot(player); // 在线玩家：继续使用旧快照，由后台重建后替换
+            return snapshot;
+        }
+        return nullptr; // 所依赖的组已被修改，由调用方重建
     }
-    return nullopt; // 未找到则返回空
+    return snapshot;
 }
 
 // 存储玩家权限
-// 参数: playerUuid - 玩家UUID, permissions - 权限规则列表
+// 参数: player - 玩家, snapshot - 新构建的权限快照
 void PermissionCache::storePlayerPermissions(
-    const string&                         playerUuid,
-    const vector<CompiledPermissionRule>& permissions
+    const PlayerKey&                           player,
+    shared_ptr<const PlayerPermissionSnapshot> snapshot
 ) {
-    unique_lock<shared_mutex> lock(m_playerPermissionsMutex); // 获取写锁
-    m_playerPermissionsCache[playerUuid] = permissions;       // 存储玩家权限
+    // 整体替换旧快照，超出上限时淘汰最久未访问的玩家
+    const PlayerPermissionSnapshot* stored = snapshot.get();
+    dropDecisions(m_playerPermissionsCache.store(player, snapshot));
+    // 与失效相同，先修改缓存再通知在线玩家权限索引；并发存储时索引会忽略已被替换的快照
+    if (m_onSnapshotChanged) m_onSnapshotChanged(&player, snapshot);
+    // 绑定旧快照的备忘录不再有用，清除它以免旧快照一直存活
+    auto&                     shard = decisionShardOf(player);
+    unique_lock<shared_mutex> lock(shard.mutex);
+    auto                      it = shard.memos.find(player);
+    if (it != shard.memos.end() && it->second.snapshot.get() != stored) shard.memos.erase(it);
+}
+
+// 缓存中玩家的权限快照是否仍是 snapshot
+// 参数: player - 玩家, snapshot - 快照
+bool PermissionCache::holdsPlayerPermissions(const PlayerKey& player, const PlayerPermissionSnapshot* snapshot) const {
+    return m_playerPermissionsCache.holds(player, snapshot);
 }
 
 // 使玩家权限缓存失效
-// 参数: playerUuid - 玩家UUID
-void PermissionCache::invalidatePlayerPermissions(const string& playerUuid) {
-    unique_lock<shared_mutex> lock(m_playerPermissionsMutex); // 获取写锁
-    m_playerPermissionsCache.erase(playerUuid);               // 移除玩家权限
+// 参数: player - 玩家
+void PermissionCache::invalidatePlayerPermissions(const PlayerKey& player) {
+    m_playerPermissionsCache.erase(player); // 移除玩家权限
+    if (m_onSnapshotChanged) m_onSnapshotChanged(&player, nullptr);
+    auto&                     shard = decisionShardOf(player);
+    unique_lock<shared_mutex> lock(shard.mutex); // 决策缓存随权限缓存一起失效
+    shard.memos.erase(player);
 }
 
 // 使所有玩家权限缓存失效
 void PermissionCache::invalidateAllPlayerPermissions() {
-    unique_lock<shared_mutex> lock(m_playerPermissionsMutex); // 获取写锁
-    m_playerPermissionsCache.clear();                         // 清空玩家权限缓存
+    m_playerPermissionsCache.clear(); // 清空玩家权限缓存
+    if (m_onSnapshotChanged) m_onSnapshotChanged(nullptr, nullptr);
+    for (auto& shard : m_decisionShards) {
+        unique_lock<shared_mutex> lock(shard->mutex);
+        shard->memos.clear();
+    }
+}
+
+// --- 玩家缓存容量与固定 ---
+
+// 设置玩家缓存字节上限
+// 参数: maxBytes - 每种玩家缓存的字节上限，0 表示不限制
+void PermissionCache::setPlayerCacheMaxBytes(size_t maxBytes) {
+    dropDecisions(m_playerPermissionsCache.setMaxBytes(maxBytes));
+    unindexPlayers(m_playerGroupsCache.setMaxBytes(maxBytes));
+}
+
+// 固定玩家
+// 参数: player - 玩家
+void PermissionCache::pinPlayer(const PlayerKey& player) { m_pinnedPlayers.pin(player); }
+
+// 取消固定玩家，其缓存之后按访问时间正常参与淘汰
+// 参数: player - 玩家
+void PermissionCache::unpinPlayer(const PlayerKey& player) { m_pinnedPlayers.unpin(player); }
+
+// 玩家是否被固定
+bool PermissionCache::isPinned(const PlayerKey& player) const { return m_pinnedPlayers.contains(player); }
+
+// 设置过期快照回调
+// 参数: handler - 以玩家键调用的回调，为空时关闭 refresh-ahead
+void PermissionCache::setStaleSnapshotHandler(function<void(const PlayerKey&)> handler) {
+    m_onStaleSnapshot = std::move(handler);
+}
+
+// 设置玩家快照监听器
+// 参数: listener - 以 (玩家, 新快照) 调用的回调，快照为空表示失效，玩家为空表示所有玩家
+void PermissionCache::setPlayerSnapshotListener(
+    function<void(const PlayerKey*, const shared_ptr<const PlayerPermissionSnapshot>&)> listener
+) {
+    m_onSnapshotChanged = std::move(listener);
+}
+
+// 获取玩家缓存统计
+CacheStats PermissionCache::getStats() const {
+    CacheStats stats;
+    stats.playerPermissionEntries = m_playerPermissionsCache.size();
+    stats.playerPermissionBytes   = m_playerPermissionsCache.residentBytes();
+    stats.playerGroupEntries      = m_playerGroupsCache.size();
+    stats.playerGroupBytes        = m_playerGroupsCache.residentBytes();
+    stats.maxBytesPerCache        = m_playerPermissionsCache.maxBytes();
+    stats.pinnedPlayers           = m_pinnedPlayers.size();
+    stats.shardCount              = m_playerPermissionsCache.shardCount();
+    stats.evictions               = m_playerPermissionsCache.evictions() + m_playerGroupsCache.evictions();
+    auto interned                 = RuleSetInterner::getInstance().stats();
+    stats.internedRuleSets        = interned.ruleSets;
+    stats.internedRuleSetBytes    = interned.bytes;
+    return stats;
+}
+
+// 清除被淘汰玩家的决策备忘录
+// 参数: players - 被淘汰的玩家
+void PermissionCache::dropDecisions(const vector<PlayerKey>& players) {
+    for (const auto& player : players) {
+        auto&                     shard = decisionShardOf(player);
+        unique_lock<shared_mutex> lock(shard.mutex);
+        shard.memos.erase(player);
+    }
+}
+
+// 决策缓存分片与玩家缓存使用相同的哈希分布
+PermissionCache::DecisionShard& PermissionCache::decisionShardOf(const PlayerKey& player) {
+    return *m_decisionShards[PlayerKeyHash{}(player) % m_decisionShards.size()];
+}
+
+const PermissionCache::DecisionShard& PermissionCache::decisionShardOf(const PlayerKey& player) const {
+    return *m_decisionShards[PlayerKeyHash{}(player) % m_decisionShards.size()];
+}
+
+// --- 玩家决策缓存 ---
+
+// 绑定决策备忘录
+// 参数: current - 当前的快照, version - 当前的默认权限版本
+void PermissionCache::DecisionMemo::rebind(const shared_ptr<const PlayerPermissionSnapshot>& current, uint64_t version) {
+    if (snapshot == current && defaultsVersion == version) return;
+    snapshot        = current;
+    defaultsVersion = version;
+    decisions.clear();
+    effectiveRules.reset();
+}
+
+// 获取玩家的决策备忘录，须持有分片写锁
+// 参数: shard - 玩家所在的决策分片, player - 玩家, snapshot - 得出结果所用的快照
+// 返回: 快照已不在缓存中（构建后未存储、已被替换或淘汰）时返回空指针。
+//       移除或替换缓存条目后总会在分片锁内清除备忘录，所以在锁内检查一次即可保证备忘录不会比条目存活更久
+PermissionCache::DecisionMemo* PermissionCache::memoOf(
+    DecisionShard&                                    shard,
+    const PlayerKey&                                  player,
+    const shared_ptr<const PlayerPermissionSnapshot>& snapshot
+) {
+    if (!m_playerPermissionsCache.holds(player, snapshot.get())) return nullptr;
+    return &shard.memos[player];
+}
+
+// 设置决策缓存容量
+// 参数: maxEntriesPerPlayer - 每个玩家最多缓存的节点数，0 表示禁用
+void PermissionCache::setDecisionCacheCapacity(size_t maxEntriesPerPlayer) {
+    m_decisionCapacity.store(maxEntriesPerPlayer, memory_order_relaxed);
+    if (maxEntriesPerPlayer == 0) {
+        for (auto& shard : m_decisionShards) {
+            unique_lock<shared_mutex> lock(shard->mutex);
+            shard->memos.clear();
+        }
+    }
+}
+
+// 查找决策
+// 参数: player - 玩家, snapshot - 当前使用的权限快照, node - 权限节点
+// 返回: 缓存的最终结果 (未命中或快照已变化则为空)
+optional<bool> PermissionCache::findDecision(
+    const PlayerKey&                player,
+    const PlayerPermissionSnapshot* snapshot,
+    uint64_t                        defaultsVersion,
+    const string&                   node
+) const {
+    const auto&               shard = decisionShardOf(player);
+    shared_lock<shared_mutex> lock(shard.mutex); // 获取分片读锁
+    auto                      it = shard.memos.find(player);
+    if (it == shard.memos.end() || it->second.snapshot.get() != snapshot
+        || it->second.defaultsVersion != defaultsVersion) {
+        return nullopt;
+    }
+    auto decision = it->second.decisions.find(node);
+    if (decision == it->second.decisions.end()) {
+        return nullopt;
+    }
+    return decision->second;
+}
+
+// 查找全部生效规则
+// 参数: player - 玩家, snapshot - 当前的快照, defaultsVersion - 当前的默认权限版本
+// 返回: 合并默认权限层并排序后的规则 (未计算过或已过期则为空指针)
+shared_ptr<const vector<CompiledPermissionRule>> PermissionCache::findEffectiveRules(
+    const PlayerKey&                player,
+    const PlayerPermissionSnapshot* snapshot,
+    uint64_t                        defaultsVersion
+) const {
+    const auto&               shard = decisionShardOf(player);
+    shared_lock<shared_mutex> lock(shard.mutex); // 获取分片读锁
+    auto                      it = shard.memos.find(player);
+    if (it == shard.memos.end() || it->second.snapshot.get() != snapshot
+        || it->second.defaultsVersion != defaultsVersion) {
+        return nullptr;
+    }
+    return it->second.effectiveRules;
+}
+
+// 存储全部生效规则
+// 参数: player - 玩家, snapshot - 计算所用的快照, defaultsVersion - 所用的默认权限版本, rules - 排序后的规则
+void PermissionCache::storeEffectiveRules(
+    const PlayerKey&                                  player,
+    const shared_ptr<const PlayerPermissionSnapshot>& snapshot,
+    uint64_t                                          defaultsVersion,
+    shared_ptr<const vector<CompiledPermissionRule>>  rules
+) {
+    auto&                     shard = decisionShardOf(player);
+    unique_lock<shared_mutex> lock(shard.mutex); // 获取分片写锁
+    DecisionMemo*             memo = memoOf(shard, player, snapshot);
+    if (!memo) return;
+    memo->rebind(snapshot, defaultsVersion);
+    memo->effectiveRules = std::move(rules);
+}
+
+// 批量查找决策
+// 参数: player - 玩家, snapshot - 当前的快照, defaultsVersion - 当前的默认权限版本, nodes - 权限节点
+// 返回: 与 nodes 一一对应的决策，未命中的为空
+vector<optional<bool>> PermissionCache::findDecisions(
+    const PlayerKey&                player,
+    const PlayerPermissionSnapshot* snapshot,
+    uint64_t                        defaultsVersion,
+    span<const string>              nodes
+) const {
+    vector<optional<bool>>    results(nodes.size());
+    const auto&               shard = decisionShardOf(player);
+    shared_lock<shared_mutex> lock(shard.mutex); // 获取分片读锁
+    auto                      it = shard.memos.find(player);
+    if (it == shard.memos.end() || it->second.snapshot.get() != snapshot
+        || it->second.defaultsVersion != defaultsVersion) {
+        return results;
+    }
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        auto decision = it->second.decisions.find(nodes[i]);
+        if (decision != it->second.decisions.end()) results[i] = decision->second;
+    }
+    return results;
+}
+
+// 批量存储决策
+// 参数: player - 玩家, snapshot - 得出结果所用的快照, defaultsVersion - 所用的默认权限版本,
+//       decisions - (权限节点, 最终结果) 列表
+void PermissionCache::storeDecisions(
+    const PlayerKey&                                  player,
+    const shared_ptr<const PlayerPermissionSnapshot>& snapshot,
+    uint64_t                                          defaultsVersion,
+    const vector<pair<string, bool>>&                 decisions
+) {
+    size_t capacity = m_decisionCapacity.load(memory_order_relaxed);
+    if (capacity == 0 || decisions.empty()) return;
+    auto&                     shard = decisionShardOf(player);
+    unique_lock<shared_mutex> lock(shard.mutex); // 获取分片写锁
+    DecisionMemo*             memo = memoOf(shard, player, snapshot);
+    if (!memo) return;
+    memo->rebind(snapshot, defaultsVersion);
+    for (const auto& [node, value] : decisions) {
+        if (memo->decisions.size() >= capacity && !memo->decisions.count(node)) {
+            memo->decisions.clear(); // 与 storeDecision 相同，达到上限时整体清空
+        }
+        memo->decisions[node] = value;
+    }
+}
+
+// 存储决策
+// 参数: player - 玩家, snapshot - 得出结果所用的快照, defaultsVersion - 所用的默认权限版本,
+//       node - 权限节点, value - 最终结果
+void PermissionCache::storeDecision(
+    const PlayerKey&                                  player,
+    const shared_ptr<const PlayerPermissionSnapshot>& snapshot,
+    uint64_t                                          defaultsVersion,
+    const string&                                     node,
+    bool                                              value
+) {
+    size_t capacity = m_decisionCapacity.load(memory_order_relaxed);
+    if (capacity == 0) return;
+    auto&                     shard = decisionShardOf(player);
+    unique_lock<shared_mutex> lock(shard.mutex); // 获取分片写锁
+    DecisionMemo*             memo = memoOf(shard, player, snapshot);
+    if (!memo) return;
+    if (memo->snapshot != snapshot || memo->defaultsVersion != defaultsVersion) {
+        memo->rebind(snapshot, defaultsVersion); // 玩家快照或默认权限已变化，旧结果全部作废
+    } else if (memo->decisions.size() >= capacity) {
+        // 达到上限时整体清空，热点节点会很快被重新填充
+        memo->decisions.clear();
+    }
+    memo->decisions[node] = value;
 }
 
 // --- 玩家组缓存 ---
 
 // 查找玩家组
-// 参数: playerUuid - 玩家UUID
-// 返回: 组详情列表 (如果找到)
-optional<vector<GroupDetails>> PermissionCache::findPlayerGroups(const string& playerUuid) {
-    shared_lock<shared_mutex> lock(m_playerGroupsMutex);                 // 获取读锁
-    auto                      it = m_playerGroupsCache.find(playerUuid); // 在玩家组缓存中查找
-    if (it != m_playerGroupsCache.end()) {
-        // 缓存命中，现在检查条目是否过期
-        long long currentTime =
-            std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch())
-                .count();
-        vector<GroupDetails> validGroups;
+// 参数: player - 玩家
+// 返回: 组详情列表快照 (未找到或其中有组已过期则为空指针)
+shared_ptr<const PlayerGroupsSnapshot> PermissionCache::findPlayerGroups(const PlayerKey& player) const {
+    auto groups = m_playerGroupsCache.find(player); // 在玩家组缓存中查找
+    if (!groups || !isStampCurrent(*groups)) {
+        return nullptr; // 未找到，或所属组的信息已被修改
+    }
+    // 缓存命中，检查是否有组已经过期；有则视为未命中，由调用方从数据库重新加载
+    long long currentTime =
+        std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+    for (const auto& group : *groups) {
+        if (group.expirationTime.has_value() && group.expirationTime.value() <= currentTime) {
+            return nullptr;
+        }
+    }
+    return groups;
+}
+
+// 存储玩家组
+// 参数: player - 玩家, groups - 组详情列表快照
+void PermissionCache::storePlayerGroups(const PlayerKey& player, shared_ptr<const PlayerGroupsSnapshot> groups) {
+    indexPlayerGroups(player, groups.get());
+    unindexPlayers(m_playerGroupsCache.store(player, std::move(groups))); // 存储玩家组，超出上限时淘汰
+}
+
+// 使玩家组缓存失效
+// 参数: player - 玩家
+void PermissionCache::invalidatePlayerGroups(const PlayerKey& player) {
+    m_playerGroupsCache.erase(player); // 移除玩家组
+    indexPlayerGroups(player, nullptr);
+}
+
+// --- 反向索引 ---
+// 索引只用于提前释放内存，不保证与缓存内容严格一致；是否过期始终以组代数检查为准。
+
+// 更新玩家在反向索引中的组
+// 参数: player - 玩家, groups - 新的组列表，为空指针时移除该玩家
+void PermissionCache::indexPlayerGroups(const PlayerKey& player, const PlayerGroupsSnapshot* groups) {
+    unique_lock<shared_mutex> lock(m_reverseIndexMutex);
+    auto                      it = m_indexedPlayerGroups.find(player);
+    if (it != m_indexedPlayerGroups.end()) {
         for (const auto& group : it->second) {
-            if (!group.expirationTime.has_value() || group.expirationTime.value() > currentTime) {
-                validGroups.push_back(group);
-            }
+            auto members = m_groupMembers.find(group);
+            if (members == m_groupMembers.end()) continue;
+            members->second.erase(player);
+            if (members->second.empty()) m_groupMembers.erase(members);
         }
+        m_indexedPlayerGroups.erase(it);
+    }
+    if (!groups || groups->empty()) return;
+    auto& indexed = m_indexedPlayerGroups[player];
+    for (const auto& group : *groups) {
+        indexed.push_back(group.name);
+        m_groupMembers[group.name].insert(player);
+    }
+}
+
+// 从反向索引中移除一批玩家
+// 参数: players - 玩家
+void PermissionCache::unindexPlayers(const vector<PlayerKey>& players) {
+    for (const auto& player : players) {
+        indexPlayerGroups(player, nullptr);
+    }
+}
+
+// 获取直接属于指定组的已缓存玩家
+// 参数: groups - 组的闭包
+// 返回: 去重后的玩家
+vector<PlayerKey> PermissionCache::getCachedPlayersInGroups(const GroupClosure& groups) const {
+    unordered_set<PlayerKey, PlayerKeyHash> players;
+    shared_lock<shared_mutex>               lock(m_reverseIndexMutex);
+    for (string_view group : groups) {
+        auto it = m_groupMembers.find(group);
+        if (it != m_groupMembers.end()) players.insert(it->second.begin(), it->second.end());
+    }
+    return vector<PlayerKey>(players.begin(), players.end());
+}
+
+// 批量释放直接属于指定组的未固定玩家
+// 参数: groups - 组的闭包（通常是被修改的组及其子组）
+// 返回: 释放的玩家数
+size_t PermissionCache::releasePlayersInGroups(const GroupClosure& groups) {
+    vector<PlayerKey> players = getCachedPlayersInGroups(groups);
+    players.erase(
+        remove_if(players.begin(), players.end(), [this](const PlayerKey& player) { return m_pinnedPlayers.contains(player); }),
+        players.end()
+    );
+    if (players.empty()) return 0;
+    m_playerPermissionsCache.eraseMany(players);
+    m_playerGroupsCache.eraseMany(players);
+    dropDecisions(players);
+    unindexPlayers(players);
+    return players.size();
+}
 
-        if (!validGroups.empty()) {
-            return validGroups; // 返回未过期的组
+// 获取组信息在缓存中的所有玩家
+// 返回: 反向索引中的玩家
+vector<PlayerKey> PermissionCache::getCachedPlayers() const {
+    vector<PlayerKey>         players;
+    shared_lock<shared_mutex> lock(m_reverseIndexMutex);
+    players.reserve(m_indexedPlayerGroups.size());
+    for (const auto& [player, groups] : m_indexedPlayerGroups) players.push_back(player);
+    return players;
+}
+
+// 释放所有未固定玩家的缓存
+// 返回: 释放的玩家数
+size_t PermissionCache::releaseAllPlayers() {
+    vector<PlayerKey> players = getCachedPlayers();
+    players.erase(
+        remove_if(players.begin(), players.end(), [this](const PlayerKey& player) { return m_pinnedPlayers.contains(player); }),
+        players.end()
+    );
+    if (players.empty()) return 0;
+    m_playerPermissionsCache.eraseMany(players);
+    m_playerGroupsCache.eraseMany(players);
+    dropDecisions(players);
+    unindexPlayers(players);
+    return players.size();
+}
+
+// --- 组代数 ---
+
+// 获取全局组纪元
+uint64_t PermissionCache::getGroupEpoch() const { return m_groupEpoch.load(memory_order_acquire); }
+
+// 获取组的当前代数
+// 参数: groupNames - 组名集合
+// 返回: 组名与代数的列表，未被修改过的组代数为 0
+GroupGenerations PermissionCache::captureGroupGenerations(const set<string>& groupNames) const {
+    vector<string_view> names(groupNames.begin(), groupNames.end());
+    return captureGroupGenerations(names);
+}
+
+// 参数: groupNames - 组名（互不相同），只在调用期间使用
+GroupGenerations PermissionCache::captureGroupGenerations(span<const string_view> groupNames) const {
+    // 条目先写入栈上的缓冲区，最终只为快照分配一块连续内存
+    std::array<std::byte, 2048>         buffer;
+    pmr::monotonic_buffer_resource      arena(buffer.data(), buffer.size());
+    pmr::vector<GroupGenerations::Entry> entries(&arena);
+    entries.reserve(groupNames.size());
+    {
+        shared_lock<shared_mutex> lock(m_groupGenerationMutex);
+        for (string_view name : groupNames) {
+            auto it = m_groupGenerations.find(name);
+            entries.push_back({name, it == m_groupGenerations.end() ? m_baseGeneration : it->second});
         }
-        // 如果所有组都已过期，则视为缓存未命中
     }
-    return nullopt; // 未找到或所有组都已过期
+    return GroupGenerations(entries);
 }
 
-// 存储玩家组
-// 参数: playerUuid - 玩家UUID, groups - 组详情列表
-void PermissionCache::storePlayerGroups(const string& playerUuid, const vector<GroupDetails>& groups) {
-    unique_lock<shared_mutex> lock(m_playerGroupsMutex); // 获取写锁
-    m_playerGroupsCache[playerUuid] = groups;            // 存储玩家组
+// 递增组代数
+// 参数: groupNames - 被修改的组（通常是某个组及其所有子组）
+void PermissionCache::bumpGroupGenerations(const set<string>& groupNames) {
+    if (groupNames.empty()) return;
+    unique_lock<shared_mutex> lock(m_groupGenerationMutex);
+    for (const auto& name : groupNames) {
+        ++m_groupGenerations.try_emplace(name, m_baseGeneration).first->second;
+    }
+    m_groupEpoch.fetch_add(1, memory_order_release); // 在锁内递增，保证读到新纪元的线程也能读到新代数
 }
 
-// 使玩家组缓存失效
-// 参数: playerUuid - 玩家UUID
-void PermissionCache::invalidatePlayerGroups(const string& playerUuid) {
-    unique_lock<shared_mutex> lock(m_playerGroupsMutex); // 获取写锁
-    m_playerGroupsCache.erase(playerUuid);               // 移除玩家组
+// 参数: groups - 被修改的组的后代闭包
+void PermissionCache::bumpGroupGenerations(const GroupClosure& groups) {
+    unique_lock<shared_mutex> lock(m_groupGenerationMutex);
+    for (string_view name : groups) {
+        auto it = m_groupGenerations.find(name);
+        if (it == m_groupGenerations.end()) it = m_groupGenerations.emplace(string(name), m_baseGeneration).first;
+        ++it->second;
+    }
+    m_groupEpoch.fetch_add(1, memory_order_release);
+}
+
+// 递增所有组的代数：映射中的组逐个递增，其余的组共享基础代数，一起递增
+void PermissionCache::bumpAllGroupGenerations() {
+    unique_lock<shared_mutex> lock(m_groupGenerationMutex);
+    ++m_baseGeneration;
+    for (auto& [name, generation] : m_groupGenerations) ++generation;
+    m_groupEpoch.fetch_add(1, memory_order_release);
+}
+
+// 检查快照是否过期
+// 参数: stamp - 快照记录的组代数
+// 返回: 所有依赖的组代数都未变化时返回 true
+bool PermissionCache::isStampCurrent(const GroupGenerationStamp& stamp) const {
+    uint64_t epoch = m_groupEpoch.load(memory_order_acquire);
+    if (stamp.validatedEpoch.load(memory_order_relaxed) == epoch) {
+        return true; // 常见路径：自上次确认以来没有任何组被修改
+    }
+    {
+        shared_lock<shared_mutex> lock(m_groupGenerationMutex);
+        for (const auto& [name, generation] : stamp.groupGenerations) {
+            auto     it      = m_groupGenerations.find(name);
+            uint64_t current = it == m_groupGenerations.end() ? m_baseGeneration : it->second;
+            if (current != generation) return false;
+        }
+    }
+    // 被修改的都是无关的组，记录新纪元，之后的查找重新走快速路径
+    stamp.validatedEpoch.store(epoch, memory_order_relaxed);
+    return true;
 }
 
 // --- 组权限缓存 ---
 
 // 查找组权限
 // 参数: groupName - 组名
-// 返回: 编译后的权限规则列表 (如果找到)
-optional<vector<CompiledPermissionRule>> PermissionCache::findGroupPermissions(const string& groupName) {
+// 返回: 权限快照 (未找到则为空指针)
+shared_ptr<const GroupPermissionSnapshot> PermissionCache::findGroupPermissions(const string& groupName) const {
     shared_lock<shared_mutex> lock(m_groupPermissionsMutex);                // 获取读锁
     auto                      it = m_groupPermissionsCache.find(groupName); // 在组权限缓存中查找
     if (it != m_groupPermissionsCache.end()) {
-        return it->second; // 返回找到的权限规则
+        return it->second;
     }
-    return nullopt; // 未找到则返回空
+    return nullptr; // 未找到则返回空
 }
 
 // 存储组权限
-// 参数: groupName - 组名, permissions - 权限规则列表
+// 参数: groupName - 组名, snapshot - 权限快照
 void PermissionCache::storeGroupPermissions(
-    const string&                         groupName,
-    const vector<CompiledPermissionRule>& permissions
+    const string&                             groupName,
+    shared_ptr<const GroupPermissionSnapshot> snapshot
 ) {
-    unique_lock<shared_mutex> lock(m_groupPermissionsMutex); // 获取写锁
-    m_groupPermissionsCache[groupName] = permissions;        // 存储组权限
+    unique_lock<shared_mutex> lock(m_groupPermissionsMutex);  // 获取写锁
+    m_groupPermissionsCache[groupName] = std::move(snapshot); // 存储组权限
+}
+
+uint64_t PermissionCache::getGroupPermissionsVersion() const {
+    return m_groupPermissionsVersion.load(memory_order_acquire);
+}
+
+// 按版本存储组权限：版本在写锁内比较，失效也在同一把锁内递增版本，
+// 因此构建期间读到旧数据的快照要么被拒绝，要么在失效时被一并移除
+// 参数: groupName - 组名, snapshot - 权限快照, version - 开始构建前的版本
+// 返回: 是否已存储
+bool PermissionCache::storeGroupPermissions(
+    const string&                             groupName,
+    shared_ptr<const GroupPermissionSnapshot> snapshot,
+    uint64_t                                  version
+) {
+    unique_lock<shared_mutex> lock(m_groupPermissionsMutex);
+    if (m_groupPermissionsVersion.load(memory_order_relaxed) != version) return false;
+    m_groupPermissionsCache[groupName] = std::move(snapshot);
+    return true;
 }
 
 // 使组权限缓存失效
@@ -193,12 +666,31 @@ void PermissionCache::storeGroupPermissions(
 void PermissionCache::invalidateGroupPermissions(const string& groupName) {
     unique_lock<shared_mutex> lock(m_groupPermissionsMutex); // 获取写锁
     m_groupPermissionsCache.erase(groupName);                // 移除组权限
+    m_groupPermissionsVersion.fetch_add(1, memory_order_release);
+}
+
+// 参数: groups - 组的闭包
+void PermissionCache::invalidateGroupPermissions(const GroupClosure& groups) {
+    unique_lock<shared_mutex> lock(m_groupPermissionsMutex);
+    for (string_view name : groups) {
+        auto it = m_groupPermissionsCache.find(name);
+        if (it != m_groupPermissionsCache.end()) m_groupPermissionsCache.erase(it);
+    }
+    m_groupPermissionsVersion.fetch_add(1, memory_order_release);
 }
 
 // 使所有组权限缓存失效
 void PermissionCache::invalidateAllGroupPermissions() {
     unique_lock<shared_mutex> lock(m_groupPermissionsMutex); // 获取写锁
     m_groupPermissionsCache.clear();                         // 清空组权限缓存
+    m_groupPermissionsVersion.fetch_add(1, memory_order_release);
+}
+
+// 获取所有组权限
+// 返回: 组名与权限快照的列表
+vector<pair<string, shared_ptr<const GroupPermissionSnapshot>>> PermissionCache::getAllGroupPermissions() const {
+    shared_lock<shared_mutex> lock(m_groupPermissionsMutex); // 获取读锁
+    return {m_groupPermissionsCache.begin(), m_groupPermissionsCache.end()};
 }
 
 // --- 默认权限缓存 ---
@@ -219,7 +711,12 @@ optional<bool> PermissionCache::findPermissionDefault(const string& permissionNa
 // 参数: permissionName - 权限名, defaultValue - 默认值
 void PermissionCache::storePermissionDefault(const string& permissionName, bool defaultValue) {
     unique_lock<shared_mutex> lock(m_permissionDefaultsMutex); // 获取写锁
-    m_permissionDefaultsCache[permissionName] = defaultValue;  // 存储默认权限
+    auto [it, inserted] = m_permissionDefaultsCache.try_emplace(permissionName, defaultValue);
+    if (inserted || it->second != defaultValue) {
+        it->second = defaultValue; // 存储默认权限
+        // 新增或变化的默认值会影响默认权限层和所有决策缓存，递增版本使其失效
+        ++m_defaultsVersion;
+    }
 }
 
 // 批量填充所有默认权限
@@ -227,6 +724,8 @@ void PermissionCache::storePermissionDefault(const string& permissionName, bool
 void PermissionCache::populateAllPermissionDefaults(unordered_map<string, bool>&& defaultsMap) {
     unique_lock<shared_mutex> lock(m_permissionDefaultsMutex); // 获取写锁
     m_permissionDefaultsCache = std::move(defaultsMap);        // 移动赋值填充默认权限缓存
+    m_defaultsLoaded          = true;
+    ++m_defaultsVersion;
 }
 
 // 获取所有默认权限
@@ -236,6 +735,41 @@ const std::unordered_map<std::string, bool>& PermissionCache::getAllPermissionDe
     return m_permissionDefaultsCache;                          // 返回默认权限缓存
 }
 
+// 默认权限是否已加载
+bool PermissionCache::permissionDefaultsLoaded() const {
+    shared_lock<shared_mutex> lock(m_permissionDefaultsMutex);
+    return m_defaultsLoaded;
+}
+
+// 获取默认权限版本
+uint64_t PermissionCache::getDefaultsVersion() const { return m_defaultsVersion.load(memory_order_acquire); }
+
+// 获取默认权限层
+// 返回: 与当前版本一致的默认权限层；版本落后时在锁外重建后替换
+shared_ptr<const DefaultPermissionLayer> PermissionCache::getDefaultLayer() {
+    uint64_t                       version;
+    vector<CompiledPermissionRule> defaultRules;
+    {
+        shared_lock<shared_mutex> lock(m_permissionDefaultsMutex);
+        if (m_defaultLayer && m_defaultLayer->version == m_defaultsVersion) {
+            return m_defaultLayer; // 常见路径：只复制指针
+        }
+        version = m_defaultsVersion;
+        for (const auto& [name, value] : m_permissionDefaultsCache) {
+            if (value) defaultRules.emplace_back(name, true);
+        }
+    }
+    // 注册权限时版本会连续变化，重建被推迟到第一次读取，避免每次注册都编译一次
+    sort(defaultRules.begin(), defaultRules.end(), [](const auto& a, const auto& b) { return a.pattern < b.pattern; });
+    auto layer = make_shared<const DefaultPermissionLayer>(version, std::move(defaultRules));
+
+    unique_lock<shared_mutex> lock(m_permissionDefaultsMutex);
+    if (!m_defaultLayer || m_defaultLayer->version < layer->version) {
+        m_defaultLayer = layer;
+    }
+    return layer;
+}
+
 // --- 继承缓存 ---
 
 // 填充继承关系
@@ -244,120 +778,116 @@ void PermissionCache::populateInheritance(
     unordered_map<string, set<string>>&& parentToChildren,
     unordered_map<string, set<string>>&& childToParents
 ) {
+    // childToParents 已包含全部边，parentToChildren 只为保持接口兼容
+    (void)parentToChildren;
+    auto                      graph = make_shared<const GroupGraph>(GroupGraph::build(childToParents));
+    lock_guard<mutex>         writeLock(m_inheritanceWriteMutex);
     unique_lock<shared_mutex> lock(m_inheritanceMutex); // 获取写锁
-    m_parentToChildren = std::move(parentToChildren);   // 移动赋值父组到子组的映射
-    m_childToParents   = std::move(childToParents);     // 移动赋值子组到父组的映射
+    m_groupGraph = std::move(graph);
 }
 
 // 添加继承关系
 // 参数: child - 子组, parent - 父组
 void PermissionCache::addInheritance(const string& child, const string& parent) {
-    unique_lock<shared_mutex> lock(m_inheritanceMutex); // 获取写锁
-    m_childToParents[child].insert(parent);             // 在子组到父组的映射中添加关系
-    m_parentToChildren[parent].insert(child);           // 在父组到子组的映射中添加关系
+    lock_guard<mutex> writeLock(m_inheritanceWriteMutex); // 防止并发修改丢失更新
+    auto              current = getGroupGraph();
+    auto              next    = make_shared<GroupGraph>(*current); // 在副本上增量更新闭包
+    next->addEdge(next->intern(child), next->intern(parent));
+    unique_lock<shared_mutex> lock(m_inheritanceMutex); // 只在替换指针时持有写锁
+    m_groupGraph = std::move(next);
 }
 
 // 移除继承关系
 // 参数: child - 子组, parent - 父组
 void PermissionCache::removeInheritance(const string& child, const string& parent) {
-    unique_lock<shared_mutex> lock(m_inheritanceMutex); // 获取写锁
-    if (m_childToParents.count(child)) {                // 如果子组存在
-        m_childToParents[child].erase(parent);          // 移除子组到父组的映射
-        if (m_childToParents[child].empty()) {          // 如果子组的父组列表为空
-            m_childToParents.erase(child);              // 移除该子组
-        }
-    }
-    if (m_parentToChildren.count(parent)) {       // 如果父组存在
-        m_parentToChildren[parent].erase(child);  // 移除父组到子组的映射
-        if (m_parentToChildren[parent].empty()) { // 如果父组的子组列表为空
-            m_parentToChildren.erase(parent);     // 移除该父组
-        }
-    }
+    lock_guard<mutex> writeLock(m_inheritanceWriteMutex);
+    auto              current  = getGroupGraph();
+    GroupId           childId  = current->find(child);
+    GroupId           parentId = current->find(parent);
+    if (childId == GroupGraph::INVALID_GROUP || parentId == GroupGraph::INVALID_GROUP) return;
+    auto next = make_shared<GroupGraph>(*current);
+    if (!next->removeEdge(childId, parentId)) return;
+    unique_lock<shared_mutex> lock(m_inheritanceMutex);
+    m_groupGraph = std::move(next);
+}
+
+// 移除组的全部继承边，组名仍保留在图中以免 ID 失效
+// 参数: groupName - 被删除的组
+void PermissionCache::removeGroupFromGraph(const string& groupName) {
+    lock_guard<mutex> writeLock(m_inheritanceWriteMutex);
+    auto              current = getGroupGraph();
+    GroupId           id      = current->find(groupName);
+    if (id == GroupGraph::INVALID_GROUP) return;
+    auto next = make_shared<GroupGraph>(*current);
+    if (!next->detach(id)) return;
+    unique_lock<shared_mutex> lock(m_inheritanceMutex);
+    m_groupGraph = std::move(next);
+}
+
+// 替换继承关系图
+// 参数: graph - 新的图
+void PermissionCache::replaceGroupGraph(shared_ptr<const GroupGraph> graph) {
+    if (!graph) return;
+    lock_guard<mutex>         writeLock(m_inheritanceWriteMutex);
+    unique_lock<shared_mutex> lock(m_inheritanceMutex);
+    m_groupGraph = std::move(graph);
+}
+
+// 获取继承关系图
+// 返回: 当前的图，永不为空
+shared_ptr<const GroupGraph> PermissionCache::getGroupGraph() const {
+    shared_lock<shared_mutex> lock(m_inheritanceMutex); // 获取读锁，只复制指针
+    return m_groupGraph;
 }
 
 // 检查是否存在路径
 // 参数: startNode - 起始节点, endNode - 结束节点
-// 返回: 如果存在路径则为true，否则为false
+// 返回: 如果从 startNode 沿父到子方向可以到达 endNode 则为true，否则为false
 bool PermissionCache::hasPath(const string& startNode, const string& endNode) const {
-    if (startNode == endNode) return true;              // 如果起始节点和结束节点相同，则存在路径
-    shared_lock<shared_mutex> lock(m_inheritanceMutex); // 获取读锁
-
-    queue<string> q;       // 广度优先搜索队列
-    set<string>   visited; // 已访问节点集合
-
-    q.push(startNode);         // 将起始节点加入队列
-    visited.insert(startNode); // 将起始节点标记为已访问
-
-    while (!q.empty()) {
-        string current = q.front(); // 获取当前节点
-        q.pop();                    // 移除当前节点
-
-        auto it = m_parentToChildren.find(current); // 查找当前节点的子节点
-        if (it != m_parentToChildren.end()) {
-            for (const auto& neighbor : it->second) {          // 遍历所有子节点
-                if (neighbor == endNode) return true;          // 如果找到结束节点，则存在路径
-                if (visited.find(neighbor) == visited.end()) { // 如果子节点未被访问
-                    visited.insert(neighbor);                  // 标记为已访问
-                    q.push(neighbor);                          // 加入队列
-                }
-            }
-        }
-    }
-    return false; // 未找到路径
+    if (startNode == endNode) return true; // 如果起始节点和结束节点相同，则存在路径
+    auto    graph = getGroupGraph();
+    GroupId from  = graph->find(startNode);
+    GroupId to    = graph->find(endNode);
+    if (from == GroupGraph::INVALID_GROUP || to == GroupGraph::INVALID_GROUP) return false;
+    return graph->hasPath(from, to); // 在预先计算的后代闭包中二分查找
 }
 
 // 获取所有祖先组
 // 参数: groupName - 组名
 // 返回: 所有祖先组的集合 (包括自身)
 set<string> PermissionCache::getAllAncestorGroups(const string& groupName) const {
-    shared_lock<shared_mutex> lock(m_inheritanceMutex); // 获取读锁
-    set<string>               ancestors;                // 祖先组集合
-    queue<string>             q;                        // 广度优先搜索队列
-
-    q.push(groupName);           // 将当前组加入队列
-    ancestors.insert(groupName); // 将当前组标记为祖先
-
-    while (!q.empty()) {
-        string current = q.front();               // 获取当前节点
-        q.pop();                                  // 移除当前节点
-        auto it = m_childToParents.find(current); // 查找当前节点的父节点
-        if (it != m_childToParents.end()) {
-            for (const auto& parent : it->second) {              // 遍历所有父节点
-                if (ancestors.find(parent) == ancestors.end()) { // 如果父节点未被访问
-                    ancestors.insert(parent);                    // 标记为祖先
-                    q.push(parent);                              // 加入队列
-                }
-            }
-        }
-    }
-    return ancestors; // 返回所有祖先组
+    auto    graph = getGroupGraph();
+    GroupId id    = graph->find(groupName);
+    if (id == GroupGraph::INVALID_GROUP) return {groupName}; // 没有任何继承关系的组
+    set<string> ancestors;
+    for (GroupId ancestor : graph->ancestorsOf(id)) ancestors.insert(graph->nameOf(ancestor));
+    return ancestors;
 }
 
 // 递归获取所有子组
 // 参数: groupName - 组名
 // 返回: 所有子组的集合 (包括自身)
 set<string> PermissionCache::getChildGroupsRecursive(const string& groupName) const {
-    shared_lock<shared_mutex> lock(m_inheritanceMutex); // 获取读锁
-    set<string>               children;                 // 子组集合
-    queue<string>             q;                        // 广度优先搜索队列
-
-    q.push(groupName);          // 将当前组加入队列
-    children.insert(groupName); // 将当前组标记为子组
-
-    while (!q.empty()) {
-        string current = q.front();                 // 获取当前节点
-        q.pop();                                    // 移除当前节点
-        auto it = m_parentToChildren.find(current); // 查找当前节点的子节点
-        if (it != m_parentToChildren.end()) {
-            for (const auto& child : it->second) {            // 遍历所有子节点
-                if (children.find(child) == children.end()) { // 如果子节点未被访问
-                    children.insert(child);                   // 标记为子组
-                    q.push(child);                            // 加入队列
-                }
-            }
-        }
-    }
-    return children; // 返回所有子组
+    auto    graph = getGroupGraph();
+    GroupId id    = graph->find(groupName);
+    if (id == GroupGraph::INVALID_GROUP) return {groupName};
+    set<string> children;
+    for (GroupId child : graph->descendantsOf(id)) children.insert(graph->nameOf(child));
+    return children;
+}
+
+// 获取祖先闭包
+// 参数: groupName - 组名
+// 返回: 所有祖先组 (包括自身) 的视图
+GroupClosure PermissionCache::getAncestorClosure(const string& groupName) const {
+    return GroupClosure(getGroupGraph(), groupName, true);
+}
+
+// 获取后代闭包
+// 参数: groupName - 组名
+// 返回: 所有子组 (包括自身) 的视图
+GroupClosure PermissionCache::getDescendantClosure(const string& groupName) const {
+    return GroupClosure(getGroupGraph(), groupName, false);
 }
 
 
@@ -1,18 +1,41 @@
 #pragma once
 
-#include "permission/PermissionData.h" // 包含权限数据结构定义
-#include <optional>                     // 用于可选值
+#include "permission/PermissionData.h"    // 包含权限数据结构定义
+#include "permission/PermissionSnapshot.h" // 包含不可变权限快照
+#include "permission/GroupGraph.h"         // 包含组继承关系图
+#include "permission/PlayerCacheMap.h"     // 包含有界玩家缓存表
+#include "permission/PlayerKey.h"          // 包含玩家缓存键
+#include <mutex>
+#include <atomic>                          // 用于原子计数
+#include <functional>                      // 用于回调
+#include <memory>                          // 用于共享指针
+#include <optional>                        // 用于可选值
 #include <shared_mutex>                 // 用于读写锁
+#include <span>                         // 用于批量查找
+#include <string_view>                  // 用于异构查找
 #include <unordered_map>                // 用于哈希表
+#include <unordered_set>                // 用于反向索引
+#include <vector>
 
 
 namespace BA {
 namespace permission {
 namespace internal {
 
+// 允许用 std::string_view 查找 std::string 键，查找时不构造临时字符串
+struct StringKeyHash {
+    using is_transparent = void;
+    size_t operator()(std::string_view key) const noexcept { return std::hash<std::string_view>{}(key); }
+};
+
 // 权限缓存类，用于存储和管理各种权限相关的数据
 class PermissionCache {
 public:
+    /**
+     * @param shardCount 玩家缓存与决策缓存的分片数，1 表示每种缓存只用一把读写锁。
+     */
+    explicit PermissionCache(size_t shardCount = 1);
+
     // 组名/ID 缓存
     // 根据组名查找组ID
     std::optional<std::string> findGroupId(const std::string& groupName);
@@ -28,32 +51,137 @@ public:
     const std::unordered_map<std::string, std::string>& getAllGroups() const;
 
     // 玩家权限缓存
-    // 查找指定玩家的权限
-    std::optional<std::vector<CompiledPermissionRule>> findPlayerPermissions(const std::string& playerUuid);
-    // 存储指定玩家的权限
-    void storePlayerPermissions(const std::string& playerUuid, const std::vector<CompiledPermissionRule>& permissions);
+    // 查找指定玩家的权限快照，未命中返回空指针
+    std::shared_ptr<const PlayerPermissionSnapshot> findPlayerPermissions(const PlayerKey& player) const;
+    // 存储（替换）指定玩家的权限快照
+    void storePlayerPermissions(const PlayerKey& player, std::shared_ptr<const PlayerPermissionSnapshot> snapshot);
+    // 缓存中指定玩家的权限快照是否仍是 snapshot，不刷新访问时间
+    bool holdsPlayerPermissions(const PlayerKey& player, const PlayerPermissionSnapshot* snapshot) const;
     // 使指定玩家的权限缓存失效
-    void invalidatePlayerPermissions(const std::string& playerUuid);
+    void invalidatePlayerPermissions(const PlayerKey& player);
     // 使所有玩家的权限缓存失效
     void invalidateAllPlayerPermissions();
 
+    // 玩家缓存容量与固定
+    // 设置玩家权限快照与玩家组缓存各自的字节上限，0 表示不限制
+    void       setPlayerCacheMaxBytes(size_t maxBytes);
+    // 固定玩家（通常在玩家上线时调用），被固定玩家的缓存不会被淘汰
+    void       pinPlayer(const PlayerKey& player);
+    // 取消固定玩家（通常在玩家下线时调用）
+    void       unpinPlayer(const PlayerKey& player);
+    // 玩家是否被固定
+    bool       isPinned(const PlayerKey& player) const;
+    // 获取玩家缓存的占用统计
+    CacheStats getStats() const;
+    // 设置过期快照回调（refresh-ahead）：设置后，被固定玩家的过期权限快照会继续返回，
+    // 同时调用回调请求后台重建。只应在初始化阶段调用
+    void       setStaleSnapshotHandler(std::function<void(const PlayerKey&)> handler);
+    // 设置玩家快照监听器：快照被存储时以新快照调用，失效时以空指针调用，全部失效时 player 为空指针。
+    // 总是在缓存被修改之后、在缓存的锁外调用，并发修改同一玩家时通知的顺序可能与修改顺序不同，
+    // 监听器应以 holdsPlayerPermissions 忽略已被替换的快照。只应在初始化阶段调用
+    void       setPlayerSnapshotListener(
+              std::function<void(const PlayerKey*, const std::shared_ptr<const PlayerPermissionSnapshot>&)> listener
+          );
+
+    // 玩家决策缓存（节点 -> 最终结果，包含回退到默认值的结果）
+    // 设置每个玩家最多缓存的节点数，0 表示禁用
+    void setDecisionCacheCapacity(size_t maxEntriesPerPlayer);
+    // 查找基于指定快照和默认权限版本得出的决策，任一变化时视为未命中
+    std::optional<bool> findDecision(
+        const PlayerKey&                player,
+        const PlayerPermissionSnapshot* snapshot,
+        uint64_t                        defaultsVersion,
+        const std::string&              node
+    ) const;
+    // 查找基于指定快照和默认权限版本合并、排序后的全部生效规则，任一变化时视为未命中
+    std::shared_ptr<const std::vector<CompiledPermissionRule>> findEffectiveRules(
+        const PlayerKey&                player,
+        const PlayerPermissionSnapshot* snapshot,
+        uint64_t                        defaultsVersion
+    ) const;
+    // 存储基于指定快照和默认权限版本合并、排序后的全部生效规则
+    void storeEffectiveRules(
+        const PlayerKey&                                           player,
+        const std::shared_ptr<const PlayerPermissionSnapshot>&     snapshot,
+        uint64_t                                                   defaultsVersion,
+        std::shared_ptr<const std::vector<CompiledPermissionRule>> rules
+    );
+    // 批量查找决策，只加一次读锁，返回值与 nodes 一一对应
+    std::vector<std::optional<bool>> findDecisions(
+        const PlayerKey&                player,
+        const PlayerPermissionSnapshot* snapshot,
+        uint64_t                        defaultsVersion,
+        std::span<const std::string>    nodes
+    ) const;
+    // 批量存储决策，只加一次写锁
+    void storeDecisions(
+        const PlayerKey&                                       player,
+        const std::shared_ptr<const PlayerPermissionSnapshot>& snapshot,
+        uint64_t                                               defaultsVersion,
+        const std::vector<std::pair<std::string, bool>>&       decisions
+    );
+    // 存储基于指定快照和默认权限版本得出的决策
+    void storeDecision(
+        const PlayerKey&                                       player,
+        const std::shared_ptr<const PlayerPermissionSnapshot>& snapshot,
+        uint64_t                                               defaultsVersion,
+        const std::string&                                     node,
+        bool                                                   value
+    );
+
     // 玩家组缓存
-    // 查找指定玩家所属的组
-    std::optional<std::vector<GroupDetails>> findPlayerGroups(const std::string& playerUuid);
-    // 存储指定玩家所属的组
-    void storePlayerGroups(const std::string& playerUuid, const std::vector<GroupDetails>& groups);
+    // 查找指定玩家所属的组，未命中或存在已过期的组时返回空指针
+    std::shared_ptr<const PlayerGroupsSnapshot> findPlayerGroups(const PlayerKey& player) const;
+    // 存储（替换）指定玩家所属的组
+    void storePlayerGroups(const PlayerKey& player, std::shared_ptr<const PlayerGroupsSnapshot> groups);
     // 使指定玩家的组缓存失效
-    void invalidatePlayerGroups(const std::string& playerUuid);
+    void invalidatePlayerGroups(const PlayerKey& player);
+
+    // 反向索引（组名 -> 已缓存组信息的玩家）
+    // 获取直接属于指定组、且组信息在缓存中的玩家
+    std::vector<PlayerKey>   getCachedPlayersInGroups(const GroupClosure& groups) const;
+    // 批量释放直接属于指定组的未固定玩家的缓存，返回释放的玩家数；被固定的玩家留给代数检查按需重建
+    size_t                   releasePlayersInGroups(const GroupClosure& groups);
+    // 获取组信息在缓存中的所有玩家
+    std::vector<PlayerKey>   getCachedPlayers() const;
+    // 释放所有未固定玩家的缓存，返回释放的玩家数
+    size_t                   releaseAllPlayers();
+
+    // 组代数（玩家快照的惰性失效）
+    // 获取全局组纪元，任何组的代数递增时它也会递增
+    uint64_t         getGroupEpoch() const;
+    // 获取指定组当前的代数
+    GroupGenerations captureGroupGenerations(const std::set<std::string>& groupNames) const;
+    GroupGenerations captureGroupGenerations(std::span<const std::string_view> groupNames) const;
+    // 递增指定组的代数，依赖这些组的玩家快照在下次查找时视为过期
+    void             bumpGroupGenerations(const std::set<std::string>& groupNames);
+    void             bumpGroupGenerations(const GroupClosure& groups);
+    // 递增所有组（包括从未被修改过的组）的代数，用于全局性的组变化
+    void             bumpAllGroupGenerations();
+    // 快照所依赖的组代数是否仍是最新
+    bool             isStampCurrent(const GroupGenerationStamp& stamp) const;
 
     // 组权限缓存
-    // 查找指定组的权限
-    std::optional<std::vector<CompiledPermissionRule>> findGroupPermissions(const std::string& groupName);
-    // 存储指定组的权限
-    void storeGroupPermissions(const std::string& groupName, const std::vector<CompiledPermissionRule>& permissions);
+    // 查找指定组的权限快照，未命中返回空指针
+    std::shared_ptr<const GroupPermissionSnapshot> findGroupPermissions(const std::string& groupName) const;
+    // 存储（替换）指定组的权限快照
+    void storeGroupPermissions(const std::string& groupName, std::shared_ptr<const GroupPermissionSnapshot> snapshot);
+    // 组权限缓存的版本，每次失效时递增；在从存储层读取组数据之前获取
+    uint64_t getGroupPermissionsVersion() const;
+    // 仅当版本仍为 version（构建期间没有组权限失效）时存储，返回是否已存储
+    bool storeGroupPermissions(
+        const std::string&                             groupName,
+        std::shared_ptr<const GroupPermissionSnapshot> snapshot,
+        uint64_t                                       version
+    );
     // 使指定组的权限缓存失效
     void invalidateGroupPermissions(const std::string& groupName);
+    // 使一批组的权限缓存失效，只加一次写锁
+    void invalidateGroupPermissions(const GroupClosure& groups);
     // 使所有组的权限缓存失效
     void invalidateAllGroupPermissions();
+    // 获取当前缓存的所有组权限快照
+    std::vector<std::pair<std::string, std::shared_ptr<const GroupPermissionSnapshot>>> getAllGroupPermissions() const;
 
     // 默认权限缓存
     // 查找指定权限的默认值
@@ -64,6 +192,12 @@ public:
     void                populateAllPermissionDefaults(std::unordered_map<std::string, bool>&& defaultsMap);
     // 获取所有默认权限的映射关系
     const std::unordered_map<std::string, bool>& getAllPermissionDefaults() const;
+    // 默认权限是否已从存储层加载过
+    bool                                         permissionDefaultsLoaded() const;
+    // 获取当前默认权限版本，每次默认值变化时递增
+    uint64_t                                     getDefaultsVersion() const;
+    // 获取共享的默认权限层，版本落后时按需重建
+    std::shared_ptr<const DefaultPermissionLayer> getDefaultLayer();
 
     // 继承缓存
     // 填充继承关系缓存
@@ -75,32 +209,88 @@ public:
     void                  addInheritance(const std::string& child, const std::string& parent);
     // 移除继承关系
     void                  removeInheritance(const std::string& child, const std::string& parent);
+    // 移除组的全部继承边（组被删除时调用）
+    void                  removeGroupFromGraph(const std::string& groupName);
     // 检查两个组之间是否存在继承路径
     bool                  hasPath(const std::string& startNode, const std::string& endNode) const;
     // 获取指定组的所有祖先组（包括自身）
     std::set<std::string> getAllAncestorGroups(const std::string& groupName) const;
     // 递归获取指定组的所有子组（包括自身）
     std::set<std::string> getChildGroupsRecursive(const std::string& groupName) const;
+    // 获取指定组的祖先闭包（包括自身）的视图，不复制组名，热路径使用
+    GroupClosure          getAncestorClosure(const std::string& groupName) const;
+    // 获取指定组的后代闭包（包括自身）的视图，不复制组名，热路径使用
+    GroupClosure          getDescendantClosure(const std::string& groupName) const;
+    // 获取当前继承关系图，返回的图不可变，可在不加锁的情况下反复查询
+    std::shared_ptr<const GroupGraph> getGroupGraph() const;
+    // 整体替换继承关系图（从快照文件载入时使用，闭包已预先计算）
+    void                              replaceGroupGraph(std::shared_ptr<const GroupGraph> graph);
 
 private:
+    // 单个玩家的决策备忘录，只对 snapshot 所指的快照有效
+    struct DecisionMemo {
+        std::shared_ptr<const PlayerPermissionSnapshot> snapshot;
+        uint64_t                                        defaultsVersion = 0;
+        std::unordered_map<std::string, bool>           decisions;
+        std::shared_ptr<const std::vector<CompiledPermissionRule>> effectiveRules; // 合并默认权限层并排序后的全部规则
+
+        // 绑定到新的快照或默认权限版本，之前的结果全部作废；已绑定时什么也不做
+        void rebind(const std::shared_ptr<const PlayerPermissionSnapshot>& current, uint64_t version);
+    };
+
+    // 决策缓存分片，对齐到缓存行以避免分片之间的伪共享
+    struct alignas(64) DecisionShard {
+        mutable std::shared_mutex                                  mutex;
+        std::unordered_map<PlayerKey, DecisionMemo, PlayerKeyHash> memos; // 玩家到决策备忘录的映射
+    };
+
+    DecisionShard&       decisionShardOf(const PlayerKey& player);
+    const DecisionShard& decisionShardOf(const PlayerKey& player) const;
+    // 快照仍在玩家缓存中时返回玩家的备忘录，否则返回空指针；须持有分片写锁
+    DecisionMemo*        memoOf(
+               DecisionShard&                                         shard,
+               const PlayerKey&                                       player,
+               const std::shared_ptr<const PlayerPermissionSnapshot>& snapshot
+           );
+    // 玩家缓存被淘汰后，清除其决策备忘录
+    void                 dropDecisions(const std::vector<PlayerKey>& players);
+    // 更新反向索引中某个玩家的组，groups 为空指针表示移除
+    void                 indexPlayerGroups(const PlayerKey& player, const PlayerGroupsSnapshot* groups);
+    // 从反向索引中移除一批玩家
+    void                 unindexPlayers(const std::vector<PlayerKey>& players);
+
     // 缓存数据结构
     std::unordered_map<std::string, std::string>                         m_groupNameCache;        // 组名到组ID的映射
     std::unordered_map<std::string, std::string>                         m_groupIdCache;          // 组ID到组名的映射
-    std::unordered_map<std::string, std::vector<CompiledPermissionRule>> m_playerPermissionsCache; // 玩家UUID到编译权限规则的映射
-    std::unordered_map<std::string, std::vector<GroupDetails>>           m_playerGroupsCache;      // 玩家UUID到组详情的映射
-    std::unordered_map<std::string, std::vector<CompiledPermissionRule>> m_groupPermissionsCache;  // 组名到编译权限规则的映射
+    PinnedKeys                                                           m_pinnedPlayers;         // 被固定的玩家（需先于玩家缓存构造）
+    PlayerCacheMap<PlayerPermissionSnapshot>                             m_playerPermissionsCache; // 玩家到权限快照的映射（有界）
+    PlayerCacheMap<PlayerGroupsSnapshot>                                 m_playerGroupsCache;      // 玩家到组详情的映射（有界）
+    std::unordered_map<std::string, std::shared_ptr<const GroupPermissionSnapshot>, StringKeyHash, std::equal_to<>> m_groupPermissionsCache; // 组名到权限快照的映射
+    std::atomic<uint64_t>                                                m_groupPermissionsVersion{0}; // 组权限缓存的失效次数
+    std::vector<std::unique_ptr<DecisionShard>>                          m_decisionShards;         // 按玩家键哈希分片的决策缓存
+    std::atomic<size_t>                                                  m_decisionCapacity{256};  // 每个玩家的决策缓存上限
     std::unordered_map<std::string, bool>                                m_permissionDefaultsCache; // 权限名到默认值的映射
-    std::unordered_map<std::string, std::set<std::string>>               m_parentToChildren;       // 父组到子组的映射
-    std::unordered_map<std::string, std::set<std::string>>               m_childToParents;         // 子组到父组的映射
+    std::shared_ptr<const DefaultPermissionLayer>                        m_defaultLayer;           // 共享的默认权限层
+    std::atomic<uint64_t>                                                m_defaultsVersion{0};     // 默认权限版本，在锁内递增，可不加锁读取
+    bool                                                                 m_defaultsLoaded  = false; // 默认权限是否已加载
+    std::unordered_map<std::string, std::unordered_set<PlayerKey, PlayerKeyHash>, StringKeyHash, std::equal_to<>> m_groupMembers; // 组名到已缓存玩家的反向索引
+    std::unordered_map<PlayerKey, std::vector<std::string>, PlayerKeyHash>        m_indexedPlayerGroups; // 玩家到其被索引的组名
+    std::unordered_map<std::string, uint64_t, StringKeyHash, std::equal_to<>> m_groupGenerations; // 组名到代数的映射（组删除后保留，防止重建同名组时代数回退）
+    uint64_t                                                             m_baseGeneration = 0;     // 不在映射中的组的代数，全局变化时递增
+    std::atomic<uint64_t>                                                m_groupEpoch{0};          // 全局组纪元
+    std::function<void(const PlayerKey&)>                                m_onStaleSnapshot;        // 过期快照回调
+    std::function<void(const PlayerKey*, const std::shared_ptr<const PlayerPermissionSnapshot>&)> m_onSnapshotChanged; // 玩家快照监听器
+    std::shared_ptr<const GroupGraph>                                    m_groupGraph;             // 继承关系图（写时复制）
 
     // 互斥锁，用于保护缓存数据
     mutable std::shared_mutex m_groupNameMutex;        // 组名缓存的互斥锁
     mutable std::shared_mutex m_groupIdMutex;          // 组ID缓存的互斥锁
-    mutable std::shared_mutex m_playerPermissionsMutex; // 玩家权限缓存的互斥锁
-    mutable std::shared_mutex m_playerGroupsMutex;      // 玩家组缓存的互斥锁
     mutable std::shared_mutex m_groupPermissionsMutex;  // 组权限缓存的互斥锁
     mutable std::shared_mutex m_permissionDefaultsMutex; // 默认权限缓存的互斥锁
-    mutable std::shared_mutex m_inheritanceMutex;       // 继承缓存的互斥锁
+    mutable std::shared_mutex m_inheritanceMutex;       // 保护 m_groupGraph 指针的互斥锁
+    std::mutex                m_inheritanceWriteMutex;  // 串行化继承关系图的复制与替换
+    mutable std::shared_mutex m_groupGenerationMutex;   // 组代数的互斥锁
+    mutable std::shared_mutex m_reverseIndexMutex;      // 反向索引的互斥锁
 };
 
 } // namespace internal
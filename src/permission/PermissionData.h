@@ -1,7 +1,8 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
 #include <optional> // 显式包含 optional
-#include <regex>
 #include <set>
 #include <string>
 #include <vector>
@@ -25,12 +26,20 @@
 namespace BA {
 namespace permission {
 
+// 权限节点的稠密整数ID，由 PermissionManager::resolvePermission 分配，在进程生命周期内保持不变
+using PermissionId = uint32_t;
+// 无效的权限ID
+inline constexpr PermissionId INVALID_PERMISSION_ID = UINT32_MAX;
+
 // 异步缓存失效任务类型
 enum class CacheInvalidationTaskType {
     GROUP_MODIFIED,       // 组权限或继承关系改变
     PLAYER_GROUP_CHANGED, // 玩家组关系改变
     ALL_GROUPS_MODIFIED,  // 所有组的权限或默认权限改变
     ALL_PLAYERS_MODIFIED, // 所有玩家的默认权限改变
+    PLAYER_REFRESH,       // 在后台重建玩家快照并替换旧快照（refresh-ahead）
+    PLAYER_BATCH_GROUP_CHANGED, // 一批玩家的组关系改变（写回队列提交后），玩家列表在 players 中
+    PERMISSION_DEFAULT_CHANGED, // 权限的默认值改变（由其他服务器注册），重新载入默认权限
     SHUTDOWN              // 停止工作线程
 };
 
@@ -38,6 +47,7 @@ enum class CacheInvalidationTaskType {
 struct CacheInvalidationTask {
     CacheInvalidationTaskType type;
     std::string               data; // 存储组名或玩家UUID等数据
+    std::vector<std::string>  players = {}; // 批量任务涉及的玩家 UUID
 };
 
 // 结构体用于返回组的详细信息
@@ -74,16 +84,12 @@ struct GroupPermissionInfo {
       directPermissionRules(std::move(rules)) {}
 };
 
-// 编译后的权限规则结构体
+// 编译后的权限规则结构体（匹配由 PermissionMatcher 统一完成）
 struct CompiledPermissionRule {
     std::string pattern;
-    std::regex  regex;
     bool        state;
 
-    CompiledPermissionRule(std::string p, std::regex r, bool s)
-    : pattern(std::move(p)),
-      regex(std::move(r)),
-      state(s) {}
+    CompiledPermissionRule(std::string p, bool s) : pattern(std::move(p)), state(s) {}
 };
 
 // 结构体用于存储权限的定义
@@ -93,6 +99,41 @@ struct PermissionDefinition {
     bool        defaultValue;
 };
 
+// 玩家缓存的占用统计
+struct CacheStats {
+    size_t   playerPermissionEntries = 0; // 玩家权限快照条目数
+    size_t   playerPermissionBytes   = 0; // 玩家权限快照估算占用字节数
+    size_t   playerGroupEntries      = 0; // 玩家组条目数
+    size_t   playerGroupBytes        = 0; // 玩家组估算占用字节数
+    size_t   maxBytesPerCache        = 0; // 每种玩家缓存的字节上限，0 表示不限制
+    size_t   pinnedPlayers           = 0; // 被固定（不会被淘汰）的玩家数
+    size_t   shardCount              = 1; // 玩家缓存分片数
+    uint64_t evictions               = 0; // 累计淘汰的条目数
+    size_t   internedRuleSets        = 0; // 所有快照共享的不同规则集数
+    size_t   internedRuleSetBytes    = 0; // 这些规则集（规则与匹配器）的估算占用字节数
+};
+
+// 批量导出或导入的统计
+struct TransferStats {
+    bool        success     = false; // 是否完整执行（导出写完所有记录；导入提交了所有批次）
+    size_t      permissions = 0;     // 权限定义数
+    size_t      groups      = 0;     // 组数
+    size_t      inheritance = 0;     // 继承关系数
+    size_t      rules       = 0;     // 组权限规则数
+    size_t      memberships = 0;     // 玩家组关系数
+    size_t      skipped     = 0;     // 导入时跳过的记录（无法解析、引用了不存在的组或会形成循环继承）
+    std::string error;               // 失败原因，成功时为空
+};
+
+// API 调用录制的统计
+struct CallRecordingStats {
+    bool        active     = false; // 是否正在录制
+    std::string path;                // 录制文件路径
+    double      sampleRate = 1;      // 检查与查询的抽样率
+    uint64_t    calls      = 0;      // 已录制的调用数
+    uint64_t    skipped    = 0;      // 未被抽中的检查与查询数
+    uint64_t    bytes      = 0;      // 已写入文件的字节数
+};
 
 } // namespace permission
 } // namespace BA
@@ -35,9 +35,20 @@ PermissionManager::~PermissionManager() = default;
  * @return 如果初始化成功则返回 true，否则返回 false。
  */
 bool PermissionManager::init(db::IDatabase* db, bool enableWarmup, unsigned int threadPoolSize) {
-    return m_pimpl->init(db, enableWarmup, threadPoolSize);
+    PermissionOptions options;
+    options.enableWarmup   = enableWarmup;
+    options.threadPoolSize = threadPoolSize;
+    return m_pimpl->init(db, options);
 }
 
+/**
+ * @brief 使用完整的运行参数初始化权限管理器。
+ * @param db 数据库接口指针。
+ * @param options 运行参数。
+ * @return 如果初始化成功则返回 true，否则返回 false。
+ */
+bool PermissionManager::init(db::IDatabase* db, const PermissionOptions& options) { return m_pimpl->init(db, options); }
+
 /**
  * @brief 关闭权限管理器。
  */
@@ -63,6 +74,13 @@ bool PermissionManager::registerPermission(const std::string& name, const std::s
  */
 bool PermissionManager::permissionExists(const std::string& name) { return m_pimpl->permissionExists(name); }
 
+/**
+ * @brief 获取权限节点的整数ID。
+ * @param name 权限节点名。
+ * @return 权限ID。
+ */
+PermissionId PermissionManager::resolvePermission(const std::string& name) { return m_pimpl->resolvePermission(name); }
+
 /**
  * @brief 获取所有已注册的权限。
  * @return 包含所有权限名称的字符串向量。
@@ -165,6 +183,16 @@ std::vector<CompiledPermissionRule> PermissionManager::getPermissionsOfGroup(con
     return m_pimpl->getPermissionsOfGroup(groupName);
 }
 
+/**
+ * @brief 获取权限组的不可变权限快照（包括继承的）。
+ * @param groupName 组名称。
+ * @return 权限快照指针。
+ */
+std::shared_ptr<const GroupPermissionSnapshot> PermissionManager::getGroupPermissionSnapshot(const std::string& groupName
+) {
+    return m_pimpl->getGroupPermissionSnapshot(groupName);
+}
+
 /**
  * @brief 向权限组批量添加权限规则。
  * @param groupName 组名称。
@@ -263,6 +291,38 @@ bool PermissionManager::addPlayerToGroup(
     return m_pimpl->addPlayerToGroup(playerUuid, groupName, durationSeconds);
 }
 
+/**
+ * @brief 将玩家添加到权限组（写回队列）。
+ * @param playerUuid 玩家的 UUID。
+ * @param groupName 组名称。
+ * @param durationSeconds 有效时长（秒），0 或负数表示永不过期。
+ * @return 修改写入数据库后就绪的 future。
+ */
+std::future<bool> PermissionManager::addPlayerToGroupBuffered(
+    const std::string& playerUuid,
+    const std::string& groupName,
+    long long          durationSeconds
+) {
+    return m_pimpl->addPlayerToGroupBuffered(playerUuid, groupName, durationSeconds);
+}
+
+/**
+ * @brief 将玩家从权限组中移除（写回队列）。
+ * @param playerUuid 玩家的 UUID。
+ * @param groupName 组名称。
+ * @return 修改写入数据库后就绪的 future。
+ */
+std::future<bool>
+PermissionManager::removePlayerFromGroupBuffered(const std::string& playerUuid, const std::string& groupName) {
+    return m_pimpl->removePlayerFromGroupBuffered(playerUuid, groupName);
+}
+
+/**
+ * @brief 立即提交写回队列中的所有修改。
+ * @return 全部提交成功时返回 true。
+ */
+bool PermissionManager::flush() { return m_pimpl->flushPendingWrites(); }
+
 /**
  * @brief 将玩家从权限组中移除。
  * @param playerUuid 玩家的 UUID。
@@ -299,6 +359,10 @@ std::vector<std::string> PermissionManager::getPlayerGroupIds(const std::string&
 std::vector<std::string> PermissionManager::getPlayersInGroup(const std::string& groupName) {
     return m_pimpl->getPlayersInGroup(groupName);
 }
+std::vector<std::string>
+PermissionManager::getPlayersInGroup(const std::string& groupName, size_t offset, size_t limit) {
+    return m_pimpl->getPlayersInGroup(groupName, offset, limit);
+}
 /**
  * @brief 获取玩家在某个权限组中的身份过期时间。
  * @param playerUuid 玩家的 UUID。
@@ -363,6 +427,16 @@ std::vector<CompiledPermissionRule> PermissionManager::getAllPermissionsForPlaye
     return m_pimpl->getAllPermissionsForPlayer(playerUuid);
 }
 
+/**
+ * @brief 获取玩家的不可变权限快照。
+ * @param playerUuid 玩家的 UUID。
+ * @return 权限快照指针。
+ */
+std::shared_ptr<const PlayerPermissionSnapshot>
+PermissionManager::getPlayerPermissionSnapshot(const std::string& playerUuid) {
+    return m_pimpl->getPlayerPermissionSnapshot(playerUuid);
+}
+
 /**
  * @brief 检查玩家是否拥有某个权限。
  * @param playerUuid 玩家的 UUID。
@@ -372,7 +446,217 @@ std::vector<CompiledPermissionRule> PermissionManager::getAllPermissionsForPlaye
 bool PermissionManager::hasPermission(const std::string& playerUuid, const std::string& permissionNode) {
     return m_pimpl->hasPermission(playerUuid, permissionNode);
 }
+
+bool PermissionManager::hasPermission(const std::string& playerUuid, PermissionId permission) {
+    return m_pimpl->hasPermission(playerUuid, permission);
+}
+
+std::vector<bool>
+PermissionManager::hasPermissions(const std::string& playerUuid, std::span<const std::string> permissionNodes) {
+    return m_pimpl->hasPermissions(playerUuid, permissionNodes);
+}
+
+std::vector<std::string> PermissionManager::filterPlayersWithPermission(
+    std::span<const std::string> playerUuids,
+    const std::string&           permissionNode
+) {
+    return m_pimpl->filterPlayersWithPermission(playerUuids, permissionNode);
+}
+std::vector<std::string> PermissionManager::getOnlinePlayersWithPermission(const std::string& permissionNode) {
+    return m_pimpl->getOnlinePlayersWithPermission(permissionNode);
+}
 void PermissionManager::runPeriodicCleanup() { m_pimpl->runPeriodicCleanup(); }
 
+// --- 到期队列 ---
+size_t                   PermissionManager::processDueExpirations() { return m_pimpl->processDueExpirations(); }
+std::optional<long long> PermissionManager::getNextExpiration() { return m_pimpl->getNextExpiration(); }
+void PermissionManager::setExpirationWakeHandler(std::function<void()> handler) {
+    m_pimpl->setExpirationWakeHandler(std::move(handler));
+}
+
+// --- 缓存容量 ---
+void       PermissionManager::pinPlayer(const std::string& playerUuid) { m_pimpl->pinPlayer(playerUuid); }
+void       PermissionManager::unpinPlayer(const std::string& playerUuid) { m_pimpl->unpinPlayer(playerUuid); }
+void       PermissionManager::prefetchPlayer(const std::string& playerUuid) { m_pimpl->prefetchPlayer(playerUuid); }
+CacheStats PermissionManager::getCacheStats() { return m_pimpl->getCacheStats(); }
+
+// --- 运行时指标 ---
+std::string              PermissionManager::getMetricsText() { return m_pimpl->getMetricsText(); }
+std::vector<std::string> PermissionManager::getStatsSummary() { return m_pimpl->getStatsSummary(); }
+std::vector<std::string> PermissionManager::explainHotQueries() { return m_pimpl->explainHotQueries(); }
+std::vector<std::string> PermissionManager::dumpTrace(size_t maxRecords) { return m_pimpl->dumpTrace(maxRecords); }
+
+// --- 调用录制 ---
+bool PermissionManager::startCallRecording(const std::string& path, double sampleRate, uint64_t maxBytes) {
+    return m_pimpl->startCallRecording(path, sampleRate, maxBytes);
+}
+CallRecordingStats PermissionManager::stopCallRecording() { return m_pimpl->stopCallRecording(); }
+CallRecordingStats PermissionManager::getCallRecordingStats() { return m_pimpl->getCallRecordingStats(); }
+
+// --- 数据导入导出 ---
+TransferStats PermissionManager::exportData(const std::function<bool(std::string_view)>& sink) {
+    return m_pimpl->exportData(sink);
+}
+TransferStats PermissionManager::importData(const std::function<size_t(char*, size_t)>& read) {
+    return m_pimpl->importData(read);
+}
+
+// --- 异步接口 ---
+// 参数按值捕获，调用返回后调用者的字符串可以立即释放
+
+void PermissionManager::setCompletionExecutor(std::function<void(std::function<void()>)> executor) {
+    m_pimpl->setCompletionExecutor(std::move(executor));
+}
+
+void PermissionManager::runAsync(std::function<void()> task) { m_pimpl->runAsync(std::move(task)); }
+
+std::future<bool> PermissionManager::hasPermissionAsync(const std::string& playerUuid, const std::string& permissionNode) {
+    return m_pimpl->submitAsync<bool>([impl = m_pimpl.get(), playerUuid, permissionNode] {
+        return impl->hasPermission(playerUuid, permissionNode);
+    });
+}
+
+void PermissionManager::hasPermissionAsync(
+    const std::string&        playerUuid,
+    const std::string&        permissionNode,
+    std::function<void(bool)> callback
+) {
+    m_pimpl->submitAsync<bool>(
+        [impl = m_pimpl.get(), playerUuid, permissionNode] { return impl->hasPermission(playerUuid, permissionNode); },
+        std::move(callback)
+    );
+}
+
+std::future<std::vector<std::string>> PermissionManager::getPlayerGroupsAsync(const std::string& playerUuid) {
+    return m_pimpl->submitAsync<std::vector<std::string>>([impl = m_pimpl.get(), playerUuid] {
+        return impl->getPlayerGroups(playerUuid);
+    });
+}
+
+void PermissionManager::getPlayerGroupsAsync(
+    const std::string&                             playerUuid,
+    std::function<void(std::vector<std::string>)> callback
+) {
+    m_pimpl->submitAsync<std::vector<std::string>>(
+        [impl = m_pimpl.get(), playerUuid] { return impl->getPlayerGroups(playerUuid); },
+        std::move(callback)
+    );
+}
+
+std::future<std::vector<std::string>> PermissionManager::getPlayersInGroupAsync(const std::string& groupName) {
+    return m_pimpl->submitAsync<std::vector<std::string>>([impl = m_pimpl.get(), groupName] {
+        return impl->getPlayersInGroup(groupName);
+    });
+}
+
+void PermissionManager::getPlayersInGroupAsync(
+    const std::string&                             groupName,
+    std::function<void(std::vector<std::string>)> callback
+) {
+    m_pimpl->submitAsync<std::vector<std::string>>(
+        [impl = m_pimpl.get(), groupName] { return impl->getPlayersInGroup(groupName); },
+        std::move(callback)
+    );
+}
+
+std::future<std::vector<CompiledPermissionRule>>
+PermissionManager::getAllPermissionsForPlayerAsync(const std::string& playerUuid) {
+    return m_pimpl->submitAsync<std::vector<CompiledPermissionRule>>([impl = m_pimpl.get(), playerUuid] {
+        return impl->getAllPermissionsForPlayer(playerUuid);
+    });
+}
+
+void PermissionManager::getAllPermissionsForPlayerAsync(
+    const std::string&                                       playerUuid,
+    std::function<void(std::vector<CompiledPermissionRule>)> callback
+) {
+    m_pimpl->submitAsync<std::vector<CompiledPermissionRule>>(
+        [impl = m_pimpl.get(), playerUuid] { return impl->getAllPermissionsForPlayer(playerUuid); },
+        std::move(callback)
+    );
+}
+
+std::future<bool> PermissionManager::addPlayerToGroupAsync(
+    const std::string& playerUuid,
+    const std::string& groupName,
+    long long          durationSeconds
+) {
+    return m_pimpl->submitAsync<bool>([impl = m_pimpl.get(), playerUuid, groupName, durationSeconds] {
+        return impl->addPlayerToGroup(playerUuid, groupName, durationSeconds);
+    });
+}
+
+void PermissionManager::addPlayerToGroupAsync(
+    const std::string&        playerUuid,
+    const std::string&        groupName,
+    long long                 durationSeconds,
+    std::function<void(bool)> callback
+) {
+    m_pimpl->submitAsync<bool>(
+        [impl = m_pimpl.get(), playerUuid, groupName, durationSeconds] {
+            return impl->addPlayerToGroup(playerUuid, groupName, durationSeconds);
+        },
+        std::move(callback)
+    );
+}
+
+std::future<bool>
+PermissionManager::removePlayerFromGroupAsync(const std::string& playerUuid, const std::string& groupName) {
+    return m_pimpl->submitAsync<bool>([impl = m_pimpl.get(), playerUuid, groupName] {
+        return impl->removePlayerFromGroup(playerUuid, groupName);
+    });
+}
+
+void PermissionManager::removePlayerFromGroupAsync(
+    const std::string&        playerUuid,
+    const std::string&        groupName,
+    std::function<void(bool)> callback
+) {
+    m_pimpl->submitAsync<bool>(
+        [impl = m_pimpl.get(), playerUuid, groupName] { return impl->removePlayerFromGroup(playerUuid, groupName); },
+        std::move(callback)
+    );
+}
+
+std::future<bool>
+PermissionManager::addPermissionToGroupAsync(const std::string& groupName, const std::string& permissionName) {
+    return m_pimpl->submitAsync<bool>([impl = m_pimpl.get(), groupName, permissionName] {
+        return impl->addPermissionToGroup(groupName, permissionName);
+    });
+}
+
+void PermissionManager::addPermissionToGroupAsync(
+    const std::string&        groupName,
+    const std::string&        permissionName,
+    std::function<void(bool)> callback
+) {
+    m_pimpl->submitAsync<bool>(
+        [impl = m_pimpl.get(), groupName, permissionName] {
+            return impl->addPermissionToGroup(groupName, permissionName);
+        },
+        std::move(callback)
+    );
+}
+
+std::future<bool>
+PermissionManager::removePermissionFromGroupAsync(const std::string& groupName, const std::string& permissionName) {
+    return m_pimpl->submitAsync<bool>([impl = m_pimpl.get(), groupName, permissionName] {
+        return impl->removePermissionFromGroup(groupName, permissionName);
+    });
+}
+
+void PermissionManager::removePermissionFromGroupAsync(
+    const std::string&        groupName,
+    const std::string&        permissionName,
+    std::function<void(bool)> callback
+) {
+    m_pimpl->submitAsync<bool>(
+        [impl = m_pimpl.get(), groupName, permissionName] {
+            return impl->removePermissionFromGroup(groupName, permissionName);
+        },
+        std::move(callback)
+    );
+}
+
 } // namespace permission
 } // namespace BA
@@ -1,7 +1,13 @@
 #pragma once
 
-#include "PermissionData.h" // 包含公共数据结构
-#include <memory>                      // 包含智能指针
+#include "PermissionData.h"     // 包含公共数据结构
+#include "PermissionOptions.h"  // 包含运行参数
+#include "PermissionSnapshot.h" // 包含不可变权限快照
+#include <functional>           // 包含 std::function
+#include <future>               // 包含 std::future
+#include <memory>               // 包含智能指针
+#include <span>                 // 包含 std::span
+#include <string_view>          // 包含 std::string_view
 
 namespace BA {
 namespace db {
@@ -32,6 +38,13 @@ public:
      * @return 如果初始化成功则返回 true，否则返回 false。
      */
     BA_API bool init(db::IDatabase* db, bool enableWarmup = true, unsigned int threadPoolSize = 4);
+    /**
+     * @brief 使用完整的运行参数初始化权限管理器。
+     * @param db 数据库接口指针。
+     * @param options 运行参数。
+     * @return 如果初始化成功则返回 true，否则返回 false。
+     */
+    BA_API bool init(db::IDatabase* db, const PermissionOptions& options);
     /**
      * @brief 关闭权限管理器，释放资源。
      */
@@ -53,6 +66,14 @@ public:
      * @return 如果权限存在则返回 true，否则返回 false。
      */
     BA_API bool permissionExists(const std::string& name);
+    /**
+     * @brief 获取权限节点的整数ID，用于 hasPermission(playerUuid, PermissionId)。
+     *        ID 按首次解析的顺序稠密分配，在进程生命周期内保持不变；registerPermission 会自动为节点分配ID。
+     *        适合插件启动时解析一组固定节点并保存其ID，动态拼接的节点继续使用字符串接口。
+     * @param name 权限节点名（不含通配符的具体节点）。
+     * @return 权限ID。
+     */
+    BA_API PermissionId resolvePermission(const std::string& name);
     /**
      * @brief 获取所有已注册的权限。
      * @return 包含所有权限名称的字符串向量。
@@ -132,14 +153,21 @@ public:
      */
     BA_API std::vector<CompiledPermissionRule> getPermissionsOfGroup(const std::string& groupName);
     /**
-     * @brief 向权限组批量添加权限规则。
+     * @brief 获取权限组的不可变权限快照（包括继承的），不复制规则。
+     * @param groupName 组名称。
+     * @return 权限快照指针，永不为空；组被修改后缓存会换成新快照，旧指针仍然有效。
+     */
+    BA_API std::shared_ptr<const GroupPermissionSnapshot> getGroupPermissionSnapshot(const std::string& groupName);
+    /**
+     * @brief 向权限组批量添加权限规则，所有规则在一个事务中写入。
+     *        整批触发一次 GroupPermissionBatchChangeBefore/AfterEvent；逐条的 GroupPermissionChange 事件只在有监听器时触发。
      * @param groupName 组名称。
      * @param permissionRules 权限规则字符串向量。
      * @return 成功添加的权限规则数量。
      */
     BA_API size_t addPermissionsToGroup(const std::string& groupName, const std::vector<std::string>& permissionRules);
     /**
-     * @brief 从权限组批量移除权限规则。
+     * @brief 从权限组批量移除权限规则，事件与 addPermissionsToGroup 相同。
      * @param groupName 组名称。
      * @param permissionRules 权限规则字符串向量。
      * @return 成功移除的权限规则数量。
@@ -210,6 +238,32 @@ public:
      * @return 如果移除成功则返回 true，否则返回 false。
      */
     BA_API bool removePlayerFromGroup(const std::string& playerUuid, const std::string& groupName);
+    /**
+     * @brief 将玩家添加到权限组，启用写回队列时先入队、与其他修改一起批量提交。
+     *        PlayerJoinGroupBeforeEvent 在调用线程触发，AfterEvent 在提交成功后由提交线程触发；
+     *        未启用写回队列时等同于 addPlayerToGroup，返回的 future 已就绪。
+     * @param playerUuid 玩家的 UUID。
+     * @param groupName 组名称。
+     * @param durationSeconds 有效时长（秒），0 或负数表示永不过期。
+     * @return 修改写入数据库（或失败、被取消）后就绪的 future。
+     */
+    BA_API std::future<bool> addPlayerToGroupBuffered(
+        const std::string& playerUuid,
+        const std::string& groupName,
+        long long          durationSeconds = 0
+    );
+    /**
+     * @brief 将玩家从权限组中移除，启用写回队列时先入队、与其他修改一起批量提交。
+     * @param playerUuid 玩家的 UUID。
+     * @param groupName 组名称。
+     * @return 修改写入数据库（或失败、被取消）后就绪的 future。
+     */
+    BA_API std::future<bool> removePlayerFromGroupBuffered(const std::string& playerUuid, const std::string& groupName);
+    /**
+     * @brief 立即提交写回队列中的所有修改并等待完成。
+     * @return 全部提交成功（或队列为空、未启用）时返回 true。
+     */
+    BA_API bool flush();
     /**
      * @brief 获取玩家所属的所有权限组。
      * @param playerUuid 玩家的 UUID。
@@ -228,6 +282,14 @@ public:
      * @return 包含组中所有玩家 UUID 的字符串向量。
      */
     BA_API std::vector<std::string> getPlayersInGroup(const std::string& groupName);
+    /**
+     * @brief 按玩家 UUID 排序分页获取指定权限组中的玩家，只查询本页的行。
+     * @param groupName 组名称。
+     * @param offset 跳过的玩家数。
+     * @param limit 最多返回的玩家数。
+     * @return 本页的玩家 UUID，少于 limit 个时表示已到末尾。
+     */
+    BA_API std::vector<std::string> getPlayersInGroup(const std::string& groupName, size_t offset, size_t limit);
     /**
      * @brief 获取玩家所属的所有权限组及其优先级。
      * @param playerUuid 玩家的 UUID。
@@ -235,14 +297,15 @@ public:
      */
     BA_API std::vector<GroupDetails> getPlayerGroupsWithPriorities(const std::string& playerUuid);
     /**
-     * @brief 将玩家批量添加到权限组。
+     * @brief 将玩家批量添加到权限组，所有关系在一个事务中写入。
+     *        整批触发一次 PlayerGroupBatchChangeBefore/AfterEvent；逐条的 PlayerJoinGroup 事件只在有监听器时触发。
      * @param playerUuid 玩家的 UUID。
      * @param groupNames 组名称字符串向量。
      * @return 成功添加的组数量。
      */
     BA_API size_t addPlayerToGroups(const std::string& playerUuid, const std::vector<std::string>& groupNames);
     /**
-     * @brief 将玩家从权限组中批量移除。
+     * @brief 将玩家从权限组中批量移除，事件与 addPlayerToGroups 相同（逐条事件为 PlayerLeaveGroup）。
      * @param playerUuid 玩家的 UUID。
      * @param groupNames 组名称字符串向量。
      * @return 成功移除的组数量。
@@ -256,6 +319,13 @@ public:
      * @return 包含编译后权限规则的向量。
      */
     BA_API std::vector<CompiledPermissionRule> getAllPermissionsForPlayer(const std::string& playerUuid);
+    /**
+     * @brief 获取玩家的不可变权限快照，不复制规则，适合需要多次匹配的场景。
+     *        快照只包含组规则，不含默认权限，最终结果请使用 hasPermission。
+     * @param playerUuid 玩家的 UUID。
+     * @return 权限快照指针，永不为空；缓存重建时会整体替换，已持有的旧指针仍然有效。
+     */
+    BA_API std::shared_ptr<const PlayerPermissionSnapshot> getPlayerPermissionSnapshot(const std::string& playerUuid);
     /**
      * @brief 检查玩家是否拥有某个权限。
      * @param playerUuid 玩家的 UUID。
@@ -285,8 +355,260 @@ public:
     );
 
     BA_API bool hasPermission(const std::string& playerUuid, const std::string& permissionNode);
+    /**
+     * @brief 按权限ID检查玩家是否拥有某个权限。
+     *        首次调用时对所有已分配ID的节点计算一次结果并按位保存在玩家快照中，之后直到玩家快照或默认权限变化前都只是一次位测试。
+     *        与字符串版本不同，计算时不回退到存储层：没有匹配规则、默认值也不在缓存中的节点直接视为没有权限。
+     * @param playerUuid 玩家的 UUID。
+     * @param permission resolvePermission 返回的权限ID。
+     * @return 如果玩家拥有该权限则返回 true；ID 无效时返回 false。
+     */
+    BA_API bool hasPermission(const std::string& playerUuid, PermissionId permission);
+    /**
+     * @brief 一次检查玩家的多个权限节点，例如打开菜单时决定显示哪些按钮。
+     *        玩家快照与默认权限层只获取一次，决策缓存也只加锁一次，比逐个调用 hasPermission 开销小。
+     * @param playerUuid 玩家的 UUID。
+     * @param permissionNodes 要检查的权限节点。
+     * @return 与 permissionNodes 一一对应的结果。
+     */
+    BA_API std::vector<bool>
+    hasPermissions(const std::string& playerUuid, std::span<const std::string> permissionNodes);
+    /**
+     * @brief 从一组玩家中筛选出拥有某个权限节点的玩家，例如向所有在线玩家广播前过滤接收者。
+     *        默认权限层只获取一次，每个玩家的快照只获取一次。
+     * @param playerUuids 候选玩家的 UUID。
+     * @param permissionNode 要检查的权限节点。
+     * @return 拥有该权限的玩家 UUID，保持输入顺序。
+     */
+    BA_API std::vector<std::string>
+    filterPlayersWithPermission(std::span<const std::string> playerUuids, const std::string& permissionNode);
+    /**
+     * @brief 获取拥有某个权限节点的在线玩家（通过 pinPlayer / prefetchPlayer 固定的玩家），
+     *        例如管理员频道、反作弊警报与 VIP 广播。结果由按节点维护的索引直接给出，
+     *        节点第一次被查询后不再逐个玩家匹配；玩家快照重建或失效、默认权限变化时索引随之更新。
+     * @param permissionNode 要检查的权限节点。
+     * @return 拥有该权限的在线玩家 UUID，顺序不固定。
+     */
+    BA_API std::vector<std::string> getOnlinePlayersWithPermission(const std::string& permissionNode);
     BA_API void runPeriodicCleanup(); // 新增：一个公共方法来触发清理任务
-    
+
+    // --- 到期队列 ---
+    /**
+     * @brief 删除已到期的玩家组关系。只按键删除到期队列中已到时间的记录，不扫描整张表。
+     * @return 处理的 (玩家, 组) 数量。
+     */
+    BA_API size_t                   processDueExpirations();
+    /**
+     * @brief 获取最早的玩家组关系过期时间。
+     * @return Unix 时间戳（秒）；没有带过期时间的玩家组关系时返回 std::nullopt。
+     */
+    BA_API std::optional<long long> getNextExpiration();
+    /**
+     * @brief 设置最早的过期时间提前时（例如新加入了一个更早到期的临时组）调用的回调。
+     *        回调可能在任意线程中调用，不应阻塞。
+     * @param handler 回调，传入空函数表示清除。
+     */
+    BA_API void                     setExpirationWakeHandler(std::function<void()> handler);
+
+    // --- 缓存容量 ---
+    /**
+     * @brief 固定玩家的缓存，使其不会因超出容量而被淘汰，通常在玩家上线时调用。
+     * @param playerUuid 玩家的 UUID。
+     */
+    BA_API void       pinPlayer(const std::string& playerUuid);
+    /**
+     * @brief 取消固定玩家的缓存，通常在玩家下线时调用。
+     * @param playerUuid 玩家的 UUID。
+     */
+    BA_API void       unpinPlayer(const std::string& playerUuid);
+    /**
+     * @brief 固定玩家的缓存，并在 I/O 线程中预先载入其组与权限快照，通常在玩家上线时调用。
+     *        玩家之后的第一次权限检查直接命中缓存，不必在调用线程中查询数据库。
+     * @param playerUuid 玩家的 UUID。
+     */
+    BA_API void       prefetchPlayer(const std::string& playerUuid);
+    /**
+     * @brief 获取玩家缓存的条目数、估算占用字节数与淘汰次数。
+     * @return 缓存统计。
+     */
+    BA_API CacheStats getCacheStats();
+
+    // --- 运行时指标 ---
+    /**
+     * @brief 以 Prometheus 文本格式导出运行时指标：检查与快照的命中率、构建与数据库语句耗时直方图、
+     *        失效队列深度与合并次数、清理耗时以及玩家缓存占用。
+     * @return 可直接作为 /metrics 响应体的文本。
+     */
+    BA_API std::string              getMetricsText();
+    /**
+     * @brief 获取运行时指标的可读摘要，供 /ba stats 显示。
+     * @return 摘要，每个元素为一行。
+     */
+    BA_API std::vector<std::string> getStatsSummary();
+    /**
+     * @brief 对热点存储语句执行 EXPLAIN，供 /ba explain 显示，用于在大表上确认它们使用覆盖索引。
+     *        会访问数据库，应在 I/O 线程中调用。
+     * @return 架构版本与每条语句的查询计划，每个元素为一行。
+     */
+    BA_API std::vector<std::string> explainHotQueries();
+    /**
+     * @brief 导出追踪缓冲区中最近的记录：失效任务的入队、合并与处理，玩家快照构建，数据库语句，
+     *        写回提交与到期处理，各自带耗时与受影响的数量。每个线程保留最近的 4096 条。
+     *        会查询组名与权限名用于显示，应在 I/O 线程中调用。
+     * @param maxRecords 最多导出的记录数（最新的），0 表示全部。
+     * @return 按时间排序的记录，每个元素为一行；未开启追踪（PermissionOptions::tracing）时只有开启前的记录。
+     */
+    BA_API std::vector<std::string> dumpTrace(size_t maxRecords = 0);
+
+    // --- 调用录制 ---
+    /**
+     * @brief 开始把 API 调用连同时间戳录制到紧凑的二进制文件，供 ba-replay 在测试环境中按原速或加速回放。
+     *        录制的调用：检查（hasPermission、hasPermissions）、查询（getAllPermissionsForPlayer、getPlayerGroups、
+     *        getPlayersInGroup、getOnlinePlayersWithPermission）、修改（玩家组关系、组规则、继承、优先级、创建与删除组）
+     *        与上下线（pinPlayer、prefetchPlayer、unpinPlayer），包括 *Async 与 *Buffered 版本。
+     *        检查与查询按玩家抽样，修改与上下线总是录制。记录由后台线程写入文件，未录制时每次调用只多一次原子读取。
+     * @param path 录制文件路径，已存在时覆盖；已在录制时先停止之前的录制。
+     * @param sampleRate 检查与查询的抽样率（0~1]。
+     * @param maxBytes 文件大小上限，达到后自动停止录制；0 表示不限制。
+     * @return 无法创建文件时返回 false。
+     */
+    BA_API bool startCallRecording(const std::string& path, double sampleRate = 1.0, uint64_t maxBytes = 0);
+    /**
+     * @brief 停止录制，把剩余的记录写入文件后返回。shutdown 时会自动停止。
+     * @return 本次录制的统计。
+     */
+    BA_API CallRecordingStats stopCallRecording();
+    /**
+     * @brief 获取当前或上一次录制的统计。
+     * @return 录制统计。
+     */
+    BA_API CallRecordingStats getCallRecordingStats();
+
+    // --- 数据导入导出 ---
+    /**
+     * @brief 把权限定义、组、继承、组规则与未过期的玩家组关系流式导出为 NDJSON（每行一条记录，组以名称引用）。
+     *        输出按约 64KB 分块交给 sink，整个数据集不会同时放在内存中。各表分别读取，不是同一时刻的快照。
+     *        会阻塞调用线程，应在 I/O 线程中调用（例如通过 runAsync）。
+     * @param sink 接收一块输出，返回 false 时停止导出。
+     * @return 各类记录的数量；sink 中途失败或读取出错时 success 为 false。
+     */
+    BA_API TransferStats exportData(const std::function<bool(std::string_view)>& sink);
+    /**
+     * @brief 导入 exportData 生成的 NDJSON。输入按块增量解析，每约 5000 条记录在一个事务中写入；
+     *        已存在的权限与组被更新，规则、继承与玩家组关系被合并，引用不存在的组或会形成循环继承的记录被跳过。
+     *        不触发逐条的 Before/After 事件，全部写入后统一刷新缓存。会阻塞调用线程，应在 I/O 线程中调用。
+     * @param read 向缓冲区读入最多 size 字节并返回读入的字节数，返回 0 表示输入结束。
+     * @return 导入统计；某一批写入失败时 success 为 false，此前提交的批次保留。
+     */
+    BA_API TransferStats importData(const std::function<size_t(char*, size_t)>& read);
+
+    // --- 异步接口 ---
+    // 以下调用在独立的 I/O 线程池中执行，不阻塞调用线程（例如游戏线程）。
+    // 返回 future 的版本在 I/O 线程中兑现；带 callback 的版本通过 setCompletionExecutor 设置的投递函数执行回调，
+    // 插件自身会将其设置为投递到游戏线程。修改类调用的 Before/After 事件在 I/O 线程中触发。
+    /**
+     * @brief 设置异步回调的投递函数。
+     * @param executor 接收一个回调并安排其在目标线程中执行的函数；为空时回调直接在 I/O 线程中执行。
+     */
+    BA_API void setCompletionExecutor(std::function<void(std::function<void()>)> executor);
+    /**
+     * @brief 在 I/O 线程池中执行一段调用，可在其中组合多个同步接口。
+     *        不经过 setCompletionExecutor 投递，适合自行回复结果的调用者（例如 HTTP 服务器）；
+     *        管理器未初始化时直接在调用线程中执行。
+     * @param task 要执行的调用，不应抛出异常。
+     */
+    BA_API void runAsync(std::function<void()> task);
+    /**
+     * @brief 异步检查玩家是否拥有某个权限。
+     * @param playerUuid 玩家的 UUID。
+     * @param permissionNode 权限节点。
+     * @return 结果的 future。
+     */
+    BA_API std::future<bool> hasPermissionAsync(const std::string& playerUuid, const std::string& permissionNode);
+    BA_API void              hasPermissionAsync(
+                     const std::string&        playerUuid,
+                     const std::string&        permissionNode,
+                     std::function<void(bool)> callback
+                 );
+    /**
+     * @brief 异步获取玩家所属的所有权限组。
+     * @param playerUuid 玩家的 UUID。
+     * @return 组名称列表的 future。
+     */
+    BA_API std::future<std::vector<std::string>> getPlayerGroupsAsync(const std::string& playerUuid);
+    BA_API void
+    getPlayerGroupsAsync(const std::string& playerUuid, std::function<void(std::vector<std::string>)> callback);
+    /**
+     * @brief 异步获取指定权限组中的所有玩家 UUID。
+     * @param groupName 组名称。
+     * @return 玩家 UUID 列表的 future。
+     */
+    BA_API std::future<std::vector<std::string>> getPlayersInGroupAsync(const std::string& groupName);
+    BA_API void
+    getPlayersInGroupAsync(const std::string& groupName, std::function<void(std::vector<std::string>)> callback);
+    /**
+     * @brief 异步获取玩家的所有编译后的权限规则。
+     * @param playerUuid 玩家的 UUID。
+     * @return 权限规则列表的 future。
+     */
+    BA_API std::future<std::vector<CompiledPermissionRule>> getAllPermissionsForPlayerAsync(const std::string& playerUuid);
+    BA_API void                                             getAllPermissionsForPlayerAsync(
+                                                    const std::string&                                     playerUuid,
+                                                    std::function<void(std::vector<CompiledPermissionRule>)> callback
+                                                );
+    /**
+     * @brief 异步将玩家添加到权限组。
+     * @param playerUuid 玩家的 UUID。
+     * @param groupName 组名称。
+     * @param durationSeconds 有效时长（秒），0 或负数表示永不过期。
+     * @return 是否成功的 future。
+     */
+    BA_API std::future<bool>
+    addPlayerToGroupAsync(const std::string& playerUuid, const std::string& groupName, long long durationSeconds = 0);
+    BA_API void addPlayerToGroupAsync(
+        const std::string&        playerUuid,
+        const std::string&        groupName,
+        long long                 durationSeconds,
+        std::function<void(bool)> callback
+    );
+    /**
+     * @brief 异步将玩家从权限组中移除。
+     * @param playerUuid 玩家的 UUID。
+     * @param groupName 组名称。
+     * @return 是否成功的 future。
+     */
+    BA_API std::future<bool> removePlayerFromGroupAsync(const std::string& playerUuid, const std::string& groupName);
+    BA_API void              removePlayerFromGroupAsync(
+                     const std::string&        playerUuid,
+                     const std::string&        groupName,
+                     std::function<void(bool)> callback
+                 );
+    /**
+     * @brief 异步向权限组添加一个权限。
+     * @param groupName 组名称。
+     * @param permissionName 权限名称。
+     * @return 是否成功的 future。
+     */
+    BA_API std::future<bool> addPermissionToGroupAsync(const std::string& groupName, const std::string& permissionName);
+    BA_API void              addPermissionToGroupAsync(
+                     const std::string&        groupName,
+                     const std::string&        permissionName,
+                     std::function<void(bool)> callback
+                 );
+    /**
+     * @brief 异步从权限组中移除一个权限。
+     * @param groupName 组名称。
+     * @param permissionName 权限名称。
+     * @return 是否成功的 future。
+     */
+    BA_API std::future<bool>
+    removePermissionFromGroupAsync(const std::string& groupName, const std::string& permissionName);
+    BA_API void removePermissionFromGroupAsync(
+        const std::string&        groupName,
+        const std::string&        permissionName,
+        std::function<void(bool)> callback
+    );
+
 
 private:
     // PIMPL: 前向声明实现类
@@ -3,13 +3,32 @@
 #include "ll/api/io/Logger.h"                 // 包含日志库
 #include "ll/api/mod/NativeMod.h"             // 包含原生模块接口
 #include "permission/AsyncCacheInvalidator.h" // 包含异步缓存失效器
+#include "permission/CacheSnapshotFile.h"      // 包含缓存快照文件
+#include "permission/ClusterInvalidator.h"     // 包含跨服务器缓存失效
+#include "permission/DataTransfer.h"          // 包含数据集导入导出
+#include "permission/ExpiryQueue.h"            // 包含玩家组关系到期队列
+#include "permission/IoExecutor.h"            // 包含异步接口的 I/O 线程池
+#include "permission/Metrics.h"               // 包含运行时指标
+#include "permission/OnlinePermissionIndex.h"  // 包含在线玩家权限索引
+#include "permission/CallRecorder.h"           // 包含 API 调用录制器
 #include "permission/PermissionCache.h"       // 包含权限缓存
+#include "permission/PermissionRegistry.h"    // 包含权限ID注册表
+#include "permission/PermissionSnapshot.h"    // 包含不可变权限快照
 #include "permission/PermissionStorage.h"     // 包含权限存储
+#include "permission/Trace.h"                 // 包含追踪缓冲区
+#include "permission/WriteBehindQueue.h"      // 包含玩家组关系写回队列
 #include "permission/events/PlayerJoinGroupEvent.h" // 包含玩家加入组事件
 #include "permission/events/PlayerLeaveGroupEvent.h" // 包含玩家离开组事件
 #include "permission/events/GroupPermissionChangeEvent.h" // 包含组权限变更事件
+#include "permission/events/GroupPermissionBatchChangeEvent.h" // 包含组权限批量变更事件
+#include "permission/events/PlayerGroupBatchChangeEvent.h" // 包含玩家组关系批量变更事件
 #include <algorithm>                          // 包含算法库
+#include <array>                              // 包含定长数组
+#include <chrono>                             // 包含计时
+#include <cstddef>                            // 包含 std::byte
 #include <functional>                         // 包含函数对象库
+#include <map>                                // 包含有序映射
+#include <memory_resource>                    // 包含重建快照时使用的栈上内存资源
 #include <ll/api/event/EventBus.h>            // 包含事件总线
 
 
@@ -19,35 +38,24 @@ namespace permission {
 
 using namespace std; // 将 using namespace std; 移动到全局作用域
 
-// --- 辅助函数：通配符转正则表达式（从原始类中移出） ---
-/**
- * @brief 将通配符模式转换为正则表达式。
- * @param pattern 包含通配符的字符串模式。
- * @return 对应的正则表达式对象。
- */
-std::regex PermissionManager::PermissionManagerImpl::wildcardToRegex(const std::string& pattern) {
-    std::string regexPatternStr = "^"; // 正则表达式以字符串开头
-    for (char c : pattern) {
-        if (c == '*') {
-            regexPatternStr += ".*"; // 将 '*' 转换为 '.*' (匹配任意字符零次或多次)
-        } else if (std::string(".\\+?^$[](){}|").find(c) != std::string::npos) {
-            regexPatternStr += '\\'; // 转义正则表达式特殊字符
-            regexPatternStr += c;
-        } else {
-            regexPatternStr += c; // 其他字符直接添加
-        }
-    }
-    regexPatternStr += "$"; // 正则表达式以字符串结尾
-    // 使用 ECMAScript 语法和不区分大小写的匹配
-    return std::regex(regexPatternStr, std::regex_constants::ECMAScript | std::regex_constants::icase);
+namespace {
+// 事件只在事件总线上有监听器时才构造和发布，没有插件关心时修改接口不付出分发开销
+template <typename Event>
+bool hasListeners() {
+    return ll::event::EventBus::getInstance().getListenerCount<Event>() > 0;
 }
+} // namespace
 
 // --- 实现类生命周期 ---
 
 /**
  * @brief PermissionManagerImpl 构造函数。
  */
-PermissionManager::PermissionManagerImpl::PermissionManagerImpl() = default;
+PermissionManager::PermissionManagerImpl::PermissionManagerImpl()
+: m_ioExecutor(std::make_unique<internal::IoExecutor>()),
+  m_expiryQueue(std::make_unique<internal::ExpiryQueue>()),
+  m_registry(std::make_unique<internal::PermissionRegistry>()),
+  m_recorder(std::make_unique<internal::CallRecorder>()) {}
 
 /**
  * @brief PermissionManagerImpl 析构函数。
@@ -62,11 +70,10 @@ PermissionManager::PermissionManagerImpl::~PermissionManagerImpl() {
 /**
  * @brief 初始化权限管理器实现。
  * @param db 数据库接口指针。
- * @param enableWarmup 是否启用预热缓存。
- * @param threadPoolSize 线程池大小。
+ * @param options 运行参数。
  * @return 如果初始化成功则返回 true，否则返回 false。
  */
-bool PermissionManager::PermissionManagerImpl::init(db::IDatabase* db, bool enableWarmup, unsigned int threadPoolSize) {
+bool PermissionManager::PermissionManagerImpl::init(db::IDatabase* db, const PermissionOptions& options) {
     if (m_initialized) {
         ::ll::mod::NativeMod::current()->getLogger().warn("权限管理器已初始化，无需重复初始化。");
         return true;
@@ -75,23 +82,79 @@ bool PermissionManager::PermissionManagerImpl::init(db::IDatabase* db, bool enab
         ::ll::mod::NativeMod::current()->getLogger().error("权限管理器初始化失败：数据库指针为空。");
         return false;
     }
+    internal::Tracer::getInstance().setEnabled(options.tracing);
 
     try {
         // 创建权限存储、缓存和异步缓存失效器实例
         m_storage     = make_unique<internal::PermissionStorage>(db);
-        m_cache       = make_unique<internal::PermissionCache>();
+        m_cache       = make_unique<internal::PermissionCache>(options.cacheShardCount);
         m_invalidator = make_unique<internal::AsyncCacheInvalidator>(*m_cache, *m_storage);
+        // 索引随缓存一同替换，缓存通过监听器把玩家快照的变化告诉它
+        m_onlineIndex = make_unique<internal::OnlinePermissionIndex>(
+            *m_cache,
+            [this](const internal::PlayerKey& player) { return getPlayerPermissionSnapshot(player); },
+            [this] { return currentDefaultLayer(); },
+            [this](const PlayerPermissionSnapshot& snapshot, const DefaultPermissionLayer& layer, const std::string& node) {
+                return evaluatePermission(snapshot, layer, node, false); // 在索引的锁内调用，不查询数据库
+            }
+        );
+        m_cache->setDecisionCacheCapacity(options.decisionCacheMaxEntriesPerPlayer);
+        m_cache->setPlayerCacheMaxBytes(options.playerCacheMaxBytes);
+        if (options.refreshAhead) {
+            // 过期的在线玩家快照继续服务，同时排队后台重建
+            m_cache->setStaleSnapshotHandler([this](const internal::PlayerKey& player) {
+                m_invalidator->enqueueTask({CacheInvalidationTaskType::PLAYER_REFRESH, player.toString()});
+            });
+            m_invalidator->setRefreshHandler([this](const internal::PlayerKey& player) { refreshPlayer(player); });
+        }
 
         // 确保数据库表存在
         m_storage->ensureTables();
+        // 载入所有带过期时间的玩家组关系，清理线程据此在到期时精确删除
+        m_expiryQueue->merge(m_storage->fetchPlayerGroupExpirations());
+        ::ll::mod::NativeMod::current()->getLogger().debug("已载入 {} 条带过期时间的玩家组关系。", m_expiryQueue->size());
+
+        // 跨服务器失效日志的读取位置须在预热读取数据之前确定，之后其他服务器的修改都不会漏掉
+        long long clusterLogPosition = 0;
+        if (options.clusterInvalidation) {
+            clusterLogPosition = m_storage->fetchLatestInvalidationLogId().value_or(0);
+            m_cluster          = make_unique<internal::ClusterInvalidator>(
+                *m_storage,
+                std::chrono::milliseconds(options.clusterPollIntervalMs),
+                [this](std::vector<CacheInvalidationTask> tasks) { onRemoteInvalidations(std::move(tasks)); }
+            );
+            m_invalidator->setPublishHandler([this](const CacheInvalidationTask& task) { m_cluster->publish(task); });
+        }
 
-        // 如果启用预热，则填充所有缓存
-        if (enableWarmup) {
-            populateAllCaches();
+        // 如果启用预热，则填充所有缓存；配置了快照文件且未过期时直接载入
+        m_snapshotPath = options.cacheSnapshotPath;
+        m_snapshotWatermark.reset();
+        if (options.enableWarmup) {
+            // 水位须在读取任何数据之前获取，之后的修改都会使它变化
+            std::optional<uint64_t> watermark;
+            if (!m_snapshotPath.empty()) watermark = m_storage->fetchChangeWatermark();
+            if (!watermark || !loadCacheSnapshot(*watermark)) {
+                populateAllCaches(options.warmupRecentPlayers);
+            }
+            m_snapshotWatermark    = watermark;
+            m_snapshotLocalChanges = m_storage->localChangeCount();
         }
 
         // 启动异步缓存失效器
-        m_invalidator->start(threadPoolSize);
+        m_invalidator->start(options.threadPoolSize);
+        if (m_cluster) m_cluster->start(clusterLogPosition);
+        if (options.writeBehind) {
+            m_writeBehind = make_unique<internal::WriteBehindQueue>(
+                *m_storage,
+                std::chrono::milliseconds(options.writeBehindIntervalMs),
+                options.writeBehindMaxBatch,
+                [this](const std::vector<internal::AppliedPlayerGroupMutation>& applied) {
+                    onPlayerGroupMutationsApplied(applied);
+                }
+            );
+            m_writeBehind->start();
+        }
+        m_ioExecutor->start(options.ioThreadPoolSize);
         m_initialized = true;
         ::ll::mod::NativeMod::current()->getLogger().info("权限管理器初始化成功。");
         return true;
@@ -111,31 +174,78 @@ void PermissionManager::PermissionManagerImpl::shutdown() {
         // 如果未初始化，则直接返回
         return;
     }
+    m_recorder->stop();
+    // 先执行完已提交的异步调用，它们可能还会写入写回队列和失效器
+    m_ioExecutor->stop();
+    // 再提交写回队列中剩余的修改，它们的失效任务仍需由失效器处理
+    if (m_writeBehind) {
+        m_writeBehind->stop();
+        m_writeBehind.reset();
+    }
+    // 写出剩余的待发布任务，并停止接收其他服务器的任务
+    if (m_cluster) {
+        m_cluster->stop();
+    }
     // 停止异步缓存失效器
     m_invalidator->stop();
+    m_cluster.reset();
+    // 失效任务已全部处理，缓存与数据库一致，此时写入快照文件
+    if (!m_snapshotPath.empty() && m_snapshotWatermark) {
+        saveCacheSnapshot();
+    }
     m_initialized = false;
     ::ll::mod::NativeMod::current()->getLogger().info("权限管理器已关闭。");
 }
 
 /**
  * @brief 预热所有权限缓存。
- *        此方法会从存储层加载数据并填充到缓存中，以提高后续查询性能。
+ *        组、继承、组权限与默认值各用一次流式查询并行读取（使用连接池时各占一个连接），
+ *        读完后在内存中构建所有组的权限快照，不再逐组查询；最后可选地预热最近上线的玩家。
+ * @param recentPlayers 预热最近上线的玩家数量，0 表示不预热玩家。
  */
-void PermissionManager::PermissionManagerImpl::populateAllCaches() {
+void PermissionManager::PermissionManagerImpl::populateAllCaches(size_t recentPlayers) {
+    using Clock  = std::chrono::steady_clock;
     auto& logger = ::ll::mod::NativeMod::current()->getLogger();
     logger.info("正在预热权限缓存...");
+    auto elapsedMs = [](Clock::time_point since) {
+        return static_cast<long long>(std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - since).count());
+    };
+    // 在独立线程中执行一次读取并记录耗时
+    auto timedLoad = [&elapsedMs](auto load, long long& ms) {
+        return std::async(std::launch::async, [load = std::move(load), &ms, &elapsedMs] {
+            auto since  = Clock::now();
+            auto result = load();
+            ms          = elapsedMs(since);
+            return result;
+        });
+    };
+
+    auto     start = Clock::now();
+    uint64_t epoch = m_cache->getGroupEpoch(); // 在读取任何数据之前获取
+
+    // 1. 并行读取四张表
+    long long groupsMs = 0, inheritanceMs = 0, permissionsMs = 0, defaultsMs = 0;
+    auto      groupsTask      = timedLoad([this] { return m_storage->fetchAllGroupDetails(); }, groupsMs);
+    auto      inheritanceTask = timedLoad([this] { return m_storage->fetchAllInheritance(); }, inheritanceMs);
+    auto      permissionsTask = timedLoad([this] { return m_storage->fetchAllGroupPermissions(); }, permissionsMs);
+    auto      defaultsTask    = timedLoad([this] { return m_storage->fetchAllPermissionDefaults(); }, defaultsMs);
+
+    PreloadedGroupData preloaded;
+    preloaded.groupsByName    = groupsTask.get();
+    preloaded.permissionsById = permissionsTask.get();
+    auto parentToChildren     = inheritanceTask.get();
+    auto defaults             = defaultsTask.get();
+    long long loadMs          = elapsedMs(start);
 
     // 填充组名 -> ID 缓存
-    std::vector<std::string> groupNamesVec = m_storage->fetchAllGroupNames();
-    std::set<std::string> groupNamesSet(groupNamesVec.begin(), groupNamesVec.end()); // 将向量转换为集合
-    
-    // 批量获取所有组名及其 ID
-    std::unordered_map<std::string, std::string> groupNameMap = m_storage->fetchGroupIdsByNames(groupNamesSet);
+    std::unordered_map<std::string, std::string> groupNameMap;
+    for (const auto& [name, details] : preloaded.groupsByName) {
+        groupNameMap.emplace(name, details.id);
+    }
+    logger.debug("已使用 {} 个条目填充组名缓存。", groupNameMap.size());
     m_cache->populateAllGroups(std::move(groupNameMap));
-    logger.debug("已使用 {} 个条目填充组名缓存。", groupNameMap.size()); // 使用 map 大小确保准确性
 
     // 填充继承缓存
-    auto                               parentToChildren = m_storage->fetchAllInheritance();
     unordered_map<string, set<string>> childToParents;
     for (const auto& pair : parentToChildren) {
         const string& parent = pair.first;
@@ -147,21 +257,153 @@ void PermissionManager::PermissionManagerImpl::populateAllCaches() {
     logger.debug("已填充继承缓存。");
 
     // 填充权限默认值缓存
-    m_cache->populateAllPermissionDefaults(m_storage->fetchAllPermissionDefaults());
+    m_cache->populateAllPermissionDefaults(std::move(defaults));
     logger.debug("已填充权限默认值缓存。");
 
-    // 组权限缓存由 getPermissionsOfGroup 按需填充
-    // 玩家权限和组缓存也是按需填充
-
-    // 预热组权限缓存
-    for (const auto& pair : m_cache->getAllGroups()) {
+    // 2. 预先构建所有组的权限快照
+    auto buildStart = Clock::now();
+    for (const auto& pair : preloaded.groupsByName) {
         const std::string& groupName = pair.first;
-        // 调用 getPermissionsOfGroup 会自动填充 m_groupPermissionsCache
-        getPermissionsOfGroup(groupName);
-        logger.debug("已预热组 '{}' 的权限缓存。", groupName);
+        auto               layer     = computeGroupLayer(m_cache->getAncestorClosure(groupName), &preloaded);
+        m_cache->storeGroupPermissions(groupName, std::make_shared<const GroupPermissionSnapshot>(layer));
+    }
+    long long buildMs = elapsedMs(buildStart);
+
+    // 3. 预热最近上线的玩家：一次读出他们的组，再归并上面已构建的组权限层
+    auto   playersStart  = Clock::now();
+    size_t warmedPlayers = 0;
+    if (recentPlayers > 0) {
+        auto players         = m_storage->fetchRecentlySeenPlayers(recentPlayers);
+        auto groupsByPlayer  = m_storage->fetchPlayerGroupsWithDetails(players);
+        for (const auto& playerUuid : players) {
+            auto                      it = groupsByPlayer.find(playerUuid);
+            std::vector<GroupDetails> details;
+            if (it != groupsByPlayer.end()) details = std::move(it->second);
+            auto player = internal::PlayerKey::fromString(playerUuid);
+            auto groups = buildPlayerGroupsSnapshot(player, epoch, std::move(details));
+            buildPlayerPermissionSnapshot(player, epoch, *groups);
+            ++warmedPlayers;
+        }
     }
+    long long playersMs = elapsedMs(playersStart);
+
+    logger.info(
+        "权限缓存预热完成，共 {} ms：读取 {} ms（组 {} ms，继承 {} ms，组权限 {} ms，默认值 {} ms），"
+        "构建 {} 个组的权限快照 {} ms，预热 {} 名玩家 {} ms。",
+        elapsedMs(start),
+        loadMs,
+        groupsMs,
+        inheritanceMs,
+        permissionsMs,
+        defaultsMs,
+        preloaded.groupsByName.size(),
+        buildMs,
+        warmedPlayers,
+        playersMs
+    );
+}
 
-    logger.info("权限缓存预热完成。");
+/**
+ * @brief 从快照文件载入组、继承、组权限层与默认值缓存。
+ * @param watermark 数据库当前的变更水位。
+ * @return 载入成功返回 true，否则返回 false。
+ */
+bool PermissionManager::PermissionManagerImpl::loadCacheSnapshot(uint64_t watermark) {
+    auto& logger = ::ll::mod::NativeMod::current()->getLogger();
+    auto  start  = std::chrono::steady_clock::now();
+    auto  data   = internal::CacheSnapshotFile::read(m_snapshotPath);
+    if (!data) {
+        logger.info("未找到可用的缓存快照文件，执行完整预热。");
+        return false;
+    }
+    if (data->watermark != watermark) {
+        logger.info("缓存快照已过期（快照水位 {}，数据库水位 {}），执行完整预热。", data->watermark, watermark);
+        return false;
+    }
+
+    size_t groupCount = data->groupIds.size();
+    size_t layerCount = data->groupLayers.size();
+    m_cache->populateAllGroups(std::move(data->groupIds));
+    m_cache->replaceGroupGraph(std::make_shared<const internal::GroupGraph>(std::move(data->graph)));
+    m_cache->populateAllPermissionDefaults(std::move(data->permissionDefaults));
+    for (auto& [groupName, rules] : data->groupLayers) {
+        m_cache->storeGroupPermissions(groupName, std::make_shared<const GroupPermissionSnapshot>(rules));
+    }
+    logger.info(
+        "已从缓存快照载入 {} 个组与 {} 个组权限层，耗时 {} ms。",
+        groupCount,
+        layerCount,
+        std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count()
+    );
+    return true;
+}
+
+/**
+ * @brief 把当前的组、继承、组权限层与默认值缓存写入快照文件。
+ */
+void PermissionManager::PermissionManagerImpl::saveCacheSnapshot() {
+    auto& logger  = ::ll::mod::NativeMod::current()->getLogger();
+    auto  current = m_storage->fetchChangeWatermark();
+    // 本实例的每次修改都已由失效器反映到缓存中；水位多出的部分来自其他实例，缓存未必看到了这些修改
+    uint64_t expected = *m_snapshotWatermark + (m_storage->localChangeCount() - m_snapshotLocalChanges);
+    if (!current || *current != expected) {
+        logger.info("数据库在运行期间被其他实例修改过，不写入缓存快照。");
+        return;
+    }
+
+    internal::CacheSnapshotData data;
+    data.watermark          = *current;
+    data.groupIds           = m_cache->getAllGroups();
+    data.graph              = *m_cache->getGroupGraph();
+    data.permissionDefaults = m_cache->getAllPermissionDefaults();
+    data.groupLayers.reserve(data.groupIds.size());
+    for (const auto& pair : data.groupIds) {
+        // 已失效的组权限层在这里按需重建，下次启动时所有组都不必再查询数据库
+        data.groupLayers.emplace_back(pair.first, getGroupPermissionSnapshot(pair.first)->rankedRules());
+    }
+    if (internal::CacheSnapshotFile::write(m_snapshotPath, data)) {
+        logger.info("已写入缓存快照（{} 个组，水位 {}）。", data.groupIds.size(), data.watermark);
+    }
+}
+
+/**
+ * @brief 处理其他服务器发布的失效任务。
+ * @param tasks 其他服务器发布的任务。
+ */
+void PermissionManager::PermissionManagerImpl::onRemoteInvalidations(std::vector<CacheInvalidationTask> tasks) {
+    bool groupsChanged = std::any_of(tasks.begin(), tasks.end(), [](const CacheInvalidationTask& task) {
+        return task.type == CacheInvalidationTaskType::GROUP_MODIFIED
+            || task.type == CacheInvalidationTaskType::ALL_GROUPS_MODIFIED;
+    });
+    if (groupsChanged) {
+        // 组的创建、删除与继承关系修改在发起的服务器上直接更新缓存，这里须从数据库重新载入，
+        // 之后处理 GROUP_MODIFIED 时才能按新的继承关系找到受影响的子组
+        std::unordered_map<std::string, std::string> groupNameMap;
+        for (const auto& [name, details] : m_storage->fetchAllGroupDetails()) {
+            groupNameMap.emplace(name, details.id);
+        }
+        m_cache->populateAllGroups(std::move(groupNameMap));
+
+        auto                               parentToChildren = m_storage->fetchAllInheritance();
+        unordered_map<string, set<string>> childToParents;
+        for (const auto& [parent, children] : parentToChildren) {
+            for (const auto& child : children) childToParents[child].insert(parent);
+        }
+        m_cache->populateInheritance(std::move(parentToChildren), std::move(childToParents));
+
+        // 新的继承关系已经生效，在任务排队期间旧的玩家快照不能继续命中：立即按新图递增代数，
+        // 任务执行时再释放快照并重建在线玩家
+        for (const auto& task : tasks) {
+            if (task.type == CacheInvalidationTaskType::ALL_GROUPS_MODIFIED) {
+                m_cache->bumpAllGroupGenerations();
+            } else if (task.type == CacheInvalidationTaskType::GROUP_MODIFIED) {
+                m_cache->bumpGroupGenerations(m_cache->getDescendantClosure(task.data));
+            }
+        }
+    }
+    for (auto& task : tasks) {
+        m_invalidator->enqueueRemoteTask(std::move(task));
+    }
 }
 
 // --- 缓存感知辅助函数 ---
@@ -202,15 +444,25 @@ bool PermissionManager::PermissionManagerImpl::registerPermission(
     bool               defaultValue
 ) {
     if (m_storage->upsertPermission(name, description, defaultValue)) {
+        m_registry->resolve(name); // 注册的节点都分配ID，之后可直接按ID检查
+        // 玩家快照不包含默认权限，只需更新默认权限层的版本，无需重建任何玩家或组的缓存
         m_cache->storePermissionDefault(name, defaultValue);
-        // 权限注册或更新后，需要使所有组和玩家的权限缓存失效
-        m_invalidator->enqueueTask({CacheInvalidationTaskType::ALL_GROUPS_MODIFIED, ""});
-        m_invalidator->enqueueTask({CacheInvalidationTaskType::ALL_PLAYERS_MODIFIED, ""});
+        // 本机已同步更新，只需通知其他服务器重新载入默认权限
+        m_invalidator->publish({CacheInvalidationTaskType::PERMISSION_DEFAULT_CHANGED, name});
         return true;
     }
     return false;
 }
 
+/**
+ * @brief 获取权限节点的整数ID。
+ * @param name 权限节点名。
+ * @return 权限ID。
+ */
+PermissionId PermissionManager::PermissionManagerImpl::resolvePermission(const std::string& name) {
+    return m_registry->resolve(name);
+}
+
 /**
  * @brief 检查权限是否存在。
  * @param name 权限名称。
@@ -238,6 +490,7 @@ bool PermissionManager::PermissionManagerImpl::createGroup(
     const std::string& groupName,
     const std::string& description
 ) {
+    m_recorder->record(internal::RecordedOp::CREATE_GROUP, {groupName});
     string groupId;
     if (m_storage->createGroup(groupName, description, groupId) && !groupId.empty()) {
         m_cache->storeGroup(groupName, groupId);
@@ -253,6 +506,7 @@ bool PermissionManager::PermissionManagerImpl::createGroup(
  * @return 如果删除成功则返回 true，否则返回 false。
  */
 bool PermissionManager::PermissionManagerImpl::deleteGroup(const std::string& groupName) {
+    m_recorder->record(internal::RecordedOp::DELETE_GROUP, {groupName});
     string groupId = getCachedGroupId(groupName);
     if (groupId.empty()) {
         return false; // 组不存在
@@ -265,6 +519,8 @@ bool PermissionManager::PermissionManagerImpl::deleteGroup(const std::string& gr
     if (m_storage->deleteGroup(groupId)) {
         // 从数据库删除后使缓存失效
         m_cache->invalidateGroup(groupName);
+        // 数据库已级联删除继承关系，图中的边也要同步移除，否则会残留到缓存快照中
+        m_cache->removeGroupFromGraph(groupName);
         // 将所有相关组及其玩家的缓存失效任务加入队列
         for (const auto& child : children)
             m_invalidator->enqueueTask({CacheInvalidationTaskType::GROUP_MODIFIED, child});
@@ -331,6 +587,7 @@ bool PermissionManager::PermissionManagerImpl::addPermissionToGroup(
     const std::string& groupName,
     const std::string& permissionRule
 ) {
+    m_recorder->record(internal::RecordedOp::ADD_PERMISSION_TO_GROUP, {groupName, permissionRule});
     string groupId = getCachedGroupId(groupName);
     if (groupId.empty()) return false; // 组不存在
 
@@ -338,22 +595,26 @@ bool PermissionManager::PermissionManagerImpl::addPermissionToGroup(
     std::string permissionRuleForEvent = permissionRule;
     bool isAddForEvent = true;
 
-    auto beforeEvent = event::GroupPermissionChangeBeforeEvent(groupNameForEvent, permissionRuleForEvent, isAddForEvent);
-    ll::event::EventBus::getInstance().publish(beforeEvent);
-    if (beforeEvent.isCancelled()) {
-        ::ll::mod::NativeMod::current()->getLogger().debug(
-            "组 '{}' 添加权限 '{}' 的事件被取消。",
-            groupName,
-            permissionRule
-        );
-        return false;
+    if (hasListeners<event::GroupPermissionChangeBeforeEvent>()) {
+        auto beforeEvent = event::GroupPermissionChangeBeforeEvent(groupNameForEvent, permissionRuleForEvent, isAddForEvent);
+        ll::event::EventBus::getInstance().publish(beforeEvent);
+        if (beforeEvent.isCancelled()) {
+            ::ll::mod::NativeMod::current()->getLogger().debug(
+                "组 '{}' 添加权限 '{}' 的事件被取消。",
+                groupName,
+                permissionRule
+            );
+            return false;
+        }
     }
 
     if (m_storage->addPermissionToGroup(groupId, permissionRule)) {
         // 组权限修改后，需要使该组的权限缓存失效
         m_invalidator->enqueueTask({CacheInvalidationTaskType::GROUP_MODIFIED, groupName});
-        
-        ll::event::EventBus::getInstance().publish(event::GroupPermissionChangeAfterEvent(groupNameForEvent, permissionRuleForEvent, isAddForEvent));
+
+        if (hasListeners<event::GroupPermissionChangeAfterEvent>()) {
+            ll::event::EventBus::getInstance().publish(event::GroupPermissionChangeAfterEvent(groupNameForEvent, permissionRuleForEvent, isAddForEvent));
+        }
         return true;
     }
     return false;
@@ -369,6 +630,7 @@ bool PermissionManager::PermissionManagerImpl::removePermissionFromGroup(
     const std::string& groupName,
     const std::string& permissionRule
 ) {
+    m_recorder->record(internal::RecordedOp::REMOVE_PERMISSION_FROM_GROUP, {groupName, permissionRule});
     string groupId = getCachedGroupId(groupName);
     if (groupId.empty()) return false; // 组不存在
 
@@ -376,22 +638,26 @@ bool PermissionManager::PermissionManagerImpl::removePermissionFromGroup(
     std::string permissionRuleForEvent = permissionRule;
     bool isAddForEvent = false;
 
-    auto beforeEvent = event::GroupPermissionChangeBeforeEvent(groupNameForEvent, permissionRuleForEvent, isAddForEvent);
-    ll::event::EventBus::getInstance().publish(beforeEvent);
-    if (beforeEvent.isCancelled()) {
-        ::ll::mod::NativeMod::current()->getLogger().debug(
-            "组 '{}' 移除权限 '{}' 的事件被取消。",
-            groupName,
-            permissionRule
-        );
-        return false;
+    if (hasListeners<event::GroupPermissionChangeBeforeEvent>()) {
+        auto beforeEvent = event::GroupPermissionChangeBeforeEvent(groupNameForEvent, permissionRuleForEvent, isAddForEvent);
+        ll::event::EventBus::getInstance().publish(beforeEvent);
+        if (beforeEvent.isCancelled()) {
+            ::ll::mod::NativeMod::current()->getLogger().debug(
+                "组 '{}' 移除权限 '{}' 的事件被取消。",
+                groupName,
+                permissionRule
+            );
+            return false;
+        }
     }
 
     if (m_storage->removePermissionFromGroup(groupId, permissionRule)) {
         // 组权限修改后，需要使该组的权限缓存失效
         m_invalidator->enqueueTask({CacheInvalidationTaskType::GROUP_MODIFIED, groupName});
-        
-        ll::event::EventBus::getInstance().publish(event::GroupPermissionChangeAfterEvent(groupNameForEvent, permissionRuleForEvent, isAddForEvent));
+
+        if (hasListeners<event::GroupPermissionChangeAfterEvent>()) {
+            ll::event::EventBus::getInstance().publish(event::GroupPermissionChangeAfterEvent(groupNameForEvent, permissionRuleForEvent, isAddForEvent));
+        }
         return true;
     }
     return false;
@@ -416,70 +682,101 @@ PermissionManager::PermissionManagerImpl::getDirectPermissionsOfGroup(const std:
  */
 std::vector<CompiledPermissionRule>
 PermissionManager::PermissionManagerImpl::getPermissionsOfGroup(const std::string& groupName) {
+    return getGroupPermissionSnapshot(groupName)->rules;
+}
+
+/**
+ * @brief 获取组的权限快照（包括继承的权限），缓存未命中时构建并缓存。
+ * @param groupName 组名称。
+ * @return 不可变的权限快照，永不为空。
+ */
+std::shared_ptr<const GroupPermissionSnapshot>
+PermissionManager::PermissionManagerImpl::getGroupPermissionSnapshot(const std::string& groupName) {
     // 1. 检查缓存
-    auto cachedPerms = m_cache->findGroupPermissions(groupName);
-    if (cachedPerms) {
-        return *cachedPerms; // 缓存命中，直接返回
+    if (auto cached = m_cache->findGroupPermissions(groupName)) {
+        return cached; // 缓存命中，直接返回
     }
 
     // 2. 缓存未命中，计算权限
-    // 获取所有祖先组的名称
-    std::set<std::string> ancestorNames = m_cache->getAllAncestorGroups(groupName);
-    // 批量获取所有相关组的详情
-    std::unordered_map<std::string, GroupDetails> relevantGroupsMap = m_storage->fetchGroupDetailsByNames(ancestorNames);
-    std::vector<GroupDetails>                relevantGroups;
-    std::vector<std::string>                 relevantGroupIds; // 用于批量查询权限
-    for (const auto& name : ancestorNames) {
-        auto it = relevantGroupsMap.find(name);
+    // 版本必须在读取组数据之前获取，构建期间组权限失效时只返回不缓存
+    uint64_t version = m_cache->getGroupPermissionsVersion();
+    auto     layer   = computeGroupLayer(m_cache->getAncestorClosure(groupName));
+
+    // 3. 构建快照，存储到缓存并返回
+    auto snapshot = std::make_shared<const GroupPermissionSnapshot>(layer);
+    m_cache->storeGroupPermissions(groupName, snapshot, version);
+    return snapshot;
+}
+
+/**
+ * @brief 按优先级升序把一组权限组的直接权限叠加为组权限层，高优先级组覆盖低优先级组。
+ * @param groups 参与计算的组（一个组的祖先闭包）。
+ * @param preloaded 预热时读出的组数据，为空时从存储层查询。
+ * @return 按模式字典序排列的规则及决定其状态的组的优先级。
+ */
+std::vector<RankedPermissionRule> PermissionManager::PermissionManagerImpl::computeGroupLayer(
+    const internal::GroupClosure& groups,
+    const PreloadedGroupData*     preloaded
+) {
+    // 批量获取所有相关组的详情（预热时直接使用已读出的数据，不复制组名）
+    std::unordered_map<std::string, GroupDetails> fetchedGroupsMap;
+    if (!preloaded) fetchedGroupsMap = m_storage->fetchGroupDetailsByNames(std::set<std::string>(groups.begin(), groups.end()));
+    const auto& relevantGroupsMap = preloaded ? preloaded->groupsByName : fetchedGroupsMap;
+    std::vector<const GroupDetails*>              relevantGroups;
+    std::vector<std::string>                      relevantGroupIds; // 用于批量查询权限
+    relevantGroups.reserve(groups.size());
+    for (std::string_view name : groups) {
+        auto it = relevantGroupsMap.find(std::string(name));
         if (it != relevantGroupsMap.end()) {
-            relevantGroups.push_back(it->second);
-            relevantGroupIds.push_back(it->second.id);
+            relevantGroups.push_back(&it->second);
+            if (!preloaded) relevantGroupIds.push_back(it->second.id);
         }
     }
 
-    // 根据优先级对相关组进行排序
-    std::sort(relevantGroups.begin(), relevantGroups.end(), [](const auto& a, const auto& b) {
-        return a.priority < b.priority;
+    // 根据优先级对相关组进行排序，同优先级按组名排序，使结果与组 ID 的分配顺序无关
+    std::sort(relevantGroups.begin(), relevantGroups.end(), [](const GroupDetails* a, const GroupDetails* b) {
+        return a->priority != b->priority ? a->priority < b->priority : a->name < b->name;
     });
 
     // 批量获取所有相关组的直接权限
-    std::unordered_map<std::string, std::vector<std::string>> allDirectPermissions =
-        m_storage->fetchDirectPermissionsOfGroups(relevantGroupIds);
+    std::unordered_map<std::string, std::vector<std::string>> fetchedPermissions;
+    if (!preloaded) fetchedPermissions = m_storage->fetchDirectPermissionsOfGroups(relevantGroupIds);
+    const auto& allDirectPermissions = preloaded ? preloaded->permissionsById : fetchedPermissions;
 
-    // 计算最终的有效权限状态
-    std::map<std::string, bool> effectiveState;
-    for (const auto& group : relevantGroups) {
+    // 计算最终的有效权限状态，同时记录决定该状态的组的优先级
+    std::map<std::string, std::pair<bool, int>> effectiveState;
+    for (const GroupDetails* group : relevantGroups) {
         // 从批量查询结果中获取当前组的权限
-        auto it = allDirectPermissions.find(group.id);
+        auto it = allDirectPermissions.find(group->id);
         if (it != allDirectPermissions.end()) {
-            const auto& rules = it->second;
-            for (const auto& rule : rules) {
+            for (const auto& rule : it->second) {
                 bool        isNegated = rule.starts_with("-"); // 检查是否是负向权限
                 std::string baseName  = isNegated ? rule.substr(1) : rule; // 获取权限基础名称
                 if (baseName.empty()) continue;
-                effectiveState[baseName] = !isNegated; // 设置权限的有效状态
+                effectiveState[baseName] = {!isNegated, group->priority}; // 设置权限的有效状态
             }
         }
     }
 
-    // 将有效权限转换为编译后的权限规则
-    std::vector<CompiledPermissionRule> finalPerms;
-    for (const auto& [pattern, state] : effectiveState) {
-        try {
-            finalPerms.emplace_back(pattern, wildcardToRegex(pattern), state);
-        } catch (const std::regex_error& e) {
-            ::ll::mod::NativeMod::current()->getLogger().error("权限模式 ", pattern, e.what());
-        }
+    std::vector<RankedPermissionRule> layer;
+    layer.reserve(effectiveState.size());
+    for (auto& [pattern, state] : effectiveState) {
+        layer.push_back({pattern, state.first, state.second});
     }
+    return layer;
+}
 
-    // 根据模式长度对权限进行排序（长模式优先）
-    std::sort(finalPerms.begin(), finalPerms.end(), [](const auto& a, const auto& b) {
-        return a.pattern.length() > b.pattern.length();
-    });
-
-    // 3. 存储到缓存并返回
-    m_cache->storeGroupPermissions(groupName, finalPerms);
-    return finalPerms;
+/**
+ * @brief 将有效权限状态转换为规则列表。
+ */
+std::vector<CompiledPermissionRule>
+PermissionManager::PermissionManagerImpl::toRules(const std::map<std::string, bool>& effectiveState) {
+    std::vector<CompiledPermissionRule> rules;
+    rules.reserve(effectiveState.size());
+    for (const auto& [pattern, state] : effectiveState) {
+        rules.emplace_back(pattern, state);
+    }
+    return rules;
 }
 
 /**
@@ -492,37 +789,7 @@ size_t PermissionManager::PermissionManagerImpl::addPermissionsToGroup(
     const std::string&              groupName,
     const std::vector<std::string>& permissionRules
 ) {
-    string groupId = getCachedGroupId(groupName);
-    if (groupId.empty()) return 0; // 组不存在
-
-    size_t successCount = 0;
-    for (const auto& rule : permissionRules) {
-        std::string groupNameForEvent = groupName;
-        std::string permissionRuleForEvent = rule;
-        bool isAddForEvent = true;
-
-        auto beforeEvent = event::GroupPermissionChangeBeforeEvent(groupNameForEvent, permissionRuleForEvent, isAddForEvent);
-        ll::event::EventBus::getInstance().publish(beforeEvent);
-        if (beforeEvent.isCancelled()) {
-            ::ll::mod::NativeMod::current()->getLogger().debug(
-                "组 '{}' 批量添加权限 '{}' 的事件被取消。",
-                groupName,
-                rule
-            );
-            continue; // 跳过此规则，继续处理下一个
-        }
-
-        if (m_storage->addPermissionToGroup(groupId, rule)) {
-            successCount++;
-            ll::event::EventBus::getInstance().publish(event::GroupPermissionChangeAfterEvent(groupNameForEvent, permissionRuleForEvent, isAddForEvent));
-        }
-    }
-
-    if (successCount > 0) {
-        // 组权限修改后，需要使该组的权限缓存失效
-        m_invalidator->enqueueTask({CacheInvalidationTaskType::GROUP_MODIFIED, groupName});
-    }
-    return successCount;
+    return changeGroupPermissions(groupName, permissionRules, true);
 }
 
 /**
@@ -535,35 +802,69 @@ size_t PermissionManager::PermissionManagerImpl::removePermissionsFromGroup(
     const std::string&              groupName,
     const std::vector<std::string>& permissionRules
 ) {
-    string groupId = getCachedGroupId(groupName);
-    if (groupId.empty()) return 0; // 组不存在
+    return changeGroupPermissions(groupName, permissionRules, false);
+}
 
-    size_t successCount = 0;
-    for (const auto& rule : permissionRules) {
-        std::string groupNameForEvent = groupName;
-        std::string permissionRuleForEvent = rule;
-        bool isAddForEvent = false;
+/**
+ * @brief 批量修改组权限的共同实现。
+ *        先触发一次批量 Before 事件（监听器可删除单条规则或取消整批），有逐条 Before 事件的监听器时再逐条询问；
+ *        剩下的规则在一个事务中写入，之后同样先触发批量 After 事件，再按需逐条触发。
+ * @param groupName 组名称。
+ * @param permissionRules 权限规则字符串向量。
+ * @param isAdd true 为添加，false 为移除。
+ * @return 成功写入的权限规则数量。
+ */
+size_t PermissionManager::PermissionManagerImpl::changeGroupPermissions(
+    const std::string&              groupName,
+    const std::vector<std::string>& permissionRules,
+    bool                            isAdd
+) {
+    string groupId = getCachedGroupId(groupName);
+    if (groupId.empty() || permissionRules.empty()) return 0; // 组不存在
 
-        auto beforeEvent = event::GroupPermissionChangeBeforeEvent(groupNameForEvent, permissionRuleForEvent, isAddForEvent);
+    auto&                    logger = ::ll::mod::NativeMod::current()->getLogger();
+    std::vector<std::string> rules  = permissionRules;
+    if (hasListeners<event::GroupPermissionBatchChangeBeforeEvent>()) {
+        auto beforeEvent = event::GroupPermissionBatchChangeBeforeEvent(groupName, rules, isAdd);
         ll::event::EventBus::getInstance().publish(beforeEvent);
         if (beforeEvent.isCancelled()) {
-            ::ll::mod::NativeMod::current()->getLogger().debug(
-                "组 '{}' 批量移除权限 '{}' 的事件被取消。",
-                groupName,
-                rule
-            );
-            continue; // 跳过此规则，继续处理下一个
-        }
-
-        if (m_storage->removePermissionFromGroup(groupId, rule)) {
-            successCount++;
-            ll::event::EventBus::getInstance().publish(event::GroupPermissionChangeAfterEvent(groupNameForEvent, permissionRuleForEvent, isAddForEvent));
+            logger.debug("组 '{}' 批量{}权限的事件被取消。", groupName, isAdd ? "添加" : "移除");
+            return 0;
         }
     }
+    if (hasListeners<event::GroupPermissionChangeBeforeEvent>()) {
+        std::erase_if(rules, [&](const std::string& rule) {
+            std::string groupNameForEvent      = groupName;
+            std::string permissionRuleForEvent = rule;
+            bool        isAddForEvent          = isAdd;
+            auto beforeEvent = event::GroupPermissionChangeBeforeEvent(groupNameForEvent, permissionRuleForEvent, isAddForEvent);
+            ll::event::EventBus::getInstance().publish(beforeEvent);
+            if (beforeEvent.isCancelled()) {
+                logger.debug("组 '{}' 批量{}权限 '{}' 的事件被取消。", groupName, isAdd ? "添加" : "移除", rule);
+                return true; // 跳过此规则，继续处理下一个
+            }
+            return false;
+        });
+    }
+    // 与存储层一致：空规则与单独的 "-" 不写入
+    std::erase_if(rules, [](const std::string& rule) { return rule.empty() || rule == "-"; });
+    if (rules.empty()) return 0;
 
-    if (successCount > 0) {
-        // 组权限修改后，需要使该组的权限缓存失效
-        m_invalidator->enqueueTask({CacheInvalidationTaskType::GROUP_MODIFIED, groupName});
+    size_t successCount =
+        isAdd ? m_storage->addPermissionsToGroup(groupId, rules) : m_storage->removePermissionsFromGroup(groupId, rules);
+    if (successCount == 0) return 0;
+
+    // 组权限修改后，需要使该组的权限缓存失效
+    m_invalidator->enqueueTask({CacheInvalidationTaskType::GROUP_MODIFIED, groupName});
+
+    // 存储层在同一事务中写入整批，提交成功即视为全部写入
+    if (hasListeners<event::GroupPermissionBatchChangeAfterEvent>()) {
+        ll::event::EventBus::getInstance().publish(event::GroupPermissionBatchChangeAfterEvent(groupName, rules, isAdd));
+    }
+    if (hasListeners<event::GroupPermissionChangeAfterEvent>()) {
+        for (const auto& rule : rules) {
+            ll::event::EventBus::getInstance().publish(event::GroupPermissionChangeAfterEvent(groupName, rule, isAdd));
+        }
     }
     return successCount;
 }
@@ -578,8 +879,9 @@ bool PermissionManager::PermissionManagerImpl::addGroupInheritance(
     const std::string& groupName,
     const std::string& parentGroupName
 ) {
-    // 检查是否尝试继承自身或形成循环
-    if (groupName == parentGroupName || m_cache->hasPath(parentGroupName, groupName)) {
+    m_recorder->record(internal::RecordedOp::ADD_GROUP_INHERITANCE, {groupName, parentGroupName});
+    // 检查是否尝试继承自身或形成循环：父组已经是子组的后代时，新边会成环
+    if (groupName == parentGroupName || m_cache->hasPath(groupName, parentGroupName)) {
         return false; // 检测到循环或无效继承
     }
     string groupId       = getCachedGroupId(groupName);
@@ -605,6 +907,7 @@ bool PermissionManager::PermissionManagerImpl::removeGroupInheritance(
     const std::string& groupName,
     const std::string& parentGroupName
 ) {
+    m_recorder->record(internal::RecordedOp::REMOVE_GROUP_INHERITANCE, {groupName, parentGroupName});
     string groupId       = getCachedGroupId(groupName);
     string parentGroupId = getCachedGroupId(parentGroupName);
     if (groupId.empty() || parentGroupId.empty()) return false; // 组或父组不存在
@@ -660,6 +963,7 @@ std::vector<std::string> PermissionManager::PermissionManagerImpl::getDirectPare
  * @return 如果设置成功则返回 true，否则返回 false。
  */
 bool PermissionManager::PermissionManagerImpl::setGroupPriority(const std::string& groupName, int priority) {
+    m_recorder->record(internal::RecordedOp::SET_GROUP_PRIORITY, {groupName}, priority);
     if (m_storage->updateGroupPriority(groupName, priority)) {
         // 组优先级修改后，需要使该组的权限缓存失效
         m_invalidator->enqueueTask({CacheInvalidationTaskType::GROUP_MODIFIED, groupName});
@@ -694,6 +998,7 @@ bool PermissionManager::PermissionManagerImpl::addPlayerToGroup(
     const std::string& groupName,
     long long          durationSeconds
 ) {
+    m_recorder->record(internal::RecordedOp::ADD_PLAYER_TO_GROUP, {playerUuid, groupName}, durationSeconds);
     string groupId = getCachedGroupId(groupName);
     if (groupId.empty()) return false; // 组不存在
 
@@ -719,23 +1024,29 @@ bool PermissionManager::PermissionManagerImpl::addPlayerToGroup(
     std::string groupNameForEvent = actualGroupName;
     std::optional<long long> expiryTimestampForEvent = expiryTimestamp;
 
-    auto beforeEvent = event::PlayerJoinGroupBeforeEvent(playerUuidForEvent, groupNameForEvent, expiryTimestampForEvent);
-    ll::event::EventBus::getInstance().publish(beforeEvent);
-    if (beforeEvent.isCancelled()) {
-        ::ll::mod::NativeMod::current()->getLogger().debug(
-            "玩家 '{}' 加入组 '{}' 的事件被取消。",
-            playerUuid,
-            actualGroupName
-        );
-        return false;
+    if (hasListeners<event::PlayerJoinGroupBeforeEvent>()) {
+        auto beforeEvent = event::PlayerJoinGroupBeforeEvent(playerUuidForEvent, groupNameForEvent, expiryTimestampForEvent);
+        ll::event::EventBus::getInstance().publish(beforeEvent);
+        if (beforeEvent.isCancelled()) {
+            ::ll::mod::NativeMod::current()->getLogger().debug(
+                "玩家 '{}' 加入组 '{}' 的事件被取消。",
+                playerUuid,
+                actualGroupName
+            );
+            return false;
+        }
     }
 
+    flushPendingWrites(); // 先让写回队列中更早的修改生效
     if (m_storage->addPlayerToGroup(playerUuid, groupId, expiryTimestamp)) {
         // 玩家组关系修改后，需要使该玩家的权限和组缓存失效
         m_invalidator->enqueueTask({CacheInvalidationTaskType::PLAYER_GROUP_CHANGED, playerUuid});
+        m_expiryQueue->schedule(playerUuid, groupId, expiryTimestamp); // 重新加入会覆盖原来的过期时间
         
         // 触发 PlayerJoinGroupAfterEvent
-        ll::event::EventBus::getInstance().publish(event::PlayerJoinGroupAfterEvent(playerUuidForEvent, groupNameForEvent, expiryTimestampForEvent));
+        if (hasListeners<event::PlayerJoinGroupAfterEvent>()) {
+            ll::event::EventBus::getInstance().publish(event::PlayerJoinGroupAfterEvent(playerUuidForEvent, groupNameForEvent, expiryTimestampForEvent));
+        }
         return true;
     }
     return false;
@@ -750,33 +1061,290 @@ bool PermissionManager::PermissionManagerImpl::removePlayerFromGroup(
     const std::string& playerUuid,
     const std::string& groupName
 ) {
+    m_recorder->record(internal::RecordedOp::REMOVE_PLAYER_FROM_GROUP, {playerUuid, groupName});
     string groupId = getCachedGroupId(groupName);
     if (groupId.empty()) return false; // 组不存在
 
     std::string playerUuidForEvent = playerUuid;
     std::string groupNameForEvent = groupName;
 
-    auto beforeEvent = event::PlayerLeaveGroupBeforeEvent(playerUuidForEvent, groupNameForEvent);
-    ll::event::EventBus::getInstance().publish(beforeEvent);
-    if (beforeEvent.isCancelled()) {
-        ::ll::mod::NativeMod::current()->getLogger().debug(
-            "玩家 '{}' 离开组 '{}' 的事件被取消。",
-            playerUuid,
-            groupName
-        );
-        return false;
+    if (hasListeners<event::PlayerLeaveGroupBeforeEvent>()) {
+        auto beforeEvent = event::PlayerLeaveGroupBeforeEvent(playerUuidForEvent, groupNameForEvent);
+        ll::event::EventBus::getInstance().publish(beforeEvent);
+        if (beforeEvent.isCancelled()) {
+            ::ll::mod::NativeMod::current()->getLogger().debug(
+                "玩家 '{}' 离开组 '{}' 的事件被取消。",
+                playerUuid,
+                groupName
+            );
+            return false;
+        }
     }
 
+    flushPendingWrites(); // 先让写回队列中更早的修改生效
     if (m_storage->removePlayerFromGroup(playerUuid, groupId)) {
         // 玩家组关系修改后，需要使该玩家的权限缓存失效
         m_invalidator->enqueueTask({CacheInvalidationTaskType::PLAYER_GROUP_CHANGED, playerUuid});
-        
-        ll::event::EventBus::getInstance().publish(event::PlayerLeaveGroupAfterEvent(playerUuidForEvent, groupNameForEvent));
+        m_expiryQueue->cancel(playerUuid, groupId);
+
+        if (hasListeners<event::PlayerLeaveGroupAfterEvent>()) {
+            ll::event::EventBus::getInstance().publish(event::PlayerLeaveGroupAfterEvent(playerUuidForEvent, groupNameForEvent));
+        }
         return true;
     }
     return false;
 }
 
+/**
+ * @brief 将玩家添加到组（写回队列）。
+ * @param playerUuid 玩家的 UUID。
+ * @param groupName 组名称。
+ * @param durationSeconds 有效时长（秒），0 或负数表示永不过期。
+ * @return 修改写入数据库后就绪的 future。
+ */
+std::future<bool> PermissionManager::PermissionManagerImpl::addPlayerToGroupBuffered(
+    const std::string& playerUuid,
+    const std::string& groupName,
+    long long          durationSeconds
+) {
+    if (!m_writeBehind) {
+        std::promise<bool> done;
+        done.set_value(addPlayerToGroup(playerUuid, groupName, durationSeconds));
+        return done.get_future();
+    }
+    m_recorder->record(internal::RecordedOp::ADD_PLAYER_TO_GROUP, {playerUuid, groupName}, durationSeconds);
+
+    std::promise<bool> rejected;
+    rejected.set_value(false);
+    string groupId = getCachedGroupId(groupName);
+    if (groupId.empty()) return rejected.get_future(); // 组不存在
+
+    std::optional<long long> expiryTimestamp;
+    if (durationSeconds > 0) {
+        long long currentTime =
+            std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch())
+                .count();
+        expiryTimestamp = currentTime + durationSeconds;
+    }
+
+    std::string              actualGroupName         = m_cache->findGroupName(groupId).value_or(groupName);
+    std::string              playerUuidForEvent      = playerUuid;
+    std::string              groupNameForEvent       = actualGroupName;
+    std::optional<long long> expiryTimestampForEvent = expiryTimestamp;
+
+    if (hasListeners<event::PlayerJoinGroupBeforeEvent>()) {
+        auto beforeEvent = event::PlayerJoinGroupBeforeEvent(playerUuidForEvent, groupNameForEvent, expiryTimestampForEvent);
+        ll::event::EventBus::getInstance().publish(beforeEvent);
+        if (beforeEvent.isCancelled()) {
+            ::ll::mod::NativeMod::current()->getLogger().debug(
+                "玩家 '{}' 加入组 '{}' 的事件被取消。",
+                playerUuid,
+                actualGroupName
+            );
+            return rejected.get_future();
+        }
+    }
+
+    return m_writeBehind->enqueue({true, playerUuid, groupId, expiryTimestamp}, actualGroupName);
+}
+
+/**
+ * @brief 将玩家从组中移除（写回队列）。
+ * @param playerUuid 玩家的 UUID。
+ * @param groupName 组名称。
+ * @return 修改写入数据库后就绪的 future。
+ */
+std::future<bool> PermissionManager::PermissionManagerImpl::removePlayerFromGroupBuffered(
+    const std::string& playerUuid,
+    const std::string& groupName
+) {
+    if (!m_writeBehind) {
+        std::promise<bool> done;
+        done.set_value(removePlayerFromGroup(playerUuid, groupName));
+        return done.get_future();
+    }
+    m_recorder->record(internal::RecordedOp::REMOVE_PLAYER_FROM_GROUP, {playerUuid, groupName});
+
+    std::promise<bool> rejected;
+    rejected.set_value(false);
+    string groupId = getCachedGroupId(groupName);
+    if (groupId.empty()) return rejected.get_future(); // 组不存在
+
+    std::string playerUuidForEvent = playerUuid;
+    std::string groupNameForEvent  = groupName;
+
+    if (hasListeners<event::PlayerLeaveGroupBeforeEvent>()) {
+        auto beforeEvent = event::PlayerLeaveGroupBeforeEvent(playerUuidForEvent, groupNameForEvent);
+        ll::event::EventBus::getInstance().publish(beforeEvent);
+        if (beforeEvent.isCancelled()) {
+            ::ll::mod::NativeMod::current()->getLogger().debug(
+                "玩家 '{}' 离开组 '{}' 的事件被取消。",
+                playerUuid,
+                groupName
+            );
+            return rejected.get_future();
+        }
+    }
+
+    return m_writeBehind->enqueue({false, playerUuid, groupId, std::nullopt}, groupName);
+}
+
+/**
+ * @brief 提交写回队列中的所有修改。
+ * @return 全部提交成功（或未启用写回队列）时返回 true。
+ */
+bool PermissionManager::PermissionManagerImpl::flushPendingWrites() {
+    return m_writeBehind ? m_writeBehind->flush() : true;
+}
+
+/**
+ * @brief 设置异步回调的投递函数。
+ * @param executor 投递函数，为空时回调在 I/O 线程中执行。
+ */
+void PermissionManager::PermissionManagerImpl::setCompletionExecutor(
+    std::function<void(std::function<void()>)> executor
+) {
+    std::lock_guard<std::mutex> lock(m_completionMutex);
+    m_completionExecutor = std::move(executor);
+}
+
+void PermissionManager::PermissionManagerImpl::runAsync(std::function<void()> task) {
+    postIo([task = std::move(task)] {
+        try {
+            task();
+        } catch (...) {
+            logAsyncFailure(std::current_exception());
+        }
+    });
+}
+
+void PermissionManager::PermissionManagerImpl::postIo(std::function<void()> task) {
+    if (m_ioExecutor->post(task)) return;
+    // I/O 线程未运行：直接执行，未初始化时各接口会自行返回失败
+    task();
+}
+
+void PermissionManager::PermissionManagerImpl::dispatchCompletion(std::function<void()> completion) {
+    std::function<void(std::function<void()>)> executor;
+    {
+        std::lock_guard<std::mutex> lock(m_completionMutex);
+        executor = m_completionExecutor;
+    }
+    if (executor) {
+        executor(std::move(completion));
+        return;
+    }
+    try {
+        completion();
+    } catch (const std::exception& e) {
+        ::ll::mod::NativeMod::current()->getLogger().error("异步调用的回调执行失败: {}", e.what());
+    }
+}
+
+void PermissionManager::PermissionManagerImpl::logAsyncFailure(const std::exception_ptr& error) {
+    try {
+        std::rethrow_exception(error);
+    } catch (const std::exception& e) {
+        ::ll::mod::NativeMod::current()->getLogger().error("异步调用执行失败: {}", e.what());
+    } catch (...) {
+        ::ll::mod::NativeMod::current()->getLogger().error("异步调用执行失败：未知异常。");
+    }
+}
+
+/**
+ * @brief 写回队列提交一批修改后调用，在提交线程中执行。
+ *        整批只产生一个失效任务；After 事件逐条触发。
+ * @param applied 已提交的修改。
+ */
+void PermissionManager::PermissionManagerImpl::onPlayerGroupMutationsApplied(
+    const std::vector<internal::AppliedPlayerGroupMutation>& applied
+) {
+    std::set<std::string> players;
+    for (const auto& item : applied) {
+        players.insert(item.mutation.playerUuid);
+        if (item.mutation.add) {
+            m_expiryQueue->schedule(item.mutation.playerUuid, item.mutation.groupId, item.mutation.expiryTimestamp);
+        } else {
+            m_expiryQueue->cancel(item.mutation.playerUuid, item.mutation.groupId);
+        }
+    }
+    CacheInvalidationTask task{CacheInvalidationTaskType::PLAYER_BATCH_GROUP_CHANGED, ""};
+    task.players.assign(players.begin(), players.end());
+    m_invalidator->enqueueTask(std::move(task));
+
+    if (!hasListeners<event::PlayerGroupBatchChangeAfterEvent>() && !hasListeners<event::PlayerJoinGroupAfterEvent>()
+        && !hasListeners<event::PlayerLeaveGroupAfterEvent>()) {
+        return; // 没有监听器时不复制修改列表
+    }
+    std::vector<event::PlayerGroupChange> changes;
+    changes.reserve(applied.size());
+    for (const auto& item : applied) {
+        changes.push_back({item.mutation.playerUuid, item.groupName, item.mutation.expiryTimestamp, item.mutation.add});
+    }
+    publishPlayerGroupChanges(changes);
+}
+
+bool PermissionManager::PermissionManagerImpl::confirmPlayerGroupChanges(std::vector<event::PlayerGroupChange>& changes) {
+    auto& logger = ::ll::mod::NativeMod::current()->getLogger();
+    if (hasListeners<event::PlayerGroupBatchChangeBeforeEvent>()) {
+        auto beforeEvent = event::PlayerGroupBatchChangeBeforeEvent(changes);
+        ll::event::EventBus::getInstance().publish(beforeEvent);
+        if (beforeEvent.isCancelled()) {
+            logger.debug("{} 条玩家组关系修改的批量事件被取消。", changes.size());
+            return false;
+        }
+    }
+    bool joinListeners  = hasListeners<event::PlayerJoinGroupBeforeEvent>();
+    bool leaveListeners = hasListeners<event::PlayerLeaveGroupBeforeEvent>();
+    if (!joinListeners && !leaveListeners) return true;
+    std::erase_if(changes, [&](event::PlayerGroupChange& change) {
+        if (change.isJoin ? !joinListeners : !leaveListeners) return false;
+        bool cancelled = false;
+        if (change.isJoin) {
+            auto beforeEvent = event::PlayerJoinGroupBeforeEvent(change.playerUuid, change.groupName, change.expirationTime);
+            ll::event::EventBus::getInstance().publish(beforeEvent);
+            cancelled = beforeEvent.isCancelled();
+        } else {
+            auto beforeEvent = event::PlayerLeaveGroupBeforeEvent(change.playerUuid, change.groupName);
+            ll::event::EventBus::getInstance().publish(beforeEvent);
+            cancelled = beforeEvent.isCancelled();
+        }
+        if (cancelled) {
+            logger.debug(
+                "玩家 '{}' {}组 '{}' 的事件被取消。",
+                change.playerUuid,
+                change.isJoin ? "加入" : "离开",
+                change.groupName
+            );
+        }
+        return cancelled;
+    });
+    return true;
+}
+
+void PermissionManager::PermissionManagerImpl::publishPlayerGroupChanges(
+    const std::vector<event::PlayerGroupChange>& changes
+) {
+    if (changes.empty()) return;
+    if (hasListeners<event::PlayerGroupBatchChangeAfterEvent>()) {
+        ll::event::EventBus::getInstance().publish(event::PlayerGroupBatchChangeAfterEvent(changes));
+    }
+    bool joinListeners  = hasListeners<event::PlayerJoinGroupAfterEvent>();
+    bool leaveListeners = hasListeners<event::PlayerLeaveGroupAfterEvent>();
+    if (!joinListeners && !leaveListeners) return;
+    for (const auto& change : changes) {
+        if (change.isJoin && joinListeners) {
+            ll::event::EventBus::getInstance().publish(
+                event::PlayerJoinGroupAfterEvent(change.playerUuid, change.groupName, change.expirationTime)
+            );
+        } else if (!change.isJoin && leaveListeners) {
+            ll::event::EventBus::getInstance().publish(
+                event::PlayerLeaveGroupAfterEvent(change.playerUuid, change.groupName)
+            );
+        }
+    }
+}
+
 /**
  * @brief 获取玩家所属的组及其优先级。
  * @param playerUuid 玩家的 UUID。
@@ -784,15 +1352,88 @@ bool PermissionManager::PermissionManagerImpl::removePlayerFromGroup(
  */
 std::vector<GroupDetails>
 PermissionManager::PermissionManagerImpl::getPlayerGroupsWithPriorities(const std::string& playerUuid) {
+    return *getPlayerGroupsSnapshot(playerUuid);
+}
+
+/**
+ * @brief 获取玩家所属组的快照，缓存未命中时从数据库获取并缓存。
+ * @param playerUuid 玩家的 UUID。
+ * @return 不可变的组列表快照，永不为空。
+ */
+std::shared_ptr<const PlayerGroupsSnapshot>
+PermissionManager::PermissionManagerImpl::getPlayerGroupsSnapshot(const std::string& playerUuid) {
+    return getPlayerGroupsSnapshot(internal::PlayerKey::fromString(playerUuid));
+}
+
+/**
+ * @brief 获取玩家所属组的快照（已解析的玩家键），缓存未命中时从数据库获取并缓存。
+ * @param player 玩家键。
+ * @return 不可变的组列表快照，永不为空。
+ */
+std::shared_ptr<const PlayerGroupsSnapshot>
+PermissionManager::PermissionManagerImpl::getPlayerGroupsSnapshot(const internal::PlayerKey& player) {
+    auto& metrics = internal::Metrics::getInstance();
     // 1. 检查缓存
-    auto cachedGroups = m_cache->findPlayerGroups(playerUuid);
-    if (cachedGroups) {
-        return *cachedGroups; // 缓存命中，直接返回
+    if (auto cached = m_cache->findPlayerGroups(player)) {
+        metrics.groupSnapshotHits.add();
+        return cached; // 缓存命中，直接返回
     }
     // 2. 缓存未命中，从数据库获取并存储到缓存
-    auto groupsFromDb = m_storage->fetchPlayerGroupsWithDetails(playerUuid);
-    m_cache->storePlayerGroups(playerUuid, groupsFromDb);
-    return groupsFromDb;
+    metrics.groupSnapshotMisses.add();
+    return buildPlayerGroupsSnapshot(player);
+}
+
+/**
+ * @brief 从数据库构建玩家的组列表快照并存入缓存。
+ * @param player 玩家键。
+ * @return 新构建的组列表快照。
+ */
+std::shared_ptr<const PlayerGroupsSnapshot>
+PermissionManager::PermissionManagerImpl::buildPlayerGroupsSnapshot(const internal::PlayerKey& player) {
+    internal::ScopedLatency timer(internal::Metrics::getInstance().groupRebuildLatency);
+    auto&                   tracer  = internal::Tracer::getInstance();
+    uint64_t                start   = tracer.enabled() ? internal::Tracer::now() : 0;
+    uint64_t                epoch   = m_cache->getGroupEpoch();
+    bool                    ok      = false;
+    auto                    details = m_storage->fetchPlayerGroupsWithDetails(player.toString(), &ok);
+    // 查询失败（例如连接断开）时的空结果不代表玩家没有任何组，不能缓存，下次访问重新查询
+    auto groups = buildPlayerGroupsSnapshot(player, epoch, std::move(details), ok);
+    if (start) {
+        tracer.recordPlayer(
+            internal::TraceEvent::GROUPS_REBUILD,
+            0,
+            player,
+            internal::Tracer::now() - start,
+            static_cast<uint32_t>(groups->size())
+        );
+    }
+    return groups;
+}
+
+/**
+ * @brief 用已读出的组详情构建玩家的组列表快照并存入缓存。
+ * @param player 玩家键。
+ * @param epoch 读取组详情之前的全局组纪元。
+ * @param details 玩家未过期的组详情。
+ * @param complete 组详情是否读取成功。
+ * @return 新构建的组列表快照。
+ */
+std::shared_ptr<const PlayerGroupsSnapshot> PermissionManager::PermissionManagerImpl::buildPlayerGroupsSnapshot(
+    const internal::PlayerKey& player,
+    uint64_t                   epoch,
+    std::vector<GroupDetails>  details,
+    bool                       complete
+) {
+    set<string> groupNames;
+    for (const auto& group : details) groupNames.insert(group.name);
+    auto generations = m_cache->captureGroupGenerations(groupNames);
+    auto groups      = std::make_shared<PlayerGroupsSnapshot>(std::move(details), epoch, std::move(generations));
+    groups->complete = complete;
+    // 构建期间有组被修改或读取失败时，数据可能已过期或不完整，只返回不缓存
+    if (complete && m_cache->getGroupEpoch() == epoch) {
+        m_cache->storePlayerGroups(player, groups);
+    }
+    return groups;
 }
 
 /**
@@ -801,9 +1442,10 @@ PermissionManager::PermissionManagerImpl::getPlayerGroupsWithPriorities(const st
  * @return 包含玩家所属组名称的向量。
  */
 std::vector<std::string> PermissionManager::PermissionManagerImpl::getPlayerGroups(const std::string& playerUuid) {
-    auto           details = getPlayerGroupsWithPriorities(playerUuid);
+    m_recorder->record(internal::RecordedOp::GET_PLAYER_GROUPS, {playerUuid});
+    auto           details = getPlayerGroupsSnapshot(playerUuid);
     vector<string> names;
-    transform(details.begin(), details.end(), back_inserter(names), [](const auto& d) { return d.name; });
+    transform(details->begin(), details->end(), back_inserter(names), [](const auto& d) { return d.name; });
     return names;
 }
 
@@ -813,9 +1455,9 @@ std::vector<std::string> PermissionManager::PermissionManagerImpl::getPlayerGrou
  * @return 包含玩家所属组 ID 的向量。
  */
 std::vector<std::string> PermissionManager::PermissionManagerImpl::getPlayerGroupIds(const std::string& playerUuid) {
-    auto           details = getPlayerGroupsWithPriorities(playerUuid);
+    auto           details = getPlayerGroupsSnapshot(playerUuid);
     vector<string> ids;
-    transform(details.begin(), details.end(), back_inserter(ids), [](const auto& d) { return d.id; });
+    transform(details->begin(), details->end(), back_inserter(ids), [](const auto& d) { return d.id; });
     return ids;
 }
 
@@ -825,11 +1467,26 @@ std::vector<std::string> PermissionManager::PermissionManagerImpl::getPlayerGrou
  * @return 包含组中所有玩家 UUID 的向量。
  */
 std::vector<std::string> PermissionManager::PermissionManagerImpl::getPlayersInGroup(const std::string& groupName) {
+    m_recorder->record(internal::RecordedOp::GET_PLAYERS_IN_GROUP, {groupName});
     string groupId = getCachedGroupId(groupName);
     if (groupId.empty()) return {}; // 组不存在
     return m_storage->fetchPlayersInGroup(groupId);
 }
 
+/**
+ * @brief 按玩家 UUID 排序分页获取组中的玩家 UUID。
+ * @param groupName 组名称。
+ * @param offset 跳过的玩家数。
+ * @param limit 最多返回的玩家数。
+ * @return 本页的玩家 UUID。
+ */
+std::vector<std::string>
+PermissionManager::PermissionManagerImpl::getPlayersInGroup(const std::string& groupName, size_t offset, size_t limit) {
+    string groupId = getCachedGroupId(groupName);
+    if (groupId.empty()) return {}; // 组不存在
+    return m_storage->fetchPlayersInGroup(groupId, offset, limit);
+}
+
 /**
  * @brief 获取玩家的所有有效权限（包括组权限和默认权限）。
  * @param playerUuid 玩家的 UUID。
@@ -837,88 +1494,154 @@ std::vector<std::string> PermissionManager::PermissionManagerImpl::getPlayersInG
  */
 std::vector<CompiledPermissionRule>
 PermissionManager::PermissionManagerImpl::getAllPermissionsForPlayer(const std::string& playerUuid) {
-    // 1. 检查缓存
-    auto cachedPerms = m_cache->findPlayerPermissions(playerUuid);
-    if (cachedPerms) {
-        return *cachedPerms; // 缓存命中，直接返回
+    m_recorder->record(internal::RecordedOp::GET_ALL_PERMISSIONS, {playerUuid});
+    auto player   = internal::PlayerKey::fromString(playerUuid);
+    auto snapshot = getPlayerPermissionSnapshot(player);
+    auto layer    = currentDefaultLayer();
+    // 合并结果只取决于快照与默认权限层，同一组合只合并、排序一次
+    if (auto cached = m_cache->findEffectiveRules(player, snapshot.get(), layer->version)) {
+        return *cached;
     }
 
-    // 2. 缓存未命中，计算权限
+    // 合并默认权限层与玩家快照，同名模式以组规则为准，结果与旧的单层快照一致
     map<string, bool> effectiveState;
-    // 2.1. 添加默认权限
-    // 尝试从缓存获取默认权限，如果未命中则从存储层获取并填充缓存
-    auto defaults = m_cache->getAllPermissionDefaults(); // 使用公共方法获取缓存
-    if (defaults.empty()) { // 如果缓存为空，则从存储层加载
-        m_cache->populateAllPermissionDefaults(m_storage->fetchAllPermissionDefaults());
-        defaults = m_cache->getAllPermissionDefaults(); // 重新获取填充后的缓存
+    for (const auto& rule : layer->rules.rules) {
+        effectiveState[rule.pattern] = true;
     }
-    for (const auto& [name, state] : defaults) {
-        if (state) {
-            effectiveState[name] = true;
-        }
+    for (const auto& rule : snapshot->rules) {
+        effectiveState[rule.pattern] = rule.state;
     }
+    auto rules = toRules(effectiveState);
+    PermissionRuleSnapshot::sortByPriority(rules);
+    m_cache->storeEffectiveRules(
+        player,
+        snapshot,
+        layer->version,
+        std::make_shared<const std::vector<CompiledPermissionRule>>(rules)
+    );
+    return rules;
+}
 
-    // 2.2. 获取所有相关组（直接所属和继承）及其权限
-    auto        playerGroups = getPlayerGroupsWithPriorities(playerUuid);
-    std::set<std::string> allRelevantGroupNames;
-    for (const auto& group : playerGroups) {
-        auto ancestors = m_cache->getAllAncestorGroups(group.name);
-        allRelevantGroupNames.insert(ancestors.begin(), ancestors.end());
-    }
-
-    // 批量获取所有相关组的详情
-    std::unordered_map<std::string, GroupDetails> allRelevantGroupsMap = m_storage->fetchGroupDetailsByNames(allRelevantGroupNames);
-    std::vector<GroupDetails>                allRelevantGroupsDetails;
-    std::vector<std::string>                 allRelevantGroupIds; // 用于批量查询权限
-    for (const auto& name : allRelevantGroupNames) {
-        auto it = allRelevantGroupsMap.find(name);
-        if (it != allRelevantGroupsMap.end()) {
-            allRelevantGroupsDetails.push_back(it->second);
-            allRelevantGroupIds.push_back(it->second.id);
-        }
+/**
+ * @brief 获取当前的默认权限层，默认权限尚未加载时先从存储层加载。
+ * @return 默认权限层，永不为空。
+ */
+std::shared_ptr<const DefaultPermissionLayer> PermissionManager::PermissionManagerImpl::currentDefaultLayer() {
+    if (!m_cache->permissionDefaultsLoaded()) {
+        m_cache->populateAllPermissionDefaults(m_storage->fetchAllPermissionDefaults());
     }
+    return m_cache->getDefaultLayer();
+}
 
-    // 根据优先级对所有相关组进行排序
-    std::sort(allRelevantGroupsDetails.begin(), allRelevantGroupsDetails.end(), [](const auto& a, const auto& b) {
-        return a.priority < b.priority;
-    });
+/**
+ * @brief 获取玩家的权限快照，缓存未命中时构建并缓存。
+ * @param playerUuid 玩家的 UUID。
+ * @return 不可变的权限快照，永不为空。
+ */
+std::shared_ptr<const PlayerPermissionSnapshot>
+PermissionManager::PermissionManagerImpl::getPlayerPermissionSnapshot(const std::string& playerUuid) {
+    return getPlayerPermissionSnapshot(internal::PlayerKey::fromString(playerUuid));
+}
 
-    // 批量获取所有相关组的直接权限
-    std::unordered_map<std::string, std::vector<std::string>> allDirectPermissions =
-        m_storage->fetchDirectPermissionsOfGroups(allRelevantGroupIds);
+/**
+ * @brief 获取玩家的权限快照（已解析的玩家键），缓存未命中时构建并缓存。
+ * @param player 玩家键。
+ * @return 不可变的权限快照，永不为空。
+ */
+std::shared_ptr<const PlayerPermissionSnapshot>
+PermissionManager::PermissionManagerImpl::getPlayerPermissionSnapshot(const internal::PlayerKey& player) {
+    auto& metrics = internal::Metrics::getInstance();
+    // 1. 检查缓存
+    if (auto cached = m_cache->findPlayerPermissions(player)) {
+        metrics.permissionSnapshotHits.add();
+        return cached; // 缓存命中，直接返回
+    }
 
-    // 应用组权限
-    for (const auto& group : allRelevantGroupsDetails) {
-        auto it = allDirectPermissions.find(group.id);
-        if (it != allDirectPermissions.end()) {
-            const auto& rules = it->second;
-            for (const auto& rule : rules) {
-                bool        isNegated = rule.starts_with("-");
-                std::string baseName  = isNegated ? rule.substr(1) : rule;
-                if (baseName.empty()) continue;
-                effectiveState[baseName] = !isNegated;
-            }
-        }
+    // 2. 缓存未命中，计算权限
+    metrics.permissionSnapshotMisses.add();
+    // 纪元必须在读取玩家组之前获取，这样组信息在构建期间被修改时也能被发现
+    uint64_t epoch = m_cache->getGroupEpoch();
+    return buildPlayerPermissionSnapshot(player, epoch, *getPlayerGroupsSnapshot(player));
+}
+
+/**
+ * @brief 在后台重建玩家的组列表与权限快照，并原子替换缓存中的旧快照。
+ *        由失效工作线程在 refresh-ahead 模式下调用，重建完成前旧快照继续生效。
+ * @param player 玩家键。
+ */
+void PermissionManager::PermissionManagerImpl::refreshPlayer(const internal::PlayerKey& player) {
+    uint64_t epoch  = m_cache->getGroupEpoch();
+    auto     groups = buildPlayerGroupsSnapshot(player);
+    buildPlayerPermissionSnapshot(player, epoch, *groups); // 存储即替换，决策缓存随快照指针变化自动作废
+}
+
+/**
+ * @brief 根据玩家所属组构建权限快照并存入缓存。
+ * @param player 玩家键。
+ * @param epoch 开始构建（读取玩家组）之前的全局组纪元。
+ * @param playerGroups 玩家所属组。
+ * @return 新构建的权限快照。
+ */
+std::shared_ptr<const PlayerPermissionSnapshot> PermissionManager::PermissionManagerImpl::buildPlayerPermissionSnapshot(
+    const internal::PlayerKey&  player,
+    uint64_t                    epoch,
+    const PlayerGroupsSnapshot& playerGroups
+) {
+    internal::ScopedLatency timer(internal::Metrics::getInstance().permissionRebuildLatency);
+    auto&                   tracer = internal::Tracer::getInstance();
+    uint64_t                start  = tracer.enabled() ? internal::Tracer::now() : 0;
+    // 构建期间的临时容器都从栈上的缓冲区分配，超出时才回退到全局 operator new（即 LeviLamina 的分配器），
+    // 函数返回时一次释放；规则集命中驻留表时，整个重建只为快照本身和组代数各分配一次
+    std::array<std::byte, 16 * 1024>    buffer;
+    std::pmr::monotonic_buffer_resource arena(buffer.data(), buffer.size());
+
+    // 默认权限由共享的 DefaultPermissionLayer 提供，快照中只保存组规则。
+    // 每个直接所属组的权限层已包含其祖先的规则与优先级，归并各层即得到玩家的规则，
+    // 组权限层都已缓存时不访问存储层
+    std::pmr::vector<std::shared_ptr<const GroupPermissionSnapshot>> layers(&arena);
+    layers.reserve(playerGroups.size());
+    for (const auto& group : playerGroups) {
+        layers.push_back(getGroupPermissionSnapshot(group.name));
     }
+    std::pmr::vector<const CompiledPermissionRule*> rules(&arena);
+    GroupPermissionSnapshot::merge(layers, rules);
 
-    // 将有效权限转换为编译后的权限规则
-    std::vector<CompiledPermissionRule> finalPerms;
-    for (const auto& [pattern, state] : effectiveState) {
-        try {
-            finalPerms.emplace_back(pattern, wildcardToRegex(pattern), state);
-        } catch (const std::regex_error& e) {
-            ::ll::mod::NativeMod::current()->getLogger().error("权限模式 ", pattern, e.what());
+    // 快照依赖所有相关组（直接所属和继承）的代数；图在快照构建完成前保持存活，组名可以直接引用
+    auto                              graph = m_cache->getGroupGraph();
+    std::pmr::vector<std::string_view> allRelevantGroupNames(&arena);
+    for (const auto& group : playerGroups) {
+        internal::GroupId id = graph->find(group.name);
+        if (id == internal::GroupGraph::INVALID_GROUP) {
+            allRelevantGroupNames.push_back(group.name); // 没有任何继承关系的组
+            continue;
+        }
+        for (internal::GroupId ancestor : graph->ancestorsOf(id)) {
+            allRelevantGroupNames.push_back(graph->nameOf(ancestor));
         }
     }
+    std::sort(allRelevantGroupNames.begin(), allRelevantGroupNames.end());
+    allRelevantGroupNames.erase(
+        std::unique(allRelevantGroupNames.begin(), allRelevantGroupNames.end()),
+        allRelevantGroupNames.end()
+    );
 
-    // 根据模式长度对权限进行排序（长模式优先）
-    std::sort(finalPerms.begin(), finalPerms.end(), [](const auto& a, const auto& b) {
-        return a.pattern.length() > b.pattern.length();
-    });
-
-    // 3. 存储到缓存并返回
-    m_cache->storePlayerPermissions(playerUuid, finalPerms);
-    return finalPerms;
+    // 构建快照，存储到缓存并返回
+    // 快照记录所依赖组的代数，组被修改后下次查找即视为过期
+    auto generations = m_cache->captureGroupGenerations(allRelevantGroupNames);
+    auto ruleCount   = static_cast<uint32_t>(rules.size());
+    auto snapshot    = std::make_shared<const PlayerPermissionSnapshot>(
+        std::span<const CompiledPermissionRule*>(rules),
+        epoch,
+        std::move(generations)
+    );
+    // 构建期间有组被修改或玩家组读取失败时，读到的数据可能已过期或不完整，只返回不缓存
+    if (playerGroups.complete && m_cache->getGroupEpoch() == epoch) {
+        m_cache->storePlayerPermissions(player, snapshot);
+    }
+    if (start) {
+        tracer.recordPlayer(internal::TraceEvent::PERMISSIONS_REBUILD, 0, player, internal::Tracer::now() - start, ruleCount);
+    }
+    return snapshot;
 }
 
 /**
@@ -931,18 +1654,195 @@ bool PermissionManager::PermissionManagerImpl::hasPermission(
     const std::string& playerUuid,
     const std::string& permissionNode
 ) {
-    auto rules = getAllPermissionsForPlayer(playerUuid);
-    for (const auto& rule : rules) {
-        if (regex_match(permissionNode, rule.regex)) {
-            return rule.state; // 匹配到规则，返回其状态
+    auto&                   metrics = internal::Metrics::getInstance();
+    internal::ScopedLatency timer(metrics.sampleCheck());
+    metrics.checks.add();
+    auto player   = internal::PlayerKey::fromString(playerUuid); // 只解析一次，之后的查找都只哈希 16 字节
+    auto snapshot = getPlayerPermissionSnapshot(player);
+    auto layer    = currentDefaultLayer();
+    // 先查决策缓存，命中时连匹配都不需要
+    bool result;
+    if (auto memo = m_cache->findDecision(player, snapshot.get(), layer->version, permissionNode)) {
+        metrics.decisionHits.add();
+        result = *memo;
+    } else {
+        metrics.decisionMisses.add();
+        result = evaluatePermission(*snapshot, *layer, permissionNode);
+        m_cache->storeDecision(player, snapshot, layer->version, permissionNode, result);
+    }
+    if (m_recorder->active()) m_recorder->record(internal::RecordedOp::HAS_PERMISSION, {playerUuid, permissionNode}, result);
+    return result;
+}
+
+/**
+ * @brief 按权限ID检查玩家是否拥有某个权限。
+ *        结果位集保存在玩家快照中，命中时只需查找一次快照、读取默认权限版本并测试一位。
+ *        位集覆盖计算时已分配的全部ID，之后新分配的ID会触发一次重新计算。
+ *        计算位集时不回退到存储层：缓存中没有默认值的节点按默认拒绝处理。
+ * @param playerUuid 玩家的 UUID。
+ * @param permission 权限ID。
+ * @return 如果玩家拥有该权限则返回 true；ID 无效时返回 false。
+ */
+bool PermissionManager::PermissionManagerImpl::hasPermission(const std::string& playerUuid, PermissionId permission) {
+    auto&                   metrics = internal::Metrics::getInstance();
+    internal::ScopedLatency timer(metrics.sampleCheck());
+    metrics.checks.add();
+    auto player   = internal::PlayerKey::fromString(playerUuid);
+    auto snapshot = getPlayerPermissionSnapshot(player);
+    bool result;
+    if (auto bit = snapshot->testPermission(permission, m_cache->getDefaultsVersion())) {
+        metrics.decisionHits.add();
+        result = *bit;
+    } else {
+        metrics.decisionMisses.add();
+        auto names = m_registry->names();
+        if (permission >= names->size()) return false; // 未分配的ID
+        auto layer    = currentDefaultLayer();
+        auto computed = std::make_shared<PermissionBits>(names->size(), layer->version);
+        for (PermissionId id = 0; id < names->size(); ++id) {
+            // 不为每个未写入数据库的节点查询一次数据库，它们按默认拒绝处理
+            if (evaluatePermission(*snapshot, *layer, (*names)[id], false)) computed->set(id);
+        }
+        result = computed->test(permission);
+        snapshot->publishPermissionBits(std::move(computed));
+    }
+    if (m_recorder->active()) {
+        // 录制节点名而不是ID，ID 只在本进程内有效
+        auto names = m_registry->names();
+        if (permission < names->size()) {
+            m_recorder->record(internal::RecordedOp::HAS_PERMISSION_ID, {playerUuid, (*names)[permission]}, result);
         }
     }
+    return result;
+}
+
+/**
+ * @brief 一次检查玩家的多个权限节点。
+ * @param playerUuid 玩家的 UUID。
+ * @param permissionNodes 要检查的权限节点。
+ * @return 与 permissionNodes 一一对应的结果。
+ */
+std::vector<bool> PermissionManager::PermissionManagerImpl::hasPermissions(
+    const std::string&           playerUuid,
+    std::span<const std::string> permissionNodes
+) {
+    std::vector<bool> results(permissionNodes.size(), false);
+    if (permissionNodes.empty()) return results;
+    if (m_recorder->active()) {
+        m_recorder->record(
+            internal::RecordedOp::HAS_PERMISSIONS,
+            playerUuid,
+            std::vector<std::string_view>(permissionNodes.begin(), permissionNodes.end())
+        );
+    }
+
+    auto player   = internal::PlayerKey::fromString(playerUuid);
+    auto snapshot = getPlayerPermissionSnapshot(player);
+    auto layer    = currentDefaultLayer();
+    // 决策缓存只查一次、存一次，各自只加一次锁
+    auto                memos = m_cache->findDecisions(player, snapshot.get(), layer->version, permissionNodes);
+    std::vector<size_t> computed;
+    for (size_t i = 0; i < permissionNodes.size(); ++i) {
+        if (memos[i]) {
+            results[i] = *memos[i];
+            continue;
+        }
+        results[i] = evaluatePermission(*snapshot, *layer, permissionNodes[i]);
+        computed.push_back(i);
+    }
+    auto& metrics = internal::Metrics::getInstance();
+    metrics.checks.add(permissionNodes.size());
+    metrics.decisionHits.add(permissionNodes.size() - computed.size());
+    metrics.decisionMisses.add(computed.size());
+    if (!computed.empty()) {
+        std::vector<std::pair<std::string, bool>> decisions;
+        decisions.reserve(computed.size());
+        for (size_t i : computed) decisions.emplace_back(permissionNodes[i], results[i]);
+        m_cache->storeDecisions(player, snapshot, layer->version, decisions);
+    }
+    return results;
+}
+
+/**
+ * @brief 从一组玩家中筛选出拥有某个权限节点的玩家。
+ * @param playerUuids 候选玩家的 UUID。
+ * @param permissionNode 要检查的权限节点。
+ * @return 拥有该权限的玩家 UUID，保持输入顺序。
+ */
+std::vector<std::string> PermissionManager::PermissionManagerImpl::filterPlayersWithPermission(
+    std::span<const std::string> playerUuids,
+    const std::string&           permissionNode
+) {
+    std::vector<std::string> allowed;
+    auto                     layer   = currentDefaultLayer(); // 所有玩家共用同一个默认权限层
+    auto&                    metrics = internal::Metrics::getInstance();
+    metrics.checks.add(playerUuids.size());
+    for (const auto& playerUuid : playerUuids) {
+        auto player   = internal::PlayerKey::fromString(playerUuid);
+        auto snapshot = getPlayerPermissionSnapshot(player);
+        bool result;
+        if (auto memo = m_cache->findDecision(player, snapshot.get(), layer->version, permissionNode)) {
+            metrics.decisionHits.add();
+            result = *memo;
+        } else {
+            metrics.decisionMisses.add();
+            result = evaluatePermission(*snapshot, *layer, permissionNode);
+            m_cache->storeDecision(player, snapshot, layer->version, permissionNode, result);
+        }
+        if (result) allowed.push_back(playerUuid);
+    }
+    return allowed;
+}
+
+/**
+ * @brief 获取拥有某个权限节点的在线（已固定）玩家。
+ *        节点第一次被查询时对所有在线玩家计算一次并加入索引，之后只返回索引中的结果；
+ *        玩家快照被重建或失效、默认权限变化时索引随之更新。
+ * @param permissionNode 要检查的权限节点。
+ * @return 拥有该权限的在线玩家 UUID，顺序不固定。
+ */
+std::vector<std::string>
+PermissionManager::PermissionManagerImpl::getOnlinePlayersWithPermission(const std::string& permissionNode) {
+    m_recorder->record(internal::RecordedOp::ONLINE_PLAYERS_WITH_PERMISSION, {permissionNode});
+    std::vector<std::string> result;
+    if (!m_onlineIndex) return result;
+    auto players = m_onlineIndex->query(permissionNode);
+    result.reserve(players.size());
+    for (const auto& player : players) result.push_back(player.toString());
+    return result;
+}
+
+/**
+ * @brief 在快照和默认权限层上计算权限节点的最终结果（包括回退到默认值）。
+ * @param snapshot 玩家权限快照。
+ * @param defaultLayer 默认权限层。
+ * @param permissionNode 要检查的权限节点。
+ * @return 最终结果。
+ */
+bool PermissionManager::PermissionManagerImpl::evaluatePermission(
+    const PlayerPermissionSnapshot& snapshot,
+    const DefaultPermissionLayer&   defaultLayer,
+    const std::string&              permissionNode,
+    bool                            allowStorageFallback
+) {
+    // 两层分别匹配，再按合并后的优先级取胜者：长模式优先，等长时同名以组规则为准，否则按字典序
+    const CompiledPermissionRule* groupRule   = snapshot.find(permissionNode);
+    const CompiledPermissionRule* defaultRule = defaultLayer.rules.find(permissionNode);
+    if (groupRule && defaultRule) {
+        const auto& g = groupRule->pattern;
+        const auto& d = defaultRule->pattern;
+        bool groupWins = g.size() != d.size() ? g.size() > d.size() : (g == d || g < d);
+        return groupWins ? groupRule->state : defaultRule->state;
+    }
+    if (groupRule) return groupRule->state;
+    if (defaultRule) return defaultRule->state;
 
     // 如果没有匹配到特定规则，则回退到权限的默认值
     auto defaultValue = m_cache->findPermissionDefault(permissionNode);
     if (defaultValue) {
         return *defaultValue; // 缓存中找到默认值
     }
+    if (!allowStorageFallback) return false;
 
     // 如果缓存中没有，则双重检查数据库（这种情况应该很少发生）
     auto defaults = m_storage->fetchAllPermissionDefaults();
@@ -966,17 +1866,27 @@ size_t PermissionManager::PermissionManagerImpl::addPlayerToGroups(
     const std::vector<std::string>& groupNames
 ) {
     if (groupNames.empty()) return 0;
-    vector<pair<string, string>> groupInfos;
+    std::vector<event::PlayerGroupChange> changes;
     for (const auto& name : groupNames) {
-        string id = getCachedGroupId(name);
+        if (!getCachedGroupId(name).empty()) changes.push_back({playerUuid, name, std::nullopt, true});
+    }
+    if (!confirmPlayerGroupChanges(changes)) return 0;
+
+    // 监听器只能删除条目，剩下条目的组名重新解析
+    vector<pair<string, string>> groupInfos;
+    for (const auto& change : changes) {
+        string id = getCachedGroupId(change.groupName);
         if (!id.empty()) {
-            groupInfos.emplace_back(name, id);
+            groupInfos.emplace_back(change.groupName, id);
         }
     }
+    if (groupInfos.empty()) return 0;
+    flushPendingWrites(); // 先让写回队列中更早的修改生效
     size_t count = m_storage->addPlayerToGroups(playerUuid, groupInfos);
     if (count > 0) {
         // 玩家组关系修改后，需要使该玩家的权限缓存失效
         m_invalidator->enqueueTask({CacheInvalidationTaskType::PLAYER_GROUP_CHANGED, playerUuid});
+        publishPlayerGroupChanges(changes); // 整批在同一事务中写入
     }
     return count;
 }
@@ -992,26 +1902,43 @@ size_t PermissionManager::PermissionManagerImpl::removePlayerFromGroups(
     const std::vector<std::string>& groupNames
 ) {
     if (groupNames.empty()) return 0;
-    vector<string> groupIds;
+    std::vector<event::PlayerGroupChange> changes;
     for (const auto& name : groupNames) {
-        string id = getCachedGroupId(name);
+        if (!getCachedGroupId(name).empty()) changes.push_back({playerUuid, name, std::nullopt, false});
+    }
+    if (!confirmPlayerGroupChanges(changes)) return 0;
+
+    vector<string> groupIds;
+    for (const auto& change : changes) {
+        string id = getCachedGroupId(change.groupName);
         if (!id.empty()) {
             groupIds.push_back(id);
         }
     }
+    if (groupIds.empty()) return 0;
+    flushPendingWrites(); // 先让写回队列中更早的修改生效
     size_t count = m_storage->removePlayerFromGroups(playerUuid, groupIds);
     if (count > 0) {
         // 玩家组关系修改后，需要使该玩家的权限缓存失效
         m_invalidator->enqueueTask({CacheInvalidationTaskType::PLAYER_GROUP_CHANGED, playerUuid});
+        for (const auto& groupId : groupIds) m_expiryQueue->cancel(playerUuid, groupId);
+        publishPlayerGroupChanges(changes); // 整批在同一事务中写入
     }
     return count;
 }
 
 // 新增清理方法
 void PermissionManager::PermissionManagerImpl::runPeriodicCleanup() {
+    auto&                   metrics = internal::Metrics::getInstance();
+    internal::ScopedLatency timer(metrics.cleanupLatency);
+    metrics.cleanupRuns.add();
     auto& logger = ::ll::mod::NativeMod::current()->getLogger();
     logger.debug("正在运行定期的权限清理任务...");
+    flushPendingWrites(); // 先让写回队列中更早的修改生效
     std::vector<std::string> affectedPlayers = m_storage->deleteExpiredPlayerGroups();
+    metrics.expiredMemberships.add(affectedPlayers.size());
+    // 顺带补上其他实例或直接修改数据库添加的临时组关系
+    m_expiryQueue->merge(m_storage->fetchPlayerGroupExpirations());
     if (!affectedPlayers.empty()) {
         logger.debug("权限清理任务完成。已删除 {} 条过期记录，并使受影响玩家的缓存失效。", affectedPlayers.size());
         for (const auto& playerUuid : affectedPlayers) {
@@ -1021,6 +1948,231 @@ void PermissionManager::PermissionManagerImpl::runPeriodicCleanup() {
         logger.debug("权限清理任务：没有过期的记录需要删除。");
     }
 }
+
+/**
+ * @brief 删除到期队列中已到期的玩家组关系，并使受影响玩家的缓存失效。
+ * @return 处理的 (玩家, 组) 数量。
+ */
+size_t PermissionManager::PermissionManagerImpl::processDueExpirations() {
+    flushPendingWrites(); // 先让写回队列中更早的修改生效，它们可能改变过期时间
+    long long now =
+        std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+    auto due = m_expiryQueue->popDue(now);
+    if (due.empty()) return 0;
+    auto&                   metrics = internal::Metrics::getInstance(); // 只统计真正删除了关系的到期处理
+    internal::ScopedLatency timer(metrics.cleanupLatency);
+    metrics.cleanupRuns.add();
+    if (!m_storage->deleteExpiredPlayerGroups(due, now)) {
+        // 放回队列，等待下次重试
+        ::ll::mod::NativeMod::current()->getLogger().warn("删除 {} 条到期的玩家组关系失败，稍后重试。", due.size());
+        for (const auto& [playerUuid, groupId] : due) m_expiryQueue->schedule(playerUuid, groupId, now + 5);
+        return 0;
+    }
+    metrics.expiredMemberships.add(due.size());
+    std::set<std::string> players;
+    for (const auto& key : due) players.insert(key.first);
+    CacheInvalidationTask task{CacheInvalidationTaskType::PLAYER_BATCH_GROUP_CHANGED, ""};
+    task.players.assign(players.begin(), players.end());
+    m_invalidator->enqueueTask(std::move(task));
+    internal::Tracer::getInstance().record(internal::TraceEvent::EXPIRY_APPLIED, 0, 0, static_cast<uint32_t>(due.size()));
+    return due.size();
+}
+
+/**
+ * @brief 获取到期队列中最早的过期时间。
+ * @return Unix 时间戳（秒）；没有带过期时间的玩家组关系时返回 std::nullopt。
+ */
+std::optional<long long> PermissionManager::PermissionManagerImpl::getNextExpiration() {
+    return m_expiryQueue->nextDeadline();
+}
+
+/**
+ * @brief 设置最早的过期时间提前时调用的回调。
+ * @param handler 回调，传入空函数表示清除。
+ */
+void PermissionManager::PermissionManagerImpl::setExpirationWakeHandler(std::function<void()> handler) {
+    m_expiryQueue->setWakeHandler(std::move(handler));
+}
+
+/**
+ * @brief 固定玩家的缓存，使其不会被淘汰。
+ * @param playerUuid 玩家的 UUID。
+ */
+void PermissionManager::PermissionManagerImpl::pinPlayer(const std::string& playerUuid) {
+    m_recorder->record(internal::RecordedOp::PLAYER_ONLINE, {playerUuid}, 0);
+    pinOnlinePlayer(playerUuid);
+}
+
+/**
+ * @brief 固定玩家的缓存、加入在线索引并记录上线时间。
+ * @param playerUuid 玩家的 UUID。
+ */
+void PermissionManager::PermissionManagerImpl::pinOnlinePlayer(const std::string& playerUuid) {
+    auto player = internal::PlayerKey::fromString(playerUuid);
+    m_cache->pinPlayer(player);
+    m_onlineIndex->addPlayer(player);
+    if (!m_initialized) return;
+    // 记录上线时间，供下次启动时预热最近活跃的玩家；写入在 I/O 线程中进行
+    long long now =
+        std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+    postIo([this, playerUuid, now] { m_storage->touchPlayerLastSeen(playerUuid, now); });
+}
+
+/**
+ * @brief 取消固定玩家的缓存。
+ * @param playerUuid 玩家的 UUID。
+ */
+void PermissionManager::PermissionManagerImpl::unpinPlayer(const std::string& playerUuid) {
+    m_recorder->record(internal::RecordedOp::PLAYER_OFFLINE, {playerUuid});
+    auto player = internal::PlayerKey::fromString(playerUuid);
+    m_cache->unpinPlayer(player);
+    m_onlineIndex->removePlayer(player);
+}
+
+/**
+ * @brief 固定玩家的缓存，并在 I/O 线程中预先载入其组与权限快照。
+ * @param playerUuid 玩家的 UUID。
+ */
+void PermissionManager::PermissionManagerImpl::prefetchPlayer(const std::string& playerUuid) {
+    m_recorder->record(internal::RecordedOp::PLAYER_ONLINE, {playerUuid}, 1);
+    pinOnlinePlayer(playerUuid);
+    if (!m_initialized) return;
+    // 已缓存时只是一次查找；未缓存时在 I/O 线程中构建，游戏线程随后的检查直接命中
+    postIo([this, playerUuid] { getPlayerPermissionSnapshot(playerUuid); });
+}
+
+/**
+ * @brief 获取玩家缓存统计。
+ * @return 缓存统计。
+ */
+CacheStats PermissionManager::PermissionManagerImpl::getCacheStats() { return m_cache->getStats(); }
+
+/**
+ * @brief 以 Prometheus 文本格式导出运行时指标。
+ * @return 指标文本。
+ */
+std::string PermissionManager::PermissionManagerImpl::getMetricsText() {
+    return internal::Metrics::getInstance().renderPrometheus(m_cache->getStats());
+}
+
+/**
+ * @brief 获取运行时指标的可读摘要。
+ * @return 摘要，每个元素为一行。
+ */
+std::vector<std::string> PermissionManager::PermissionManagerImpl::getStatsSummary() {
+    return internal::Metrics::getInstance().renderSummary(m_cache->getStats());
+}
+
+/**
+ * @brief 对热点存储语句执行 EXPLAIN。
+ * @return 架构版本与每条语句的查询计划，每个元素为一行。
+ */
+std::vector<std::string> PermissionManager::PermissionManagerImpl::explainHotQueries() {
+    if (!m_storage) return {};
+    std::vector<std::string> lines;
+    auto                     version = m_storage->fetchSchemaVersion();
+    lines.push_back(
+        "架构版本: " + (version ? std::to_string(*version) : std::string("未知")) + " (当前代码: "
+        + std::to_string(internal::PermissionStorage::SCHEMA_VERSION) + ")"
+    );
+    for (const auto& plan : m_storage->explainHotStatements()) {
+        lines.push_back("[" + plan.name + "] " + plan.sql);
+        if (plan.lines.empty()) lines.push_back("  (EXPLAIN 执行失败)");
+        for (const auto& line : plan.lines) lines.push_back("  " + line);
+    }
+    return lines;
+}
+
+/**
+ * @brief 开始录制 API 调用。
+ * @param path 录制文件路径。
+ * @param sampleRate 检查与查询的抽样率。
+ * @param maxBytes 文件大小上限，0 表示不限制。
+ * @return 无法创建文件时返回 false。
+ */
+bool PermissionManager::PermissionManagerImpl::startCallRecording(
+    const std::string& path,
+    double             sampleRate,
+    uint64_t           maxBytes
+) {
+    return m_recorder->start(std::filesystem::u8path(path), sampleRate, maxBytes);
+}
+
+/**
+ * @brief 停止录制 API 调用。
+ * @return 本次录制的统计。
+ */
+CallRecordingStats PermissionManager::PermissionManagerImpl::stopCallRecording() { return m_recorder->stop(); }
+
+/**
+ * @brief 获取当前或上一次录制的统计。
+ * @return 录制统计。
+ */
+CallRecordingStats PermissionManager::PermissionManagerImpl::getCallRecordingStats() { return m_recorder->stats(); }
+
+/**
+ * @brief 导出追踪缓冲区中最近的记录。
+ * @param maxRecords 最多导出的记录数，0 表示全部。
+ * @return 格式化后的记录，每个元素为一行，按时间排序。
+ */
+std::vector<std::string> PermissionManager::PermissionManagerImpl::dumpTrace(size_t maxRecords) {
+    auto records = internal::Tracer::getInstance().snapshot(maxRecords);
+    // 记录中只有组名与权限名的哈希，用当前的名称反查
+    auto names       = m_storage->fetchAllGroupNames();
+    auto permissions = m_storage->fetchAllPermissionNames();
+    names.insert(names.end(), permissions.begin(), permissions.end());
+    return internal::Tracer::format(records, names);
+}
+
+/**
+ * @brief 把整个权限数据集流式导出为 NDJSON。
+ * @param sink 接收输出块，返回 false 时停止导出。
+ * @return 导出统计。
+ */
+TransferStats PermissionManager::PermissionManagerImpl::exportData(const std::function<bool(std::string_view)>& sink) {
+    flushPendingWrites(); // 先让写回队列中更早的修改生效
+    return internal::exportDataset(*m_storage, sink);
+}
+
+/**
+ * @brief 从 NDJSON 流导入数据集。
+ *        各批次直接写入存储层，不经过逐条修改的接口，因此既不触发 Before/After 事件，也不逐条失效缓存；
+ *        全部写入后组结构有变化时一次性重建组相关缓存，玩家组关系合并为一个失效任务。
+ *        中途某批失败时，已提交的批次保留，缓存同样按已提交的部分刷新。
+ * @param read 向缓冲区读入最多 size 字节并返回读入的字节数，返回 0 表示输入结束。
+ * @return 导入统计。
+ */
+TransferStats PermissionManager::PermissionManagerImpl::importData(const std::function<size_t(char*, size_t)>& read) {
+    flushPendingWrites(); // 先让写回队列中更早的修改生效
+
+    internal::DatasetImporter importer(*m_storage);
+    std::vector<char>         buffer(64 * 1024);
+    while (true) {
+        size_t bytes = read(buffer.data(), buffer.size());
+        if (bytes == 0 || !importer.feed(std::string_view(buffer.data(), bytes))) break;
+    }
+    TransferStats stats = importer.finish();
+
+    if (stats.permissions + stats.groups + stats.inheritance + stats.rules > 0) {
+        populateAllCaches(0); // 重新载入组名表、继承、默认值并重建所有组的权限快照
+        for (const auto& name : m_storage->fetchAllPermissionNames()) m_registry->resolve(name);
+        // 组的优先级与规则可能都变了：玩家组快照按代数失效，玩家权限快照全部失效
+        m_cache->bumpAllGroupGenerations();
+        m_cache->invalidateAllPlayerPermissions();
+        m_invalidator->publish({CacheInvalidationTaskType::ALL_GROUPS_MODIFIED, ""});
+        m_invalidator->publish({CacheInvalidationTaskType::PERMISSION_DEFAULT_CHANGED, ""});
+    }
+    if (!importer.players().empty()) {
+        for (const auto& expiry : importer.expirations()) {
+            m_expiryQueue->schedule(expiry.playerUuid, expiry.groupId, expiry.expiryTimestamp);
+        }
+        CacheInvalidationTask task{CacheInvalidationTaskType::PLAYER_BATCH_GROUP_CHANGED, ""};
+        task.players.assign(importer.players().begin(), importer.players().end());
+        m_invalidator->enqueueTask(std::move(task));
+    }
+    return stats;
+}
+
 /**
  * @brief 获取玩家在某个权限组中的身份过期时间。
  * @param playerUuid 玩家的 UUID。
@@ -1031,9 +2183,9 @@ std::optional<long long> PermissionManager::PermissionManagerImpl::getPlayerGrou
     const std::string& playerUuid,
     const std::string& groupName
 ) {
-    // 利用现有缓存机制，getPlayerGroupsWithPriorities 现在会返回带有过期时间的数据
-    auto playerGroups = getPlayerGroupsWithPriorities(playerUuid);
-    for (const auto& groupDetails : playerGroups) {
+    // 利用现有缓存机制，组快照中带有过期时间的数据
+    auto playerGroups = getPlayerGroupsSnapshot(playerUuid);
+    for (const auto& groupDetails : *playerGroups) {
         if (groupDetails.name == groupName) {
             return groupDetails.expirationTime; // 直接返回缓存的过期时间
         }
@@ -1067,9 +2219,11 @@ bool PermissionManager::PermissionManagerImpl::setPlayerGroupExpirationTime(
     }
 
     // 调用存储层更新
+    flushPendingWrites(); // 先让写回队列中更早的修改生效
     if (m_storage->updatePlayerGroupExpirationTime(playerUuid, groupId, expiryTimestamp)) {
         // 更新成功后，使该玩家的缓存失效，以便下次获取时能得到最新数据
         m_invalidator->enqueueTask({CacheInvalidationTaskType::PLAYER_GROUP_CHANGED, playerUuid});
+        m_expiryQueue->schedule(playerUuid, groupId, expiryTimestamp);
         return true;
     }
 
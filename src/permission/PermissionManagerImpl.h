@@ -1,10 +1,23 @@
 #pragma once
 
+#include "permission/GroupGraph.h"
 #include "permission/PermissionData.h"  
 #include "permission/PermissionManager.h" 
+#include "permission/PermissionOptions.h"
+#include "permission/PermissionSnapshot.h"
+#include "permission/PlayerKey.h"
+#include <exception>
+#include <functional>
+#include <future>
+#include <map>
 #include <memory>                       
-#include <regex>                          
+#include <mutex>
+#include <optional>
+#include <set>
+#include <span>
 #include <string>                         
+#include <string_view>
+#include <unordered_map>
 #include <vector>                         
 
 
@@ -17,7 +30,18 @@ namespace internal {
 class PermissionStorage;     
 class PermissionCache;       
 class AsyncCacheInvalidator; 
+class WriteBehindQueue;
+class IoExecutor;
+class ExpiryQueue;
+class ClusterInvalidator;
+class PermissionRegistry;
+class OnlinePermissionIndex;
+class CallRecorder;
+struct AppliedPlayerGroupMutation;
 } // namespace internal
+namespace event {
+struct PlayerGroupChange; // 批量事件中的一条玩家组关系修改
+} // namespace event
 } // namespace permission
 } // namespace BA
 
@@ -39,11 +63,10 @@ public:
     /**
      * @brief 初始化权限管理器实现。
      * @param db 数据库接口指针。
-     * @param enableWarmup 是否启用预热缓存。
-     * @param threadPoolSize 线程池大小。
+     * @param options 运行参数（预热、线程池、缓存容量等）。
      * @return 如果初始化成功则返回 true，否则返回 false。
      */
-    bool init(db::IDatabase* db, bool enableWarmup, unsigned int threadPoolSize);
+    bool init(db::IDatabase* db, const PermissionOptions& options);
     /**
      * @brief 关闭权限管理器实现。
      */
@@ -58,6 +81,12 @@ public:
      * @return 如果注册成功则返回 true，否则返回 false。
      */
     bool registerPermission(const std::string& name, const std::string& description, bool defaultValue);
+    /**
+     * @brief 获取权限节点的整数ID，尚未分配时分配一个新的。
+     * @param name 权限节点名。
+     * @return 权限ID。
+     */
+    PermissionId resolvePermission(const std::string& name);
     /**
      * @brief 检查权限是否存在。
      * @param name 权限名称。
@@ -142,6 +171,12 @@ public:
      * @return 包含编译后的权限规则的向量。
      */
     std::vector<CompiledPermissionRule> getPermissionsOfGroup(const std::string& groupName);
+    /**
+     * @brief 获取组的不可变权限快照（包括继承的权限）。
+     * @param groupName 组名称。
+     * @return 权限快照指针，永不为空。
+     */
+    std::shared_ptr<const GroupPermissionSnapshot> getGroupPermissionSnapshot(const std::string& groupName);
     /**
      * @brief 批量向组添加权限规则。
      * @param groupName 组名称。
@@ -216,6 +251,14 @@ public:
      * @return 如果移除成功则返回 true，否则返回 false。
      */
     bool removePlayerFromGroup(const std::string& playerUuid, const std::string& groupName);
+    std::future<bool>
+    addPlayerToGroupBuffered(const std::string& playerUuid, const std::string& groupName, long long durationSeconds);
+    std::future<bool> removePlayerFromGroupBuffered(const std::string& playerUuid, const std::string& groupName);
+    /**
+     * @brief 提交写回队列中的所有修改，未启用写回队列时直接返回 true。
+     *        直接写入玩家组关系的操作会先调用它，保证与队列中的修改按调用顺序生效。
+     */
+    bool flushPendingWrites();
     /**
      * @brief 获取玩家所属的所有组名称。
      * @param playerUuid 玩家的 UUID。
@@ -234,12 +277,25 @@ public:
      * @return 包含组中所有玩家 UUID 的向量。
      */
     std::vector<std::string> getPlayersInGroup(const std::string& groupName);
+    std::vector<std::string> getPlayersInGroup(const std::string& groupName, size_t offset, size_t limit);
     /**
      * @brief 获取玩家所属的组及其优先级。
      * @param playerUuid 玩家的 UUID。
      * @return 包含玩家所属组详细信息（包括优先级）的向量。
      */
     std::vector<GroupDetails> getPlayerGroupsWithPriorities(const std::string& playerUuid);
+    /**
+     * @brief 获取玩家所属组的不可变快照。
+     * @param playerUuid 玩家的 UUID。
+     * @return 组列表快照指针，永不为空。
+     */
+    std::shared_ptr<const PlayerGroupsSnapshot> getPlayerGroupsSnapshot(const std::string& playerUuid);
+    /**
+     * @brief 获取玩家所属组的不可变快照（已解析的玩家键）。
+     * @param player 玩家键。
+     * @return 组列表快照指针，永不为空。
+     */
+    std::shared_ptr<const PlayerGroupsSnapshot> getPlayerGroupsSnapshot(const internal::PlayerKey& player);
     /**
      * @brief 批量将玩家添加到多个组。
      * @param playerUuid 玩家的 UUID。
@@ -262,6 +318,18 @@ public:
      * @return 包含编译后的权限规则的向量。
      */
     std::vector<CompiledPermissionRule> getAllPermissionsForPlayer(const std::string& playerUuid);
+    /**
+     * @brief 获取玩家的不可变权限快照。
+     * @param playerUuid 玩家的 UUID。
+     * @return 权限快照指针，永不为空。
+     */
+    std::shared_ptr<const PlayerPermissionSnapshot> getPlayerPermissionSnapshot(const std::string& playerUuid);
+    /**
+     * @brief 获取玩家的不可变权限快照（已解析的玩家键）。
+     * @param player 玩家键。
+     * @return 权限快照指针，永不为空。
+     */
+    std::shared_ptr<const PlayerPermissionSnapshot> getPlayerPermissionSnapshot(const internal::PlayerKey& player);
     /**
      * @brief 检查玩家是否拥有某个权限。
      * @param playerUuid 玩家的 UUID。
@@ -269,7 +337,60 @@ public:
      * @return 如果玩家拥有该权限则返回 true，否则返回 false。
      */
     bool hasPermission(const std::string& playerUuid, const std::string& permissionNode);
+    /**
+     * @brief 按权限ID检查玩家是否拥有某个权限。
+     * @param playerUuid 玩家的 UUID。
+     * @param permission 权限ID。
+     * @return 如果玩家拥有该权限则返回 true；ID 无效时返回 false。
+     */
+    bool hasPermission(const std::string& playerUuid, PermissionId permission);
+    /**
+     * @brief 一次检查玩家的多个权限节点。
+     * @param playerUuid 玩家的 UUID。
+     * @param permissionNodes 要检查的权限节点。
+     * @return 与 permissionNodes 一一对应的结果。
+     */
+    std::vector<bool> hasPermissions(const std::string& playerUuid, std::span<const std::string> permissionNodes);
+    /**
+     * @brief 从一组玩家中筛选出拥有某个权限节点的玩家。
+     * @param playerUuids 候选玩家的 UUID。
+     * @param permissionNode 要检查的权限节点。
+     * @return 拥有该权限的玩家 UUID，保持输入顺序。
+     */
+    std::vector<std::string>
+    filterPlayersWithPermission(std::span<const std::string> playerUuids, const std::string& permissionNode);
+    /**
+     * @brief 获取拥有某个权限节点的在线（已固定）玩家，由在线玩家权限索引提供。
+     * @param permissionNode 要检查的权限节点。
+     * @return 拥有该权限的在线玩家 UUID，顺序不固定。
+     */
+    std::vector<std::string> getOnlinePlayersWithPermission(const std::string& permissionNode);
     void runPeriodicCleanup();
+    /**
+     * @brief 删除已到期的玩家组关系并使受影响玩家的缓存失效，删除失败时稍后重试。
+     * @return 处理的 (玩家, 组) 数量。
+     */
+    size_t                   processDueExpirations();
+    /**
+     * @brief 获取最早的玩家组关系过期时间。
+     * @return Unix 时间戳（秒）；没有带过期时间的玩家组关系时返回 std::nullopt。
+     */
+    std::optional<long long> getNextExpiration();
+    /**
+     * @brief 设置最早的过期时间提前时调用的回调，清理线程用它提前醒来。
+     */
+    void                     setExpirationWakeHandler(std::function<void()> handler);
+    void       pinPlayer(const std::string& playerUuid);
+    void       unpinPlayer(const std::string& playerUuid);
+    void       prefetchPlayer(const std::string& playerUuid);
+    CacheStats getCacheStats();
+    std::string              getMetricsText();
+    std::vector<std::string> getStatsSummary();
+    std::vector<std::string> explainHotQueries();
+    std::vector<std::string> dumpTrace(size_t maxRecords);
+    bool               startCallRecording(const std::string& path, double sampleRate, uint64_t maxBytes);
+    CallRecordingStats stopCallRecording();
+    CallRecordingStats getCallRecordingStats();
     std::optional<long long> getPlayerGroupExpirationTime(const std::string& playerUuid, const std::string& groupName);
     bool                     setPlayerGroupExpirationTime(
                             const std::string& playerUuid,
@@ -277,7 +398,64 @@ public:
                             long long          durationSeconds
                         );
 
+    // --- 数据导入导出 ---
+    /**
+     * @brief 把整个权限数据集流式导出为 NDJSON，先提交写回队列中的修改。
+     * @param sink 接收输出块，返回 false 时停止导出。
+     * @return 导出统计。
+     */
+    TransferStats exportData(const std::function<bool(std::string_view)>& sink);
+    /**
+     * @brief 从 NDJSON 流导入数据集，分批事务写入；不触发逐条事件，结束后统一刷新缓存。
+     * @param read 向缓冲区读入最多 size 字节并返回读入的字节数，返回 0 表示输入结束。
+     * @return 导入统计。
+     */
+    TransferStats importData(const std::function<size_t(char*, size_t)>& read);
+
+    // --- 异步调用 ---
+    /**
+     * @brief 设置异步回调的投递函数，为空时回调直接在 I/O 线程中执行。
+     * @param executor 接收一个回调并安排其在目标线程（通常是游戏线程）中执行的函数。
+     */
+    void setCompletionExecutor(std::function<void(std::function<void()>)> executor);
+    /**
+     * @brief 在 I/O 线程中执行 task，不投递回调；task 抛出的异常只记录日志。
+     * @param task 要执行的调用。
+     */
+    void runAsync(std::function<void()> task);
+    /**
+     * @brief 在 I/O 线程中执行 work，返回其结果的 future；work 抛出的异常会转交给 future。
+     *        I/O 线程未运行（未初始化或已关闭）时在调用线程中直接执行。
+     */
+    template <typename Result>
+    std::future<Result> submitAsync(std::function<Result()> work);
+    /**
+     * @brief 在 I/O 线程中执行 work，完成后通过投递函数以其结果调用 callback。
+     *        work 抛出异常时记录日志，并以 Result{} 调用 callback。
+     */
+    template <typename Result>
+    void submitAsync(std::function<Result()> work, std::function<void(Result)> callback);
+
 private:
+    /**
+     * @brief 固定玩家的缓存、加入在线索引并记录上线时间，pinPlayer 与 prefetchPlayer 在录制调用后共用。
+     * @param playerUuid 玩家的 UUID。
+     */
+    void pinOnlinePlayer(const std::string& playerUuid);
+
+    // 预热时一次性读出的组数据，构建快照时代替逐组查询
+    struct PreloadedGroupData {
+        std::unordered_map<std::string, GroupDetails>             groupsByName;      // 组名 -> 详情
+        std::unordered_map<std::string, std::vector<std::string>> permissionsById;   // 组 ID -> 直接权限
+    };
+
+    // 把任务交给 I/O 线程，未运行时在调用线程中执行
+    void postIo(std::function<void()> task);
+    // 把回调交给投递函数
+    void dispatchCompletion(std::function<void()> completion);
+    // 记录异步调用中 work 抛出的异常
+    static void logAsyncFailure(const std::exception_ptr& error);
+
     // --- 辅助方法 ---
     /**
      * @brief 获取缓存的组 ID，如果缓存中不存在则从存储层获取并缓存。
@@ -286,25 +464,185 @@ private:
      */
     std::string getCachedGroupId(const std::string& groupName);
     /**
-     * @brief 将通配符模式转换为正则表达式。
-     * @param pattern 包含通配符的字符串模式。
-     * @return 对应的正则表达式对象。
+     * @brief 批量添加或移除组权限：整批触发一次批量事件，逐条事件只在有监听器时触发，规则在一个事务中写入。
+     * @param groupName 组名称。
+     * @param permissionRules 权限规则字符串向量。
+     * @param isAdd true 为添加，false 为移除。
+     * @return 成功写入的权限规则数量。
+     */
+    size_t changeGroupPermissions(
+        const std::string&              groupName,
+        const std::vector<std::string>& permissionRules,
+        bool                            isAdd
+    );
+    /**
+     * @brief 为一批玩家组关系修改触发批量与逐条的 Before 事件（各自只在有监听器时触发），删除被拒绝的条目。
+     * @param changes 待执行的修改，原地删除被拒绝的条目。
+     * @return 整批被取消时返回 false。
+     */
+    bool confirmPlayerGroupChanges(std::vector<event::PlayerGroupChange>& changes);
+    /**
+     * @brief 为一批已写入的玩家组关系修改触发批量与逐条的 After 事件（各自只在有监听器时触发）。
+     * @param changes 已写入的修改。
+     */
+    void publishPlayerGroupChanges(const std::vector<event::PlayerGroupChange>& changes);
+    /**
+     * @brief 按优先级把多个组的直接权限叠加为一个组权限层，高优先级组覆盖低优先级组。
+     * @param groups 参与计算的组（一个组的祖先闭包，含自身）。
+     * @param preloaded 预热时读出的组数据，为空时从存储层查询。
+     * @return 按模式字典序排列的规则，每条带有决定其状态的组的优先级。
+     */
+    std::vector<RankedPermissionRule>
+    computeGroupLayer(const internal::GroupClosure& groups, const PreloadedGroupData* preloaded = nullptr);
+    /**
+     * @brief 将有效状态转换为规则列表。
+     * @param effectiveState 模式到状态的映射。
+     * @return 规则列表（未排序）。
+     */
+    static std::vector<CompiledPermissionRule> toRules(const std::map<std::string, bool>& effectiveState);
+    /**
+     * @brief 获取当前的默认权限层，必要时先从存储层加载默认权限。
+     * @return 默认权限层，永不为空。
+     */
+    std::shared_ptr<const DefaultPermissionLayer> currentDefaultLayer();
+    /**
+     * @brief 在快照和默认权限层上计算节点的最终结果，均未匹配时回退到默认值。
+     * @param snapshot 玩家权限快照。
+     * @param defaultLayer 默认权限层。
+     * @param permissionNode 权限节点。
+     * @param allowStorageFallback 默认值缓存未命中时是否再查询一次数据库。
+     * @return 最终结果。
      */
-    std::regex wildcardToRegex(const std::string& pattern);
+    bool evaluatePermission(
+        const PlayerPermissionSnapshot& snapshot,
+        const DefaultPermissionLayer&   defaultLayer,
+        const std::string&              permissionNode,
+        bool                            allowStorageFallback = true
+    );
     /**
      * @brief 预热所有权限缓存。
-     *        此方法会从存储层加载数据并填充到缓存中，以提高后续查询性能。
+     *        组、继承、组权限与默认值各用一次流式查询并行读取，随后预先构建所有组的权限快照，
+     *        并可选地构建最近上线玩家的缓存。各阶段耗时写入日志。
+     * @param recentPlayers 预热最近上线的玩家数量，0 表示不预热玩家。
      */
-    void populateAllCaches();
+    void populateAllCaches(size_t recentPlayers);
+    /**
+     * @brief 从快照文件载入组、继承、组权限层与默认值缓存。
+     * @param watermark 数据库当前的变更水位，与快照记录的水位不同时视为过期。
+     * @return 载入成功返回 true；文件不存在、损坏或已过期时返回 false，缓存保持不变。
+     */
+    bool loadCacheSnapshot(uint64_t watermark);
+    /**
+     * @brief 把当前的组、继承、组权限层与默认值缓存写入快照文件。
+     *        运行期间数据库被其他实例修改过时（水位与本实例的修改次数对不上）不写入。
+     */
+    void saveCacheSnapshot();
+    /**
+     * @brief 处理其他服务器发布的失效任务。
+     *        涉及组的任务会先从数据库重新载入组名表与继承关系（其他服务器的修改不会更新本机的这两部分缓存），
+     *        再把任务交给本机的失效器。
+     * @param tasks 其他服务器发布的任务。
+     */
+    void onRemoteInvalidations(std::vector<CacheInvalidationTask> tasks);
+    /**
+     * @brief 从数据库构建玩家的组列表快照并存入缓存。
+     * @param player 玩家键。
+     * @return 新构建的组列表快照。
+     */
+    std::shared_ptr<const PlayerGroupsSnapshot> buildPlayerGroupsSnapshot(const internal::PlayerKey& player);
+    /**
+     * @brief 用已读出的组详情构建玩家的组列表快照并存入缓存（构建期间有组被修改时只返回不缓存）。
+     * @param player 玩家键。
+     * @param epoch 读取组详情之前的全局组纪元。
+     * @param details 玩家未过期的组详情。
+     * @param complete 组详情是否读取成功；为 false 时快照只返回不缓存，由它构建的权限快照也不缓存。
+     * @return 新构建的组列表快照。
+     */
+    std::shared_ptr<const PlayerGroupsSnapshot> buildPlayerGroupsSnapshot(
+        const internal::PlayerKey& player,
+        uint64_t                   epoch,
+        std::vector<GroupDetails>  details,
+        bool                       complete = true
+    );
+    /**
+     * @brief 归并玩家所属组的权限层构建权限快照并存入缓存（构建期间有组被修改时只返回不缓存）。
+     *        组权限层都已缓存时不访问存储层。
+     * @param player 玩家键。
+     * @param epoch 开始读取玩家组之前的全局组纪元。
+     * @param playerGroups 玩家所属组。
+     * @return 新构建的权限快照。
+     */
+    std::shared_ptr<const PlayerPermissionSnapshot> buildPlayerPermissionSnapshot(
+        const internal::PlayerKey&  player,
+        uint64_t                    epoch,
+        const PlayerGroupsSnapshot& playerGroups
+    );
+    /**
+     * @brief 在后台重建玩家的缓存并原子替换旧快照（refresh-ahead）。
+     * @param player 玩家键。
+     */
+    void refreshPlayer(const internal::PlayerKey& player);
+    /**
+     * @brief 写回队列提交一批修改后调用：合并为一个批量失效任务并触发 After 事件。
+     * @param applied 已提交的修改。
+     */
+    void onPlayerGroupMutationsApplied(const std::vector<internal::AppliedPlayerGroupMutation>& applied);
 
     // --- 成员变量 ---
     // 使用 unique_ptr 来管理内部组件的生命周期，确保资源自动释放
     std::unique_ptr<internal::PermissionStorage>     m_storage;     // 权限存储组件
     std::unique_ptr<internal::PermissionCache>       m_cache;       // 权限缓存组件
     std::unique_ptr<internal::AsyncCacheInvalidator> m_invalidator; // 异步缓存失效器组件
+    std::unique_ptr<internal::WriteBehindQueue>      m_writeBehind; // 玩家组关系写回队列，未启用时为空
+    std::unique_ptr<internal::IoExecutor>            m_ioExecutor;  // 执行 *Async 接口的 I/O 线程池
+    std::unique_ptr<internal::ExpiryQueue>           m_expiryQueue; // 即将到期的玩家组关系
+    std::unique_ptr<internal::ClusterInvalidator>    m_cluster;     // 跨服务器缓存失效，未启用时为空
+    std::unique_ptr<internal::PermissionRegistry>    m_registry;    // 权限节点名到整数ID的映射
+    std::unique_ptr<internal::OnlinePermissionIndex> m_onlineIndex; // 权限节点到在线玩家的反向索引
+    std::unique_ptr<internal::CallRecorder>          m_recorder;    // API 调用录制器，未录制时只是一次原子读取
+
+    std::mutex                                   m_completionMutex;    // 保护 m_completionExecutor
+    std::function<void(std::function<void()>)>   m_completionExecutor; // 异步回调的投递函数
+
+    std::string             m_snapshotPath;         // 缓存快照文件路径，为空表示不使用
+    std::optional<uint64_t> m_snapshotWatermark;    // 缓存所对应的数据库变更水位，未知时为空
+    uint64_t                m_snapshotLocalChanges = 0; // 记录水位时本实例已递增水位的次数
 
     bool m_initialized = false; // 标记权限管理器是否已初始化
 };
 
+template <typename Result>
+std::future<Result> PermissionManager::PermissionManagerImpl::submitAsync(std::function<Result()> work) {
+    auto promise = std::make_shared<std::promise<Result>>();
+    auto future  = promise->get_future();
+    postIo([promise, work = std::move(work)] {
+        try {
+            promise->set_value(work());
+        } catch (...) {
+            promise->set_exception(std::current_exception());
+        }
+    });
+    return future;
+}
+
+template <typename Result>
+void PermissionManager::PermissionManagerImpl::submitAsync(
+    std::function<Result()>     work,
+    std::function<void(Result)> callback
+) {
+    postIo([this, work = std::move(work), callback = std::move(callback)]() mutable {
+        Result result{};
+        try {
+            result = work();
+        } catch (...) {
+            logAsyncFailure(std::current_exception());
+        }
+        if (!callback) return;
+        dispatchCompletion([callback = std::move(callback), result = std::move(result)]() mutable {
+            callback(std::move(result));
+        });
+    });
+}
+
 } // namespace permission
 } // namespace BA
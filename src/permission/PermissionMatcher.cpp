@@ -0,0 +1,213 @@
+#include "permission/PermissionMatcher.h"
+#include <algorithm>
+#include <deque>
+#include <map>
+
+namespace BA {
+namespace permission {
+
+using namespace std;
+
+namespace {
+// ASCII 大小写折叠，与旧实现中 regex icase 对权限节点的效果一致
+inline unsigned char foldCase(char c) {
+    auto uc = static_cast<unsigned char>(c);
+    return (uc >= 'A' && uc <= 'Z') ? static_cast<unsigned char>(uc + ('a' - 'A')) : uc;
+}
+} // namespace
+
+PermissionMatcher::PermissionMatcher(const vector<CompiledPermissionRule>& rules) {
+    for (size_t i = 0; i < rules.size(); ++i) {
+        insert(rules[i].pattern, static_cast<int32_t>(i));
+    }
+    m_hasRules = !rules.empty();
+    m_useDfa   = buildDfa();
+    if (m_useDfa) {
+        // DFA 已包含全部信息，释放前缀树；构建时按倍数增长的容量也一并收回
+        m_nfa = {};
+        m_dfaStates.shrink_to_fit();
+        m_edgeChars.shrink_to_fit();
+        m_edgeTargets.shrink_to_fit();
+    } else {
+        m_dfaStates   = {};
+        m_edgeChars   = {};
+        m_edgeTargets = {};
+    }
+}
+
+// 将一个模式插入前缀树，连续的 '*' 会被折叠为一个
+void PermissionMatcher::insert(string_view pattern, int32_t ruleIndex) {
+    uint32_t current = 0;
+    for (char raw : pattern) {
+        if (raw == '*') {
+            if (m_nfa[current].isStar) continue;
+            if (m_nfa[current].starChild == INVALID) {
+                m_nfa[current].starChild = static_cast<uint32_t>(m_nfa.size());
+                NfaNode star;
+                star.isStar = true;
+                m_nfa.push_back(std::move(star));
+            }
+            current = m_nfa[current].starChild;
+            continue;
+        }
+
+        unsigned char c        = foldCase(raw);
+        auto&         children = m_nfa[current].children;
+        auto          it       = lower_bound(children.begin(), children.end(), c, [](const auto& edge, unsigned char ch) {
+            return edge.first < ch;
+        });
+        if (it != children.end() && it->first == c) {
+            current = it->second;
+        } else {
+            auto next = static_cast<uint32_t>(m_nfa.size());
+            children.insert(it, {c, next});
+            m_nfa.emplace_back();
+            current = next;
+        }
+    }
+    // 同一节点上只保留优先级最高（下标最小）的规则
+    auto& node = m_nfa[current];
+    if (node.ruleIndex == NO_MATCH || ruleIndex < node.ruleIndex) {
+        node.ruleIndex = ruleIndex;
+    }
+}
+
+// '*' 可以匹配空串，因此到达某节点等同于同时到达它的 '*' 子节点
+void PermissionMatcher::addClosure(vector<uint32_t>& set, uint32_t node) const {
+    while (node != INVALID) {
+        set.push_back(node);
+        node = m_nfa[node].starChild;
+    }
+}
+
+int32_t PermissionMatcher::acceptOf(const vector<uint32_t>& set) const {
+    int32_t best = NO_MATCH;
+    for (uint32_t n : set) {
+        int32_t rule = m_nfa[n].ruleIndex;
+        if (rule != NO_MATCH && (best == NO_MATCH || rule < best)) {
+            best = rule;
+        }
+    }
+    return best;
+}
+
+// 子集构造：每个 DFA 状态对应一组 NFA 节点。
+// 只为 NFA 节点实际拥有的字面量字符生成边，其余字符统一走 defaultNext（仅由 '*' 自环产生）。
+bool PermissionMatcher::buildDfa() {
+    map<vector<uint32_t>, int32_t> stateIds;
+    deque<vector<uint32_t>>        pending;
+
+    auto intern = [&](vector<uint32_t>&& set) -> int32_t {
+        if (set.empty()) return DEAD;
+        sort(set.begin(), set.end());
+        set.erase(unique(set.begin(), set.end()), set.end());
+        auto it = stateIds.find(set);
+        if (it != stateIds.end()) return it->second;
+        auto id = static_cast<int32_t>(m_dfaStates.size());
+        m_dfaStates.emplace_back();
+        m_dfaStates.back().acceptRule = acceptOf(set);
+        stateIds.emplace(set, id);
+        pending.push_back(std::move(set));
+        return id;
+    };
+
+    vector<uint32_t> start;
+    addClosure(start, 0);
+    intern(std::move(start));
+
+    for (int32_t stateId = 0; !pending.empty(); ++stateId) {
+        if (m_dfaStates.size() > MAX_DFA_STATES) {
+            return false;
+        }
+        vector<uint32_t> current = std::move(pending.front());
+        pending.pop_front();
+
+        vector<unsigned char> chars;
+        vector<uint32_t>      stars;
+        for (uint32_t n : current) {
+            for (const auto& edge : m_nfa[n].children) chars.push_back(edge.first);
+            if (m_nfa[n].isStar) stars.push_back(n);
+        }
+        sort(chars.begin(), chars.end());
+        chars.erase(unique(chars.begin(), chars.end()), chars.end());
+
+        vector<int32_t> targets;
+        targets.reserve(chars.size());
+        for (unsigned char c : chars) {
+            vector<uint32_t> next = stars;
+            for (uint32_t n : current) {
+                const auto& children = m_nfa[n].children;
+                auto        it       = lower_bound(children.begin(), children.end(), c, [](const auto& e, unsigned char ch) {
+                    return e.first < ch;
+                });
+                if (it != children.end() && it->first == c) addClosure(next, it->second);
+            }
+            targets.push_back(intern(std::move(next)));
+        }
+        int32_t defaultNext = intern(vector<uint32_t>(stars));
+
+        auto& state       = m_dfaStates[stateId];
+        state.edgeBegin   = static_cast<uint32_t>(m_edgeChars.size());
+        state.edgeCount   = static_cast<uint16_t>(chars.size());
+        state.defaultNext = defaultNext;
+        state.absorbing   = chars.empty() && defaultNext == stateId;
+        m_edgeChars.insert(m_edgeChars.end(), chars.begin(), chars.end());
+        m_edgeTargets.insert(m_edgeTargets.end(), targets.begin(), targets.end());
+    }
+    return true;
+}
+
+int32_t PermissionMatcher::match(string_view node) const {
+    if (!m_useDfa) {
+        return matchNfa(node);
+    }
+    int32_t stateId = 0;
+    for (char raw : node) {
+        const DfaState& state = m_dfaStates[stateId];
+        if (state.absorbing) break;
+        unsigned char c     = foldCase(raw);
+        const auto*   begin = m_edgeChars.data() + state.edgeBegin;
+        const auto*   end   = begin + state.edgeCount;
+        const auto*   it    = lower_bound(begin, end, c);
+        stateId             = (it != end && *it == c) ? m_edgeTargets[it - m_edgeChars.data()] : state.defaultNext;
+        if (stateId == DEAD) return NO_MATCH;
+    }
+    return m_dfaStates[stateId].acceptRule;
+}
+
+// 回退路径：规则中存在大量中间通配符导致 DFA 过大时，直接模拟 NFA
+int32_t PermissionMatcher::matchNfa(string_view node) const {
+    vector<uint32_t> current;
+    vector<uint32_t> next;
+    addClosure(current, 0);
+    for (char raw : node) {
+        unsigned char c = foldCase(raw);
+        next.clear();
+        for (uint32_t n : current) {
+            if (m_nfa[n].isStar) next.push_back(n);
+            const auto& children = m_nfa[n].children;
+            auto        it       = lower_bound(children.begin(), children.end(), c, [](const auto& e, unsigned char ch) {
+                return e.first < ch;
+            });
+            if (it != children.end() && it->first == c) addClosure(next, it->second);
+        }
+        sort(next.begin(), next.end());
+        next.erase(unique(next.begin(), next.end()), next.end());
+        if (next.empty()) return NO_MATCH;
+        current.swap(next);
+    }
+    return acceptOf(current);
+}
+
+size_t PermissionMatcher::memoryUsage() const {
+    size_t bytes = sizeof(*this) + m_nfa.capacity() * sizeof(NfaNode);
+    for (const auto& n : m_nfa) {
+        bytes += n.children.capacity() * sizeof(n.children[0]);
+    }
+    bytes += m_dfaStates.capacity() * sizeof(DfaState) + m_edgeChars.capacity() * sizeof(unsigned char)
+           + m_edgeTargets.capacity() * sizeof(int32_t);
+    return bytes;
+}
+
+} // namespace permission
+} // namespace BA
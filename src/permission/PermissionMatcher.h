@@ -0,0 +1,85 @@
+#pragma once
+
+#include "PermissionData.h"
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace BA {
+namespace permission {
+
+/**
+ * @brief 权限通配符匹配引擎。
+ *        由一组已按优先级排序的权限规则（长模式在前）构建，内部先将所有模式插入一棵字符前缀树（NFA），
+ *        再通过子集构造生成一个稀疏 DFA。匹配时每个字符只做一次状态转移，耗时与节点长度成线性关系，
+ *        与规则数量无关。`*` 匹配任意数量的任意字符（包括 `.`），匹配不区分 ASCII 大小写，
+ *        语义与旧的 wildcardToRegex 生成的 `^...$` 正则保持一致。
+ */
+class PermissionMatcher {
+public:
+    static constexpr int32_t NO_MATCH = -1;
+
+    PermissionMatcher() = default;
+    /**
+     * @brief 从规则列表构建匹配器。
+     * @param rules 按优先级降序排列的规则（下标越小优先级越高）。
+     */
+    BA_API explicit PermissionMatcher(const std::vector<CompiledPermissionRule>& rules);
+
+    /**
+     * @brief 查找与节点匹配的最高优先级规则。
+     * @param node 要匹配的权限节点。
+     * @return 匹配规则在构建时列表中的下标；没有规则匹配时返回 NO_MATCH。
+     */
+    BA_API int32_t match(std::string_view node) const;
+
+    /**
+     * @brief 匹配器是否不包含任何规则。
+     */
+    bool empty() const { return !m_hasRules; }
+
+    /**
+     * @brief 估算匹配器占用的内存字节数。
+     */
+    BA_API size_t memoryUsage() const;
+
+private:
+    static constexpr uint32_t INVALID          = 0xFFFFFFFFu;
+    static constexpr size_t   MAX_DFA_STATES   = 4096; // DFA 状态数上限，超出则回退到 NFA 模拟
+    static constexpr int32_t  DEAD             = -1;
+
+    // NFA 节点：前缀树中的一个位置
+    struct NfaNode {
+        std::vector<std::pair<unsigned char, uint32_t>> children;             // 按字符排序的字面量子节点
+        uint32_t                                        starChild = INVALID; // 经由 '*' 到达的子节点
+        bool                                            isStar    = false;   // 该节点是否为 '*' 节点（可自环）
+        int32_t                                         ruleIndex = NO_MATCH;
+    };
+
+    // DFA 状态：边的字符与目标状态分别存储在 m_edgeChars 与 m_edgeTargets 的 [edgeBegin, edgeBegin + edgeCount) 区间。
+    // 规则集按内容整体驻留，每个驻留的规则集各有一份 DFA，因此状态与边都尽量紧凑（16 字节与 5 字节）
+    struct DfaState {
+        uint32_t edgeBegin   = 0;
+        int32_t  defaultNext = DEAD;     // 不在边表中的字符的目标状态
+        int32_t  acceptRule  = NO_MATCH; // 在此状态结束时命中的规则
+        uint16_t edgeCount   = 0;        // 最多 256 种字符
+        bool     absorbing   = false;    // 无出边且默认自环：后续字符不会改变结果
+    };
+
+    void    insert(std::string_view pattern, int32_t ruleIndex);
+    void    addClosure(std::vector<uint32_t>& set, uint32_t node) const;
+    int32_t acceptOf(const std::vector<uint32_t>& set) const;
+    bool    buildDfa();
+    int32_t matchNfa(std::string_view node) const;
+
+    std::vector<NfaNode>  m_nfa{NfaNode{}};
+    std::vector<DfaState>      m_dfaStates;
+    std::vector<unsigned char> m_edgeChars;   // 每个状态的边按字符升序排列
+    std::vector<int32_t>       m_edgeTargets; // 与 m_edgeChars 一一对应的目标状态
+    bool                       m_useDfa   = false;
+    bool                       m_hasRules = false;
+};
+
+} // namespace permission
+} // namespace BA
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+namespace BA {
+namespace permission {
+
+/**
+ * @brief 权限管理器的运行参数。
+ *        由 MyMod 从 config::Config 填充后传给 PermissionManager::init，
+ *        第三方直接嵌入时使用默认值即可。
+ */
+struct PermissionOptions {
+    bool         enableWarmup   = true; // 是否在启动时预热缓存
+    // 预热时额外构建最近上线的多少名玩家的缓存（按 player_last_seen 排序），0 表示不预热玩家
+    size_t warmupRecentPlayers = 0;
+    unsigned int threadPoolSize = 4;    // 缓存失效工作线程池大小
+
+    // 编译缓存快照文件路径，为空表示不使用。设置后 shutdown 时写入组、继承、组权限层与默认值，
+    // 下次 init 时若数据库的变更水位未变则直接载入，否则回退到完整预热；只在 enableWarmup 时生效
+    std::string cacheSnapshotPath;
+
+    // 每个玩家决策缓存（节点 -> 最终结果）最多保存的节点数，0 表示禁用
+    size_t decisionCacheMaxEntriesPerPlayer = 256;
+
+    // 玩家权限快照与玩家组缓存各自的估算字节上限，超出后淘汰最久未访问且未固定的玩家，0 表示不限制
+    size_t playerCacheMaxBytes = 64u * 1024 * 1024;
+
+    // 玩家缓存与决策缓存按玩家 UUID 哈希的分片数，每个分片一把读写锁；1 表示单锁模式
+    size_t cacheShardCount = 16;
+
+    // 启用后，在线（被固定）玩家的缓存失效时由失效工作线程在后台重建快照并原子替换，
+    // 重建完成前继续使用旧快照，游戏线程不会因数据库查询而阻塞
+    bool refreshAhead = false;
+
+    // 启用后，addPlayerToGroupBuffered / removePlayerFromGroupBuffered 的修改先进入内存队列，
+    // 每隔 writeBehindIntervalMs 毫秒或积累 writeBehindMaxBatch 条时在一个事务中批量提交
+    bool         writeBehind           = false;
+    unsigned int writeBehindIntervalMs = 50;
+    size_t       writeBehindMaxBatch   = 1000;
+
+    // 执行 *Async 接口的 I/O 线程数，这些调用在 I/O 线程中访问数据库，不阻塞调用线程
+    unsigned int ioThreadPoolSize = 2;
+
+    // 启用后，多台服务器共用一个数据库时通过 cache_invalidation_log 互相同步缓存失效任务，
+    // 每隔 clusterPollIntervalMs 毫秒读取一次其他服务器的记录；PostgreSQL 上另用 LISTEN/NOTIFY 立即唤醒
+    bool         clusterInvalidation   = false;
+    unsigned int clusterPollIntervalMs = 500;
+
+    // 是否把失效任务、快照构建与数据库语句记录到每线程的追踪缓冲区，供 dumpTrace 导出；开销很小，默认开启
+    bool tracing = true;
+};
+
+} // namespace permission
+} // namespace BA
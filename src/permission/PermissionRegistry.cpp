@@ -0,0 +1,33 @@
+#include "permission/PermissionRegistry.h"
+
+namespace BA {
+namespace permission {
+namespace internal {
+
+PermissionId PermissionRegistry::resolve(const std::string& name) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto                        it = m_ids.find(name);
+    if (it != m_ids.end()) return it->second;
+
+    // 节点大多在启动时一次性注册，复制整张表的开销可以接受，换来读取方无需加锁遍历
+    auto names = std::make_shared<NameTable>(*m_names);
+    auto id    = static_cast<PermissionId>(names->size());
+    names->push_back(name);
+    m_names = std::move(names);
+    m_ids.emplace(name, id);
+    return id;
+}
+
+std::shared_ptr<const PermissionRegistry::NameTable> PermissionRegistry::names() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_names;
+}
+
+size_t PermissionRegistry::size() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_names->size();
+}
+
+} // namespace internal
+} // namespace permission
+} // namespace BA
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "permission/PermissionData.h"
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace BA {
+namespace permission {
+namespace internal {
+
+/**
+ * @brief 权限节点名到稠密整数ID的映射，只增不减。
+ *        ID 按首次解析的顺序从 0 开始分配，在进程生命周期内保持不变，可直接用作位集下标。
+ *        名称表采用写时复制，读取方拿到的表不会再被修改，可以在锁外遍历。
+ */
+class PermissionRegistry {
+public:
+    using NameTable = std::vector<std::string>;
+
+    /**
+     * @brief 获取权限节点的ID，尚未分配时分配一个新的。
+     * @param name 权限节点名。
+     * @return 权限ID。
+     */
+    PermissionId resolve(const std::string& name);
+
+    /**
+     * @brief 获取当前所有已分配ID的名称表，下标即ID。
+     */
+    std::shared_ptr<const NameTable> names() const;
+
+    // 已分配的ID数量
+    size_t size() const;
+
+private:
+    mutable std::mutex                            m_mutex;
+    std::unordered_map<std::string, PermissionId> m_ids;
+    std::shared_ptr<const NameTable>              m_names = std::make_shared<const NameTable>();
+};
+
+} // namespace internal
+} // namespace permission
+} // namespace BA
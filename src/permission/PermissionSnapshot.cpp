@@ -0,0 +1,147 @@
+#include "permission/PermissionSnapshot.h"
+#include "permission/RuleSetInterner.h"
+#include <algorithm>
+#include <cstring>
+#include <new>
+
+namespace BA {
+namespace permission {
+
+namespace {
+// 长模式优先，匹配器按下标决定优先级
+std::vector<CompiledPermissionRule> sortedByPriority(std::vector<CompiledPermissionRule> rules) {
+    PermissionRuleSnapshot::sortByPriority(rules);
+    return rules;
+}
+} // namespace
+
+CompiledRuleSet::CompiledRuleSet(std::vector<CompiledPermissionRule> sortedRules, uint64_t hash)
+: rules(std::move(sortedRules)),
+  matcher(rules),
+  hash(hash) {
+    bytes = sizeof(*this) + rules.capacity() * sizeof(CompiledPermissionRule) + matcher.memoryUsage();
+    for (const auto& rule : rules) {
+        bytes += rule.pattern.capacity();
+    }
+}
+
+PermissionRuleSnapshot::PermissionRuleSnapshot(std::vector<CompiledPermissionRule> unsortedRules)
+: ruleSet(internal::RuleSetInterner::getInstance().intern(sortedByPriority(std::move(unsortedRules)))),
+  rules(ruleSet->rules),
+  matcher(ruleSet->matcher) {}
+
+namespace {
+// 输入已按模式排序且互不相同，按 (长度降序, 模式) 排序与对其做按长度的稳定排序结果相同，
+// 而 std::sort 不需要稳定排序的临时缓冲区
+std::span<const CompiledPermissionRule*> sortedByPriority(std::span<const CompiledPermissionRule*> rules) {
+    std::sort(rules.begin(), rules.end(), [](const CompiledPermissionRule* a, const CompiledPermissionRule* b) {
+        if (a->pattern.length() != b->pattern.length()) return a->pattern.length() > b->pattern.length();
+        return a->pattern < b->pattern;
+    });
+    return rules;
+}
+} // namespace
+
+PermissionRuleSnapshot::PermissionRuleSnapshot(std::span<const CompiledPermissionRule*> rulesByPattern)
+: ruleSet(internal::RuleSetInterner::getInstance().intern(sortedByPriority(rulesByPattern))),
+  rules(ruleSet->rules),
+  matcher(ruleSet->matcher) {}
+
+void PermissionRuleSnapshot::sortByPriority(std::vector<CompiledPermissionRule>& rules) {
+    std::stable_sort(rules.begin(), rules.end(), [](const auto& a, const auto& b) {
+        return a.pattern.length() > b.pattern.length();
+    });
+}
+
+size_t PermissionRuleSnapshot::memoryUsage() const { return sizeof(*this); }
+
+GroupGenerations::GroupGenerations(std::span<const Entry> entries) {
+    if (entries.empty()) return;
+    size_t nameBytes = 0;
+    for (const auto& entry : entries) nameBytes += entry.group.size();
+    m_count = entries.size();
+    m_bytes = m_count * sizeof(Entry) + nameBytes;
+    m_block = std::make_unique_for_overwrite<std::byte[]>(m_bytes);
+
+    auto* packed = reinterpret_cast<Entry*>(m_block.get());
+    char* names  = reinterpret_cast<char*>(m_block.get() + m_count * sizeof(Entry));
+    for (size_t i = 0; i < m_count; ++i) {
+        std::memcpy(names, entries[i].group.data(), entries[i].group.size());
+        new (&packed[i]) Entry{std::string_view(names, entries[i].group.size()), entries[i].generation};
+        names += entries[i].group.size();
+    }
+    m_entries = packed;
+}
+
+namespace {
+std::vector<CompiledPermissionRule> toCompiledRules(const std::vector<RankedPermissionRule>& rankedRules) {
+    std::vector<CompiledPermissionRule> rules;
+    rules.reserve(rankedRules.size());
+    for (const auto& rule : rankedRules) rules.emplace_back(rule.pattern, rule.state);
+    return rules;
+}
+} // namespace
+
+GroupPermissionSnapshot::GroupPermissionSnapshot(const std::vector<RankedPermissionRule>& rankedRules)
+: PermissionRuleSnapshot(toCompiledRules(rankedRules)) {
+    // rules 已按长度重新排序，按模式排回字典序后与输入一一对应
+    layer.reserve(rules.size());
+    for (const auto& rule : rules) layer.push_back({&rule, 0});
+    std::sort(layer.begin(), layer.end(), [](const LayerEntry& a, const LayerEntry& b) {
+        return a.rule->pattern < b.rule->pattern;
+    });
+    for (size_t i = 0; i < layer.size() && i < rankedRules.size(); ++i) {
+        layer[i].priority = rankedRules[i].priority;
+    }
+}
+
+std::vector<RankedPermissionRule> GroupPermissionSnapshot::rankedRules() const {
+    std::vector<RankedPermissionRule> result;
+    result.reserve(layer.size());
+    for (const auto& entry : layer) result.push_back({entry.rule->pattern, entry.rule->state, entry.priority});
+    return result;
+}
+
+void GroupPermissionSnapshot::merge(
+    std::span<const std::shared_ptr<const GroupPermissionSnapshot>> layers,
+    std::pmr::vector<const CompiledPermissionRule*>&                out
+) {
+    if (layers.size() == 1) {
+        // 只属于一个组时规则与该组相同，驻留表会直接复用该组已编译的规则集
+        out.reserve(out.size() + layers[0]->layer.size());
+        for (const auto& entry : layers[0]->layer) out.push_back(entry.rule);
+        return;
+    }
+
+    // 玩家通常只属于少数几个组，每步线性扫描各层的当前位置即可，不需要堆
+    size_t total = 0;
+    for (const auto& layer : layers) total += layer->layer.size();
+    out.reserve(out.size() + total);
+    std::pmr::vector<size_t> cursors(layers.size(), 0, out.get_allocator());
+    while (true) {
+        const std::string* next = nullptr;
+        for (size_t i = 0; i < layers.size(); ++i) {
+            if (cursors[i] == layers[i]->layer.size()) continue;
+            const std::string& pattern = layers[i]->layer[cursors[i]].rule->pattern;
+            if (!next || pattern < *next) next = &pattern;
+        }
+        if (!next) break;
+
+        const LayerEntry* best = nullptr;
+        for (size_t i = 0; i < layers.size(); ++i) {
+            if (cursors[i] == layers[i]->layer.size()) continue;
+            const LayerEntry& entry = layers[i]->layer[cursors[i]];
+            if (entry.rule->pattern != *next) continue;
+            if (!best || entry.priority >= best->priority) best = &entry;
+            ++cursors[i];
+        }
+        out.push_back(best->rule);
+    }
+}
+
+size_t GroupPermissionSnapshot::memoryUsage() const {
+    return PermissionRuleSnapshot::memoryUsage() + layer.capacity() * sizeof(LayerEntry);
+}
+
+} // namespace permission
+} // namespace BA
@@ -0,0 +1,270 @@
+#pragma once
+
+#include "PermissionData.h"
+#include "PermissionMatcher.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace BA {
+namespace permission {
+
+/**
+ * @brief 已按优先级排序的规则及由它们构建的匹配器。
+ *        内容相同的规则集在进程内只编译、保存一次，由所有引用它的快照（玩家、组、默认层）共享。
+ */
+struct CompiledRuleSet {
+    std::vector<CompiledPermissionRule> rules;     // 已按长模式优先排序的规则
+    PermissionMatcher                   matcher;   // 由 rules 构建的匹配器
+    uint64_t                            hash  = 0; // 规则内容的哈希
+    size_t                              bytes = 0; // 估算占用字节数，构建时计算一次
+
+    BA_API CompiledRuleSet(std::vector<CompiledPermissionRule> sortedRules, uint64_t hash);
+};
+
+/**
+ * @brief 不可变的权限规则快照。
+ *        构建后不再修改，缓存以 std::shared_ptr<const ...> 的形式持有并在重建时整体替换，
+ *        读者拿到指针后无需加锁、也无需复制规则即可进行匹配。
+ *        规则与匹配器存放在驻留的 CompiledRuleSet 中，规则内容相同的快照不会重复编译匹配器。
+ */
+struct PermissionRuleSnapshot {
+    std::shared_ptr<const CompiledRuleSet>     ruleSet; // 可能与其他快照共享的规则集
+    const std::vector<CompiledPermissionRule>& rules;   // ruleSet->rules
+    const PermissionMatcher&                   matcher; // ruleSet->matcher
+
+    /**
+     * @brief 构建快照。规则内容与已有快照相同时直接共享其规则集。
+     * @param unsortedRules 生效的规则，构造时会按模式长度降序（等长保持原顺序）排序。
+     */
+    BA_API explicit PermissionRuleSnapshot(std::vector<CompiledPermissionRule> unsortedRules);
+    /**
+     * @brief 从其他快照中的规则构建快照。规则集命中驻留表时不复制任何规则。
+     * @param rulesByPattern 按模式字典序排列、模式互不相同的规则，构造时原地按优先级重新排序。
+     */
+    BA_API explicit PermissionRuleSnapshot(std::span<const CompiledPermissionRule*> rulesByPattern);
+
+    /**
+     * @brief 按匹配优先级排序规则：模式长度降序，等长时保持原顺序。
+     * @param rules 要原地排序的规则。
+     */
+    BA_API static void sortByPriority(std::vector<CompiledPermissionRule>& rules);
+
+    /**
+     * @brief 匹配权限节点。
+     * @param node 权限节点。
+     * @return 命中规则的状态；没有规则匹配时返回 std::nullopt。
+     */
+    std::optional<bool> evaluate(std::string_view node) const {
+        const CompiledPermissionRule* rule = find(node);
+        if (!rule) return std::nullopt;
+        return rule->state;
+    }
+
+    /**
+     * @brief 查找与节点匹配的最高优先级规则。
+     * @param node 权限节点。
+     * @return 命中的规则；没有规则匹配时返回 nullptr。
+     */
+    const CompiledPermissionRule* find(std::string_view node) const {
+        int32_t index = matcher.match(node);
+        return index == PermissionMatcher::NO_MATCH ? nullptr : &rules[index];
+    }
+
+    /**
+     * @brief 估算快照自身占用的内存字节数，不含共享的规则集（规则集的占用见 CacheStats::internedRuleSetBytes）。
+     */
+    BA_API size_t memoryUsage() const;
+};
+
+/**
+ * @brief 玩家对前 count 个已注册权限ID的最终结果（组规则与默认权限合并后），按位存储。
+ *        由所属的玩家快照持有，默认权限版本变化或出现更大的ID时整体重建。
+ */
+struct PermissionBits {
+    std::vector<uint64_t> words;
+    size_t                count           = 0; // 覆盖的权限ID数量，ID 不小于它时需重建
+    uint64_t              defaultsVersion = 0; // 计算时的默认权限版本
+
+    PermissionBits(size_t count, uint64_t defaultsVersion)
+    : words((count + 63) / 64, 0),
+      count(count),
+      defaultsVersion(defaultsVersion) {}
+
+    void set(PermissionId id) { words[id / 64] |= uint64_t(1) << (id % 64); }
+    bool test(PermissionId id) const { return (words[id / 64] >> (id % 64)) & 1; }
+};
+
+/**
+ * @brief 组名及其代数。所有条目与组名紧凑地存放在一块连续内存中，随快照一次分配、一次释放。
+ */
+class GroupGenerations {
+public:
+    struct Entry {
+        std::string_view group;      // 指向同一块内存中的组名
+        uint64_t         generation;
+    };
+
+    GroupGenerations() = default;
+    /**
+     * @param entries 组名与代数；组名会被复制进连续内存，调用方的字符串无需在之后保持有效。
+     */
+    BA_API explicit GroupGenerations(std::span<const Entry> entries);
+
+    const Entry* begin() const { return m_entries; }
+    const Entry* end() const { return m_entries + m_count; }
+    size_t       size() const { return m_count; }
+    bool         empty() const { return m_count == 0; }
+    size_t       memoryUsage() const { return m_bytes; }
+
+private:
+    std::unique_ptr<std::byte[]> m_block;             // Entry 数组之后紧跟各组名的字符
+    const Entry*                 m_entries = nullptr;
+    size_t                       m_count   = 0;
+    size_t                       m_bytes   = 0;
+};
+
+/**
+ * @brief 玩家快照构建时所依赖的组代数。
+ *        组被修改时只递增该组及其子组的代数，查找时比较代数即可判断快照是否过期，无需逐个使玩家缓存失效。
+ */
+struct GroupGenerationStamp {
+    GroupGenerations              groupGenerations;  // 构建时依赖的组及其代数
+    mutable std::atomic<uint64_t> validatedEpoch{0}; // 最近一次确认未过期时的全局组纪元
+
+    GroupGenerationStamp() = default;
+    GroupGenerationStamp(uint64_t epoch, GroupGenerations generations)
+    : groupGenerations(std::move(generations)),
+      validatedEpoch(epoch) {}
+
+    size_t memoryUsage() const { return groupGenerations.memoryUsage(); }
+};
+
+// 玩家由权限组得出的权限快照（不含默认权限，默认权限由 DefaultPermissionLayer 统一提供）
+struct PlayerPermissionSnapshot : PermissionRuleSnapshot, GroupGenerationStamp {
+    explicit PlayerPermissionSnapshot(
+        std::vector<CompiledPermissionRule> unsortedRules,
+        uint64_t                            epoch       = 0,
+        GroupGenerations                    generations = {}
+    )
+    : PermissionRuleSnapshot(std::move(unsortedRules)),
+      GroupGenerationStamp(epoch, std::move(generations)) {}
+    // 从组权限层归并出的规则构建，见 GroupPermissionSnapshot::merge
+    PlayerPermissionSnapshot(
+        std::span<const CompiledPermissionRule*> rulesByPattern,
+        uint64_t                                 epoch,
+        GroupGenerations                         generations
+    )
+    : PermissionRuleSnapshot(rulesByPattern),
+      GroupGenerationStamp(epoch, std::move(generations)) {}
+
+    /**
+     * @brief 在按权限ID预先计算的位集中查找结果，不加锁。
+     * @param id 权限ID。
+     * @param defaultsVersion 当前的默认权限版本。
+     * @return 位集未计算、已过期或未覆盖该ID时返回 std::nullopt。
+     */
+    std::optional<bool> testPermission(PermissionId id, uint64_t defaultsVersion) const {
+        auto bits = m_bits.load(std::memory_order_acquire);
+        if (!bits || bits->defaultsVersion != defaultsVersion || id >= bits->count) return std::nullopt;
+        return bits->test(id);
+    }
+
+    /**
+     * @brief 发布新计算的位集。并发计算时保留默认权限版本更新、覆盖范围更大的结果。
+     *        只保留当前的位集，被替换的位集在最后一个读者用完后释放。
+     * @param bits 计算结果。
+     */
+    void publishPermissionBits(std::shared_ptr<const PermissionBits> bits) const {
+        std::lock_guard<std::mutex> lock(m_bitsMutex);
+        auto                        current = m_bits.load(std::memory_order_relaxed);
+        if (current
+            && (current->defaultsVersion > bits->defaultsVersion
+                || (current->defaultsVersion == bits->defaultsVersion && current->count >= bits->count))) {
+            return;
+        }
+        m_bits.store(std::move(bits), std::memory_order_release);
+    }
+
+private:
+    mutable std::atomic<std::shared_ptr<const PermissionBits>> m_bits;      // 当前的位集
+    mutable std::mutex                                         m_bitsMutex; // 串行化位集的发布
+};
+
+// 组权限层中的一条规则：模式、状态与决定该状态的组（自身或祖先）的优先级
+struct RankedPermissionRule {
+    std::string pattern;
+    bool        state;
+    int         priority;
+};
+
+/**
+ * @brief 权限组（含继承）的最终生效权限快照，同时作为构建玩家快照的一层。
+ *        除匹配用的规则外还按模式字典序保存每条规则及其来源组的优先级，玩家快照由其所属组的层
+ *        按模式归并得到：同一模式取优先级最高的一层，结果与把所有祖先组的直接权限按优先级叠加相同。
+ */
+struct GroupPermissionSnapshot : PermissionRuleSnapshot {
+    struct LayerEntry {
+        const CompiledPermissionRule* rule;     // 指向 rules 中的规则
+        int                           priority; // 决定该规则状态的组的优先级
+    };
+    std::vector<LayerEntry> layer; // 按模式字典序排列
+
+    /**
+     * @brief 构建组权限快照。
+     * @param rankedRules 按模式字典序排列、模式互不相同的规则。
+     */
+    BA_API explicit GroupPermissionSnapshot(const std::vector<RankedPermissionRule>& rankedRules);
+
+    /**
+     * @brief 按模式字典序返回规则及其优先级，用于写入缓存快照文件。
+     */
+    BA_API std::vector<RankedPermissionRule> rankedRules() const;
+
+    /**
+     * @brief 把多个组权限层归并为玩家的规则：同一模式取优先级最高的层，优先级相同时取靠后的层。
+     *        结果只引用各层中的规则，不复制模式字符串。
+     * @param layers 玩家直接所属组的权限层。
+     * @param out 按模式字典序追加指向各层规则的指针，临时数据从它的内存资源分配。
+     */
+    BA_API static void merge(
+        std::span<const std::shared_ptr<const GroupPermissionSnapshot>> layers,
+        std::pmr::vector<const CompiledPermissionRule*>&                out
+    );
+
+    BA_API size_t memoryUsage() const;
+};
+
+/**
+ * @brief 全局共享的默认权限层，包含所有默认值为 true 的权限。
+ *        所有玩家共用同一份，默认值变化时整体替换并递增版本号，无需重建任何玩家快照。
+ */
+struct DefaultPermissionLayer {
+    uint64_t               version; // 构建时的默认权限版本
+    PermissionRuleSnapshot rules;   // 默认值为 true 的权限规则
+
+    DefaultPermissionLayer(uint64_t version, std::vector<CompiledPermissionRule> defaultRules)
+    : version(version),
+      rules(std::move(defaultRules)) {}
+};
+
+// 玩家所属组列表快照，可直接当作 std::vector<GroupDetails> 使用
+struct PlayerGroupsSnapshot : std::vector<GroupDetails>, GroupGenerationStamp {
+    bool complete = true; // 从存储层读取失败时为 false，这样的快照不会被缓存
+
+    explicit PlayerGroupsSnapshot(std::vector<GroupDetails> groups, uint64_t epoch = 0, GroupGenerations generations = {})
+    : std::vector<GroupDetails>(std::move(groups)),
+      GroupGenerationStamp(epoch, std::move(generations)) {}
+};
+
+} // namespace permission
+} // namespace BA
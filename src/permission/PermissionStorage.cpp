@@ -1,7 +1,12 @@
 #include "permission/PermissionStorage.h"
 #include "db/IDatabase.h"
+#include "permission/Metrics.h"
+#include "permission/Trace.h"
 #include "ll/api/io/Logger.h"
 #include "ll/api/mod/NativeMod.h"
+#include <algorithm>
+#include <chrono>
+#include <map>
 #include <string> 
 #include <vector> 
 #include <unordered_map> 
@@ -11,6 +16,89 @@ namespace BA {
 namespace permission {
 namespace internal {
 
+namespace {
+
+// 语句耗时同时记入直方图与追踪缓冲区。name 必须是字符串字面量，追踪记录中只保存它的地址
+class StatementTimer {
+public:
+    explicit StatementTimer(const char* name)
+    : m_name(name),
+      m_histogram(Metrics::getInstance().statementLatency(name)),
+      m_start(Tracer::now()) {}
+    ~StatementTimer() {
+        uint64_t elapsed = Tracer::now() - m_start;
+        m_histogram.record(elapsed);
+        Tracer::getInstance().recordLabel(TraceEvent::STATEMENT, m_name, elapsed);
+    }
+    StatementTimer(const StatementTimer&)            = delete;
+    StatementTimer& operator=(const StatementTimer&) = delete;
+
+private:
+    const char*       m_name;
+    LatencyHistogram& m_histogram;
+    uint64_t          m_start;
+};
+
+// 热点语句，查询方法与 explainHotStatements 共用，修改时需保证迁移创建的索引仍能覆盖它们
+constexpr const char* SQL_PLAYER_GROUPS_WITH_DETAILS =
+    "SELECT pg.id, pg.name, pg.description, pg.priority, pgr.expiry_timestamp "
+    "FROM permission_groups pg "
+    "JOIN player_groups pgr ON pg.id = pgr.group_id "
+    "WHERE pgr.player_uuid = ? AND (pgr.expiry_timestamp IS NULL OR pgr.expiry_timestamp > ?);";
+constexpr const char* SQL_PLAYERS_IN_GROUP = "SELECT player_uuid FROM player_groups WHERE group_id = ?;";
+// 分页变体，由调用方追加 LIMIT/OFFSET
+constexpr const char* SQL_PLAYERS_IN_GROUP_PAGE =
+    "SELECT player_uuid FROM player_groups WHERE group_id = ? ORDER BY player_uuid";
+constexpr const char* SQL_GROUP_PERMISSIONS = "SELECT permission_rule FROM group_permissions WHERE group_id = ?;";
+constexpr const char* SQL_EXPIRED_PLAYERS =
+    "SELECT DISTINCT player_uuid FROM player_groups WHERE expiry_timestamp IS NOT NULL AND expiry_timestamp <= ?;";
+constexpr const char* SQL_PLAYER_GROUP_EXPIRATIONS =
+    "SELECT player_uuid, group_id, expiry_timestamp FROM player_groups WHERE expiry_timestamp IS NOT NULL;";
+
+/**
+ * @brief 把架构从 toVersion - 1 迁移到 toVersion 的语句。每条语句都必须可重复执行，
+ *        因为某一步中途失败后会在下次启动时整步重试。
+ */
+std::vector<std::string> schemaMigrationStatements(db::IDatabase& db, int toVersion) {
+    switch (toVersion) {
+    case 1:
+        return {
+            // fetchPlayerGroupsWithDetails(Batch)：按玩家等值查找、在索引内过滤过期时间，连接所需的 group_id 也在索引中
+            db.getCreateIndexSql("idx_player_groups_uuid_expiry_group", "player_groups", "player_uuid, expiry_timestamp, group_id"),
+            // fetchPlayersInGroup(s) 及分页：按组等值查找，玩家已按序排列，无需回表和排序
+            db.getCreateIndexSql("idx_player_groups_group_uuid", "player_groups", "group_id, player_uuid"),
+            // 到期清理与到期队列加载：只索引带过期时间的行，不支持部分索引的数据库退化为普通索引
+            db.getCreatePartialIndexSql(
+                "idx_player_groups_expiring",
+                "player_groups",
+                "expiry_timestamp, player_uuid, group_id",
+                "expiry_timestamp IS NOT NULL"
+            ),
+            // 以下单列索引已是上面复合索引或主键的前缀，删除以减少写入开销（必须在新索引创建之后）
+            db.getDropIndexSql("idx_player_groups_uuid", "player_groups"),
+            db.getDropIndexSql("idx_player_groups_expiry_timestamp", "player_groups"),
+            db.getDropIndexSql("idx_group_permissions_group_id", "group_permissions"),
+        };
+    default:
+        return {};
+    }
+}
+
+// 把语句中的 ? 依次替换为已转义好的字面量，仅用于 EXPLAIN 的示例参数
+std::string inlineParams(const std::string& sql, const std::vector<std::string>& literals) {
+    std::string result;
+    size_t      next = 0;
+    for (char c : sql) {
+        if (c == '?' && next < literals.size()) {
+            result += literals[next++];
+        } else {
+            result += c;
+        }
+    }
+    return result;
+}
+
+} // namespace
 
 /**
  * @brief 权限存储类的构造函数。
@@ -125,14 +213,7 @@ bool PermissionStorage::ensureTables() {
         m_db->getCreateIndexSql("idx_permission_groups_name", "permission_groups", "name"),
         "在 permission_groups.name 上创建索引"
     );
-    executeAndLog(
-        m_db->getCreateIndexSql("idx_player_groups_uuid", "player_groups", "player_uuid"),
-        "在 player_groups.player_uuid 上创建索引"
-    );
-    executeAndLog(
-        m_db->getCreateIndexSql("idx_group_permissions_group_id", "group_permissions", "group_id"),
-        "在 group_permissions.group_id 上创建索引"
-    );
+    // player_groups 的复合索引由架构迁移创建，见 migrateSchema
 
     executeAndLog(
         m_db->getCreateIndexSql("idx_group_inheritance_group_id", "group_inheritance", "group_id"),
@@ -143,15 +224,150 @@ bool PermissionStorage::ensureTables() {
         "在 group_inheritance.parent_group_id 上创建索引"
     );
 
+    // 玩家最近上线时间，用于启动时预热最近活跃的玩家
+    executeAndLog(
+        m_db->getCreateTableSql(
+            "player_last_seen",
+            "player_uuid VARCHAR(36) NOT NULL PRIMARY KEY, "
+            "last_seen BIGINT NOT NULL"
+        ),
+        "创建玩家最近上线时间表"
+    );
+    executeAndLog(
+        m_db->getCreateIndexSql("idx_player_last_seen_last_seen", "player_last_seen", "last_seen"),
+        "在 player_last_seen.last_seen 上创建索引"
+    );
+
+    // 变更水位：组、组权限、继承与权限定义每被修改一次递增一次，用于判断缓存快照文件是否过期
+    executeAndLog(
+        m_db->getCreateTableSql("change_watermark", "id INT NOT NULL PRIMARY KEY, version BIGINT NOT NULL"),
+        "创建变更水位表"
+    );
+    executeAndLog(
+        m_db->getInsertOrIgnoreSql("change_watermark", "id, version", "1, 0", "id"),
+        "初始化变更水位"
+    );
+
+    // 缓存失效日志：多台服务器共用一个数据库时，各自写入本机产生的失效任务并轮询其他服务器写入的记录
+    executeAndLog(
+        m_db->getCreateTableSql(
+            "cache_invalidation_log",
+            "id " + m_db->getAutoIncrementPrimaryKeyDefinition() + ", "
+            "origin VARCHAR(64) NOT NULL, "
+            "task_type INT NOT NULL, "
+            "data TEXT NOT NULL, "
+            "players TEXT NOT NULL, "
+            "created_at BIGINT NOT NULL"
+        ),
+        "创建缓存失效日志表"
+    );
+    executeAndLog(
+        m_db->getCreateIndexSql("idx_cache_invalidation_log_created_at", "cache_invalidation_log", "created_at"),
+        "在 cache_invalidation_log.created_at 上创建索引"
+    );
+
+    // 架构版本：记录已执行的迁移步骤，见 migrateSchema
     executeAndLog(
-        m_db->getCreateIndexSql("idx_player_groups_expiry_timestamp", "player_groups", "expiry_timestamp"),
-        "在 player_groups.expiry_timestamp 上创建索引"
+        m_db->getCreateTableSql("schema_version", "id INT NOT NULL PRIMARY KEY, version INT NOT NULL"),
+        "创建架构版本表"
     );
+    executeAndLog(m_db->getInsertOrIgnoreSql("schema_version", "id, version", "1, 0", "id"), "初始化架构版本");
+    migrateSchema();
 
     logger.debug("存储: 表格确保完成。");
     return true;
 }
 
+
+// --- 架构迁移与查询计划 ---
+/**
+ * @brief 获取数据库记录的架构版本。
+ * @return 架构版本；读取失败时返回 std::nullopt。
+ */
+std::optional<int> PermissionStorage::fetchSchemaVersion() {
+    if (!m_db) return std::nullopt;
+    std::optional<int> version;
+    m_db->queryPrepared("SELECT version FROM schema_version WHERE id = 1;", {}, [&version](const db::RowView& row) {
+        if (auto value = row.getOptionalInt64(0)) version = static_cast<int>(*value);
+        return false;
+    });
+    return version;
+}
+
+/**
+ * @brief 依次执行数据库记录的架构版本之后的迁移步骤。
+ * @return 数据库架构已不低于 SCHEMA_VERSION 时返回 true。
+ */
+bool PermissionStorage::migrateSchema() {
+    auto& logger = ::ll::mod::NativeMod::current()->getLogger();
+    if (!m_db) return false;
+    auto current = fetchSchemaVersion();
+    if (!current) {
+        logger.error("存储: 无法读取架构版本，跳过架构迁移。");
+        return false;
+    }
+    if (*current > SCHEMA_VERSION) {
+        logger.warn("存储: 数据库架构版本 {} 高于当前支持的版本 {}，可能由更新版本的插件写入。", *current, SCHEMA_VERSION);
+        return true;
+    }
+    for (int version = *current + 1; version <= SCHEMA_VERSION; ++version) {
+        logger.info("存储: 正在迁移数据库架构 {} -> {}...", version - 1, version);
+        for (const auto& sql : schemaMigrationStatements(*m_db, version)) {
+            if (!m_db->execute(sql)) {
+                logger.error("存储: 迁移到架构版本 {} 失败，将在下次启动时重试。语句: {}", version, sql);
+                return false;
+            }
+        }
+        // 只前进不后退：共用数据库的其他服务器可能已迁移到更高版本
+        std::string versionText = std::to_string(version);
+        if (!m_db->executePrepared(
+                "UPDATE schema_version SET version = ? WHERE id = 1 AND version < ?;",
+                {versionText, versionText}
+            )) {
+            logger.error("存储: 更新架构版本到 {} 失败，将在下次启动时重试。", version);
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief 对热点语句执行 EXPLAIN，用于确认它们使用覆盖索引。
+ * @return 每条热点语句的查询计划。
+ */
+std::vector<QueryPlan> PermissionStorage::explainHotStatements() {
+    if (!m_db) return {};
+    // 示例参数：不存在的玩家与组同样能得到真实的访问路径
+    const std::string player = "'00000000-0000-0000-0000-000000000000'";
+    const std::string group  = "0";
+    const std::string now    = std::to_string(
+        std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count()
+    );
+    const std::pair<const char*, std::string> statements[] = {
+        {"fetchPlayerGroupsWithDetails", inlineParams(SQL_PLAYER_GROUPS_WITH_DETAILS, {player, now})},
+        {"fetchPlayersInGroup",          inlineParams(SQL_PLAYERS_IN_GROUP, {group})                 },
+        {"fetchPlayersInGroupPage",      inlineParams(SQL_PLAYERS_IN_GROUP_PAGE, {group}) + " LIMIT 100 OFFSET 0;"},
+        {"fetchDirectPermissionsOfGroup", inlineParams(SQL_GROUP_PERMISSIONS, {group})               },
+        {"deleteExpiredPlayerGroups",    inlineParams(SQL_EXPIRED_PLAYERS, {now})                    },
+        {"fetchPlayerGroupExpirations",  SQL_PLAYER_GROUP_EXPIRATIONS                                },
+    };
+
+    std::vector<QueryPlan> plans;
+    for (const auto& [name, sql] : statements) {
+        QueryPlan plan{name, sql, {}};
+        for (const auto& row : m_db->query(m_db->getExplainSql(sql))) {
+            std::string line;
+            for (size_t i = 0; i < row.size(); ++i) {
+                if (i > 0) line += " | ";
+                line += row[i];
+            }
+            plan.lines.push_back(std::move(line));
+        }
+        plans.push_back(std::move(plan));
+    }
+    return plans;
+}
+
 // --- 权限管理 ---
 /**
  * @brief 插入或更新权限。
@@ -161,6 +377,7 @@ bool PermissionStorage::ensureTables() {
  * @return 如果操作成功，则返回 true；否则返回 false。
  */
 bool PermissionStorage::upsertPermission(const std::string& name, const std::string& description, bool defaultValue) {
+    StatementTimer timer("upsertPermission");
     if (!m_db) return false;
     std::string defaultValueStr = defaultValue ? "1" : "0";
     std::string insertSql = m_db->getInsertOrIgnoreSql("permissions", "name, description, default_value", "?, ?, ?", "name");
@@ -168,7 +385,11 @@ bool PermissionStorage::upsertPermission(const std::string& name, const std::str
         return false;
     }
     std::string updateSql = "UPDATE permissions SET description = ?, default_value = ? WHERE name = ?;";
-    return m_db->executePrepared(updateSql, {description, defaultValueStr, name});
+    if (!m_db->executePrepared(updateSql, {description, defaultValueStr, name})) {
+        return false;
+    }
+    bumpChangeWatermark();
+    return true;
 }
 
 /**
@@ -177,6 +398,7 @@ bool PermissionStorage::upsertPermission(const std::string& name, const std::str
  * @return 如果权限存在，则返回 true；否则返回 false。
  */
 bool PermissionStorage::permissionExists(const std::string& name) {
+    StatementTimer timer("permissionExists");
     if (!m_db) return false;
     std::string sql = "SELECT 1 FROM permissions WHERE name = ? LIMIT 1;";
     return !m_db->queryPrepared(sql, {name}).empty();
@@ -187,6 +409,7 @@ bool PermissionStorage::permissionExists(const std::string& name) {
  * @return 包含所有权限名称的字符串向量。
  */
 std::vector<std::string> PermissionStorage::fetchAllPermissionNames() {
+    StatementTimer timer("fetchAllPermissionNames");
     if (!m_db) return {};
     std::vector<std::string> list;
     std::string         sql  = "SELECT name FROM permissions;";
@@ -201,6 +424,7 @@ std::vector<std::string> PermissionStorage::fetchAllPermissionNames() {
  * @return 包含所有默认权限名称的字符串向量。
  */
 std::vector<std::string> PermissionStorage::fetchDefaultPermissionNames() {
+    StatementTimer timer("fetchDefaultPermissionNames");
     if (!m_db) return {};
     std::vector<std::string> list;
     std::string         sql  = "SELECT name FROM permissions WHERE default_value = 1;";
@@ -215,22 +439,16 @@ std::vector<std::string> PermissionStorage::fetchDefaultPermissionNames() {
  * @return 权限名称到其默认值的映射。
  */
 std::unordered_map<std::string, bool> PermissionStorage::fetchAllPermissionDefaults() {
+    StatementTimer timer("fetchAllPermissionDefaults");
     if (!m_db) return {};
     std::unordered_map<std::string, bool> defaults;
     std::string                      sql  = "SELECT name, default_value FROM permissions;";
-    auto                        rows = m_db->queryPrepared(sql, {});
-    for (const auto& row : rows) {
-        if (row.size() >= 2 && !row[0].empty() && !row[1].empty()) {
-            try {
-                defaults[row[0]] = (std::stoi(row[1]) != 0);
-            } catch (const std::exception& e) {
-                ::ll::mod::NativeMod::current()->getLogger().warn(
-                    "权限存储: 无法将权限 '{}' 的默认值 '{}' 转换为整数: {}",
-                    row[0], row[1], e.what()
-                );
-            }
+    m_db->queryPrepared(sql, {}, [&defaults](const db::RowView& row) {
+        if (row.columnCount() >= 2 && !row.getText(0).empty() && !row.isNull(1)) {
+            defaults[row.getString(0)] = row.getInt64(1) != 0;
         }
-    }
+        return true;
+    });
     return defaults;
 }
 
@@ -247,10 +465,12 @@ bool PermissionStorage::createGroup(
     const std::string& description,
     std::string&       outGroupId
 ) {
+    StatementTimer timer("createGroup");
     if (!m_db) return false;
     std::string insertSql = m_db->getInsertOrIgnoreSql("permission_groups", "name, description", "?, ?", "name");
-    m_db->executePrepared(insertSql, {groupName, description}); // 忽略结果，只尝试执行。
-    outGroupId = fetchGroupIdByName(groupName);
+    bool inserted = m_db->executePrepared(insertSql, {groupName, description}); // 忽略结果，只尝试执行。
+    outGroupId    = fetchGroupIdByName(groupName);
+    if (inserted && !outGroupId.empty()) bumpChangeWatermark();
     return !outGroupId.empty();
 }
 
@@ -260,10 +480,11 @@ bool PermissionStorage::createGroup(
  * @return 如果用户组删除成功，则返回 true；否则返回 false。
  */
 bool PermissionStorage::deleteGroup(const std::string& groupId) {
+    StatementTimer timer("deleteGroup");
     if (!m_db) return false;
     // 外键上的 ON DELETE CASCADE 将处理相关表的清理。
     std::string sql = "DELETE FROM permission_groups WHERE id = ?;";
-    return m_db->executePrepared(sql, {groupId});
+    return executeAndBumpWatermark(sql, {groupId});
 }
 
 /**
@@ -272,6 +493,7 @@ bool PermissionStorage::deleteGroup(const std::string& groupId) {
  * @return 用户组ID，如果不存在则返回空字符串。
  */
 std::string PermissionStorage::fetchGroupIdByName(const std::string& groupName) {
+    StatementTimer timer("fetchGroupIdByName");
     if (!m_db) return "";
     std::string sql  = "SELECT id FROM permission_groups WHERE name = ? LIMIT 1;";
     auto   rows = m_db->queryPrepared(sql, {groupName});
@@ -284,6 +506,7 @@ std::string PermissionStorage::fetchGroupIdByName(const std::string& groupName)
  * @return 包含所有用户组名称的字符串向量。
  */
 std::vector<std::string> PermissionStorage::fetchAllGroupNames() {
+    StatementTimer timer("fetchAllGroupNames");
     if (!m_db) return {};
     std::vector<std::string> list;
     std::string         sql  = "SELECT name FROM permission_groups;";
@@ -299,6 +522,7 @@ std::vector<std::string> PermissionStorage::fetchAllGroupNames() {
  * @return 如果用户组存在，则返回 true；否则返回 false。
  */
 bool PermissionStorage::groupExists(const std::string& groupName) {
+    StatementTimer timer("groupExists");
     if (!m_db) return false;
     std::string sql = "SELECT 1 FROM permission_groups WHERE name = ? LIMIT 1;";
     return !m_db->queryPrepared(sql, {groupName}).empty();
@@ -310,6 +534,7 @@ bool PermissionStorage::groupExists(const std::string& groupName) {
  * @return 用户组详细信息对象。
  */
 GroupDetails PermissionStorage::fetchGroupDetails(const std::string& groupName) {
+    StatementTimer timer("fetchGroupDetails");
     if (!m_db) return {};
     std::string sql  = "SELECT id, name, description, priority FROM permission_groups WHERE name = ? LIMIT 1;";
     auto   rows = m_db->queryPrepared(sql, {groupName});
@@ -334,6 +559,7 @@ GroupDetails PermissionStorage::fetchGroupDetails(const std::string& groupName)
  * @return 用户组优先级。
  */
 int PermissionStorage::fetchGroupPriority(const std::string& groupName) {
+    StatementTimer timer("fetchGroupPriority");
     if (!m_db) return 0;
     std::string sql  = "SELECT priority FROM permission_groups WHERE name = ? LIMIT 1;";
     auto   rows = m_db->queryPrepared(sql, {groupName});
@@ -356,9 +582,10 @@ int PermissionStorage::fetchGroupPriority(const std::string& groupName) {
  * @return 如果更新成功，则返回 true；否则返回 false。
  */
 bool PermissionStorage::updateGroupPriority(const std::string& groupName, int priority) {
+    StatementTimer timer("updateGroupPriority");
     if (!m_db) return false;
     std::string sql = "UPDATE permission_groups SET priority = ? WHERE name = ?;";
-    return m_db->executePrepared(sql, {std::to_string(priority), groupName});
+    return executeAndBumpWatermark(sql, {std::to_string(priority), groupName});
 }
 
 /**
@@ -368,6 +595,7 @@ bool PermissionStorage::updateGroupPriority(const std::string& groupName, int pr
  * @return 如果更新成功，则返回 true；否则返回 false。
  */
 bool PermissionStorage::updateGroupDescription(const std::string& groupName, const std::string& newDescription) {
+    StatementTimer timer("updateGroupDescription");
     if (!m_db) return false;
     std::string sql = "UPDATE permission_groups SET description = ? WHERE name = ?;";
     return m_db->executePrepared(sql, {newDescription, groupName});
@@ -379,6 +607,7 @@ bool PermissionStorage::updateGroupDescription(const std::string& groupName, con
  * @return 用户组描述，如果不存在则返回空字符串。
  */
 std::string PermissionStorage::fetchGroupDescription(const std::string& groupName) {
+    StatementTimer timer("fetchGroupDescription");
     if (!m_db) return "";
     std::string sql  = "SELECT description FROM permission_groups WHERE name = ? LIMIT 1;";
     auto   rows = m_db->queryPrepared(sql, {groupName});
@@ -394,6 +623,7 @@ std::string PermissionStorage::fetchGroupDescription(const std::string& groupNam
  * @return 如果添加成功，则返回 true；否则返回 false。
  */
 bool PermissionStorage::addPermissionToGroup(const std::string& groupId, const std::string& permissionRule) {
+    StatementTimer timer("addPermissionToGroup");
     if (!m_db) return false;
     std::string insertSql = m_db->getInsertOrIgnoreSql(
         "group_permissions",
@@ -401,7 +631,7 @@ bool PermissionStorage::addPermissionToGroup(const std::string& groupId, const s
         "?, ?",
         "group_id, permission_rule"
     );
-    return m_db->executePrepared(insertSql, {groupId, permissionRule});
+    return executeAndBumpWatermark(insertSql, {groupId, permissionRule});
 }
 
 /**
@@ -411,9 +641,10 @@ bool PermissionStorage::addPermissionToGroup(const std::string& groupId, const s
  * @return 如果移除成功，则返回 true；否则返回 false。
  */
 bool PermissionStorage::removePermissionFromGroup(const std::string& groupId, const std::string& permissionRule) {
+    StatementTimer timer("removePermissionFromGroup");
     if (!m_db) return false;
     std::string sql = "DELETE FROM group_permissions WHERE group_id = ? AND permission_rule = ?;";
-    return m_db->executePrepared(sql, {groupId, permissionRule});
+    return executeAndBumpWatermark(sql, {groupId, permissionRule});
 }
 
 /**
@@ -422,10 +653,10 @@ bool PermissionStorage::removePermissionFromGroup(const std::string& groupId, co
  * @return 包含用户组直接权限规则的字符串向量。
  */
 std::vector<std::string> PermissionStorage::fetchDirectPermissionsOfGroup(const std::string& groupId) {
+    StatementTimer timer("fetchDirectPermissionsOfGroup");
     if (!m_db) return {};
     std::vector<std::string> perms;
-    std::string         sql  = "SELECT permission_rule FROM group_permissions WHERE group_id = ?;";
-    auto           rows = m_db->queryPrepared(sql, {groupId});
+    auto           rows = m_db->queryPrepared(SQL_GROUP_PERMISSIONS, {groupId});
     for (auto& row : rows)
         if (!row.empty()) perms.push_back(row[0]);
     return perms;
@@ -438,6 +669,7 @@ std::vector<std::string> PermissionStorage::fetchDirectPermissionsOfGroup(const
  */
 std::unordered_map<std::string, std::vector<std::string>>
 PermissionStorage::fetchDirectPermissionsOfGroups(const std::vector<std::string>& groupIds) {
+    StatementTimer timer("fetchDirectPermissionsOfGroups");
     if (!m_db) return {};
     return m_db->fetchDirectPermissionsOfGroups(groupIds);
 }
@@ -450,6 +682,7 @@ PermissionStorage::fetchDirectPermissionsOfGroups(const std::vector<std::string>
  * @return 如果添加成功，则返回 true；否则返回 false。
  */
 bool PermissionStorage::addGroupInheritance(const std::string& groupId, const std::string& parentGroupId) {
+    StatementTimer timer("addGroupInheritance");
     if (!m_db) return false;
     std::string insertSql = m_db->getInsertOrIgnoreSql(
         "group_inheritance",
@@ -457,7 +690,7 @@ bool PermissionStorage::addGroupInheritance(const std::string& groupId, const st
         "?, ?",
         "group_id, parent_group_id"
     );
-    return m_db->executePrepared(insertSql, {groupId, parentGroupId});
+    return executeAndBumpWatermark(insertSql, {groupId, parentGroupId});
 }
 
 /**
@@ -467,9 +700,10 @@ bool PermissionStorage::addGroupInheritance(const std::string& groupId, const st
  * @return 如果移除成功，则返回 true；否则返回 false。
  */
 bool PermissionStorage::removeGroupInheritance(const std::string& groupId, const std::string& parentGroupId) {
+    StatementTimer timer("removeGroupInheritance");
     if (!m_db) return false;
     std::string sql = "DELETE FROM group_inheritance WHERE group_id = ? AND parent_group_id = ?;";
-    return m_db->executePrepared(sql, {groupId, parentGroupId});
+    return executeAndBumpWatermark(sql, {groupId, parentGroupId});
 }
 
 /**
@@ -477,18 +711,19 @@ bool PermissionStorage::removeGroupInheritance(const std::string& groupId, const
  * @return 父用户组ID到其子用户组ID集合的映射。
  */
 std::unordered_map<std::string, std::set<std::string>> PermissionStorage::fetchAllInheritance() {
+    StatementTimer timer("fetchAllInheritance");
     if (!m_db) return {};
     std::unordered_map<std::string, std::set<std::string>> parentToChildren;
     std::string                             sql  = "SELECT T1.name AS child_name, T2.name AS parent_name "
                                               "FROM group_inheritance gi "
                                               "JOIN permission_groups T1 ON gi.group_id = T1.id "
                                               "JOIN permission_groups T2 ON gi.parent_group_id = T2.id;";
-    auto                               rows = m_db->queryPrepared(sql, {});
-    for (const auto& row : rows) {
-        if (row.size() >= 2 && !row[0].empty() && !row[1].empty()) {
-            parentToChildren[row[1]].insert(row[0]); // parent -> set<child>
+    m_db->queryPrepared(sql, {}, [&parentToChildren](const db::RowView& row) {
+        if (row.columnCount() >= 2 && !row.getText(0).empty() && !row.getText(1).empty()) {
+            parentToChildren[row.getString(1)].insert(row.getString(0)); // parent -> set<child>
         }
-    }
+        return true;
+    });
     return parentToChildren;
 }
 
@@ -509,6 +744,7 @@ bool PermissionStorage::addPlayerToGroup(
     const std::string&              groupId,
     const std::optional<long long>& expiryTimestamp
 ) {
+    StatementTimer timer("addPlayerToGroup");
     if (!m_db) return false;
 
     // 这是一个通用的“插入或更新”逻辑
@@ -536,6 +772,7 @@ bool PermissionStorage::addPlayerToGroup(
  * @return 如果移除成功，则返回 true；否则返回 false。
  */
 bool PermissionStorage::removePlayerFromGroup(const std::string& playerUuid, const std::string& groupId) {
+    StatementTimer timer("removePlayerFromGroup");
     if (!m_db) return false;
     std::string sql = "DELETE FROM player_groups WHERE player_uuid = ? AND group_id = ?;";
     return m_db->executePrepared(sql, {playerUuid, groupId});
@@ -544,41 +781,32 @@ bool PermissionStorage::removePlayerFromGroup(const std::string& playerUuid, con
 /**
  * @brief 获取玩家所属的用户组及其详细信息。
  * @param playerUuid 玩家UUID。
+ * @param ok 不为空时写入查询是否成功。
  * @return 包含玩家所属用户组详细信息的向量。
  */
-std::vector<GroupDetails> PermissionStorage::fetchPlayerGroupsWithDetails(const std::string& playerUuid) {
+std::vector<GroupDetails> PermissionStorage::fetchPlayerGroupsWithDetails(const std::string& playerUuid, bool* ok) {
+    StatementTimer timer("fetchPlayerGroupsWithDetails");
+    if (ok) *ok = false;
     if (!m_db) return {};
     std::vector<GroupDetails> playerGroupDetails;
 
     long long currentTime =
         std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count();
 
-    // 修改SQL查询以选择 expiry_timestamp 并过滤过期的记录
-    std::string sql =
-        "SELECT pg.id, pg.name, pg.description, pg.priority, pgr.expiry_timestamp " // <-- 添加 pgr.expiry_timestamp
-        "FROM permission_groups pg "
-        "JOIN player_groups pgr ON pg.id = pgr.group_id "
-        "WHERE pgr.player_uuid = ? AND (pgr.expiry_timestamp IS NULL OR pgr.expiry_timestamp > ?);";
-
-    auto rows = m_db->queryPrepared(sql, {playerUuid, std::to_string(currentTime)});
-    for (const auto& row : rows) {
-        if (row.size() >= 5) { // <-- 检查5列
-            try {
-                int                      priority = std::stoi(row[3]);
-                std::optional<long long> expirationTime;
-                if (!row[4].empty()) { // 检查 expiry_timestamp 是否为 NULL
-                    expirationTime = std::stoll(row[4]);
-                }
-                playerGroupDetails.emplace_back(row[0], row[1], row[2], priority, expirationTime);
-            } catch (const std::exception& e) {
-                ::ll::mod::NativeMod::current()->getLogger().warn(
-                    "权限存储: 无法解析玩家组 '{}' 的详细信息: {}",
-                    row[1],
-                    e.what()
-                );
+    // 选择 expiry_timestamp 并过滤过期的记录
+    bool succeeded = m_db->queryPrepared(SQL_PLAYER_GROUPS_WITH_DETAILS, {playerUuid, std::to_string(currentTime)}, [&playerGroupDetails](const db::RowView& row) {
+        if (row.columnCount() >= 5) { // <-- 检查5列
+            int                      priority = static_cast<int>(row.getInt64(3));
+            std::optional<long long> expirationTime;
+            // 检查 expiry_timestamp 是否为 NULL（SQLite 中永不过期的记录可能存为空字符串）
+            if (!row.isNull(4) && !row.getText(4).empty()) {
+                expirationTime = row.getInt64(4);
             }
+            playerGroupDetails.emplace_back(row.getString(0), row.getString(1), row.getString(2), priority, expirationTime);
         }
-    }
+        return true;
+    });
+    if (ok) *ok = succeeded;
     return playerGroupDetails;
 }
 
@@ -588,21 +816,44 @@ std::vector<GroupDetails> PermissionStorage::fetchPlayerGroupsWithDetails(const
  * @return 包含玩家UUID的字符串向量。
  */
 std::vector<std::string> PermissionStorage::fetchPlayersInGroup(const std::string& groupId) {
+    StatementTimer timer("fetchPlayersInGroup");
     if (!m_db) return {};
     std::vector<std::string> players;
-    std::string         sql  = "SELECT player_uuid FROM player_groups WHERE group_id = ?;";
-    auto           rows = m_db->queryPrepared(sql, {groupId});
+    auto           rows = m_db->queryPrepared(SQL_PLAYERS_IN_GROUP, {groupId});
     for (auto& row : rows)
         if (!row.empty()) players.push_back(row[0]);
     return players;
 }
 
+/**
+ * @brief 按玩家UUID排序分页获取用户组中的玩家UUID。
+ * @param groupId 用户组ID。
+ * @param offset 跳过的玩家数。
+ * @param limit 最多返回的玩家数。
+ * @return 包含玩家UUID的字符串向量。
+ */
+std::vector<std::string> PermissionStorage::fetchPlayersInGroup(const std::string& groupId, size_t offset, size_t limit) {
+    StatementTimer timer("fetchPlayersInGroupPage");
+    if (!m_db || limit == 0) return {};
+    std::vector<std::string> players;
+    players.reserve(limit);
+    // MySQL 不接受以字符串绑定的 LIMIT 参数，页大小与偏移直接写入语句（都是整数，不存在注入问题）
+    std::string sql = std::string(SQL_PLAYERS_IN_GROUP_PAGE) + " LIMIT " + std::to_string(limit) + " OFFSET "
+                    + std::to_string(offset) + ";";
+    m_db->queryPrepared(sql, {groupId}, [&players](const db::RowView& row) {
+        if (!row.isNull(0)) players.push_back(row.getString(0));
+        return true;
+    });
+    return players;
+}
+
 /**
  * @brief 获取在多个用户组中的所有玩家UUID。
  * @param groupIds 用户组ID向量。
  * @return 包含玩家UUID的字符串向量。
  */
 std::vector<std::string> PermissionStorage::fetchPlayersInGroups(const std::vector<std::string>& groupIds) {
+    StatementTimer timer("fetchPlayersInGroups");
     if (!m_db || groupIds.empty()) return {};
     std::vector<std::string> players;
     std::string         placeholders = m_db->getInClausePlaceholders(groupIds.size());
@@ -619,17 +870,18 @@ std::vector<std::string> PermissionStorage::fetchPlayersInGroups(const std::vect
  * @return 用户组名称到用户组ID的映射。
  */
 std::unordered_map<std::string, std::string> PermissionStorage::fetchGroupIdsByNames(const std::set<std::string>& groupNames) {
+    StatementTimer timer("fetchGroupIdsByNames");
     if (!m_db || groupNames.empty()) return {};
     std::unordered_map<std::string, std::string> groupNameMap;
     std::vector<std::string>                namesVec(groupNames.begin(), groupNames.end());
     std::string                        placeholders = m_db->getInClausePlaceholders(namesVec.size());
     std::string                        sql          = "SELECT name, id FROM permission_groups WHERE name IN (" + placeholders + ");";
-    auto                          rows         = m_db->queryPrepared(sql, namesVec);
-    for (const auto& row : rows) {
-        if (row.size() >= 2 && !row[0].empty() && !row[1].empty()) {
-            groupNameMap[row[0]] = row[1];
+    m_db->queryPrepared(sql, namesVec, [&groupNameMap](const db::RowView& row) {
+        if (row.columnCount() >= 2 && !row.getText(0).empty() && !row.getText(1).empty()) {
+            groupNameMap[row.getString(0)] = row.getString(1);
         }
-    }
+        return true;
+    });
     return groupNameMap;
 }
 
@@ -639,29 +891,182 @@ std::unordered_map<std::string, std::string> PermissionStorage::fetchGroupIdsByN
  * @return 用户组名称到用户组详细信息的映射。
  */
 std::unordered_map<std::string, GroupDetails> PermissionStorage::fetchGroupDetailsByNames(const std::set<std::string>& groupNames) {
+    StatementTimer timer("fetchGroupDetailsByNames");
     if (!m_db || groupNames.empty()) return {};
     std::unordered_map<std::string, GroupDetails> groupDetailsMap;
     std::vector<std::string>                 namesVec(groupNames.begin(), groupNames.end());
     std::string                         placeholders = m_db->getInClausePlaceholders(namesVec.size());
     std::string                         sql          = "SELECT id, name, description, priority FROM permission_groups WHERE name IN (" + placeholders + ");";
-    auto                           rows         = m_db->queryPrepared(sql, namesVec);
+    m_db->queryPrepared(sql, namesVec, [&groupDetailsMap](const db::RowView& row) {
+        // 描述可以为空，不能据此跳过该组
+        if (row.columnCount() >= 4 && !row.getText(0).empty() && !row.getText(1).empty() && !row.isNull(3)) {
+            std::string name      = row.getString(1);
+            groupDetailsMap[name] = GroupDetails(row.getString(0), name, row.getString(2), static_cast<int>(row.getInt64(3)));
+        }
+        return true;
+    });
+    return groupDetailsMap;
+}
 
-    for (const auto& row : rows) {
-        if (row.size() >= 4 && !row[0].empty() && !row[1].empty() && !row[2].empty() && !row[3].empty()) {
-            try {
-                int priority = std::stoi(row[3]);
-                groupDetailsMap[row[1]] = GroupDetails(row[0], row[1], row[2], priority);
-            } catch (const std::exception& e) {
-                ::ll::mod::NativeMod::current()->getLogger().warn(
-                    "权限存储: 无法将组 '{}' 的优先级 '{}' 转换为整数: {}",
-                    row[1], row[3], e.what()
-                );
-            }
+// --- 启动预热 ---
+/**
+ * @brief 获取所有用户组的详细信息。
+ * @return 用户组名称到用户组详细信息的映射。
+ */
+std::unordered_map<std::string, GroupDetails> PermissionStorage::fetchAllGroupDetails() {
+    StatementTimer timer("fetchAllGroupDetails");
+    if (!m_db) return {};
+    std::unordered_map<std::string, GroupDetails> groupDetailsMap;
+    std::string sql = "SELECT id, name, description, priority FROM permission_groups;";
+    m_db->queryPrepared(sql, {}, [&groupDetailsMap](const db::RowView& row) {
+        if (row.columnCount() >= 4 && !row.getText(0).empty() && !row.getText(1).empty()) {
+            std::string name      = row.getString(1);
+            groupDetailsMap[name] = GroupDetails(row.getString(0), name, row.getString(2), static_cast<int>(row.getInt64(3)));
         }
-    }
+        return true;
+    });
     return groupDetailsMap;
 }
 
+/**
+ * @brief 获取所有用户组的直接权限规则。
+ * @return 用户组ID到其直接权限规则向量的映射。
+ */
+std::unordered_map<std::string, std::vector<std::string>> PermissionStorage::fetchAllGroupPermissions() {
+    StatementTimer timer("fetchAllGroupPermissions");
+    if (!m_db) return {};
+    std::unordered_map<std::string, std::vector<std::string>> permissions;
+    std::string sql = "SELECT group_id, permission_rule FROM group_permissions;";
+    m_db->queryPrepared(sql, {}, [&permissions](const db::RowView& row) {
+        if (row.columnCount() >= 2) {
+            permissions[row.getString(0)].push_back(row.getString(1));
+        }
+        return true;
+    });
+    return permissions;
+}
+
+/**
+ * @brief 批量获取多个玩家未过期的用户组及其详细信息。
+ *        过期时间在读取时过滤，IN 子句之外不再绑定参数（PostgreSQL 的 IN 占位符已是 $n 形式，不能与 ? 混用）。
+ * @param playerUuids 玩家UUID向量。
+ * @return 玩家UUID到其用户组详细信息的映射。
+ */
+std::unordered_map<std::string, std::vector<GroupDetails>>
+PermissionStorage::fetchPlayerGroupsWithDetails(const std::vector<std::string>& playerUuids) {
+    StatementTimer timer("fetchPlayerGroupsWithDetailsBatch");
+    if (!m_db || playerUuids.empty()) return {};
+    std::unordered_map<std::string, std::vector<GroupDetails>> result;
+    constexpr size_t CHUNK_SIZE = 500; // 每条语句的参数数量，低于各数据库的占位符上限
+
+    long long currentTime =
+        std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+    for (size_t begin = 0; begin < playerUuids.size(); begin += CHUNK_SIZE) {
+        size_t                   end = std::min(begin + CHUNK_SIZE, playerUuids.size());
+        std::vector<std::string> chunk(playerUuids.begin() + begin, playerUuids.begin() + end);
+        std::string              sql =
+            "SELECT pgr.player_uuid, pg.id, pg.name, pg.description, pg.priority, pgr.expiry_timestamp "
+            "FROM permission_groups pg "
+            "JOIN player_groups pgr ON pg.id = pgr.group_id "
+            "WHERE pgr.player_uuid IN (" + m_db->getInClausePlaceholders(chunk.size()) + ");";
+        m_db->queryPrepared(sql, chunk, [&result, currentTime](const db::RowView& row) {
+            if (row.columnCount() < 6) return true;
+            std::optional<long long> expirationTime;
+            if (!row.isNull(5) && !row.getText(5).empty()) {
+                expirationTime = row.getInt64(5);
+                if (*expirationTime <= currentTime) return true; // 已过期
+            }
+            result[row.getString(0)].emplace_back(
+                row.getString(1),
+                row.getString(2),
+                row.getString(3),
+                static_cast<int>(row.getInt64(4)),
+                expirationTime
+            );
+            return true;
+        });
+    }
+    return result;
+}
+
+// --- 玩家最近上线时间 ---
+/**
+ * @brief 记录玩家最近一次上线的时间。
+ * @param playerUuid 玩家UUID。
+ * @param timestamp Unix 时间戳（秒）。
+ * @return 如果写入成功，则返回 true；否则返回 false。
+ */
+bool PermissionStorage::touchPlayerLastSeen(const std::string& playerUuid, long long timestamp) {
+    StatementTimer timer("touchPlayerLastSeen");
+    if (!m_db) return false;
+    std::string timestampStr = std::to_string(timestamp);
+    std::string insertSql    = m_db->getInsertOrIgnoreSql("player_last_seen", "player_uuid, last_seen", "?, ?", "player_uuid");
+    if (!m_db->executePrepared(insertSql, {playerUuid, timestampStr})) {
+        return false;
+    }
+    std::string updateSql = "UPDATE player_last_seen SET last_seen = ? WHERE player_uuid = ?;";
+    return m_db->executePrepared(updateSql, {timestampStr, playerUuid});
+}
+
+/**
+ * @brief 获取最近上线的玩家。
+ * @param limit 最多返回的玩家数量。
+ * @return 按最近上线时间从新到旧排列的玩家UUID。
+ */
+std::vector<std::string> PermissionStorage::fetchRecentlySeenPlayers(size_t limit) {
+    StatementTimer timer("fetchRecentlySeenPlayers");
+    if (!m_db || limit == 0) return {};
+    std::vector<std::string> players;
+    players.reserve(limit);
+    // LIMIT 直接写入数值：MySQL 不接受以字符串绑定的 LIMIT 参数
+    std::string sql =
+        "SELECT player_uuid FROM player_last_seen ORDER BY last_seen DESC LIMIT " + std::to_string(limit) + ";";
+    m_db->queryPrepared(sql, {}, [&players](const db::RowView& row) {
+        players.push_back(row.getString(0));
+        return true;
+    });
+    return players;
+}
+
+// --- 变更水位 ---
+/**
+ * @brief 获取数据库当前的变更水位。
+ * @return 变更水位；读取失败时返回 std::nullopt。
+ */
+std::optional<uint64_t> PermissionStorage::fetchChangeWatermark() {
+    StatementTimer timer("fetchChangeWatermark");
+    if (!m_db) return std::nullopt;
+    std::optional<uint64_t> watermark;
+    m_db->queryPrepared("SELECT version FROM change_watermark WHERE id = 1;", {}, [&watermark](const db::RowView& row) {
+        if (auto version = row.getOptionalInt64(0)) watermark = static_cast<uint64_t>(*version);
+        return false;
+    });
+    return watermark;
+}
+
+/**
+ * @brief 递增变更水位。在修改成功之后调用，使并发加载缓存的其他实例一定能看到水位变化。
+ */
+void PermissionStorage::bumpChangeWatermark() {
+    if (m_db->execute("UPDATE change_watermark SET version = version + 1 WHERE id = 1;")) {
+        m_localChanges.fetch_add(1, std::memory_order_relaxed);
+    } else {
+        ::ll::mod::NativeMod::current()->getLogger().error("存储: 递增变更水位失败，缓存快照文件可能无法识别此次修改。");
+    }
+}
+
+/**
+ * @brief 执行修改语句，成功时递增变更水位。
+ * @param sql SQL 语句。
+ * @param params 参数。
+ * @return 如果执行成功，则返回 true；否则返回 false。
+ */
+bool PermissionStorage::executeAndBumpWatermark(const std::string& sql, const std::vector<std::string>& params) {
+    if (!m_db->executePrepared(sql, params)) return false;
+    bumpChangeWatermark();
+    return true;
+}
+
 // --- 批量操作 ---
 /**
  * @brief 为用户组批量添加权限规则。
@@ -671,28 +1076,18 @@ std::unordered_map<std::string, GroupDetails> PermissionStorage::fetchGroupDetai
  */
 size_t
 PermissionStorage::addPermissionsToGroup(const std::string& groupId, const std::vector<std::string>& permissionRules) {
-    if (!m_db || permissionRules.empty()) return 0;
-    if (!m_db->beginTransaction()) return 0;
-
-    size_t successCount = 0;
-    std::string insertSql    = m_db->getInsertOrIgnoreSql(
-        "group_permissions",
-        "group_id, permission_rule",
-        "?, ?",
-        "group_id, permission_rule"
-    );
-
+    StatementTimer timer("addPermissionsToGroup");
+    db::BatchStatement batch;
+    batch.kind            = db::BatchKind::InsertOrIgnore;
+    batch.table           = "group_permissions";
+    batch.columns         = {"group_id", "permission_rule"};
+    batch.conflictColumns = "group_id, permission_rule";
     for (const auto& rule : permissionRules) {
         if (rule.empty() || rule == "-") continue;
-        if (m_db->executePrepared(insertSql, {groupId, rule})) {
-            successCount++;
-        }
-    }
-
-    if (!m_db->commit()) {
-        m_db->rollback();
-        return 0;
+        batch.rows.push_back({groupId, rule});
     }
+    size_t successCount = executeBatchInTransaction(batch);
+    if (successCount > 0) bumpChangeWatermark();
     return successCount;
 }
 
@@ -706,23 +1101,17 @@ size_t PermissionStorage::removePermissionsFromGroup(
     const std::string&              groupId,
     const std::vector<std::string>& permissionRules
 ) {
-    if (!m_db || permissionRules.empty()) return 0;
-    if (!m_db->beginTransaction()) return 0;
-
-    size_t successCount = 0;
-    std::string deleteSql    = "DELETE FROM group_permissions WHERE group_id = ? AND permission_rule = ?;";
-
+    StatementTimer timer("removePermissionsFromGroup");
+    db::BatchStatement batch;
+    batch.kind    = db::BatchKind::Delete;
+    batch.table   = "group_permissions";
+    batch.columns = {"group_id", "permission_rule"};
     for (const auto& rule : permissionRules) {
         if (rule.empty() || rule == "-") continue;
-        if (m_db->executePrepared(deleteSql, {groupId, rule})) {
-            successCount++;
-        }
-    }
-
-    if (!m_db->commit()) {
-        m_db->rollback();
-        return 0;
+        batch.rows.push_back({groupId, rule});
     }
+    size_t successCount = executeBatchInTransaction(batch);
+    if (successCount > 0) bumpChangeWatermark();
     return successCount;
 }
 
@@ -733,25 +1122,17 @@ size_t PermissionStorage::removePermissionsFromGroup(
  * @return 成功添加的玩家用户组关联数量。
  */
 size_t PermissionStorage::addPlayerToGroups(const std::string& playerUuid, const std::vector<std::pair<std::string, std::string>>& groupInfos) {
-    if (!m_db || groupInfos.empty()) return 0;
-    if (!m_db->beginTransaction()) return 0;
-
-    size_t successCount = 0;
-    std::string insertSql =
-        m_db->getInsertOrIgnoreSql("player_groups", "player_uuid, group_id", "?, ?", "player_uuid, group_id");
-
+    StatementTimer timer("addPlayerToGroups");
+    db::BatchStatement batch;
+    batch.kind            = db::BatchKind::InsertOrIgnore;
+    batch.table           = "player_groups";
+    batch.columns         = {"player_uuid", "group_id"};
+    batch.conflictColumns = "player_uuid, group_id";
     for (const auto& groupInfo : groupInfos) {
         // 这里我们假设第二个元素是 groupId
-        if (m_db->executePrepared(insertSql, {playerUuid, groupInfo.second})) {
-            successCount++;
-        }
-    }
-
-    if (!m_db->commit()) {
-        m_db->rollback();
-        return 0;
+        batch.rows.push_back({playerUuid, groupInfo.second});
     }
-    return successCount;
+    return executeBatchInTransaction(batch);
 }
 
 /**
@@ -762,23 +1143,277 @@ size_t PermissionStorage::addPlayerToGroups(const std::string& playerUuid, const
  */
 size_t
 PermissionStorage::removePlayerFromGroups(const std::string& playerUuid, const std::vector<std::string>& groupIds) {
-    if (!m_db || groupIds.empty()) return 0;
+    StatementTimer timer("removePlayerFromGroups");
+    db::BatchStatement batch;
+    batch.kind    = db::BatchKind::Delete;
+    batch.table   = "player_groups";
+    batch.columns = {"player_uuid", "group_id"};
+    for (const auto& groupId : groupIds) batch.rows.push_back({playerUuid, groupId});
+    return executeBatchInTransaction(batch);
+}
+
+/**
+ * @brief 在一个事务中执行批量语句。后端把整批合并为尽量少的往返：
+ *        PostgreSQL 使用管道模式，MySQL 合并为多行语句，SQLite 在同一事务中复用缓存的预处理语句。
+ * @param batch 要执行的批量语句。
+ * @return 执行成功的行数；事务提交失败时已回滚并返回 0。
+ */
+size_t PermissionStorage::executeBatchInTransaction(const db::BatchStatement& batch) {
+    if (!m_db || batch.rows.empty()) return 0;
     if (!m_db->beginTransaction()) return 0;
+    size_t successCount = m_db->executeBatch(batch);
+    if (!m_db->commit()) {
+        m_db->rollback();
+        return 0;
+    }
+    return successCount;
+}
+
+/**
+ * @brief 在一个事务中批量应用玩家组关系修改。
+ *        先用多行 DELETE 清掉所有涉及的 (玩家, 组) 记录，再用多行 INSERT 写入加入操作，
+ *        与单条 addPlayerToGroup 的“先删后插”语义一致。每条语句的行数有上限，避免超出数据库的参数数量限制。
+ * @param mutations 要应用的修改，同一 (玩家, 组) 只应出现一次。
+ * @return 事务提交成功返回 true，失败时已回滚。
+ */
+bool PermissionStorage::applyPlayerGroupMutations(const std::vector<PlayerGroupMutation>& mutations) {
+    StatementTimer timer("applyPlayerGroupMutations");
+    if (!m_db) return false;
+    if (mutations.empty()) return true;
+    if (!m_db->beginTransaction()) return false;
 
-    size_t successCount = 0;
-    std::string deleteSql    = "DELETE FROM player_groups WHERE player_uuid = ? AND group_id = ?;";
+    if (!writePlayerGroupMutations(mutations) || !m_db->commit()) {
+        m_db->rollback();
+        ::ll::mod::NativeMod::current()->getLogger().error("批量写入 {} 条玩家组修改失败，已回滚。", mutations.size());
+        return false;
+    }
+    return true;
+}
 
-    for (const auto& groupId : groupIds) {
-        if (m_db->executePrepared(deleteSql, {playerUuid, groupId})) {
-            successCount++;
+/**
+ * @brief 用多行语句写入玩家组关系修改，调用方负责开启与提交事务。
+ * @param mutations 要写入的修改，同一 (玩家, 组) 只应出现一次。
+ * @return 所有语句执行成功返回 true。
+ */
+bool PermissionStorage::writePlayerGroupMutations(const std::vector<PlayerGroupMutation>& mutations) {
+    constexpr size_t ROWS_PER_STATEMENT = 250;
+
+    bool ok = true;
+    for (size_t begin = 0; ok && begin < mutations.size(); begin += ROWS_PER_STATEMENT) {
+        size_t                   end = std::min(begin + ROWS_PER_STATEMENT, mutations.size());
+        std::string              sql = "DELETE FROM player_groups WHERE ";
+        std::vector<std::string> params;
+        params.reserve((end - begin) * 2);
+        for (size_t i = begin; i < end; ++i) {
+            if (i != begin) sql += " OR ";
+            sql += "(player_uuid = ? AND group_id = ?)";
+            params.push_back(mutations[i].playerUuid);
+            params.push_back(mutations[i].groupId);
         }
+        sql += ";";
+        ok = m_db->executePrepared(sql, params);
     }
 
-    if (!m_db->commit()) {
+    std::vector<const PlayerGroupMutation*> inserts;
+    for (const auto& mutation : mutations) {
+        if (mutation.add) inserts.push_back(&mutation);
+    }
+    for (size_t begin = 0; ok && begin < inserts.size(); begin += ROWS_PER_STATEMENT) {
+        size_t      end = std::min(begin + ROWS_PER_STATEMENT, inserts.size());
+        std::string sql = "INSERT INTO player_groups (player_uuid, group_id, expiry_timestamp) VALUES ";
+        std::vector<std::string> params;
+        params.reserve((end - begin) * 3);
+        for (size_t i = begin; i < end; ++i) {
+            const auto& mutation = *inserts[i];
+            if (i != begin) sql += ", ";
+            params.push_back(mutation.playerUuid);
+            params.push_back(mutation.groupId);
+            if (mutation.expiryTimestamp) {
+                sql += "(?, ?, ?)";
+                params.push_back(std::to_string(*mutation.expiryTimestamp));
+            } else {
+                sql += "(?, ?, NULL)"; // 永久加入写入真正的 NULL
+            }
+        }
+        sql += ";";
+        ok = m_db->executePrepared(sql, params);
+    }
+    return ok;
+}
+
+// --- 批量导出与导入 ---
+/**
+ * @brief 流式读取所有权限定义。
+ * @param visitor 每个权限调用一次，返回 false 时停止读取。
+ * @return 查询执行完毕（或被 visitor 停止）返回 true，出错返回 false。
+ */
+bool PermissionStorage::forEachPermission(const std::function<bool(const PermissionDefinition&)>& visitor) {
+    StatementTimer timer("forEachPermission");
+    if (!m_db) return false;
+    std::string sql = "SELECT name, description, default_value FROM permissions ORDER BY name;";
+    return m_db->queryPrepared(sql, {}, [&visitor](const db::RowView& row) {
+        if (row.columnCount() < 3 || row.getText(0).empty()) return true;
+        return visitor(PermissionDefinition{row.getString(0), row.getString(1), row.getInt64(2) != 0});
+    });
+}
+
+/**
+ * @brief 流式读取所有未过期的玩家组关系，按玩家排序，同一玩家的关系相邻。
+ *        过期时间在读取时过滤，与 fetchPlayerGroupsWithDetails 的批量版本一致。
+ * @param now 当前 Unix 时间戳（秒）。
+ * @param visitor 每条关系调用一次，返回 false 时停止读取。
+ * @return 查询执行完毕（或被 visitor 停止）返回 true，出错返回 false。
+ */
+bool PermissionStorage::forEachPlayerGroup(
+    long long                                                                                  now,
+    const std::function<bool(const std::string&, const std::string&, std::optional<long long>)>& visitor
+) {
+    StatementTimer timer("forEachPlayerGroup");
+    if (!m_db) return false;
+    std::string sql = "SELECT player_uuid, group_id, expiry_timestamp FROM player_groups ORDER BY player_uuid;";
+    std::string playerUuid, groupId; // 复用缓冲区，避免每行分配
+    return m_db->queryPrepared(sql, {}, [&](const db::RowView& row) {
+        if (row.columnCount() < 3 || row.getText(0).empty() || row.getText(1).empty()) return true;
+        // SQLite 中永久关系可能以空字符串而非 NULL 存储
+        std::optional<long long> expiry;
+        if (!row.isNull(2) && !row.getText(2).empty()) {
+            expiry = row.getInt64(2);
+            if (*expiry <= now) return true;
+        }
+        playerUuid.assign(row.getText(0));
+        groupId.assign(row.getText(1));
+        return visitor(playerUuid, groupId, expiry);
+    });
+}
+
+/**
+ * @brief 在一个事务中写入一批导入记录。
+ *        权限与组逐条插入或更新（数量通常不多），规则与继承逐条插入并忽略已存在的记录，
+ *        玩家组关系去重后用多行语句写入；整批最多递增一次变更水位。
+ * @param batch 要写入的记录。
+ * @param groupIds 组名到组ID的映射，本批新建的组会加入其中。
+ * @param stats 事务提交成功后累加本批写入的数量。
+ * @return 事务提交成功返回 true，失败时已回滚。
+ */
+bool PermissionStorage::applyImportBatch(
+    const ImportBatch&                            batch,
+    std::unordered_map<std::string, std::string>& groupIds,
+    TransferStats&                                stats
+) {
+    StatementTimer timer("applyImportBatch");
+    if (!m_db) return false;
+    if (batch.empty()) return true;
+    if (!m_db->beginTransaction()) return false;
+
+    TransferStats                                applied;
+    std::unordered_map<std::string, std::string> createdGroups; // 提交成功后才并入 groupIds
+    auto findGroupId = [&](const std::string& name) -> const std::string* {
+        if (auto it = groupIds.find(name); it != groupIds.end()) return &it->second;
+        if (auto it = createdGroups.find(name); it != createdGroups.end()) return &it->second;
+        return nullptr;
+    };
+
+    bool ok = true;
+    std::string permissionInsertSql =
+        m_db->getInsertOrIgnoreSql("permissions", "name, description, default_value", "?, ?, ?", "name");
+    std::string permissionUpdateSql = "UPDATE permissions SET description = ?, default_value = ? WHERE name = ?;";
+    for (size_t i = 0; ok && i < batch.permissions.size(); ++i) {
+        const auto& permission   = batch.permissions[i];
+        std::string defaultValue = permission.defaultValue ? "1" : "0";
+        ok = m_db->executePrepared(permissionInsertSql, {permission.name, permission.description, defaultValue})
+          && m_db->executePrepared(permissionUpdateSql, {permission.description, defaultValue, permission.name});
+        if (ok) ++applied.permissions;
+    }
+
+    std::string groupInsertSql =
+        m_db->getInsertOrIgnoreSql("permission_groups", "name, description, priority", "?, ?, ?", "name");
+    std::string groupUpdateSql = "UPDATE permission_groups SET description = ?, priority = ? WHERE name = ?;";
+    for (size_t i = 0; ok && i < batch.groups.size(); ++i) {
+        const auto& group    = batch.groups[i];
+        std::string priority = std::to_string(group.priority);
+        ok = m_db->executePrepared(groupInsertSql, {group.name, group.description, priority})
+          && m_db->executePrepared(groupUpdateSql, {group.description, priority, group.name});
+        if (ok && !findGroupId(group.name)) {
+            auto rows = m_db->queryPrepared("SELECT id FROM permission_groups WHERE name = ? LIMIT 1;", {group.name});
+            ok        = !rows.empty() && !rows[0].empty();
+            if (ok) createdGroups.emplace(group.name, rows[0][0]);
+        }
+        if (ok) ++applied.groups;
+    }
+
+    std::string inheritanceSql = m_db->getInsertOrIgnoreSql(
+        "group_inheritance",
+        "group_id, parent_group_id",
+        "?, ?",
+        "group_id, parent_group_id"
+    );
+    for (size_t i = 0; ok && i < batch.inheritance.size(); ++i) {
+        const auto* child  = findGroupId(batch.inheritance[i].first);
+        const auto* parent = findGroupId(batch.inheritance[i].second);
+        if (!child || !parent) {
+            ++applied.skipped;
+            continue;
+        }
+        ok = m_db->executePrepared(inheritanceSql, {*child, *parent});
+        if (ok) ++applied.inheritance;
+    }
+
+    std::string ruleSql = m_db->getInsertOrIgnoreSql(
+        "group_permissions",
+        "group_id, permission_rule",
+        "?, ?",
+        "group_id, permission_rule"
+    );
+    for (size_t i = 0; ok && i < batch.rules.size(); ++i) {
+        const auto& [groupName, rule] = batch.rules[i];
+        const auto* groupId           = findGroupId(groupName);
+        if (!groupId || rule.empty() || rule == "-") {
+            ++applied.skipped;
+            continue;
+        }
+        ok = m_db->executePrepared(ruleSql, {*groupId, rule});
+        if (ok) ++applied.rules;
+    }
+
+    // 同一 (玩家, 组) 以最后出现的记录为准
+    std::vector<PlayerGroupMutation>                          mutations;
+    std::map<std::pair<std::string, std::string>, size_t> positions;
+    for (const auto& membership : batch.memberships) {
+        const auto* groupId = findGroupId(membership.groupName);
+        if (!groupId || membership.playerUuid.empty()) {
+            ++applied.skipped;
+            continue;
+        }
+        auto [it, inserted] = positions.try_emplace({membership.playerUuid, *groupId}, mutations.size());
+        if (inserted) {
+            mutations.push_back({true, membership.playerUuid, *groupId, membership.expiryTimestamp});
+        } else {
+            mutations[it->second].expiryTimestamp = membership.expiryTimestamp;
+        }
+    }
+    if (ok) ok = writePlayerGroupMutations(mutations);
+    applied.memberships = mutations.size();
+
+    bool structureChanged = applied.permissions + applied.groups + applied.inheritance + applied.rules > 0;
+    if (ok && structureChanged) {
+        // 水位随事务一起提交，回滚时不会留下多余的递增
+        ok = m_db->execute("UPDATE change_watermark SET version = version + 1 WHERE id = 1;");
+    }
+    if (!ok || !m_db->commit()) {
         m_db->rollback();
-        return 0;
+        ::ll::mod::NativeMod::current()->getLogger().error("导入 {} 条记录的批次失败，已回滚。", batch.size());
+        return false;
     }
-    return successCount;
+    if (structureChanged) m_localChanges.fetch_add(1, std::memory_order_relaxed);
+
+    groupIds.merge(createdGroups);
+    stats.permissions += applied.permissions;
+    stats.groups      += applied.groups;
+    stats.inheritance += applied.inheritance;
+    stats.rules       += applied.rules;
+    stats.memberships += applied.memberships;
+    stats.skipped     += applied.skipped;
+    return true;
 }
 
 /**
@@ -787,6 +1422,7 @@ PermissionStorage::removePlayerFromGroups(const std::string& playerUuid, const s
  * @return 包含直接父用户组ID的字符串向量。
  */
 std::vector<std::string> PermissionStorage::fetchDirectParentGroupIds(const std::string& groupId) {
+    StatementTimer timer("fetchDirectParentGroupIds");
     if (!m_db) return {};
     std::vector<std::string> parentIds;
     std::string         sql  = "SELECT parent_group_id FROM group_inheritance WHERE group_id = ?;";
@@ -802,6 +1438,7 @@ std::vector<std::string> PermissionStorage::fetchDirectParentGroupIds(const std:
  * @return 用户组ID到用户组名称的映射。
  */
 std::unordered_map<std::string, std::string> PermissionStorage::fetchGroupNamesByIds(const std::vector<std::string>& groupIds) {
+    StatementTimer timer("fetchGroupNamesByIds");
     if (!m_db || groupIds.empty()) return {};
     std::unordered_map<std::string, std::string> groupNameMap;
     std::string                        placeholders = m_db->getInClausePlaceholders(groupIds.size());
@@ -816,6 +1453,7 @@ std::unordered_map<std::string, std::string> PermissionStorage::fetchGroupNamesB
 }
 
 std::vector<std::string> PermissionStorage::deleteExpiredPlayerGroups() {
+    StatementTimer timer("deleteExpiredPlayerGroups");
     if (!m_db) return {};
 
     long long currentTime =
@@ -823,8 +1461,7 @@ std::vector<std::string> PermissionStorage::deleteExpiredPlayerGroups() {
 
     // 1. 查询所有过期的玩家 UUID
     std::vector<std::string> expiredPlayerUuids;
-    std::string selectSql = "SELECT DISTINCT player_uuid FROM player_groups WHERE expiry_timestamp IS NOT NULL AND expiry_timestamp <= ?;";
-    auto rows = m_db->queryPrepared(selectSql, {std::to_string(currentTime)});
+    auto rows = m_db->queryPrepared(SQL_EXPIRED_PLAYERS, {std::to_string(currentTime)});
     for (const auto& row : rows) {
         if (!row.empty()) {
             expiredPlayerUuids.push_back(row[0]);
@@ -842,6 +1479,54 @@ std::vector<std::string> PermissionStorage::deleteExpiredPlayerGroups() {
     return expiredPlayerUuids;
 }
 
+/**
+ * @brief 获取所有带过期时间的玩家组关系。
+ * @return 玩家组关系及其过期时间戳向量。
+ */
+std::vector<PlayerGroupExpiry> PermissionStorage::fetchPlayerGroupExpirations() {
+    StatementTimer timer("fetchPlayerGroupExpirations");
+    if (!m_db) return {};
+    std::vector<PlayerGroupExpiry> expirations;
+    m_db->queryPrepared(SQL_PLAYER_GROUP_EXPIRATIONS, {}, [&expirations](const db::RowView& row) {
+        // SQLite 中永久关系可能以空字符串而非 NULL 存储
+        if (row.columnCount() < 3 || row.isNull(2) || row.getText(2).empty()) return true;
+        expirations.push_back({row.getString(0), row.getString(1), row.getInt64(2)});
+        return true;
+    });
+    return expirations;
+}
+
+/**
+ * @brief 按 (玩家UUID, 组ID) 删除已到期的玩家组关系。
+ * @param keys 要删除的 (玩家UUID, 组ID)。
+ * @param now 当前 Unix 时间戳（秒）。
+ * @return 事务提交成功返回 true，失败时已回滚。
+ */
+bool PermissionStorage::deleteExpiredPlayerGroups(
+    const std::vector<std::pair<std::string, std::string>>& keys,
+    long long                                                now
+) {
+    StatementTimer timer("deleteExpiredPlayerGroupsByKeys");
+    if (!m_db) return false;
+    if (keys.empty()) return true;
+    if (!m_db->beginTransaction()) return false;
+
+    std::string deleteSql = "DELETE FROM player_groups WHERE player_uuid = ? AND group_id = ? "
+                            "AND expiry_timestamp IS NOT NULL AND expiry_timestamp <= ?;";
+    std::string nowStr    = std::to_string(now);
+    for (const auto& [playerUuid, groupId] : keys) {
+        if (!m_db->executePrepared(deleteSql, {playerUuid, groupId, nowStr})) {
+            m_db->rollback();
+            return false;
+        }
+    }
+    if (!m_db->commit()) {
+        m_db->rollback();
+        return false;
+    }
+    return true;
+}
+
 /**
  * @brief 获取玩家在特定用户组中的过期时间戳。
  * @param playerUuid 玩家UUID。
@@ -850,6 +1535,7 @@ std::vector<std::string> PermissionStorage::deleteExpiredPlayerGroups() {
  */
 std::optional<long long>
 PermissionStorage::fetchPlayerGroupExpirationTime(const std::string& playerUuid, const std::string& groupId) {
+    StatementTimer timer("fetchPlayerGroupExpirationTime");
     if (!m_db) return std::nullopt;
     std::string sql  = "SELECT expiry_timestamp FROM player_groups WHERE player_uuid = ? AND group_id = ? LIMIT 1;";
     auto        rows = m_db->queryPrepared(sql, {playerUuid, groupId});
@@ -888,6 +1574,7 @@ bool PermissionStorage::updatePlayerGroupExpirationTime(
     const std::string&              groupId,
     const std::optional<long long>& expiryTimestamp
 ) {
+    StatementTimer timer("updatePlayerGroupExpirationTime");
     if (!m_db) return false;
     std::string sql = "UPDATE player_groups SET expiry_timestamp = ? WHERE player_uuid = ? AND group_id = ?;";
 
@@ -898,6 +1585,115 @@ bool PermissionStorage::updatePlayerGroupExpirationTime(
         return m_db->executePrepared(sql, {"", playerUuid, groupId});
     }
 }
+// --- 跨服务器缓存失效 ---
+
+/**
+ * @brief 在一个事务中追加一批缓存失效任务。
+ * @param origin 本服务器的节点ID。
+ * @param tasks 要追加的任务。
+ * @return 事务提交成功返回 true，失败时已回滚。
+ */
+bool PermissionStorage::appendInvalidationLog(const std::string& origin, const std::vector<CacheInvalidationTask>& tasks) {
+    StatementTimer timer("appendInvalidationLog");
+    if (!m_db) return false;
+    if (tasks.empty()) return true;
+    long long now =
+        std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+    std::string nowStr = std::to_string(now);
+    std::string sql =
+        "INSERT INTO cache_invalidation_log (origin, task_type, data, players, created_at) VALUES (?, ?, ?, ?, ?);";
+
+    if (!m_db->beginTransaction()) return false;
+    for (const auto& task : tasks) {
+        // 玩家 UUID 不含换行符，直接按行拼接
+        std::string players;
+        for (const auto& playerUuid : task.players) {
+            if (!players.empty()) players += '\n';
+            players += playerUuid;
+        }
+        if (!m_db->executePrepared(sql, {origin, std::to_string(static_cast<int>(task.type)), task.data, players, nowStr})) {
+            m_db->rollback();
+            return false;
+        }
+    }
+    if (!m_db->commit()) {
+        m_db->rollback();
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief 按ID顺序读取 afterId 之后的缓存失效日志。
+ * @param afterId 只返回ID大于它的记录。
+ * @param limit 最多返回的记录数。
+ * @return 日志记录向量。
+ */
+std::vector<InvalidationLogEntry> PermissionStorage::fetchInvalidationLogAfter(long long afterId, size_t limit) {
+    StatementTimer timer("fetchInvalidationLogAfter");
+    if (!m_db) return {};
+    std::vector<InvalidationLogEntry> entries;
+    std::string sql = "SELECT id, origin, task_type, data, players, created_at FROM cache_invalidation_log "
+                      "WHERE id > ? ORDER BY id LIMIT " + std::to_string(limit) + ";";
+    m_db->queryPrepared(sql, {std::to_string(afterId)}, [&entries](const db::RowView& row) {
+        if (row.columnCount() < 6) return true;
+        InvalidationLogEntry entry;
+        entry.id        = row.getInt64(0);
+        entry.origin    = row.getString(1);
+        entry.task.type = static_cast<CacheInvalidationTaskType>(row.getInt64(2));
+        entry.task.data = row.getString(3);
+        std::string_view players = row.getText(4);
+        while (!players.empty()) {
+            size_t end = players.find('\n');
+            entry.task.players.emplace_back(players.substr(0, end));
+            if (end == std::string_view::npos) break;
+            players.remove_prefix(end + 1);
+        }
+        entry.createdAt = row.getInt64(5);
+        entries.push_back(std::move(entry));
+        return true;
+    });
+    return entries;
+}
+
+/**
+ * @brief 获取缓存失效日志中最大的ID。
+ * @return 最大ID，日志为空时返回 0；读取失败时返回 std::nullopt。
+ */
+std::optional<long long> PermissionStorage::fetchLatestInvalidationLogId() {
+    StatementTimer timer("fetchLatestInvalidationLogId");
+    if (!m_db) return std::nullopt;
+    std::optional<long long> latest;
+    bool ok = m_db->queryPrepared("SELECT MAX(id) FROM cache_invalidation_log;", {}, [&latest](const db::RowView& row) {
+        latest = row.isNull(0) ? 0 : row.getInt64(0);
+        return false;
+    });
+    if (!ok) return std::nullopt;
+    return latest.value_or(0);
+}
+
+/**
+ * @brief 删除写入时间早于 olderThan 的缓存失效日志。
+ * @param olderThan Unix 时间戳（秒）。
+ * @return 如果操作成功，则返回 true；否则返回 false。
+ */
+bool PermissionStorage::pruneInvalidationLog(long long olderThan) {
+    StatementTimer timer("pruneInvalidationLog");
+    if (!m_db) return false;
+    return m_db->executePrepared("DELETE FROM cache_invalidation_log WHERE created_at < ?;", {std::to_string(olderThan)});
+}
+
+bool PermissionStorage::notifyChannel(const std::string& channel) {
+    StatementTimer timer("notifyChannel");
+    if (!m_db) return false;
+    return m_db->notify(channel);
+}
+
+std::unique_ptr<db::INotificationListener> PermissionStorage::createNotificationListener(const std::string& channel) {
+    if (!m_db) return nullptr;
+    return m_db->createNotificationListener(channel);
+}
+
 } // namespace internal
 } // namespace permission
 } // namespace BA
@@ -1,19 +1,91 @@
 #pragma once
 
 #include "permission/PermissionData.h"
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
 #include <string>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
 
 namespace BA {
 namespace db {
 class IDatabase;
+class INotificationListener;
+struct BatchStatement;
 } // namespace db
 
 namespace permission {
 namespace internal {
 
+/**
+ * @brief 一条玩家组关系修改，由写回队列批量提交。
+ */
+struct PlayerGroupMutation {
+    bool                     add = true; // true 为加入（已存在时覆盖过期时间），false 为移除
+    std::string              playerUuid;
+    std::string              groupId;
+    std::optional<long long> expiryTimestamp; // 仅加入时有效，空表示永久
+};
+
+/**
+ * @brief 一条带过期时间的玩家组关系。
+ */
+struct PlayerGroupExpiry {
+    std::string playerUuid;
+    std::string groupId;
+    long long   expiryTimestamp; // Unix 时间戳（秒）
+};
+
+/**
+ * @brief 一条待导入的玩家组关系，组以名称引用。
+ */
+struct ImportedMembership {
+    std::string              playerUuid;
+    std::string              groupName;
+    std::optional<long long> expiryTimestamp; // 空表示永久
+};
+
+/**
+ * @brief 一批待导入的记录，由 applyImportBatch 在一个事务中按成员顺序写入，
+ *        因此同一批中的规则、继承与玩家组关系可以引用本批新建的组。
+ */
+struct ImportBatch {
+    std::vector<PermissionDefinition>                permissions; // 插入或更新描述与默认值
+    std::vector<GroupDetails>                        groups;      // 按名称插入或更新描述与优先级
+    std::vector<std::pair<std::string, std::string>> inheritance; // (子组名, 父组名)
+    std::vector<std::pair<std::string, std::string>> rules;       // (组名, 规则)
+    std::vector<ImportedMembership>                  memberships; // 已存在的关系覆盖过期时间
+
+    size_t size() const {
+        return permissions.size() + groups.size() + inheritance.size() + rules.size() + memberships.size();
+    }
+    bool empty() const { return size() == 0; }
+};
+
+/**
+ * @brief 缓存失效日志中的一条记录，由其他服务器写入。
+ */
+struct InvalidationLogEntry {
+    long long             id = 0;  // 自增ID，按写入顺序递增
+    std::string           origin;  // 写入该记录的服务器节点ID
+    long long             createdAt = 0; // 写入时间（Unix 时间戳，秒）
+    CacheInvalidationTask task;
+};
+
+/**
+ * @brief 一条热点语句的查询计划，由 PermissionStorage::explainHotStatements 返回。
+ */
+struct QueryPlan {
+    std::string              name;  // 使用该语句的存储方法
+    std::string              sql;   // 执行 EXPLAIN 的语句，参数已替换为示例值
+    std::vector<std::string> lines; // 计划的每一行，各列以 " | " 连接；执行失败时为空
+};
+
 /**
  * @brief 权限存储类，负责与数据库交互，管理权限、用户组、用户组权限、继承关系和玩家用户组数据。
  */
@@ -31,6 +103,27 @@ public:
      */
     bool ensureTables();
 
+    // --- 架构迁移与查询计划 ---
+    // 当前代码对应的架构版本，每增加一个迁移步骤递增一次
+    static constexpr int SCHEMA_VERSION = 1;
+    /**
+     * @brief 依次执行数据库记录的架构版本之后的迁移步骤，由 ensureTables 在建表后调用。
+     *        每个步骤的语句都可重复执行；某一步失败时版本停在该步之前，下次启动时重试。
+     * @return 数据库架构已不低于 SCHEMA_VERSION 时返回 true。
+     */
+    bool               migrateSchema();
+    /**
+     * @brief 获取数据库记录的架构版本。
+     * @return 架构版本；读取失败时返回 std::nullopt。
+     */
+    std::optional<int> fetchSchemaVersion();
+    /**
+     * @brief 对热点语句执行 EXPLAIN（SQLite 为 EXPLAIN QUERY PLAN），用于在大表上确认它们使用覆盖索引。
+     *        参数以示例值直接写入语句，不使用预处理语句（MySQL 不支持预处理 EXPLAIN）。
+     * @return 每条热点语句的查询计划。
+     */
+    std::vector<QueryPlan> explainHotStatements();
+
     // 权限管理
     /**
      * @brief 插入或更新权限。
@@ -241,15 +334,24 @@ public:
         /**
          * @brief 获取玩家所属的用户组及其详细信息。
          * @param playerUuid 玩家UUID。
+         * @param ok 不为空时写入查询是否成功；失败时返回的空结果不代表玩家没有任何组，不应缓存。
          * @return 包含玩家所属用户组详细信息的向量。
          */
-        std::vector<GroupDetails> fetchPlayerGroupsWithDetails(const std::string& playerUuid);
+        std::vector<GroupDetails> fetchPlayerGroupsWithDetails(const std::string& playerUuid, bool* ok = nullptr);
     /**
      * @brief 获取指定用户组中的所有玩家UUID。
      * @param groupId 用户组ID。
      * @return 包含玩家UUID的字符串向量。
      */
     std::vector<std::string>  fetchPlayersInGroup(const std::string& groupId);
+    /**
+     * @brief 按玩家UUID排序分页获取用户组中的玩家UUID。
+     * @param groupId 用户组ID。
+     * @param offset 跳过的玩家数。
+     * @param limit 最多返回的玩家数。
+     * @return 包含玩家UUID的字符串向量。
+     */
+    std::vector<std::string>  fetchPlayersInGroup(const std::string& groupId, size_t offset, size_t limit);
     /**
      * @brief 获取在多个用户组中的所有玩家UUID。
      * @param groupIds 用户组ID向量。
@@ -275,6 +377,40 @@ public:
      */
     std::unordered_map<std::string, GroupDetails> fetchGroupDetailsByNames(const std::set<std::string>& groupNames); // 新增：根据名称获取用户组详细信息
 
+    // --- 启动预热：每张表一次流式查询 ---
+    /**
+     * @brief 获取所有用户组的详细信息。
+     * @return 用户组名称到用户组详细信息的映射。
+     */
+    std::unordered_map<std::string, GroupDetails> fetchAllGroupDetails();
+    /**
+     * @brief 获取所有用户组的直接权限规则。
+     * @return 用户组ID到其直接权限规则向量的映射。
+     */
+    std::unordered_map<std::string, std::vector<std::string>> fetchAllGroupPermissions();
+    /**
+     * @brief 批量获取多个玩家未过期的用户组及其详细信息，按批次分成多条 IN 查询。
+     * @param playerUuids 玩家UUID向量。
+     * @return 玩家UUID到其用户组详细信息的映射，没有任何用户组的玩家不出现在结果中。
+     */
+    std::unordered_map<std::string, std::vector<GroupDetails>>
+    fetchPlayerGroupsWithDetails(const std::vector<std::string>& playerUuids);
+
+    // --- 玩家最近上线时间 ---
+    /**
+     * @brief 记录玩家最近一次上线的时间。
+     * @param playerUuid 玩家UUID。
+     * @param timestamp Unix 时间戳（秒）。
+     * @return 如果写入成功，则返回 true；否则返回 false。
+     */
+    bool touchPlayerLastSeen(const std::string& playerUuid, long long timestamp);
+    /**
+     * @brief 获取最近上线的玩家。
+     * @param limit 最多返回的玩家数量。
+     * @return 按最近上线时间从新到旧排列的玩家UUID。
+     */
+    std::vector<std::string> fetchRecentlySeenPlayers(size_t limit);
+
     /**
      * @brief 将玩家批量添加到多个用户组。
      * @param playerUuid 玩家UUID。
@@ -294,13 +430,118 @@ public:
     size_t removePlayerFromGroups(const std::string& playerUuid, const std::vector<std::string>& groupIds);
     // 新增：为后台任务删除所有过期的玩家组关系
     std::vector<std::string> deleteExpiredPlayerGroups();
+    /**
+     * @brief 获取所有带过期时间的玩家组关系，用于填充到期队列。
+     */
+    std::vector<PlayerGroupExpiry> fetchPlayerGroupExpirations();
+    /**
+     * @brief 按 (玩家UUID, 组ID) 删除已到期的玩家组关系，在一个事务中执行。
+     *        只删除过期时间仍不晚于 now 的记录，期间被改期或改为永久的关系不受影响。
+     * @param keys 要删除的 (玩家UUID, 组ID)。
+     * @param now 当前 Unix 时间戳（秒）。
+     * @return 事务提交成功返回 true，失败时已回滚。
+     */
+    bool deleteExpiredPlayerGroups(const std::vector<std::pair<std::string, std::string>>& keys, long long now);
+    /**
+     * @brief 在一个事务中批量应用玩家组关系修改，使用多行 DELETE 与多行 INSERT。
+     *        同一 (玩家, 组) 只应出现一次，调用方负责合并。
+     * @param mutations 要应用的修改。
+     * @return 事务提交成功返回 true，失败时已回滚。
+     */
+    bool applyPlayerGroupMutations(const std::vector<PlayerGroupMutation>& mutations);
+
+    // --- 批量导出与导入 ---
+    /**
+     * @brief 流式读取所有权限定义。
+     * @param visitor 每个权限调用一次，返回 false 时停止读取。期间不能在同一数据库上执行其他语句。
+     * @return 查询执行完毕（或被 visitor 停止）返回 true，出错返回 false。
+     */
+    bool forEachPermission(const std::function<bool(const PermissionDefinition&)>& visitor);
+    /**
+     * @brief 流式读取所有未过期的玩家组关系，不把结果集读入内存。
+     * @param now 当前 Unix 时间戳（秒），过期时间不晚于它的关系被跳过。
+     * @param visitor 每条关系调用一次（玩家UUID, 组ID, 过期时间），返回 false 时停止读取。
+     *        期间不能在同一数据库上执行其他语句。
+     * @return 查询执行完毕（或被 visitor 停止）返回 true，出错返回 false。
+     */
+    bool forEachPlayerGroup(
+        long long                                                                                  now,
+        const std::function<bool(const std::string&, const std::string&, std::optional<long long>)>& visitor
+    );
+    /**
+     * @brief 在一个事务中写入一批导入记录。组按名称插入或更新；规则、继承与玩家组关系中引用的组
+     *        必须已在 groupIds 中或由本批创建，否则计入 stats.skipped。玩家组关系使用多行语句写入。
+     * @param batch 要写入的记录。
+     * @param groupIds 组名到组ID的映射，调用方在导入开始时从数据库载入，本批新建的组会加入其中。
+     * @param stats 事务提交成功后累加本批写入的数量；失败时不变。
+     * @return 事务提交成功返回 true，失败时已回滚。
+     */
+    bool applyImportBatch(
+        const ImportBatch&                            batch,
+        std::unordered_map<std::string, std::string>& groupIds,
+        TransferStats&                                stats
+    );
+
+    // --- 变更水位 ---
+    /**
+     * @brief 获取数据库当前的变更水位。组、组权限、继承关系与权限定义的每次修改都会使其递增，
+     *        玩家组关系的修改不影响水位。
+     * @return 变更水位；读取失败时返回 std::nullopt。
+     */
+    std::optional<uint64_t> fetchChangeWatermark();
+    // 本实例递增水位的累计次数
+    uint64_t                localChangeCount() const { return m_localChanges.load(std::memory_order_relaxed); }
+
+    // --- 跨服务器缓存失效 ---
+    /**
+     * @brief 在一个事务中把一批缓存失效任务追加到 cache_invalidation_log。
+     * @param origin 本服务器的节点ID，读取时用于跳过自己写入的记录。
+     * @param tasks 要追加的任务。
+     * @return 事务提交成功返回 true，失败时已回滚。
+     */
+    bool appendInvalidationLog(const std::string& origin, const std::vector<CacheInvalidationTask>& tasks);
+    /**
+     * @brief 按ID顺序读取 afterId 之后的缓存失效日志。
+     * @param afterId 只返回ID大于它的记录。
+     * @param limit 最多返回的记录数。
+     */
+    std::vector<InvalidationLogEntry> fetchInvalidationLogAfter(long long afterId, size_t limit);
+    /**
+     * @brief 获取缓存失效日志中最大的ID。
+     * @return 最大ID，日志为空时返回 0；读取失败时返回 std::nullopt。
+     */
+    std::optional<long long> fetchLatestInvalidationLogId();
+    /**
+     * @brief 删除写入时间早于 olderThan 的缓存失效日志。
+     * @param olderThan Unix 时间戳（秒）。
+     */
+    bool pruneInvalidationLog(long long olderThan);
+    /**
+     * @brief 在指定频道上发送通知（PostgreSQL NOTIFY）。
+     * @return 数据库不支持通知或发送失败时返回 false。
+     */
+    bool notifyChannel(const std::string& channel);
+    /**
+     * @brief 创建指定频道的通知监听器，它使用独立的数据库连接。
+     * @return 数据库不支持通知或连接失败时返回空指针。
+     */
+    std::unique_ptr<db::INotificationListener> createNotificationListener(const std::string& channel);
+
     struct PlayerGroupInfo {
         std::string              groupId;
         std::optional<long long> expiryTimestamp;
     };
 
 private:
-    db::IDatabase* m_db = nullptr; /**< 数据库接口指针 */
+    void bumpChangeWatermark();
+    // 用多行 DELETE 与多行 INSERT 写入玩家组关系修改，调用方负责开启事务
+    bool writePlayerGroupMutations(const std::vector<PlayerGroupMutation>& mutations);
+    bool executeAndBumpWatermark(const std::string& sql, const std::vector<std::string>& params);
+    // 在一个事务中执行批量语句，返回成功的行数
+    size_t executeBatchInTransaction(const db::BatchStatement& batch);
+
+    db::IDatabase*        m_db = nullptr;  /**< 数据库接口指针 */
+    std::atomic<uint64_t> m_localChanges{0}; /**< 本实例递增水位的次数 */
 };
 
 } // namespace internal
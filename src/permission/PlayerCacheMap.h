@@ -0,0 +1,246 @@
+#pragma once
+
+#include "permission/PlayerKey.h"
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace BA {
+namespace permission {
+namespace internal {
+
+/**
+ * @brief 被固定的键集合（通常是在线玩家），其中的条目不会被淘汰。
+ */
+class PinnedKeys {
+public:
+    // 固定一个键，已固定时返回 false
+    bool pin(const PlayerKey& key) {
+        std::unique_lock<std::shared_mutex> lock(m_mutex);
+        return m_keys.insert(key).second;
+    }
+    // 取消固定，未固定时返回 false
+    bool unpin(const PlayerKey& key) {
+        std::unique_lock<std::shared_mutex> lock(m_mutex);
+        return m_keys.erase(key) > 0;
+    }
+    bool contains(const PlayerKey& key) const {
+        std::shared_lock<std::shared_mutex> lock(m_mutex);
+        return m_keys.count(key) > 0;
+    }
+    size_t size() const {
+        std::shared_lock<std::shared_mutex> lock(m_mutex);
+        return m_keys.size();
+    }
+
+private:
+    mutable std::shared_mutex                    m_mutex;
+    std::unordered_set<PlayerKey, PlayerKeyHash> m_keys;
+};
+
+/**
+ * @brief 按字节数限制大小的玩家缓存表（近似 LRU），以 PlayerKey 为键，可按键哈希分成多个分片。
+ *        每个分片有独立的读写锁、哈希表、字节计数和逻辑时钟，不同玩家的读写落在不同分片上时互不竞争；
+ *        分片数为 1 时退化为单锁模式。字节上限在分片之间平均分配。
+ *        每个条目记录最近一次访问时的逻辑时钟，读取只在自己的条目上做一次 relaxed 写入，不需要写锁；
+ *        逻辑时钟只在写入时递增。分片超出上限时批量淘汰最久未访问且未被固定的条目，直到回落到上限的 90%，
+ *        以免每次写入都触发淘汰。
+ * @tparam V 快照类型，以 std::shared_ptr<const V> 持有。
+ */
+template <typename V>
+class PlayerCacheMap {
+public:
+    using ValuePtr = std::shared_ptr<const V>;
+    using SizeOf   = size_t (*)(const V&);
+
+    /**
+     * @param sizeOf 估算单个值占用字节数的函数。
+     * @param pinned 固定键集合，可为空。
+     * @param shardCount 分片数，0 按 1 处理。
+     */
+    PlayerCacheMap(SizeOf sizeOf, const PinnedKeys* pinned, size_t shardCount = 1)
+    : m_sizeOf(sizeOf),
+      m_pinned(pinned) {
+        m_shards.resize(std::max<size_t>(shardCount, 1));
+        for (auto& shard : m_shards) shard = std::make_unique<Shard>();
+    }
+
+    // 设置总字节上限，0 表示不限制；返回因上限缩小而被淘汰的键
+    std::vector<PlayerKey> setMaxBytes(size_t maxBytes) {
+        m_maxBytes.store(maxBytes, std::memory_order_relaxed);
+        std::vector<PlayerKey> evicted;
+        for (auto& shard : m_shards) {
+            std::unique_lock<std::shared_mutex> lock(shard->mutex);
+            auto                                part = evictLocked(*shard, nullptr);
+            evicted.insert(evicted.end(), part.begin(), part.end());
+        }
+        return evicted;
+    }
+
+    // 查找并刷新访问时间，未命中返回空指针
+    ValuePtr find(const PlayerKey& key) const {
+        const Shard&                        shard = shardOf(key);
+        std::shared_lock<std::shared_mutex> lock(shard.mutex);
+        auto                                it = shard.entries.find(key);
+        if (it == shard.entries.end()) return nullptr;
+        uint64_t now = shard.clock.load(std::memory_order_relaxed);
+        if (it->second.lastAccess.load(std::memory_order_relaxed) != now) {
+            it->second.lastAccess.store(now, std::memory_order_relaxed); // 避免对同一缓存行的重复写入
+        }
+        return it->second.value;
+    }
+
+    // 条目是否存在且仍是 value，不刷新访问时间
+    bool holds(const PlayerKey& key, const V* value) const {
+        const Shard&                        shard = shardOf(key);
+        std::shared_lock<std::shared_mutex> lock(shard.mutex);
+        auto                                it = shard.entries.find(key);
+        return it != shard.entries.end() && it->second.value.get() == value;
+    }
+
+    // 存储（替换）条目，返回因超出上限而被淘汰的键
+    std::vector<PlayerKey> store(const PlayerKey& key, ValuePtr value) {
+        size_t                              bytes = entryBytes(*value);
+        Shard&                              shard = shardOf(key);
+        std::unique_lock<std::shared_mutex> lock(shard.mutex);
+        uint64_t                            now = shard.clock.fetch_add(1, std::memory_order_relaxed) + 1;
+        auto [it, inserted]                     = shard.entries.try_emplace(key);
+        if (!inserted) shard.residentBytes -= it->second.bytes;
+        it->second.value = std::move(value);
+        it->second.bytes = bytes;
+        it->second.lastAccess.store(now, std::memory_order_relaxed);
+        shard.residentBytes += bytes;
+        return evictLocked(shard, &key);
+    }
+
+    // 移除条目，返回是否存在
+    bool erase(const PlayerKey& key) {
+        Shard&                              shard = shardOf(key);
+        std::unique_lock<std::shared_mutex> lock(shard.mutex);
+        auto                                it = shard.entries.find(key);
+        if (it == shard.entries.end()) return false;
+        shard.residentBytes -= it->second.bytes;
+        shard.entries.erase(it);
+        return true;
+    }
+
+    // 批量移除条目，每个分片只加一次锁；返回实际移除的数量
+    size_t eraseMany(const std::vector<PlayerKey>& keys) {
+        std::vector<std::vector<const PlayerKey*>> byShard(m_shards.size());
+        for (const auto& key : keys) byShard[shardIndexOf(key)].push_back(&key);
+        size_t removed = 0;
+        for (size_t i = 0; i < m_shards.size(); ++i) {
+            if (byShard[i].empty()) continue;
+            Shard&                              shard = *m_shards[i];
+            std::unique_lock<std::shared_mutex> lock(shard.mutex);
+            for (const PlayerKey* key : byShard[i]) {
+                auto it = shard.entries.find(*key);
+                if (it == shard.entries.end()) continue;
+                shard.residentBytes -= it->second.bytes;
+                shard.entries.erase(it);
+                ++removed;
+            }
+        }
+        return removed;
+    }
+
+    void clear() {
+        for (auto& shard : m_shards) {
+            std::unique_lock<std::shared_mutex> lock(shard->mutex);
+            shard->entries.clear();
+            shard->residentBytes = 0;
+        }
+    }
+
+    size_t size() const {
+        size_t total = 0;
+        for (const auto& shard : m_shards) {
+            std::shared_lock<std::shared_mutex> lock(shard->mutex);
+            total += shard->entries.size();
+        }
+        return total;
+    }
+    size_t residentBytes() const {
+        size_t total = 0;
+        for (const auto& shard : m_shards) {
+            std::shared_lock<std::shared_mutex> lock(shard->mutex);
+            total += shard->residentBytes;
+        }
+        return total;
+    }
+    size_t   maxBytes() const { return m_maxBytes.load(std::memory_order_relaxed); }
+    size_t   shardCount() const { return m_shards.size(); }
+    uint64_t evictions() const { return m_evictions.load(std::memory_order_relaxed); }
+
+private:
+    struct Entry {
+        ValuePtr                      value;
+        size_t                        bytes = 0;
+        mutable std::atomic<uint64_t> lastAccess{0};
+    };
+
+    // 对齐到缓存行，避免相邻分片的锁互相伪共享
+    struct alignas(64) Shard {
+        mutable std::shared_mutex                           mutex;
+        std::unordered_map<PlayerKey, Entry, PlayerKeyHash> entries;
+        size_t                                              residentBytes = 0;
+        std::atomic<uint64_t>                               clock{0};
+    };
+
+    size_t       shardIndexOf(const PlayerKey& key) const { return PlayerKeyHash{}(key) % m_shards.size(); }
+    Shard&       shardOf(const PlayerKey& key) { return *m_shards[shardIndexOf(key)]; }
+    const Shard& shardOf(const PlayerKey& key) const { return *m_shards[shardIndexOf(key)]; }
+
+    // 键、值与哈希表节点的大致开销
+    size_t entryBytes(const V& value) const {
+        return m_sizeOf(value) + sizeof(PlayerKey) + sizeof(Entry) + sizeof(void*) * 4;
+    }
+
+    // 在持有分片写锁时淘汰，keep 为刚写入的键（可为空），不参与淘汰
+    std::vector<PlayerKey> evictLocked(Shard& shard, const PlayerKey* keep) {
+        std::vector<PlayerKey> evicted;
+        size_t                   maxBytes = m_maxBytes.load(std::memory_order_relaxed);
+        if (maxBytes == 0) return evicted;
+        size_t shardMax = std::max<size_t>(maxBytes / m_shards.size(), 1);
+        if (shard.residentBytes <= shardMax) return evicted;
+
+        std::vector<std::pair<uint64_t, typename std::unordered_map<PlayerKey, Entry, PlayerKeyHash>::iterator>> candidates;
+        candidates.reserve(shard.entries.size());
+        for (auto it = shard.entries.begin(); it != shard.entries.end(); ++it) {
+            if ((keep && it->first == *keep) || (m_pinned && m_pinned->contains(it->first))) continue;
+            candidates.emplace_back(it->second.lastAccess.load(std::memory_order_relaxed), it);
+        }
+        std::sort(candidates.begin(), candidates.end(), [](const auto& a, const auto& b) {
+            return a.first < b.first;
+        });
+
+        size_t target = shardMax / 10 * 9;
+        for (auto& [tick, it] : candidates) {
+            if (shard.residentBytes <= target) break;
+            shard.residentBytes -= it->second.bytes;
+            evicted.push_back(it->first);
+            shard.entries.erase(it);
+        }
+        m_evictions.fetch_add(evicted.size(), std::memory_order_relaxed);
+        return evicted;
+    }
+
+    SizeOf                              m_sizeOf;
+    const PinnedKeys*                   m_pinned;
+    std::vector<std::unique_ptr<Shard>> m_shards;
+    std::atomic<size_t>                 m_maxBytes{0};
+    std::atomic<uint64_t>               m_evictions{0};
+};
+
+} // namespace internal
+} // namespace permission
+} // namespace BA
@@ -0,0 +1,97 @@
+#include "permission/PlayerKey.h"
+#include <deque>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+
+namespace BA {
+namespace permission {
+namespace internal {
+
+namespace {
+
+// 登记表中的键使用的高位；高位恰好全为 1 的标准 UUID 同样走登记表，不会与其混淆
+constexpr uint64_t INTERNED_TAG = UINT64_MAX;
+
+// 非标准格式字符串的登记表，只增不减（这类键很少见，通常来自脚本或命令传入的玩家名）
+class InternTable {
+public:
+    uint64_t intern(std::string_view value) {
+        {
+            std::shared_lock<std::shared_mutex> lock(m_mutex);
+            auto                                it = m_ids.find(std::string(value));
+            if (it != m_ids.end()) return it->second;
+        }
+        std::unique_lock<std::shared_mutex> lock(m_mutex);
+        auto [it, inserted] = m_ids.try_emplace(std::string(value), m_values.size());
+        if (inserted) m_values.emplace_back(value);
+        return it->second;
+    }
+
+    std::string lookup(uint64_t id) const {
+        std::shared_lock<std::shared_mutex> lock(m_mutex);
+        return id < m_values.size() ? m_values[id] : std::string();
+    }
+
+private:
+    mutable std::shared_mutex                 m_mutex;
+    std::unordered_map<std::string, uint64_t> m_ids;
+    std::deque<std::string>                   m_values;
+};
+
+InternTable& internTable() {
+    static InternTable table;
+    return table;
+}
+
+int hexValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    return -1;
+}
+
+constexpr bool isHyphenPosition(size_t i) { return i == 8 || i == 13 || i == 18 || i == 23; }
+
+} // namespace
+
+std::optional<PlayerKey> PlayerKey::parseUuid(std::string_view uuid) {
+    if (uuid.size() != 36) return std::nullopt;
+    PlayerKey key;
+    size_t    nibbles = 0;
+    for (size_t i = 0; i < uuid.size(); ++i) {
+        if (isHyphenPosition(i)) {
+            if (uuid[i] != '-') return std::nullopt;
+            continue;
+        }
+        int value = hexValue(uuid[i]);
+        if (value < 0) return std::nullopt;
+        uint64_t& half = nibbles < 16 ? key.high : key.low;
+        half           = (half << 4) | static_cast<uint64_t>(value);
+        ++nibbles;
+    }
+    return key;
+}
+
+PlayerKey PlayerKey::fromString(std::string_view uuid) {
+    if (auto key = parseUuid(uuid); key && key->high != INTERNED_TAG) return *key;
+    return PlayerKey{INTERNED_TAG, internTable().intern(uuid)};
+}
+
+std::string PlayerKey::toString() const {
+    if (high == INTERNED_TAG) return internTable().lookup(low);
+    static constexpr char digits[] = "0123456789abcdef";
+    std::string           out(36, '-');
+    size_t                nibble = 0;
+    for (size_t i = 0; i < out.size(); ++i) {
+        if (isHyphenPosition(i)) continue;
+        uint64_t half  = nibble < 16 ? high : low;
+        int      shift = static_cast<int>(60 - 4 * (nibble % 16));
+        out[i]         = digits[(half >> shift) & 0xF];
+        ++nibble;
+    }
+    return out;
+}
+
+} // namespace internal
+} // namespace permission
+} // namespace BA
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace BA {
+namespace permission {
+namespace internal {
+
+/**
+ * @brief 玩家在缓存中的键：UUID 的 128 位原始值。
+ *        在 API 入口处解析一次，之后缓存表、决策分片、固定集合与失效队列都只比较和哈希 16 个字节，
+ *        不再为每个键保存一份 36 字符的字符串。
+ *
+ *        只有小写的标准格式（8-4-4-4-12，与 mce::UUID::asString() 一致）才按位打包；
+ *        其他字符串（大写 UUID、玩家名等）被登记到进程内的名称表，键中保存表下标，
+ *        toString() 总能还原出原始字符串，传给存储层的值与调用方给出的完全一致。
+ */
+struct PlayerKey {
+    uint64_t high = 0;
+    uint64_t low  = 0;
+
+    /**
+     * @brief 获取字符串对应的键，总是成功。
+     * @param uuid 玩家 UUID（或其他玩家标识）。
+     */
+    static PlayerKey fromString(std::string_view uuid);
+
+    /**
+     * @brief 按标准格式解析 UUID。
+     * @return 解析结果；不是小写标准格式时返回 std::nullopt。
+     */
+    static std::optional<PlayerKey> parseUuid(std::string_view uuid);
+
+    // 还原为字符串
+    std::string toString() const;
+
+    bool operator==(const PlayerKey&) const = default;
+    auto operator<=>(const PlayerKey&) const = default;
+};
+
+/**
+ * @brief PlayerKey 的哈希函数。
+ *        登记表中的键高位相同、低位连续，因此两半混合后再做一次 64 位末端混淆，分片取模时分布均匀。
+ */
+struct PlayerKeyHash {
+    size_t operator()(const PlayerKey& key) const noexcept {
+        uint64_t x = key.high ^ (key.low + 0x9e3779b97f4a7c15ull + (key.high << 6) + (key.high >> 2));
+        x ^= x >> 33;
+        x *= 0xff51afd7ed558ccdull;
+        x ^= x >> 33;
+        x *= 0xc4ceb9fe1a85ec53ull;
+        x ^= x >> 33;
+        return static_cast<size_t>(x);
+    }
+};
+
+} // namespace internal
+} // namespace permission
+} // namespace BA
@@ -0,0 +1,124 @@
+#include "permission/RuleSetInterner.h"
+#include "permission/Metrics.h"
+#include <algorithm>
+
+namespace BA {
+namespace permission {
+namespace internal {
+
+namespace {
+
+const CompiledPermissionRule& ruleOf(const CompiledPermissionRule& rule) { return rule; }
+const CompiledPermissionRule& ruleOf(const CompiledPermissionRule* rule) { return *rule; }
+
+// 规则内容的 FNV-1a 哈希，模式之间以状态字节分隔
+template <typename Rules>
+uint64_t hashRules(const Rules& rules) {
+    uint64_t hash = 0xcbf29ce484222325ull;
+    auto     mix  = [&hash](unsigned char c) {
+        hash ^= c;
+        hash *= 0x100000001b3ull;
+    };
+    for (const auto& item : rules) {
+        const CompiledPermissionRule& rule = ruleOf(item);
+        for (unsigned char c : rule.pattern) mix(c);
+        mix(rule.state ? 0x01 : 0x00);
+        mix(0xff);
+    }
+    return hash;
+}
+
+template <typename Rules>
+bool sameRules(const std::vector<CompiledPermissionRule>& a, const Rules& b) {
+    return std::equal(a.begin(), a.end(), b.begin(), b.end(), [](const auto& x, const auto& y) {
+        const CompiledPermissionRule& rule = ruleOf(y);
+        return x.state == rule.state && x.pattern == rule.pattern;
+    });
+}
+
+} // namespace
+
+RuleSetInterner& RuleSetInterner::getInstance() {
+    static RuleSetInterner instance;
+    return instance;
+}
+
+template <typename Rules>
+std::shared_ptr<const CompiledRuleSet> RuleSetInterner::find(uint64_t hash, const Rules& rules) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto                        it = m_sets.find(hash);
+    if (it == m_sets.end()) return nullptr;
+    for (const auto& entry : it->second) {
+        auto ruleSet = entry.lock();
+        if (ruleSet && sameRules(ruleSet->rules, rules)) return ruleSet;
+    }
+    return nullptr;
+}
+
+std::shared_ptr<const CompiledRuleSet> RuleSetInterner::insert(std::shared_ptr<const CompiledRuleSet> compiled) {
+    if (auto found = find(compiled->hash, compiled->rules)) {
+        Metrics::getInstance().ruleSetInternHits.add();
+        return found;
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto&                       bucket = m_sets[compiled->hash];
+        auto                        before = bucket.size();
+        std::erase_if(bucket, [](const auto& entry) { return entry.expired(); });
+        m_entries -= before - bucket.size();
+        bucket.push_back(compiled);
+        if (++m_entries >= m_sweepAt) sweepLocked();
+    }
+    Metrics::getInstance().ruleSetInternMisses.add();
+    return compiled;
+}
+
+std::shared_ptr<const CompiledRuleSet> RuleSetInterner::intern(std::vector<CompiledPermissionRule> sortedRules) {
+    uint64_t hash = hashRules(sortedRules);
+    if (auto found = find(hash, sortedRules)) {
+        Metrics::getInstance().ruleSetInternHits.add();
+        return found;
+    }
+    // 匹配器的子集构造可能较慢，在锁外完成；期间其他线程插入了相同内容时使用先插入的那份
+    return insert(std::make_shared<const CompiledRuleSet>(std::move(sortedRules), hash));
+}
+
+std::shared_ptr<const CompiledRuleSet> RuleSetInterner::intern(std::span<const CompiledPermissionRule* const> sortedRules) {
+    uint64_t hash = hashRules(sortedRules);
+    if (auto found = find(hash, sortedRules)) {
+        Metrics::getInstance().ruleSetInternHits.add();
+        return found;
+    }
+    std::vector<CompiledPermissionRule> copied;
+    copied.reserve(sortedRules.size());
+    for (const auto* rule : sortedRules) copied.push_back(*rule);
+    return insert(std::make_shared<const CompiledRuleSet>(std::move(copied), hash));
+}
+
+void RuleSetInterner::sweepLocked() {
+    for (auto it = m_sets.begin(); it != m_sets.end();) {
+        std::erase_if(it->second, [](const auto& entry) { return entry.expired(); });
+        it = it->second.empty() ? m_sets.erase(it) : std::next(it);
+    }
+    m_entries = 0;
+    for (const auto& [hash, bucket] : m_sets) m_entries += bucket.size();
+    m_sweepAt = std::max(MIN_SWEEP_ENTRIES, m_entries * 2);
+}
+
+RuleSetInterner::Stats RuleSetInterner::stats() const {
+    Stats                       stats;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (const auto& [hash, bucket] : m_sets) {
+        for (const auto& entry : bucket) {
+            if (auto ruleSet = entry.lock()) {
+                ++stats.ruleSets;
+                stats.bytes += ruleSet->bytes;
+            }
+        }
+    }
+    return stats;
+}
+
+} // namespace internal
+} // namespace permission
+} // namespace BA
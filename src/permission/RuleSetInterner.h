@@ -0,0 +1,64 @@
+#pragma once
+
+#include "permission/PermissionSnapshot.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+namespace BA {
+namespace permission {
+namespace internal {
+
+/**
+ * @brief 进程内的规则集驻留表：规则内容 -> 已编译的 CompiledRuleSet。
+ *        同一组规则（例如属于相同权限组的玩家、内容相同的组）只编译一次匹配器、只保存一份规则，
+ *        所有快照共享同一个 shared_ptr。表中只保存 weak_ptr，最后一个快照释放后规则集随之释放，
+ *        失效的表项在插入时顺带清除。
+ */
+class RuleSetInterner {
+public:
+    struct Stats {
+        size_t ruleSets = 0; // 仍被快照持有的规则集数
+        size_t bytes    = 0; // 这些规则集的估算占用字节数
+    };
+
+    static RuleSetInterner& getInstance();
+
+    /**
+     * @brief 查找或编译规则集。命中时不构建匹配器；未命中时在锁外编译，避免阻塞其他线程的查找。
+     * @param sortedRules 已按 PermissionRuleSnapshot::sortByPriority 排序的规则。
+     * @return 与其他内容相同的快照共享的规则集。
+     */
+    std::shared_ptr<const CompiledRuleSet> intern(std::vector<CompiledPermissionRule> sortedRules);
+    /**
+     * @brief 同上，规则以指针给出（通常指向组权限层中的规则）；只有未命中时才复制规则。
+     */
+    std::shared_ptr<const CompiledRuleSet> intern(std::span<const CompiledPermissionRule* const> sortedRules);
+
+    Stats stats() const;
+
+private:
+    static constexpr size_t MIN_SWEEP_ENTRIES = 64;
+
+    RuleSetInterner() = default;
+
+    // 在哈希桶中查找内容相同且仍存活的规则集
+    template <typename Rules>
+    std::shared_ptr<const CompiledRuleSet> find(uint64_t hash, const Rules& rules);
+    // 插入新编译的规则集；其他线程已插入相同内容时返回先插入的那份
+    std::shared_ptr<const CompiledRuleSet> insert(std::shared_ptr<const CompiledRuleSet> compiled);
+    void                                   sweepLocked();
+
+    mutable std::mutex                                                                m_mutex;
+    std::unordered_map<uint64_t, std::vector<std::weak_ptr<const CompiledRuleSet>>> m_sets;    // 内容哈希 -> 规则集
+    size_t                                                                            m_entries = 0; // 表项数（含已失效的）
+    size_t m_sweepAt = MIN_SWEEP_ENTRIES; // 表项数达到该值时清除所有失效表项
+};
+
+} // namespace internal
+} // namespace permission
+} // namespace BA
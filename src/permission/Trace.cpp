@@ -0,0 +1,257 @@
+#include "permission/Trace.h"
+#include "permission/PermissionData.h"
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <unordered_map>
+
+namespace BA {
+namespace permission {
+namespace internal {
+
+static_assert((Tracer::RING_CAPACITY & (Tracer::RING_CAPACITY - 1)) == 0, "RING_CAPACITY 必须是 2 的幂");
+
+namespace {
+
+constexpr size_t RECORD_WORDS = 5; // 时间、key、aux、耗时、(value << 32 | kind << 16 | detail << 8 | event)
+
+const char* eventName(TraceEvent event) {
+    switch (event) {
+    case TraceEvent::INVALIDATOR_ENQUEUE:
+        return "invalidator.enqueue";
+    case TraceEvent::INVALIDATOR_MERGE:
+        return "invalidator.merge";
+    case TraceEvent::INVALIDATOR_TASK:
+        return "invalidator.task";
+    case TraceEvent::INVALIDATOR_FAILED:
+        return "invalidator.failed";
+    case TraceEvent::GROUPS_REBUILD:
+        return "cache.groups_rebuild";
+    case TraceEvent::PERMISSIONS_REBUILD:
+        return "cache.permissions_rebuild";
+    case TraceEvent::STATEMENT:
+        return "storage.statement";
+    case TraceEvent::WRITE_BEHIND_FLUSH:
+        return "write_behind.flush";
+    case TraceEvent::CLUSTER_RECEIVE:
+        return "cluster.receive";
+    case TraceEvent::EXPIRY_APPLIED:
+        return "expiry.applied";
+    }
+    return "unknown";
+}
+
+const char* taskTypeName(uint8_t type) {
+    switch (static_cast<CacheInvalidationTaskType>(type)) {
+    case CacheInvalidationTaskType::GROUP_MODIFIED:
+        return "GROUP_MODIFIED";
+    case CacheInvalidationTaskType::PLAYER_GROUP_CHANGED:
+        return "PLAYER_GROUP_CHANGED";
+    case CacheInvalidationTaskType::ALL_GROUPS_MODIFIED:
+        return "ALL_GROUPS_MODIFIED";
+    case CacheInvalidationTaskType::ALL_PLAYERS_MODIFIED:
+        return "ALL_PLAYERS_MODIFIED";
+    case CacheInvalidationTaskType::PLAYER_REFRESH:
+        return "PLAYER_REFRESH";
+    case CacheInvalidationTaskType::PLAYER_BATCH_GROUP_CHANGED:
+        return "PLAYER_BATCH_GROUP_CHANGED";
+    case CacheInvalidationTaskType::PERMISSION_DEFAULT_CHANGED:
+        return "PERMISSION_DEFAULT_CHANGED";
+    case CacheInvalidationTaskType::SHUTDOWN:
+        return "SHUTDOWN";
+    }
+    return "UNKNOWN";
+}
+
+bool isInvalidatorEvent(TraceEvent event) {
+    return event == TraceEvent::INVALIDATOR_ENQUEUE || event == TraceEvent::INVALIDATOR_MERGE
+        || event == TraceEvent::INVALIDATOR_TASK || event == TraceEvent::INVALIDATOR_FAILED;
+}
+
+} // namespace
+
+/**
+ * @brief 单个线程的环形缓冲区。每条记录由若干原子字组成，写入方只做 relaxed 存储：
+ *        写入第 n 条记录前先把 m_writing 置为 n + 1，写完后把 m_head 置为 n + 1；
+ *        读取方先读 m_head，复制记录后再读 m_writing，丢弃在复制期间可能被覆盖的记录。
+ */
+struct Tracer::Ring {
+    explicit Ring(uint32_t index) : m_index(index) {}
+
+    void write(const std::array<uint64_t, RECORD_WORDS>& words) {
+        uint64_t n = m_head.load(std::memory_order_relaxed);
+        m_writing.store(n + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        auto& slot = m_slots[n & (RING_CAPACITY - 1)];
+        for (size_t i = 0; i < RECORD_WORDS; ++i) slot[i].store(words[i], std::memory_order_relaxed);
+        m_head.store(n + 1, std::memory_order_release);
+    }
+
+    void copyTo(std::vector<TraceRecord>& out) const {
+        uint64_t head  = m_head.load(std::memory_order_acquire);
+        uint64_t first = head > RING_CAPACITY ? head - RING_CAPACITY : 0;
+        std::vector<std::array<uint64_t, RECORD_WORDS>> copied;
+        copied.reserve(static_cast<size_t>(head - first));
+        for (uint64_t n = first; n < head; ++n) {
+            const auto&                          slot = m_slots[n & (RING_CAPACITY - 1)];
+            std::array<uint64_t, RECORD_WORDS> words;
+            for (size_t i = 0; i < RECORD_WORDS; ++i) words[i] = slot[i].load(std::memory_order_relaxed);
+            copied.push_back(words);
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        // 已开始写入的记录都小于 writing，编号 n 的槽位只会被 n + RING_CAPACITY 及之后的记录覆盖
+        uint64_t writing = m_writing.load(std::memory_order_relaxed);
+        for (uint64_t n = first; n < head; ++n) {
+            if (n + RING_CAPACITY < writing) continue;
+            const auto& words = copied[static_cast<size_t>(n - first)];
+            TraceRecord record;
+            record.timestampNs = words[0];
+            record.key         = words[1];
+            record.aux         = words[2];
+            record.durationNs  = words[3];
+            record.event       = static_cast<TraceEvent>(words[4] & 0xff);
+            record.detail      = static_cast<uint8_t>((words[4] >> 8) & 0xff);
+            record.keyKind     = static_cast<TraceKey>((words[4] >> 16) & 0xff);
+            record.value       = static_cast<uint32_t>(words[4] >> 32);
+            record.buffer      = m_index;
+            out.push_back(record);
+        }
+    }
+
+    const uint32_t                                                      m_index;
+    std::atomic<bool>                                                   m_inUse = true;
+    alignas(64) std::atomic<uint64_t>                                   m_head{0};    // 已写完的记录数
+    std::atomic<uint64_t>                                               m_writing{0}; // 已开始写入的记录数
+    std::array<std::array<std::atomic<uint64_t>, RECORD_WORDS>, RING_CAPACITY> m_slots{};
+};
+
+namespace {
+
+// 线程退出时归还缓冲区
+struct RingLease {
+    Tracer::Ring* ring = nullptr;
+    ~RingLease() {
+        if (ring) ring->m_inUse.store(false, std::memory_order_release);
+    }
+};
+
+} // namespace
+
+Tracer& Tracer::getInstance() {
+    static Tracer instance;
+    return instance;
+}
+
+uint64_t Tracer::nameKey(std::string_view name) {
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (unsigned char c : name) {
+        hash ^= c;
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+Tracer::Ring& Tracer::currentRing() {
+    thread_local RingLease lease;
+    if (lease.ring) return *lease.ring;
+    std::lock_guard<std::mutex> lock(m_ringsMutex);
+    for (auto& ring : m_rings) {
+        bool expected = false;
+        if (ring->m_inUse.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+            lease.ring = ring.get();
+            return *lease.ring;
+        }
+    }
+    m_rings.push_back(std::make_unique<Ring>(static_cast<uint32_t>(m_rings.size())));
+    lease.ring = m_rings.back().get();
+    return *lease.ring;
+}
+
+void Tracer::write(
+    TraceEvent event,
+    uint8_t    detail,
+    TraceKey   kind,
+    uint64_t   key,
+    uint64_t   aux,
+    uint64_t   durationNs,
+    uint32_t   value
+) {
+    currentRing().write(
+        {now(),
+         key,
+         aux,
+         durationNs,
+         (uint64_t{value} << 32) | (uint64_t{static_cast<uint8_t>(kind)} << 16) | (uint64_t{detail} << 8)
+             | static_cast<uint8_t>(event)}
+    );
+}
+
+std::vector<TraceRecord> Tracer::snapshot(size_t maxRecords) const {
+    std::vector<TraceRecord> records;
+    {
+        std::lock_guard<std::mutex> lock(m_ringsMutex);
+        for (const auto& ring : m_rings) ring->copyTo(records);
+    }
+    std::sort(records.begin(), records.end(), [](const TraceRecord& a, const TraceRecord& b) {
+        return a.timestampNs < b.timestampNs;
+    });
+    if (maxRecords > 0 && records.size() > maxRecords) {
+        records.erase(records.begin(), records.end() - static_cast<std::ptrdiff_t>(maxRecords));
+    }
+    return records;
+}
+
+std::vector<std::string>
+Tracer::format(const std::vector<TraceRecord>& records, const std::vector<std::string>& names) {
+    std::unordered_map<uint64_t, const std::string*> nameByKey;
+    for (const auto& name : names) nameByKey.emplace(nameKey(name), &name);
+
+    uint64_t                 reference = now();
+    std::vector<std::string> lines;
+    lines.reserve(records.size());
+    char buffer[64];
+    for (const auto& record : records) {
+        double offset = (static_cast<double>(record.timestampNs) - static_cast<double>(reference)) / 1e9;
+        std::snprintf(buffer, sizeof(buffer), "%+.6fs #%u ", offset, record.buffer);
+        std::string line = buffer;
+        line += eventName(record.event);
+        if (isInvalidatorEvent(record.event)) {
+            line += ' ';
+            line += taskTypeName(record.detail);
+        } else if (record.event == TraceEvent::WRITE_BEHIND_FLUSH) {
+            line += record.detail ? " ok" : " failed";
+        }
+        switch (record.keyKind) {
+        case TraceKey::NAME: {
+            auto it = nameByKey.find(record.key);
+            if (it != nameByKey.end()) {
+                line += " name=" + *it->second;
+            } else {
+                std::snprintf(buffer, sizeof(buffer), " name#%016llx", static_cast<unsigned long long>(record.key));
+                line += buffer;
+            }
+            break;
+        }
+        case TraceKey::PLAYER:
+            line += " player=" + PlayerKey{record.aux, record.key}.toString();
+            break;
+        case TraceKey::LABEL:
+            line += ' ';
+            line += reinterpret_cast<const char*>(record.aux);
+            break;
+        case TraceKey::NONE:
+            break;
+        }
+        if (record.durationNs > 0) {
+            std::snprintf(buffer, sizeof(buffer), " %.3fms", static_cast<double>(record.durationNs) / 1e6);
+            line += buffer;
+        }
+        if (record.value > 0) line += " value=" + std::to_string(record.value);
+        lines.push_back(std::move(line));
+    }
+    return lines;
+}
+
+} // namespace internal
+} // namespace permission
+} // namespace BA
@@ -0,0 +1,122 @@
+#pragma once
+
+#include "permission/PlayerKey.h"
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace BA {
+namespace permission {
+namespace internal {
+
+// 追踪事件的类型
+enum class TraceEvent : uint8_t {
+    INVALIDATOR_ENQUEUE,  // 失效任务入队，detail 为任务类型
+    INVALIDATOR_MERGE,    // 失效任务与已排队的任务合并，detail 为任务类型
+    INVALIDATOR_TASK,     // 失效任务处理完成，value 为受影响的组数或玩家数
+    INVALIDATOR_FAILED,   // 失效任务处理时抛出异常
+    GROUPS_REBUILD,       // 构建玩家组快照（含数据库查询），value 为组数
+    PERMISSIONS_REBUILD,  // 构建玩家权限快照，value 为规则数
+    STATEMENT,            // 存储层语句，标签为语句名
+    WRITE_BEHIND_FLUSH,   // 写回队列提交，value 为修改数，detail 为 1 表示成功
+    CLUSTER_RECEIVE,      // 收到其他服务器的失效任务，value 为任务数
+    EXPIRY_APPLIED,       // 删除到期的玩家组关系，value 为关系数
+};
+
+// 记录中 key/aux 的含义
+enum class TraceKey : uint8_t {
+    NONE,
+    NAME,   // key 为组名或权限名的 FNV-1a 哈希，导出时按已知名称反查
+    PLAYER, // key/aux 为 PlayerKey 的 low/high，导出时还原为 UUID
+    LABEL,  // aux 为静态字符串（字符串字面量）的地址
+};
+
+/**
+ * @brief 一条追踪记录。在缓冲区中占 5 个 64 位字，写入时不分配内存、不格式化字符串。
+ */
+struct TraceRecord {
+    uint64_t   timestampNs = 0; // steady_clock 时间（纳秒）
+    uint64_t   key         = 0;
+    uint64_t   aux         = 0;
+    uint64_t   durationNs  = 0;
+    uint32_t   value       = 0;
+    TraceEvent event       = TraceEvent::INVALIDATOR_ENQUEUE;
+    uint8_t    detail      = 0;
+    TraceKey   keyKind     = TraceKey::NONE;
+    uint32_t   buffer      = 0; // 所在缓冲区的编号，只在 snapshot 的结果中有意义
+};
+
+/**
+ * @brief 低开销的结构化追踪：每个线程写入自己的固定大小环形缓冲区，写入无锁、不分配内存，
+ *        旧记录被新记录覆盖，因此可以在生产环境中一直开启；需要排查时通过 /ba trace 导出最近的记录。
+ *        缓冲区按 seqlock 的方式读取，读取时正在被覆盖的记录会被丢弃，写入方从不等待读取方。
+ *        线程退出后它的缓冲区会被之后创建的线程复用，缓冲区编号因此不等同于线程。
+ */
+class Tracer {
+public:
+    static constexpr size_t RING_CAPACITY = 4096; // 每个缓冲区保存的记录数，必须是 2 的幂
+
+    static Tracer& getInstance();
+
+    void setEnabled(bool enabled) { m_enabled.store(enabled, std::memory_order_relaxed); }
+    bool enabled() const { return m_enabled.load(std::memory_order_relaxed); }
+
+    // 组名、权限名等的哈希，与 TraceKey::NAME 的记录配合使用
+    static uint64_t nameKey(std::string_view name);
+    static uint64_t now() {
+        return static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+                .count()
+        );
+    }
+
+    void record(TraceEvent event, uint8_t detail, uint64_t durationNs = 0, uint32_t value = 0) {
+        if (enabled()) write(event, detail, TraceKey::NONE, 0, 0, durationNs, value);
+    }
+    void recordName(TraceEvent event, uint8_t detail, std::string_view name, uint64_t durationNs = 0, uint32_t value = 0) {
+        if (enabled()) write(event, detail, TraceKey::NAME, nameKey(name), 0, durationNs, value);
+    }
+    void recordPlayer(TraceEvent event, uint8_t detail, const PlayerKey& player, uint64_t durationNs = 0, uint32_t value = 0) {
+        if (enabled()) write(event, detail, TraceKey::PLAYER, player.low, player.high, durationNs, value);
+    }
+    // label 必须在进程生命周期内有效（通常是字符串字面量），记录中只保存地址
+    void recordLabel(TraceEvent event, const char* label, uint64_t durationNs = 0, uint32_t value = 0) {
+        if (enabled()) write(event, 0, TraceKey::LABEL, 0, reinterpret_cast<uint64_t>(label), durationNs, value);
+    }
+
+    /**
+     * @brief 复制所有缓冲区中的记录，按时间排序。可以在任意线程调用，不阻塞写入方。
+     * @param maxRecords 只保留最新的多少条，0 表示全部。
+     */
+    std::vector<TraceRecord> snapshot(size_t maxRecords = 0) const;
+
+    /**
+     * @brief 把记录格式化为文本，每条一行，时间为相对导出时刻的偏移。
+     * @param records snapshot 的结果。
+     * @param names 用于反查 TraceKey::NAME 记录的名称（组名、权限名）。
+     */
+    static std::vector<std::string>
+    format(const std::vector<TraceRecord>& records, const std::vector<std::string>& names);
+
+    struct Ring;
+
+private:
+    Tracer() = default;
+
+    void  write(TraceEvent event, uint8_t detail, TraceKey kind, uint64_t key, uint64_t aux, uint64_t durationNs, uint32_t value);
+    Ring& currentRing();
+
+    std::atomic<bool>                  m_enabled = true;
+    mutable std::mutex                 m_ringsMutex; // 只在线程首次写入和读取时使用
+    std::vector<std::unique_ptr<Ring>> m_rings;      // 缓冲区不会被释放，线程退出后留给新线程复用
+};
+
+} // namespace internal
+} // namespace permission
+} // namespace BA
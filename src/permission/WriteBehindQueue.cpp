@@ -0,0 +1,145 @@
+#include "permission/WriteBehindQueue.h"
+#include "ll/api/io/Logger.h"
+#include "ll/api/mod/NativeMod.h"
+#include "permission/Trace.h"
+#include <algorithm>
+
+namespace BA {
+namespace permission {
+namespace internal {
+
+WriteBehindQueue::WriteBehindQueue(
+    PermissionStorage&        storage,
+    std::chrono::milliseconds interval,
+    size_t                    maxBatch,
+    AppliedHandler            onApplied
+)
+: m_storage(storage),
+  m_interval(interval),
+  m_maxBatch(std::max<size_t>(maxBatch, 1)),
+  m_onApplied(std::move(onApplied)) {}
+
+WriteBehindQueue::~WriteBehindQueue() { stop(); }
+
+void WriteBehindQueue::start() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_running) return;
+    m_running = true;
+    m_thread  = std::thread(&WriteBehindQueue::run, this);
+}
+
+void WriteBehindQueue::stop() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_running) return;
+        m_running = false;
+    }
+    m_wakeup.notify_all();
+    if (m_thread.joinable()) m_thread.join(); // 后台线程退出前会提交剩余的修改
+}
+
+std::future<bool> WriteBehindQueue::enqueue(PlayerGroupMutation mutation, std::string groupName) {
+    std::promise<bool> promise;
+    auto               future = promise.get_future();
+    bool               notify = false;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_running) {
+            promise.set_value(false);
+            return future;
+        }
+        Key   key{mutation.playerUuid, mutation.groupId};
+        auto& pending    = m_pending[key];
+        pending.mutation = std::move(mutation); // 同一 (玩家, 组) 后到的修改覆盖先到的
+        pending.groupName = std::move(groupName);
+        pending.promises.push_back(std::move(promise));
+        pending.sequence = m_nextSequence++;
+        notify           = m_pending.size() >= m_maxBatch;
+    }
+    if (notify) m_wakeup.notify_one();
+    return future;
+}
+
+bool WriteBehindQueue::flush() {
+    // 提交后回调（事件监听器）中再次写入时会走到这里，提交线程不能等待自己
+    if (std::this_thread::get_id() == m_thread.get_id()) return true;
+    std::unique_lock<std::mutex> lock(m_mutex);
+    uint64_t                     target = m_nextSequence - 1;
+    uint64_t                     lowest = m_appliedSequence + 1;
+    if (target < lowest) return true; // 没有未完成的修改
+    m_flushRequested = true;
+    m_wakeup.notify_one();
+    m_committed.wait(lock, [&] { return m_appliedSequence >= target || (!m_running && m_pending.empty()); });
+    return m_lastFailedSequence < lowest;
+}
+
+size_t WriteBehindQueue::pendingCount() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_pending.size();
+}
+
+void WriteBehindQueue::run() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true) {
+        m_wakeup.wait_for(lock, m_interval, [this] {
+            return !m_running || m_flushRequested || m_pending.size() >= m_maxBatch;
+        });
+        if (!m_pending.empty()) {
+            std::map<Key, Pending> batch;
+            batch.swap(m_pending);
+            m_flushRequested = false;
+            lock.unlock();
+            apply(std::move(batch)); // 提交期间新的修改继续进入 m_pending
+            lock.lock();
+        } else {
+            m_flushRequested = false;
+        }
+        if (!m_running && m_pending.empty()) break;
+    }
+}
+
+void WriteBehindQueue::apply(std::map<Key, Pending> batch) {
+    std::vector<PlayerGroupMutation> mutations;
+    mutations.reserve(batch.size());
+    uint64_t maxSequence = 0;
+    for (const auto& [key, pending] : batch) {
+        mutations.push_back(pending.mutation);
+        maxSequence = std::max(maxSequence, pending.sequence);
+    }
+
+    uint64_t start = Tracer::now();
+    bool     ok    = m_storage.applyPlayerGroupMutations(mutations);
+    Tracer::getInstance()
+        .record(TraceEvent::WRITE_BEHIND_FLUSH, ok ? 1 : 0, Tracer::now() - start, static_cast<uint32_t>(mutations.size()));
+    if (!ok) {
+        ::ll::mod::NativeMod::current()->getLogger().warn("WriteBehindQueue: 批量提交 {} 条玩家组修改失败。", mutations.size());
+    }
+
+    if (ok && m_onApplied) {
+        std::vector<AppliedPlayerGroupMutation> applied;
+        applied.reserve(batch.size());
+        for (auto& [key, pending] : batch) {
+            applied.push_back({std::move(pending.mutation), std::move(pending.groupName)});
+        }
+        try {
+            m_onApplied(applied);
+        } catch (const std::exception& e) {
+            ::ll::mod::NativeMod::current()->getLogger().error("WriteBehindQueue: 提交后处理失败: {}", e.what());
+        }
+    }
+
+    // 先排队缓存失效并触发事件，再兑现 future，与同步接口的顺序一致
+    for (auto& [key, pending] : batch) {
+        for (auto& promise : pending.promises) promise.set_value(ok);
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_appliedSequence = std::max(m_appliedSequence, maxSequence);
+        if (!ok) m_lastFailedSequence = std::max(m_lastFailedSequence, maxSequence);
+    }
+    m_committed.notify_all();
+}
+
+} // namespace internal
+} // namespace permission
+} // namespace BA
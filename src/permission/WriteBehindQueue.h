@@ -0,0 +1,104 @@
+#pragma once
+
+#include "permission/PermissionStorage.h"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace BA {
+namespace permission {
+namespace internal {
+
+// 一条已提交的玩家组修改及其组名，用于提交后的缓存失效与事件
+struct AppliedPlayerGroupMutation {
+    PlayerGroupMutation mutation;
+    std::string         groupName;
+};
+
+/**
+ * @brief 玩家组关系修改的写回队列。
+ *        修改先进入内存队列，由后台线程每隔一段时间或积累到一定数量时在一个事务中批量提交（group commit），
+ *        同一 (玩家, 组) 的多次修改只保留最后一次。每次提交同时对应一个 future，在提交完成后给出结果。
+ */
+class WriteBehindQueue {
+public:
+    using AppliedHandler = std::function<void(const std::vector<AppliedPlayerGroupMutation>&)>;
+
+    /**
+     * @param storage 权限存储。
+     * @param interval 两次提交之间的最长间隔。
+     * @param maxBatch 积累到这么多条修改时立即提交。
+     * @param onApplied 每批成功提交后在后台线程中调用。
+     */
+    WriteBehindQueue(
+        PermissionStorage&        storage,
+        std::chrono::milliseconds interval,
+        size_t                    maxBatch,
+        AppliedHandler            onApplied
+    );
+    ~WriteBehindQueue();
+
+    void start();
+    // 提交剩余的修改并停止后台线程
+    void stop();
+
+    /**
+     * @brief 将一条修改加入队列。
+     * @param mutation 修改内容。
+     * @param groupName 组名（用于提交后的事件）。
+     * @return 修改被提交（或提交失败）后就绪的 future。
+     */
+    std::future<bool> enqueue(PlayerGroupMutation mutation, std::string groupName);
+
+    /**
+     * @brief 立即提交队列中的所有修改并等待完成。
+     * @return 调用时已在队列中的修改全部提交成功时返回 true。
+     */
+    bool flush();
+
+    // 队列中尚未提交的修改数量
+    size_t pendingCount() const;
+
+private:
+    struct Pending {
+        PlayerGroupMutation             mutation;
+        std::string                     groupName;
+        std::vector<std::promise<bool>> promises; // 被合并的每次调用各有一个
+        uint64_t                        sequence = 0;
+    };
+    using Key = std::pair<std::string, std::string>; // (玩家 UUID, 组 ID)
+
+    void run();
+    // 提交一批修改并兑现对应的 promise
+    void apply(std::map<Key, Pending> batch);
+
+    PermissionStorage&        m_storage;
+    std::chrono::milliseconds m_interval;
+    size_t                    m_maxBatch;
+    AppliedHandler            m_onApplied;
+
+    mutable std::mutex      m_mutex;
+    std::condition_variable m_wakeup;    // 通知后台线程提交
+    std::condition_variable m_committed; // 通知 flush 调用者某批已完成
+    std::map<Key, Pending>  m_pending;
+    uint64_t                m_nextSequence    = 1;
+    uint64_t                m_appliedSequence = 0; // 已完成（成功或失败）的最大序号
+    uint64_t                m_lastFailedSequence = 0; // 最近一次失败批次中的最大序号
+    bool                    m_flushRequested  = false;
+    bool                    m_running         = false;
+    std::thread             m_thread;
+};
+
+} // namespace internal
+} // namespace permission
+} // namespace BA
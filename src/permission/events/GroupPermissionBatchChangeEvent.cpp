@@ -0,0 +1,21 @@
+#include "permission/events/GroupPermissionBatchChangeEvent.h"
+#include <ll/api/event/Emitter.h>
+
+namespace BA::permission::event {
+
+std::string const&        GroupPermissionBatchChangeBeforeEvent::getGroupName() const { return mGroupName; }
+std::vector<std::string>& GroupPermissionBatchChangeBeforeEvent::getPermissionRules() const { return mPermissionRules; }
+bool const&               GroupPermissionBatchChangeBeforeEvent::isAdd() const { return mIsAdd; }
+
+class GroupPermissionBatchChangeBeforeEventEmitter
+: public ll::event::Emitter<[](auto&&...) { return nullptr; }, GroupPermissionBatchChangeBeforeEvent> {};
+
+
+std::string const&              GroupPermissionBatchChangeAfterEvent::getGroupName() const { return mGroupName; }
+std::vector<std::string> const& GroupPermissionBatchChangeAfterEvent::getPermissionRules() const { return mPermissionRules; }
+bool const&                     GroupPermissionBatchChangeAfterEvent::isAdd() const { return mIsAdd; }
+
+class GroupPermissionBatchChangeAfterEventEmitter
+: public ll::event::Emitter<[](auto&&...) { return nullptr; }, GroupPermissionBatchChangeAfterEvent> {};
+
+} // namespace BA::permission::event
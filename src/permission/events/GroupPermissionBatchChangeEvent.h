@@ -0,0 +1,57 @@
+#pragma once
+
+#include <ll/api/event/Cancellable.h>
+#include <ll/api/event/Event.h>
+#include <string>
+#include <vector>
+
+namespace BA::permission::event {
+
+// 批量修改组权限（addPermissionsToGroup / removePermissionsFromGroup）时整批触发一次。
+// 监听器可以从 getPermissionRules() 中删除规则来单独拒绝它们，取消事件则拒绝整批。
+class GroupPermissionBatchChangeBeforeEvent final : public ll::event::Cancellable<ll::event::Event> {
+protected:
+    std::string const&        mGroupName;
+    std::vector<std::string>& mPermissionRules;
+    bool const&               mIsAdd; // true for add, false for remove
+
+public:
+    constexpr explicit GroupPermissionBatchChangeBeforeEvent(
+        std::string const&        groupName,
+        std::vector<std::string>& permissionRules,
+        bool const&               isAdd
+    )
+    : mGroupName(groupName),
+      mPermissionRules(permissionRules),
+      mIsAdd(isAdd) {}
+
+public:
+    std::string const&        getGroupName() const;
+    std::vector<std::string>& getPermissionRules() const;
+    bool const&               isAdd() const;
+};
+
+// 批量修改写入数据库后触发一次，只包含实际写入的规则。
+class GroupPermissionBatchChangeAfterEvent final : public ll::event::Event {
+protected:
+    std::string const&              mGroupName;
+    std::vector<std::string> const& mPermissionRules;
+    bool const&                     mIsAdd; // true for add, false for remove
+
+public:
+    constexpr explicit GroupPermissionBatchChangeAfterEvent(
+        std::string const&              groupName,
+        std::vector<std::string> const& permissionRules,
+        bool const&                     isAdd
+    )
+    : mGroupName(groupName),
+      mPermissionRules(permissionRules),
+      mIsAdd(isAdd) {}
+
+public:
+    std::string const&              getGroupName() const;
+    std::vector<std::string> const& getPermissionRules() const;
+    bool const&                     isAdd() const;
+};
+
+} // namespace BA::permission::event
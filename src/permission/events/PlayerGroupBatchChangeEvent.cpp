@@ -0,0 +1,17 @@
+#include "permission/events/PlayerGroupBatchChangeEvent.h"
+#include <ll/api/event/Emitter.h>
+
+namespace BA::permission::event {
+
+std::vector<PlayerGroupChange>& PlayerGroupBatchChangeBeforeEvent::getChanges() const { return mChanges; }
+
+class PlayerGroupBatchChangeBeforeEventEmitter
+: public ll::event::Emitter<[](auto&&...) { return nullptr; }, PlayerGroupBatchChangeBeforeEvent> {};
+
+
+std::vector<PlayerGroupChange> const& PlayerGroupBatchChangeAfterEvent::getChanges() const { return mChanges; }
+
+class PlayerGroupBatchChangeAfterEventEmitter
+: public ll::event::Emitter<[](auto&&...) { return nullptr; }, PlayerGroupBatchChangeAfterEvent> {};
+
+} // namespace BA::permission::event
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <ll/api/event/Cancellable.h>
+#include <ll/api/event/Event.h>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace BA::permission::event {
+
+// 批量事件中的一条玩家组关系修改
+struct PlayerGroupChange {
+    std::string              playerUuid;
+    std::string              groupName;
+    std::optional<long long> expirationTime; // Unix timestamp in seconds, nullopt for permanent; join only
+    bool                     isJoin = true;  // true for join, false for leave
+};
+
+// 批量修改玩家组关系（addPlayerToGroups / removePlayerFromGroups）时整批触发一次。
+// 监听器可以从 getChanges() 中删除条目来单独拒绝它们，取消事件则拒绝整批。
+class PlayerGroupBatchChangeBeforeEvent final : public ll::event::Cancellable<ll::event::Event> {
+protected:
+    std::vector<PlayerGroupChange>& mChanges;
+
+public:
+    constexpr explicit PlayerGroupBatchChangeBeforeEvent(std::vector<PlayerGroupChange>& changes)
+    : mChanges(changes) {}
+
+public:
+    std::vector<PlayerGroupChange>& getChanges() const;
+};
+
+// 一批玩家组关系写入数据库后触发一次，包括上述批量接口与写回队列的每次提交。
+class PlayerGroupBatchChangeAfterEvent final : public ll::event::Event {
+protected:
+    std::vector<PlayerGroupChange> const& mChanges;
+
+public:
+    constexpr explicit PlayerGroupBatchChangeAfterEvent(std::vector<PlayerGroupChange> const& changes)
+    : mChanges(changes) {}
+
+public:
+    std::vector<PlayerGroupChange> const& getChanges() const;
+};
+
+} // namespace BA::permission::event
@@ -115,3 +115,33 @@ target("Bedrock-Authority") -- Change this to your mod name.
         os.cp(path.join(os.projectdir(), "src", "permission", "events", "*.h"), path.join(includedir, "permission", "events"))
         os.cp(path.join(target:targetdir(), target:name() .. ".lib"), libdir)
         end)
+
+-- 性能基准，不依赖 LeviLamina（日志与事件总线使用 bench/stubs 中的替身），在内存 SQLite 上运行：
+-- xmake build ba-bench && xmake run ba-bench [manager|cache] [参数...]
+target("ba-bench")
+    set_kind("binary")
+    set_default(false)
+    set_languages("c++20")
+    set_exceptions("cxx")
+    add_cxflags("/utf-8", {tools = {"cl", "clang_cl"}})
+    add_defines("NOMINMAX", "BA_EXPORTS", "BA_ENABLE_MYSQL=0", "BA_ENABLE_POSTGRESQL=0")
+    add_packages("sqlite3")
+    add_includedirs("bench/stubs", "src")
+    add_files("bench/*.cpp", "src/permission/*.cpp", "src/permission/events/*.cpp")
+    remove_files("src/permission/events/EventTest.cpp")
+    add_files("src/db/DatabaseFactory.cpp", "src/db/PooledDatabase.cpp", "src/db/SQLiteDatabase.cpp")
+
+-- 调用回放：把 /ba record start 录制的调用重新驱动到内存（或指定文件的）SQLite 上，报告吞吐、尾延迟与缓存命中率：
+-- xmake build ba-replay && xmake run ba-replay <录制文件> [--speed N] [--threads N] [--data 导出文件] [选项...]
+target("ba-replay")
+    set_kind("binary")
+    set_default(false)
+    set_languages("c++20")
+    set_exceptions("cxx")
+    add_cxflags("/utf-8", {tools = {"cl", "clang_cl"}})
+    add_defines("NOMINMAX", "BA_EXPORTS", "BA_ENABLE_MYSQL=0", "BA_ENABLE_POSTGRESQL=0")
+    add_packages("sqlite3")
+    add_includedirs("bench/stubs", "src")
+    add_files("bench/replay/*.cpp", "src/permission/*.cpp", "src/permission/events/*.cpp")
+    remove_files("src/permission/events/EventTest.cpp")
+    add_files("src/db/DatabaseFactory.cpp", "src/db/PooledDatabase.cpp", "src/db/SQLiteDatabase.cpp")